@@ -21,6 +21,25 @@
  */
 #define VGA_PHYSICAL_BASE (0xA0000)
 
+/**
+ * Physical base address of the window through which
+ * the text is accessed in text mode.
+ */
+#define VGA_TEXT_PHYSICAL_BASE (0xB0000)
+
+/**
+ * Size of the text mode window, in bytes.
+ */
+#define VGA_TEXT_WINDOW_BYTES (0x10000)
+
+/**
+ * Default text mode geometry, assumed if the CRTC
+ * registers don't make sense (mode 03h).
+ */
+#define DEFAULT_TEXT_COLUMNS (80)
+#define DEFAULT_TEXT_ROWS (25)
+#define DEFAULT_TEXT_CHAR_HEIGHT (16)
+
 /**
  * DAC read index register.
  * Writes to this register determine the index
@@ -34,6 +53,37 @@
  */
 #define DAC_DATA_REG (0x3C9)
 
+/**
+ * Sequencer index register.
+ */
+#define SEQ_INDEX_REG (0x3C4)
+
+/**
+ * Sequencer data register.
+ */
+#define SEQ_DATA_REG (0x3C5)
+
+/**
+ * Index of the Sequencer Character Map Select register.
+ */
+#define SEQ_CHARACTER_MAP_SELECT_INDEX (3)
+
+/**
+ * Index of the Sequencer Memory Mode register.
+ */
+#define SEQ_MEMORY_MODE_INDEX (4)
+
+/**
+ * Sequencer Memory Mode register - odd/even host memory
+ * addressing is disabled.
+ */
+#define SEQ_MEMORY_MODE_ODD_EVEN_DISABLE (0x04)
+
+/**
+ * Sequencer Memory Mode register - chain 4 addressing is enabled.
+ */
+#define SEQ_MEMORY_MODE_CHAIN_4 (0x08)
+
 /**
  * Graphics Controller index register.
  */
@@ -54,6 +104,184 @@
  */
 #define GC_MODE_INDEX (5)
 
+/**
+ * GC Mode register - read mode 1 is selected.
+ */
+#define GC_MODE_READ_MODE_1 (0x08)
+
+/**
+ * GC Mode register - host odd/even addressing is enabled.
+ */
+#define GC_MODE_HOST_ODD_EVEN (0x10)
+
+/**
+ * Index of the GC Miscellaneous register.
+ */
+#define GC_MISC_INDEX (6)
+
+/**
+ * GC Miscellaneous register - graphics mode is selected.
+ */
+#define GC_MISC_GRAPHICS (0x01)
+
+/**
+ * GC Miscellaneous register - the memory map select field.
+ */
+#define GC_MISC_MEMORY_MAP_SHIFT (2)
+#define GC_MISC_MEMORY_MAP_MASK (0x03)
+
+/**
+ * GC Miscellaneous register memory maps.
+ */
+#define GC_MISC_MEMORY_MAP_A0000_128K (0)
+#define GC_MISC_MEMORY_MAP_A0000_64K (1)
+#define GC_MISC_MEMORY_MAP_B0000_32K (2)
+#define GC_MISC_MEMORY_MAP_B8000_32K (3)
+
+/**
+ * Plane that holds the fonts in text mode.
+ */
+#define FONT_PLANE (2)
+
+/**
+ * Attribute Controller index register.
+ * Data is also written here, on alternate writes.
+ */
+#define AC_INDEX_REG (0x3C0)
+
+/**
+ * Attribute Controller data read register.
+ */
+#define AC_DATA_READ_REG (0x3C1)
+
+/**
+ * Attribute Controller index register - the palette
+ * address source bit. While it is clear, the display is off.
+ */
+#define AC_PALETTE_ADDRESS_SOURCE (0x20)
+
+/**
+ * Index of the AC Attribute Mode Control register.
+ */
+#define AC_MODE_CONTROL_INDEX (0x10)
+
+/**
+ * Index of the AC Color Select register.
+ */
+#define AC_COLOR_SELECT_INDEX (0x14)
+
+/**
+ * Input Status #1 register, when the color addresses are selected.
+ * Reading it resets the Attribute Controller's index/data flip-flop.
+ */
+#define INPUT_STATUS_1_COLOR_REG (0x3DA)
+
+/**
+ * Input Status #1 register, when the monochrome addresses are selected.
+ */
+#define INPUT_STATUS_1_MONO_REG (0x3BA)
+
+/**
+ * Miscellaneous Output register, read port.
+ * Bit 0 selects between the color and monochrome
+ * CRTC register addresses.
+ */
+#define MISC_OUTPUT_READ_REG (0x3CC)
+
+/**
+ * CRTC index register, when the color addresses are selected.
+ */
+#define CRTC_COLOR_INDEX_REG (0x3D4)
+
+/**
+ * CRTC index register, when the monochrome addresses are selected.
+ */
+#define CRTC_MONO_INDEX_REG (0x3B4)
+
+/**
+ * Index of the CRTC End Horizontal Display register.
+ */
+#define CRTC_HORIZONTAL_DISPLAY_END_INDEX (0x01)
+
+/**
+ * Index of the CRTC Overflow register.
+ */
+#define CRTC_OVERFLOW_INDEX (0x07)
+
+/**
+ * Index of the CRTC Maximum Scan Line register.
+ */
+#define CRTC_MAX_SCAN_LINE_INDEX (0x09)
+
+/**
+ * Index of the CRTC Start Address High register.
+ */
+#define CRTC_START_ADDRESS_HIGH_INDEX (0x0C)
+
+/**
+ * Index of the CRTC Start Address Low register.
+ */
+#define CRTC_START_ADDRESS_LOW_INDEX (0x0D)
+
+/**
+ * Index of the CRTC Vertical Display End register.
+ */
+#define CRTC_VERTICAL_DISPLAY_END_INDEX (0x12)
+
+/**
+ * Index of the CRTC Offset register.
+ */
+#define CRTC_OFFSET_INDEX (0x13)
+
+/**
+ * CRTC Maximum Scan Line register - the maximum scan line field.
+ */
+#define CRTC_MAX_SCAN_LINE_MASK (0x1F)
+
+/**
+ * CRTC Maximum Scan Line register - scan lines are doubled.
+ */
+#define CRTC_MAX_SCAN_LINE_DOUBLE_SCAN (0x80)
+
+
+/** Typedefs ************************************************************/
+
+/**
+ * Structure of the capture buffer.
+ * Only as much of it as the detected geometry requires
+ * is saved to the dump file.
+ */
+typedef struct _VGA_CAPTURE
+{
+	VGA_CAPTURE_HEADER	tHeader;
+	PALETTE_ENTRY		atPaletteEntries[VGA_DAC_PALETTE_ENTRIES];
+
+	// The screen contents, laid out as described
+	// by VGA_CAPTURE_HEADER.
+	UCHAR				anPayload[VGA_PLANES * VGA_PLANE_MAX_BYTES];
+} VGA_CAPTURE, *PVGA_CAPTURE;
+
+/**
+ * Display timings, as programmed into the CRTC.
+ */
+typedef struct _VGA_CRTC_TIMINGS
+{
+	// Number of displayed character clocks in each scan line.
+	ULONG	nCharacterClocks;
+
+	// Number of displayed scan lines, accounting for double scanning.
+	ULONG	nScanLines;
+
+	// Number of scan lines in each character row.
+	ULONG	nCharHeight;
+
+	// Distance between rows, in words.
+	ULONG	nOffset;
+
+	// Memory address of the first displayed character.
+	ULONG	nStartAddress;
+} VGA_CRTC_TIMINGS, *PVGA_CRTC_TIMINGS;
+
 
 /** Globals *************************************************************/
 
@@ -62,6 +290,20 @@
  */
 STATIC PVOID g_pvVgaBase = NULL;
 
+/**
+ * Mapped text mode window base address.
+ */
+STATIC PVOID g_pvTextBase = NULL;
+
+/**
+ * Offsets of the fonts in plane 2, indexed by
+ * the character map select fields.
+ */
+STATIC CONST ULONG g_anFontOffsets[] = {
+	0x0000, 0x4000, 0x8000, 0xC000,
+	0x2000, 0x6000, 0xA000, 0xE000,
+};
+
  /**
  * VGA dump callback registration record.
  */
@@ -77,7 +319,12 @@ STATIC BOOLEAN g_bCallbackRegistered = FALSE;
  * Special alignment is due to bugcheck callback requirements.
  * See the MSDN for more information.
  */
-STATIC DECLSPEC_ALIGN(PAGE_SIZE) VGA_DUMP g_tDump = { 0 };
+STATIC DECLSPEC_ALIGN(PAGE_SIZE) VGA_CAPTURE g_tDump = { 0 };
+
+/**
+ * Number of bytes of g_tDump that are in use.
+ */
+STATIC ULONG g_cbDump = 0;
 
 /**
  * Counts how many times interrupts have been disabled.
@@ -245,6 +492,7 @@ vgadump_DumpPalette(
  * Dumps a single VGA plane.
  *
  * @param[in]	nPlane	Index of the plane to dump.
+ * @param[in]	nOffset	Offset in the plane to start dumping from.
  * @param[out]	pvPlane	Will receive the plane's data.
  * @param[in]	cbPlane	Size of the output buffer, in bytes.
  */
@@ -252,6 +500,7 @@ STATIC
 VOID
 vgadump_DumpPlane(
 	_In_							ULONG	nPlane,
+	_In_							ULONG	nOffset,
 	_Out_writes_bytes_all_(cbPlane)	PVOID	pvPlane,
 	_In_							ULONG	cbPlane
 )
@@ -262,6 +511,8 @@ vgadump_DumpPlane(
 	ASSERT(nPlane < VGA_PLANES);
 	ASSERT(NULL != pvPlane);
 	ASSERT(0 != cbPlane);
+	ASSERT(VGA_PLANE_MAX_BYTES >= nOffset);
+	ASSERT(VGA_PLANE_MAX_BYTES - nOffset >= cbPlane);
 
 	vgadump_DisableInterrupts();
 	{
@@ -284,21 +535,500 @@ vgadump_DumpPlane(
 								  (UCHAR)nPlane);
 
 		// Copy the video memory
-		RtlMoveMemory(pvPlane, g_pvVgaBase, cbPlane);
+		RtlMoveMemory(pvPlane, (PUCHAR)g_pvVgaBase + nOffset, cbPlane);
+
+		// Restore values
+		vgadump_WriteRegisterByte(GC_INDEX_REG,
+								  GC_DATA_REG,
+								  GC_READ_MAP_INDEX,
+								  nOldPlane);
+		vgadump_WriteRegisterByte(GC_INDEX_REG,
+								  GC_DATA_REG,
+								  GC_MODE_INDEX,
+								  fOldGcMode);
+	}
+	vgadump_EnableInterrupts();
+}
+
+/**
+ * Determines whether the VGA's registers are at
+ * the color addresses, rather than the monochrome ones.
+ *
+ * @returns BOOLEAN
+ */
+STATIC
+BOOLEAN
+vgadump_IsColor(VOID)
+{
+	return 0 != (__inbyte(MISC_OUTPUT_READ_REG) & 1);
+}
+
+/**
+ * Reads the display timings from the CRTC registers.
+ *
+ * @param[out]	ptTimings	Will receive the timings.
+ */
+STATIC
+VOID
+vgadump_ReadCrtcTimings(
+	_Out_	PVGA_CRTC_TIMINGS	ptTimings
+)
+{
+	USHORT	nCrtcIndexRegister	= 0;
+	USHORT	nCrtcDataRegister	= 0;
+	UCHAR	fOverflow			= 0;
+	UCHAR	fMaxScanLine		= 0;
+	ULONG	nScanLines			= 0;
+	ULONG	nStartAddress		= 0;
+
+	ASSERT(NULL != ptTimings);
+
+	nCrtcIndexRegister =
+		(vgadump_IsColor())
+		? (CRTC_COLOR_INDEX_REG)
+		: (CRTC_MONO_INDEX_REG);
+	nCrtcDataRegister = nCrtcIndexRegister + 1;
+
+	ptTimings->nCharacterClocks = vgadump_ReadRegisterByte(nCrtcIndexRegister,
+														   nCrtcDataRegister,
+														   CRTC_HORIZONTAL_DISPLAY_END_INDEX) + 1;
+
+	// The vertical display end is 10 bits wide, and its top bits
+	// are in the overflow register.
+	fOverflow = vgadump_ReadRegisterByte(nCrtcIndexRegister,
+										 nCrtcDataRegister,
+										 CRTC_OVERFLOW_INDEX);
+	fMaxScanLine = vgadump_ReadRegisterByte(nCrtcIndexRegister,
+											nCrtcDataRegister,
+											CRTC_MAX_SCAN_LINE_INDEX);
+	nScanLines = vgadump_ReadRegisterByte(nCrtcIndexRegister,
+										  nCrtcDataRegister,
+										  CRTC_VERTICAL_DISPLAY_END_INDEX);
+	nScanLines |= ((fOverflow >> 1) & 1) << 8;
+	nScanLines |= ((fOverflow >> 6) & 1) << 9;
+	nScanLines += 1;
+	if (0 != (fMaxScanLine & CRTC_MAX_SCAN_LINE_DOUBLE_SCAN))
+	{
+		nScanLines /= 2;
+	}
+	ptTimings->nScanLines = nScanLines;
+	ptTimings->nCharHeight = (fMaxScanLine & CRTC_MAX_SCAN_LINE_MASK) + 1;
+
+	ptTimings->nOffset = vgadump_ReadRegisterByte(nCrtcIndexRegister,
+												  nCrtcDataRegister,
+												  CRTC_OFFSET_INDEX);
+
+	nStartAddress = vgadump_ReadRegisterByte(nCrtcIndexRegister,
+											 nCrtcDataRegister,
+											 CRTC_START_ADDRESS_HIGH_INDEX) << 8;
+	nStartAddress |= vgadump_ReadRegisterByte(nCrtcIndexRegister,
+											  nCrtcDataRegister,
+											  CRTC_START_ADDRESS_LOW_INDEX);
+	ptTimings->nStartAddress = nStartAddress;
+}
+
+/**
+ * Dumps the Attribute Controller registers that
+ * take part in translating pixel values to DAC entries.
+ *
+ * @param[out]	ptHeader	Will receive the registers' values.
+ *
+ * @remark	The palette registers can only be read while
+ *			the display is off, so the screen blanks momentarily.
+ */
+STATIC
+VOID
+vgadump_DumpAttributeRegisters(
+	_Inout_	PVGA_CAPTURE_HEADER	ptHeader
+)
+{
+	USHORT	nInputStatusRegister	= 0;
+	UCHAR	nOldIndex				= 0;
+	ULONG	nEntry					= 0;
+
+	ASSERT(NULL != ptHeader);
+
+	//
+	// NOTE: We don't use the safe register functions
+	//       here because the AC has a single port for
+	//       both the index and the data, and a flip-flop
+	//       to tell them apart.
+	//
+
+	nInputStatusRegister =
+		(vgadump_IsColor())
+		? (INPUT_STATUS_1_COLOR_REG)
+		: (INPUT_STATUS_1_MONO_REG);
+
+	vgadump_DisableInterrupts();
+	{
+		// Reading the index doesn't disturb the flip-flop.
+		nOldIndex = __inbyte(AC_INDEX_REG);
+
+		for (nEntry = 0; nEntry < VGA_ATTRIBUTE_PALETTE_ENTRIES; ++nEntry)
+		{
+			(VOID)__inbyte(nInputStatusRegister);
+			__outbyte(AC_INDEX_REG, (UCHAR)nEntry);
+			ptHeader->anAttributePalette[nEntry] = __inbyte(AC_DATA_READ_REG);
+		}
+
+		(VOID)__inbyte(nInputStatusRegister);
+		__outbyte(AC_INDEX_REG, AC_MODE_CONTROL_INDEX | AC_PALETTE_ADDRESS_SOURCE);
+		ptHeader->fAttributeMode = __inbyte(AC_DATA_READ_REG);
+
+		(VOID)__inbyte(nInputStatusRegister);
+		__outbyte(AC_INDEX_REG, AC_COLOR_SELECT_INDEX | AC_PALETTE_ADDRESS_SOURCE);
+		ptHeader->fColorSelect = __inbyte(AC_DATA_READ_REG);
+
+		// Restore the index, turning the display back on,
+		// and leave the flip-flop expecting an index.
+		(VOID)__inbyte(nInputStatusRegister);
+		__outbyte(AC_INDEX_REG, nOldIndex | AC_PALETTE_ADDRESS_SOURCE);
+		(VOID)__inbyte(nInputStatusRegister);
+	}
+	vgadump_EnableInterrupts();
+}
+
+/**
+ * Dumps the font used for text mode, from plane 2.
+ *
+ * @param[out]	pnFont		Will receive the glyphs.
+ * @param[in]	nCharHeight	Number of scan lines to dump from each glyph.
+ */
+STATIC
+VOID
+vgadump_DumpFont(
+	_Out_writes_all_(VGA_FONT_GLYPHS * nCharHeight)	PUCHAR	pnFont,
+	_In_											ULONG	nCharHeight
+)
+{
+	UCHAR			fCharacterMapSelect	= 0;
+	ULONG			nFontOffset			= 0;
+	UCHAR			fOldMemoryMode		= 0;
+	UCHAR			fOldGcMode			= 0;
+	UCHAR			fOldGcMisc			= 0;
+	UCHAR			nOldPlane			= 0;
+	ULONG			nGlyph				= 0;
+	CONST UCHAR *	pnPlane				= (CONST UCHAR *)g_pvVgaBase;
+
+	ASSERT(NULL != pnFont);
+	ASSERT(VGA_FONT_GLYPH_MAX_HEIGHT >= nCharHeight);
+
+	// Only the first font (map A) is captured. It's the only one
+	// unless 512-character mode is in use.
+	fCharacterMapSelect = vgadump_ReadRegisterByte(SEQ_INDEX_REG,
+												   SEQ_DATA_REG,
+												   SEQ_CHARACTER_MAP_SELECT_INDEX);
+	nFontOffset = g_anFontOffsets[(((fCharacterMapSelect >> 5) & 1) << 2) |
+								  ((fCharacterMapSelect >> 2) & 3)];
+
+	vgadump_DisableInterrupts();
+	{
+		// Address the planes sequentially through the A0000 window,
+		// in read mode 0, just like in the planar graphics modes.
+		fOldMemoryMode = vgadump_ReadRegisterByte(SEQ_INDEX_REG,
+												  SEQ_DATA_REG,
+												  SEQ_MEMORY_MODE_INDEX);
+		vgadump_WriteRegisterByte(SEQ_INDEX_REG,
+								  SEQ_DATA_REG,
+								  SEQ_MEMORY_MODE_INDEX,
+								  (fOldMemoryMode | SEQ_MEMORY_MODE_ODD_EVEN_DISABLE) & (~SEQ_MEMORY_MODE_CHAIN_4));
+		fOldGcMode = vgadump_ReadRegisterByte(GC_INDEX_REG,
+											  GC_DATA_REG,
+											  GC_MODE_INDEX);
+		vgadump_WriteRegisterByte(GC_INDEX_REG,
+								  GC_DATA_REG,
+								  GC_MODE_INDEX,
+								  fOldGcMode & (~(GC_MODE_READ_MODE_1 | GC_MODE_HOST_ODD_EVEN)));
+		fOldGcMisc = vgadump_ReadRegisterByte(GC_INDEX_REG,
+											  GC_DATA_REG,
+											  GC_MISC_INDEX);
+		vgadump_WriteRegisterByte(GC_INDEX_REG,
+								  GC_DATA_REG,
+								  GC_MISC_INDEX,
+								  (fOldGcMisc & GC_MISC_GRAPHICS) |
+								  (GC_MISC_MEMORY_MAP_A0000_64K << GC_MISC_MEMORY_MAP_SHIFT));
+		nOldPlane = vgadump_ReadRegisterByte(GC_INDEX_REG,
+											 GC_DATA_REG,
+											 GC_READ_MAP_INDEX);
+		vgadump_WriteRegisterByte(GC_INDEX_REG,
+								  GC_DATA_REG,
+								  GC_READ_MAP_INDEX,
+								  FONT_PLANE);
+
+		// Glyphs are always VGA_FONT_GLYPH_MAX_HEIGHT bytes apart,
+		// but we only need the scan lines that are displayed.
+		for (nGlyph = 0; nGlyph < VGA_FONT_GLYPHS; ++nGlyph)
+		{
+			RtlMoveMemory(pnFont + (nGlyph * nCharHeight),
+						  pnPlane + nFontOffset + (nGlyph * VGA_FONT_GLYPH_MAX_HEIGHT),
+						  nCharHeight);
+		}
 
 		// Restore values
 		vgadump_WriteRegisterByte(GC_INDEX_REG,
 								  GC_DATA_REG,
 								  GC_READ_MAP_INDEX,
 								  nOldPlane);
+		vgadump_WriteRegisterByte(GC_INDEX_REG,
+								  GC_DATA_REG,
+								  GC_MISC_INDEX,
+								  fOldGcMisc);
 		vgadump_WriteRegisterByte(GC_INDEX_REG,
 								  GC_DATA_REG,
 								  GC_MODE_INDEX,
 								  fOldGcMode);
+		vgadump_WriteRegisterByte(SEQ_INDEX_REG,
+								  SEQ_DATA_REG,
+								  SEQ_MEMORY_MODE_INDEX,
+								  fOldMemoryMode);
 	}
 	vgadump_EnableInterrupts();
 }
 
+/**
+ * Captures the screen in a planar graphics mode.
+ * If the CRTC registers don't make sense,
+ * the geometry of mode 12h is assumed.
+ *
+ * @param[in,out]	ptHeader	Will receive the geometry.
+ * @param[out]		pnPayload	Will receive the planes.
+ *
+ * @returns The size of the captured planes, in bytes.
+ */
+STATIC
+ULONG
+vgadump_CaptureGraphics(
+	_Inout_											PVGA_CAPTURE_HEADER	ptHeader,
+	_Out_writes_(VGA_PLANES * VGA_PLANE_MAX_BYTES)	PUCHAR				pnPayload
+)
+{
+	VGA_CRTC_TIMINGS	tTimings		= { 0 };
+	ULONG				nWidth			= 0;
+	ULONG				nHeight			= 0;
+	ULONG				cbStride		= 0;
+	ULONG				nStartAddress	= 0;
+	ULONG				cbPlane			= 0;
+	ULONG				nPlane			= 0;
+
+	ASSERT(NULL != ptHeader);
+	ASSERT(NULL != pnPayload);
+
+	vgadump_ReadCrtcTimings(&tTimings);
+
+	// Each character clock is 8 pixels wide, and the maximum
+	// scan line repeats each row of pixels. The offset register
+	// counts words, and the planar modes use byte addressing.
+	nWidth = tTimings.nCharacterClocks * PIXELS_IN_BYTE;
+	nHeight = tTimings.nScanLines / tTimings.nCharHeight;
+	cbStride = tTimings.nOffset * 2;
+	nStartAddress = tTimings.nStartAddress;
+
+	if ((0 == nHeight) ||
+		(nWidth > cbStride * PIXELS_IN_BYTE) ||
+		(nStartAddress + (cbStride * nHeight) > VGA_PLANE_MAX_BYTES))
+	{
+		nWidth = SCREEN_WIDTH_PIXELS;
+		nHeight = SCREEN_HEIGHT_PIXELS;
+		cbStride = SCREEN_WIDTH_PIXELS / PIXELS_IN_BYTE;
+		nStartAddress = 0;
+	}
+
+	ptHeader->eMode = VGA_CAPTURE_MODE_GRAPHICS;
+	ptHeader->nWidth = nWidth;
+	ptHeader->nHeight = nHeight;
+	ptHeader->cbStride = cbStride;
+	ptHeader->nPlanes = VGA_PLANES;
+
+	cbPlane = cbStride * nHeight;
+	for (nPlane = 0; nPlane < VGA_PLANES; ++nPlane)
+	{
+		vgadump_DumpPlane(nPlane,
+						  nStartAddress,
+						  pnPayload + (nPlane * cbPlane),
+						  cbPlane);
+	}
+
+	return VGA_PLANES * cbPlane;
+}
+
+/**
+ * Captures the screen in text mode: the characters,
+ * their attributes and the font.
+ * If the CRTC registers don't make sense,
+ * the geometry of mode 03h is assumed.
+ *
+ * @param[in,out]	ptHeader	Will receive the geometry.
+ * @param[out]		pnPayload	Will receive the text and the font.
+ *
+ * @returns The size of the captured text and font, in bytes.
+ */
+STATIC
+ULONG
+vgadump_CaptureText(
+	_Inout_											PVGA_CAPTURE_HEADER	ptHeader,
+	_Out_writes_(VGA_PLANES * VGA_PLANE_MAX_BYTES)	PUCHAR				pnPayload
+)
+{
+	VGA_CRTC_TIMINGS	tTimings		= { 0 };
+	CONST UCHAR *		pnWindow		= NULL;
+	ULONG				cbWindow		= 0;
+	ULONG				nColumns		= 0;
+	ULONG				nRows			= 0;
+	ULONG				nCharHeight		= 0;
+	ULONG				cbWindowStride	= 0;
+	ULONG				nStartOffset	= 0;
+	ULONG				cbRow			= 0;
+	ULONG				nRow			= 0;
+
+	ASSERT(NULL != ptHeader);
+	ASSERT(NULL != pnPayload);
+
+	// Find where the text is visible to the CPU.
+	switch ((vgadump_ReadRegisterByte(GC_INDEX_REG,
+									  GC_DATA_REG,
+									  GC_MISC_INDEX) >> GC_MISC_MEMORY_MAP_SHIFT) & GC_MISC_MEMORY_MAP_MASK)
+	{
+	case GC_MISC_MEMORY_MAP_B0000_32K:
+		pnWindow = (CONST UCHAR *)g_pvTextBase;
+		cbWindow = VGA_TEXT_WINDOW_BYTES / 2;
+		break;
+
+	case GC_MISC_MEMORY_MAP_B8000_32K:
+		pnWindow = (CONST UCHAR *)g_pvTextBase + (VGA_TEXT_WINDOW_BYTES / 2);
+		cbWindow = VGA_TEXT_WINDOW_BYTES / 2;
+		break;
+
+	default:
+		pnWindow = (CONST UCHAR *)g_pvVgaBase;
+		cbWindow = VGA_PLANE_MAX_BYTES;
+		break;
+	}
+
+	vgadump_ReadCrtcTimings(&tTimings);
+
+	// Each character clock is a column, and each character
+	// spans maximum scan line rows of pixels.
+	// The offset register and the start address count words,
+	// and each word in the window is a character and its attribute.
+	nColumns = tTimings.nCharacterClocks;
+	nCharHeight = tTimings.nCharHeight;
+	nRows = tTimings.nScanLines / nCharHeight;
+	cbWindowStride = tTimings.nOffset * 2 * VGA_TEXT_CELL_BYTES;
+	nStartOffset = tTimings.nStartAddress * VGA_TEXT_CELL_BYTES;
+
+	// Anything the parser would reject as a text mode
+	// falls back too, so every capture can be read back.
+	if ((0 == nRows) ||
+		(VGA_TEXT_MAX_COLUMNS < nColumns) ||
+		(VGA_TEXT_MAX_ROWS < nRows) ||
+		(VGA_FONT_GLYPH_MAX_HEIGHT < nCharHeight) ||
+		(nColumns * VGA_TEXT_CELL_BYTES > cbWindowStride) ||
+		(nStartOffset + (cbWindowStride * nRows) > cbWindow))
+	{
+		nColumns = DEFAULT_TEXT_COLUMNS;
+		nRows = DEFAULT_TEXT_ROWS;
+		nCharHeight = DEFAULT_TEXT_CHAR_HEIGHT;
+		cbWindowStride = DEFAULT_TEXT_COLUMNS * VGA_TEXT_CELL_BYTES;
+		nStartOffset = 0;
+	}
+
+	// Rows are saved without the padding between them.
+	cbRow = nColumns * VGA_TEXT_CELL_BYTES;
+
+	ptHeader->eMode = VGA_CAPTURE_MODE_TEXT;
+	ptHeader->nWidth = nColumns;
+	ptHeader->nHeight = nRows;
+	ptHeader->cbStride = cbRow;
+	ptHeader->nPlanes = 0;
+	ptHeader->nCharHeight = nCharHeight;
+
+	for (nRow = 0; nRow < nRows; ++nRow)
+	{
+		RtlMoveMemory(pnPayload + (nRow * cbRow),
+					  pnWindow + nStartOffset + (nRow * cbWindowStride),
+					  cbRow);
+	}
+
+	vgadump_DumpFont(pnPayload + (nRows * cbRow), nCharHeight);
+
+	return (nRows * cbRow) + (VGA_FONT_GLYPHS * nCharHeight);
+}
+
+/**
+ * Adds a buffer to a capture checksum.
+ *
+ * @param[in]	nChecksum	The checksum so far.
+ * @param[in]	pvData		Data to add.
+ * @param[in]	cbData		Size of the data, in bytes.
+ *
+ * @returns ULONG
+ */
+STATIC
+ULONG
+vgadump_UpdateChecksum(
+	_In_						ULONG			nChecksum,
+	_In_reads_bytes_(cbData)	CONST VOID *	pvData,
+	_In_						ULONG			cbData
+)
+{
+	CONST UCHAR *	pnData	= (CONST UCHAR *)pvData;
+	ULONG			nIndex	= 0;
+
+	ASSERT(NULL != pvData);
+
+	for (nIndex = 0; nIndex < cbData; ++nIndex)
+	{
+		nChecksum = VGA_CAPTURE_CHECKSUM_STEP(nChecksum, pnData[nIndex]);
+	}
+
+	return nChecksum;
+}
+
+/**
+ * Fills the capture buffer with the current state of the VGA.
+ */
+STATIC
+VOID
+vgadump_Capture(VOID)
+{
+	PVGA_CAPTURE_HEADER	ptHeader	= &(g_tDump.tHeader);
+	ULONG				cbPayload	= 0;
+
+	RtlZeroMemory(ptHeader, sizeof(*ptHeader));
+	ptHeader->nMagic = VGA_CAPTURE_MAGIC;
+	ptHeader->nVersion = VGA_CAPTURE_VERSION;
+	ptHeader->cbHeader = sizeof(*ptHeader);
+	ptHeader->nBitsPerPixel = VGA_PLANES;
+	ptHeader->nPaletteEntries = VGA_DAC_PALETTE_ENTRIES;
+
+	vgadump_DumpPalette(g_tDump.atPaletteEntries);
+	vgadump_DumpAttributeRegisters(ptHeader);
+
+	if (0 != (vgadump_ReadRegisterByte(GC_INDEX_REG,
+									   GC_DATA_REG,
+									   GC_MISC_INDEX) & GC_MISC_GRAPHICS))
+	{
+		cbPayload = vgadump_CaptureGraphics(ptHeader, g_tDump.anPayload);
+	}
+	else
+	{
+		cbPayload = vgadump_CaptureText(ptHeader, g_tDump.anPayload);
+	}
+
+	// The payload immediately follows the header,
+	// and the palette and the rest are contiguous,
+	// so the checksum covers them in one go.
+	C_ASSERT(FIELD_OFFSET(VGA_CAPTURE, atPaletteEntries) == sizeof(VGA_CAPTURE_HEADER));
+	C_ASSERT(FIELD_OFFSET(VGA_CAPTURE, anPayload) ==
+			 FIELD_OFFSET(VGA_CAPTURE, atPaletteEntries) + sizeof(g_tDump.atPaletteEntries));
+	ptHeader->nChecksum = vgadump_UpdateChecksum(VGA_CAPTURE_CHECKSUM_BASIS,
+												 g_tDump.atPaletteEntries,
+												 sizeof(g_tDump.atPaletteEntries) + cbPayload);
+
+	g_cbDump = FIELD_OFFSET(VGA_CAPTURE, anPayload) + cbPayload;
+}
+
 /**
  * Bugcheck callback for dumping the VGA video memory.
  *
@@ -319,7 +1049,6 @@ vgadump_BugCheckSecondaryDumpDataCallback(
 )
 {
 	PKBUGCHECK_SECONDARY_DUMP_DATA	ptSecondaryDumpData	= (PKBUGCHECK_SECONDARY_DUMP_DATA)pvReasonSpecificData;
-	ULONG							nPlane				= 0;
 
 #ifndef DBG
 	UNREFERENCED_PARAMETER(eReason);
@@ -338,33 +1067,28 @@ vgadump_BugCheckSecondaryDumpDataCallback(
 	// enable them on return from the callback.
 	g_nInterruptDisableCount = vgadump_AreInterruptsEnabled() ? 0 : 1;
 
-	if (sizeof(g_tDump) > ptSecondaryDumpData->MaximumAllowed)
-	{
-		ptSecondaryDumpData->OutBuffer = NULL;
-		ptSecondaryDumpData->OutBufferLength = 0;
-		goto lblCleanup;
-	}
-
 	ASSERT(
 		(NULL == ptSecondaryDumpData->OutBuffer) ||
 		(ptSecondaryDumpData->InBuffer == ptSecondaryDumpData->OutBuffer)
 	);
 
 	// First time around, fill the dump data.
+	// Its size depends on the video mode, so only now
+	// can we tell whether it fits.
 	if (NULL == ptSecondaryDumpData->OutBuffer)
 	{
-		vgadump_DumpPalette(g_tDump.atPaletteEntries);
+		vgadump_Capture();
+	}
 
-		for (nPlane = 0; nPlane < VGA_PLANES; ++nPlane)
-		{
-			vgadump_DumpPlane(nPlane,
-							  g_tDump.atPlanes[nPlane],
-							  sizeof(g_tDump.atPlanes[nPlane]));
-		}
+	if (g_cbDump > ptSecondaryDumpData->MaximumAllowed)
+	{
+		ptSecondaryDumpData->OutBuffer = NULL;
+		ptSecondaryDumpData->OutBufferLength = 0;
+		goto lblCleanup;
 	}
 
 	ptSecondaryDumpData->OutBuffer = &g_tDump;
-	ptSecondaryDumpData->OutBufferLength = sizeof(g_tDump);
+	ptSecondaryDumpData->OutBufferLength = g_cbDump;
 	ptSecondaryDumpData->Guid = g_tVgaDumpGuid;
 
 lblCleanup:
@@ -384,7 +1108,7 @@ VGADUMP_Initialize(VOID)
 	// to access it in protected mode.
 	pvVgaPhysicalBase.QuadPart = VGA_PHYSICAL_BASE;
 	g_pvVgaBase = MmMapIoSpace(pvVgaPhysicalBase,
-							   sizeof(VGA_PLANE_DUMP),
+							   VGA_PLANE_MAX_BYTES,
 							   MmNonCached);
 	if (NULL == g_pvVgaBase)
 	{
@@ -392,6 +1116,16 @@ VGADUMP_Initialize(VOID)
 		goto lblCleanup;
 	}
 
+	pvVgaPhysicalBase.QuadPart = VGA_TEXT_PHYSICAL_BASE;
+	g_pvTextBase = MmMapIoSpace(pvVgaPhysicalBase,
+								VGA_TEXT_WINDOW_BYTES,
+								MmNonCached);
+	if (NULL == g_pvTextBase)
+	{
+		eStatus = STATUS_INSUFFICIENT_RESOURCES;
+		goto lblCleanup;
+	}
+
 	KeInitializeCallbackRecord(&g_tCallbackRecord);
 	if (!KeRegisterBugCheckReasonCallback(&g_tCallbackRecord,
 										  &vgadump_BugCheckSecondaryDumpDataCallback,
@@ -426,9 +1160,15 @@ VGADUMP_Shutdown(VOID)
 		g_bCallbackRegistered = FALSE;
 	}
 
+	if (NULL != g_pvTextBase)
+	{
+		MmUnmapIoSpace(g_pvTextBase, VGA_TEXT_WINDOW_BYTES);
+		g_pvTextBase = NULL;
+	}
+
 	if (NULL != g_pvVgaBase)
 	{
-		MmUnmapIoSpace(g_pvVgaBase, sizeof(VGA_PLANE_DUMP));
+		MmUnmapIoSpace(g_pvVgaBase, VGA_PLANE_MAX_BYTES);
 		g_pvVgaBase = NULL;
 	}
 
@@ -20,7 +20,7 @@
  * @see DEBUG_Progress.
  */
 #define PROGRESS(pszFormat, ...) \
-	DEBUG_Progress(__FUNCTION__, (pszFormat), __VA_ARGS__)
+	DEBUG_Progress(__FUNCTION__, (pszFormat), ##__VA_ARGS__)
 
 
 /** Functions ***********************************************************/
@@ -0,0 +1,1020 @@
+/**
+ * @file DumpFile.c
+ * @author biko
+ * @date 2026-10-17
+ *
+ * DumpFile module implementation.
+ * Everything that differs between Windows and POSIX systems
+ * is in here, once for each.
+ */
+
+/** Headers *************************************************************/
+#include <Windows.h>
+#include <intsafe.h>
+#include <strsafe.h>
+
+#include <assert.h>
+
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif // !_WIN32
+
+#include "Util.h"
+#include "Debug.h"
+
+#include "DumpFile.h"
+
+
+/** Constants ***********************************************************/
+
+#ifdef _WIN32
+/**
+ * Path a file is written to before it replaces the file:
+ * the file's path, then the IDs of the writing process and thread.
+ */
+#define DUMPFILE_TEMP_FORMAT (L"%s.%lx.%lx.tmp")
+#else // !_WIN32
+/**
+ * Appended to the path of a file to get the template for the path
+ * it's written to before it replaces the file. mkstemp fills in the Xs.
+ */
+#define DUMPFILE_TEMP_SUFFIX (".XXXXXX")
+#endif // !_WIN32
+
+
+/** Typedefs ************************************************************/
+
+typedef struct _DUMPFILE_CONTEXT
+{
+#ifdef _WIN32
+	HANDLE	hFile;
+#else // !_WIN32
+	INT		nDescriptor;
+#endif // !_WIN32
+} DUMPFILE_CONTEXT, *PDUMPFILE_CONTEXT;
+typedef CONST DUMPFILE_CONTEXT *PCDUMPFILE_CONTEXT;
+
+
+/** Functions ***********************************************************/
+
+#ifdef _WIN32
+
+/**
+ * Retrieves the granularity of the addresses views can be mapped at,
+ * which is also the granularity of the file offsets they can start at.
+ *
+ * @returns DWORD
+ */
+STATIC
+DWORD
+dumpfile_GetMappingGranularity(VOID)
+{
+	SYSTEM_INFO	tSystemInfo	= { 0 };
+
+	GetSystemInfo(&tSystemInfo);
+
+	return tSystemInfo.dwAllocationGranularity;
+}
+
+HRESULT
+DUMPFILE_ResolvePath(
+	_In_opt_	PCWSTR	pwszPath,
+	_Outptr_	PWSTR *	ppwszResolvedPath
+)
+{
+	HRESULT	hrResult			= E_FAIL;
+	DWORD	eType				= REG_NONE;
+	DWORD	cbSystemDumpFile	= 0;
+	PWSTR	pwszSystemDumpFile	= NULL;
+
+	assert(NULL != ppwszResolvedPath);
+
+	if (NULL == pwszPath)
+	{
+		PROGRESS("NULL path specified. Obtaining the path to the system dump file.");
+
+		hrResult = UTIL_RegGetValue(HKEY_LOCAL_MACHINE,
+									L"SYSTEM\\CurrentControlSet\\Control\\CrashControl",
+									L"DumpFile",
+									&pwszSystemDumpFile,
+									&cbSystemDumpFile,
+									&eType);
+		if (FAILED(hrResult))
+		{
+			PROGRESS("Failed obtaining the path to the system dump file.");
+			goto lblCleanup;
+		}
+		if ((REG_SZ != eType) && (REG_EXPAND_SZ != eType))
+		{
+			PROGRESS("Failed obtaining the path to the system dump file. Incorrect data format.");
+			hrResult = HRESULT_FROM_WIN32(ERROR_INVALID_DATATYPE);
+			goto lblCleanup;
+		}
+
+		pwszPath = pwszSystemDumpFile;
+	}
+
+	hrResult = UTIL_ExpandEnvironmentStrings(pwszPath, ppwszResolvedPath);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	hrResult = S_OK;
+
+lblCleanup:
+	HEAPFREE(pwszSystemDumpFile);
+
+	return hrResult;
+}
+
+HRESULT
+DUMPFILE_Open(
+	_In_	PCWSTR		pwszPath,
+	_Out_	PHDUMPFILE	phFile
+)
+{
+	HRESULT				hrResult	= E_FAIL;
+	PDUMPFILE_CONTEXT	ptContext	= NULL;
+
+	assert(NULL != pwszPath);
+	assert(NULL != phFile);
+
+	ptContext = HEAPALLOC(sizeof(*ptContext));
+	if (NULL == ptContext)
+	{
+		PROGRESS("Oops. Ran out of memory.");
+		hrResult = E_OUTOFMEMORY;
+		goto lblCleanup;
+	}
+
+	ptContext->hFile = CreateFileW(pwszPath,
+								   GENERIC_READ,
+								   FILE_SHARE_READ,
+								   NULL,
+								   OPEN_EXISTING,
+								   FILE_ATTRIBUTE_NORMAL,
+								   NULL);
+	if (INVALID_HANDLE_VALUE == ptContext->hFile)
+	{
+		hrResult = HRESULT_FROM_WIN32(GetLastError());
+		goto lblCleanup;
+	}
+
+	// Transfer ownership:
+	*phFile = (HDUMPFILE)ptContext;
+	ptContext = NULL;
+
+	hrResult = S_OK;
+
+lblCleanup:
+	HEAPFREE(ptContext);
+
+	return hrResult;
+}
+
+VOID
+DUMPFILE_Close(
+	_In_	HDUMPFILE	hFile
+)
+{
+	PDUMPFILE_CONTEXT	ptContext	= (PDUMPFILE_CONTEXT)hFile;
+
+	if (NULL == hFile)
+	{
+		goto lblCleanup;
+	}
+
+	CLOSE_FILE_HANDLE(ptContext->hFile);
+	HEAPFREE(ptContext);
+
+lblCleanup:
+	return;
+}
+
+HRESULT
+DUMPFILE_GetSize(
+	_In_	HDUMPFILE	hFile,
+	_Out_	PULONGLONG	pcbFile
+)
+{
+	HRESULT				hrResult	= E_FAIL;
+	PCDUMPFILE_CONTEXT	ptContext	= (PCDUMPFILE_CONTEXT)hFile;
+	LARGE_INTEGER		tFileSize	= { 0 };
+
+	assert(NULL != hFile);
+	assert(NULL != pcbFile);
+
+	if (!GetFileSizeEx(ptContext->hFile, &tFileSize))
+	{
+		hrResult = HRESULT_FROM_WIN32(GetLastError());
+		goto lblCleanup;
+	}
+	*pcbFile = (ULONGLONG)tFileSize.QuadPart;
+
+	hrResult = S_OK;
+
+lblCleanup:
+	return hrResult;
+}
+
+HRESULT
+DUMPFILE_GetLastWriteTime(
+	_In_	HDUMPFILE	hFile,
+	_Out_	PULONGLONG	pnLastWriteTime
+)
+{
+	HRESULT				hrResult		= E_FAIL;
+	PCDUMPFILE_CONTEXT	ptContext		= (PCDUMPFILE_CONTEXT)hFile;
+	FILETIME			tLastWriteTime	= { 0 };
+
+	assert(NULL != hFile);
+	assert(NULL != pnLastWriteTime);
+
+	if (!GetFileTime(ptContext->hFile, NULL, NULL, &tLastWriteTime))
+	{
+		hrResult = HRESULT_FROM_WIN32(GetLastError());
+		goto lblCleanup;
+	}
+	*pnLastWriteTime = ((ULONGLONG)tLastWriteTime.dwHighDateTime << 32) | tLastWriteTime.dwLowDateTime;
+
+	hrResult = S_OK;
+
+lblCleanup:
+	return hrResult;
+}
+
+HRESULT
+DUMPFILE_ReadAt(
+	_In_							HDUMPFILE	hFile,
+	_In_							ULONGLONG	nOffset,
+	_Out_writes_bytes_(cbBuffer)	PVOID		pvBuffer,
+	_In_							DWORD		cbBuffer,
+	_Out_							PDWORD		pcbRead
+)
+{
+	HRESULT				hrResult	= E_FAIL;
+	PCDUMPFILE_CONTEXT	ptContext	= (PCDUMPFILE_CONTEXT)hFile;
+	OVERLAPPED			tOverlapped	= { 0 };
+
+	assert(NULL != hFile);
+	assert(NULL != pvBuffer);
+	assert(NULL != pcbRead);
+
+	// The offset goes with the read rather than through the file pointer.
+	tOverlapped.Offset = (DWORD)nOffset;
+	tOverlapped.OffsetHigh = (DWORD)(nOffset >> 32);
+
+	*pcbRead = 0;
+	if (!ReadFile(ptContext->hFile,
+				  pvBuffer,
+				  cbBuffer,
+				  pcbRead,
+				  &tOverlapped))
+	{
+		// Reading at or past the end of the file fails instead of reading nothing.
+		if (ERROR_HANDLE_EOF != GetLastError())
+		{
+			hrResult = HRESULT_FROM_WIN32(GetLastError());
+			goto lblCleanup;
+		}
+		*pcbRead = 0;
+	}
+
+	hrResult = S_OK;
+
+lblCleanup:
+	return hrResult;
+}
+
+HRESULT
+DUMPFILE_Map(
+	_In_									HDUMPFILE	hFile,
+	_In_									ULONGLONG	nOffset,
+	_In_									DWORD		cbLength,
+	_Outptr_result_bytebuffer_(cbLength)	LPCVOID *	ppvView,
+	_Out_									PSIZE_T		pcbMapped
+)
+{
+	HRESULT				hrResult		= E_FAIL;
+	PCDUMPFILE_CONTEXT	ptContext		= (PCDUMPFILE_CONTEXT)hFile;
+	DWORD				nGranularity	= 0;
+	ULONGLONG			nViewOffset		= 0;
+	SIZE_T				cbView			= 0;
+	HANDLE				hMapping		= NULL;
+	PBYTE				pnView			= NULL;
+
+	assert(NULL != hFile);
+	assert(0 != cbLength);
+	assert(NULL != ppvView);
+	assert(NULL != pcbMapped);
+
+	// Views start on the allocation granularity,
+	// so the part is somewhere in the first stretch of the view.
+	nGranularity = dumpfile_GetMappingGranularity();
+	nViewOffset = nOffset - (nOffset % nGranularity);
+	hrResult = ULongLongToSizeT(nOffset - nViewOffset + cbLength, &cbView);
+	if (FAILED(hrResult))
+	{
+		PROGRESS("The part is too big to map.");
+		goto lblCleanup;
+	}
+
+	hMapping = CreateFileMappingW(ptContext->hFile,
+								  NULL,
+								  PAGE_READONLY,
+								  0,
+								  0,
+								  NULL);
+	if (NULL == hMapping)
+	{
+		hrResult = HRESULT_FROM_WIN32(GetLastError());
+		goto lblCleanup;
+	}
+
+	// The view keeps the mapping alive once its handle is closed.
+	pnView = MapViewOfFile(hMapping,
+						   FILE_MAP_READ,
+						   (DWORD)(nViewOffset >> 32),
+						   (DWORD)nViewOffset,
+						   cbView);
+	if (NULL == pnView)
+	{
+		hrResult = HRESULT_FROM_WIN32(GetLastError());
+		goto lblCleanup;
+	}
+
+	*ppvView = pnView + (nOffset - nViewOffset);
+	*pcbMapped = cbView;
+
+	hrResult = S_OK;
+
+lblCleanup:
+	CLOSE_HANDLE(hMapping);
+
+	return hrResult;
+}
+
+VOID
+DUMPFILE_Unmap(
+	_In_	LPCVOID	pvView,
+	_In_	DWORD	cbLength
+)
+{
+	ULONG_PTR	nGranularity	= 0;
+
+	// The whole view goes, whatever its size.
+	UNREFERENCED_PARAMETER(cbLength);
+
+	if (NULL == pvView)
+	{
+		goto lblCleanup;
+	}
+
+	// The view starts on the allocation granularity,
+	// less than a granule before the part.
+	nGranularity = dumpfile_GetMappingGranularity();
+	(VOID)UnmapViewOfFile((LPCVOID)((ULONG_PTR)pvView & ~(nGranularity - 1)));
+
+lblCleanup:
+	return;
+}
+
+HRESULT
+DUMPFILE_ReadAll(
+	_In_									PCWSTR	pwszPath,
+	_Outptr_result_bytebuffer_(*pcbData)	PVOID *	ppvData,
+	_Out_									PDWORD	pcbData
+)
+{
+	assert(NULL != pwszPath);
+	assert(NULL != ppvData);
+	assert(NULL != pcbData);
+
+	return UTIL_ReadFile(pwszPath, ppvData, pcbData);
+}
+
+HRESULT
+DUMPFILE_Replace(
+	_In_						PCWSTR	pwszPath,
+	_In_reads_bytes_(cbData)	LPCVOID	pvData,
+	_In_						DWORD	cbData
+)
+{
+	HRESULT	hrResult		= E_FAIL;
+	SIZE_T	cchTempPath		= 0;
+	PWSTR	pwszTempPath	= NULL;
+	BOOL	bDeleteFile		= FALSE;
+
+	assert(NULL != pwszPath);
+	assert(NULL != pvData);
+
+	cchTempPath = wcslen(pwszPath) + ARRAYSIZE(L".ffffffff.ffffffff.tmp");
+	pwszTempPath = HEAPALLOC(cchTempPath * sizeof(pwszTempPath[0]));
+	if (NULL == pwszTempPath)
+	{
+		PROGRESS("Oops. Ran out of memory.");
+		hrResult = E_OUTOFMEMORY;
+		goto lblCleanup;
+	}
+
+	hrResult = StringCchPrintfW(pwszTempPath,
+								cchTempPath,
+								DUMPFILE_TEMP_FORMAT,
+								pwszPath,
+								GetCurrentProcessId(),
+								GetCurrentThreadId());
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	bDeleteFile = TRUE;
+	hrResult = UTIL_WriteFile(pwszTempPath, pvData, cbData);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	if (!MoveFileExW(pwszTempPath, pwszPath, MOVEFILE_REPLACE_EXISTING))
+	{
+		hrResult = HRESULT_FROM_WIN32(GetLastError());
+		goto lblCleanup;
+	}
+	bDeleteFile = FALSE;
+
+	hrResult = S_OK;
+
+lblCleanup:
+	if (bDeleteFile)
+	{
+		(VOID)DeleteFileW(pwszTempPath);
+		bDeleteFile = FALSE;
+	}
+	HEAPFREE(pwszTempPath);
+
+	return hrResult;
+}
+
+#else // !_WIN32
+
+/**
+ * Converts the error of a failed call to an HRESULT.
+ *
+ * @param[in]	nError	The error (an errno value).
+ *
+ * @returns HRESULT
+ */
+STATIC
+HRESULT
+dumpfile_HresultFromErrno(
+	_In_	INT	nError
+)
+{
+	HRESULT	hrResult	= E_FAIL;
+
+	switch (nError)
+	{
+	case ENOENT:
+	case ENOTDIR:
+		hrResult = HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND);
+		break;
+
+	case EACCES:
+	case EPERM:
+	case EROFS:
+		hrResult = HRESULT_FROM_WIN32(ERROR_ACCESS_DENIED);
+		break;
+
+	case ENOMEM:
+		hrResult = E_OUTOFMEMORY;
+		break;
+
+	case EINVAL:
+		hrResult = E_INVALIDARG;
+		break;
+
+	default:
+		hrResult = E_FAIL;
+		break;
+	}
+
+	return hrResult;
+}
+
+/**
+ * Converts a path to the multibyte encoding of the current locale,
+ * which is what the system calls take.
+ *
+ * @param[in]	pwszPath	The path.
+ * @param[in]	pszSuffix	Appended to the converted path.
+ * @param[out]	ppszPath	Will receive the converted path.
+ *
+ * @returns HRESULT
+ *
+ * @remark Free the returned path to the process heap.
+ */
+STATIC
+HRESULT
+dumpfile_GetNativePath(
+	_In_		PCWSTR	pwszPath,
+	_In_		PCSTR	pszSuffix,
+	_Outptr_	PSTR *	ppszPath
+)
+{
+	HRESULT	hrResult	= E_FAIL;
+	SIZE_T	cbPath		= 0;
+	SIZE_T	cbSuffix	= 0;
+	PSTR	pszPath		= NULL;
+
+	assert(NULL != pwszPath);
+	assert(NULL != pszSuffix);
+	assert(NULL != ppszPath);
+
+	cbPath = wcstombs(NULL, pwszPath, 0);
+	if ((SIZE_T)-1 == cbPath)
+	{
+		PROGRESS("The path can't be converted to the current locale.");
+		hrResult = HRESULT_FROM_WIN32(ERROR_NO_UNICODE_TRANSLATION);
+		goto lblCleanup;
+	}
+	cbSuffix = strlen(pszSuffix);
+
+	pszPath = HEAPALLOC(cbPath + cbSuffix + 1);
+	if (NULL == pszPath)
+	{
+		PROGRESS("Oops. Ran out of memory.");
+		hrResult = E_OUTOFMEMORY;
+		goto lblCleanup;
+	}
+
+	(VOID)wcstombs(pszPath, pwszPath, cbPath + 1);
+	CopyMemory(pszPath + cbPath, pszSuffix, cbSuffix + 1);
+
+	// Transfer ownership:
+	*ppszPath = pszPath;
+	pszPath = NULL;
+
+	hrResult = S_OK;
+
+lblCleanup:
+	HEAPFREE(pszPath);
+
+	return hrResult;
+}
+
+/**
+ * Retrieves the granularity of the file offsets views can start at.
+ *
+ * @returns SIZE_T
+ */
+STATIC
+SIZE_T
+dumpfile_GetMappingGranularity(VOID)
+{
+	return (SIZE_T)sysconf(_SC_PAGESIZE);
+}
+
+HRESULT
+DUMPFILE_ResolvePath(
+	_In_opt_	PCWSTR	pwszPath,
+	_Outptr_	PWSTR *	ppwszResolvedPath
+)
+{
+	HRESULT	hrResult			= E_FAIL;
+	SIZE_T	cbResolvedPath		= 0;
+	PWSTR	pwszResolvedPath	= NULL;
+
+	assert(NULL != ppwszResolvedPath);
+
+	if (NULL == pwszPath)
+	{
+		PROGRESS("Only Windows has a system dump file. Specify the dump file to open.");
+		hrResult = HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND);
+		goto lblCleanup;
+	}
+
+	// The shell already expanded the environment variables.
+	cbResolvedPath = (wcslen(pwszPath) + 1) * sizeof(pwszPath[0]);
+	pwszResolvedPath = HEAPALLOC(cbResolvedPath);
+	if (NULL == pwszResolvedPath)
+	{
+		PROGRESS("Oops. Ran out of memory.");
+		hrResult = E_OUTOFMEMORY;
+		goto lblCleanup;
+	}
+	CopyMemory(pwszResolvedPath, pwszPath, cbResolvedPath);
+
+	// Transfer ownership:
+	*ppwszResolvedPath = pwszResolvedPath;
+	pwszResolvedPath = NULL;
+
+	hrResult = S_OK;
+
+lblCleanup:
+	HEAPFREE(pwszResolvedPath);
+
+	return hrResult;
+}
+
+HRESULT
+DUMPFILE_Open(
+	_In_	PCWSTR		pwszPath,
+	_Out_	PHDUMPFILE	phFile
+)
+{
+	HRESULT				hrResult	= E_FAIL;
+	PSTR				pszPath		= NULL;
+	PDUMPFILE_CONTEXT	ptContext	= NULL;
+
+	assert(NULL != pwszPath);
+	assert(NULL != phFile);
+
+	hrResult = dumpfile_GetNativePath(pwszPath, "", &pszPath);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	ptContext = HEAPALLOC(sizeof(*ptContext));
+	if (NULL == ptContext)
+	{
+		PROGRESS("Oops. Ran out of memory.");
+		hrResult = E_OUTOFMEMORY;
+		goto lblCleanup;
+	}
+
+	ptContext->nDescriptor = open(pszPath, O_RDONLY | O_CLOEXEC);
+	if (-1 == ptContext->nDescriptor)
+	{
+		hrResult = dumpfile_HresultFromErrno(errno);
+		goto lblCleanup;
+	}
+
+	// Transfer ownership:
+	*phFile = (HDUMPFILE)ptContext;
+	ptContext = NULL;
+
+	hrResult = S_OK;
+
+lblCleanup:
+	HEAPFREE(ptContext);
+	HEAPFREE(pszPath);
+
+	return hrResult;
+}
+
+VOID
+DUMPFILE_Close(
+	_In_	HDUMPFILE	hFile
+)
+{
+	PDUMPFILE_CONTEXT	ptContext	= (PDUMPFILE_CONTEXT)hFile;
+
+	if (NULL == hFile)
+	{
+		goto lblCleanup;
+	}
+
+	CLOSE_TO_VALUE(ptContext->nDescriptor, close, -1);
+	HEAPFREE(ptContext);
+
+lblCleanup:
+	return;
+}
+
+HRESULT
+DUMPFILE_GetSize(
+	_In_	HDUMPFILE	hFile,
+	_Out_	PULONGLONG	pcbFile
+)
+{
+	HRESULT				hrResult	= E_FAIL;
+	PCDUMPFILE_CONTEXT	ptContext	= (PCDUMPFILE_CONTEXT)hFile;
+	struct stat			tStat		= { 0 };
+
+	assert(NULL != hFile);
+	assert(NULL != pcbFile);
+
+	if (0 != fstat(ptContext->nDescriptor, &tStat))
+	{
+		hrResult = dumpfile_HresultFromErrno(errno);
+		goto lblCleanup;
+	}
+	*pcbFile = (ULONGLONG)tStat.st_size;
+
+	hrResult = S_OK;
+
+lblCleanup:
+	return hrResult;
+}
+
+HRESULT
+DUMPFILE_GetLastWriteTime(
+	_In_	HDUMPFILE	hFile,
+	_Out_	PULONGLONG	pnLastWriteTime
+)
+{
+	HRESULT				hrResult	= E_FAIL;
+	PCDUMPFILE_CONTEXT	ptContext	= (PCDUMPFILE_CONTEXT)hFile;
+	struct stat			tStat		= { 0 };
+
+	assert(NULL != hFile);
+	assert(NULL != pnLastWriteTime);
+
+	if (0 != fstat(ptContext->nDescriptor, &tStat))
+	{
+		hrResult = dumpfile_HresultFromErrno(errno);
+		goto lblCleanup;
+	}
+
+	// In nanoseconds.
+	*pnLastWriteTime = ((ULONGLONG)tStat.st_mtim.tv_sec * 1000000000) + (ULONGLONG)tStat.st_mtim.tv_nsec;
+
+	hrResult = S_OK;
+
+lblCleanup:
+	return hrResult;
+}
+
+HRESULT
+DUMPFILE_ReadAt(
+	_In_							HDUMPFILE	hFile,
+	_In_							ULONGLONG	nOffset,
+	_Out_writes_bytes_(cbBuffer)	PVOID		pvBuffer,
+	_In_							DWORD		cbBuffer,
+	_Out_							PDWORD		pcbRead
+)
+{
+	HRESULT				hrResult	= E_FAIL;
+	PCDUMPFILE_CONTEXT	ptContext	= (PCDUMPFILE_CONTEXT)hFile;
+	ssize_t				cbRead		= 0;
+
+	assert(NULL != hFile);
+	assert(NULL != pvBuffer);
+	assert(NULL != pcbRead);
+
+	*pcbRead = 0;
+
+	// Offsets past what off_t holds are past the end of any file.
+	if ((ULONGLONG)INT64_MAX < nOffset)
+	{
+		hrResult = S_OK;
+		goto lblCleanup;
+	}
+
+	do
+	{
+		cbRead = pread(ptContext->nDescriptor, pvBuffer, cbBuffer, (off_t)nOffset);
+	} while ((-1 == cbRead) && (EINTR == errno));
+	if (-1 == cbRead)
+	{
+		hrResult = dumpfile_HresultFromErrno(errno);
+		goto lblCleanup;
+	}
+	*pcbRead = (DWORD)cbRead;
+
+	hrResult = S_OK;
+
+lblCleanup:
+	return hrResult;
+}
+
+HRESULT
+DUMPFILE_Map(
+	_In_									HDUMPFILE	hFile,
+	_In_									ULONGLONG	nOffset,
+	_In_									DWORD		cbLength,
+	_Outptr_result_bytebuffer_(cbLength)	LPCVOID *	ppvView,
+	_Out_									PSIZE_T		pcbMapped
+)
+{
+	HRESULT				hrResult		= E_FAIL;
+	PCDUMPFILE_CONTEXT	ptContext		= (PCDUMPFILE_CONTEXT)hFile;
+	SIZE_T				nGranularity	= 0;
+	ULONGLONG			nViewOffset		= 0;
+	SIZE_T				cbView			= 0;
+	PBYTE				pnView			= NULL;
+
+	assert(NULL != hFile);
+	assert(0 != cbLength);
+	assert(NULL != ppvView);
+	assert(NULL != pcbMapped);
+
+	// Views start on a page, so the part is
+	// somewhere in the first page of the view.
+	nGranularity = dumpfile_GetMappingGranularity();
+	nViewOffset = nOffset - (nOffset % nGranularity);
+	if ((ULONGLONG)INT64_MAX < nViewOffset)
+	{
+		PROGRESS("The part is too far into the file to map.");
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+	hrResult = ULongLongToSizeT(nOffset - nViewOffset + cbLength, &cbView);
+	if (FAILED(hrResult))
+	{
+		PROGRESS("The part is too big to map.");
+		goto lblCleanup;
+	}
+
+	// The view keeps the file alive once its descriptor is closed.
+	pnView = mmap(NULL, cbView, PROT_READ, MAP_SHARED, ptContext->nDescriptor, (off_t)nViewOffset);
+	if (MAP_FAILED == pnView)
+	{
+		hrResult = dumpfile_HresultFromErrno(errno);
+		goto lblCleanup;
+	}
+
+	*ppvView = pnView + (nOffset - nViewOffset);
+	*pcbMapped = cbView;
+
+	hrResult = S_OK;
+
+lblCleanup:
+	return hrResult;
+}
+
+VOID
+DUMPFILE_Unmap(
+	_In_	LPCVOID	pvView,
+	_In_	DWORD	cbLength
+)
+{
+	ULONG_PTR	nGranularity	= 0;
+	ULONG_PTR	nView			= 0;
+
+	if (NULL == pvView)
+	{
+		goto lblCleanup;
+	}
+
+	// The view starts on a page, less than a page before the part,
+	// and has to be unmapped with its size.
+	nGranularity = dumpfile_GetMappingGranularity();
+	nView = (ULONG_PTR)pvView & ~(nGranularity - 1);
+	(VOID)munmap((PVOID)nView, ((ULONG_PTR)pvView - nView) + cbLength);
+
+lblCleanup:
+	return;
+}
+
+HRESULT
+DUMPFILE_ReadAll(
+	_In_									PCWSTR	pwszPath,
+	_Outptr_result_bytebuffer_(*pcbData)	PVOID *	ppvData,
+	_Out_									PDWORD	pcbData
+)
+{
+	HRESULT		hrResult	= E_FAIL;
+	HDUMPFILE	hFile		= NULL;
+	ULONGLONG	cbFile		= 0;
+	PVOID		pvData		= NULL;
+	DWORD		cbRead		= 0;
+
+	assert(NULL != pwszPath);
+	assert(NULL != ppvData);
+	assert(NULL != pcbData);
+
+	hrResult = DUMPFILE_Open(pwszPath, &hFile);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	hrResult = DUMPFILE_GetSize(hFile, &cbFile);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+	if (MAXDWORD <= cbFile)
+	{
+		PROGRESS("The file is too big to read.");
+		hrResult = HRESULT_FROM_WIN32(ERROR_FILE_TOO_LARGE);
+		goto lblCleanup;
+	}
+
+	// Like HeapAlloc, allocating nothing still returns something.
+	pvData = HEAPALLOC(max((DWORD)cbFile, 1));
+	if (NULL == pvData)
+	{
+		PROGRESS("Oops. Ran out of memory.");
+		hrResult = E_OUTOFMEMORY;
+		goto lblCleanup;
+	}
+
+	hrResult = DUMPFILE_ReadAt(hFile, 0, pvData, (DWORD)cbFile, &cbRead);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+	if (cbFile != cbRead)
+	{
+		hrResult = HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
+		goto lblCleanup;
+	}
+
+	// Transfer ownership:
+	*ppvData = pvData;
+	pvData = NULL;
+	*pcbData = cbRead;
+
+	hrResult = S_OK;
+
+lblCleanup:
+	HEAPFREE(pvData);
+	CLOSE(hFile, DUMPFILE_Close);
+
+	return hrResult;
+}
+
+HRESULT
+DUMPFILE_Replace(
+	_In_						PCWSTR	pwszPath,
+	_In_reads_bytes_(cbData)	LPCVOID	pvData,
+	_In_						DWORD	cbData
+)
+{
+	HRESULT	hrResult	= E_FAIL;
+	PSTR	pszPath		= NULL;
+	PSTR	pszTempPath	= NULL;
+	INT		nDescriptor	= -1;
+	BOOL	bDeleteFile	= FALSE;
+	SIZE_T	cbWritten	= 0;
+	ssize_t	cbWrite		= 0;
+
+	assert(NULL != pwszPath);
+	assert(NULL != pvData);
+
+	hrResult = dumpfile_GetNativePath(pwszPath, "", &pszPath);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	hrResult = dumpfile_GetNativePath(pwszPath, DUMPFILE_TEMP_SUFFIX, &pszTempPath);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	nDescriptor = mkstemp(pszTempPath);
+	if (-1 == nDescriptor)
+	{
+		hrResult = dumpfile_HresultFromErrno(errno);
+		goto lblCleanup;
+	}
+	bDeleteFile = TRUE;
+
+	while (cbWritten < cbData)
+	{
+		cbWrite = write(nDescriptor, (CONST BYTE *)pvData + cbWritten, cbData - cbWritten);
+		if ((-1 == cbWrite) && (EINTR == errno))
+		{
+			continue;
+		}
+		if (-1 == cbWrite)
+		{
+			hrResult = dumpfile_HresultFromErrno(errno);
+			goto lblCleanup;
+		}
+		cbWritten += (SIZE_T)cbWrite;
+	}
+
+	if (0 != close(nDescriptor))
+	{
+		nDescriptor = -1;
+		hrResult = dumpfile_HresultFromErrno(errno);
+		goto lblCleanup;
+	}
+	nDescriptor = -1;
+
+	if (0 != rename(pszTempPath, pszPath))
+	{
+		hrResult = dumpfile_HresultFromErrno(errno);
+		goto lblCleanup;
+	}
+	bDeleteFile = FALSE;
+
+	hrResult = S_OK;
+
+lblCleanup:
+	CLOSE_TO_VALUE(nDescriptor, close, -1);
+	if (bDeleteFile)
+	{
+		(VOID)unlink(pszTempPath);
+		bDeleteFile = FALSE;
+	}
+	HEAPFREE(pszTempPath);
+	HEAPFREE(pszPath);
+
+	return hrResult;
+}
+
+#endif // !_WIN32
@@ -0,0 +1,196 @@
+/**
+ * @file DumpFile.h
+ * @author biko
+ * @date 2026-10-17
+ *
+ * DumpFile module public header.
+ * Contains the file access the native dump reader needs,
+ * implemented with Win32 on Windows and with POSIX elsewhere,
+ * so the reader itself runs on both.
+ */
+#pragma once
+
+/** Headers *************************************************************/
+#include <Windows.h>
+
+
+/** Typedefs ************************************************************/
+
+/**
+ * Handle to a file opened for reading.
+ */
+DECLARE_HANDLE(HDUMPFILE);
+typedef HDUMPFILE *PHDUMPFILE;
+
+
+/** Functions ***********************************************************/
+
+/**
+ * Resolves the path of a dump file.
+ *
+ * @param[in]	pwszPath			Path to the dump file.
+ *									If not specified, the path of the
+ *									system crash dump is used, which only
+ *									Windows has.
+ * @param[out]	ppwszResolvedPath	Will receive the path,
+ *									with environment variables expanded.
+ *
+ * @returns HRESULT
+ *
+ * @remark Free the returned path to the process heap.
+ */
+HRESULT
+DUMPFILE_ResolvePath(
+	_In_opt_	PCWSTR	pwszPath,
+	_Outptr_	PWSTR *	ppwszResolvedPath
+);
+
+/**
+ * Opens a file for reading.
+ *
+ * @param[in]	pwszPath	Path of the file.
+ * @param[out]	phFile		Will receive a handle to the file.
+ *
+ * @returns HRESULT
+ */
+HRESULT
+DUMPFILE_Open(
+	_In_	PCWSTR		pwszPath,
+	_Out_	PHDUMPFILE	phFile
+);
+
+/**
+ * Closes a file.
+ *
+ * @param[in]	hFile	File to close.
+ */
+VOID
+DUMPFILE_Close(
+	_In_	HDUMPFILE	hFile
+);
+
+/**
+ * Retrieves the size of a file.
+ *
+ * @param[in]	hFile	The file.
+ * @param[out]	pcbFile	Will receive the size, in bytes.
+ *
+ * @returns HRESULT
+ */
+HRESULT
+DUMPFILE_GetSize(
+	_In_	HDUMPFILE	hFile,
+	_Out_	PULONGLONG	pcbFile
+);
+
+/**
+ * Retrieves when a file was last written.
+ *
+ * @param[in]	hFile			The file.
+ * @param[out]	pnLastWriteTime	Will receive the time, in units
+ *								that only mean something when compared
+ *								with other times from the same system.
+ *
+ * @returns HRESULT
+ */
+HRESULT
+DUMPFILE_GetLastWriteTime(
+	_In_	HDUMPFILE	hFile,
+	_Out_	PULONGLONG	pnLastWriteTime
+);
+
+/**
+ * Reads part of a file, at most once.
+ * The offset goes with the read, so reads never
+ * depend on where another one left off.
+ *
+ * @param[in]	hFile		The file.
+ * @param[in]	nOffset		Where to start reading.
+ * @param[out]	pvBuffer	Will receive the data.
+ * @param[in]	cbBuffer	How much to read, in bytes.
+ * @param[out]	pcbRead		Will receive how much was read, in bytes.
+ *							Less than asked for only at the end of the file.
+ *
+ * @returns HRESULT
+ */
+HRESULT
+DUMPFILE_ReadAt(
+	_In_							HDUMPFILE	hFile,
+	_In_							ULONGLONG	nOffset,
+	_Out_writes_bytes_(cbBuffer)	PVOID		pvBuffer,
+	_In_							DWORD		cbBuffer,
+	_Out_							PDWORD		pcbRead
+);
+
+/**
+ * Maps part of a file, read-only.
+ *
+ * @param[in]	hFile		The file.
+ * @param[in]	nOffset		Where the part starts. Needn't be aligned.
+ * @param[in]	cbLength	Size of the part, in bytes. Mustn't be 0.
+ * @param[out]	ppvView		Will receive a view of the part.
+ * @param[out]	pcbMapped	Will receive how much was mapped, in bytes,
+ *							which includes what's before the part
+ *							on the first page of the view.
+ *
+ * @returns HRESULT
+ *
+ * @remark	The view stays valid after the file is closed.
+ *			Unmap it with DUMPFILE_Unmap.
+ */
+HRESULT
+DUMPFILE_Map(
+	_In_									HDUMPFILE	hFile,
+	_In_									ULONGLONG	nOffset,
+	_In_									DWORD		cbLength,
+	_Outptr_result_bytebuffer_(cbLength)	LPCVOID *	ppvView,
+	_Out_									PSIZE_T		pcbMapped
+);
+
+/**
+ * Unmaps a view mapped by DUMPFILE_Map.
+ *
+ * @param[in]	pvView		The view.
+ * @param[in]	cbLength	The size it was mapped with, in bytes.
+ */
+VOID
+DUMPFILE_Unmap(
+	_In_	LPCVOID	pvView,
+	_In_	DWORD	cbLength
+);
+
+/**
+ * Reads an entire file into memory.
+ *
+ * @param[in]	pwszPath	Path of the file to read.
+ * @param[out]	ppvData		Will receive the file's contents.
+ * @param[out]	pcbData		Will receive the size of the file.
+ *
+ * @returns HRESULT
+ *
+ * @remark Free the returned data to the process heap.
+ */
+HRESULT
+DUMPFILE_ReadAll(
+	_In_									PCWSTR	pwszPath,
+	_Outptr_result_bytebuffer_(*pcbData)	PVOID *	ppvData,
+	_Out_									PDWORD	pcbData
+);
+
+/**
+ * Writes a file in a single step: the data goes to a file of its own,
+ * which replaces the file once it's whole. Readers see the old file
+ * or the new one, never a part of it, however many write at once.
+ *
+ * @param[in]	pwszPath	Path of the file to write.
+ * @param[in]	pvData		The data to write.
+ * @param[in]	cbData		Size of the data, in bytes.
+ *
+ * @returns HRESULT
+ */
+HRESULT
+DUMPFILE_Replace(
+	_In_						PCWSTR	pwszPath,
+	_In_reads_bytes_(cbData)	LPCVOID	pvData,
+	_In_						DWORD	cbData
+);
@@ -0,0 +1,196 @@
+/**
+ * @file DumpFormat.h
+ * @author biko
+ * @date 2026-10-17
+ *
+ * Layout of the parts of kernel memory dump files that DumpParse reads:
+ * the header, the summary that follows it in kernel and bitmap dumps,
+ * and the secondary data that bugcheck callbacks append after the pages.
+ */
+#pragma once
+
+/** Headers *************************************************************/
+#include <Windows.h>
+
+
+/** Constants ***********************************************************/
+
+/**
+ * Signatures at the start of the header, as little-endian DWORDs.
+ */
+#define KERNEL_DUMP_SIGNATURE (0x45474150)		// "PAGE"
+#define KERNEL_DUMP_VALID_DUMP32 (0x504D5544)	// "DUMP"
+#define KERNEL_DUMP_VALID_DUMP64 (0x34365544)	// "DU64"
+
+/**
+ * Signatures of the summary of kernel and bitmap dumps.
+ */
+#define KERNEL_DUMP_SUMMARY_SIGNATURE (0x504D4453)	// "SDMP"
+#define KERNEL_DUMP_BITMAP_SIGNATURE (0x504D4446)	// "FDMP"
+#define KERNEL_DUMP_SUMMARY_VALID_DUMP (0x504D5544)	// "DUMP"
+
+/**
+ * Signatures of the header of the secondary data.
+ */
+#define KERNEL_DUMP_BLOB_SIGNATURE1 (0x706D7544)	// "Dump"
+#define KERNEL_DUMP_BLOB_SIGNATURE2 (0x626F6C42)	// "Blob"
+
+/**
+ * Sizes of the headers, which the summary or the pages follow.
+ */
+#define KERNEL_DUMP_HEADER32_SIZE (0x1000)
+#define KERNEL_DUMP_HEADER64_SIZE (0x2000)
+
+/**
+ * Size of the pages of memory in the dump.
+ */
+#define KERNEL_DUMP_PAGE_SIZE (0x1000)
+
+
+/** Enums ***************************************************************/
+
+/**
+ * The kinds of dumps, as stored in the header.
+ */
+typedef enum _KERNEL_DUMP_TYPE
+{
+	// Every page of physical memory, in the runs
+	// the header describes.
+	KERNEL_DUMP_TYPE_FULL = 1,
+
+	// The kernel's pages, picked by the summary's bitmap.
+	KERNEL_DUMP_TYPE_SUMMARY = 2,
+
+	KERNEL_DUMP_TYPE_HEADER = 3,
+	KERNEL_DUMP_TYPE_TRIAGE = 4,
+
+	// Pages picked by the summary's bitmap,
+	// as written since Windows 8.
+	KERNEL_DUMP_TYPE_BITMAP_FULL = 5,
+	KERNEL_DUMP_TYPE_BITMAP_KERNEL = 6,
+
+	KERNEL_DUMP_TYPE_AUTOMATIC = 7
+} KERNEL_DUMP_TYPE, *PKERNEL_DUMP_TYPE;
+
+
+/** Typedefs ************************************************************/
+
+/**
+ * Header of 32-bit dumps. Only the fields read are named.
+ */
+typedef struct _KERNEL_DUMP_HEADER32
+{
+	DWORD	nSignature;
+	DWORD	nValidDump;
+	BYTE	acbReserved1[0x64 - 0x8];
+
+	// The physical memory descriptor.
+	DWORD	nMemoryRuns;
+	DWORD	nMemoryPages;
+	BYTE	acbReserved2[0xF88 - 0x6C];
+
+	DWORD	eDumpType;
+	BYTE	acbReserved3[KERNEL_DUMP_HEADER32_SIZE - 0xF8C];
+} KERNEL_DUMP_HEADER32, *PKERNEL_DUMP_HEADER32;
+typedef CONST KERNEL_DUMP_HEADER32 *PCKERNEL_DUMP_HEADER32;
+C_ASSERT(0x64 == FIELD_OFFSET(KERNEL_DUMP_HEADER32, nMemoryRuns));
+C_ASSERT(0xF88 == FIELD_OFFSET(KERNEL_DUMP_HEADER32, eDumpType));
+C_ASSERT(KERNEL_DUMP_HEADER32_SIZE == sizeof(KERNEL_DUMP_HEADER32));
+
+/**
+ * Header of 64-bit dumps. Only the fields read are named.
+ */
+typedef struct _KERNEL_DUMP_HEADER64
+{
+	DWORD		nSignature;
+	DWORD		nValidDump;
+	BYTE		acbReserved1[0x88 - 0x8];
+
+	// The physical memory descriptor.
+	DWORD		nMemoryRuns;
+	DWORD		nPadding;
+	ULONGLONG	nMemoryPages;
+	BYTE		acbReserved2[0xF98 - 0x98];
+
+	DWORD		eDumpType;
+	BYTE		acbReserved3[KERNEL_DUMP_HEADER64_SIZE - 0xF9C];
+} KERNEL_DUMP_HEADER64, *PKERNEL_DUMP_HEADER64;
+typedef CONST KERNEL_DUMP_HEADER64 *PCKERNEL_DUMP_HEADER64;
+C_ASSERT(0x88 == FIELD_OFFSET(KERNEL_DUMP_HEADER64, nMemoryRuns));
+C_ASSERT(0x90 == FIELD_OFFSET(KERNEL_DUMP_HEADER64, nMemoryPages));
+C_ASSERT(0xF98 == FIELD_OFFSET(KERNEL_DUMP_HEADER64, eDumpType));
+C_ASSERT(KERNEL_DUMP_HEADER64_SIZE == sizeof(KERNEL_DUMP_HEADER64));
+
+/**
+ * Summary of 32-bit kernel and bitmap dumps, right after the header.
+ * The bitmap of the pages that were written follows it.
+ */
+typedef struct _KERNEL_DUMP_SUMMARY32
+{
+	DWORD	nSignature;
+	DWORD	nValidDump;
+	DWORD	fDumpOptions;
+
+	// Offset of the first page in the file.
+	DWORD	cbHeaders;
+
+	DWORD	nBitmapBits;
+
+	// Number of pages written, which is the number
+	// of bits set in the bitmap.
+	DWORD	nPages;
+} KERNEL_DUMP_SUMMARY32, *PKERNEL_DUMP_SUMMARY32;
+typedef CONST KERNEL_DUMP_SUMMARY32 *PCKERNEL_DUMP_SUMMARY32;
+C_ASSERT(0x18 == sizeof(KERNEL_DUMP_SUMMARY32));
+
+/**
+ * Summary of 64-bit kernel and bitmap dumps, right after the header.
+ * The bitmap of the pages that were written follows it.
+ */
+typedef struct _KERNEL_DUMP_SUMMARY64
+{
+	DWORD		nSignature;
+	DWORD		nValidDump;
+	BYTE		acbReserved[0x20 - 0x8];
+
+	// Offset of the first page in the file.
+	ULONGLONG	cbHeaders;
+
+	// Number of pages written, which is the number
+	// of bits set in the bitmap.
+	ULONGLONG	nPages;
+
+	ULONGLONG	nBitmapBits;
+} KERNEL_DUMP_SUMMARY64, *PKERNEL_DUMP_SUMMARY64;
+typedef CONST KERNEL_DUMP_SUMMARY64 *PCKERNEL_DUMP_SUMMARY64;
+C_ASSERT(0x20 == FIELD_OFFSET(KERNEL_DUMP_SUMMARY64, cbHeaders));
+C_ASSERT(0x38 == sizeof(KERNEL_DUMP_SUMMARY64));
+
+/**
+ * Header of the secondary data, right after the last page.
+ * The first record follows it.
+ */
+typedef struct _KERNEL_DUMP_BLOB_FILE_HEADER
+{
+	DWORD	nSignature1;
+	DWORD	nSignature2;
+	DWORD	cbHeader;
+	DWORD	nBuildNumber;
+} KERNEL_DUMP_BLOB_FILE_HEADER, *PKERNEL_DUMP_BLOB_FILE_HEADER;
+typedef CONST KERNEL_DUMP_BLOB_FILE_HEADER *PCKERNEL_DUMP_BLOB_FILE_HEADER;
+
+/**
+ * Header of each record of secondary data.
+ * The record's data follows it, between two runs of padding,
+ * and the next record follows the data.
+ */
+typedef struct _KERNEL_DUMP_BLOB_HEADER
+{
+	DWORD	cbHeader;
+	GUID	tTag;
+	DWORD	cbData;
+	DWORD	cbPrePad;
+	DWORD	cbPostPad;
+} KERNEL_DUMP_BLOB_HEADER, *PKERNEL_DUMP_BLOB_HEADER;
+typedef CONST KERNEL_DUMP_BLOB_HEADER *PCKERNEL_DUMP_BLOB_HEADER;
+C_ASSERT(0x20 == sizeof(KERNEL_DUMP_BLOB_HEADER));
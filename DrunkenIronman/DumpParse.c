@@ -1,5 +1,5 @@
 /**
- * @file DumpParse.cpp
+ * @file DumpParse.c
  * @author biko
  * @date 2016-07-30
  *
@@ -8,126 +8,1653 @@
 
 /** Headers *************************************************************/
 #include <Windows.h>
+#ifdef _WIN32
 #include <DbgEng.h>
+#include <delayimp.h>
+#endif // _WIN32
+#include <intsafe.h>
+#include <strsafe.h>
+
+#include <assert.h>
+
+#include <Drink.h>
 
 #include "Util.h"
 #include "Debug.h"
+#include "DumpFormat.h"
+#include "DumpFile.h"
+
+#include "DumpParse.h"
+
+
+/** Constants ***********************************************************/
+
+/**
+ * How much the native reader reads at once.
+ * Enough for the header and summary, or for the records
+ * at the start of the secondary data.
+ */
+#define DUMPPARSE_READ_AHEAD_SIZE (64 * 1024)
+C_ASSERT(KERNEL_DUMP_HEADER64_SIZE + sizeof(KERNEL_DUMP_SUMMARY64) <= DUMPPARSE_READ_AHEAD_SIZE);
+
+/**
+ * Number of records the list of tagged data initially has room for.
+ * A dump usually has only a handful.
+ */
+#define DUMPPARSE_INITIAL_TAGS (16)
+
+/**
+ * Signature and version of dump indexes.
+ */
+#define DUMPPARSE_INDEX_SIGNATURE (0x58444944)	// "DIDX"
+#define DUMPPARSE_INDEX_VERSION (1)
+
+
+/** Typedefs ************************************************************/
+
+typedef struct _DUMP_FILE_CONTEXT
+{
+	// The reader that opened the file.
+	DUMPPARSE_READER	eReader;
+
+#ifdef _WIN32
+	// Used by the debugger reader.
+	IDebugClient *		piDebugClient;
+#endif // _WIN32
+
+	// Used by the native reader.
+	HDUMPFILE			hFile;
+	ULONGLONG			cbFile;
+
+	// What the headers say.
+	DUMPPARSE_DUMP_INFO	tInfo;
+
+	// Offset of the first record of secondary data.
+	// The size of the file if there is none.
+	ULONGLONG			nFirstRecord;
+
+	// The last stretch of the file read,
+	// which small reads are served from.
+	PBYTE				pnReadAhead;
+	ULONGLONG			nReadAheadOffset;
+	DWORD				cbReadAhead;
+
+	// How much of the file was read, in bytes.
+	ULONGLONG			cbRead;
+
+	// The records of secondary data, once they were scanned.
+	BOOL				bScanned;
+	PDUMPPARSE_TAG		patTags;
+	DWORD				nTags;
+	DWORD				nTagsCapacity;
+} DUMP_FILE_CONTEXT, *PDUMP_FILE_CONTEXT;
+typedef CONST DUMP_FILE_CONTEXT *PCDUMP_FILE_CONTEXT;
+
+/**
+ * Identifies the dump an index was made from.
+ * If any of these changes, the dump was rewritten.
+ */
+typedef struct _DUMPPARSE_INDEX_KEY
+{
+	ULONGLONG	cbFile;
+	ULONGLONG	nLastWriteTime;
+
+	// FNV-1a of the header.
+	DWORD		nHeaderHash;
+} DUMPPARSE_INDEX_KEY, *PDUMPPARSE_INDEX_KEY;
+typedef CONST DUMPPARSE_INDEX_KEY *PCDUMPPARSE_INDEX_KEY;
+
+/**
+ * Start of an index file.
+ * The records of tagged data in the dump follow it.
+ */
+typedef struct _DUMPPARSE_INDEX_HEADER
+{
+	DWORD				nSignature;
+	DWORD				nVersion;
+	DUMPPARSE_INDEX_KEY	tKey;
+
+	DUMPPARSE_DUMP_INFO	tInfo;
+	ULONGLONG			nFirstRecord;
+	DWORD				nTags;
+} DUMPPARSE_INDEX_HEADER, *PDUMPPARSE_INDEX_HEADER;
+typedef CONST DUMPPARSE_INDEX_HEADER *PCDUMPPARSE_INDEX_HEADER;
+
+/**
+ * Opens a dump file into a context.
+ *
+ * @param[in]	pwszPath	Path to the dump file,
+ *							with environment variables expanded.
+ * @param[in]	ptContext	The context to fill.
+ *
+ * @returns HRESULT
+ */
+typedef
+HRESULT
+FN_DUMPPARSE_OPEN(
+	_In_	PCWSTR				pwszPath,
+	_Inout_	PDUMP_FILE_CONTEXT	ptContext
+);
+typedef FN_DUMPPARSE_OPEN *PFN_DUMPPARSE_OPEN;
+
+/**
+ * Releases what an opener put in a context.
+ *
+ * @param[in]	ptContext	The context.
+ */
+typedef
+VOID
+FN_DUMPPARSE_CLOSE(
+	_Inout_	PDUMP_FILE_CONTEXT	ptContext
+);
+typedef FN_DUMPPARSE_CLOSE *PFN_DUMPPARSE_CLOSE;
+
+/**
+ * Reads tagged data from an open dump file.
+ *
+ * @see DUMPPARSE_ReadTagged
+ */
+typedef
+HRESULT
+FN_DUMPPARSE_READ_TAGGED(
+	_Inout_									PDUMP_FILE_CONTEXT	ptContext,
+	_In_									LPCGUID				ptTag,
+	_Outptr_result_bytebuffer_(*pcbData)	PVOID *				ppvData,
+	_Out_									PDWORD				pcbData
+);
+typedef FN_DUMPPARSE_READ_TAGGED *PFN_DUMPPARSE_READ_TAGGED;
+
+/**
+ * Maps tagged data from an open dump file.
+ *
+ * @see DUMPPARSE_MapTagged
+ */
+typedef
+HRESULT
+FN_DUMPPARSE_MAP_TAGGED(
+	_Inout_											PDUMP_FILE_CONTEXT	ptContext,
+	_In_											LPCGUID				ptTag,
+	_Outptr_result_bytebuffer_maybenull_(*pcbData)	LPCVOID *			ppvData,
+	_Out_											PDWORD				pcbData
+);
+typedef FN_DUMPPARSE_MAP_TAGGED *PFN_DUMPPARSE_MAP_TAGGED;
+
+/**
+ * Lists the tagged data in an open dump file.
+ *
+ * @see DUMPPARSE_EnumerateTags
+ */
+typedef
+HRESULT
+FN_DUMPPARSE_ENUMERATE_TAGS(
+	_Inout_							PDUMP_FILE_CONTEXT	ptContext,
+	_Outptr_result_buffer_(*pnTags)	PDUMPPARSE_TAG *	patTags,
+	_Out_							PDWORD				pnTags
+);
+typedef FN_DUMPPARSE_ENUMERATE_TAGS *PFN_DUMPPARSE_ENUMERATE_TAGS;
+
+/**
+ * Describes a single way of reading dump files.
+ */
+typedef struct _DUMPPARSE_READER_ENTRY
+{
+	// Name of the reader, for diagnostics.
+	PCWSTR							pwszName;
+
+	PFN_DUMPPARSE_OPEN				pfnOpen;
+	PFN_DUMPPARSE_CLOSE				pfnClose;
+	PFN_DUMPPARSE_READ_TAGGED		pfnReadTagged;
+	PFN_DUMPPARSE_MAP_TAGGED		pfnMapTagged;
+	PFN_DUMPPARSE_ENUMERATE_TAGS	pfnEnumerateTags;
+} DUMPPARSE_READER_ENTRY, *PDUMPPARSE_READER_ENTRY;
+typedef CONST DUMPPARSE_READER_ENTRY *PCDUMPPARSE_READER_ENTRY;
+
+// Forward declarations for the reader table.
+STATIC FN_DUMPPARSE_OPEN dumpparse_OpenNative;
+STATIC FN_DUMPPARSE_CLOSE dumpparse_CloseNative;
+STATIC FN_DUMPPARSE_READ_TAGGED dumpparse_ReadTaggedNative;
+STATIC FN_DUMPPARSE_MAP_TAGGED dumpparse_MapTaggedNative;
+STATIC FN_DUMPPARSE_ENUMERATE_TAGS dumpparse_EnumerateTagsNative;
+STATIC FN_DUMPPARSE_OPEN dumpparse_OpenDebugger;
+STATIC FN_DUMPPARSE_CLOSE dumpparse_CloseDebugger;
+STATIC FN_DUMPPARSE_READ_TAGGED dumpparse_ReadTaggedDebugger;
+STATIC FN_DUMPPARSE_MAP_TAGGED dumpparse_MapTaggedDebugger;
+STATIC FN_DUMPPARSE_ENUMERATE_TAGS dumpparse_EnumerateTagsDebugger;
+STATIC FN_DUMPPARSE_OPEN dumpparse_OpenIndexed;
+
+
+/** Globals *************************************************************/
+
+/**
+ * The ways of reading dump files, indexed by DUMPPARSE_READER.
+ */
+STATIC CONST DUMPPARSE_READER_ENTRY g_atReaders[] = {
+	{
+		L"native",
+		&dumpparse_OpenNative,
+		&dumpparse_CloseNative,
+		&dumpparse_ReadTaggedNative,
+		&dumpparse_MapTaggedNative,
+		&dumpparse_EnumerateTagsNative
+	},
+
+	{
+		L"dbgeng",
+		&dumpparse_OpenDebugger,
+		&dumpparse_CloseDebugger,
+		&dumpparse_ReadTaggedDebugger,
+		&dumpparse_MapTaggedDebugger,
+		&dumpparse_EnumerateTagsDebugger
+	},
+
+	{
+		// Only opening differs from the native reader.
+		L"indexed",
+		&dumpparse_OpenIndexed,
+		&dumpparse_CloseNative,
+		&dumpparse_ReadTaggedNative,
+		&dumpparse_MapTaggedNative,
+		&dumpparse_EnumerateTagsNative
+	},
+};
+C_ASSERT(ARRAYSIZE(g_atReaders) == DUMPPARSE_READERS);
+
+
+/** Functions ***********************************************************/
+
+/**
+ * Reads part of a dump file opened by the native reader.
+ * Small reads are served from the read-ahead buffer,
+ * which is refilled from where they start when they miss it.
+ *
+ * @param[in]	ptContext	The dump file.
+ * @param[in]	nOffset		Where to start reading.
+ * @param[out]	pvBuffer	Will receive the data.
+ * @param[in]	cbBuffer	How much to read, in bytes.
+ *
+ * @returns HRESULT
+ */
+STATIC
+HRESULT
+dumpparse_ReadAt(
+	_Inout_							PDUMP_FILE_CONTEXT	ptContext,
+	_In_							ULONGLONG			nOffset,
+	_Out_writes_bytes_(cbBuffer)	PVOID				pvBuffer,
+	_In_							DWORD				cbBuffer
+)
+{
+	HRESULT	hrResult	= E_FAIL;
+	PBYTE	pnBuffer	= NULL;
+	DWORD	cbCopied	= 0;
+	DWORD	cbRead		= 0;
+
+	assert(NULL != ptContext);
+	assert(NULL != ptContext->pnReadAhead);
+	assert(NULL != pvBuffer);
+
+	pnBuffer = (PBYTE)pvBuffer;
+
+	// Whatever part of it was read ahead isn't read again.
+	if ((ptContext->nReadAheadOffset <= nOffset) &&
+		(nOffset - ptContext->nReadAheadOffset < ptContext->cbReadAhead))
+	{
+		cbCopied = min(cbBuffer, ptContext->cbReadAhead - (DWORD)(nOffset - ptContext->nReadAheadOffset));
+		CopyMemory(pnBuffer,
+				   ptContext->pnReadAhead + (nOffset - ptContext->nReadAheadOffset),
+				   cbCopied);
+	}
+
+	if (DUMPPARSE_READ_AHEAD_SIZE < cbBuffer - cbCopied)
+	{
+		// Too big to buffer, so the rest is read as is.
+		hrResult = DUMPFILE_ReadAt(ptContext->hFile,
+								   nOffset + cbCopied,
+								   pnBuffer + cbCopied,
+								   cbBuffer - cbCopied,
+								   &cbRead);
+		ptContext->cbRead += cbRead;
+		if (FAILED(hrResult))
+		{
+			goto lblCleanup;
+		}
+
+		cbCopied += cbRead;
+	}
+	else if (cbBuffer > cbCopied)
+	{
+		ptContext->cbReadAhead = 0;
+		hrResult = DUMPFILE_ReadAt(ptContext->hFile,
+								   nOffset + cbCopied,
+								   ptContext->pnReadAhead,
+								   DUMPPARSE_READ_AHEAD_SIZE,
+								   &cbRead);
+		ptContext->cbRead += cbRead;
+		if (FAILED(hrResult))
+		{
+			goto lblCleanup;
+		}
+		ptContext->nReadAheadOffset = nOffset + cbCopied;
+		ptContext->cbReadAhead = cbRead;
+
+		cbRead = min(cbBuffer - cbCopied, cbRead);
+		CopyMemory(pnBuffer + cbCopied, ptContext->pnReadAhead, cbRead);
+		cbCopied += cbRead;
+	}
+
+	if (cbBuffer != cbCopied)
+	{
+		hrResult = HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
+		goto lblCleanup;
+	}
+
+	hrResult = S_OK;
+
+lblCleanup:
+	return hrResult;
+}
+
+/**
+ * Parses the header of a dump, and the summary that follows it
+ * in kernel and bitmap dumps, finding where the pages end,
+ * which is where the secondary data starts.
+ *
+ * @param[in]	ptContext	The dump file, opened by the native reader.
+ * @param[out]	ptInfo		Will receive what the header says.
+ *							The build number is left alone.
+ *
+ * @returns HRESULT
+ *
+ * @remark	Only the header and summary are read, since the pages
+ *			are all the same size. The pages themselves aren't read.
+ */
+STATIC
+HRESULT
+dumpparse_ParseHeader(
+	_Inout_	PDUMP_FILE_CONTEXT		ptContext,
+	_Out_	PDUMPPARSE_DUMP_INFO	ptInfo
+)
+{
+	HRESULT					hrResult		= E_FAIL;
+	KERNEL_DUMP_HEADER64	tHeader			= { 0 };
+	PCKERNEL_DUMP_HEADER32	ptHeader32		= NULL;
+	KERNEL_DUMP_SUMMARY64	tSummary		= { 0 };
+	PCKERNEL_DUMP_SUMMARY32	ptSummary32		= NULL;
+	BOOL					b64Bit			= FALSE;
+	DWORD					cbHeader		= 0;
+	DWORD					eDumpType		= 0;
+	ULONGLONG				nFirstPage		= 0;
+	ULONGLONG				nPages			= 0;
+	ULONGLONG				cbPages			= 0;
+
+	C_ASSERT(sizeof(tHeader) >= sizeof(*ptHeader32));
+	C_ASSERT(sizeof(tSummary) >= sizeof(*ptSummary32));
+
+	assert(NULL != ptContext);
+	assert(NULL != ptInfo);
+
+	ptHeader32 = (PCKERNEL_DUMP_HEADER32)&tHeader;
+	ptSummary32 = (PCKERNEL_DUMP_SUMMARY32)&tSummary;
+
+	// Both headers start with the same signatures,
+	// and the 32-bit one is the shorter. Reading it reads ahead
+	// the rest of the 64-bit header and the summary too.
+	hrResult = dumpparse_ReadAt(ptContext, 0, &tHeader, sizeof(*ptHeader32));
+	if (FAILED(hrResult))
+	{
+		PROGRESS("The file is too small to be a dump.");
+		goto lblCleanup;
+	}
+
+	if ((KERNEL_DUMP_SIGNATURE == tHeader.nSignature) &&
+		(KERNEL_DUMP_VALID_DUMP32 == tHeader.nValidDump))
+	{
+		cbHeader = KERNEL_DUMP_HEADER32_SIZE;
+		eDumpType = ptHeader32->eDumpType;
+		nPages = ptHeader32->nMemoryPages;
+	}
+	else if ((KERNEL_DUMP_SIGNATURE == tHeader.nSignature) &&
+			 (KERNEL_DUMP_VALID_DUMP64 == tHeader.nValidDump))
+	{
+		b64Bit = TRUE;
+		cbHeader = KERNEL_DUMP_HEADER64_SIZE;
+
+		hrResult = dumpparse_ReadAt(ptContext, 0, &tHeader, sizeof(tHeader));
+		if (FAILED(hrResult))
+		{
+			PROGRESS("The file is too small to be a dump.");
+			goto lblCleanup;
+		}
+
+		eDumpType = tHeader.eDumpType;
+		nPages = tHeader.nMemoryPages;
+	}
+	else
+	{
+		PROGRESS("The file isn't a kernel dump.");
+		hrResult = HRESULT_FROM_WIN32(ERROR_BAD_FORMAT);
+		goto lblCleanup;
+	}
+
+	switch (eDumpType)
+	{
+	case KERNEL_DUMP_TYPE_FULL:
+		// Every page of the physical memory runs,
+		// right after the header.
+		nFirstPage = cbHeader;
+		break;
+
+	case KERNEL_DUMP_TYPE_SUMMARY:
+	case KERNEL_DUMP_TYPE_BITMAP_FULL:
+	case KERNEL_DUMP_TYPE_BITMAP_KERNEL:
+		hrResult = dumpparse_ReadAt(ptContext,
+									cbHeader,
+									&tSummary,
+									b64Bit ? sizeof(tSummary) : sizeof(*ptSummary32));
+		if (FAILED(hrResult))
+		{
+			PROGRESS("The dump's summary is missing.");
+			goto lblCleanup;
+		}
+
+		if (((KERNEL_DUMP_SUMMARY_SIGNATURE != tSummary.nSignature) &&
+			 (KERNEL_DUMP_BITMAP_SIGNATURE != tSummary.nSignature)) ||
+			(KERNEL_DUMP_SUMMARY_VALID_DUMP != tSummary.nValidDump))
+		{
+			PROGRESS("The dump's summary is corrupt.");
+			hrResult = HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+			goto lblCleanup;
+		}
+
+		// Only the pages set in the bitmap,
+		// from where the summary says.
+		nFirstPage = b64Bit ? tSummary.cbHeaders : ptSummary32->cbHeaders;
+		nPages = b64Bit ? tSummary.nPages : ptSummary32->nPages;
+		break;
+
+	default:
+		PROGRESS("Only full, kernel and bitmap dumps are supported (this one is type %lu).", eDumpType);
+		hrResult = HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+		goto lblCleanup;
+	}
+
+	hrResult = ULongLongMult(nPages, KERNEL_DUMP_PAGE_SIZE, &cbPages);
+	if (FAILED(hrResult))
+	{
+		PROGRESS("The dump's page count is corrupt.");
+		goto lblCleanup;
+	}
+
+	hrResult = ULongLongAdd(nFirstPage, cbPages, &(ptInfo->nSecondaryData));
+	if (FAILED(hrResult))
+	{
+		PROGRESS("The dump's page count is corrupt.");
+		goto lblCleanup;
+	}
+
+	ptInfo->b64Bit = b64Bit;
+	ptInfo->eDumpType = eDumpType;
+	ptInfo->nFirstPage = nFirstPage;
+	ptInfo->nPages = nPages;
+
+	hrResult = S_OK;
+
+lblCleanup:
+	return hrResult;
+}
+
+/**
+ * Opens a dump file for the native reader, without parsing it.
+ *
+ * @param[in]	pwszPath	Path to the dump file.
+ * @param[in]	ptContext	The context to fill.
+ *
+ * @returns HRESULT
+ *
+ * @remark	Whatever is put in the context is released
+ *			by dumpparse_CloseNative, even if opening fails.
+ */
+STATIC
+HRESULT
+dumpparse_OpenFile(
+	_In_	PCWSTR				pwszPath,
+	_Inout_	PDUMP_FILE_CONTEXT	ptContext
+)
+{
+	HRESULT	hrResult	= E_FAIL;
+
+	assert(NULL != pwszPath);
+	assert(NULL != ptContext);
+
+	hrResult = DUMPFILE_Open(pwszPath, &(ptContext->hFile));
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	hrResult = DUMPFILE_GetSize(ptContext->hFile, &(ptContext->cbFile));
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	ptContext->pnReadAhead = HEAPALLOC(DUMPPARSE_READ_AHEAD_SIZE);
+	if (NULL == ptContext->pnReadAhead)
+	{
+		PROGRESS("Oops. Ran out of memory.");
+		hrResult = E_OUTOFMEMORY;
+		goto lblCleanup;
+	}
+
+	hrResult = S_OK;
+
+lblCleanup:
+	return hrResult;
+}
+
+/**
+ * Parses the headers of a dump file opened for the native reader,
+ * and finds its first record of secondary data.
+ *
+ * @param[in]	ptContext	The dump file.
+ *
+ * @returns HRESULT
+ */
+STATIC
+HRESULT
+dumpparse_ParseDump(
+	_Inout_	PDUMP_FILE_CONTEXT	ptContext
+)
+{
+	HRESULT							hrResult	= E_FAIL;
+	KERNEL_DUMP_BLOB_FILE_HEADER	tBlobFile	= { 0 };
+	ULONGLONG						nEnd		= 0;
+
+	assert(NULL != ptContext);
+
+	// The secondary data is right after the pages, so where it starts
+	// is worked out from the header, rather than by reading up to it.
+	hrResult = dumpparse_ParseHeader(ptContext, &(ptContext->tInfo));
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+	nEnd = ptContext->tInfo.nSecondaryData;
+
+	// Dumps without secondary data are still dumps,
+	// there's just nothing to read from them.
+	ptContext->nFirstRecord = ptContext->cbFile;
+	if (SUCCEEDED(dumpparse_ReadAt(ptContext, nEnd, &tBlobFile, sizeof(tBlobFile))) &&
+		(KERNEL_DUMP_BLOB_SIGNATURE1 == tBlobFile.nSignature1) &&
+		(KERNEL_DUMP_BLOB_SIGNATURE2 == tBlobFile.nSignature2))
+	{
+		ptContext->nFirstRecord = nEnd + tBlobFile.cbHeader;
+		ptContext->tInfo.nBuildNumber = tBlobFile.nBuildNumber;
+	}
+
+	hrResult = S_OK;
+
+lblCleanup:
+	return hrResult;
+}
+
+STATIC
+HRESULT
+dumpparse_OpenNative(
+	_In_	PCWSTR				pwszPath,
+	_Inout_	PDUMP_FILE_CONTEXT	ptContext
+)
+{
+	HRESULT	hrResult	= E_FAIL;
+
+	assert(NULL != pwszPath);
+	assert(NULL != ptContext);
+
+	hrResult = dumpparse_OpenFile(pwszPath, ptContext);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	hrResult = dumpparse_ParseDump(ptContext);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	hrResult = S_OK;
+
+lblCleanup:
+	return hrResult;
+}
+
+STATIC
+VOID
+dumpparse_CloseNative(
+	_Inout_	PDUMP_FILE_CONTEXT	ptContext
+)
+{
+	assert(NULL != ptContext);
+
+	HEAPFREE(ptContext->patTags);
+	HEAPFREE(ptContext->pnReadAhead);
+	CLOSE(ptContext->hFile, DUMPFILE_Close);
+}
+
+/**
+ * Appends a record to the list of tagged data in a dump file.
+ *
+ * @param[in]	ptContext	The dump file, opened by the native reader.
+ * @param[in]	ptTag		Tag identifying the data.
+ * @param[in]	nData		Offset of the data in the file.
+ * @param[in]	cbData		The data's size, in bytes.
+ *
+ * @returns HRESULT
+ */
+STATIC
+HRESULT
+dumpparse_AddRecord(
+	_Inout_	PDUMP_FILE_CONTEXT	ptContext,
+	_In_	LPCGUID				ptTag,
+	_In_	ULONGLONG			nData,
+	_In_	DWORD				cbData
+)
+{
+	HRESULT			hrResult	= E_FAIL;
+	DWORD			nCapacity	= 0;
+	PDUMPPARSE_TAG	patTags		= NULL;
+	PDUMPPARSE_TAG	ptRecord	= NULL;
+
+	assert(NULL != ptContext);
+	assert(NULL != ptTag);
+
+	if (ptContext->nTags == ptContext->nTagsCapacity)
+	{
+		// Double the capacity of the list.
+		nCapacity = DUMPPARSE_INITIAL_TAGS;
+		if (0 != ptContext->nTagsCapacity)
+		{
+			hrResult = DWordMult(ptContext->nTagsCapacity, 2, &nCapacity);
+			if (FAILED(hrResult))
+			{
+				goto lblCleanup;
+			}
+		}
+
+		patTags = HEAPALLOC(nCapacity * sizeof(patTags[0]));
+		if (NULL == patTags)
+		{
+			PROGRESS("Oops. Ran out of memory.");
+			hrResult = E_OUTOFMEMORY;
+			goto lblCleanup;
+		}
+
+		if (0 != ptContext->nTags)
+		{
+			CopyMemory(patTags, ptContext->patTags, ptContext->nTags * sizeof(patTags[0]));
+		}
+
+		// Transfer ownership:
+		HEAPFREE(ptContext->patTags);
+		ptContext->patTags = patTags;
+		patTags = NULL;
+		ptContext->nTagsCapacity = nCapacity;
+	}
+
+	ptRecord = &(ptContext->patTags[ptContext->nTags]);
+	ptRecord->tTag = *ptTag;
+	ptRecord->nOffset = nData;
+	ptRecord->cbData = cbData;
+	++(ptContext->nTags);
+
+	hrResult = S_OK;
+
+lblCleanup:
+	HEAPFREE(patTags);
+
+	return hrResult;
+}
+
+/**
+ * Lists the records in the secondary data of a dump file,
+ * unless they were already listed.
+ *
+ * @param[in]	ptContext	The dump file, opened by the native reader.
+ *
+ * @returns HRESULT
+ *
+ * @remark	The list ends at the first record that is corrupt
+ *			or cut off, rather than failing.
+ */
+STATIC
+HRESULT
+dumpparse_ScanRecords(
+	_Inout_	PDUMP_FILE_CONTEXT	ptContext
+)
+{
+	HRESULT					hrResult	= E_FAIL;
+	ULONGLONG				nOffset		= 0;
+	ULONGLONG				nData		= 0;
+	ULONGLONG				nNext		= 0;
+	KERNEL_DUMP_BLOB_HEADER	tBlob		= { 0 };
+
+	assert(NULL != ptContext);
+
+	if (ptContext->bScanned)
+	{
+		hrResult = S_OK;
+		goto lblCleanup;
+	}
+
+	// Each record says where the next one starts, so the data
+	// in between is skipped without reading it, and the headers
+	// of small records come from the same read-ahead.
+	for (nOffset = ptContext->nFirstRecord; nOffset < ptContext->cbFile; nOffset = nNext)
+	{
+		if (FAILED(dumpparse_ReadAt(ptContext, nOffset, &tBlob, sizeof(tBlob))))
+		{
+			break;
+		}
+
+		if ((sizeof(tBlob) > tBlob.cbHeader) ||
+			FAILED(ULongLongAdd(nOffset, (ULONGLONG)tBlob.cbHeader + tBlob.cbPrePad, &nData)) ||
+			FAILED(ULongLongAdd(nData, (ULONGLONG)tBlob.cbData + tBlob.cbPostPad, &nNext)))
+		{
+			break;
+		}
+
+		hrResult = dumpparse_AddRecord(ptContext, &(tBlob.tTag), nData, tBlob.cbData);
+		if (FAILED(hrResult))
+		{
+			goto lblCleanup;
+		}
+	}
+
+	ptContext->bScanned = TRUE;
+
+	hrResult = S_OK;
+
+lblCleanup:
+	return hrResult;
+}
+
+/**
+ * Finds tagged data in the secondary data of a dump file.
+ *
+ * @param[in]	ptContext	The dump file, opened by the native reader.
+ * @param[in]	ptTag		Tag identifying the data.
+ * @param[out]	pnData		Will receive the offset of the data in the file.
+ * @param[out]	pcbData		Will receive the data's size, in bytes.
+ *
+ * @returns HRESULT
+ */
+STATIC
+HRESULT
+dumpparse_FindRecord(
+	_Inout_	PDUMP_FILE_CONTEXT	ptContext,
+	_In_	LPCGUID				ptTag,
+	_Out_	PULONGLONG			pnData,
+	_Out_	PDWORD				pcbData
+)
+{
+	HRESULT			hrResult	= E_FAIL;
+	DWORD			nTag		= 0;
+	PCDUMPPARSE_TAG	ptRecord	= NULL;
+
+	assert(NULL != ptContext);
+	assert(NULL != ptTag);
+	assert(NULL != pnData);
+	assert(NULL != pcbData);
+
+	hrResult = dumpparse_ScanRecords(ptContext);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	for (nTag = 0; nTag < ptContext->nTags; ++nTag)
+	{
+		ptRecord = &(ptContext->patTags[nTag]);
+		if (IsEqualGUID(&(ptRecord->tTag), ptTag))
+		{
+			*pnData = ptRecord->nOffset;
+			*pcbData = ptRecord->cbData;
+			hrResult = S_OK;
+			goto lblCleanup;
+		}
+	}
+
+	PROGRESS("Failed reading the tagged data. Is it even there?");
+	hrResult = HRESULT_FROM_WIN32(ERROR_NOT_FOUND);
+
+lblCleanup:
+	return hrResult;
+}
+
+STATIC
+HRESULT
+dumpparse_ReadTaggedNative(
+	_Inout_									PDUMP_FILE_CONTEXT	ptContext,
+	_In_									LPCGUID				ptTag,
+	_Outptr_result_bytebuffer_(*pcbData)	PVOID *				ppvData,
+	_Out_									PDWORD				pcbData
+)
+{
+	HRESULT		hrResult	= E_FAIL;
+	ULONGLONG	nData		= 0;
+	DWORD		cbData		= 0;
+	ULONGLONG	nDataEnd	= 0;
+	PVOID		pvData		= NULL;
+
+	assert(NULL != ptContext);
+	assert(NULL != ptTag);
+	assert(NULL != ppvData);
+	assert(NULL != pcbData);
+
+	hrResult = dumpparse_FindRecord(ptContext, ptTag, &nData, &cbData);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	// The size comes from the record's header, so it's checked
+	// against the file before anything is allocated for it.
+	if (FAILED(ULongLongAdd(nData, cbData, &nDataEnd)) ||
+		(ptContext->cbFile < nDataEnd))
+	{
+		PROGRESS("Failed reading the tagged data. The dump is truncated.");
+		hrResult = HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
+		goto lblCleanup;
+	}
+
+	pvData = HEAPALLOC(cbData);
+	if (NULL == pvData)
+	{
+		PROGRESS("Oops. Ran out of memory.");
+		hrResult = E_OUTOFMEMORY;
+		goto lblCleanup;
+	}
+
+	hrResult = dumpparse_ReadAt(ptContext, nData, pvData, cbData);
+	if (FAILED(hrResult))
+	{
+		PROGRESS("Failed reading the tagged data. The dump is truncated.");
+		goto lblCleanup;
+	}
+
+	// Transfer ownership:
+	*ppvData = pvData;
+	pvData = NULL;
+	*pcbData = cbData;
+
+	hrResult = S_OK;
+
+lblCleanup:
+	HEAPFREE(pvData);
+
+	return hrResult;
+}
+
+STATIC
+HRESULT
+dumpparse_MapTaggedNative(
+	_Inout_											PDUMP_FILE_CONTEXT	ptContext,
+	_In_											LPCGUID				ptTag,
+	_Outptr_result_bytebuffer_maybenull_(*pcbData)	LPCVOID *			ppvData,
+	_Out_											PDWORD				pcbData
+)
+{
+	HRESULT		hrResult	= E_FAIL;
+	ULONGLONG	nData		= 0;
+	DWORD		cbData		= 0;
+	SIZE_T		cbMapped	= 0;
+
+	assert(NULL != ptContext);
+	assert(NULL != ptTag);
+	assert(NULL != ppvData);
+	assert(NULL != pcbData);
+
+	hrResult = dumpparse_FindRecord(ptContext, ptTag, &nData, &cbData);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	if ((ptContext->cbFile < nData) ||
+		(ptContext->cbFile - nData < cbData))
+	{
+		PROGRESS("Failed reading the tagged data. The dump is truncated.");
+		hrResult = HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
+		goto lblCleanup;
+	}
+
+	// A view of no bytes would reach the end of the file,
+	// so empty data isn't mapped at all.
+	if (0 == cbData)
+	{
+		*ppvData = NULL;
+		*pcbData = 0;
+		hrResult = S_OK;
+		goto lblCleanup;
+	}
+
+	// Only the pages the data is on are mapped.
+	hrResult = DUMPFILE_Map(ptContext->hFile, nData, cbData, ppvData, &cbMapped);
+	if (FAILED(hrResult))
+	{
+		PROGRESS("Failed mapping the tagged data.");
+		goto lblCleanup;
+	}
+
+	// Decoding reads the whole view, so it counts as read.
+	ptContext->cbRead += cbMapped;
+	*pcbData = cbData;
+
+	hrResult = S_OK;
+
+lblCleanup:
+	return hrResult;
+}
+
+STATIC
+HRESULT
+dumpparse_EnumerateTagsNative(
+	_Inout_							PDUMP_FILE_CONTEXT	ptContext,
+	_Outptr_result_buffer_(*pnTags)	PDUMPPARSE_TAG *	patTags,
+	_Out_							PDWORD				pnTags
+)
+{
+	HRESULT			hrResult	= E_FAIL;
+	PDUMPPARSE_TAG	patCopy		= NULL;
+
+	assert(NULL != ptContext);
+	assert(NULL != patTags);
+	assert(NULL != pnTags);
+
+	hrResult = dumpparse_ScanRecords(ptContext);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	// The list stays with the dump, for looking the records up.
+	patCopy = HEAPALLOC(max(ptContext->nTags, 1) * sizeof(patCopy[0]));
+	if (NULL == patCopy)
+	{
+		PROGRESS("Oops. Ran out of memory.");
+		hrResult = E_OUTOFMEMORY;
+		goto lblCleanup;
+	}
+	if (0 != ptContext->nTags)
+	{
+		CopyMemory(patCopy, ptContext->patTags, ptContext->nTags * sizeof(patCopy[0]));
+	}
+
+	// Transfer ownership:
+	*patTags = patCopy;
+	patCopy = NULL;
+	*pnTags = ptContext->nTags;
+
+	hrResult = S_OK;
+
+lblCleanup:
+	HEAPFREE(patCopy);
+
+	return hrResult;
+}
+
+/**
+ * Works out what identifies a dump file opened for the native reader,
+ * so its index can tell whether it's still the same dump.
+ *
+ * @param[in]	ptContext	The dump file.
+ * @param[out]	ptKey		Will receive the key.
+ *
+ * @returns HRESULT
+ *
+ * @remark	Only the header is read, rather than a whole read-ahead,
+ *			since with an index nothing else will be. It's left
+ *			in the read-ahead buffer, for parsing it without an index.
+ */
+STATIC
+HRESULT
+dumpparse_GetIndexKey(
+	_Inout_	PDUMP_FILE_CONTEXT		ptContext,
+	_Out_	PDUMPPARSE_INDEX_KEY	ptKey
+)
+{
+	HRESULT	hrResult	= E_FAIL;
+	DWORD	cbHeader	= 0;
+	DWORD	cbRead		= 0;
+	DWORD	nOffset		= 0;
+	DWORD	nHash		= VGA_CAPTURE_CHECKSUM_BASIS;
+
+	assert(NULL != ptContext);
+	assert(NULL != ptKey);
+
+	hrResult = DUMPFILE_GetLastWriteTime(ptContext->hFile, &(ptKey->nLastWriteTime));
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	// A 64-bit header's worth, or the whole file if it's shorter.
+	cbHeader = (DWORD)min(ptContext->cbFile, KERNEL_DUMP_HEADER64_SIZE);
+	ptContext->cbReadAhead = 0;
+	hrResult = DUMPFILE_ReadAt(ptContext->hFile,
+							   0,
+							   ptContext->pnReadAhead,
+							   cbHeader,
+							   &cbRead);
+	ptContext->cbRead += cbRead;
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+	ptContext->nReadAheadOffset = 0;
+	ptContext->cbReadAhead = cbRead;
+
+	for (nOffset = 0; nOffset < cbRead; ++nOffset)
+	{
+		nHash = VGA_CAPTURE_CHECKSUM_STEP(nHash, ptContext->pnReadAhead[nOffset]);
+	}
+
+	ptKey->cbFile = ptContext->cbFile;
+	ptKey->nHeaderHash = nHash;
+
+	hrResult = S_OK;
+
+lblCleanup:
+	return hrResult;
+}
+
+/**
+ * Retrieves the path of a dump's index.
+ *
+ * @param[in]	pwszPath		Path to the dump file.
+ * @param[out]	ppwszIndexPath	Will receive the path of the index.
+ *
+ * @returns HRESULT
+ *
+ * @remark Free the returned path to the process heap.
+ */
+STATIC
+HRESULT
+dumpparse_GetIndexPath(
+	_In_		PCWSTR	pwszPath,
+	_Outptr_	PWSTR *	ppwszIndexPath
+)
+{
+	HRESULT	hrResult		= E_FAIL;
+	SIZE_T	cchIndexPath	= 0;
+	PWSTR	pwszIndexPath	= NULL;
+
+	assert(NULL != pwszPath);
+	assert(NULL != ppwszIndexPath);
+
+	cchIndexPath = wcslen(pwszPath) + ARRAYSIZE(DUMPPARSE_INDEX_EXTENSION);
+	pwszIndexPath = HEAPALLOC(cchIndexPath * sizeof(pwszIndexPath[0]));
+	if (NULL == pwszIndexPath)
+	{
+		PROGRESS("Oops. Ran out of memory.");
+		hrResult = E_OUTOFMEMORY;
+		goto lblCleanup;
+	}
+
+	hrResult = StringCchCopyW(pwszIndexPath, cchIndexPath, pwszPath);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	hrResult = StringCchCatW(pwszIndexPath, cchIndexPath, DUMPPARSE_INDEX_EXTENSION);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	// Transfer ownership:
+	*ppwszIndexPath = pwszIndexPath;
+	pwszIndexPath = NULL;
+
+	hrResult = S_OK;
+
+lblCleanup:
+	HEAPFREE(pwszIndexPath);
+
+	return hrResult;
+}
+
+/**
+ * Fills a context from a dump's index,
+ * if the index was made from the same dump.
+ *
+ * @param[in]	ptContext		The dump file, opened for the native reader.
+ * @param[in]	pwszIndexPath	Path of the index.
+ * @param[in]	ptKey			Identifies the dump.
+ *
+ * @returns HRESULT
+ */
+STATIC
+HRESULT
+dumpparse_LoadIndex(
+	_Inout_	PDUMP_FILE_CONTEXT		ptContext,
+	_In_	PCWSTR					pwszIndexPath,
+	_In_	PCDUMPPARSE_INDEX_KEY	ptKey
+)
+{
+	HRESULT						hrResult	= E_FAIL;
+	PVOID						pvIndex		= NULL;
+	DWORD						cbIndex		= 0;
+	PCDUMPPARSE_INDEX_HEADER	ptHeader	= NULL;
+	PDUMPPARSE_TAG				patTags		= NULL;
+
+	assert(NULL != ptContext);
+	assert(NULL != pwszIndexPath);
+	assert(NULL != ptKey);
+
+	// There's no index the first time the dump is opened.
+	hrResult = DUMPFILE_ReadAll(pwszIndexPath, &pvIndex, &cbIndex);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+	ptHeader = (PCDUMPPARSE_INDEX_HEADER)pvIndex;
+
+	if ((sizeof(*ptHeader) > cbIndex) ||
+		(DUMPPARSE_INDEX_SIGNATURE != ptHeader->nSignature) ||
+		(DUMPPARSE_INDEX_VERSION != ptHeader->nVersion) ||
+		((cbIndex - sizeof(*ptHeader)) / sizeof(patTags[0]) != ptHeader->nTags) ||
+		((cbIndex - sizeof(*ptHeader)) % sizeof(patTags[0]) != 0))
+	{
+		PROGRESS("The dump's index is corrupt.");
+		hrResult = HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+		goto lblCleanup;
+	}
+
+	if ((ptKey->cbFile != ptHeader->tKey.cbFile) ||
+		(ptKey->nLastWriteTime != ptHeader->tKey.nLastWriteTime) ||
+		(ptKey->nHeaderHash != ptHeader->tKey.nHeaderHash))
+	{
+		PROGRESS("The dump changed since it was indexed.");
+		hrResult = HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+		goto lblCleanup;
+	}
+
+	patTags = HEAPALLOC(max(ptHeader->nTags, 1) * sizeof(patTags[0]));
+	if (NULL == patTags)
+	{
+		PROGRESS("Oops. Ran out of memory.");
+		hrResult = E_OUTOFMEMORY;
+		goto lblCleanup;
+	}
+	if (0 != ptHeader->nTags)
+	{
+		CopyMemory(patTags, ptHeader + 1, ptHeader->nTags * sizeof(patTags[0]));
+	}
+
+	// Transfer ownership:
+	ptContext->tInfo = ptHeader->tInfo;
+	ptContext->nFirstRecord = ptHeader->nFirstRecord;
+	HEAPFREE(ptContext->patTags);
+	ptContext->patTags = patTags;
+	patTags = NULL;
+	ptContext->nTags = ptHeader->nTags;
+	ptContext->nTagsCapacity = ptHeader->nTags;
+	ptContext->bScanned = TRUE;
+
+	hrResult = S_OK;
+
+lblCleanup:
+	HEAPFREE(patTags);
+	HEAPFREE(pvIndex);
+
+	return hrResult;
+}
+
+/**
+ * Writes an index of a parsed and scanned dump.
+ *
+ * @param[in]	ptContext		The dump file, opened for the native reader.
+ * @param[in]	pwszIndexPath	Path of the index.
+ * @param[in]	ptKey			Identifies the dump.
+ *
+ * @returns HRESULT
+ */
+STATIC
+HRESULT
+dumpparse_SaveIndex(
+	_In_	PCDUMP_FILE_CONTEXT		ptContext,
+	_In_	PCWSTR					pwszIndexPath,
+	_In_	PCDUMPPARSE_INDEX_KEY	ptKey
+)
+{
+	HRESULT					hrResult	= E_FAIL;
+	DWORD					cbTags		= 0;
+	DWORD					cbIndex		= 0;
+	PDUMPPARSE_INDEX_HEADER	ptHeader	= NULL;
+
+	assert(NULL != ptContext);
+	assert(NULL != pwszIndexPath);
+	assert(NULL != ptKey);
+	assert(ptContext->bScanned);
+
+	hrResult = DWordMult(ptContext->nTags, sizeof(ptContext->patTags[0]), &cbTags);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+	hrResult = DWordAdd(sizeof(*ptHeader), cbTags, &cbIndex);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	ptHeader = HEAPALLOC(cbIndex);
+	if (NULL == ptHeader)
+	{
+		PROGRESS("Oops. Ran out of memory.");
+		hrResult = E_OUTOFMEMORY;
+		goto lblCleanup;
+	}
+
+	ptHeader->nSignature = DUMPPARSE_INDEX_SIGNATURE;
+	ptHeader->nVersion = DUMPPARSE_INDEX_VERSION;
+	ptHeader->tKey = *ptKey;
+	ptHeader->tInfo = ptContext->tInfo;
+	ptHeader->nFirstRecord = ptContext->nFirstRecord;
+	ptHeader->nTags = ptContext->nTags;
+	if (0 != cbTags)
+	{
+		CopyMemory(ptHeader + 1, ptContext->patTags, cbTags);
+	}
+
+	// Each writer has a file of its own, renamed over the index
+	// once it's whole, so no one reads a half-written index,
+	// even when several threads or processes index the same dump.
+	hrResult = DUMPFILE_Replace(pwszIndexPath, ptHeader, cbIndex);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	hrResult = S_OK;
+
+lblCleanup:
+	HEAPFREE(ptHeader);
+
+	return hrResult;
+}
+
+STATIC
+HRESULT
+dumpparse_OpenIndexed(
+	_In_	PCWSTR				pwszPath,
+	_Inout_	PDUMP_FILE_CONTEXT	ptContext
+)
+{
+	HRESULT				hrResult		= E_FAIL;
+	DUMPPARSE_INDEX_KEY	tKey			= { 0 };
+	PWSTR				pwszIndexPath	= NULL;
+
+	assert(NULL != pwszPath);
+	assert(NULL != ptContext);
+
+	hrResult = dumpparse_OpenFile(pwszPath, ptContext);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	hrResult = dumpparse_GetIndexKey(ptContext, &tKey);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	hrResult = dumpparse_GetIndexPath(pwszPath, &pwszIndexPath);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	if (SUCCEEDED(dumpparse_LoadIndex(ptContext, pwszIndexPath, &tKey)))
+	{
+		PROGRESS("Read the dump's index.");
+		hrResult = S_OK;
+		goto lblCleanup;
+	}
+
+	// The records are scanned now rather than when first looked up,
+	// so they go in the index.
+	hrResult = dumpparse_ParseDump(ptContext);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	hrResult = dumpparse_ScanRecords(ptContext);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	// The dump may well be somewhere read-only,
+	// in which case it's parsed every time, as without an index.
+	if (FAILED(dumpparse_SaveIndex(ptContext, pwszIndexPath, &tKey)))
+	{
+		PROGRESS("Couldn't write the dump's index to '%S'.", pwszIndexPath);
+	}
+
+	hrResult = S_OK;
+
+lblCleanup:
+	HEAPFREE(pwszIndexPath);
+
+	return hrResult;
+}
+
+#ifdef _WIN32
+
+STATIC
+HRESULT
+dumpparse_OpenDebugger(
+	_In_	PCWSTR				pwszPath,
+	_Inout_	PDUMP_FILE_CONTEXT	ptContext
+)
+{
+	HRESULT			hrResult		= E_FAIL;
+	IDebugClient *	piDebugClient	= NULL;
+	PSTR			pszPath			= NULL;
+
+	assert(NULL != pwszPath);
+	assert(NULL != ptContext);
+
+	// dbgeng.dll is delay-loaded, since only this reader uses it,
+	// so load it here rather than fault on the first call.
+	hrResult = __HrLoadAllImportsForDll("dbgeng.dll");
+	if (FAILED(hrResult))
+	{
+		PROGRESS("Failed loading dbgeng.dll.");
+		goto lblCleanup;
+	}
+
+	hrResult = DebugCreate(&IID_IDebugClient, &piDebugClient);
+	if (FAILED(hrResult))
+	{
+		PROGRESS("Failed obtaining the IDebugClient4.");
+		goto lblCleanup;
+	}
 
-#include "DumpParse.h"
+	hrResult = UTIL_DuplicateStringUnicodeToAnsi(pwszPath, &pszPath);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
 
+	hrResult = piDebugClient->lpVtbl->OpenDumpFile(piDebugClient, pszPath);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
 
-/** Typedefs ************************************************************/
+	// Transfer ownership:
+	ptContext->piDebugClient = piDebugClient;
+	piDebugClient = NULL;
 
-typedef struct _DUMP_FILE_CONTEXT
-{
-	IDebugClient *	piDebugClient;
-} DUMP_FILE_CONTEXT, *PDUMP_FILE_CONTEXT;
-typedef CONST DUMP_FILE_CONTEXT *PCDUMP_FILE_CONTEXT;
+	hrResult = S_OK;
 
+lblCleanup:
+	HEAPFREE(pszPath);
+	RELEASE(piDebugClient);
 
-/** Functions ***********************************************************/
+	return hrResult;
+}
+
+STATIC
+VOID
+dumpparse_CloseDebugger(
+	_Inout_	PDUMP_FILE_CONTEXT	ptContext
+)
+{
+	assert(NULL != ptContext);
+
+	RELEASE(ptContext->piDebugClient);
+}
 
+STATIC
 HRESULT
-DUMPPARSE_Open(
-	_In_opt_	PCWSTR	pwszPath,
-	_Out_		PHDUMP	phDump
+dumpparse_ReadTaggedDebugger(
+	_Inout_									PDUMP_FILE_CONTEXT	ptContext,
+	_In_									LPCGUID				ptTag,
+	_Outptr_result_bytebuffer_(*pcbData)	PVOID *				ppvData,
+	_Out_									PDWORD				pcbData
 )
 {
 	HRESULT				hrResult			= E_FAIL;
-	PDUMP_FILE_CONTEXT	ptContext			= NULL;
 	IDebugClient *		piDebugClient		= NULL;
-	DWORD				eType				= REG_NONE;
-	DWORD				cbSystemDumpFile	= 0;
-	PWSTR				pwszSystemDumpFile	= NULL;
-	PWSTR				pwszExpandedPath	= NULL;
-	PSTR				pszExpandedPath		= NULL;
+	IDebugDataSpaces3 *	piDebugDataSpaces	= NULL;
+	ULONG				cbData				= 0;
+	PVOID				pvData				= NULL;
+
+	C_ASSERT(sizeof(*pcbData) == sizeof(cbData));
+
+	assert(NULL != ptContext);
+	assert(NULL != ptTag);
+	assert(NULL != ppvData);
+	assert(NULL != pcbData);
 
-	if (NULL == phDump)
+	piDebugClient = ptContext->piDebugClient;
+
+	hrResult = piDebugClient->lpVtbl->QueryInterface(piDebugClient,
+													 &IID_IDebugDataSpaces3,
+													 &piDebugDataSpaces);
+	if (FAILED(hrResult))
 	{
-		PROGRESS("Invalid arguments specified.");
-		hrResult = E_INVALIDARG;
+		PROGRESS("Failed obtaining the IDebugDataSpaces3 interface.");
 		goto lblCleanup;
 	}
 
-	PROGRESS("Opening dump file '%S'.", pwszPath);
+	hrResult = piDebugDataSpaces->lpVtbl->ReadTagged(piDebugDataSpaces,
+													 (LPGUID)ptTag,
+													 0,
+													 NULL, 0,
+													 &cbData);
+	if (FAILED(hrResult))
+	{
+		PROGRESS("Failed reading the tagged data. Is it even there?");
+		goto lblCleanup;
+	}
 
-	ptContext = HEAPALLOC(sizeof(*ptContext));
-	if (NULL == ptContext)
+	pvData = HEAPALLOC(cbData);
+	if (NULL == pvData)
 	{
 		PROGRESS("Oops. Ran out of memory.");
 		hrResult = E_OUTOFMEMORY;
 		goto lblCleanup;
 	}
 
-	hrResult = DebugCreate(&IID_IDebugClient, &piDebugClient);
+	hrResult = piDebugDataSpaces->lpVtbl->ReadTagged(piDebugDataSpaces,
+													 (LPGUID)ptTag,
+													 0,
+													 pvData, cbData,
+													 NULL);
 	if (FAILED(hrResult))
 	{
-		PROGRESS("Failed obtaining the IDebugClient4.");
+		PROGRESS("Failed reading the tagged data. Is it even there?");
 		goto lblCleanup;
 	}
 
-	if (NULL == pwszPath)
-	{
-		PROGRESS("NULL path specified. Obtaining the path to the system dump file.");
+	// Transfer ownership:
+	*ppvData = pvData;
+	pvData = NULL;
+	*pcbData = cbData;
 
-		hrResult = UTIL_RegGetValue(HKEY_LOCAL_MACHINE,
-									L"SYSTEM\\CurrentControlSet\\Control\\CrashControl",
-									L"DumpFile",
-									&pwszSystemDumpFile,
-									&cbSystemDumpFile,
-									&eType);
-		if (FAILED(hrResult))
-		{
-			PROGRESS("Failed obtaining the path to the system dump file.");
-			goto lblCleanup;
-		}
-		if ((REG_SZ != eType) && (REG_EXPAND_SZ != eType))
-		{
-			PROGRESS("Failed obtaining the path to the system dump file. Incorrect data format.");
-			hrResult = HRESULT_FROM_WIN32(ERROR_INVALID_DATATYPE);
-			goto lblCleanup;
-		}
+	hrResult = S_OK;
+
+lblCleanup:
+	HEAPFREE(pvData);
+	RELEASE(piDebugDataSpaces);
+
+	return hrResult;
+}
+
+#else // !_WIN32
+
+STATIC
+HRESULT
+dumpparse_OpenDebugger(
+	_In_	PCWSTR				pwszPath,
+	_Inout_	PDUMP_FILE_CONTEXT	ptContext
+)
+{
+	UNREFERENCED_PARAMETER(pwszPath);
+	UNREFERENCED_PARAMETER(ptContext);
+
+	PROGRESS("The debugger engine only runs on Windows.");
+
+	return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+}
+
+STATIC
+VOID
+dumpparse_CloseDebugger(
+	_Inout_	PDUMP_FILE_CONTEXT	ptContext
+)
+{
+	UNREFERENCED_PARAMETER(ptContext);
+}
+
+STATIC
+HRESULT
+dumpparse_ReadTaggedDebugger(
+	_Inout_									PDUMP_FILE_CONTEXT	ptContext,
+	_In_									LPCGUID				ptTag,
+	_Outptr_result_bytebuffer_(*pcbData)	PVOID *				ppvData,
+	_Out_									PDWORD				pcbData
+)
+{
+	UNREFERENCED_PARAMETER(ptContext);
+	UNREFERENCED_PARAMETER(ptTag);
+	UNREFERENCED_PARAMETER(ppvData);
+	UNREFERENCED_PARAMETER(pcbData);
+
+	return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+}
+
+#endif // !_WIN32
+
+STATIC
+HRESULT
+dumpparse_MapTaggedDebugger(
+	_Inout_											PDUMP_FILE_CONTEXT	ptContext,
+	_In_											LPCGUID				ptTag,
+	_Outptr_result_bytebuffer_maybenull_(*pcbData)	LPCVOID *			ppvData,
+	_Out_											PDWORD				pcbData
+)
+{
+	UNREFERENCED_PARAMETER(ptContext);
+	UNREFERENCED_PARAMETER(ptTag);
+	UNREFERENCED_PARAMETER(ppvData);
+	UNREFERENCED_PARAMETER(pcbData);
+
+	PROGRESS("The debugger engine can't map tagged data.");
+
+	return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+}
+
+STATIC
+HRESULT
+dumpparse_EnumerateTagsDebugger(
+	_Inout_							PDUMP_FILE_CONTEXT	ptContext,
+	_Outptr_result_buffer_(*pnTags)	PDUMPPARSE_TAG *	patTags,
+	_Out_							PDWORD				pnTags
+)
+{
+	UNREFERENCED_PARAMETER(ptContext);
+	UNREFERENCED_PARAMETER(patTags);
+	UNREFERENCED_PARAMETER(pnTags);
+
+	PROGRESS("The debugger engine can't tell where tagged data is.");
 
-		pwszPath = pwszSystemDumpFile;
+	return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+}
+
+HRESULT
+DUMPPARSE_Open(
+	_In_opt_	PCWSTR	pwszPath,
+	_Out_		PHDUMP	phDump
+)
+{
+	return DUMPPARSE_OpenWithReader(pwszPath, DUMPPARSE_READER_NATIVE, phDump);
+}
+
+HRESULT
+DUMPPARSE_OpenWithReader(
+	_In_opt_	PCWSTR				pwszPath,
+	_In_		DUMPPARSE_READER	eReader,
+	_Out_		PHDUMP				phDump
+)
+{
+	HRESULT				hrResult			= E_FAIL;
+	PDUMP_FILE_CONTEXT	ptContext			= NULL;
+	PWSTR				pwszExpandedPath	= NULL;
+
+	if ((DUMPPARSE_READERS <= eReader) ||
+		(NULL == phDump))
+	{
+		PROGRESS("Invalid arguments specified.");
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
 	}
 
-	hrResult = UTIL_ExpandEnvironmentStrings(pwszPath, &pwszExpandedPath);
-	if (FAILED(hrResult))
+	PROGRESS("Opening dump file '%S'.", pwszPath);
+
+	ptContext = HEAPALLOC(sizeof(*ptContext));
+	if (NULL == ptContext)
 	{
+		PROGRESS("Oops. Ran out of memory.");
+		hrResult = E_OUTOFMEMORY;
 		goto lblCleanup;
 	}
+	ptContext->eReader = eReader;
 
-	hrResult = UTIL_DuplicateStringUnicodeToAnsi(pwszExpandedPath, &pszExpandedPath);
+	hrResult = DUMPFILE_ResolvePath(pwszPath, &pwszExpandedPath);
 	if (FAILED(hrResult))
 	{
 		goto lblCleanup;
 	}
 
-	hrResult = piDebugClient->lpVtbl->OpenDumpFile(piDebugClient, pszExpandedPath);
+	hrResult = g_atReaders[eReader].pfnOpen(pwszExpandedPath, ptContext);
 	if (FAILED(hrResult))
 	{
 		PROGRESS("Failed opening the dump file.");
+		g_atReaders[eReader].pfnClose(ptContext);
 		goto lblCleanup;
 	}
 
 	// Transfer ownership:
-	ptContext->piDebugClient = piDebugClient;
-	piDebugClient = NULL;
 	*phDump = (HDUMP)ptContext;
 	ptContext = NULL;
 
 	hrResult = S_OK;
 
 lblCleanup:
-	HEAPFREE(pszExpandedPath);
 	HEAPFREE(pwszExpandedPath);
-	HEAPFREE(pwszSystemDumpFile);
-	RELEASE(piDebugClient);
 	HEAPFREE(ptContext);
 
 	return hrResult;
 }
 
+PCWSTR
+DUMPPARSE_GetReaderName(
+	_In_	DUMPPARSE_READER	eReader
+)
+{
+	assert(DUMPPARSE_READERS > eReader);
+
+	return g_atReaders[eReader].pwszName;
+}
+
 VOID
 DUMPPARSE_Close(
 	_In_	HDUMP	hDump
@@ -140,7 +1667,7 @@ DUMPPARSE_Close(
 		goto lblCleanup;
 	}
 
-	RELEASE(ptContext->piDebugClient);
+	g_atReaders[ptContext->eReader].pfnClose(ptContext);
 	HEAPFREE(ptContext);
 
 lblCleanup:
@@ -155,14 +1682,8 @@ DUMPPARSE_ReadTagged(
 	_Out_									PDWORD	pcbData
 )
 {
-	HRESULT				hrResult			= E_FAIL;
-	PDUMP_FILE_CONTEXT	ptContext			= (PDUMP_FILE_CONTEXT)hDump;
-	IDebugClient *		piDebugClient		= NULL;
-	IDebugDataSpaces3 *	piDebugDataSpaces	= NULL;
-	ULONG				cbData				= 0;
-	PVOID				pvData				= NULL;
-
-	C_ASSERT(sizeof(*pcbData) == sizeof(cbData));
+	HRESULT				hrResult	= E_FAIL;
+	PDUMP_FILE_CONTEXT	ptContext	= (PDUMP_FILE_CONTEXT)hDump;
 
 	if ((NULL == hDump) ||
 		(NULL == ptTag) ||
@@ -174,57 +1695,119 @@ DUMPPARSE_ReadTagged(
 		goto lblCleanup;
 	}
 
-	piDebugClient = ptContext->piDebugClient;
+	hrResult = g_atReaders[ptContext->eReader].pfnReadTagged(ptContext, ptTag, ppvData, pcbData);
 
-	hrResult = piDebugClient->lpVtbl->QueryInterface(piDebugClient,
-													 &IID_IDebugDataSpaces3,
-													 &piDebugDataSpaces);
-	if (FAILED(hrResult))
+lblCleanup:
+	return hrResult;
+}
+
+HRESULT
+DUMPPARSE_MapTagged(
+	_In_											HDUMP		hDump,
+	_In_											LPCGUID		ptTag,
+	_Outptr_result_bytebuffer_maybenull_(*pcbData)	LPCVOID *	ppvData,
+	_Out_											PDWORD		pcbData
+)
+{
+	HRESULT				hrResult	= E_FAIL;
+	PDUMP_FILE_CONTEXT	ptContext	= (PDUMP_FILE_CONTEXT)hDump;
+
+	if ((NULL == hDump) ||
+		(NULL == ptTag) ||
+		(NULL == ppvData) ||
+		(NULL == pcbData))
 	{
-		PROGRESS("Failed obtaining the IDebugDataSpaces3 interface.");
+		PROGRESS("Invalid arguments specified.");
+		hrResult = E_INVALIDARG;
 		goto lblCleanup;
 	}
 
-	hrResult = piDebugDataSpaces->lpVtbl->ReadTagged(piDebugDataSpaces,
-													 (LPGUID)ptTag,
-													 0,
-													 NULL, 0,
-													 &cbData);
-	if (FAILED(hrResult))
+	hrResult = g_atReaders[ptContext->eReader].pfnMapTagged(ptContext, ptTag, ppvData, pcbData);
+
+lblCleanup:
+	return hrResult;
+}
+
+HRESULT
+DUMPPARSE_EnumerateTags(
+	_In_							HDUMP				hDump,
+	_Outptr_result_buffer_(*pnTags)	PDUMPPARSE_TAG *	patTags,
+	_Out_							PDWORD				pnTags
+)
+{
+	HRESULT				hrResult	= E_FAIL;
+	PDUMP_FILE_CONTEXT	ptContext	= (PDUMP_FILE_CONTEXT)hDump;
+
+	if ((NULL == hDump) ||
+		(NULL == patTags) ||
+		(NULL == pnTags))
 	{
-		PROGRESS("Failed reading the tagged data. Is it even there?");
+		PROGRESS("Invalid arguments specified.");
+		hrResult = E_INVALIDARG;
 		goto lblCleanup;
 	}
 
-	pvData = HEAPALLOC(cbData);
-	if (NULL == pvData)
+	hrResult = g_atReaders[ptContext->eReader].pfnEnumerateTags(ptContext, patTags, pnTags);
+
+lblCleanup:
+	return hrResult;
+}
+
+VOID
+DUMPPARSE_UnmapTagged(
+	_In_	LPCVOID	pvData,
+	_In_	DWORD	cbData
+)
+{
+	DUMPFILE_Unmap(pvData, cbData);
+}
+
+VOID
+DUMPPARSE_GetReadStatistics(
+	_In_	HDUMP		hDump,
+	_Out_	PULONGLONG	pcbRead,
+	_Out_	PULONGLONG	pcbFile
+)
+{
+	PCDUMP_FILE_CONTEXT	ptContext	= (PCDUMP_FILE_CONTEXT)hDump;
+
+	assert(NULL != hDump);
+	assert(NULL != pcbRead);
+	assert(NULL != pcbFile);
+
+	// Both stay 0 for the debugger reader.
+	*pcbRead = ptContext->cbRead;
+	*pcbFile = ptContext->cbFile;
+}
+
+HRESULT
+DUMPPARSE_GetDumpInfo(
+	_In_	HDUMP					hDump,
+	_Out_	PDUMPPARSE_DUMP_INFO	ptInfo
+)
+{
+	HRESULT				hrResult	= E_FAIL;
+	PCDUMP_FILE_CONTEXT	ptContext	= (PCDUMP_FILE_CONTEXT)hDump;
+
+	if ((NULL == hDump) ||
+		(NULL == ptInfo))
 	{
-		PROGRESS("Oops. Ran out of memory.");
-		hrResult = E_OUTOFMEMORY;
+		PROGRESS("Invalid arguments specified.");
+		hrResult = E_INVALIDARG;
 		goto lblCleanup;
 	}
 
-	hrResult = piDebugDataSpaces->lpVtbl->ReadTagged(piDebugDataSpaces,
-													 (LPGUID)ptTag,
-													 0,
-													 pvData, cbData,
-													 NULL);
-	if (FAILED(hrResult))
+	if (DUMPPARSE_READER_DEBUGGER == ptContext->eReader)
 	{
-		PROGRESS("Failed reading the tagged data. Is it even there?");
+		PROGRESS("The debugger engine doesn't parse the headers itself.");
+		hrResult = HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
 		goto lblCleanup;
 	}
 
-	// Transfer ownership:
-	*ppvData = pvData;
-	pvData = NULL;
-	*pcbData = cbData;
+	*ptInfo = ptContext->tInfo;
 
 	hrResult = S_OK;
 
 lblCleanup:
-	HEAPFREE(pvData);
-	RELEASE(piDebugDataSpaces);
-
 	return hrResult;
 }
@@ -12,6 +12,39 @@
 #include <Windows.h>
 
 
+/** Constants ***********************************************************/
+
+/**
+ * Appended to the path of a dump to get the path of its index.
+ */
+#define DUMPPARSE_INDEX_EXTENSION (L".didx")
+
+
+/** Enums ***************************************************************/
+
+/**
+ * The ways of reading dump files.
+ */
+typedef enum _DUMPPARSE_READER
+{
+	// Parses the dump's headers and walks its secondary data
+	// with plain file reads.
+	DUMPPARSE_READER_NATIVE = 0,
+
+	// Opens the dump with the debugger engine (dbgeng).
+	// Only on Windows.
+	DUMPPARSE_READER_DEBUGGER,
+
+	// Like the native reader, but keeps what it finds in an index
+	// next to the dump, so opening it again doesn't parse it again.
+	// Only used when asked for, since it writes next to the dump.
+	DUMPPARSE_READER_INDEXED,
+
+	// Must be last:
+	DUMPPARSE_READERS
+} DUMPPARSE_READER, *PDUMPPARSE_READER;
+
+
 /** Typedefs ************************************************************/
 
 /**
@@ -20,18 +53,63 @@
 DECLARE_HANDLE(HDUMP);
 typedef HDUMP *PHDUMP;
 
+/**
+ * A record of tagged data in a dump file.
+ */
+typedef struct _DUMPPARSE_TAG
+{
+	// Tag identifying the data.
+	GUID		tTag;
+
+	// Offset of the data in the dump file.
+	ULONGLONG	nOffset;
+
+	// Size of the data, in bytes.
+	DWORD		cbData;
+} DUMPPARSE_TAG, *PDUMPPARSE_TAG;
+typedef CONST DUMPPARSE_TAG *PCDUMPPARSE_TAG;
+
+/**
+ * What the headers of a dump file say.
+ */
+typedef struct _DUMPPARSE_DUMP_INFO
+{
+	// Whether a 64-bit kernel wrote the dump.
+	BOOL		b64Bit;
+
+	// The kind of dump (a KERNEL_DUMP_TYPE).
+	DWORD		eDumpType;
+
+	// Offset of the first page in the file,
+	// and the number of pages written.
+	ULONGLONG	nFirstPage;
+	ULONGLONG	nPages;
+
+	// Offset of the secondary data, right after the last page.
+	ULONGLONG	nSecondaryData;
+
+	// Build number of the kernel, as saved with the secondary data.
+	// 0 if there is none.
+	DWORD		nBuildNumber;
+} DUMPPARSE_DUMP_INFO, *PDUMPPARSE_DUMP_INFO;
+typedef CONST DUMPPARSE_DUMP_INFO *PCDUMPPARSE_DUMP_INFO;
+
 
 /** Functions ***********************************************************/
 
 /**
- * Opens a dump file.
+ * Opens a dump file with the native reader.
  *
  * @param[in]	pwszPath	Path to the dump file.
  *							If not specified, the system crash dump
- *							will be opened (usually C:\Windows\MEMORY.DMP).
+ *							will be opened (usually C:\Windows\MEMORY.DMP),
+ *							which only Windows has.
  * @param[in]	phDump		Will receive a handle to the dump file.
  *
  * @returns HRESULT
+ *
+ * @remark	Nothing is written next to the dump. To keep an index of it,
+ *			open it with DUMPPARSE_READER_INDEXED instead.
  */
 HRESULT
 DUMPPARSE_Open(
@@ -39,6 +117,37 @@ DUMPPARSE_Open(
 	_Out_		PHDUMP	phDump
 );
 
+/**
+ * Opens a dump file with the given reader.
+ *
+ * @param[in]	pwszPath	Path to the dump file.
+ *							If not specified, the system crash dump
+ *							will be opened (usually C:\Windows\MEMORY.DMP),
+ *							which only Windows has.
+ * @param[in]	eReader		How to read the dump file.
+ * @param[in]	phDump		Will receive a handle to the dump file.
+ *
+ * @returns HRESULT
+ */
+HRESULT
+DUMPPARSE_OpenWithReader(
+	_In_opt_	PCWSTR				pwszPath,
+	_In_		DUMPPARSE_READER	eReader,
+	_Out_		PHDUMP				phDump
+);
+
+/**
+ * Retrieves the name of a way of reading dump files.
+ *
+ * @param[in]	eReader	The reader.
+ *
+ * @returns PCWSTR
+ */
+PCWSTR
+DUMPPARSE_GetReaderName(
+	_In_	DUMPPARSE_READER	eReader
+);
+
 /**
  * Closes a dump file.
  *
@@ -68,3 +177,97 @@ DUMPPARSE_ReadTagged(
 	_Outptr_result_bytebuffer_(*pcbData)	PVOID *	ppvData,
 	_Out_									PDWORD	pcbData
 );
+
+/**
+ * Maps tagged data from the dump file, rather than copying it.
+ * Only the pages the data is on are mapped, however big the dump is.
+ *
+ * @param[in]	hDump	Dump file to read from.
+ * @param[in]	ptTag	Tag identifying the data to map.
+ * @param[out]	ppvData	Will receive a read-only view of the data.
+ *						NULL if the data is empty.
+ * @param[out]	pcbData	Will receive the data's size, in bytes.
+ *
+ * @returns HRESULT
+ *
+ * @remark	The view stays valid after the dump file is closed.
+ *			Unmap it with DUMPPARSE_UnmapTagged.
+ * @remark	Only the native reader can map data.
+ */
+HRESULT
+DUMPPARSE_MapTagged(
+	_In_											HDUMP		hDump,
+	_In_											LPCGUID		ptTag,
+	_Outptr_result_bytebuffer_maybenull_(*pcbData)	LPCVOID *	ppvData,
+	_Out_											PDWORD		pcbData
+);
+
+/**
+ * Lists the tagged data in the dump file, in the order it was saved.
+ * The records are all found with a single pass over the
+ * secondary data, which later reads and maps look them up in,
+ * so reading many of them costs no more passes.
+ *
+ * @param[in]	hDump	Dump file to read from.
+ * @param[out]	patTags	Will receive the records.
+ * @param[out]	pnTags	Will receive the number of records.
+ *
+ * @returns HRESULT
+ *
+ * @remark	Free the returned array to the process heap.
+ * @remark	Only the native reader can list tagged data.
+ */
+HRESULT
+DUMPPARSE_EnumerateTags(
+	_In_							HDUMP				hDump,
+	_Outptr_result_buffer_(*pnTags)	PDUMPPARSE_TAG *	patTags,
+	_Out_							PDWORD				pnTags
+);
+
+/**
+ * Unmaps tagged data mapped by DUMPPARSE_MapTagged.
+ *
+ * @param[in]	pvData	The view of the data.
+ * @param[in]	cbData	The data's size, in bytes,
+ *						as DUMPPARSE_MapTagged returned it.
+ */
+VOID
+DUMPPARSE_UnmapTagged(
+	_In_	LPCVOID	pvData,
+	_In_	DWORD	cbData
+);
+
+/**
+ * Retrieves how much of a dump file was read so far.
+ * The native reader reads the header and the secondary data,
+ * but never the pages between them, so this doesn't grow
+ * with the size of the dump.
+ *
+ * @param[in]	hDump	The dump file.
+ * @param[out]	pcbRead	Will receive how much was read or mapped, in bytes.
+ * @param[out]	pcbFile	Will receive the size of the dump file, in bytes.
+ *
+ * @remark Both are 0 for the debugger reader, which doesn't tell.
+ */
+VOID
+DUMPPARSE_GetReadStatistics(
+	_In_	HDUMP		hDump,
+	_Out_	PULONGLONG	pcbRead,
+	_Out_	PULONGLONG	pcbFile
+);
+
+/**
+ * Retrieves what the headers of a dump file say.
+ *
+ * @param[in]	hDump	The dump file.
+ * @param[out]	ptInfo	Will receive the information.
+ *
+ * @returns HRESULT
+ *
+ * @remark Only the native and indexed readers parse the headers.
+ */
+HRESULT
+DUMPPARSE_GetDumpInfo(
+	_In_	HDUMP					hDump,
+	_Out_	PDUMPPARSE_DUMP_INFO	ptInfo
+);
@@ -0,0 +1,304 @@
+/**
+ * @file DumpSynth.c
+ * @author biko
+ * @date 2026-10-17
+ *
+ * DumpSynth module implementation.
+ */
+
+/** Headers *************************************************************/
+#include <Windows.h>
+#include <intsafe.h>
+
+#include <assert.h>
+
+#include "Util.h"
+#include "Debug.h"
+#include "DumpFormat.h"
+
+#include "DumpSynth.h"
+
+
+/** Constants ***********************************************************/
+
+/**
+ * Number of pages of memory written to each dump.
+ */
+#define DUMP_SYNTH_PAGES (8)
+
+/**
+ * Size of the physical memory that the bitmaps describe, in pages.
+ * Every other page is written.
+ */
+#define DUMP_SYNTH_BITMAP_BITS (DUMP_SYNTH_PAGES * 2)
+
+/**
+ * Build number written to the secondary data's header.
+ */
+#define DUMP_SYNTH_BUILD_NUMBER (19041)
+
+/**
+ * Size of the data of the records with other tags, in bytes.
+ */
+#define DUMP_SYNTH_DECOY_SIZE (0x200)
+
+/**
+ * Padding before and after the data of each record, in bytes.
+ */
+#define DUMP_SYNTH_RECORD_PAD (0x10)
+
+
+/** Typedefs ************************************************************/
+
+/**
+ * Describes a single layout of synthetic dumps.
+ */
+typedef struct _DUMPSYNTH_LAYOUT_ENTRY
+{
+	PCWSTR				pwszName;
+	BOOL				b64Bit;
+	KERNEL_DUMP_TYPE	eDumpType;
+
+	// Signature of the summary, or 0 for dumps without one.
+	DWORD				nSummarySignature;
+} DUMPSYNTH_LAYOUT_ENTRY, *PDUMPSYNTH_LAYOUT_ENTRY;
+typedef CONST DUMPSYNTH_LAYOUT_ENTRY *PCDUMPSYNTH_LAYOUT_ENTRY;
+
+
+/** Globals *************************************************************/
+
+/**
+ * The layouts, indexed by DUMP_SYNTH_LAYOUT.
+ */
+STATIC CONST DUMPSYNTH_LAYOUT_ENTRY g_atLayouts[] = {
+	{ L"full32", FALSE, KERNEL_DUMP_TYPE_FULL, 0 },
+	{ L"kernel32", FALSE, KERNEL_DUMP_TYPE_SUMMARY, KERNEL_DUMP_SUMMARY_SIGNATURE },
+	{ L"full64", TRUE, KERNEL_DUMP_TYPE_FULL, 0 },
+	{ L"kernel64", TRUE, KERNEL_DUMP_TYPE_SUMMARY, KERNEL_DUMP_SUMMARY_SIGNATURE },
+	{ L"bitmap64", TRUE, KERNEL_DUMP_TYPE_BITMAP_FULL, KERNEL_DUMP_BITMAP_SIGNATURE },
+};
+C_ASSERT(ARRAYSIZE(g_atLayouts) == DUMP_SYNTH_LAYOUTS);
+
+/**
+ * {2f6a1c0e-5b7d-4e39-8a42-0d3c91e7b6a5}
+ * {c8e04d71-93a2-4f1b-b65e-7a18d2f40c93}
+ * Tags of the records around the requested one,
+ * standing in for the data of other drivers.
+ */
+STATIC CONST GUID g_tDecoyTagBefore =
+{ 0x2f6a1c0e, 0x5b7d, 0x4e39, { 0x8a, 0x42, 0x0d, 0x3c, 0x91, 0xe7, 0xb6, 0xa5 } };
+STATIC CONST GUID g_tDecoyTagAfter =
+{ 0xc8e04d71, 0x93a2, 0x4f1b, { 0xb6, 0x5e, 0x7a, 0x18, 0xd2, 0xf4, 0x0c, 0x93 } };
+
+
+/** Functions ***********************************************************/
+
+/**
+ * Writes a record of secondary data.
+ *
+ * @param[out]	pnRecord	Where to write the record.
+ * @param[in]	ptTag		Tag of the record.
+ * @param[in]	pvData		The record's data,
+ *							or NULL to fill it with a byte.
+ * @param[in]	cbData		Size of the data, in bytes.
+ * @param[in]	nFill		The byte to fill the data with
+ *							if pvData is NULL.
+ *
+ * @returns PBYTE (where the next record goes)
+ */
+STATIC
+PBYTE
+dumpsynth_WriteRecord(
+	_Out_							PBYTE	pnRecord,
+	_In_							LPCGUID	ptTag,
+	_In_reads_bytes_opt_(cbData)	PVOID	pvData,
+	_In_							DWORD	cbData,
+	_In_							BYTE	nFill
+)
+{
+	KERNEL_DUMP_BLOB_HEADER	tBlob	= { 0 };
+	PBYTE					pnData	= NULL;
+
+	assert(NULL != pnRecord);
+	assert(NULL != ptTag);
+
+	// Records follow data of any size, so they needn't be aligned.
+	tBlob.cbHeader = sizeof(tBlob);
+	tBlob.tTag = *ptTag;
+	tBlob.cbData = cbData;
+	tBlob.cbPrePad = DUMP_SYNTH_RECORD_PAD;
+	tBlob.cbPostPad = DUMP_SYNTH_RECORD_PAD;
+	CopyMemory(pnRecord, &tBlob, sizeof(tBlob));
+
+	pnData = pnRecord + sizeof(tBlob) + DUMP_SYNTH_RECORD_PAD;
+	if (NULL == pvData)
+	{
+		FillMemory(pnData, cbData, nFill);
+	}
+	else
+	{
+		CopyMemory(pnData, pvData, cbData);
+	}
+
+	return pnData + cbData + DUMP_SYNTH_RECORD_PAD;
+}
+
+PCWSTR
+DUMPSYNTH_GetLayoutName(
+	_In_	DUMP_SYNTH_LAYOUT	eLayout
+)
+{
+	assert(DUMP_SYNTH_LAYOUTS > eLayout);
+
+	return g_atLayouts[eLayout].pwszName;
+}
+
+HRESULT
+DUMPSYNTH_Create(
+	_In_									DUMP_SYNTH_LAYOUT	eLayout,
+	_In_									LPCGUID				ptTag,
+	_In_reads_bytes_(cbData)				PVOID				pvData,
+	_In_									DWORD				cbData,
+	_Outptr_result_bytebuffer_(*pcbDump)	PVOID *				ppvDump,
+	_Out_									PDWORD				pcbDump
+)
+{
+	HRESULT							hrResult	= E_FAIL;
+	PCDUMPSYNTH_LAYOUT_ENTRY		ptLayout	= NULL;
+	DWORD							cbHeader	= 0;
+	DWORD							cbSummary	= 0;
+	DWORD							nFirstPage	= 0;
+	DWORD							nEnd		= 0;
+	DWORD							cbRecords	= 0;
+	DWORD							cbDump		= 0;
+	PBYTE							pnDump		= NULL;
+	PKERNEL_DUMP_HEADER32			ptHeader32	= NULL;
+	PKERNEL_DUMP_HEADER64			ptHeader64	= NULL;
+	PKERNEL_DUMP_SUMMARY32			ptSummary32	= NULL;
+	PKERNEL_DUMP_SUMMARY64			ptSummary64	= NULL;
+	PBYTE							pnBitmap	= NULL;
+	PKERNEL_DUMP_BLOB_FILE_HEADER	ptBlobFile	= NULL;
+	PBYTE							pnRecord	= NULL;
+	DWORD							nPage		= 0;
+
+	assert(DUMP_SYNTH_LAYOUTS > eLayout);
+	assert(NULL != ptTag);
+	assert(NULL != pvData);
+	assert(NULL != ppvDump);
+	assert(NULL != pcbDump);
+
+	ptLayout = &(g_atLayouts[eLayout]);
+
+	cbHeader = ptLayout->b64Bit ? KERNEL_DUMP_HEADER64_SIZE : KERNEL_DUMP_HEADER32_SIZE;
+	if (0 == ptLayout->nSummarySignature)
+	{
+		nFirstPage = cbHeader;
+	}
+	else
+	{
+		// The summary and its bitmap,
+		// then the pages from the next page boundary.
+		cbSummary = ptLayout->b64Bit ? sizeof(KERNEL_DUMP_SUMMARY64) : sizeof(KERNEL_DUMP_SUMMARY32);
+		nFirstPage = cbHeader + cbSummary + (DUMP_SYNTH_BITMAP_BITS / 8);
+		nFirstPage = (nFirstPage + KERNEL_DUMP_PAGE_SIZE - 1) & ~(KERNEL_DUMP_PAGE_SIZE - 1);
+	}
+	nEnd = nFirstPage + (DUMP_SYNTH_PAGES * KERNEL_DUMP_PAGE_SIZE);
+
+	// The secondary data's header, then the requested record
+	// between two others.
+	cbRecords = sizeof(KERNEL_DUMP_BLOB_FILE_HEADER) +
+				(3 * (sizeof(KERNEL_DUMP_BLOB_HEADER) + (2 * DUMP_SYNTH_RECORD_PAD))) +
+				(2 * DUMP_SYNTH_DECOY_SIZE);
+	hrResult = DWordAdd(nEnd + cbRecords, cbData, &cbDump);
+	if (FAILED(hrResult))
+	{
+		PROGRESS("The data is too big.");
+		goto lblCleanup;
+	}
+
+	pnDump = HEAPALLOC(cbDump);
+	if (NULL == pnDump)
+	{
+		PROGRESS("Oops. Ran out of memory.");
+		hrResult = E_OUTOFMEMORY;
+		goto lblCleanup;
+	}
+
+	if (ptLayout->b64Bit)
+	{
+		ptHeader64 = (PKERNEL_DUMP_HEADER64)pnDump;
+		ptHeader64->nSignature = KERNEL_DUMP_SIGNATURE;
+		ptHeader64->nValidDump = KERNEL_DUMP_VALID_DUMP64;
+		ptHeader64->nMemoryRuns = 1;
+		ptHeader64->nMemoryPages = (0 == ptLayout->nSummarySignature) ? DUMP_SYNTH_PAGES : DUMP_SYNTH_BITMAP_BITS;
+		ptHeader64->eDumpType = ptLayout->eDumpType;
+	}
+	else
+	{
+		ptHeader32 = (PKERNEL_DUMP_HEADER32)pnDump;
+		ptHeader32->nSignature = KERNEL_DUMP_SIGNATURE;
+		ptHeader32->nValidDump = KERNEL_DUMP_VALID_DUMP32;
+		ptHeader32->nMemoryRuns = 1;
+		ptHeader32->nMemoryPages = (0 == ptLayout->nSummarySignature) ? DUMP_SYNTH_PAGES : DUMP_SYNTH_BITMAP_BITS;
+		ptHeader32->eDumpType = ptLayout->eDumpType;
+	}
+
+	if (0 != ptLayout->nSummarySignature)
+	{
+		if (ptLayout->b64Bit)
+		{
+			ptSummary64 = (PKERNEL_DUMP_SUMMARY64)(pnDump + cbHeader);
+			ptSummary64->nSignature = ptLayout->nSummarySignature;
+			ptSummary64->nValidDump = KERNEL_DUMP_SUMMARY_VALID_DUMP;
+			ptSummary64->cbHeaders = nFirstPage;
+			ptSummary64->nPages = DUMP_SYNTH_PAGES;
+			ptSummary64->nBitmapBits = DUMP_SYNTH_BITMAP_BITS;
+		}
+		else
+		{
+			ptSummary32 = (PKERNEL_DUMP_SUMMARY32)(pnDump + cbHeader);
+			ptSummary32->nSignature = ptLayout->nSummarySignature;
+			ptSummary32->nValidDump = KERNEL_DUMP_SUMMARY_VALID_DUMP;
+			ptSummary32->cbHeaders = nFirstPage;
+			ptSummary32->nPages = DUMP_SYNTH_PAGES;
+			ptSummary32->nBitmapBits = DUMP_SYNTH_BITMAP_BITS;
+		}
+
+		// Every other page.
+		pnBitmap = pnDump + cbHeader + cbSummary;
+		FillMemory(pnBitmap, DUMP_SYNTH_BITMAP_BITS / 8, 0x55);
+	}
+
+	// Fill each page with its number, so that
+	// reading a page as secondary data would show.
+	for (nPage = 0; nPage < DUMP_SYNTH_PAGES; ++nPage)
+	{
+		FillMemory(pnDump + nFirstPage + (nPage * KERNEL_DUMP_PAGE_SIZE),
+				   KERNEL_DUMP_PAGE_SIZE,
+				   (BYTE)(nPage + 1));
+	}
+
+	ptBlobFile = (PKERNEL_DUMP_BLOB_FILE_HEADER)(pnDump + nEnd);
+	ptBlobFile->nSignature1 = KERNEL_DUMP_BLOB_SIGNATURE1;
+	ptBlobFile->nSignature2 = KERNEL_DUMP_BLOB_SIGNATURE2;
+	ptBlobFile->cbHeader = sizeof(*ptBlobFile);
+	ptBlobFile->nBuildNumber = DUMP_SYNTH_BUILD_NUMBER;
+
+	pnRecord = (PBYTE)(ptBlobFile + 1);
+	pnRecord = dumpsynth_WriteRecord(pnRecord, &g_tDecoyTagBefore, NULL, DUMP_SYNTH_DECOY_SIZE, 0xAA);
+	pnRecord = dumpsynth_WriteRecord(pnRecord, ptTag, pvData, cbData, 0);
+	pnRecord = dumpsynth_WriteRecord(pnRecord, &g_tDecoyTagAfter, NULL, DUMP_SYNTH_DECOY_SIZE, 0xBB);
+	assert(pnDump + cbDump == pnRecord);
+
+	// Transfer ownership:
+	*ppvDump = pnDump;
+	pnDump = NULL;
+	*pcbDump = cbDump;
+
+	hrResult = S_OK;
+
+lblCleanup:
+	HEAPFREE(pnDump);
+
+	return hrResult;
+}
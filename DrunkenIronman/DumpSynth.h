@@ -0,0 +1,81 @@
+/**
+ * @file DumpSynth.h
+ * @author biko
+ * @date 2026-10-17
+ *
+ * DumpSynth module public header.
+ * Contains routines for generating synthetic kernel memory dumps,
+ * for testing and benchmarking the dump readers without a crashed machine.
+ */
+#pragma once
+
+/** Headers *************************************************************/
+#include <Windows.h>
+
+
+/** Enums ***************************************************************/
+
+/**
+ * The layouts of synthetic dumps.
+ */
+typedef enum _DUMP_SYNTH_LAYOUT
+{
+	// 32-bit dump of every page, right after the header.
+	DUMP_SYNTH_LAYOUT_FULL32 = 0,
+
+	// 32-bit dump of the pages set in the summary's bitmap.
+	DUMP_SYNTH_LAYOUT_KERNEL32,
+
+	// 64-bit dump of every page, right after the header.
+	DUMP_SYNTH_LAYOUT_FULL64,
+
+	// 64-bit dump of the pages set in the summary's bitmap.
+	DUMP_SYNTH_LAYOUT_KERNEL64,
+
+	// 64-bit full dump, with pages picked by a bitmap
+	// as written since Windows 8.
+	DUMP_SYNTH_LAYOUT_BITMAP64,
+
+	// Must be last:
+	DUMP_SYNTH_LAYOUTS
+} DUMP_SYNTH_LAYOUT, *PDUMP_SYNTH_LAYOUT;
+
+
+/** Functions ***********************************************************/
+
+/**
+ * Retrieves the name of a layout of synthetic dumps.
+ *
+ * @param[in]	eLayout	The layout.
+ *
+ * @returns PCWSTR
+ */
+PCWSTR
+DUMPSYNTH_GetLayoutName(
+	_In_	DUMP_SYNTH_LAYOUT	eLayout
+);
+
+/**
+ * Generates a synthetic dump: a header, a few pages of memory,
+ * and secondary data in which the given tagged data sits
+ * between records with other tags.
+ *
+ * @param[in]	eLayout		The layout of the dump.
+ * @param[in]	ptTag		Tag of the data.
+ * @param[in]	pvData		The data.
+ * @param[in]	cbData		Size of the data, in bytes.
+ * @param[out]	ppvDump		Will receive the dump.
+ *							Free with HEAPFREE.
+ * @param[out]	pcbDump		Will receive the dump's size, in bytes.
+ *
+ * @returns HRESULT
+ */
+HRESULT
+DUMPSYNTH_Create(
+	_In_									DUMP_SYNTH_LAYOUT	eLayout,
+	_In_									LPCGUID				ptTag,
+	_In_reads_bytes_(cbData)				PVOID				pvData,
+	_In_									DWORD				cbData,
+	_Outptr_result_bytebuffer_(*pcbDump)	PVOID *				ppvDump,
+	_Out_									PDWORD				pcbDump
+);
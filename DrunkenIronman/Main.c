@@ -8,6 +8,7 @@
 
 /** Headers *************************************************************/
 #include <Windows.h>
+#include <intrin.h>
 #include <intsafe.h>
 #include <strsafe.h>
 
@@ -21,6 +22,21 @@
 #include "DrinkControl.h"
 #include "Util.h"
 #include "DumpParse.h"
+#include "DumpSynth.h"
+#include "VgaCapture.h"
+#include "VgaDecode.h"
+#include "VgaText.h"
+#include "VgaFingerprint.h"
+#include "VgaThumbnail.h"
+#include "VgaDiff.h"
+#include "VgaEncode.h"
+#include "VgaSynth.h"
+#include "VgaRle.h"
+#include "VgaPng.h"
+#include "VgaStream.h"
+#include "VgaPixmap.h"
+#include "VgaImage.h"
+#include "VgaTty.h"
 #include "Resource.h"
 #include "Debug.h"
 
@@ -38,6 +54,46 @@ STATIC CONST SUBFUNCTION_HANDLER_ENTRY g_atSubfunctionHandlers[] = {
 		&main_HandleConvert
 	},
 
+	{
+		L"dedup",
+		&main_HandleDedup
+	},
+
+	{
+		L"diff",
+		&main_HandleDiff
+	},
+
+	{
+		L"animate",
+		&main_HandleAnimate
+	},
+
+	{
+		L"mosaic",
+		&main_HandleMosaic
+	},
+
+	{
+		L"tags",
+		&main_HandleTags
+	},
+
+	{
+		L"synth",
+		&main_HandleSynth
+	},
+
+	{
+		L"selftest",
+		&main_HandleSelftest
+	},
+
+	{
+		L"bench",
+		&main_HandleBench
+	},
+
 	{
 		L"load",
 		&main_HandleLoad
@@ -59,6 +115,186 @@ STATIC CONST SUBFUNCTION_HANDLER_ENTRY g_atSubfunctionHandlers[] = {
 	},
 };
 
+/**
+ * Array of the options accepted by the "convert" subfunction.
+ */
+STATIC CONST CONVERT_OPTION_ENTRY g_atConvertOptions[] = {
+	{
+		L"--bpp",
+		&main_HandleBitsPerPixelOption
+	},
+
+	{
+		L"--text",
+		&main_HandleTextOption
+	},
+
+	{
+		L"--font",
+		&main_HandleFontOption
+	},
+
+	{
+		L"--thumbnail",
+		&main_HandleThumbnailOption
+	},
+
+	{
+		L"--scale",
+		&main_HandleScaleOption
+	},
+
+	{
+		L"--raw",
+		&main_HandleRawOption
+	},
+
+	{
+		L"--rle",
+		&main_HandleRleOption
+	},
+
+	{
+		L"--format",
+		&main_HandleFormatOption
+	},
+
+	{
+		L"--fingerprint",
+		&main_HandleFingerprintOption
+	},
+
+	{
+		L"--mmap",
+		&main_HandleMappedOption
+	},
+
+	{
+		L"--scratch",
+		&main_HandleScratchOption
+	},
+
+	{
+		L"--tty",
+		&main_HandleTtyOption
+	},
+
+	{
+		L"--index",
+		&main_HandleIndexOption
+	},
+};
+
+/**
+ * Array of the formats the "convert" subfunction writes.
+ * The first is the default.
+ */
+STATIC CONST CONVERT_FORMAT_ENTRY g_atConvertFormats[] = {
+	{
+		L"bmp",
+		CONVERT_FORMAT_BMP,
+		VGA_PIXMAP_FORMATS_COUNT
+	},
+
+	{
+		L"png",
+		CONVERT_FORMAT_PNG,
+		VGA_PIXMAP_FORMATS_COUNT
+	},
+
+	{
+		L"qoi",
+		CONVERT_FORMAT_PIXMAP,
+		VGA_PIXMAP_FORMAT_QOI
+	},
+
+	{
+		L"ppm",
+		CONVERT_FORMAT_PIXMAP,
+		VGA_PIXMAP_FORMAT_PPM
+	},
+
+	{
+		L"pgm",
+		CONVERT_FORMAT_PIXMAP,
+		VGA_PIXMAP_FORMAT_PGM
+	},
+
+	{
+		L"rgba",
+		CONVERT_FORMAT_PIXMAP,
+		VGA_PIXMAP_FORMAT_RGBA
+	},
+};
+
+/**
+ * The format of thumbnails, as --thumbnail writes them.
+ * Not in the table above, so no output is written as one by name.
+ */
+STATIC CONST CONVERT_FORMAT_ENTRY g_tConvertThumbnailFormat = {
+	L"thumbnail",
+	CONVERT_FORMAT_THUMBNAIL,
+	VGA_PIXMAP_FORMATS_COUNT
+};
+
+/**
+ * The encoder of each kind of file the "convert" subfunction writes,
+ * in the order of CONVERT_FORMAT.
+ */
+STATIC CONST PFN_CONVERT_ENCODER g_apfnConvertEncoders[] = {
+	&main_EncodeBitmap,
+	&main_EncodePng,
+	&main_EncodePixmap,
+	&main_EncodeThumbnail,
+};
+C_ASSERT(CONVERT_FORMATS_COUNT == ARRAYSIZE(g_apfnConvertEncoders));
+
+/**
+ * Screen sizes exercised by the "selftest" subfunction.
+ * Mode 12h first, then other common modes,
+ * then widths that don't fill the last byte of each row.
+ */
+STATIC CONST SIZE g_atSelftestGeometries[] = {
+	{ 640, 480 },
+	{ 800, 600 },
+	{ 720, 400 },
+	{ 637, 350 },
+	{ 100, 37 },
+	{ 9, 9 },
+	{ 1, 1 },
+};
+
+/**
+ * Run-length encodings exercised by the "selftest" subfunction.
+ */
+STATIC CONST WORD g_anSelftestRleBitsPerPixel[] = {
+	4,
+	8,
+};
+
+/**
+ * Screen sizes timed by the "bench" subfunction.
+ * The first two have specialized decoders.
+ */
+STATIC CONST SIZE g_atBenchGeometries[] = {
+	{ 640, 480 },
+	{ 800, 600 },
+	{ 637, 350 },
+};
+
+/**
+ * Fingerprint corpora grouped by the "bench" subfunction.
+ * Pairs of close fingerprints were compared one by one,
+ * so many copies of one screen took quadratic time.
+ */
+STATIC CONST BENCH_GROUP_CORPUS g_atBenchGroupCorpora[] = {
+	{ 0, FALSE },
+	{ 20000, FALSE },
+	{ 80000, FALSE },
+	{ 20000, TRUE },
+	{ 80000, TRUE },
+};
+
 
 /** Functions ***********************************************************/
 
@@ -88,7 +324,38 @@ main_PrintUsage(VOID)
 				   pwszExecutableName);
 
 	(VOID)fwprintf(stderr,
-				   L"  convert [input] output\n    Extracts a screenshot from a memory dump.\n");
+				   L"  convert [--bpp=4|8|32] [--thumbnail=file [--scale=n]] [--text [--font=file]] [--raw] [--rle] [--format=name] [--fingerprint] [--mmap [--scratch]] [--index] [input] output [output...]\n  convert --tty[=columns] [--raw | --index] [input]\n    Extracts a screenshot from a memory dump.\n    --bpp=4 writes a 16 color BMP, half the size of the default.\n    --bpp=32 writes a true color BMP instead of a paletted one.\n    --thumbnail also writes a true color BMP n times smaller\n    (default %d) than the screen.\n    --text writes the text on the screen as UTF-8 instead.\n    Graphics mode screens need the font the text was drawn with.\n    --raw reads a capture written by synth instead.\n    --rle run-length encodes a 4bpp or 8bpp BMP.\n    --format writes bmp, png (16 colors), qoi, ppm, pgm or rgba\n    (bare pixels), rather than going by the output's extension.\n    An output of - is the standard output.\n    Once an input is given, more outputs may follow, all written\n    at once from a single decode of the screen.\n    --fingerprint also prints the screen's fingerprint, as dedup does.\n    --mmap sizes each output file up front and writes it through\n    a mapping, decoding BMPs straight into it.\n    --scratch doesn't wait for mapped files to reach the disk.\n    --tty draws the screen on the terminal instead, as wide as\n    the console (default %d columns when it isn't one).\n    --index keeps an index next to the dump, so reading it\n    again only reads its header and the screenshot.\n",
+				   CONVERT_DEFAULT_THUMBNAIL_SCALE,
+				   CONVERT_DEFAULT_TTY_COLUMNS);
+
+	(VOID)fwprintf(stderr,
+				   L"  dedup directory [distance]\n    Groups the dumps and BMPs in a directory by their screens.\n    Screens whose fingerprints differ by up to distance bits\n    (default %d) are duplicates.\n",
+				   DEDUP_DEFAULT_MAX_DISTANCE);
+
+	(VOID)fwprintf(stderr,
+				   L"  diff [--raw] first second [output]\n    Lists the regions of the screen that differ\n    between two memory dumps. If an output is given,\n    writes the second screen to it as a true color BMP,\n    with the changes highlighted.\n    --raw reads captures written by synth instead.\n");
+
+	(VOID)fwprintf(stderr,
+				   L"  animate [--raw] [--delay=n] output first [next...]\n    Writes the screens of several memory dumps to an\n    animated GIF, one frame each, that only redraws\n    what changed between them.\n    --delay shows each frame for n hundredths of a second\n    (default %d).\n    --raw reads captures written by synth instead.\n",
+				   ANIMATE_DEFAULT_DELAY);
+
+	(VOID)fwprintf(stderr,
+				   L"  mosaic [--raw] [--scale=n] [--columns=n] output first [next...]\n    Tiles the screens of many memory dumps in a grid,\n    as thumbnails n times smaller (default %d) than the\n    screens, and writes them to a single true color BMP.\n    --columns puts n tiles in each row, rather than\n    making the grid as square as possible.\n    The first screen sets the size of the tiles.\n    --raw reads captures written by synth instead.\n",
+				   MOSAIC_DEFAULT_SCALE);
+
+	(VOID)fwprintf(stderr,
+				   L"  tags [--index] [input]\n    Prints what a memory dump's headers say, and lists\n    the tagged data bugcheck callbacks saved to it:\n    each record's GUID, where its data is and how big it is.\n    --index reads and keeps the dump's index, as with convert.\n");
+
+	(VOID)fwprintf(stderr,
+				   L"  synth solid|text|noise|bsod width height seed output\n    Generates a synthetic screen and writes it\n    as a raw capture, for convert --raw.\n");
+
+	(VOID)fwprintf(stderr,
+				   L"  selftest [rounds]\n    Round-trips synthetic screens through the planes\n    and checks the decoders, diff and RLE, then reads them\n    back out of synthetic dump files (default %d rounds).\n",
+				   SELFTEST_DEFAULT_ROUNDS);
+
+	(VOID)fwprintf(stderr,
+				   L"  bench [repetitions]\n    Times decoding synthetic screens straight to true color\n    against decoding them and then applying the palette,\n    with every decoder (default %d repetitions), then\n    grouping fingerprints with many copies of one of them.\n",
+				   BENCH_DEFAULT_REPETITIONS);
 
 	(VOID)fwprintf(stderr,
 				   L"  load\n    Loads the driver.\n");
@@ -118,100 +385,148 @@ main_VgaDacEntryToRgb(
 }
 
 STATIC
-BYTE
-main_GetPixelBitFromPlane(
-	_In_	CONST BYTE *	pnPlane,
-	_In_	DWORD			nPixelIndex
+VOID
+main_InitializeBitmapHeaders(
+	_Out_	BITMAPFILEHEADER *	ptFileHeader,
+	_Out_	BITMAPINFOHEADER *	ptInfoHeader,
+	_In_	DWORD				nWidth,
+	_In_	DWORD				nHeight,
+	_In_	WORD				nBitsPerPixel,
+	_In_	DWORD				cbHeaders,
+	_In_	DWORD				cbBitmap
 )
 {
-	BYTE	nByteContainingPixel	= 0;
-	BYTE	nBit					= 0;
+	assert(NULL != ptFileHeader);
+	assert(NULL != ptInfoHeader);
 
-	assert(NULL != pnPlane);
+	// Initialize the file header
+	ptFileHeader->bfType = 'MB';
+	ptFileHeader->bfSize = cbBitmap;
+	ptFileHeader->bfOffBits = cbHeaders;
 
-	// Find the byte containing the pixel data required
-	nByteContainingPixel = pnPlane[nPixelIndex / PIXELS_IN_BYTE];
+	// Initialize the info header
+	ptInfoHeader->biSize = sizeof(*ptInfoHeader);
+	ptInfoHeader->biWidth = (LONG)nWidth;
+	ptInfoHeader->biHeight = -(LONG)nHeight;		// Negative because otherwise the bitmap
+													// is bottom-up :)
+	ptInfoHeader->biPlanes = 1;
+	ptInfoHeader->biBitCount = nBitsPerPixel;
+	ptInfoHeader->biCompression = BI_RGB;
+}
 
-	// Move the relevant bit to be the MSB
-	nBit = nByteContainingPixel;
-	nBit <<= (nPixelIndex % PIXELS_IN_BYTE);
+STATIC
+VOID
+main_GetPixelColors(
+	_In_							PCVGA_CAPTURE_VIEW	ptCapture,
+	_Out_writes_all_(VGA_COLORS)	RGBQUAD *			ptPalette
+)
+{
+	DWORD	nCurrentEntry	= 0;
+	DWORD	nDacEntry		= 0;
 
-	// Move the relevant bit to be the LSB
-	nBit >>= (PIXELS_IN_BYTE - 1);
+	assert(NULL != ptCapture);
+	assert(NULL != ptPalette);
 
-	return nBit;
+	// Only the DAC entries the Attribute Controller maps
+	// the pixel values to are reachable.
+	for (nCurrentEntry = 0;
+		 nCurrentEntry < VGA_COLORS;
+		 ++nCurrentEntry)
+	{
+		nDacEntry = ptCapture->anColorIndices[nCurrentEntry];
+		assert(nDacEntry < ptCapture->nPaletteEntries);
+		ptPalette[nCurrentEntry].rgbRed = main_VgaDacEntryToRgb(ptCapture->ptPaletteEntries[nDacEntry].nRed);
+		ptPalette[nCurrentEntry].rgbGreen = main_VgaDacEntryToRgb(ptCapture->ptPaletteEntries[nDacEntry].nGreen);
+		ptPalette[nCurrentEntry].rgbBlue = main_VgaDacEntryToRgb(ptCapture->ptPaletteEntries[nDacEntry].nBlue);
+		ptPalette[nCurrentEntry].rgbReserved = MAXBYTE;
+	}
 }
 
 STATIC
-HRESULT
-main_VgaDumpToBitmap(
-	_In_		PCVGA_DUMP		ptDump,
-	_Outptr_	PVGA_BITMAP *	pptBitmap
+VOID
+main_GetDacColors(
+	_In_									PCVGA_CAPTURE_VIEW	ptCapture,
+	_Out_writes_(VGA_DAC_PALETTE_ENTRIES)	RGBQUAD *			ptColors
 )
 {
-	HRESULT		hrResult		= E_FAIL;
-	PVGA_BITMAP	ptBitmap		= NULL;
-	DWORD		nCurrentEntry	= 0;
-	DWORD		nCurrentPixel	= 0;
-	DWORD		nCurrentPlane	= 0;
-	BYTE		nCurrentBit		= 0;
+	DWORD	nCurrentEntry	= 0;
+	DWORD	nDacEntry		= 0;
 
-	PROGRESS("Converting raw VGA dump to BMP...");
+	assert(NULL != ptCapture);
+	assert(NULL != ptColors);
 
-	ptBitmap = HEAPALLOC(sizeof(*ptBitmap));
-	if (NULL == ptBitmap)
+	// Pixel values go through the Attribute Controller
+	// before reaching the DAC.
+	for (nCurrentEntry = 0;
+		 nCurrentEntry < ptCapture->nPaletteEntries;
+		 ++nCurrentEntry)
 	{
-		PROGRESS("Oops. Ran out of memory.");
-		hrResult = E_OUTOFMEMORY;
-		goto lblCleanup;
+		nDacEntry = (nCurrentEntry < VGA_COLORS)
+				  ? ptCapture->anColorIndices[nCurrentEntry]
+				  : nCurrentEntry;
+		ptColors[nCurrentEntry].rgbRed = main_VgaDacEntryToRgb(ptCapture->ptPaletteEntries[nDacEntry].nRed);
+		ptColors[nCurrentEntry].rgbGreen = main_VgaDacEntryToRgb(ptCapture->ptPaletteEntries[nDacEntry].nGreen);
+		ptColors[nCurrentEntry].rgbBlue = main_VgaDacEntryToRgb(ptCapture->ptPaletteEntries[nDacEntry].nBlue);
 	}
+}
 
-	PROGRESS("Writing the BMP header.");
+STATIC
+HRESULT
+main_AllocateTrueColorBitmap(
+	_In_		DWORD					nWidth,
+	_In_		DWORD					nHeight,
+	_Outptr_	PVGA_TRUECOLOR_BITMAP *	pptBitmap,
+	_Out_		PDWORD					pcbBitmap
+)
+{
+	HRESULT					hrResult	= E_FAIL;
+	PVGA_TRUECOLOR_BITMAP	ptBitmap	= NULL;
+	DWORD					nPixels		= 0;
+	DWORD					cbPixels	= 0;
+	DWORD					cbBitmap	= 0;
 
-	// Initialize the file header
-	ptBitmap->tFileHeader.bfType = 'MB';
-	ptBitmap->tFileHeader.bfSize = sizeof(*ptBitmap);
-	ptBitmap->tFileHeader.bfOffBits = FIELD_OFFSET(VGA_BITMAP, anPixels);
+	assert(NULL != pptBitmap);
+	assert(NULL != pcbBitmap);
 
-	// Initialize the info header
-	ptBitmap->tInfoHeader.biSize = sizeof(ptBitmap->tInfoHeader);
-	ptBitmap->tInfoHeader.biWidth = SCREEN_WIDTH_PIXELS;
-	ptBitmap->tInfoHeader.biHeight = -SCREEN_HEIGHT_PIXELS;		// Negative because otherwise the bitmap
-																// is bottom-up :)
-	ptBitmap->tInfoHeader.biPlanes = 1;
-	ptBitmap->tInfoHeader.biBitCount = 8;
-	ptBitmap->tInfoHeader.biCompression = BI_RGB;
-
-	// Initialize the color palette
-	PROGRESS("Writing the palette.");
-	for (nCurrentEntry = 0;
-		 nCurrentEntry < ARRAYSIZE(ptBitmap->atColors);
-		 ++nCurrentEntry)
+	hrResult = DWordMult(nWidth, nHeight, &nPixels);
+	if (FAILED(hrResult))
+	{
+		PROGRESS("The image is too big.");
+		goto lblCleanup;
+	}
+	hrResult = DWordMult(nPixels, sizeof(RGBQUAD), &cbPixels);
+	if (FAILED(hrResult))
+	{
+		PROGRESS("The image is too big.");
+		goto lblCleanup;
+	}
+	hrResult = DWordAdd(FIELD_OFFSET(VGA_TRUECOLOR_BITMAP, atPixels), cbPixels, &cbBitmap);
+	if (FAILED(hrResult))
 	{
-		ptBitmap->atColors[nCurrentEntry].rgbRed = main_VgaDacEntryToRgb(ptDump->atPaletteEntries[nCurrentEntry].nRed);
-		ptBitmap->atColors[nCurrentEntry].rgbGreen = main_VgaDacEntryToRgb(ptDump->atPaletteEntries[nCurrentEntry].nGreen);
-		ptBitmap->atColors[nCurrentEntry].rgbBlue = main_VgaDacEntryToRgb(ptDump->atPaletteEntries[nCurrentEntry].nBlue);
+		PROGRESS("The image is too big.");
+		goto lblCleanup;
 	}
 
-	// Set the pixel values
-	PROGRESS("Writing the pixel data.");
-	for (nCurrentPixel = 0;
-		 nCurrentPixel < ARRAYSIZE(ptBitmap->anPixels);
-		 ++nCurrentPixel)
+	ptBitmap = HEAPALLOC(cbBitmap);
+	if (NULL == ptBitmap)
 	{
-		for (nCurrentPlane = 0;
-			 nCurrentPlane < ARRAYSIZE(ptDump->atPlanes);
-			 ++nCurrentPlane)
-		{
-			nCurrentBit = main_GetPixelBitFromPlane(ptDump->atPlanes[nCurrentPlane],
-													nCurrentPixel);
-			ptBitmap->anPixels[nCurrentPixel] |= nCurrentBit << nCurrentPlane;
-		}
+		PROGRESS("Oops. Ran out of memory.");
+		hrResult = E_OUTOFMEMORY;
+		goto lblCleanup;
 	}
 
+	main_InitializeBitmapHeaders(&ptBitmap->tFileHeader,
+								 &ptBitmap->tInfoHeader,
+								 nWidth,
+								 nHeight,
+								 32,
+								 FIELD_OFFSET(VGA_TRUECOLOR_BITMAP, atPixels),
+								 cbBitmap);
+
 	// Transfer ownership:
 	*pptBitmap = ptBitmap;
 	ptBitmap = NULL;
+	*pcbBitmap = cbBitmap;
 
 	hrResult = S_OK;
 
@@ -223,114 +538,5045 @@ lblCleanup:
 
 STATIC
 HRESULT
-main_HandleConvert(
-	_In_					INT				nArguments,
-	_In_reads_(nArguments)	CONST PCWSTR *	ppwszArguments
+main_AllocateThumbnail(
+	_In_		PCVGA_CAPTURE_VIEW		ptCapture,
+	_In_		DWORD					nScale,
+	_Outptr_	PVGA_TRUECOLOR_BITMAP *	pptThumbnail,
+	_Out_		PDWORD					pcbThumbnail
 )
 {
-	HRESULT		hrResult		= E_FAIL;
-	PCWSTR		pwszDumpPath	= NULL;
-	PCWSTR		pwszOutputPath	= NULL;
-	HDUMP		hDump			= NULL;
-	PVGA_DUMP	ptDump			= NULL;
-	DWORD		cbDump			= 0;
-	PVGA_BITMAP	ptBitmap		= NULL;
-	HANDLE		hOutputFile		= INVALID_HANDLE_VALUE;
-	DWORD		cbWritten		= 0;
+	HRESULT	hrResult	= E_FAIL;
+	DWORD	nWidth		= 0;
+	DWORD	nHeight		= 0;
 
-	assert(NULL != ppwszArguments);
+	assert(NULL != ptCapture);
+	assert(NULL != pptThumbnail);
+	assert(NULL != pcbThumbnail);
+
+	hrResult = VGATHUMBNAIL_GetSize(ptCapture, nScale, &nWidth, &nHeight);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	PROGRESS("Also writing a %lux%lu thumbnail.", nWidth, nHeight);
+	hrResult = main_AllocateTrueColorBitmap(nWidth, nHeight, pptThumbnail, pcbThumbnail);
+
+lblCleanup:
+	return hrResult;
+}
+
+STATIC
+DWORD
+main_GetBandRows(
+	_In_	PCVGA_CAPTURE_VIEW	ptCapture,
+	_In_	DWORD				cbRow
+)
+{
+	DWORD	nBandRows	= 0;
+
+	assert(NULL != ptCapture);
+	assert(0 != cbRow);
+
+	nBandRows = max(CONVERT_BAND_SIZE / cbRow, 1);
+	if (VGA_CAPTURE_MODE_TEXT == ptCapture->eMode)
+	{
+		nBandRows = max(nBandRows / ptCapture->tText.nCharHeight, 1) * ptCapture->tText.nCharHeight;
+	}
+
+	return min(nBandRows, ptCapture->nHeight);
+}
+
+STATIC
+CONST BYTE *
+main_GetBand(
+	_In_						PCVGA_CAPTURE_VIEW	ptCapture,
+	_In_opt_					PCVGA_IMAGE			ptImage,
+	_In_						DWORD				nRow,
+	_In_						DWORD				nRows,
+	_In_						WORD				nBitsPerPixel,
+	_Out_writes_(cbRow * nRows)	PBYTE				pnBuffer,
+	_In_						DWORD				cbRow
+)
+{
+	VGA_TEXT_SCREEN	tBand					= { 0 };
+	CONST BYTE *	apnPlanes[VGA_PLANES]	= { NULL };
+	DWORD			nPlane					= 0;
+	CONST BYTE *	pnBand					= pnBuffer;
+
+	assert(NULL != ptCapture);
+	assert(nRow + nRows <= ptCapture->nHeight);
+	assert((4 == nBitsPerPixel) || (8 == nBitsPerPixel));
+	assert(NULL != pnBuffer);
+
+	if ((NULL != ptImage) && (8 == nBitsPerPixel))
+	{
+		// The image's rows are already as the band has them.
+		assert(cbRow == ptImage->cbStride);
+		pnBand = ptImage->anPixels + (nRow * ptImage->cbStride);
+	}
+	else if (NULL != ptImage)
+	{
+		VGAIMAGE_PackRows(ptImage, nRow, nRows, pnBuffer, cbRow);
+	}
+	else if (VGA_CAPTURE_MODE_TEXT == ptCapture->eMode)
+	{
+		assert(0 == nRow % ptCapture->tText.nCharHeight);
+		assert(0 == nRows % ptCapture->tText.nCharHeight);
+
+		// The band is a smaller screen of its own.
+		tBand = ptCapture->tText;
+		tBand.pnText += (nRow / tBand.nCharHeight) * tBand.nColumns * VGA_TEXT_CELL_BYTES;
+		tBand.nRows = nRows / tBand.nCharHeight;
+		if (4 == nBitsPerPixel)
+		{
+			VGADECODE_RenderTextToNibbles(&tBand, pnBuffer, cbRow);
+		}
+		else
+		{
+			VGADECODE_RenderText(&tBand, pnBuffer, cbRow);
+		}
+	}
+	else
+	{
+		for (nPlane = 0; nPlane < VGA_PLANES; ++nPlane)
+		{
+			apnPlanes[nPlane] = ptCapture->apnPlanes[nPlane] + (nRow * ptCapture->cbStride);
+		}
+		if (4 == nBitsPerPixel)
+		{
+			VGADECODE_DecodeImageToNibbles(apnPlanes,
+										   ptCapture->cbStride,
+										   ptCapture->nWidth,
+										   nRows,
+										   pnBuffer,
+										   cbRow);
+		}
+		else
+		{
+			VGADECODE_DecodeImage(apnPlanes,
+								  ptCapture->cbStride,
+								  ptCapture->nWidth,
+								  nRows,
+								  pnBuffer,
+								  cbRow,
+								  NULL);
+		}
+	}
+
+	return pnBand;
+}
 
-	switch (nArguments)
+STATIC
+HRESULT
+main_VgaDumpToStreamedBitmap(
+	_In_		PCVGA_CAPTURE_VIEW	ptCapture,
+	_In_opt_	PCVGA_IMAGE			ptImage,
+	_In_		WORD				nBitsPerPixel,
+	_In_		HVGASTREAM			hStream
+)
+{
+	HRESULT				hrResult							= E_FAIL;
+	HVGAPIXMAP			hPixmap								= NULL;
+	RGBQUAD				atPalette[VGA_COLORS]				= { { 0 } };
+	BITMAPFILEHEADER	tFileHeader							= { 0 };
+	BITMAPINFOHEADER	tInfoHeader							= { 0 };
+	RGBQUAD				atColors[VGA_DAC_PALETTE_ENTRIES]	= { { 0 } };
+	DWORD				cbHeaders							= 0;
+	DWORD				cbColors							= 0;
+	DWORD				cbRow								= 0;
+	DWORD				cbPixels							= 0;
+	DWORD				cbBitmap							= 0;
+	WORD				nBandBitsPerPixel					= 0;
+	DWORD				cbBandRow							= 0;
+	DWORD				nBandRows							= 0;
+	DWORD				cbBand								= 0;
+	PBYTE				pnBand								= NULL;
+	CONST BYTE *		pnRows								= NULL;
+	PBYTE				pnSpace								= NULL;
+	DWORD				cbSpace								= 0;
+	DWORD				nRow								= 0;
+	DWORD				nRows								= 0;
+	DWORD				nBandRow							= 0;
+	DWORD				nCurrentEntry						= 0;
+	DWORD64				nStartTime							= 0;
+	DWORD64				nCycles								= 0;
+	DWORD64				nPixels								= 0;
+
+	assert(NULL != ptCapture);
+	assert((4 == nBitsPerPixel) || (8 == nBitsPerPixel) || (32 == nBitsPerPixel));
+	assert(NULL != hStream);
+
+	PROGRESS("Converting raw VGA dump to %ubpp BMP...", nBitsPerPixel);
+
+	// BMP rows are padded to a multiple of 4 bytes.
+	// 32bpp rows are decoded to 8bpp, and colored as they're written.
+	switch (nBitsPerPixel)
 	{
-	case SUBFUNCTION_CONVERT_NO_INPUT_ARGS_COUNT:
-		pwszOutputPath = ppwszArguments[SUBFUNCTION_CONVERT_NO_INPUT_ARG_OUTPUT];
-		PROGRESS("Converting system memory dump to '%S'.", pwszOutputPath);
+	case 4:
+		cbHeaders = FIELD_OFFSET(VGA_PACKED_BITMAP, anPixels);
+		cbRow = ((ptCapture->nWidth + 7) / PIXELS_IN_BYTE) * sizeof(DWORD);
+		nBandBitsPerPixel = 4;
+		cbBandRow = cbRow;
 		break;
 
-	case SUBFUNCTION_CONVERT_ARGS_COUNT:
-		pwszDumpPath = ppwszArguments[SUBFUNCTION_CONVERT_ARG_INPUT];
-		pwszOutputPath = ppwszArguments[SUBFUNCTION_CONVERT_ARG_OUTPUT];
-		PROGRESS("Converting dump '%S' to '%S'.", pwszDumpPath, pwszOutputPath);
+	case 8:
+		cbHeaders = FIELD_OFFSET(VGA_BITMAP, anPixels);
+		cbRow = (ptCapture->nWidth + 3) & ~3UL;
+		nBandBitsPerPixel = 8;
+		cbBandRow = cbRow;
 		break;
 
 	default:
-		PROGRESS("Invalid number of arguments specified.");
-		hrResult = E_INVALIDARG;
+		cbHeaders = FIELD_OFFSET(VGA_TRUECOLOR_BITMAP, atPixels);
+		cbRow = ptCapture->nWidth * sizeof(RGBQUAD);
+		nBandBitsPerPixel = 8;
+		cbBandRow = (ptCapture->nWidth + 3) & ~3UL;
+		break;
+	}
+	hrResult = DWordMult(cbRow, ptCapture->nHeight, &cbPixels);
+	if (FAILED(hrResult))
+	{
+		PROGRESS("The image is too big.");
 		goto lblCleanup;
 	}
-
-	hrResult = DUMPPARSE_Open(pwszDumpPath, &hDump);
+	hrResult = DWordAdd(cbHeaders, cbPixels, &cbBitmap);
 	if (FAILED(hrResult))
 	{
-		PROGRESS("Failed opening the dump file.");
+		PROGRESS("The image is too big.");
 		goto lblCleanup;
 	}
 
-	hrResult = DUMPPARSE_ReadTagged(hDump,
-									&g_tVgaDumpGuid,
-									&ptDump,
-									&cbDump);
+	nBandRows = main_GetBandRows(ptCapture, cbBandRow);
+	hrResult = DWordMult(cbBandRow, nBandRows, &cbBand);
 	if (FAILED(hrResult))
 	{
-		PROGRESS("Failed reading saved bugcheck screenshot. Did you save it?");
+		PROGRESS("The image is too big.");
 		goto lblCleanup;
 	}
-	if (sizeof(*ptDump) != cbDump)
+
+	pnBand = HEAPALLOC(cbBand);
+	if (NULL == pnBand)
 	{
-		PROGRESS("The stored screenshot has a weird size.");
-		hrResult = HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+		PROGRESS("Oops. Ran out of memory.");
+		hrResult = E_OUTOFMEMORY;
 		goto lblCleanup;
 	}
 
-	hrResult = main_VgaDumpToBitmap(ptDump, &ptBitmap);
+	hrResult = VGASTREAM_Map(hStream, cbBitmap);
 	if (FAILED(hrResult))
 	{
-		PROGRESS("Failed converting raw VGA dump to BMP.");
+		PROGRESS("Failed mapping the output file.");
 		goto lblCleanup;
 	}
 
-	hOutputFile = CreateFileW(pwszOutputPath,
-							  GENERIC_WRITE,
-							  0,
-							  NULL,
-							  CREATE_ALWAYS,
-							  FILE_ATTRIBUTE_NORMAL,
-							  NULL);
-	if (INVALID_HANDLE_VALUE == hOutputFile)
-	{
-		PROGRESS("Failed creating the output file.");
+	PROGRESS("Writing the BMP header.");
+	main_InitializeBitmapHeaders(&tFileHeader,
+								 &tInfoHeader,
+								 ptCapture->nWidth,
+								 ptCapture->nHeight,
+								 nBitsPerPixel,
+								 cbHeaders,
+								 cbBitmap);
+	hrResult = VGASTREAM_Write(hStream, &tFileHeader, sizeof(tFileHeader));
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+	hrResult = VGASTREAM_Write(hStream, &tInfoHeader, sizeof(tInfoHeader));
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	// At 4bpp, only the VGA_COLORS pixel values have palette entries,
+	// and 32bpp bitmaps have none.
+	main_GetPixelColors(ptCapture, atPalette);
+	cbColors = cbHeaders - sizeof(tFileHeader) - sizeof(tInfoHeader);
+	if (8 == nBitsPerPixel)
+	{
+		main_GetDacColors(ptCapture, atColors);
+	}
+	else
+	{
+		for (nCurrentEntry = 0; nCurrentEntry < VGA_COLORS; ++nCurrentEntry)
+		{
+			atColors[nCurrentEntry] = atPalette[nCurrentEntry];
+			atColors[nCurrentEntry].rgbReserved = 0;
+		}
+	}
+	if (0 != cbColors)
+	{
+		PROGRESS("Writing the palette.");
+		hrResult = VGASTREAM_Write(hStream, atColors, cbColors);
+		if (FAILED(hrResult))
+		{
+			goto lblCleanup;
+		}
+	}
+
+	if (32 == nBitsPerPixel)
+	{
+		hrResult = VGAPIXMAP_Create(VGA_PIXMAP_FORMAT_BGRA,
+									ptCapture->nWidth,
+									ptCapture->nHeight,
+									atPalette,
+									hStream,
+									&hPixmap);
+		if (FAILED(hrResult))
+		{
+			goto lblCleanup;
+		}
+	}
+
+	PROGRESS("Writing the pixel data (%s decoder).", VGADECODE_GetBackendName());
+	nStartTime = __rdtsc();
+	for (nRow = 0; nRow < ptCapture->nHeight; nRow += nRows)
+	{
+		nRows = min(nBandRows, ptCapture->nHeight - nRow);
+
+		// Paletted rows are already as the BMP has them,
+		// so a mapped file can have them decoded right into it.
+		if ((NULL == hPixmap) && VGASTREAM_IsMapped(hStream))
+		{
+			hrResult = VGASTREAM_Reserve(hStream, cbBandRow * nRows, &pnSpace, &cbSpace);
+			if (SUCCEEDED(hrResult))
+			{
+				pnRows = main_GetBand(ptCapture, ptImage, nRow, nRows, nBandBitsPerPixel, pnSpace, cbBandRow);
+				if (pnRows != pnSpace)
+				{
+					CopyMemory(pnSpace, pnRows, cbBandRow * nRows);
+				}
+				VGASTREAM_Commit(hStream, cbBandRow * nRows);
+			}
+		}
+		else if (NULL == hPixmap)
+		{
+			pnRows = main_GetBand(ptCapture, ptImage, nRow, nRows, nBandBitsPerPixel, pnBand, cbBandRow);
+			hrResult = VGASTREAM_Write(hStream, pnRows, cbBandRow * nRows);
+		}
+		else
+		{
+			pnRows = main_GetBand(ptCapture, ptImage, nRow, nRows, nBandBitsPerPixel, pnBand, cbBandRow);
+			for (nBandRow = 0; nBandRow < nRows; ++nBandRow)
+			{
+				hrResult = VGAPIXMAP_WriteRow(hPixmap, pnRows + (nBandRow * cbBandRow));
+				if (FAILED(hrResult))
+				{
+					break;
+				}
+			}
+		}
+		if (FAILED(hrResult))
+		{
+			PROGRESS("Failed writing rows %lu-%lu.", nRow, nRow + nRows - 1);
+			goto lblCleanup;
+		}
+	}
+	if (NULL != hPixmap)
+	{
+		hrResult = VGAPIXMAP_Finish(hPixmap);
+		if (FAILED(hrResult))
+		{
+			goto lblCleanup;
+		}
+	}
+	nCycles = __rdtsc() - nStartTime;
+	nPixels = max((DWORD64)ptCapture->nWidth * ptCapture->nHeight, 1);
+	PROGRESS("Decoded and wrote %I64u bytes in %I64u cycles (%I64u.%02I64u cycles per pixel).",
+			 VGASTREAM_GetSize(hStream),
+			 nCycles,
+			 nCycles / nPixels,
+			 (nCycles * 100 / nPixels) % 100);
+
+	hrResult = S_OK;
+
+lblCleanup:
+	VGAPIXMAP_Destroy(hPixmap);
+	HEAPFREE(pnBand);
+
+	return hrResult;
+}
+
+STATIC
+HRESULT
+main_VgaDumpToCompressedBitmap(
+	_In_									PCVGA_CAPTURE_VIEW	ptCapture,
+	_In_opt_								PCVGA_IMAGE			ptImage,
+	_In_									WORD				nBitsPerPixel,
+	_Outptr_result_bytebuffer_(*pcbBitmap)	PVOID *				ppvBitmap,
+	_Out_									PDWORD				pcbBitmap
+)
+{
+	HRESULT		hrResult							= E_FAIL;
+	PVGA_IMAGE	ptDecoded							= NULL;
+	RGBQUAD		atColors[VGA_DAC_PALETTE_ENTRIES]	= { { 0 } };
+	PBYTE		pnData								= NULL;
+	DWORD		cbData								= 0;
+	PVGA_BITMAP	ptBitmap							= NULL;
+	DWORD		cbHeaders							= 0;
+	DWORD		cbBitmap							= 0;
+	DWORD64		nStartTime							= 0;
+	DWORD64		nCycles								= 0;
+	DWORD64		nPixels								= 0;
+
+	assert(NULL != ptCapture);
+	assert((4 == nBitsPerPixel) || (8 == nBitsPerPixel));
+	assert(NULL != ppvBitmap);
+	assert(NULL != pcbBitmap);
+
+	PROGRESS("Converting raw VGA dump to RLE%u BMP...", nBitsPerPixel);
+
+	// The runs are found in whole decoded rows.
+	if (NULL == ptImage)
+	{
+		hrResult = VGAIMAGE_Decode(ptCapture, &ptDecoded);
+		if (FAILED(hrResult))
+		{
+			goto lblCleanup;
+		}
+		ptImage = ptDecoded;
+	}
+
+	PROGRESS("Compressing the pixel data (RLE%u).", nBitsPerPixel);
+	nStartTime = __rdtsc();
+	hrResult = VGARLE_Compress(ptImage->anPixels,
+							   ptImage->cbStride,
+							   ptImage->nWidth,
+							   ptImage->nHeight,
+							   nBitsPerPixel,
+							   &pnData,
+							   &cbData);
+	nCycles = __rdtsc() - nStartTime;
+	if (FAILED(hrResult))
+	{
+		PROGRESS("Failed compressing the pixel data.");
+		goto lblCleanup;
+	}
+	nPixels = max((DWORD64)ptCapture->nWidth * ptCapture->nHeight, 1);
+	PROGRESS("Compressed %lu bytes of pixels to %lu in %I64u cycles (%I64u.%02I64u cycles per pixel).",
+			 ptImage->cbStride * ptImage->nHeight,
+			 cbData,
+			 nCycles,
+			 nCycles / nPixels,
+			 (nCycles * 100 / nPixels) % 100);
+
+	// At 4bpp, only the VGA_COLORS pixel values keep their palette entries.
+	cbHeaders = (4 == nBitsPerPixel)
+			  ? FIELD_OFFSET(VGA_PACKED_BITMAP, anPixels)
+			  : FIELD_OFFSET(VGA_BITMAP, anPixels);
+	hrResult = DWordAdd(cbHeaders, cbData, &cbBitmap);
+	if (FAILED(hrResult))
+	{
+		PROGRESS("The image is too big.");
+		goto lblCleanup;
+	}
+
+	ptBitmap = HEAPALLOC(cbBitmap);
+	if (NULL == ptBitmap)
+	{
+		PROGRESS("Oops. Ran out of memory.");
+		hrResult = E_OUTOFMEMORY;
+		goto lblCleanup;
+	}
+
+	// Compressed bitmaps can't be top-down.
+	PROGRESS("Writing the BMP header.");
+	main_InitializeBitmapHeaders(&ptBitmap->tFileHeader,
+								 &ptBitmap->tInfoHeader,
+								 ptCapture->nWidth,
+								 ptCapture->nHeight,
+								 nBitsPerPixel,
+								 cbHeaders,
+								 cbBitmap);
+	ptBitmap->tInfoHeader.biHeight = (LONG)ptCapture->nHeight;
+	ptBitmap->tInfoHeader.biCompression = (4 == nBitsPerPixel) ? BI_RLE4 : BI_RLE8;
+	ptBitmap->tInfoHeader.biSizeImage = cbData;
+
+	PROGRESS("Writing the palette.");
+	main_GetDacColors(ptCapture, atColors);
+	CopyMemory(ptBitmap->atColors, atColors, cbHeaders - FIELD_OFFSET(VGA_BITMAP, atColors));
+	CopyMemory((PBYTE)ptBitmap + cbHeaders, pnData, cbData);
+
+	// Transfer ownership:
+	*ppvBitmap = ptBitmap;
+	ptBitmap = NULL;
+	*pcbBitmap = cbBitmap;
+
+	hrResult = S_OK;
+
+lblCleanup:
+	HEAPFREE(ptBitmap);
+	HEAPFREE(pnData);
+	HEAPFREE(ptDecoded);
+
+	return hrResult;
+}
+
+STATIC
+HRESULT
+main_VgaDumpToPng(
+	_In_								PCVGA_CAPTURE_VIEW	ptCapture,
+	_In_opt_							PCVGA_IMAGE			ptImage,
+	_Outptr_result_bytebuffer_(*pcbPng)	PBYTE *				ppnPng,
+	_Out_								PDWORD				pcbPng
+)
+{
+	HRESULT			hrResult				= E_FAIL;
+	HVGAPNG			hPng					= NULL;
+	RGBQUAD			atPalette[VGA_COLORS]	= { { 0 } };
+	DWORD			cbRow					= 0;
+	DWORD			nBandRows				= 0;
+	DWORD			cbPixels				= 0;
+	PBYTE			pnPixels				= NULL;
+	CONST BYTE *	pnRows					= NULL;
+	DWORD			nRow					= 0;
+	DWORD			nRows					= 0;
+	DWORD			nBandRow				= 0;
+	PBYTE			pnPng					= NULL;
+	DWORD			cbPng					= 0;
+	DWORD64			nStartTime				= 0;
+	DWORD64			nCycles					= 0;
+	DWORD64			nPixels					= 0;
+
+	assert(NULL != ptCapture);
+	assert(NULL != ppnPng);
+	assert(NULL != pcbPng);
+
+	PROGRESS("Converting raw VGA dump to PNG...");
+
+	cbRow = ((ptCapture->nWidth + 7) / PIXELS_IN_BYTE) * sizeof(DWORD);
+	nBandRows = main_GetBandRows(ptCapture, cbRow);
+	hrResult = DWordMult(cbRow, nBandRows, &cbPixels);
+	if (FAILED(hrResult))
+	{
+		PROGRESS("The image is too big.");
+		goto lblCleanup;
+	}
+
+	pnPixels = HEAPALLOC(cbPixels);
+	if (NULL == pnPixels)
+	{
+		PROGRESS("Oops. Ran out of memory.");
+		hrResult = E_OUTOFMEMORY;
+		goto lblCleanup;
+	}
+
+	main_GetPixelColors(ptCapture, atPalette);
+	hrResult = VGAPNG_Create(ptCapture->nWidth, ptCapture->nHeight, atPalette, &hPng);
+	if (FAILED(hrResult))
+	{
+		PROGRESS("Failed starting the PNG.");
+		goto lblCleanup;
+	}
+
+	PROGRESS("Writing the pixel data.");
+	nStartTime = __rdtsc();
+	for (nRow = 0; nRow < ptCapture->nHeight; nRow += nRows)
+	{
+		nRows = min(nBandRows, ptCapture->nHeight - nRow);
+		pnRows = main_GetBand(ptCapture, ptImage, nRow, nRows, 4, pnPixels, cbRow);
+
+		for (nBandRow = 0; nBandRow < nRows; ++nBandRow)
+		{
+			hrResult = VGAPNG_WriteRow(hPng, pnRows + (nBandRow * cbRow));
+			if (FAILED(hrResult))
+			{
+				PROGRESS("Failed compressing row %lu.", nRow + nBandRow);
+				goto lblCleanup;
+			}
+		}
+	}
+
+	hrResult = VGAPNG_Finish(hPng, &pnPng, &cbPng);
+	if (FAILED(hrResult))
+	{
+		PROGRESS("Failed finishing the PNG.");
+		goto lblCleanup;
+	}
+	nCycles = __rdtsc() - nStartTime;
+	nPixels = max((DWORD64)ptCapture->nWidth * ptCapture->nHeight, 1);
+	PROGRESS("Decoded and compressed to %lu bytes in %I64u cycles (%I64u.%02I64u cycles per pixel).",
+			 cbPng,
+			 nCycles,
+			 nCycles / nPixels,
+			 (nCycles * 100 / nPixels) % 100);
+
+	// Transfer ownership:
+	*ppnPng = pnPng;
+	pnPng = NULL;
+	*pcbPng = cbPng;
+
+	hrResult = S_OK;
+
+lblCleanup:
+	HEAPFREE(pnPng);
+	VGAPNG_Destroy(hPng);
+	HEAPFREE(pnPixels);
+
+	return hrResult;
+}
+
+STATIC
+HRESULT
+main_VgaDumpToPixmap(
+	_In_		PCVGA_CAPTURE_VIEW	ptCapture,
+	_In_opt_	PCVGA_IMAGE			ptImage,
+	_In_		VGA_PIXMAP_FORMAT	eFormat,
+	_In_		HVGASTREAM			hStream
+)
+{
+	HRESULT			hrResult				= E_FAIL;
+	HVGAPIXMAP		hPixmap					= NULL;
+	RGBQUAD			atPalette[VGA_COLORS]	= { { 0 } };
+	DWORD			cbRow					= 0;
+	DWORD			nBandRows				= 0;
+	DWORD			cbPixels				= 0;
+	PBYTE			pnPixels				= NULL;
+	CONST BYTE *	pnRows					= NULL;
+	DWORD			nRow					= 0;
+	DWORD			nRows					= 0;
+	DWORD			nBandRow				= 0;
+	DWORD64			nStartTime				= 0;
+	DWORD64			nCycles					= 0;
+	DWORD64			nPixels					= 0;
+
+	assert(NULL != ptCapture);
+	assert(NULL != hStream);
+
+	PROGRESS("Converting raw VGA dump to a %lux%lu pixmap...", ptCapture->nWidth, ptCapture->nHeight);
+
+	cbRow = (ptCapture->nWidth + 3) & ~3UL;
+	nBandRows = main_GetBandRows(ptCapture, cbRow);
+	hrResult = DWordMult(cbRow, nBandRows, &cbPixels);
+	if (FAILED(hrResult))
+	{
+		PROGRESS("The image is too big.");
+		goto lblCleanup;
+	}
+
+	pnPixels = HEAPALLOC(cbPixels);
+	if (NULL == pnPixels)
+	{
+		PROGRESS("Oops. Ran out of memory.");
+		hrResult = E_OUTOFMEMORY;
+		goto lblCleanup;
+	}
+
+	main_GetPixelColors(ptCapture, atPalette);
+	hrResult = VGAPIXMAP_Create(eFormat,
+								ptCapture->nWidth,
+								ptCapture->nHeight,
+								atPalette,
+								hStream,
+								&hPixmap);
+	if (FAILED(hrResult))
+	{
+		PROGRESS("Failed starting the pixmap.");
+		goto lblCleanup;
+	}
+
+	PROGRESS("Writing the pixel data.");
+	nStartTime = __rdtsc();
+	for (nRow = 0; nRow < ptCapture->nHeight; nRow += nRows)
+	{
+		nRows = min(nBandRows, ptCapture->nHeight - nRow);
+		pnRows = main_GetBand(ptCapture, ptImage, nRow, nRows, 8, pnPixels, cbRow);
+
+		for (nBandRow = 0; nBandRow < nRows; ++nBandRow)
+		{
+			hrResult = VGAPIXMAP_WriteRow(hPixmap, pnRows + (nBandRow * cbRow));
+			if (FAILED(hrResult))
+			{
+				PROGRESS("Failed writing row %lu.", nRow + nBandRow);
+				goto lblCleanup;
+			}
+		}
+	}
+
+	hrResult = VGAPIXMAP_Finish(hPixmap);
+	if (FAILED(hrResult))
+	{
+		PROGRESS("Failed finishing the pixmap.");
+		goto lblCleanup;
+	}
+	nCycles = __rdtsc() - nStartTime;
+	nPixels = max((DWORD64)ptCapture->nWidth * ptCapture->nHeight, 1);
+	PROGRESS("Decoded and wrote %I64u bytes in %I64u cycles (%I64u.%02I64u cycles per pixel).",
+			 VGASTREAM_GetSize(hStream),
+			 nCycles,
+			 nCycles / nPixels,
+			 (nCycles * 100 / nPixels) % 100);
+
+	hrResult = S_OK;
+
+lblCleanup:
+	VGAPIXMAP_Destroy(hPixmap);
+	HEAPFREE(pnPixels);
+
+	return hrResult;
+}
+
+STATIC
+HRESULT
+main_VgaDumpToTrueColorBitmap(
+	_In_			PCVGA_CAPTURE_VIEW		ptCapture,
+	_In_			DWORD					nThumbnailScale,
+	_Outptr_		PVGA_TRUECOLOR_BITMAP *	pptBitmap,
+	_Out_			PDWORD					pcbBitmap,
+	_Outptr_opt_	PVGA_TRUECOLOR_BITMAP *	pptThumbnail,
+	_Out_opt_		PDWORD					pcbThumbnail
+)
+{
+	HRESULT					hrResult				= E_FAIL;
+	PVGA_TRUECOLOR_BITMAP	ptBitmap				= NULL;
+	DWORD					cbBitmap				= 0;
+	PVGA_TRUECOLOR_BITMAP	ptThumbnail				= NULL;
+	DWORD					cbThumbnail				= 0;
+	RGBQUAD					atPalette[VGA_COLORS]	= { { 0 } };
+	DWORD					nPixels					= 0;
+	DWORD64					nStartTime				= 0;
+	DWORD64					nCycles					= 0;
+	RECT					tContent				= { 0 };
+
+	assert(NULL != ptCapture);
+	assert(NULL != pptBitmap);
+	assert(NULL != pcbBitmap);
+	assert((NULL == pptThumbnail) || (NULL != pcbThumbnail));
+
+	PROGRESS("Converting raw VGA dump to true color BMP...");
+
+	PROGRESS("Writing the BMP header.");
+	hrResult = main_AllocateTrueColorBitmap(ptCapture->nWidth,
+											ptCapture->nHeight,
+											&ptBitmap,
+											&cbBitmap);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	if (NULL != pptThumbnail)
+	{
+		hrResult = main_AllocateThumbnail(ptCapture, nThumbnailScale, &ptThumbnail, &cbThumbnail);
+		if (FAILED(hrResult))
+		{
+			goto lblCleanup;
+		}
+	}
+
+	// That's all the decoder needs.
+	main_GetPixelColors(ptCapture, atPalette);
+
+	// Set the pixel values
+	PROGRESS("Writing the pixel data (%s decoder).", VGADECODE_GetBackendName());
+	nStartTime = __rdtsc();
+	if (NULL != ptThumbnail)
+	{
+		hrResult = VGATHUMBNAIL_Render(ptCapture,
+									   atPalette,
+									   nThumbnailScale,
+									   ptThumbnail->atPixels,
+									   NULL,
+									   0,
+									   ptBitmap->atPixels);
+		if (FAILED(hrResult))
+		{
+			PROGRESS("Failed rendering the thumbnail.");
+			goto lblCleanup;
+		}
+	}
+	else if (VGA_CAPTURE_MODE_TEXT == ptCapture->eMode)
+	{
+		VGADECODE_RenderTextToColor(&ptCapture->tText,
+									atPalette,
+									ptBitmap->atPixels);
+	}
+	else
+	{
+		VGADECODE_DecodeImageToColor(ptCapture->apnPlanes,
+									 ptCapture->cbStride,
+									 ptCapture->nWidth,
+									 ptCapture->nHeight,
+									 atPalette,
+									 ptBitmap->atPixels,
+									 &tContent);
+	}
+	nCycles = __rdtsc() - nStartTime;
+	nPixels = ptCapture->nWidth * ptCapture->nHeight;
+	PROGRESS("Decoded in %I64u cycles (%I64u.%02I64u cycles per pixel).",
+			 nCycles,
+			 nCycles / nPixels,
+			 (nCycles * 100 / nPixels) % 100);
+	if (tContent.bottom > tContent.top)
+	{
+		PROGRESS("Content spans (%ld,%ld)-(%ld,%ld).",
+				 tContent.left,
+				 tContent.top,
+				 tContent.right,
+				 tContent.bottom);
+	}
+
+	// Transfer ownership:
+	*pptBitmap = ptBitmap;
+	ptBitmap = NULL;
+	*pcbBitmap = cbBitmap;
+	if (NULL != pptThumbnail)
+	{
+		*pptThumbnail = ptThumbnail;
+		ptThumbnail = NULL;
+		*pcbThumbnail = cbThumbnail;
+	}
+
+	hrResult = S_OK;
+
+lblCleanup:
+	HEAPFREE(ptThumbnail);
+	HEAPFREE(ptBitmap);
+
+	return hrResult;
+}
+
+STATIC
+HRESULT
+main_HandleBitsPerPixelOption(
+	_In_opt_	PCWSTR				pwszValue,
+	_Inout_		PCONVERT_OPTIONS	ptOptions
+)
+{
+	HRESULT	hrResult		= E_FAIL;
+	PWSTR	pwszValueEnd	= NULL;
+	ULONG	nBitsPerPixel	= 0;
+
+	assert(NULL != ptOptions);
+
+	if (NULL == pwszValue)
+	{
+		PROGRESS("No bits per pixel specified.");
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+
+	nBitsPerPixel = wcstoul(pwszValue, &pwszValueEnd, 10);
+	if ((pwszValueEnd == pwszValue) ||
+		(L'\0' != *pwszValueEnd) ||
+		((4 != nBitsPerPixel) && (8 != nBitsPerPixel) && (32 != nBitsPerPixel)))
+	{
+		PROGRESS("Unsupported bits per pixel '%S'.", pwszValue);
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+
+	ptOptions->nBitsPerPixel = (WORD)nBitsPerPixel;
+
+	hrResult = S_OK;
+
+lblCleanup:
+	return hrResult;
+}
+
+STATIC
+HRESULT
+main_HandleTextOption(
+	_In_opt_	PCWSTR				pwszValue,
+	_Inout_		PCONVERT_OPTIONS	ptOptions
+)
+{
+	HRESULT	hrResult	= E_FAIL;
+
+	assert(NULL != ptOptions);
+
+	if (NULL != pwszValue)
+	{
+		PROGRESS("The text option takes no value.");
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+
+	ptOptions->bText = TRUE;
+
+	hrResult = S_OK;
+
+lblCleanup:
+	return hrResult;
+}
+
+STATIC
+HRESULT
+main_HandleFontOption(
+	_In_opt_	PCWSTR				pwszValue,
+	_Inout_		PCONVERT_OPTIONS	ptOptions
+)
+{
+	HRESULT	hrResult	= E_FAIL;
+
+	assert(NULL != ptOptions);
+
+	if ((NULL == pwszValue) || (L'\0' == *pwszValue))
+	{
+		PROGRESS("No font specified.");
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+
+	ptOptions->pwszFontPath = pwszValue;
+
+	hrResult = S_OK;
+
+lblCleanup:
+	return hrResult;
+}
+
+STATIC
+HRESULT
+main_HandleThumbnailOption(
+	_In_opt_	PCWSTR				pwszValue,
+	_Inout_		PCONVERT_OPTIONS	ptOptions
+)
+{
+	HRESULT	hrResult	= E_FAIL;
+
+	assert(NULL != ptOptions);
+
+	if ((NULL == pwszValue) || (L'\0' == *pwszValue))
+	{
+		PROGRESS("No thumbnail path specified.");
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+
+	ptOptions->pwszThumbnailPath = pwszValue;
+
+	hrResult = S_OK;
+
+lblCleanup:
+	return hrResult;
+}
+
+STATIC
+HRESULT
+main_HandleScaleOption(
+	_In_opt_	PCWSTR				pwszValue,
+	_Inout_		PCONVERT_OPTIONS	ptOptions
+)
+{
+	HRESULT	hrResult		= E_FAIL;
+	PWSTR	pwszValueEnd	= NULL;
+	ULONG	nScale			= 0;
+
+	assert(NULL != ptOptions);
+
+	if (NULL == pwszValue)
+	{
+		PROGRESS("No scale specified.");
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+
+	nScale = wcstoul(pwszValue, &pwszValueEnd, 10);
+	if ((pwszValueEnd == pwszValue) ||
+		(L'\0' != *pwszValueEnd) ||
+		(0 == nScale))
+	{
+		PROGRESS("Invalid scale '%S'.", pwszValue);
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+
+	ptOptions->nThumbnailScale = nScale;
+
+	hrResult = S_OK;
+
+lblCleanup:
+	return hrResult;
+}
+
+STATIC
+HRESULT
+main_HandleRawOption(
+	_In_opt_	PCWSTR				pwszValue,
+	_Inout_		PCONVERT_OPTIONS	ptOptions
+)
+{
+	HRESULT	hrResult	= E_FAIL;
+
+	assert(NULL != ptOptions);
+
+	if (NULL != pwszValue)
+	{
+		PROGRESS("The raw option takes no value.");
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+
+	ptOptions->bRaw = TRUE;
+
+	hrResult = S_OK;
+
+lblCleanup:
+	return hrResult;
+}
+
+STATIC
+HRESULT
+main_HandleRleOption(
+	_In_opt_	PCWSTR				pwszValue,
+	_Inout_		PCONVERT_OPTIONS	ptOptions
+)
+{
+	HRESULT	hrResult	= E_FAIL;
+
+	assert(NULL != ptOptions);
+
+	if (NULL != pwszValue)
+	{
+		PROGRESS("The rle option takes no value.");
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+
+	ptOptions->bRle = TRUE;
+
+	hrResult = S_OK;
+
+lblCleanup:
+	return hrResult;
+}
+
+STATIC
+PCCONVERT_FORMAT_ENTRY
+main_FindConvertFormat(
+	_In_	PCWSTR	pwszName
+)
+{
+	PCCONVERT_FORMAT_ENTRY	ptFormat	= NULL;
+	DWORD					nIndex		= 0;
+
+	assert(NULL != pwszName);
+
+	for (nIndex = 0;
+		 nIndex < ARRAYSIZE(g_atConvertFormats);
+		 ++nIndex)
+	{
+		if (0 == _wcsicmp(g_atConvertFormats[nIndex].pwszName, pwszName))
+		{
+			ptFormat = &(g_atConvertFormats[nIndex]);
+			break;
+		}
+	}
+
+	return ptFormat;
+}
+
+STATIC
+HRESULT
+main_HandleFormatOption(
+	_In_opt_	PCWSTR				pwszValue,
+	_Inout_		PCONVERT_OPTIONS	ptOptions
+)
+{
+	HRESULT	hrResult	= E_FAIL;
+
+	assert(NULL != ptOptions);
+
+	if ((NULL == pwszValue) || (L'\0' == *pwszValue))
+	{
+		PROGRESS("No format specified.");
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+
+	ptOptions->ptFormat = main_FindConvertFormat(pwszValue);
+	if (NULL == ptOptions->ptFormat)
+	{
+		PROGRESS("Unsupported format '%S'.", pwszValue);
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+
+	hrResult = S_OK;
+
+lblCleanup:
+	return hrResult;
+}
+
+STATIC
+HRESULT
+main_HandleFingerprintOption(
+	_In_opt_	PCWSTR				pwszValue,
+	_Inout_		PCONVERT_OPTIONS	ptOptions
+)
+{
+	HRESULT	hrResult	= E_FAIL;
+
+	assert(NULL != ptOptions);
+
+	if (NULL != pwszValue)
+	{
+		PROGRESS("The fingerprint option takes no value.");
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+
+	ptOptions->bFingerprint = TRUE;
+
+	hrResult = S_OK;
+
+lblCleanup:
+	return hrResult;
+}
+
+STATIC
+HRESULT
+main_HandleMappedOption(
+	_In_opt_	PCWSTR				pwszValue,
+	_Inout_		PCONVERT_OPTIONS	ptOptions
+)
+{
+	HRESULT	hrResult	= E_FAIL;
+
+	assert(NULL != ptOptions);
+
+	if (NULL != pwszValue)
+	{
+		PROGRESS("The mmap option takes no value.");
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+
+	ptOptions->bMapped = TRUE;
+
+	hrResult = S_OK;
+
+lblCleanup:
+	return hrResult;
+}
+
+STATIC
+HRESULT
+main_HandleScratchOption(
+	_In_opt_	PCWSTR				pwszValue,
+	_Inout_		PCONVERT_OPTIONS	ptOptions
+)
+{
+	HRESULT	hrResult	= E_FAIL;
+
+	assert(NULL != ptOptions);
+
+	if (NULL != pwszValue)
+	{
+		PROGRESS("The scratch option takes no value.");
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+
+	ptOptions->bScratch = TRUE;
+
+	hrResult = S_OK;
+
+lblCleanup:
+	return hrResult;
+}
+
+STATIC
+HRESULT
+main_HandleTtyOption(
+	_In_opt_	PCWSTR				pwszValue,
+	_Inout_		PCONVERT_OPTIONS	ptOptions
+)
+{
+	HRESULT	hrResult		= E_FAIL;
+	PWSTR	pwszValueEnd	= NULL;
+	ULONG	nColumns		= 0;
+
+	assert(NULL != ptOptions);
+
+	// Without a width, the console is asked for it.
+	if (NULL != pwszValue)
+	{
+		nColumns = wcstoul(pwszValue, &pwszValueEnd, 10);
+		if ((pwszValueEnd == pwszValue) ||
+			(L'\0' != *pwszValueEnd) ||
+			(0 == nColumns))
+		{
+			PROGRESS("Invalid terminal width '%S'.", pwszValue);
+			hrResult = E_INVALIDARG;
+			goto lblCleanup;
+		}
+	}
+
+	ptOptions->bTty = TRUE;
+	ptOptions->nTtyColumns = nColumns;
+
+	hrResult = S_OK;
+
+lblCleanup:
+	return hrResult;
+}
+
+STATIC
+HRESULT
+main_HandleIndexOption(
+	_In_opt_	PCWSTR				pwszValue,
+	_Inout_		PCONVERT_OPTIONS	ptOptions
+)
+{
+	HRESULT	hrResult	= E_FAIL;
+
+	assert(NULL != ptOptions);
+
+	if (NULL != pwszValue)
+	{
+		PROGRESS("The index option takes no value.");
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+
+	ptOptions->bIndexed = TRUE;
+
+	hrResult = S_OK;
+
+lblCleanup:
+	return hrResult;
+}
+
+STATIC
+HRESULT
+main_ParseConvertOptions(
+	_In_					INT					nArguments,
+	_In_reads_(nArguments)	CONST PCWSTR *		ppwszArguments,
+	_Out_					PCONVERT_OPTIONS	ptOptions,
+	_Out_					PINT				pnOptions
+)
+{
+	HRESULT						hrResult		= E_FAIL;
+	CONVERT_OPTIONS				tOptions		= { 0 };
+	INT							nCurrentArg		= 0;
+	PCWSTR						pwszValue		= NULL;
+	SIZE_T						cchName			= 0;
+	DWORD						nIndex			= 0;
+	PCCONVERT_OPTION_ENTRY		ptCurrentEntry	= NULL;
+	PFN_CONVERT_OPTION_HANDLER	pfnHandler		= NULL;
+
+	assert(NULL != ppwszArguments);
+	assert(NULL != ptOptions);
+	assert(NULL != pnOptions);
+
+	tOptions.nBitsPerPixel = CONVERT_DEFAULT_BITS_PER_PIXEL;
+	tOptions.nThumbnailScale = CONVERT_DEFAULT_THUMBNAIL_SCALE;
+
+	for (nCurrentArg = 0;
+		 nCurrentArg < nArguments;
+		 ++nCurrentArg)
+	{
+		if (0 != wcsncmp(ppwszArguments[nCurrentArg],
+						 CONVERT_OPTION_PREFIX,
+						 wcslen(CONVERT_OPTION_PREFIX)))
+		{
+			// Options are over.
+			break;
+		}
+
+		// Split the option into a name and a value.
+		pwszValue = wcschr(ppwszArguments[nCurrentArg], CONVERT_OPTION_VALUE_SEPARATOR);
+		cchName =
+			(NULL == pwszValue)
+			? (wcslen(ppwszArguments[nCurrentArg]))
+			: ((SIZE_T)(pwszValue - ppwszArguments[nCurrentArg]));
+		if (NULL != pwszValue)
+		{
+			++pwszValue;
+		}
+
+		pfnHandler = NULL;
+		for (nIndex = 0;
+			 nIndex < ARRAYSIZE(g_atConvertOptions);
+			 ++nIndex)
+		{
+			ptCurrentEntry = &(g_atConvertOptions[nIndex]);
+
+			if ((cchName == wcslen(ptCurrentEntry->pwszOptionName)) &&
+				(0 == _wcsnicmp(ptCurrentEntry->pwszOptionName,
+								ppwszArguments[nCurrentArg],
+								cchName)))
+			{
+				pfnHandler = ptCurrentEntry->pfnHandler;
+				break;
+			}
+		}
+		if (NULL == pfnHandler)
+		{
+			PROGRESS("Unknown option '%S'.", ppwszArguments[nCurrentArg]);
+			hrResult = E_INVALIDARG;
+			goto lblCleanup;
+		}
+
+		hrResult = pfnHandler(pwszValue, &tOptions);
+		if (FAILED(hrResult))
+		{
+			goto lblCleanup;
+		}
+	}
+
+	*ptOptions = tOptions;
+	*pnOptions = nCurrentArg;
+
+	hrResult = S_OK;
+
+lblCleanup:
+	return hrResult;
+}
+
+STATIC
+HRESULT
+main_ReadCapture(
+	_In_opt_								PCWSTR		pwszPath,
+	_In_									BOOL		bRaw,
+	_In_									BOOL		bIndexed,
+	_Outptr_result_bytebuffer_(*pcbCapture)	LPCVOID *	ppvCapture,
+	_Out_									PDWORD		pcbCapture
+)
+{
+	HRESULT		hrResult	= E_FAIL;
+	HDUMP		hDump		= NULL;
+	PVOID		pvRaw		= NULL;
+	ULONGLONG	cbRead		= 0;
+	ULONGLONG	cbFile		= 0;
+
+	assert(NULL != ppvCapture);
+	assert(NULL != pcbCapture);
+
+	if (bRaw)
+	{
+		if (NULL == pwszPath)
+		{
+			PROGRESS("Raw captures can only be read from a file.");
+			hrResult = E_INVALIDARG;
+			goto lblCleanup;
+		}
+
+		hrResult = UTIL_ReadFile(pwszPath, &pvRaw, pcbCapture);
+		if (FAILED(hrResult))
+		{
+			PROGRESS("Failed reading the raw capture '%S'.", pwszPath);
+			goto lblCleanup;
+		}
+
+		// Transfer ownership:
+		*ppvCapture = pvRaw;
+		pvRaw = NULL;
+	}
+	else
+	{
+		hrResult = DUMPPARSE_OpenWithReader(pwszPath,
+											bIndexed ? DUMPPARSE_READER_INDEXED : DUMPPARSE_READER_NATIVE,
+											&hDump);
+		if (FAILED(hrResult))
+		{
+			PROGRESS("Failed opening the dump file.");
+			goto lblCleanup;
+		}
+
+		hrResult = DUMPPARSE_MapTagged(hDump,
+									   &g_tVgaDumpGuid,
+									   ppvCapture,
+									   pcbCapture);
+		if (FAILED(hrResult))
+		{
+			PROGRESS("Failed reading saved bugcheck screenshot. Did you save it?");
+			goto lblCleanup;
+		}
+		if (0 == *pcbCapture)
+		{
+			PROGRESS("The saved bugcheck screenshot is empty.");
+			hrResult = HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+			goto lblCleanup;
+		}
+
+		DUMPPARSE_GetReadStatistics(hDump, &cbRead, &cbFile);
+		PROGRESS("Read %I64u bytes of the %I64u byte dump.", cbRead, cbFile);
+	}
+
+	hrResult = S_OK;
+
+lblCleanup:
+	CLOSE(hDump, DUMPPARSE_Close);
+	HEAPFREE(pvRaw);
+
+	return hrResult;
+}
+
+STATIC
+VOID
+main_ReleaseCapture(
+	_In_	LPCVOID	pvCapture,
+	_In_	DWORD	cbCapture,
+	_In_	BOOL	bRaw
+)
+{
+	PVOID	pvRaw	= NULL;
+
+	if (bRaw)
+	{
+		// Raw captures are read into the heap.
+		pvRaw = (PVOID)pvCapture;
+		HEAPFREE(pvRaw);
+	}
+	else
+	{
+		DUMPPARSE_UnmapTagged(pvCapture, cbCapture);
+	}
+}
+
+STATIC
+HRESULT
+main_EncodeBitmap(
+	_In_	PCCONVERT_SOURCE		ptSource,
+	_In_	PCCONVERT_FORMAT_ENTRY	ptFormat,
+	_In_	HVGASTREAM				hStream
+)
+{
+	HRESULT	hrResult	= E_FAIL;
+	PVOID	pvBitmap	= NULL;
+	DWORD	cbBitmap	= 0;
+
+	assert(NULL != ptSource);
+	assert(NULL != hStream);
+	UNREFERENCED_PARAMETER(ptFormat);
+
+	if (!ptSource->ptOptions->bRle)
+	{
+		// Written to the stream as it's decoded.
+		hrResult = main_VgaDumpToStreamedBitmap(ptSource->ptCapture,
+												ptSource->ptImage,
+												ptSource->ptOptions->nBitsPerPixel,
+												hStream);
+		goto lblCleanup;
+	}
+
+	hrResult = main_VgaDumpToCompressedBitmap(ptSource->ptCapture,
+											  ptSource->ptImage,
+											  ptSource->ptOptions->nBitsPerPixel,
+											  &pvBitmap,
+											  &cbBitmap);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	hrResult = VGASTREAM_Map(hStream, cbBitmap);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	hrResult = VGASTREAM_Write(hStream, pvBitmap, cbBitmap);
+
+lblCleanup:
+	HEAPFREE(pvBitmap);
+
+	return hrResult;
+}
+
+STATIC
+HRESULT
+main_EncodePng(
+	_In_	PCCONVERT_SOURCE		ptSource,
+	_In_	PCCONVERT_FORMAT_ENTRY	ptFormat,
+	_In_	HVGASTREAM				hStream
+)
+{
+	HRESULT	hrResult	= E_FAIL;
+	PBYTE	pnPng		= NULL;
+	DWORD	cbPng		= 0;
+
+	assert(NULL != ptSource);
+	assert(NULL != hStream);
+	UNREFERENCED_PARAMETER(ptFormat);
+
+	hrResult = main_VgaDumpToPng(ptSource->ptCapture, ptSource->ptImage, &pnPng, &cbPng);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	hrResult = VGASTREAM_Map(hStream, cbPng);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	hrResult = VGASTREAM_Write(hStream, pnPng, cbPng);
+
+lblCleanup:
+	HEAPFREE(pnPng);
+
+	return hrResult;
+}
+
+STATIC
+HRESULT
+main_EncodePixmap(
+	_In_	PCCONVERT_SOURCE		ptSource,
+	_In_	PCCONVERT_FORMAT_ENTRY	ptFormat,
+	_In_	HVGASTREAM				hStream
+)
+{
+	assert(NULL != ptSource);
+	assert(NULL != ptFormat);
+	assert(NULL != hStream);
+
+	// Written to the stream as it's decoded.
+	return main_VgaDumpToPixmap(ptSource->ptCapture,
+								ptSource->ptImage,
+								ptFormat->ePixmapFormat,
+								hStream);
+}
+
+STATIC
+HRESULT
+main_EncodeThumbnail(
+	_In_	PCCONVERT_SOURCE		ptSource,
+	_In_	PCCONVERT_FORMAT_ENTRY	ptFormat,
+	_In_	HVGASTREAM				hStream
+)
+{
+	HRESULT					hrResult				= E_FAIL;
+	PVGA_TRUECOLOR_BITMAP	ptThumbnail				= NULL;
+	DWORD					cbThumbnail				= 0;
+	RGBQUAD					atPalette[VGA_COLORS]	= { { 0 } };
+
+	assert(NULL != ptSource);
+	assert(NULL != hStream);
+	UNREFERENCED_PARAMETER(ptFormat);
+
+	PROGRESS("Writing a thumbnail %lu times smaller than the screen.", ptSource->ptOptions->nThumbnailScale);
+
+	hrResult = main_AllocateThumbnail(ptSource->ptCapture,
+									  ptSource->ptOptions->nThumbnailScale,
+									  &ptThumbnail,
+									  &cbThumbnail);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	main_GetPixelColors(ptSource->ptCapture, atPalette);
+	hrResult = VGATHUMBNAIL_Render(ptSource->ptCapture,
+								   atPalette,
+								   ptSource->ptOptions->nThumbnailScale,
+								   ptThumbnail->atPixels,
+								   NULL,
+								   0,
+								   NULL);
+	if (FAILED(hrResult))
+	{
+		PROGRESS("Failed rendering the thumbnail.");
+		goto lblCleanup;
+	}
+
+	hrResult = VGASTREAM_Map(hStream, cbThumbnail);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	hrResult = VGASTREAM_Write(hStream, ptThumbnail, cbThumbnail);
+
+lblCleanup:
+	HEAPFREE(ptThumbnail);
+
+	return hrResult;
+}
+
+STATIC
+HRESULT
+main_OpenConvertOutput(
+	_In_opt_	PCWSTR				pwszPath,
+	_In_		PCCONVERT_OPTIONS	ptOptions,
+	_Out_		PHVGASTREAM			phStream
+)
+{
+	assert(NULL != ptOptions);
+	assert(NULL != phStream);
+
+	// The standard output can't be mapped.
+	if ((NULL == pwszPath) || !ptOptions->bMapped)
+	{
+		return VGASTREAM_Create(pwszPath, phStream);
+	}
+
+	return VGASTREAM_CreateMapped(pwszPath, !ptOptions->bScratch, phStream);
+}
+
+STATIC
+VOID
+main_RunConvertJob(
+	_In_	PCCONVERT_SOURCE	ptSource,
+	_Inout_	PCONVERT_JOB		ptJob
+)
+{
+	HRESULT				hrResult		= E_FAIL;
+	BOOL				bStandardOutput	= FALSE;
+	HVGASTREAM			hStream			= NULL;
+	PFN_CONVERT_ENCODER	pfnEncoder		= NULL;
+
+	assert(NULL != ptSource);
+	assert(NULL != ptJob);
+	assert(NULL != ptJob->ptFormat);
+
+	bStandardOutput = (0 == wcscmp(ptJob->pwszPath, CONVERT_STANDARD_OUTPUT));
+	hrResult = main_OpenConvertOutput(bStandardOutput ? NULL : ptJob->pwszPath,
+									  ptSource->ptOptions,
+									  &hStream);
+	if (FAILED(hrResult))
+	{
+		PROGRESS("Failed opening the output file '%S'.", ptJob->pwszPath);
+		goto lblCleanup;
+	}
+
+	pfnEncoder = g_apfnConvertEncoders[ptJob->ptFormat->eFormat];
+	hrResult = pfnEncoder(ptSource, ptJob->ptFormat, hStream);
+	if (FAILED(hrResult))
+	{
+		PROGRESS("Failed converting the raw VGA dump to '%S'.", ptJob->pwszPath);
+		goto lblCleanup;
+	}
+
+	hrResult = VGASTREAM_Flush(hStream);
+	if (FAILED(hrResult))
+	{
+		PROGRESS("Failed writing the output file '%S'.", ptJob->pwszPath);
+		goto lblCleanup;
+	}
+
+	hrResult = S_OK;
+
+lblCleanup:
+	VGASTREAM_Close(hStream);
+	ptJob->hrResult = hrResult;
+}
+
+STATIC
+VOID
+CALLBACK
+main_ConvertWorkCallback(
+	_Inout_		PTP_CALLBACK_INSTANCE	ptInstance,
+	_Inout_opt_	PVOID					pvContext,
+	_Inout_		PTP_WORK				ptWork
+)
+{
+	PCONVERT_JOBS	ptJobs	= (PCONVERT_JOBS)pvContext;
+	LONG			nJob	= 0;
+
+	UNREFERENCED_PARAMETER(ptInstance);
+	UNREFERENCED_PARAMETER(ptWork);
+	assert(NULL != ptJobs);
+
+	// Every callback takes the next output nobody has taken yet.
+	nJob = InterlockedIncrement(&(ptJobs->nNextJob)) - 1;
+	assert((DWORD)nJob < ptJobs->nJobs);
+
+	main_RunConvertJob(ptJobs->ptSource, &(ptJobs->ptJobs[nJob]));
+}
+
+STATIC
+HRESULT
+main_RunConvertJobs(
+	_In_					PCCONVERT_SOURCE	ptSource,
+	_Inout_updates_(nJobs)	PCONVERT_JOB		ptJobs,
+	_In_					DWORD				nJobs
+)
+{
+	HRESULT			hrResult	= E_FAIL;
+	CONVERT_JOBS	tJobs		= { 0 };
+	PTP_WORK		ptWork		= NULL;
+	DWORD			nJob		= 0;
+
+	assert(NULL != ptSource);
+	assert(NULL != ptJobs);
+	assert(0 != nJobs);
+
+	if (1 == nJobs)
+	{
+		main_RunConvertJob(ptSource, ptJobs);
+	}
+	else
+	{
+		tJobs.ptSource = ptSource;
+		tJobs.ptJobs = ptJobs;
+		tJobs.nJobs = nJobs;
+		tJobs.nNextJob = 0;
+
+		ptWork = CreateThreadpoolWork(&main_ConvertWorkCallback, &tJobs, NULL);
+		if (NULL == ptWork)
+		{
+			hrResult = HRESULT_FROM_WIN32(GetLastError());
+			goto lblCleanup;
+		}
+
+		// The encoders only read the source, so all of them can run at once.
+		PROGRESS("Writing %lu outputs in parallel.", nJobs);
+		for (nJob = 0; nJob < nJobs; ++nJob)
+		{
+			SubmitThreadpoolWork(ptWork);
+		}
+		WaitForThreadpoolWorkCallbacks(ptWork, FALSE);
+	}
+
+	hrResult = S_OK;
+	for (nJob = 0; nJob < nJobs; ++nJob)
+	{
+		if (FAILED(ptJobs[nJob].hrResult))
+		{
+			hrResult = ptJobs[nJob].hrResult;
+			break;
+		}
+	}
+
+lblCleanup:
+	CLOSE(ptWork, CloseThreadpoolWork);
+
+	return hrResult;
+}
+
+STATIC
+DWORD
+main_GetTerminalColumns(VOID)
+{
+	CONSOLE_SCREEN_BUFFER_INFO	tInfo	= { 0 };
+
+	if (!GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &tInfo))
+	{
+		return CONVERT_DEFAULT_TTY_COLUMNS;
+	}
+
+	// The visible part of the buffer, not all of it.
+	return (DWORD)(tInfo.srWindow.Right - tInfo.srWindow.Left + 1);
+}
+
+STATIC
+HRESULT
+main_DrawOnTerminal(
+	_In_	PCVGA_CAPTURE_VIEW	ptCapture,
+	_In_	DWORD				nColumns
+)
+{
+	HRESULT		hrResult				= E_FAIL;
+	HANDLE		hOutput					= NULL;
+	BOOL		bConsole				= FALSE;
+	DWORD		nMode					= 0;
+	UINT		nCodePage				= 0;
+	HVGASTREAM	hStream					= NULL;
+	RGBQUAD		atPalette[VGA_COLORS]	= { { 0 } };
+	DWORD64		nStartTime				= 0;
+	DWORD64		nCycles					= 0;
+
+	assert(NULL != ptCapture);
+
+	if (0 == nColumns)
+	{
+		nColumns = main_GetTerminalColumns();
+	}
+
+	// Consoles only take escape sequences and UTF-8 when told to.
+	// Anything else, such as an SSH session, is left to cope.
+	hOutput = GetStdHandle(STD_OUTPUT_HANDLE);
+	bConsole = GetConsoleMode(hOutput, &nMode);
+	if (bConsole)
+	{
+		nCodePage = GetConsoleOutputCP();
+		(VOID)SetConsoleMode(hOutput, nMode | ENABLE_VIRTUAL_TERMINAL_PROCESSING);
+		(VOID)SetConsoleOutputCP(CP_UTF8);
+	}
+
+	hrResult = VGASTREAM_Create(NULL, &hStream);
+	if (FAILED(hrResult))
+	{
+		PROGRESS("Failed opening the standard output.");
+		goto lblCleanup;
+	}
+
+	PROGRESS("Drawing the screen %lu columns wide.", nColumns);
+	main_GetPixelColors(ptCapture, atPalette);
+	nStartTime = __rdtsc();
+	hrResult = VGATTY_Draw(ptCapture, atPalette, nColumns, hStream);
+	if (SUCCEEDED(hrResult))
+	{
+		hrResult = VGASTREAM_Flush(hStream);
+	}
+	if (FAILED(hrResult))
+	{
+		PROGRESS("Failed drawing the screen.");
+		goto lblCleanup;
+	}
+	nCycles = __rdtsc() - nStartTime;
+	PROGRESS("Drew %I64u bytes in %I64u cycles.", VGASTREAM_GetSize(hStream), nCycles);
+
+	hrResult = S_OK;
+
+lblCleanup:
+	CLOSE(hStream, VGASTREAM_Close);
+	if (bConsole)
+	{
+		(VOID)SetConsoleOutputCP(nCodePage);
+		(VOID)SetConsoleMode(hOutput, nMode);
+	}
+
+	return hrResult;
+}
+
+STATIC
+HRESULT
+main_HandleConvert(
+	_In_					INT				nArguments,
+	_In_reads_(nArguments)	CONST PCWSTR *	ppwszArguments
+)
+{
+	HRESULT					hrResult			= E_FAIL;
+	CONVERT_OPTIONS			tOptions			= { 0 };
+	INT						nOptions			= 0;
+	PCWSTR					pwszDumpPath		= NULL;
+	CONST PCWSTR *			ppwszOutputPaths	= NULL;
+	DWORD					nOutputs			= 0;
+	PCONVERT_JOB			ptJobs				= NULL;
+	DWORD					nJobs				= 0;
+	DWORD					nJob				= 0;
+	DWORD					nStandardOutputs	= 0;
+	BOOL					bBitmap				= FALSE;
+	PCWSTR					pwszExtension		= NULL;
+	PCCONVERT_FORMAT_ENTRY	ptFormat			= NULL;
+	LPCVOID					pvCapture			= NULL;
+	DWORD					cbCapture			= 0;
+	VGA_CAPTURE_VIEW		tCapture			= { 0 };
+	VGA_FINGERPRINT			nFingerprint		= 0;
+	PVGA_IMAGE				ptImage				= NULL;
+	CONVERT_SOURCE			tSource				= { 0 };
+	HVGASTREAM				hStream				= NULL;
+	PVOID					pvFont				= NULL;
+	DWORD					cbFont				= 0;
+	PSTR					pszText				= NULL;
+	DWORD					cbText				= 0;
+	DWORD64					nStartTime			= 0;
+	DWORD64					nCycles				= 0;
+	DWORD64					nPixels				= 0;
+
+	assert(NULL != ppwszArguments);
+
+	hrResult = main_ParseConvertOptions(nArguments,
+										ppwszArguments,
+										&tOptions,
+										&nOptions);
+	if (FAILED(hrResult))
+	{
+		PROGRESS("Invalid options specified.");
+		goto lblCleanup;
+	}
+	nArguments -= nOptions;
+	ppwszArguments += nOptions;
+
+	if (tOptions.bText && (NULL != tOptions.pwszThumbnailPath))
+	{
+		PROGRESS("Thumbnails can't be written along with the text.");
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+
+	if (tOptions.bTty &&
+		(tOptions.bText ||
+		 (NULL != tOptions.pwszThumbnailPath) ||
+		 (NULL != tOptions.ptFormat) ||
+		 tOptions.bFingerprint ||
+		 tOptions.bMapped))
+	{
+		PROGRESS("--tty only draws the screen on the terminal.");
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+
+	if (tOptions.bScratch && !tOptions.bMapped)
+	{
+		PROGRESS("--scratch only applies to --mmap.");
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+
+	if (tOptions.bIndexed && tOptions.bRaw)
+	{
+		PROGRESS("--index only applies to memory dumps.");
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+
+	if (tOptions.bRle && (32 == tOptions.nBitsPerPixel))
+	{
+		PROGRESS("Only paletted BMPs can be run-length encoded.");
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+
+	// The terminal is the only output of --tty.
+	if (tOptions.bTty && (0 == nArguments))
+	{
+		PROGRESS("Drawing the system memory dump on the terminal.");
+	}
+	else if (tOptions.bTty && (SUBFUNCTION_CONVERT_TTY_ARGS_COUNT == nArguments))
+	{
+		pwszDumpPath = ppwszArguments[SUBFUNCTION_CONVERT_TTY_ARG_INPUT];
+		PROGRESS("Drawing dump '%S' on the terminal.", pwszDumpPath);
+	}
+	else if (tOptions.bTty)
+	{
+		PROGRESS("Invalid number of arguments specified.");
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+	// Any arguments past the first output are more outputs.
+	else if (SUBFUNCTION_CONVERT_NO_INPUT_ARGS_COUNT == nArguments)
+	{
+		ppwszOutputPaths = &(ppwszArguments[SUBFUNCTION_CONVERT_NO_INPUT_ARG_OUTPUT]);
+		nOutputs = 1;
+		PROGRESS("Converting system memory dump to '%S'.", ppwszOutputPaths[0]);
+	}
+	else if (SUBFUNCTION_CONVERT_ARGS_COUNT <= nArguments)
+	{
+		pwszDumpPath = ppwszArguments[SUBFUNCTION_CONVERT_ARG_INPUT];
+		ppwszOutputPaths = &(ppwszArguments[SUBFUNCTION_CONVERT_ARG_OUTPUT]);
+		nOutputs = (DWORD)(nArguments - SUBFUNCTION_CONVERT_ARG_OUTPUT);
+		PROGRESS("Converting dump '%S' to %lu file(s), starting with '%S'.",
+				 pwszDumpPath,
+				 nOutputs,
+				 ppwszOutputPaths[0]);
+	}
+	else
+	{
+		PROGRESS("Invalid number of arguments specified.");
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+
+	if (tOptions.bText && (NULL != tOptions.ptFormat))
+	{
+		PROGRESS("The text is always written as UTF-8.");
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+
+	if (tOptions.bText && (1 != nOutputs))
+	{
+		PROGRESS("The text is only written to a single file.");
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+
+	// Room for the thumbnail, too.
+	ptJobs = HEAPALLOC((nOutputs + 1) * sizeof(*ptJobs));
+	if (NULL == ptJobs)
+	{
+		PROGRESS("Oops. Ran out of memory.");
+		hrResult = E_OUTOFMEMORY;
+		goto lblCleanup;
+	}
+
+	for (nJobs = 0; nJobs < nOutputs; ++nJobs)
+	{
+		// Unless a format was given, the output's extension decides.
+		ptFormat = tOptions.ptFormat;
+		if (NULL == ptFormat)
+		{
+			pwszExtension = wcsrchr(ppwszOutputPaths[nJobs], L'.');
+			if (NULL != pwszExtension)
+			{
+				ptFormat = main_FindConvertFormat(pwszExtension + 1);
+			}
+			if (NULL == ptFormat)
+			{
+				ptFormat = &(g_atConvertFormats[0]);
+			}
+		}
+
+		ptJobs[nJobs].pwszPath = ppwszOutputPaths[nJobs];
+		ptJobs[nJobs].ptFormat = ptFormat;
+		bBitmap = bBitmap || (CONVERT_FORMAT_BMP == ptFormat->eFormat);
+	}
+	if (NULL != tOptions.pwszThumbnailPath)
+	{
+		ptJobs[nJobs].pwszPath = tOptions.pwszThumbnailPath;
+		ptJobs[nJobs].ptFormat = &g_tConvertThumbnailFormat;
+		++nJobs;
+	}
+
+	if (!tOptions.bText &&
+		!bBitmap &&
+		(tOptions.bRle || (32 == tOptions.nBitsPerPixel)))
+	{
+		PROGRESS("--bpp=32 and --rle only apply to BMPs.");
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+
+	for (nJob = 0; nJob < nJobs; ++nJob)
+	{
+		if (0 == wcscmp(ptJobs[nJob].pwszPath, CONVERT_STANDARD_OUTPUT))
+		{
+			++nStandardOutputs;
+		}
+	}
+
+	if (1 < nStandardOutputs)
+	{
+		PROGRESS("Only one output can be the standard output.");
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+
+	if (tOptions.bFingerprint && (0 != nStandardOutputs))
+	{
+		PROGRESS("The fingerprint goes to the standard output, so no file can.");
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+
+	if (!tOptions.bText &&
+		(0 != nStandardOutputs) &&
+		(FILE_TYPE_CHAR == GetFileType(GetStdHandle(STD_OUTPUT_HANDLE))))
+	{
+		PROGRESS("Not writing an image to the console. Redirect the output.");
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+
+	hrResult = main_ReadCapture(pwszDumpPath,
+								tOptions.bRaw,
+								tOptions.bIndexed,
+								&pvCapture,
+								&cbCapture);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	hrResult = VGACAPTURE_Parse(pvCapture, cbCapture, &tCapture);
+	if (FAILED(hrResult))
+	{
+		PROGRESS("The stored screenshot is invalid.");
+		goto lblCleanup;
+	}
+
+	if (tOptions.bFingerprint)
+	{
+		VGAFINGERPRINT_FromCapture(&tCapture, &nFingerprint);
+		(VOID)wprintf(L"%016I64X\n", nFingerprint);
+	}
+
+	if (tOptions.bTty)
+	{
+		hrResult = main_DrawOnTerminal(&tCapture, tOptions.nTtyColumns);
+		goto lblCleanup;
+	}
+
+	if (tOptions.bText)
+	{
+		if (NULL != tOptions.pwszFontPath)
+		{
+			hrResult = UTIL_ReadFile(tOptions.pwszFontPath, &pvFont, &cbFont);
+			if (FAILED(hrResult))
+			{
+				PROGRESS("Failed reading the font '%S'.", tOptions.pwszFontPath);
+				goto lblCleanup;
+			}
+		}
+
+		hrResult = VGATEXT_ReadScreen(&tCapture, pvFont, cbFont, &pszText, &cbText);
+		if (FAILED(hrResult))
+		{
+			PROGRESS("Failed reading the text on the screen.");
+			goto lblCleanup;
+		}
+
+		hrResult = main_OpenConvertOutput(
+			(0 == nStandardOutputs) ? ppwszOutputPaths[0] : NULL,
+			&tOptions,
+			&hStream);
+		if (FAILED(hrResult))
+		{
+			PROGRESS("Failed opening the output file.");
+			goto lblCleanup;
+		}
+
+		hrResult = VGASTREAM_Map(hStream, cbText);
+		if (SUCCEEDED(hrResult))
+		{
+			hrResult = VGASTREAM_Write(hStream, pszText, cbText);
+		}
+		if (SUCCEEDED(hrResult))
+		{
+			hrResult = VGASTREAM_Flush(hStream);
+		}
+		if (FAILED(hrResult))
+		{
+			PROGRESS("Failed writing the output file.");
+			goto lblCleanup;
+		}
+
+		hrResult = S_OK;
+		goto lblCleanup;
+	}
+
+	// With more than one output, decoding the screen once
+	// is cheaper than decoding it for each of them.
+	// Thumbnails are counted straight from the planes, so they don't count.
+	if (1 < nOutputs)
+	{
+		PROGRESS("Decoding the screen once for all outputs (%s decoder).", VGADECODE_GetBackendName());
+		nStartTime = __rdtsc();
+		hrResult = VGAIMAGE_Decode(&tCapture, &ptImage);
+		if (FAILED(hrResult))
+		{
+			PROGRESS("Failed decoding the screen.");
+			goto lblCleanup;
+		}
+		nCycles = __rdtsc() - nStartTime;
+		nPixels = max((DWORD64)tCapture.nWidth * tCapture.nHeight, 1);
+		PROGRESS("Decoded in %I64u cycles (%I64u.%02I64u cycles per pixel).",
+				 nCycles,
+				 nCycles / nPixels,
+				 (nCycles * 100 / nPixels) % 100);
+	}
+
+	tSource.ptCapture = &tCapture;
+	tSource.ptImage = ptImage;
+	tSource.ptOptions = &tOptions;
+	hrResult = main_RunConvertJobs(&tSource, ptJobs, nJobs);
+	if (FAILED(hrResult))
+	{
+		PROGRESS("Failed writing the outputs.");
+		goto lblCleanup;
+	}
+
+	hrResult = S_OK;
+
+lblCleanup:
+	VGASTREAM_Close(hStream);
+	HEAPFREE(pszText);
+	HEAPFREE(pvFont);
+	HEAPFREE(ptImage);
+	RELEASE_CAPTURE(pvCapture, cbCapture, tOptions.bRaw);
+	HEAPFREE(ptJobs);
+
+	return hrResult;
+}
+
+STATIC
+HRESULT
+main_FingerprintFile(
+	_In_	PCWSTR				pwszPath,
+	_Out_	PVGA_FINGERPRINT	pnFingerprint
+)
+{
+	HRESULT				hrResult		= E_FAIL;
+	PCWSTR				pwszExtension	= NULL;
+	PVOID				pvBitmap		= NULL;
+	DWORD				cbBitmap		= 0;
+	HDUMP				hDump			= NULL;
+	LPCVOID				pvCapture		= NULL;
+	DWORD				cbCapture		= 0;
+	VGA_CAPTURE_VIEW	tCapture		= { 0 };
+
+	assert(NULL != pwszPath);
+	assert(NULL != pnFingerprint);
+
+	pwszExtension = wcsrchr(pwszPath, L'.');
+	if ((NULL != pwszExtension) &&
+		(0 == _wcsicmp(pwszExtension, DEDUP_BITMAP_EXTENSION)))
+	{
+		hrResult = UTIL_ReadFile(pwszPath, &pvBitmap, &cbBitmap);
+		if (FAILED(hrResult))
+		{
+			goto lblCleanup;
+		}
+
+		hrResult = VGAFINGERPRINT_FromBitmap(pvBitmap, cbBitmap, pnFingerprint);
+		if (FAILED(hrResult))
+		{
+			goto lblCleanup;
+		}
+	}
+	else
+	{
+		hrResult = DUMPPARSE_Open(pwszPath, &hDump);
+		if (FAILED(hrResult))
+		{
+			goto lblCleanup;
+		}
+
+		hrResult = DUMPPARSE_MapTagged(hDump,
+									   &g_tVgaDumpGuid,
+									   &pvCapture,
+									   &cbCapture);
+		if (FAILED(hrResult))
+		{
+			goto lblCleanup;
+		}
+		if (0 == cbCapture)
+		{
+			hrResult = HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+			goto lblCleanup;
+		}
+
+		hrResult = VGACAPTURE_Parse(pvCapture, cbCapture, &tCapture);
+		if (FAILED(hrResult))
+		{
+			goto lblCleanup;
+		}
+
+		VGAFINGERPRINT_FromCapture(&tCapture, pnFingerprint);
+	}
+
+	hrResult = S_OK;
+
+lblCleanup:
+	CLOSE_TO_VALUE_VARIADIC(pvCapture, DUMPPARSE_UnmapTagged, NULL, cbCapture);
+	CLOSE(hDump, DUMPPARSE_Close);
+	HEAPFREE(pvBitmap);
+
+	return hrResult;
+}
+
+STATIC
+HRESULT
+main_AddDedupFile(
+	_Inout_	PDEDUP_FILES	ptFiles,
+	_In_	PCWSTR			pwszPath,
+	_In_	VGA_FINGERPRINT	nFingerprint
+)
+{
+	HRESULT				hrResult		= E_FAIL;
+	DWORD				nCapacity		= 0;
+	PWSTR *				ppwszPaths		= NULL;
+	PVGA_FINGERPRINT	pnFingerprints	= NULL;
+	SIZE_T				cchPath			= 0;
+	PWSTR				pwszPathCopy	= NULL;
+
+	assert(NULL != ptFiles);
+	assert(NULL != pwszPath);
+
+	if (ptFiles->nFiles == ptFiles->nCapacity)
+	{
+		// Double the capacity of the list.
+		nCapacity = (0 == ptFiles->nCapacity) ? DEDUP_INITIAL_CAPACITY : ptFiles->nCapacity;
+		hrResult = DWordMult(nCapacity, 2, &nCapacity);
+		if (FAILED(hrResult))
+		{
+			goto lblCleanup;
+		}
+
+		ppwszPaths = HEAPALLOC(nCapacity * sizeof(ppwszPaths[0]));
+		pnFingerprints = HEAPALLOC(nCapacity * sizeof(pnFingerprints[0]));
+		if ((NULL == ppwszPaths) ||
+			(NULL == pnFingerprints))
+		{
+			PROGRESS("Oops. Ran out of memory.");
+			hrResult = E_OUTOFMEMORY;
+			goto lblCleanup;
+		}
+
+		if (0 != ptFiles->nFiles)
+		{
+			CopyMemory(ppwszPaths, ptFiles->ppwszPaths, ptFiles->nFiles * sizeof(ppwszPaths[0]));
+			CopyMemory(pnFingerprints, ptFiles->pnFingerprints, ptFiles->nFiles * sizeof(pnFingerprints[0]));
+		}
+
+		// Transfer ownership:
+		HEAPFREE(ptFiles->ppwszPaths);
+		ptFiles->ppwszPaths = ppwszPaths;
+		ppwszPaths = NULL;
+		HEAPFREE(ptFiles->pnFingerprints);
+		ptFiles->pnFingerprints = pnFingerprints;
+		pnFingerprints = NULL;
+		ptFiles->nCapacity = nCapacity;
+	}
+
+	cchPath = wcslen(pwszPath) + 1;
+	pwszPathCopy = HEAPALLOC(cchPath * sizeof(pwszPathCopy[0]));
+	if (NULL == pwszPathCopy)
+	{
+		PROGRESS("Oops. Ran out of memory.");
+		hrResult = E_OUTOFMEMORY;
+		goto lblCleanup;
+	}
+
+	hrResult = StringCchCopyW(pwszPathCopy, cchPath, pwszPath);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	// Transfer ownership:
+	ptFiles->ppwszPaths[ptFiles->nFiles] = pwszPathCopy;
+	pwszPathCopy = NULL;
+	ptFiles->pnFingerprints[ptFiles->nFiles] = nFingerprint;
+	++(ptFiles->nFiles);
+
+	hrResult = S_OK;
+
+lblCleanup:
+	HEAPFREE(pwszPathCopy);
+	HEAPFREE(pnFingerprints);
+	HEAPFREE(ppwszPaths);
+
+	return hrResult;
+}
+
+STATIC
+VOID
+main_FreeDedupFiles(
+	_Inout_	PDEDUP_FILES	ptFiles
+)
+{
+	DWORD	nIndex	= 0;
+
+	assert(NULL != ptFiles);
+
+	for (nIndex = 0; nIndex < ptFiles->nFiles; ++nIndex)
+	{
+		HEAPFREE(ptFiles->ppwszPaths[nIndex]);
+	}
+	HEAPFREE(ptFiles->ppwszPaths);
+	HEAPFREE(ptFiles->pnFingerprints);
+	ptFiles->nFiles = 0;
+	ptFiles->nCapacity = 0;
+}
+
+STATIC
+HRESULT
+main_CollectDedupFiles(
+	_In_	PCWSTR			pwszDirectory,
+	_Inout_	PDEDUP_FILES	ptFiles
+)
+{
+	HRESULT				hrResult		= E_FAIL;
+	SIZE_T				cchPath			= 0;
+	PWSTR				pwszPath		= NULL;
+	HANDLE				hFind			= INVALID_HANDLE_VALUE;
+	WIN32_FIND_DATAW	tFindData		= { 0 };
+	VGA_FINGERPRINT		nFingerprint	= 0;
+
+	assert(NULL != pwszDirectory);
+	assert(NULL != ptFiles);
+
+	// Room for the directory, a separator and a file name.
+	cchPath = wcslen(pwszDirectory) + 1 + ARRAYSIZE(tFindData.cFileName);
+	pwszPath = HEAPALLOC(cchPath * sizeof(pwszPath[0]));
+	if (NULL == pwszPath)
+	{
+		PROGRESS("Oops. Ran out of memory.");
+		hrResult = E_OUTOFMEMORY;
+		goto lblCleanup;
+	}
+
+	hrResult = StringCchPrintfW(pwszPath, cchPath, L"%s\\*", pwszDirectory);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	hFind = FindFirstFileW(pwszPath, &tFindData);
+	if (INVALID_HANDLE_VALUE == hFind)
+	{
+		PROGRESS("Failed listing the directory '%S'.", pwszDirectory);
+		hrResult = HRESULT_FROM_WIN32(GetLastError());
+		goto lblCleanup;
+	}
+
+	do
+	{
+		if (0 != (tFindData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+		{
+			continue;
+		}
+
+		hrResult = StringCchPrintfW(pwszPath, cchPath, L"%s\\%s", pwszDirectory, tFindData.cFileName);
+		if (FAILED(hrResult))
+		{
+			goto lblCleanup;
+		}
+
+		hrResult = main_FingerprintFile(pwszPath, &nFingerprint);
+		if (FAILED(hrResult))
+		{
+			PROGRESS("Skipping '%S' (0x%08lX).", pwszPath, hrResult);
+			continue;
+		}
+
+		hrResult = main_AddDedupFile(ptFiles, pwszPath, nFingerprint);
+		if (FAILED(hrResult))
+		{
+			goto lblCleanup;
+		}
+	} while (FindNextFileW(hFind, &tFindData));
+
+	if (ERROR_NO_MORE_FILES != GetLastError())
+	{
+		PROGRESS("Failed listing the directory '%S'.", pwszDirectory);
 		hrResult = HRESULT_FROM_WIN32(GetLastError());
 		goto lblCleanup;
 	}
 
-	if (!WriteFile(hOutputFile,
-				   ptBitmap,
-				   sizeof(*ptBitmap),
-				   &cbWritten,
-				   NULL))
+	hrResult = S_OK;
+
+lblCleanup:
+	CLOSE_TO_VALUE(hFind, FindClose, INVALID_HANDLE_VALUE);
+	HEAPFREE(pwszPath);
+
+	return hrResult;
+}
+
+STATIC
+HRESULT
+main_PrintDedupGroups(
+	_In_						PCDEDUP_FILES	ptFiles,
+	_In_reads_(ptFiles->nFiles)	CONST DWORD *	pnGroups
+)
+{
+	HRESULT	hrResult	= E_FAIL;
+	PDWORD	pnNext		= NULL;
+	DWORD	nIndex		= 0;
+	DWORD	nGroups		= 0;
+	DWORD	nMember		= 0;
+
+	assert(NULL != ptFiles);
+	assert(NULL != pnGroups);
+
+	pnNext = HEAPALLOC(max(ptFiles->nFiles, 1) * sizeof(pnNext[0]));
+	if (NULL == pnNext)
+	{
+		PROGRESS("Oops. Ran out of memory.");
+		hrResult = E_OUTOFMEMORY;
+		goto lblCleanup;
+	}
+
+	// Chain the members of each group after its first file.
+	// Going backwards keeps the chains in order.
+	for (nIndex = 0; nIndex < ptFiles->nFiles; ++nIndex)
+	{
+		pnNext[nIndex] = DEDUP_NO_FILE;
+	}
+	for (nIndex = ptFiles->nFiles; nIndex > 0; --nIndex)
+	{
+		if (pnGroups[nIndex - 1] != nIndex - 1)
+		{
+			pnNext[nIndex - 1] = pnNext[pnGroups[nIndex - 1]];
+			pnNext[pnGroups[nIndex - 1]] = nIndex - 1;
+		}
+	}
+
+	for (nIndex = 0; nIndex < ptFiles->nFiles; ++nIndex)
+	{
+		if (pnGroups[nIndex] != nIndex)
+		{
+			continue;
+		}
+
+		++nGroups;
+		if (DEDUP_NO_FILE == pnNext[nIndex])
+		{
+			// No duplicates.
+			continue;
+		}
+
+		(VOID)wprintf(L"%016I64X\n", ptFiles->pnFingerprints[nIndex]);
+		for (nMember = nIndex; DEDUP_NO_FILE != nMember; nMember = pnNext[nMember])
+		{
+			(VOID)wprintf(L"  %s\n", ptFiles->ppwszPaths[nMember]);
+		}
+	}
+
+	(VOID)wprintf(L"%lu files, %lu distinct screens.\n", ptFiles->nFiles, nGroups);
+
+	hrResult = S_OK;
+
+lblCleanup:
+	HEAPFREE(pnNext);
+
+	return hrResult;
+}
+
+STATIC
+HRESULT
+main_HandleDedup(
+	_In_					INT				nArguments,
+	_In_reads_(nArguments)	CONST PCWSTR *	ppwszArguments
+)
+{
+	HRESULT		hrResult		= E_FAIL;
+	PCWSTR		pwszDirectory	= NULL;
+	DWORD		nMaxDistance	= DEDUP_DEFAULT_MAX_DISTANCE;
+	PWSTR		pwszValueEnd	= NULL;
+	DEDUP_FILES	tFiles			= { 0 };
+	PDWORD		pnGroups		= NULL;
+	DWORD64		nStartTime		= 0;
+
+	assert(NULL != ppwszArguments);
+
+	// The distance is optional.
+	if ((SUBFUNCTION_DEDUP_ARGS_COUNT != nArguments) &&
+		(SUBFUNCTION_DEDUP_ARGS_COUNT - 1 != nArguments))
+	{
+		PROGRESS("Invalid number of arguments specified.");
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+
+	pwszDirectory = ppwszArguments[SUBFUNCTION_DEDUP_ARG_DIRECTORY];
+	if (SUBFUNCTION_DEDUP_ARGS_COUNT == nArguments)
+	{
+		nMaxDistance = wcstoul(ppwszArguments[SUBFUNCTION_DEDUP_ARG_MAX_DISTANCE], &pwszValueEnd, 10);
+		if ((pwszValueEnd == ppwszArguments[SUBFUNCTION_DEDUP_ARG_MAX_DISTANCE]) ||
+			(L'\0' != *pwszValueEnd) ||
+			(VGA_FINGERPRINT_MAX_DISTANCE < nMaxDistance))
+		{
+			PROGRESS("The distance must be between 0 and %d.", VGA_FINGERPRINT_MAX_DISTANCE);
+			hrResult = E_INVALIDARG;
+			goto lblCleanup;
+		}
+	}
+
+	PROGRESS("Fingerprinting the files in '%S'.", pwszDirectory);
+	hrResult = main_CollectDedupFiles(pwszDirectory, &tFiles);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	pnGroups = HEAPALLOC(max(tFiles.nFiles, 1) * sizeof(pnGroups[0]));
+	if (NULL == pnGroups)
+	{
+		PROGRESS("Oops. Ran out of memory.");
+		hrResult = E_OUTOFMEMORY;
+		goto lblCleanup;
+	}
+
+	PROGRESS("Grouping %lu fingerprints (distance %lu).", tFiles.nFiles, nMaxDistance);
+	nStartTime = __rdtsc();
+	hrResult = VGAFINGERPRINT_Group(tFiles.pnFingerprints,
+									tFiles.nFiles,
+									nMaxDistance,
+									pnGroups);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+	PROGRESS("Grouped in %I64u cycles.", __rdtsc() - nStartTime);
+
+	hrResult = main_PrintDedupGroups(&tFiles, pnGroups);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	hrResult = S_OK;
+
+lblCleanup:
+	HEAPFREE(pnGroups);
+	main_FreeDedupFiles(&tFiles);
+
+	return hrResult;
+}
+
+STATIC
+HRESULT
+main_HandleDiff(
+	_In_					INT				nArguments,
+	_In_reads_(nArguments)	CONST PCWSTR *	ppwszArguments
+)
+{
+	HRESULT					hrResult						= E_FAIL;
+	BOOL					bRaw							= FALSE;
+	LPCVOID					pvFirstCapture					= NULL;
+	DWORD					cbFirstCapture					= 0;
+	LPCVOID					pvSecondCapture					= NULL;
+	DWORD					cbSecondCapture					= 0;
+	VGA_CAPTURE_VIEW		tFirst							= { 0 };
+	VGA_CAPTURE_VIEW		tSecond							= { 0 };
+	PBYTE					pnMask							= NULL;
+	DWORD					cbMaskStride					= 0;
+	DWORD					nChangedPixels					= 0;
+	PRECT					ptRegions						= NULL;
+	DWORD					nRegions						= 0;
+	DWORD					nRegion							= 0;
+	RGBQUAD					atFirstPalette[VGA_COLORS]		= { { 0 } };
+	RGBQUAD					atSecondPalette[VGA_COLORS]		= { { 0 } };
+	PVGA_TRUECOLOR_BITMAP	ptBitmap						= NULL;
+	DWORD					cbBitmap						= 0;
+
+	assert(NULL != ppwszArguments);
+
+	if ((0 < nArguments) &&
+		(0 == wcscmp(ppwszArguments[0], DIFF_RAW_OPTION)))
+	{
+		bRaw = TRUE;
+		--nArguments;
+		++ppwszArguments;
+	}
+
+	// The output is optional.
+	if ((SUBFUNCTION_DIFF_ARGS_COUNT != nArguments) &&
+		(SUBFUNCTION_DIFF_ARGS_COUNT - 1 != nArguments))
+	{
+		PROGRESS("Invalid number of arguments specified.");
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+
+	hrResult = main_ReadCapture(ppwszArguments[SUBFUNCTION_DIFF_ARG_FIRST],
+								bRaw,
+								FALSE,
+								&pvFirstCapture,
+								&cbFirstCapture);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	hrResult = VGACAPTURE_Parse(pvFirstCapture, cbFirstCapture, &tFirst);
+	if (FAILED(hrResult))
+	{
+		PROGRESS("The first screenshot is invalid.");
+		goto lblCleanup;
+	}
+
+	hrResult = main_ReadCapture(ppwszArguments[SUBFUNCTION_DIFF_ARG_SECOND],
+								bRaw,
+								FALSE,
+								&pvSecondCapture,
+								&cbSecondCapture);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	hrResult = VGACAPTURE_Parse(pvSecondCapture, cbSecondCapture, &tSecond);
+	if (FAILED(hrResult))
+	{
+		PROGRESS("The second screenshot is invalid.");
+		goto lblCleanup;
+	}
+
+	hrResult = VGADIFF_Compare(&tFirst, &tSecond, &pnMask, &cbMaskStride, &nChangedPixels);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	hrResult = VGADIFF_FindRegions(pnMask,
+								   cbMaskStride,
+								   tSecond.nWidth,
+								   tSecond.nHeight,
+								   &ptRegions,
+								   &nRegions);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	if (0 == nChangedPixels)
+	{
+		(VOID)wprintf(L"No pixels differ.\n");
+	}
+	else
+	{
+		(VOID)wprintf(L"%lu pixels differ, in %lu regions:\n", nChangedPixels, nRegions);
+		for (nRegion = 0; nRegion < nRegions; ++nRegion)
+		{
+			(VOID)wprintf(L"  (%ld,%ld)-(%ld,%ld), %ldx%ld\n",
+						  ptRegions[nRegion].left,
+						  ptRegions[nRegion].top,
+						  ptRegions[nRegion].right,
+						  ptRegions[nRegion].bottom,
+						  ptRegions[nRegion].right - ptRegions[nRegion].left,
+						  ptRegions[nRegion].bottom - ptRegions[nRegion].top);
+		}
+	}
+
+	// The same pixel values may still be displayed differently.
+	main_GetPixelColors(&tFirst, atFirstPalette);
+	main_GetPixelColors(&tSecond, atSecondPalette);
+	if (0 != memcmp(atFirstPalette, atSecondPalette, sizeof(atFirstPalette)))
+	{
+		(VOID)wprintf(L"The palettes differ.\n");
+	}
+
+	if (SUBFUNCTION_DIFF_ARGS_COUNT == nArguments)
+	{
+		hrResult = main_VgaDumpToTrueColorBitmap(&tSecond, 0, &ptBitmap, &cbBitmap, NULL, NULL);
+		if (FAILED(hrResult))
+		{
+			PROGRESS("Failed converting the second screen.");
+			goto lblCleanup;
+		}
+
+		VGADIFF_Highlight(pnMask,
+						  cbMaskStride,
+						  tSecond.nWidth,
+						  tSecond.nHeight,
+						  ptRegions,
+						  nRegions,
+						  ptBitmap->atPixels);
+
+		hrResult = UTIL_WriteFile(ppwszArguments[SUBFUNCTION_DIFF_ARG_OUTPUT], ptBitmap, cbBitmap);
+		if (FAILED(hrResult))
+		{
+			PROGRESS("Failed writing the output file.");
+			goto lblCleanup;
+		}
+	}
+
+	hrResult = S_OK;
+
+lblCleanup:
+	HEAPFREE(ptBitmap);
+	HEAPFREE(ptRegions);
+	HEAPFREE(pnMask);
+	RELEASE_CAPTURE(pvSecondCapture, cbSecondCapture, bRaw);
+	RELEASE_CAPTURE(pvFirstCapture, cbFirstCapture, bRaw);
+
+	return hrResult;
+}
+
+STATIC
+HRESULT
+main_GetChangedRect(
+	_In_opt_	PCVGA_CAPTURE_VIEW	ptPrevious,
+	_In_		PCVGA_CAPTURE_VIEW	ptCurrent,
+	_Out_		PRECT				ptChanged
+)
+{
+	HRESULT	hrResult						= E_FAIL;
+	RGBQUAD	atPreviousPalette[VGA_COLORS]	= { { 0 } };
+	RGBQUAD	atCurrentPalette[VGA_COLORS]	= { { 0 } };
+	PBYTE	pnMask							= NULL;
+	DWORD	cbMaskStride					= 0;
+	DWORD	nChangedPixels					= 0;
+	PRECT	ptRegions						= NULL;
+	DWORD	nRegions						= 0;
+	DWORD	nRegion							= 0;
+
+	assert(NULL != ptCurrent);
+	assert(NULL != ptChanged);
+	assert((NULL == ptPrevious) ||
+		   ((ptPrevious->nWidth == ptCurrent->nWidth) &&
+			(ptPrevious->nHeight == ptCurrent->nHeight)));
+
+	ptChanged->left = 0;
+	ptChanged->top = 0;
+	ptChanged->right = (LONG)ptCurrent->nWidth;
+	ptChanged->bottom = (LONG)ptCurrent->nHeight;
+
+	// Screens of different modes can't be compared,
+	// and new colors may change any pixel.
+	if ((NULL == ptPrevious) ||
+		(ptPrevious->eMode != ptCurrent->eMode) ||
+		((VGA_CAPTURE_MODE_TEXT == ptCurrent->eMode) &&
+		 (ptPrevious->tText.nCharHeight != ptCurrent->tText.nCharHeight)))
+	{
+		hrResult = S_OK;
+		goto lblCleanup;
+	}
+	main_GetPixelColors(ptPrevious, atPreviousPalette);
+	main_GetPixelColors(ptCurrent, atCurrentPalette);
+	if (0 != memcmp(atPreviousPalette, atCurrentPalette, sizeof(atCurrentPalette)))
+	{
+		hrResult = S_OK;
+		goto lblCleanup;
+	}
+
+	hrResult = VGADIFF_Compare(ptPrevious, ptCurrent, &pnMask, &cbMaskStride, &nChangedPixels);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	hrResult = VGADIFF_FindRegions(pnMask,
+								   cbMaskStride,
+								   ptCurrent->nWidth,
+								   ptCurrent->nHeight,
+								   &ptRegions,
+								   &nRegions);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	if (0 == nRegions)
+	{
+		// A frame can't be empty, so redraw a pixel that stayed the same.
+		ptChanged->right = 1;
+		ptChanged->bottom = 1;
+	}
+	else
+	{
+		*ptChanged = ptRegions[0];
+		for (nRegion = 1; nRegion < nRegions; ++nRegion)
+		{
+			ptChanged->left = min(ptChanged->left, ptRegions[nRegion].left);
+			ptChanged->top = min(ptChanged->top, ptRegions[nRegion].top);
+			ptChanged->right = max(ptChanged->right, ptRegions[nRegion].right);
+			ptChanged->bottom = max(ptChanged->bottom, ptRegions[nRegion].bottom);
+		}
+	}
+
+	hrResult = S_OK;
+
+lblCleanup:
+	HEAPFREE(ptRegions);
+	HEAPFREE(pnMask);
+
+	return hrResult;
+}
+
+STATIC
+HRESULT
+main_WriteAnimationFrame(
+	_In_	HVGAGIF				hGif,
+	_In_	PCVGA_CAPTURE_VIEW	ptCapture,
+	_In_	CONST RECT *		ptFrame,
+	_In_	WORD				nDelay
+)
+{
+	HRESULT			hrResult				= E_FAIL;
+	RGBQUAD			atPalette[VGA_COLORS]	= { { 0 } };
+	DWORD			cbRow					= 0;
+	DWORD			nBandRows				= 0;
+	DWORD			cbPixels				= 0;
+	PBYTE			pnPixels				= NULL;
+	DWORD			nFirstRow				= 0;
+	DWORD			nEndRow					= 0;
+	DWORD			nRow					= 0;
+	DWORD			nRows					= 0;
+	DWORD			nBandRow				= 0;
+	CONST BYTE *	pnRows					= NULL;
+
+	assert(NULL != hGif);
+	assert(NULL != ptCapture);
+	assert(NULL != ptFrame);
+	assert((0 <= ptFrame->left) && (ptFrame->left < ptFrame->right));
+	assert((0 <= ptFrame->top) && (ptFrame->top < ptFrame->bottom));
+	assert((DWORD)ptFrame->right <= ptCapture->nWidth);
+	assert((DWORD)ptFrame->bottom <= ptCapture->nHeight);
+
+	cbRow = (ptCapture->nWidth + 3) & ~3UL;
+	nBandRows = main_GetBandRows(ptCapture, cbRow);
+	hrResult = DWordMult(cbRow, nBandRows, &cbPixels);
+	if (FAILED(hrResult))
+	{
+		PROGRESS("The image is too big.");
+		goto lblCleanup;
+	}
+
+	pnPixels = HEAPALLOC(cbPixels);
+	if (NULL == pnPixels)
+	{
+		PROGRESS("Oops. Ran out of memory.");
+		hrResult = E_OUTOFMEMORY;
+		goto lblCleanup;
+	}
+
+	main_GetPixelColors(ptCapture, atPalette);
+	hrResult = VGAGIF_StartFrame(hGif, ptFrame, atPalette, nDelay);
+	if (FAILED(hrResult))
+	{
+		PROGRESS("Failed starting the frame.");
+		goto lblCleanup;
+	}
+
+	// Text mode bands must start and end between character rows.
+	nFirstRow = (DWORD)ptFrame->top;
+	nEndRow = (DWORD)ptFrame->bottom;
+	if (VGA_CAPTURE_MODE_TEXT == ptCapture->eMode)
+	{
+		nFirstRow -= nFirstRow % ptCapture->tText.nCharHeight;
+		nEndRow = min(nEndRow + ptCapture->tText.nCharHeight - 1, ptCapture->nHeight);
+		nEndRow -= nEndRow % ptCapture->tText.nCharHeight;
+	}
+
+	// Only the rows the frame covers are decoded.
+	for (nRow = nFirstRow; nRow < nEndRow; nRow += nRows)
+	{
+		nRows = min(nBandRows, nEndRow - nRow);
+		pnRows = main_GetBand(ptCapture, NULL, nRow, nRows, 8, pnPixels, cbRow);
+
+		for (nBandRow = 0; nBandRow < nRows; ++nBandRow)
+		{
+			if ((nRow + nBandRow < (DWORD)ptFrame->top) ||
+				(nRow + nBandRow >= (DWORD)ptFrame->bottom))
+			{
+				continue;
+			}
+
+			hrResult = VGAGIF_WriteRow(hGif, pnRows + (nBandRow * cbRow) + ptFrame->left);
+			if (FAILED(hrResult))
+			{
+				PROGRESS("Failed writing row %lu.", nRow + nBandRow);
+				goto lblCleanup;
+			}
+		}
+	}
+
+	hrResult = S_OK;
+
+lblCleanup:
+	HEAPFREE(pnPixels);
+
+	return hrResult;
+}
+
+STATIC
+HRESULT
+main_HandleAnimate(
+	_In_					INT				nArguments,
+	_In_reads_(nArguments)	CONST PCWSTR *	ppwszArguments
+)
+{
+	HRESULT				hrResult				= E_FAIL;
+	BOOL				bRaw					= FALSE;
+	DWORD				nDelay					= ANIMATE_DEFAULT_DELAY;
+	INT					nFrame					= 0;
+	LPCVOID				pvPreviousCapture		= NULL;
+	DWORD				cbPreviousCapture		= 0;
+	LPCVOID				pvCapture				= NULL;
+	DWORD				cbCapture				= 0;
+	VGA_CAPTURE_VIEW	tPrevious				= { 0 };
+	VGA_CAPTURE_VIEW	tCurrent				= { 0 };
+	RECT				tChanged				= { 0 };
+	RGBQUAD				atPalette[VGA_COLORS]	= { { 0 } };
+	HVGASTREAM			hStream					= NULL;
+	HVGAGIF				hGif					= NULL;
+
+	assert(NULL != ppwszArguments);
+
+	while (0 < nArguments)
+	{
+		if (0 == wcscmp(ppwszArguments[0], ANIMATE_RAW_OPTION))
+		{
+			bRaw = TRUE;
+		}
+		else if (0 == wcsncmp(ppwszArguments[0],
+							  ANIMATE_DELAY_OPTION,
+							  wcslen(ANIMATE_DELAY_OPTION)))
+		{
+			hrResult = main_ParseNumber(ppwszArguments[0] + wcslen(ANIMATE_DELAY_OPTION), &nDelay);
+			if (FAILED(hrResult))
+			{
+				goto lblCleanup;
+			}
+			if (MAXWORD < nDelay)
+			{
+				PROGRESS("The delay can be at most %lu.", (DWORD)MAXWORD);
+				hrResult = E_INVALIDARG;
+				goto lblCleanup;
+			}
+		}
+		else
+		{
+			// Options are over.
+			break;
+		}
+		--nArguments;
+		++ppwszArguments;
+	}
+
+	// Any number of frames may follow the first.
+	if (SUBFUNCTION_ANIMATE_ARGS_COUNT > nArguments)
+	{
+		PROGRESS("Invalid number of arguments specified.");
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+
+	hrResult = VGASTREAM_Create(ppwszArguments[SUBFUNCTION_ANIMATE_ARG_OUTPUT], &hStream);
+	if (FAILED(hrResult))
+	{
+		PROGRESS("Failed opening the output file.");
+		goto lblCleanup;
+	}
+
+	// Only the previous screen is kept around, to compare against.
+	for (nFrame = SUBFUNCTION_ANIMATE_ARG_FIRST_FRAME; nFrame < nArguments; ++nFrame)
+	{
+		hrResult = main_ReadCapture(ppwszArguments[nFrame], bRaw, FALSE, &pvCapture, &cbCapture);
+		if (FAILED(hrResult))
+		{
+			goto lblCleanup;
+		}
+
+		hrResult = VGACAPTURE_Parse(pvCapture, cbCapture, &tCurrent);
+		if (FAILED(hrResult))
+		{
+			PROGRESS("The screenshot '%S' is invalid.", ppwszArguments[nFrame]);
+			goto lblCleanup;
+		}
+
+		if (NULL == hGif)
+		{
+			main_GetPixelColors(&tCurrent, atPalette);
+			hrResult = VGAGIF_Create(tCurrent.nWidth,
+									 tCurrent.nHeight,
+									 atPalette,
+									 hStream,
+									 &hGif);
+			if (FAILED(hrResult))
+			{
+				PROGRESS("Failed starting the animation.");
+				goto lblCleanup;
+			}
+		}
+		else if ((tPrevious.nWidth != tCurrent.nWidth) ||
+				 (tPrevious.nHeight != tCurrent.nHeight))
+		{
+			PROGRESS("All frames must be the same size (%lux%lu and %lux%lu).",
+					 tPrevious.nWidth,
+					 tPrevious.nHeight,
+					 tCurrent.nWidth,
+					 tCurrent.nHeight);
+			hrResult = E_INVALIDARG;
+			goto lblCleanup;
+		}
+
+		hrResult = main_GetChangedRect((NULL == pvPreviousCapture) ? NULL : &tPrevious,
+									   &tCurrent,
+									   &tChanged);
+		if (FAILED(hrResult))
+		{
+			goto lblCleanup;
+		}
+
+		PROGRESS("Frame %d: (%ld,%ld)-(%ld,%ld).",
+				 nFrame - SUBFUNCTION_ANIMATE_ARG_FIRST_FRAME,
+				 tChanged.left,
+				 tChanged.top,
+				 tChanged.right,
+				 tChanged.bottom);
+		hrResult = main_WriteAnimationFrame(hGif, &tCurrent, &tChanged, (WORD)nDelay);
+		if (FAILED(hrResult))
+		{
+			goto lblCleanup;
+		}
+
+		// The view points into the capture, so they move together.
+		RELEASE_CAPTURE(pvPreviousCapture, cbPreviousCapture, bRaw);
+		pvPreviousCapture = pvCapture;
+		cbPreviousCapture = cbCapture;
+		pvCapture = NULL;
+		tPrevious = tCurrent;
+	}
+
+	hrResult = VGAGIF_Finish(hGif);
+	if (FAILED(hrResult))
+	{
+		PROGRESS("Failed finishing the animation.");
+		goto lblCleanup;
+	}
+
+	hrResult = VGASTREAM_Flush(hStream);
+	if (FAILED(hrResult))
+	{
+		PROGRESS("Failed writing the output file.");
+		goto lblCleanup;
+	}
+
+	hrResult = S_OK;
+
+lblCleanup:
+	VGAGIF_Destroy(hGif);
+	VGASTREAM_Close(hStream);
+	RELEASE_CAPTURE(pvCapture, cbCapture, bRaw);
+	RELEASE_CAPTURE(pvPreviousCapture, cbPreviousCapture, bRaw);
+
+	return hrResult;
+}
+
+STATIC
+HRESULT
+main_DrawMosaicTile(
+	_In_	PMOSAIC_JOBS		ptJobs,
+	_In_	DWORD				nInput,
+	_In_	PCVGA_CAPTURE_VIEW	ptCapture
+)
+{
+	HRESULT		hrResult				= E_FAIL;
+	DWORD		nWidth					= 0;
+	DWORD		nHeight					= 0;
+	DWORD		nStride					= 0;
+	RGBQUAD *	ptTile					= NULL;
+	RGBQUAD		atPalette[VGA_COLORS]	= { { 0 } };
+
+	assert(NULL != ptJobs);
+	assert(nInput < ptJobs->nInputs);
+	assert(NULL != ptCapture);
+
+	hrResult = VGATHUMBNAIL_GetSize(ptCapture, ptJobs->nScale, &nWidth, &nHeight);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+	if ((ptJobs->nTileWidth < nWidth) ||
+		(ptJobs->nTileHeight < nHeight))
+	{
+		PROGRESS("A %lux%lu thumbnail doesn't fit in a %lux%lu tile.",
+				 nWidth,
+				 nHeight,
+				 ptJobs->nTileWidth,
+				 ptJobs->nTileHeight);
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+
+	// The mosaic was checked for overflow when it was allocated.
+	nStride = ptJobs->nColumns * ptJobs->nTileWidth;
+	ptTile = ptJobs->ptPixels +
+			 ((nInput / ptJobs->nColumns) * ptJobs->nTileHeight * nStride) +
+			 ((nInput % ptJobs->nColumns) * ptJobs->nTileWidth);
+
+	main_GetPixelColors(ptCapture, atPalette);
+	hrResult = VGATHUMBNAIL_RenderTile(ptCapture, atPalette, ptJobs->nScale, ptTile, nStride);
+
+lblCleanup:
+	return hrResult;
+}
+
+STATIC
+VOID
+main_RunMosaicJob(
+	_Inout_	PMOSAIC_JOBS	ptJobs,
+	_In_	DWORD			nInput
+)
+{
+	HRESULT				hrResult	= E_FAIL;
+	LPCVOID				pvCapture	= NULL;
+	DWORD				cbCapture	= 0;
+	VGA_CAPTURE_VIEW	tCapture	= { 0 };
+
+	assert(NULL != ptJobs);
+	assert(nInput < ptJobs->nInputs);
+
+	hrResult = main_ReadCapture(ptJobs->ppwszInputs[nInput], ptJobs->bRaw, FALSE, &pvCapture, &cbCapture);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	hrResult = VGACAPTURE_Parse(pvCapture, cbCapture, &tCapture);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	hrResult = main_DrawMosaicTile(ptJobs, nInput, &tCapture);
+
+lblCleanup:
+	if (FAILED(hrResult))
+	{
+		PROGRESS("Failed drawing '%S', leaving its tile black.", ptJobs->ppwszInputs[nInput]);
+		(VOID)InterlockedIncrement(&(ptJobs->nFailures));
+	}
+	RELEASE_CAPTURE(pvCapture, cbCapture, ptJobs->bRaw);
+}
+
+STATIC
+VOID
+CALLBACK
+main_MosaicWorkCallback(
+	_Inout_		PTP_CALLBACK_INSTANCE	ptInstance,
+	_Inout_opt_	PVOID					pvContext,
+	_Inout_		PTP_WORK				ptWork
+)
+{
+	PMOSAIC_JOBS	ptJobs	= (PMOSAIC_JOBS)pvContext;
+	LONG			nInput	= 0;
+
+	UNREFERENCED_PARAMETER(ptInstance);
+	UNREFERENCED_PARAMETER(ptWork);
+	assert(NULL != ptJobs);
+
+	// Every callback takes the next screen nobody has taken yet.
+	nInput = InterlockedIncrement(&(ptJobs->nNextInput)) - 1;
+	assert((DWORD)nInput < ptJobs->nInputs);
+
+	main_RunMosaicJob(ptJobs, (DWORD)nInput);
+}
+
+STATIC
+HRESULT
+main_HandleMosaic(
+	_In_					INT				nArguments,
+	_In_reads_(nArguments)	CONST PCWSTR *	ppwszArguments
+)
+{
+	HRESULT					hrResult	= E_FAIL;
+	MOSAIC_JOBS				tJobs		= { 0 };
+	DWORD					nRows		= 0;
+	DWORD					nWidth		= 0;
+	DWORD					nHeight		= 0;
+	LPCVOID					pvCapture	= NULL;
+	DWORD					cbCapture	= 0;
+	VGA_CAPTURE_VIEW		tCapture	= { 0 };
+	PVGA_TRUECOLOR_BITMAP	ptBitmap	= NULL;
+	DWORD					cbBitmap	= 0;
+	PTP_WORK				ptWork		= NULL;
+	DWORD					nInput		= 0;
+
+	assert(NULL != ppwszArguments);
+
+	tJobs.nScale = MOSAIC_DEFAULT_SCALE;
+
+	while (0 < nArguments)
+	{
+		if (0 == wcscmp(ppwszArguments[0], MOSAIC_RAW_OPTION))
+		{
+			tJobs.bRaw = TRUE;
+		}
+		else if (0 == wcsncmp(ppwszArguments[0],
+							  MOSAIC_SCALE_OPTION,
+							  wcslen(MOSAIC_SCALE_OPTION)))
+		{
+			hrResult = main_ParseNumber(ppwszArguments[0] + wcslen(MOSAIC_SCALE_OPTION), &(tJobs.nScale));
+			if (FAILED(hrResult))
+			{
+				goto lblCleanup;
+			}
+		}
+		else if (0 == wcsncmp(ppwszArguments[0],
+							  MOSAIC_COLUMNS_OPTION,
+							  wcslen(MOSAIC_COLUMNS_OPTION)))
+		{
+			hrResult = main_ParseNumber(ppwszArguments[0] + wcslen(MOSAIC_COLUMNS_OPTION), &(tJobs.nColumns));
+			if (FAILED(hrResult))
+			{
+				goto lblCleanup;
+			}
+			if (0 == tJobs.nColumns)
+			{
+				PROGRESS("The mosaic needs at least one column.");
+				hrResult = E_INVALIDARG;
+				goto lblCleanup;
+			}
+		}
+		else
+		{
+			// Options are over.
+			break;
+		}
+		--nArguments;
+		++ppwszArguments;
+	}
+
+	// Any number of screens may follow the first.
+	if (SUBFUNCTION_MOSAIC_ARGS_COUNT > nArguments)
+	{
+		PROGRESS("Invalid number of arguments specified.");
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+	tJobs.ppwszInputs = ppwszArguments + SUBFUNCTION_MOSAIC_ARG_FIRST_INPUT;
+	tJobs.nInputs = (DWORD)(nArguments - SUBFUNCTION_MOSAIC_ARG_FIRST_INPUT);
+
+	// As square as possible, unless specified otherwise.
+	if (0 == tJobs.nColumns)
+	{
+		for (tJobs.nColumns = 1;
+			 tJobs.nColumns * tJobs.nColumns < tJobs.nInputs;
+			 ++(tJobs.nColumns))
+		{
+			;
+		}
+	}
+	tJobs.nColumns = min(tJobs.nColumns, tJobs.nInputs);
+	nRows = (tJobs.nInputs + tJobs.nColumns - 1) / tJobs.nColumns;
+
+	// The first screen sets the size of the tiles.
+	hrResult = main_ReadCapture(tJobs.ppwszInputs[0], tJobs.bRaw, FALSE, &pvCapture, &cbCapture);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	hrResult = VGACAPTURE_Parse(pvCapture, cbCapture, &tCapture);
+	if (FAILED(hrResult))
+	{
+		PROGRESS("The first screenshot is invalid.");
+		goto lblCleanup;
+	}
+
+	hrResult = VGATHUMBNAIL_GetSize(&tCapture, tJobs.nScale, &(tJobs.nTileWidth), &(tJobs.nTileHeight));
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	hrResult = DWordMult(tJobs.nColumns, tJobs.nTileWidth, &nWidth);
+	if (FAILED(hrResult))
+	{
+		PROGRESS("The image is too big.");
+		goto lblCleanup;
+	}
+	hrResult = DWordMult(nRows, tJobs.nTileHeight, &nHeight);
+	if (FAILED(hrResult))
+	{
+		PROGRESS("The image is too big.");
+		goto lblCleanup;
+	}
+
+	PROGRESS("Tiling %lu screens %lu to a row, in a %lux%lu mosaic.",
+			 tJobs.nInputs,
+			 tJobs.nColumns,
+			 nWidth,
+			 nHeight);
+	hrResult = main_AllocateTrueColorBitmap(nWidth, nHeight, &ptBitmap, &cbBitmap);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+	tJobs.ptPixels = ptBitmap->atPixels;
+
+	hrResult = main_DrawMosaicTile(&tJobs, 0, &tCapture);
+	if (FAILED(hrResult))
+	{
+		PROGRESS("Failed drawing the first screen.");
+		goto lblCleanup;
+	}
+	RELEASE_CAPTURE(pvCapture, cbCapture, tJobs.bRaw);
+
+	if (1 < tJobs.nInputs)
+	{
+		tJobs.nNextInput = 1;
+
+		ptWork = CreateThreadpoolWork(&main_MosaicWorkCallback, &tJobs, NULL);
+		if (NULL == ptWork)
+		{
+			hrResult = HRESULT_FROM_WIN32(GetLastError());
+			goto lblCleanup;
+		}
+
+		// Every screen has a tile of its own, so all of them can be drawn at once.
+		for (nInput = 1; nInput < tJobs.nInputs; ++nInput)
+		{
+			SubmitThreadpoolWork(ptWork);
+		}
+		WaitForThreadpoolWorkCallbacks(ptWork, FALSE);
+	}
+
+	if (0 != tJobs.nFailures)
+	{
+		PROGRESS("%ld of the %lu screens couldn't be drawn.", tJobs.nFailures, tJobs.nInputs);
+	}
+
+	hrResult = UTIL_WriteFile(ppwszArguments[SUBFUNCTION_MOSAIC_ARG_OUTPUT], ptBitmap, cbBitmap);
+	if (FAILED(hrResult))
+	{
+		PROGRESS("Failed writing the output file.");
+		goto lblCleanup;
+	}
+
+	hrResult = S_OK;
+
+lblCleanup:
+	CLOSE(ptWork, CloseThreadpoolWork);
+	HEAPFREE(ptBitmap);
+	RELEASE_CAPTURE(pvCapture, cbCapture, tJobs.bRaw);
+
+	return hrResult;
+}
+
+STATIC
+HRESULT
+main_HandleTags(
+	_In_					INT				nArguments,
+	_In_reads_(nArguments)	CONST PCWSTR *	ppwszArguments
+)
+{
+	HRESULT				hrResult	= E_FAIL;
+	BOOL				bIndexed	= FALSE;
+	PCWSTR				pwszPath	= NULL;
+	HDUMP				hDump		= NULL;
+	DUMPPARSE_DUMP_INFO	tInfo		= { 0 };
+	PDUMPPARSE_TAG		patTags		= NULL;
+	DWORD				nTags		= 0;
+	DWORD				nTag		= 0;
+	LPCGUID				ptTag		= NULL;
+
+	assert(NULL != ppwszArguments);
+
+	if ((0 < nArguments) &&
+		(0 == wcscmp(ppwszArguments[0], TAGS_INDEX_OPTION)))
+	{
+		bIndexed = TRUE;
+		--nArguments;
+		++ppwszArguments;
+	}
+
+	// The dump is optional.
+	if ((SUBFUNCTION_TAGS_ARGS_COUNT != nArguments) &&
+		(SUBFUNCTION_TAGS_ARGS_COUNT - 1 != nArguments))
+	{
+		PROGRESS("Invalid number of arguments specified.");
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+
+	if (SUBFUNCTION_TAGS_ARGS_COUNT == nArguments)
+	{
+		pwszPath = ppwszArguments[SUBFUNCTION_TAGS_ARG_INPUT];
+	}
+
+	hrResult = DUMPPARSE_OpenWithReader(pwszPath,
+										bIndexed ? DUMPPARSE_READER_INDEXED : DUMPPARSE_READER_NATIVE,
+										&hDump);
+	if (FAILED(hrResult))
+	{
+		PROGRESS("Failed opening the dump file.");
+		goto lblCleanup;
+	}
+
+	hrResult = DUMPPARSE_GetDumpInfo(hDump, &tInfo);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	hrResult = DUMPPARSE_EnumerateTags(hDump, &patTags, &nTags);
+	if (FAILED(hrResult))
+	{
+		PROGRESS("Failed listing the tagged data.");
+		goto lblCleanup;
+	}
+
+	(VOID)wprintf(L"%u-bit dump of type %lu from build %lu, %I64u pages at 0x%016I64X, secondary data at 0x%016I64X\n",
+				  tInfo.b64Bit ? 64 : 32,
+				  tInfo.eDumpType,
+				  tInfo.nBuildNumber,
+				  tInfo.nPages,
+				  tInfo.nFirstPage,
+				  tInfo.nSecondaryData);
+
+	for (nTag = 0; nTag < nTags; ++nTag)
+	{
+		ptTag = &(patTags[nTag].tTag);
+		(VOID)wprintf(L"{%08lX-%04hX-%04hX-%02X%02X-%02X%02X%02X%02X%02X%02X} at 0x%016I64X, %lu bytes%s\n",
+					  ptTag->Data1,
+					  ptTag->Data2,
+					  ptTag->Data3,
+					  ptTag->Data4[0],
+					  ptTag->Data4[1],
+					  ptTag->Data4[2],
+					  ptTag->Data4[3],
+					  ptTag->Data4[4],
+					  ptTag->Data4[5],
+					  ptTag->Data4[6],
+					  ptTag->Data4[7],
+					  patTags[nTag].nOffset,
+					  patTags[nTag].cbData,
+					  IsEqualGUID(ptTag, &g_tVgaDumpGuid) ? L" (screenshot)" : L"");
+	}
+
+	PROGRESS("The dump has %lu tagged records.", nTags);
+
+	hrResult = S_OK;
+
+lblCleanup:
+	HEAPFREE(patTags);
+	CLOSE(hDump, DUMPPARSE_Close);
+
+	return hrResult;
+}
+
+STATIC
+HRESULT
+main_ParseNumber(
+	_In_	PCWSTR	pwszValue,
+	_Out_	PDWORD	pnValue
+)
+{
+	HRESULT	hrResult		= E_FAIL;
+	PWSTR	pwszValueEnd	= NULL;
+	ULONG	nValue			= 0;
+
+	assert(NULL != pwszValue);
+	assert(NULL != pnValue);
+
+	nValue = wcstoul(pwszValue, &pwszValueEnd, 10);
+	if ((pwszValueEnd == pwszValue) ||
+		(L'\0' != *pwszValueEnd))
+	{
+		PROGRESS("Invalid number '%S'.", pwszValue);
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+
+	*pnValue = nValue;
+
+	hrResult = S_OK;
+
+lblCleanup:
+	return hrResult;
+}
+
+STATIC
+HRESULT
+main_HandleSynth(
+	_In_					INT				nArguments,
+	_In_reads_(nArguments)	CONST PCWSTR *	ppwszArguments
+)
+{
+	HRESULT			hrResult										= E_FAIL;
+	VGA_SYNTH_KIND	eKind											= VGA_SYNTH_KIND_SOLID;
+	DWORD			nWidth											= 0;
+	DWORD			nHeight											= 0;
+	DWORD			nSeed											= 0;
+	DWORD			cbPixels										= 0;
+	PBYTE			pnPixels										= NULL;
+	PALETTE_ENTRY	atPaletteEntries[VGA_DAC_PALETTE_ENTRIES]		= { { 0 } };
+	PVOID			pvCapture										= NULL;
+	DWORD			cbCapture										= 0;
+
+	assert(NULL != ppwszArguments);
+
+	if (SUBFUNCTION_SYNTH_ARGS_COUNT != nArguments)
+	{
+		PROGRESS("Invalid number of arguments specified.");
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+
+	hrResult = VGASYNTH_ParseKind(ppwszArguments[SUBFUNCTION_SYNTH_ARG_KIND], &eKind);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	hrResult = main_ParseNumber(ppwszArguments[SUBFUNCTION_SYNTH_ARG_WIDTH], &nWidth);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	hrResult = main_ParseNumber(ppwszArguments[SUBFUNCTION_SYNTH_ARG_HEIGHT], &nHeight);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	hrResult = main_ParseNumber(ppwszArguments[SUBFUNCTION_SYNTH_ARG_SEED], &nSeed);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	hrResult = DWordMult(nWidth, nHeight, &cbPixels);
+	if (FAILED(hrResult))
+	{
+		PROGRESS("The screen is too large.");
+		goto lblCleanup;
+	}
+
+	pnPixels = HEAPALLOC(max(cbPixels, 1));
+	if (NULL == pnPixels)
+	{
+		PROGRESS("Oops. Ran out of memory.");
+		hrResult = E_OUTOFMEMORY;
+		goto lblCleanup;
+	}
+
+	PROGRESS("Generating a %lux%lu %S screen (seed %lu).",
+			 nWidth,
+			 nHeight,
+			 VGASYNTH_GetKindName(eKind),
+			 nSeed);
+	VGASYNTH_Generate(eKind, nSeed, nWidth, nHeight, pnPixels, nWidth);
+	VGASYNTH_GetPalette(atPaletteEntries);
+
+	hrResult = VGAENCODE_CreateCapture(pnPixels,
+									   nWidth,
+									   nWidth,
+									   nHeight,
+									   atPaletteEntries,
+									   FALSE,
+									   &pvCapture,
+									   &cbCapture);
+	if (FAILED(hrResult))
+	{
+		PROGRESS("Failed encoding the screen.");
+		goto lblCleanup;
+	}
+
+	hrResult = UTIL_WriteFile(ppwszArguments[SUBFUNCTION_SYNTH_ARG_OUTPUT], pvCapture, cbCapture);
+	if (FAILED(hrResult))
+	{
+		PROGRESS("Failed writing the capture file.");
+		goto lblCleanup;
+	}
+
+	hrResult = S_OK;
+
+lblCleanup:
+	HEAPFREE(pvCapture);
+	HEAPFREE(pnPixels);
+
+	return hrResult;
+}
+
+STATIC
+VOID
+main_FindContent(
+	_In_reads_(nWidth * nHeight)	CONST BYTE *	pnPixels,
+	_In_							DWORD			nWidth,
+	_In_							DWORD			nHeight,
+	_Out_							PRECT			ptContent
+)
+{
+	RECT	tContent	= { 0 };
+	DWORD	nRow		= 0;
+	DWORD	nColumn		= 0;
+
+	assert(NULL != pnPixels);
+	assert(NULL != ptContent);
+
+	for (nRow = 0; nRow < nHeight; ++nRow)
+	{
+		for (nColumn = 0; nColumn < nWidth; ++nColumn)
+		{
+			if (pnPixels[(nRow * nWidth) + nColumn] == pnPixels[0])
+			{
+				continue;
+			}
+
+			if (tContent.bottom <= tContent.top)
+			{
+				tContent.left = (LONG)nColumn;
+				tContent.top = (LONG)nRow;
+				tContent.right = (LONG)nColumn + 1;
+			}
+			else
+			{
+				tContent.left = min(tContent.left, (LONG)nColumn);
+				tContent.right = max(tContent.right, (LONG)nColumn + 1);
+			}
+			tContent.bottom = (LONG)nRow + 1;
+		}
+	}
+
+	*ptContent = tContent;
+}
+
+STATIC
+HRESULT
+main_CheckRoundTrip(
+	_In_	VGA_SYNTH_KIND	eKind,
+	_In_	DWORD			nSeed,
+	_In_	DWORD			nWidth,
+	_In_	DWORD			nHeight,
+	_In_	BOOL			bLegacy,
+	_Out_	PDWORD64		pnCycles
+)
+{
+	HRESULT				hrResult										= E_FAIL;
+	DWORD				nPixels											= nWidth * nHeight;
+	DWORD				cbNibbleRow										= ((nWidth + 7) / PIXELS_IN_BYTE) * sizeof(DWORD);
+	PBYTE				pnPixels										= NULL;
+	PBYTE				pnExpected										= NULL;
+	PBYTE				pnDecoded										= NULL;
+	RGBQUAD *			ptDecoded										= NULL;
+	PBYTE				pnNibbles										= NULL;
+	PALETTE_ENTRY		atPaletteEntries[VGA_DAC_PALETTE_ENTRIES]		= { { 0 } };
+	RGBQUAD				atPalette[VGA_COLORS]							= { { 0 } };
+	PVOID				pvCapture										= NULL;
+	DWORD				cbCapture										= 0;
+	VGA_CAPTURE_VIEW	tCapture										= { 0 };
+	RECT				tContent										= { 0 };
+	RECT				tExpectedContent								= { 0 };
+	DWORD64				nStartTime										= 0;
+	DWORD				nPixel											= 0;
+	DWORD				nRow											= 0;
+	DWORD				nColumn											= 0;
+	BYTE				nNibble											= 0;
+
+	assert(VGA_SYNTH_KINDS > eKind);
+	assert(NULL != pnCycles);
+
+	// Only geometries that fit in the planes are tested,
+	// so the sizes can't overflow.
+	pnPixels = HEAPALLOC(nPixels);
+	pnExpected = HEAPALLOC(nPixels);
+	pnDecoded = HEAPALLOC(nPixels);
+	ptDecoded = HEAPALLOC(nPixels * sizeof(ptDecoded[0]));
+	pnNibbles = HEAPALLOC(cbNibbleRow * nHeight);
+	if ((NULL == pnPixels) ||
+		(NULL == pnExpected) ||
+		(NULL == pnDecoded) ||
+		(NULL == ptDecoded) ||
+		(NULL == pnNibbles))
+	{
+		PROGRESS("Oops. Ran out of memory.");
+		hrResult = E_OUTOFMEMORY;
+		goto lblCleanup;
+	}
+
+	VGASYNTH_Generate(eKind, nSeed, nWidth, nHeight, pnPixels, nWidth);
+	VGASYNTH_GetPalette(atPaletteEntries);
+
+	hrResult = VGAENCODE_CreateCapture(pnPixels,
+									   nWidth,
+									   nWidth,
+									   nHeight,
+									   atPaletteEntries,
+									   bLegacy,
+									   &pvCapture,
+									   &cbCapture);
+	if (FAILED(hrResult))
+	{
+		PROGRESS("Failed encoding the screen.");
+		goto lblCleanup;
+	}
+
+	hrResult = VGACAPTURE_Parse(pvCapture, cbCapture, &tCapture);
+	if (FAILED(hrResult))
+	{
+		PROGRESS("The encoded capture is invalid.");
+		goto lblCleanup;
+	}
+	if ((nWidth != tCapture.nWidth) ||
+		(nHeight != tCapture.nHeight))
+	{
+		PROGRESS("The encoded capture is %lux%lu.", tCapture.nWidth, tCapture.nHeight);
+		hrResult = HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+		goto lblCleanup;
+	}
+
+	// The per-pixel reference shares nothing with the encoder or the decoders
+	// but the layout of the planes, so it checks the encoder here,
+	// and the decoders are then checked against it.
+	VGADECODE_DecodeImageReference(tCapture.apnPlanes,
+								   tCapture.cbStride,
+								   nWidth,
+								   nHeight,
+								   pnExpected,
+								   nWidth);
+	if (0 != memcmp(pnExpected, pnPixels, nPixels))
+	{
+		PROGRESS("The reference decoder doesn't get the screen back.");
+		hrResult = HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+		goto lblCleanup;
+	}
+
+	nStartTime = __rdtsc();
+	VGADECODE_DecodeImage(tCapture.apnPlanes,
+						  tCapture.cbStride,
+						  nWidth,
+						  nHeight,
+						  pnDecoded,
+						  nWidth,
+						  &tContent);
+	*pnCycles = __rdtsc() - nStartTime;
+
+	if (0 != memcmp(pnDecoded, pnExpected, nPixels))
+	{
+		PROGRESS("The indexed pixels don't match.");
+		hrResult = HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+		goto lblCleanup;
+	}
+
+	main_FindContent(pnExpected, nWidth, nHeight, &tExpectedContent);
+	if (0 != memcmp(&tContent, &tExpectedContent, sizeof(tContent)))
+	{
+		PROGRESS("The content spans (%ld,%ld)-(%ld,%ld) rather than (%ld,%ld)-(%ld,%ld).",
+				 tContent.left,
+				 tContent.top,
+				 tContent.right,
+				 tContent.bottom,
+				 tExpectedContent.left,
+				 tExpectedContent.top,
+				 tExpectedContent.right,
+				 tExpectedContent.bottom);
+		hrResult = HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+		goto lblCleanup;
+	}
+
+	main_GetPixelColors(&tCapture, atPalette);
+	VGADECODE_DecodeImageToColor(tCapture.apnPlanes,
+								 tCapture.cbStride,
+								 nWidth,
+								 nHeight,
+								 atPalette,
+								 ptDecoded,
+								 NULL);
+	for (nPixel = 0; nPixel < nPixels; ++nPixel)
+	{
+		if (0 != memcmp(&(ptDecoded[nPixel]), &(atPalette[pnExpected[nPixel]]), sizeof(ptDecoded[0])))
+		{
+			PROGRESS("The colored pixels don't match at %lu.", nPixel);
+			hrResult = HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+			goto lblCleanup;
+		}
+	}
+
+	VGADECODE_DecodeImageToNibbles(tCapture.apnPlanes,
+								   tCapture.cbStride,
+								   nWidth,
+								   nHeight,
+								   pnNibbles,
+								   cbNibbleRow);
+	for (nRow = 0; nRow < nHeight; ++nRow)
+	{
+		for (nColumn = 0; nColumn < nWidth; ++nColumn)
+		{
+			// The leftmost pixel of each pair is in the high nibble.
+			nNibble = pnNibbles[(nRow * cbNibbleRow) + (nColumn / 2)];
+			nNibble = (0 == nColumn % 2) ? (nNibble >> 4) : (nNibble & 0x0F);
+			if (pnExpected[(nRow * nWidth) + nColumn] != nNibble)
+			{
+				PROGRESS("The packed pixels don't match at (%lu,%lu).", nColumn, nRow);
+				hrResult = HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+				goto lblCleanup;
+			}
+		}
+	}
+
+	hrResult = S_OK;
+
+lblCleanup:
+	HEAPFREE(pvCapture);
+	HEAPFREE(pnNibbles);
+	HEAPFREE(ptDecoded);
+	HEAPFREE(pnDecoded);
+	HEAPFREE(pnExpected);
+	HEAPFREE(pnPixels);
+
+	return hrResult;
+}
+
+STATIC
+HRESULT
+main_CheckDiff(
+	_In_	VGA_SYNTH_KIND	eKind,
+	_In_	DWORD			nSeed,
+	_In_	DWORD			nWidth,
+	_In_	DWORD			nHeight,
+	_Out_	PDWORD64		pnDiffCycles,
+	_Out_	PDWORD64		pnDecodeCycles
+)
+{
+	HRESULT				hrResult										= E_FAIL;
+	DWORD				nPixels											= nWidth * nHeight;
+	PBYTE				pnFirst											= NULL;
+	PBYTE				pnSecond										= NULL;
+	PBYTE				pnNoise											= NULL;
+	PBYTE				pnFirstDecoded									= NULL;
+	PBYTE				pnSecondDecoded									= NULL;
+	PALETTE_ENTRY		atPaletteEntries[VGA_DAC_PALETTE_ENTRIES]		= { { 0 } };
+	PVOID				pvFirstCapture									= NULL;
+	DWORD				cbFirstCapture									= 0;
+	PVOID				pvSecondCapture									= NULL;
+	DWORD				cbSecondCapture									= 0;
+	VGA_CAPTURE_VIEW	tFirst											= { 0 };
+	VGA_CAPTURE_VIEW	tSecond											= { 0 };
+	PBYTE				pnMask											= NULL;
+	DWORD				cbMaskStride									= 0;
+	DWORD				nChangedPixels									= 0;
+	DWORD				nExpectedPixels									= 0;
+	PRECT				ptRegions										= NULL;
+	DWORD				nRegions										= 0;
+	DWORD				nRegion											= 0;
+	DWORD				nPatch											= 0;
+	DWORD				nHash											= 0;
+	DWORD				nLeft											= 0;
+	DWORD				nTop											= 0;
+	DWORD				nRow											= 0;
+	DWORD				nColumn											= 0;
+	DWORD				nPixel											= 0;
+	BOOL				bChanged										= FALSE;
+	BOOL				bMasked											= FALSE;
+	DWORD64				nStartTime										= 0;
+
+	assert(VGA_SYNTH_KINDS > eKind);
+	assert(NULL != pnDiffCycles);
+	assert(NULL != pnDecodeCycles);
+
+	pnFirst = HEAPALLOC(nPixels);
+	pnSecond = HEAPALLOC(nPixels);
+	pnNoise = HEAPALLOC(nPixels);
+	pnFirstDecoded = HEAPALLOC(nPixels);
+	pnSecondDecoded = HEAPALLOC(nPixels);
+	if ((NULL == pnFirst) ||
+		(NULL == pnSecond) ||
+		(NULL == pnNoise) ||
+		(NULL == pnFirstDecoded) ||
+		(NULL == pnSecondDecoded))
+	{
+		PROGRESS("Oops. Ran out of memory.");
+		hrResult = E_OUTOFMEMORY;
+		goto lblCleanup;
+	}
+
+	VGASYNTH_Generate(eKind, nSeed, nWidth, nHeight, pnFirst, nWidth);
+	VGASYNTH_Generate(VGA_SYNTH_KIND_NOISE, ~nSeed, nWidth, nHeight, pnNoise, nWidth);
+	VGASYNTH_GetPalette(atPaletteEntries);
+
+	// Paste patches of noise an eighth of the screen in size,
+	// at places picked by a multiplicative hash of the seed.
+	CopyMemory(pnSecond, pnFirst, nPixels);
+	for (nPatch = 0; nPatch < SELFTEST_DIFF_PATCHES; ++nPatch)
+	{
+		nHash = (nSeed + nPatch + 1) * 0x9E3779B1;
+		nLeft = (nHash & MAXWORD) % nWidth;
+		nTop = (nHash >> 16) % nHeight;
+		for (nRow = nTop; nRow < min(nTop + max(nHeight / 8, 1), nHeight); ++nRow)
+		{
+			for (nColumn = nLeft; nColumn < min(nLeft + max(nWidth / 8, 1), nWidth); ++nColumn)
+			{
+				pnSecond[(nRow * nWidth) + nColumn] = pnNoise[(nRow * nWidth) + nColumn];
+			}
+		}
+	}
+
+	hrResult = VGAENCODE_CreateCapture(pnFirst,
+									   nWidth,
+									   nWidth,
+									   nHeight,
+									   atPaletteEntries,
+									   FALSE,
+									   &pvFirstCapture,
+									   &cbFirstCapture);
+	if (FAILED(hrResult))
+	{
+		PROGRESS("Failed encoding the first screen.");
+		goto lblCleanup;
+	}
+
+	hrResult = VGAENCODE_CreateCapture(pnSecond,
+									   nWidth,
+									   nWidth,
+									   nHeight,
+									   atPaletteEntries,
+									   FALSE,
+									   &pvSecondCapture,
+									   &cbSecondCapture);
+	if (FAILED(hrResult))
+	{
+		PROGRESS("Failed encoding the second screen.");
+		goto lblCleanup;
+	}
+
+	hrResult = VGACAPTURE_Parse(pvFirstCapture, cbFirstCapture, &tFirst);
+	if (FAILED(hrResult))
+	{
+		PROGRESS("The first encoded capture is invalid.");
+		goto lblCleanup;
+	}
+
+	hrResult = VGACAPTURE_Parse(pvSecondCapture, cbSecondCapture, &tSecond);
+	if (FAILED(hrResult))
+	{
+		PROGRESS("The second encoded capture is invalid.");
+		goto lblCleanup;
+	}
+
+	nStartTime = __rdtsc();
+	hrResult = VGADIFF_Compare(&tFirst, &tSecond, &pnMask, &cbMaskStride, &nChangedPixels);
+	*pnDiffCycles = __rdtsc() - nStartTime;
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	// The way it would be done without the diff.
+	nStartTime = __rdtsc();
+	VGADECODE_DecodeImage(tFirst.apnPlanes,
+						  tFirst.cbStride,
+						  nWidth,
+						  nHeight,
+						  pnFirstDecoded,
+						  nWidth,
+						  NULL);
+	VGADECODE_DecodeImage(tSecond.apnPlanes,
+						  tSecond.cbStride,
+						  nWidth,
+						  nHeight,
+						  pnSecondDecoded,
+						  nWidth,
+						  NULL);
+	for (nPixel = 0; nPixel < nPixels; ++nPixel)
+	{
+		if (pnFirstDecoded[nPixel] != pnSecondDecoded[nPixel])
+		{
+			++nExpectedPixels;
+		}
+	}
+	*pnDecodeCycles = __rdtsc() - nStartTime;
+
+	if (nExpectedPixels != nChangedPixels)
+	{
+		PROGRESS("%lu pixels differ rather than %lu.", nChangedPixels, nExpectedPixels);
+		hrResult = HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+		goto lblCleanup;
+	}
+
+	hrResult = VGADIFF_FindRegions(pnMask, cbMaskStride, nWidth, nHeight, &ptRegions, &nRegions);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	// Each changed pixel must be masked and inside a region.
+	for (nRow = 0; nRow < nHeight; ++nRow)
+	{
+		for (nColumn = 0; nColumn < nWidth; ++nColumn)
+		{
+			bChanged = (pnFirst[(nRow * nWidth) + nColumn] != pnSecond[(nRow * nWidth) + nColumn]);
+			bMasked = (0 != (pnMask[(nRow * cbMaskStride) + (nColumn / PIXELS_IN_BYTE)] & (0x80 >> (nColumn % PIXELS_IN_BYTE))));
+			if (bChanged != bMasked)
+			{
+				PROGRESS("The mask is wrong at (%lu,%lu).", nColumn, nRow);
+				hrResult = HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+				goto lblCleanup;
+			}
+			if (!bChanged)
+			{
+				continue;
+			}
+
+			for (nRegion = 0; nRegion < nRegions; ++nRegion)
+			{
+				if (((LONG)nColumn >= ptRegions[nRegion].left) &&
+					((LONG)nColumn < ptRegions[nRegion].right) &&
+					((LONG)nRow >= ptRegions[nRegion].top) &&
+					((LONG)nRow < ptRegions[nRegion].bottom))
+				{
+					break;
+				}
+			}
+			if (nRegions == nRegion)
+			{
+				PROGRESS("No region covers (%lu,%lu).", nColumn, nRow);
+				hrResult = HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+				goto lblCleanup;
+			}
+		}
+	}
+
+	hrResult = S_OK;
+
+lblCleanup:
+	HEAPFREE(ptRegions);
+	HEAPFREE(pnMask);
+	HEAPFREE(pvSecondCapture);
+	HEAPFREE(pvFirstCapture);
+	HEAPFREE(pnSecondDecoded);
+	HEAPFREE(pnFirstDecoded);
+	HEAPFREE(pnNoise);
+	HEAPFREE(pnSecond);
+	HEAPFREE(pnFirst);
+
+	return hrResult;
+}
+
+STATIC
+HRESULT
+main_CheckRle(
+	_In_	VGA_SYNTH_KIND	eKind,
+	_In_	DWORD			nSeed,
+	_In_	DWORD			nWidth,
+	_In_	DWORD			nHeight,
+	_In_	WORD			nBitsPerPixel,
+	_Out_	PDWORD			pcbCompressed,
+	_Out_	PDWORD64		pnCycles
+)
+{
+	HRESULT	hrResult		= E_FAIL;
+	DWORD	nPixels			= nWidth * nHeight;
+	PBYTE	pnPixels		= NULL;
+	PBYTE	pnExpanded		= NULL;
+	PBYTE	pnData			= NULL;
+	DWORD	cbData			= 0;
+	DWORD	nPixel			= 0;
+	DWORD64	nStartTime		= 0;
+
+	assert(VGA_SYNTH_KINDS > eKind);
+	assert(NULL != pcbCompressed);
+	assert(NULL != pnCycles);
+
+	pnPixels = HEAPALLOC(nPixels);
+	pnExpanded = HEAPALLOC(nPixels);
+	if ((NULL == pnPixels) ||
+		(NULL == pnExpanded))
+	{
+		PROGRESS("Oops. Ran out of memory.");
+		hrResult = E_OUTOFMEMORY;
+		goto lblCleanup;
+	}
+
+	VGASYNTH_Generate(eKind, nSeed, nWidth, nHeight, pnPixels, nWidth);
+
+	nStartTime = __rdtsc();
+	hrResult = VGARLE_Compress(pnPixels, nWidth, nWidth, nHeight, nBitsPerPixel, &pnData, &cbData);
+	*pnCycles = __rdtsc() - nStartTime;
+	if (FAILED(hrResult))
+	{
+		PROGRESS("Failed compressing the screen.");
+		goto lblCleanup;
+	}
+
+	hrResult = VGARLE_Expand(pnData, cbData, nBitsPerPixel, nWidth, nHeight, pnExpanded, nWidth);
+	if (FAILED(hrResult))
+	{
+		PROGRESS("The compressed screen is invalid.");
+		goto lblCleanup;
+	}
+
+	for (nPixel = 0; nPixel < nPixels; ++nPixel)
+	{
+		if (pnPixels[nPixel] != pnExpanded[nPixel])
+		{
+			PROGRESS("Pixel (%lu,%lu) expanded to %u instead of %u.",
+					 nPixel % nWidth,
+					 nPixel / nWidth,
+					 pnExpanded[nPixel],
+					 pnPixels[nPixel]);
+			hrResult = HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+			goto lblCleanup;
+		}
+	}
+
+	*pcbCompressed = cbData;
+
+	hrResult = S_OK;
+
+lblCleanup:
+	HEAPFREE(pnData);
+	HEAPFREE(pnExpanded);
+	HEAPFREE(pnPixels);
+
+	return hrResult;
+}
+
+STATIC
+HRESULT
+main_TimeDumpRead(
+	_In_							PCWSTR				pwszPath,
+	_In_							DUMPPARSE_READER	eReader,
+	_In_reads_bytes_(cbExpected)	PVOID				pvExpected,
+	_In_							DWORD				cbExpected,
+	_Out_							PDWORD64			pnCycles,
+	_Out_							PULONGLONG			pcbRead
+)
+{
+	HRESULT		hrResult	= E_FAIL;
+	HDUMP		hDump		= NULL;
+	PVOID		pvCapture	= NULL;
+	DWORD		cbCapture	= 0;
+	DWORD64		nStartTime	= 0;
+	ULONGLONG	cbFile		= 0;
+
+	assert(NULL != pwszPath);
+	assert(NULL != pvExpected);
+	assert(NULL != pnCycles);
+	assert(NULL != pcbRead);
+
+	nStartTime = __rdtsc();
+
+	hrResult = DUMPPARSE_OpenWithReader(pwszPath, eReader, &hDump);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	hrResult = DUMPPARSE_ReadTagged(hDump,
+									&g_tVgaDumpGuid,
+									&pvCapture,
+									&cbCapture);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	DUMPPARSE_GetReadStatistics(hDump, pcbRead, &cbFile);
+	CLOSE(hDump, DUMPPARSE_Close);
+
+	*pnCycles = __rdtsc() - nStartTime;
+
+	if ((cbExpected != cbCapture) ||
+		(0 != memcmp(pvCapture, pvExpected, cbCapture)))
+	{
+		PROGRESS("The %S reader read the wrong data.", DUMPPARSE_GetReaderName(eReader));
+		hrResult = HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+		goto lblCleanup;
+	}
+
+	hrResult = S_OK;
+
+lblCleanup:
+	HEAPFREE(pvCapture);
+	CLOSE(hDump, DUMPPARSE_Close);
+
+	return hrResult;
+}
+
+STATIC
+HRESULT
+main_CheckDumpTags(
+	_In_	PCWSTR	pwszPath,
+	_In_	DWORD	cbExpected
+)
+{
+	HRESULT			hrResult	= E_FAIL;
+	HDUMP			hDump		= NULL;
+	PDUMPPARSE_TAG	patTags		= NULL;
+	DWORD			nTags		= 0;
+	DWORD			nTag		= 0;
+	DWORD			nCaptures	= 0;
+
+	assert(NULL != pwszPath);
+
+	hrResult = DUMPPARSE_Open(pwszPath, &hDump);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	hrResult = DUMPPARSE_EnumerateTags(hDump, &patTags, &nTags);
+	if (FAILED(hrResult))
 	{
-		PROGRESS("Failed writing to the output file.");
-		hrResult = HRESULT_FROM_WIN32(GetLastError());
 		goto lblCleanup;
 	}
-	if (sizeof(*ptBitmap) != cbWritten)
+
+	for (nTag = 0; nTag < nTags; ++nTag)
+	{
+		if (IsEqualGUID(&(patTags[nTag].tTag), &g_tVgaDumpGuid) &&
+			(cbExpected == patTags[nTag].cbData))
+		{
+			++nCaptures;
+		}
+	}
+
+	// The synthetic dumps have records on either side of the capture.
+	if ((1 != nCaptures) ||
+		(2 > nTags))
 	{
-		PROGRESS("Not all data written to the output file. Strange...");
-		hrResult = E_UNEXPECTED;
+		PROGRESS("Listed %lu records, %lu of them the capture.", nTags, nCaptures);
+		hrResult = HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
 		goto lblCleanup;
 	}
 
 	hrResult = S_OK;
 
 lblCleanup:
-	CLOSE_FILE_HANDLE(hOutputFile);
-	HEAPFREE(ptBitmap);
-	HEAPFREE(ptDump);
+	HEAPFREE(patTags);
 	CLOSE(hDump, DUMPPARSE_Close);
 
 	return hrResult;
 }
 
+STATIC
+HRESULT
+main_CheckDumpParse(
+	_In_	DUMP_SYNTH_LAYOUT	eLayout,
+	_In_	DWORD				nSeed,
+	_Out_	PDWORD64			pnNativeCycles,
+	_Out_	PDWORD64			pnDebuggerCycles,
+	_Out_	PULONGLONG			pcbRead,
+	_Out_	PDWORD				pcbDump,
+	_Out_	PDWORD64			pnIndexedCycles,
+	_Out_	PULONGLONG			pcbIndexedRead
+)
+{
+	HRESULT			hrResult										= E_FAIL;
+	DWORD			nPixels											= SCREEN_WIDTH_PIXELS * SCREEN_HEIGHT_PIXELS;
+	PBYTE			pnPixels										= NULL;
+	PALETTE_ENTRY	atPaletteEntries[VGA_DAC_PALETTE_ENTRIES]		= { { 0 } };
+	PVOID			pvCapture										= NULL;
+	DWORD			cbCapture										= 0;
+	PVOID			pvDump											= NULL;
+	DWORD			cbDump											= 0;
+	PWSTR			pwszDumpPath									= NULL;
+	ULONGLONG		cbDebuggerRead									= 0;
+	SIZE_T			cchIndexPath									= 0;
+	PWSTR			pwszIndexPath									= NULL;
+	DWORD			nOpen											= 0;
+
+	assert(DUMP_SYNTH_LAYOUTS > eLayout);
+	assert(NULL != pnNativeCycles);
+	assert(NULL != pnDebuggerCycles);
+	assert(NULL != pcbRead);
+	assert(NULL != pcbDump);
+	assert(NULL != pnIndexedCycles);
+	assert(NULL != pcbIndexedRead);
+
+	pnPixels = HEAPALLOC(nPixels);
+	if (NULL == pnPixels)
+	{
+		PROGRESS("Oops. Ran out of memory.");
+		hrResult = E_OUTOFMEMORY;
+		goto lblCleanup;
+	}
+
+	VGASYNTH_Generate(VGA_SYNTH_KIND_BSOD,
+					  nSeed,
+					  SCREEN_WIDTH_PIXELS,
+					  SCREEN_HEIGHT_PIXELS,
+					  pnPixels,
+					  SCREEN_WIDTH_PIXELS);
+	VGASYNTH_GetPalette(atPaletteEntries);
+
+	hrResult = VGAENCODE_CreateCapture(pnPixels,
+									   SCREEN_WIDTH_PIXELS,
+									   SCREEN_WIDTH_PIXELS,
+									   SCREEN_HEIGHT_PIXELS,
+									   atPaletteEntries,
+									   FALSE,
+									   &pvCapture,
+									   &cbCapture);
+	if (FAILED(hrResult))
+	{
+		PROGRESS("Failed encoding the screen.");
+		goto lblCleanup;
+	}
+
+	hrResult = DUMPSYNTH_Create(eLayout,
+								&g_tVgaDumpGuid,
+								pvCapture,
+								cbCapture,
+								&pvDump,
+								&cbDump);
+	if (FAILED(hrResult))
+	{
+		PROGRESS("Failed generating the dump.");
+		goto lblCleanup;
+	}
+
+	hrResult = UTIL_WriteToTemporaryFile(pvDump, cbDump, &pwszDumpPath);
+	if (FAILED(hrResult))
+	{
+		PROGRESS("Failed writing the dump file.");
+		goto lblCleanup;
+	}
+
+	// The indexed reader leaves an index next to the dump.
+	cchIndexPath = wcslen(pwszDumpPath) + ARRAYSIZE(DUMPPARSE_INDEX_EXTENSION);
+	pwszIndexPath = HEAPALLOC(cchIndexPath * sizeof(pwszIndexPath[0]));
+	if (NULL == pwszIndexPath)
+	{
+		PROGRESS("Oops. Ran out of memory.");
+		hrResult = E_OUTOFMEMORY;
+		goto lblCleanup;
+	}
+
+	hrResult = StringCchPrintfW(pwszIndexPath,
+								cchIndexPath,
+								L"%s%s",
+								pwszDumpPath,
+								DUMPPARSE_INDEX_EXTENSION);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	hrResult = main_TimeDumpRead(pwszDumpPath,
+								 DUMPPARSE_READER_NATIVE,
+								 pvCapture,
+								 cbCapture,
+								 pnNativeCycles,
+								 pcbRead);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	hrResult = main_CheckDumpTags(pwszDumpPath, cbCapture);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	// The first open writes the index, and the second reads it.
+	for (nOpen = 0; nOpen < 2; ++nOpen)
+	{
+		hrResult = main_TimeDumpRead(pwszDumpPath,
+									 DUMPPARSE_READER_INDEXED,
+									 pvCapture,
+									 cbCapture,
+									 pnIndexedCycles,
+									 pcbIndexedRead);
+		if (FAILED(hrResult))
+		{
+			goto lblCleanup;
+		}
+	}
+
+	// The synthetic dumps have no kernel in them to debug,
+	// so the engine may well refuse them. That's only a missing
+	// comparison, not a failure.
+	if (FAILED(main_TimeDumpRead(pwszDumpPath,
+								 DUMPPARSE_READER_DEBUGGER,
+								 pvCapture,
+								 cbCapture,
+								 pnDebuggerCycles,
+								 &cbDebuggerRead)))
+	{
+		*pnDebuggerCycles = 0;
+	}
+
+	*pcbDump = cbDump;
+
+	hrResult = S_OK;
+
+lblCleanup:
+	if (NULL != pwszIndexPath)
+	{
+		(VOID)DeleteFileW(pwszIndexPath);
+	}
+	HEAPFREE(pwszIndexPath);
+	if (NULL != pwszDumpPath)
+	{
+		(VOID)DeleteFileW(pwszDumpPath);
+	}
+	HEAPFREE(pwszDumpPath);
+	HEAPFREE(pvDump);
+	HEAPFREE(pvCapture);
+	HEAPFREE(pnPixels);
+
+	return hrResult;
+}
+
+STATIC
+HRESULT
+main_HandleSelftest(
+	_In_					INT				nArguments,
+	_In_reads_(nArguments)	CONST PCWSTR *	ppwszArguments
+)
+{
+	HRESULT			hrResult		= E_FAIL;
+	DWORD			nRounds			= SELFTEST_DEFAULT_ROUNDS;
+	DWORD			nRound			= 0;
+	DWORD			nKind			= 0;
+	DWORD			nGeometry		= 0;
+	DWORD			nWidth			= 0;
+	DWORD			nHeight			= 0;
+	DWORD			nSeed			= 0;
+	BOOL			bLegacy			= FALSE;
+	DWORD			nBackend		= 0;
+	BOOL			bDecodeFailed	= FALSE;
+	DWORD64			nCycles			= 0;
+	DWORD64			nDiffCycles		= 0;
+	DWORD64			nDecodeCycles	= 0;
+	DWORD64			nPixels			= 0;
+	DWORD			nEncoding		= 0;
+	WORD			nBitsPerPixel	= 0;
+	DWORD			cbUncompressed	= 0;
+	DWORD			cbCompressed	= 0;
+	DWORD			nLayout			= 0;
+	DWORD64			nNativeCycles	= 0;
+	DWORD64			nDebuggerCycles	= 0;
+	ULONGLONG		cbRead			= 0;
+	DWORD			cbDump			= 0;
+	DWORD64			nIndexedCycles	= 0;
+	ULONGLONG		cbIndexedRead	= 0;
+	DWORD			nChecks			= 0;
+	DWORD			nFailures		= 0;
+
+	assert(NULL != ppwszArguments);
+
+	// The number of rounds is optional.
+	if ((SUBFUNCTION_SELFTEST_ARGS_COUNT != nArguments) &&
+		(SUBFUNCTION_SELFTEST_ARGS_COUNT - 1 != nArguments))
+	{
+		PROGRESS("Invalid number of arguments specified.");
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+
+	if (SUBFUNCTION_SELFTEST_ARGS_COUNT == nArguments)
+	{
+		hrResult = main_ParseNumber(ppwszArguments[SUBFUNCTION_SELFTEST_ARG_ROUNDS], &nRounds);
+		if (FAILED(hrResult))
+		{
+			goto lblCleanup;
+		}
+	}
+
+	for (nRound = 0; nRound < nRounds; ++nRound)
+	{
+		for (nKind = 0; nKind < VGA_SYNTH_KINDS; ++nKind)
+		{
+			for (nGeometry = 0; nGeometry < ARRAYSIZE(g_atSelftestGeometries); ++nGeometry)
+			{
+				nWidth = (DWORD)g_atSelftestGeometries[nGeometry].cx;
+				nHeight = (DWORD)g_atSelftestGeometries[nGeometry].cy;
+				nSeed = (nRound << 16) | (nKind << 8) | nGeometry;
+
+				// Every other round, mode 12h screens are encoded
+				// the way captures were before the header.
+				bLegacy = (0 != (nRound % 2)) &&
+						  (SCREEN_WIDTH_PIXELS == nWidth) &&
+						  (SCREEN_HEIGHT_PIXELS == nHeight);
+
+				// Every decoder the CPU can run is checked,
+				// not just the one it would use.
+				nPixels = (DWORD64)nWidth * nHeight;
+				bDecodeFailed = FALSE;
+				for (nBackend = 0; ; ++nBackend)
+				{
+					hrResult = VGADECODE_SelectBackend(nBackend);
+					if (HRESULT_FROM_WIN32(ERROR_NO_MORE_ITEMS) == hrResult)
+					{
+						break;
+					}
+					if (FAILED(hrResult))
+					{
+						continue;
+					}
+
+					++nChecks;
+					hrResult = main_CheckRoundTrip((VGA_SYNTH_KIND)nKind,
+												   nSeed,
+												   nWidth,
+												   nHeight,
+												   bLegacy,
+												   &nCycles);
+					if (FAILED(hrResult))
+					{
+						++nFailures;
+						bDecodeFailed = TRUE;
+						(VOID)wprintf(L"%-5s %4lux%-4lu seed %-8lu%s %-6S FAILED (0x%08lX)\n",
+									  VGASYNTH_GetKindName((VGA_SYNTH_KIND)nKind),
+									  nWidth,
+									  nHeight,
+									  nSeed,
+									  bLegacy ? L" legacy" : L"",
+									  VGADECODE_GetBackendName(),
+									  hrResult);
+						continue;
+					}
+
+					(VOID)wprintf(L"%-5s %4lux%-4lu seed %-8lu%s %-6S decoded in %I64u cycles (%I64u.%02I64u cycles per pixel)\n",
+								  VGASYNTH_GetKindName((VGA_SYNTH_KIND)nKind),
+								  nWidth,
+								  nHeight,
+								  nSeed,
+								  bLegacy ? L" legacy" : L"",
+								  VGADECODE_GetBackendName(),
+								  nCycles,
+								  nCycles / nPixels,
+								  (nCycles * 100 / nPixels) % 100);
+				}
+				(VOID)VGADECODE_SelectBackend(VGADECODE_BACKEND_DEFAULT);
+				if (bDecodeFailed)
+				{
+					continue;
+				}
+
+				++nChecks;
+				hrResult = main_CheckDiff((VGA_SYNTH_KIND)nKind,
+										  nSeed,
+										  nWidth,
+										  nHeight,
+										  &nDiffCycles,
+										  &nDecodeCycles);
+				if (FAILED(hrResult))
+				{
+					++nFailures;
+					(VOID)wprintf(L"%-5s %4lux%-4lu seed %-8lu diff FAILED (0x%08lX)\n",
+								  VGASYNTH_GetKindName((VGA_SYNTH_KIND)nKind),
+								  nWidth,
+								  nHeight,
+								  nSeed,
+								  hrResult);
+					continue;
+				}
+
+				nDiffCycles = max(nDiffCycles, 1);
+				(VOID)wprintf(L"%-5s %4lux%-4lu seed %-8lu diffed in %I64u cycles rather than %I64u (%I64u.%I64ux faster)\n",
+							  VGASYNTH_GetKindName((VGA_SYNTH_KIND)nKind),
+							  nWidth,
+							  nHeight,
+							  nSeed,
+							  nDiffCycles,
+							  nDecodeCycles,
+							  nDecodeCycles / nDiffCycles,
+							  (nDecodeCycles * 10 / nDiffCycles) % 10);
+
+				for (nEncoding = 0; nEncoding < ARRAYSIZE(g_anSelftestRleBitsPerPixel); ++nEncoding)
+				{
+					nBitsPerPixel = g_anSelftestRleBitsPerPixel[nEncoding];
+
+					++nChecks;
+					hrResult = main_CheckRle((VGA_SYNTH_KIND)nKind,
+											 nSeed,
+											 nWidth,
+											 nHeight,
+											 nBitsPerPixel,
+											 &cbCompressed,
+											 &nCycles);
+					if (FAILED(hrResult))
+					{
+						++nFailures;
+						(VOID)wprintf(L"%-5s %4lux%-4lu seed %-8lu RLE%u FAILED (0x%08lX)\n",
+									  VGASYNTH_GetKindName((VGA_SYNTH_KIND)nKind),
+									  nWidth,
+									  nHeight,
+									  nSeed,
+									  nBitsPerPixel,
+									  hrResult);
+						continue;
+					}
+
+					// Compared to the rows of an uncompressed BMP,
+					// which are padded to a multiple of 4 bytes.
+					cbUncompressed = (((nWidth * nBitsPerPixel) + 31) / 32) * sizeof(DWORD) * nHeight;
+					(VOID)wprintf(L"%-5s %4lux%-4lu seed %-8lu RLE%u compressed %lu bytes to %lu (%lu.%lux smaller) in %I64u cycles (%I64u.%02I64u cycles per pixel)\n",
+								  VGASYNTH_GetKindName((VGA_SYNTH_KIND)nKind),
+								  nWidth,
+								  nHeight,
+								  nSeed,
+								  nBitsPerPixel,
+								  cbUncompressed,
+								  cbCompressed,
+								  cbUncompressed / cbCompressed,
+								  (cbUncompressed * 10 / cbCompressed) % 10,
+								  nCycles,
+								  nCycles / nPixels,
+								  (nCycles * 100 / nPixels) % 100);
+				}
+			}
+		}
+
+		for (nLayout = 0; nLayout < DUMP_SYNTH_LAYOUTS; ++nLayout)
+		{
+			nSeed = (nRound << 16) | nLayout;
+
+			++nChecks;
+			hrResult = main_CheckDumpParse((DUMP_SYNTH_LAYOUT)nLayout,
+										   nSeed,
+										   &nNativeCycles,
+										   &nDebuggerCycles,
+										   &cbRead,
+										   &cbDump,
+										   &nIndexedCycles,
+										   &cbIndexedRead);
+			if (FAILED(hrResult))
+			{
+				++nFailures;
+				(VOID)wprintf(L"dump  %-8s seed %-8lu FAILED (0x%08lX)\n",
+							  DUMPSYNTH_GetLayoutName((DUMP_SYNTH_LAYOUT)nLayout),
+							  nSeed,
+							  hrResult);
+				continue;
+			}
+
+			(VOID)wprintf(L"dump  %-8s seed %-8lu read %I64u of %lu bytes in %I64u cycles through its index\n",
+						  DUMPSYNTH_GetLayoutName((DUMP_SYNTH_LAYOUT)nLayout),
+						  nSeed,
+						  cbIndexedRead,
+						  cbDump,
+						  nIndexedCycles);
+
+			if (0 == nDebuggerCycles)
+			{
+				(VOID)wprintf(L"dump  %-8s seed %-8lu read %I64u of %lu bytes in %I64u cycles (%s couldn't read it)\n",
+							  DUMPSYNTH_GetLayoutName((DUMP_SYNTH_LAYOUT)nLayout),
+							  nSeed,
+							  cbRead,
+							  cbDump,
+							  nNativeCycles,
+							  DUMPPARSE_GetReaderName(DUMPPARSE_READER_DEBUGGER));
+				continue;
+			}
+
+			nNativeCycles = max(nNativeCycles, 1);
+			(VOID)wprintf(L"dump  %-8s seed %-8lu read %I64u of %lu bytes in %I64u cycles rather than %I64u with %s (%I64u.%I64ux faster)\n",
+						  DUMPSYNTH_GetLayoutName((DUMP_SYNTH_LAYOUT)nLayout),
+						  nSeed,
+						  cbRead,
+						  cbDump,
+						  nNativeCycles,
+						  nDebuggerCycles,
+						  DUMPPARSE_GetReaderName(DUMPPARSE_READER_DEBUGGER),
+						  nDebuggerCycles / nNativeCycles,
+						  (nDebuggerCycles * 10 / nNativeCycles) % 10);
+		}
+	}
+
+	(VOID)wprintf(L"%lu of %lu checks passed, using the %S decoder.\n",
+				  nChecks - nFailures,
+				  nChecks,
+				  VGADECODE_GetBackendName());
+
+	hrResult = (0 == nFailures) ? S_OK : HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+
+lblCleanup:
+	return hrResult;
+}
+
+STATIC
+HRESULT
+main_BenchColorDecode(
+	_In_	VGA_SYNTH_KIND	eKind,
+	_In_	DWORD			nSeed,
+	_In_	DWORD			nWidth,
+	_In_	DWORD			nHeight,
+	_In_	DWORD			nRepetitions,
+	_Out_	PDWORD64		pnFusedCycles,
+	_Out_	PDWORD64		pnTwoStepCycles
+)
+{
+	HRESULT				hrResult										= E_FAIL;
+	DWORD				nPixels											= nWidth * nHeight;
+	PBYTE				pnPixels										= NULL;
+	PBYTE				pnIndexed										= NULL;
+	RGBQUAD *			ptTwoStep										= NULL;
+	RGBQUAD *			ptFused											= NULL;
+	PALETTE_ENTRY		atPaletteEntries[VGA_DAC_PALETTE_ENTRIES]		= { { 0 } };
+	RGBQUAD				atPalette[VGA_COLORS]							= { { 0 } };
+	PVOID				pvCapture										= NULL;
+	DWORD				cbCapture										= 0;
+	VGA_CAPTURE_VIEW	tCapture										= { 0 };
+	DWORD64				nStartTime										= 0;
+	DWORD64				nCycles											= 0;
+	DWORD64				nFusedCycles									= MAXDWORD64;
+	DWORD64				nTwoStepCycles									= MAXDWORD64;
+	DWORD				nRepetition										= 0;
+	DWORD				nPixel											= 0;
+
+	assert(VGA_SYNTH_KINDS > eKind);
+	assert(0 != nRepetitions);
+	assert(NULL != pnFusedCycles);
+	assert(NULL != pnTwoStepCycles);
+
+	// Only geometries that fit in the planes are timed,
+	// so the sizes can't overflow.
+	pnPixels = HEAPALLOC(nPixels);
+	pnIndexed = HEAPALLOC(nPixels);
+	ptTwoStep = HEAPALLOC(nPixels * sizeof(ptTwoStep[0]));
+	ptFused = HEAPALLOC(nPixels * sizeof(ptFused[0]));
+	if ((NULL == pnPixels) ||
+		(NULL == pnIndexed) ||
+		(NULL == ptTwoStep) ||
+		(NULL == ptFused))
+	{
+		PROGRESS("Oops. Ran out of memory.");
+		hrResult = E_OUTOFMEMORY;
+		goto lblCleanup;
+	}
+
+	VGASYNTH_Generate(eKind, nSeed, nWidth, nHeight, pnPixels, nWidth);
+	VGASYNTH_GetPalette(atPaletteEntries);
+
+	hrResult = VGAENCODE_CreateCapture(pnPixels,
+									   nWidth,
+									   nWidth,
+									   nHeight,
+									   atPaletteEntries,
+									   FALSE,
+									   &pvCapture,
+									   &cbCapture);
+	if (FAILED(hrResult))
+	{
+		PROGRESS("Failed encoding the screen.");
+		goto lblCleanup;
+	}
+
+	hrResult = VGACAPTURE_Parse(pvCapture, cbCapture, &tCapture);
+	if (FAILED(hrResult))
+	{
+		PROGRESS("The encoded capture is invalid.");
+		goto lblCleanup;
+	}
+
+	main_GetPixelColors(&tCapture, atPalette);
+
+	// The fastest of the repetitions is the one least disturbed
+	// by interrupts and cold caches.
+	for (nRepetition = 0; nRepetition < nRepetitions; ++nRepetition)
+	{
+		nStartTime = __rdtsc();
+		VGADECODE_DecodeImage(tCapture.apnPlanes,
+							  tCapture.cbStride,
+							  nWidth,
+							  nHeight,
+							  pnIndexed,
+							  nWidth,
+							  NULL);
+		for (nPixel = 0; nPixel < nPixels; ++nPixel)
+		{
+			ptTwoStep[nPixel] = atPalette[pnIndexed[nPixel]];
+		}
+		nCycles = __rdtsc() - nStartTime;
+		nTwoStepCycles = min(nTwoStepCycles, nCycles);
+
+		nStartTime = __rdtsc();
+		VGADECODE_DecodeImageToColor(tCapture.apnPlanes,
+									 tCapture.cbStride,
+									 nWidth,
+									 nHeight,
+									 atPalette,
+									 ptFused,
+									 NULL);
+		nCycles = __rdtsc() - nStartTime;
+		nFusedCycles = min(nFusedCycles, nCycles);
+	}
+
+	if (0 != memcmp(ptFused, ptTwoStep, nPixels * sizeof(ptFused[0])))
+	{
+		PROGRESS("The colored pixels don't match.");
+		hrResult = HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+		goto lblCleanup;
+	}
+
+	*pnFusedCycles = nFusedCycles;
+	*pnTwoStepCycles = nTwoStepCycles;
+
+	hrResult = S_OK;
+
+lblCleanup:
+	HEAPFREE(pvCapture);
+	HEAPFREE(ptFused);
+	HEAPFREE(ptTwoStep);
+	HEAPFREE(pnIndexed);
+	HEAPFREE(pnPixels);
+
+	return hrResult;
+}
+
+STATIC
+HRESULT
+main_BenchGroup(
+	_In_	PCBENCH_GROUP_CORPUS	ptCorpus,
+	_In_	DWORD					nRepetitions,
+	_Out_	PDWORD64				pnCycles
+)
+{
+	HRESULT				hrResult		= E_FAIL;
+	PVGA_FINGERPRINT	pnFingerprints	= NULL;
+	PDWORD				pnGroups		= NULL;
+	DWORD64				nRandom			= 0x9E3779B97F4A7C15ULL;
+	DWORD64				nStartTime		= 0;
+	DWORD64				nCycles			= MAXDWORD64;
+	DWORD				nRepetition		= 0;
+	DWORD				nIndex			= 0;
+	DWORD				nDuplicate		= 0;
+	DWORD				nBit			= 0;
+
+	assert(NULL != ptCorpus);
+	assert(BENCH_GROUP_FINGERPRINTS > ptCorpus->nDuplicates);
+	assert(0 != nRepetitions);
+	assert(NULL != pnCycles);
+
+	pnFingerprints = HEAPALLOC(BENCH_GROUP_FINGERPRINTS * sizeof(pnFingerprints[0]));
+	pnGroups = HEAPALLOC(BENCH_GROUP_FINGERPRINTS * sizeof(pnGroups[0]));
+	if ((NULL == pnFingerprints) ||
+		(NULL == pnGroups))
+	{
+		PROGRESS("Oops. Ran out of memory.");
+		hrResult = E_OUTOFMEMORY;
+		goto lblCleanup;
+	}
+
+	// Random fingerprints (xorshift64) are all far apart.
+	for (nIndex = 0; nIndex < BENCH_GROUP_FINGERPRINTS; ++nIndex)
+	{
+		nRandom ^= nRandom << 13;
+		nRandom ^= nRandom >> 7;
+		nRandom ^= nRandom << 17;
+		pnFingerprints[nIndex] = nRandom;
+	}
+
+	// The copies of the first fingerprint are spread out evenly.
+	// Near ones differ from it in 1 to 3 bits, so they're all
+	// within the distance of it, but mostly not of one another.
+	for (nDuplicate = 1; nDuplicate <= ptCorpus->nDuplicates; ++nDuplicate)
+	{
+		nIndex = (DWORD)(((DWORD64)nDuplicate * BENCH_GROUP_FINGERPRINTS) / (ptCorpus->nDuplicates + 1));
+		pnFingerprints[nIndex] = pnFingerprints[0];
+		if (ptCorpus->bNear)
+		{
+			for (nBit = 0; nBit <= nDuplicate % 3; ++nBit)
+			{
+				pnFingerprints[nIndex] ^= 1ULL << ((nDuplicate * 7 + nBit * 23) % VGA_FINGERPRINT_BITS);
+			}
+		}
+	}
+
+	for (nRepetition = 0; nRepetition < nRepetitions; ++nRepetition)
+	{
+		nStartTime = __rdtsc();
+		hrResult = VGAFINGERPRINT_Group(pnFingerprints,
+										BENCH_GROUP_FINGERPRINTS,
+										DEDUP_DEFAULT_MAX_DISTANCE,
+										pnGroups);
+		nCycles = min(nCycles, __rdtsc() - nStartTime);
+		if (FAILED(hrResult))
+		{
+			PROGRESS("Failed grouping the fingerprints.");
+			goto lblCleanup;
+		}
+	}
+
+	for (nDuplicate = 1; nDuplicate <= ptCorpus->nDuplicates; ++nDuplicate)
+	{
+		nIndex = (DWORD)(((DWORD64)nDuplicate * BENCH_GROUP_FINGERPRINTS) / (ptCorpus->nDuplicates + 1));
+		if (0 != pnGroups[nIndex])
+		{
+			PROGRESS("A copy wasn't grouped with the original.");
+			hrResult = HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+			goto lblCleanup;
+		}
+	}
+
+	*pnCycles = nCycles;
+
+	hrResult = S_OK;
+
+lblCleanup:
+	HEAPFREE(pnGroups);
+	HEAPFREE(pnFingerprints);
+
+	return hrResult;
+}
+
+STATIC
+HRESULT
+main_HandleBench(
+	_In_					INT				nArguments,
+	_In_reads_(nArguments)	CONST PCWSTR *	ppwszArguments
+)
+{
+	HRESULT			hrResult		= E_FAIL;
+	DWORD			nRepetitions	= BENCH_DEFAULT_REPETITIONS;
+	DWORD			nBackend		= 0;
+	DWORD			nKind			= 0;
+	DWORD			nGeometry		= 0;
+	DWORD			nWidth			= 0;
+	DWORD			nHeight			= 0;
+	DWORD			nSeed			= 0;
+	DWORD64			nPixels			= 0;
+	DWORD64			nFusedCycles	= 0;
+	DWORD64			nTwoStepCycles	= 0;
+	DWORD			nCorpus			= 0;
+	DWORD64			nGroupCycles	= 0;
+	DWORD			nFailures		= 0;
+
+	assert(NULL != ppwszArguments);
+
+	// The number of repetitions is optional.
+	if ((SUBFUNCTION_BENCH_ARGS_COUNT != nArguments) &&
+		(SUBFUNCTION_BENCH_ARGS_COUNT - 1 != nArguments))
+	{
+		PROGRESS("Invalid number of arguments specified.");
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+
+	if (SUBFUNCTION_BENCH_ARGS_COUNT == nArguments)
+	{
+		hrResult = main_ParseNumber(ppwszArguments[SUBFUNCTION_BENCH_ARG_REPETITIONS], &nRepetitions);
+		if (FAILED(hrResult))
+		{
+			goto lblCleanup;
+		}
+		if (0 == nRepetitions)
+		{
+			PROGRESS("Nothing is timed without repetitions.");
+			hrResult = E_INVALIDARG;
+			goto lblCleanup;
+		}
+	}
+
+	for (nBackend = 0; ; ++nBackend)
+	{
+		hrResult = VGADECODE_SelectBackend(nBackend);
+		if (HRESULT_FROM_WIN32(ERROR_NO_MORE_ITEMS) == hrResult)
+		{
+			break;
+		}
+		if (FAILED(hrResult))
+		{
+			continue;
+		}
+
+		for (nKind = 0; nKind < VGA_SYNTH_KINDS; ++nKind)
+		{
+			for (nGeometry = 0; nGeometry < ARRAYSIZE(g_atBenchGeometries); ++nGeometry)
+			{
+				nWidth = (DWORD)g_atBenchGeometries[nGeometry].cx;
+				nHeight = (DWORD)g_atBenchGeometries[nGeometry].cy;
+				nSeed = (nKind << 8) | nGeometry;
+
+				hrResult = main_BenchColorDecode((VGA_SYNTH_KIND)nKind,
+												 nSeed,
+												 nWidth,
+												 nHeight,
+												 nRepetitions,
+												 &nFusedCycles,
+												 &nTwoStepCycles);
+				if (FAILED(hrResult))
+				{
+					++nFailures;
+					(VOID)wprintf(L"%-6S %-5s %4lux%-4lu FAILED (0x%08lX)\n",
+								  VGADECODE_GetBackendName(),
+								  VGASYNTH_GetKindName((VGA_SYNTH_KIND)nKind),
+								  nWidth,
+								  nHeight,
+								  hrResult);
+					continue;
+				}
+
+				nPixels = (DWORD64)nWidth * nHeight;
+				nFusedCycles = max(nFusedCycles, 1);
+				(VOID)wprintf(L"%-6S %-5s %4lux%-4lu %I64u.%02I64u cycles per pixel rather than %I64u.%02I64u decoding then applying the palette (%I64u.%I64ux faster)\n",
+							  VGADECODE_GetBackendName(),
+							  VGASYNTH_GetKindName((VGA_SYNTH_KIND)nKind),
+							  nWidth,
+							  nHeight,
+							  nFusedCycles / nPixels,
+							  (nFusedCycles * 100 / nPixels) % 100,
+							  nTwoStepCycles / nPixels,
+							  (nTwoStepCycles * 100 / nPixels) % 100,
+							  nTwoStepCycles / nFusedCycles,
+							  (nTwoStepCycles * 10 / nFusedCycles) % 10);
+			}
+		}
+	}
+
+	for (nCorpus = 0; nCorpus < ARRAYSIZE(g_atBenchGroupCorpora); ++nCorpus)
+	{
+		hrResult = main_BenchGroup(&(g_atBenchGroupCorpora[nCorpus]),
+								   min(nRepetitions, BENCH_GROUP_REPETITIONS),
+								   &nGroupCycles);
+		if (FAILED(hrResult))
+		{
+			++nFailures;
+			(VOID)wprintf(L"group  %lu fingerprints, %lu %s copies FAILED (0x%08lX)\n",
+						  (DWORD)BENCH_GROUP_FINGERPRINTS,
+						  g_atBenchGroupCorpora[nCorpus].nDuplicates,
+						  g_atBenchGroupCorpora[nCorpus].bNear ? L"near" : L"exact",
+						  hrResult);
+			continue;
+		}
+
+		(VOID)wprintf(L"group  %lu fingerprints, %lu %s copies: %I64u cycles (%I64u per fingerprint)\n",
+					  (DWORD)BENCH_GROUP_FINGERPRINTS,
+					  g_atBenchGroupCorpora[nCorpus].nDuplicates,
+					  g_atBenchGroupCorpora[nCorpus].bNear ? L"near" : L"exact",
+					  nGroupCycles,
+					  nGroupCycles / BENCH_GROUP_FINGERPRINTS);
+	}
+
+	hrResult = (0 == nFailures) ? S_OK : HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+
+lblCleanup:
+	(VOID)VGADECODE_SelectBackend(VGADECODE_BACKEND_DEFAULT);
+
+	return hrResult;
+}
+
 STATIC
 HRESULT
 main_HandleLoad(
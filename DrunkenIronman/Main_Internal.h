@@ -12,6 +12,15 @@
 
 #include <Drink.h>
 
+#include "DumpParse.h"
+#include "DumpSynth.h"
+#include "VgaCapture.h"
+#include "VgaFingerprint.h"
+#include "VgaSynth.h"
+#include "VgaPixmap.h"
+#include "VgaImage.h"
+#include "VgaGif.h"
+
 
 /** Constants ***********************************************************/
 
@@ -20,6 +29,148 @@
  */
 #define VANITY_FORMAT_STRING ("%S\r\n")
 
+/**
+ * Prefix identifying a "convert" subfunction option.
+ * Options must precede all other arguments.
+ */
+#define CONVERT_OPTION_PREFIX (L"--")
+
+/**
+ * Separates an option's name from its value.
+ */
+#define CONVERT_OPTION_VALUE_SEPARATOR (L'=')
+
+/**
+ * Bits per pixel of the resulting BMP, unless specified otherwise.
+ */
+#define CONVERT_DEFAULT_BITS_PER_PIXEL (8)
+
+/**
+ * How many times smaller than the screen thumbnails are,
+ * unless specified otherwise (160x120 for mode 12h).
+ */
+#define CONVERT_DEFAULT_THUMBNAIL_SCALE (4)
+
+/**
+ * Output path that stands for the standard output.
+ */
+#define CONVERT_STANDARD_OUTPUT (L"-")
+
+/**
+ * Width of the terminal screens are drawn on,
+ * when the standard output isn't a console.
+ */
+#define CONVERT_DEFAULT_TTY_COLUMNS (80)
+
+/**
+ * Most bytes of decoded rows kept at a time on their way
+ * to a PNG, a pixmap or a BMP. A band is at least a row,
+ * and at least a row of characters in text mode.
+ */
+#define CONVERT_BAND_SIZE (4 * 1024)
+
+/**
+ * Largest Hamming distance between the fingerprints of screens
+ * that are considered duplicates, unless specified otherwise.
+ */
+#define DEDUP_DEFAULT_MAX_DISTANCE (3)
+
+/**
+ * Files with this extension are fingerprinted as BMPs.
+ * All other files are assumed to be memory dumps.
+ */
+#define DEDUP_BITMAP_EXTENSION (L".bmp")
+
+/**
+ * Number of files the file list initially has room for.
+ */
+#define DEDUP_INITIAL_CAPACITY (64)
+
+/**
+ * Marks the end of a group's member list.
+ */
+#define DEDUP_NO_FILE (MAXDWORD)
+
+/**
+ * Makes the "diff" subfunction read raw captures,
+ * as written by the "synth" subfunction.
+ * Must precede all other arguments.
+ */
+#define DIFF_RAW_OPTION (L"--raw")
+
+/**
+ * Options of the "animate" subfunction, which must precede
+ * all other arguments: read raw captures, as with "diff",
+ * and show each frame for the given number of hundredths of a second.
+ */
+#define ANIMATE_RAW_OPTION (L"--raw")
+#define ANIMATE_DELAY_OPTION (L"--delay=")
+
+/**
+ * How long each frame of an animation is shown,
+ * in hundredths of a second, unless specified otherwise.
+ */
+#define ANIMATE_DEFAULT_DELAY (50)
+
+/**
+ * Options of the "mosaic" subfunction, which must precede
+ * all other arguments: read raw captures, as with "diff",
+ * scale the screens down by n, and put n tiles in each row.
+ */
+#define MOSAIC_RAW_OPTION (L"--raw")
+#define MOSAIC_SCALE_OPTION (L"--scale=")
+#define MOSAIC_COLUMNS_OPTION (L"--columns=")
+
+/**
+ * How many times smaller than the screens the tiles are,
+ * unless specified otherwise.
+ */
+#define MOSAIC_DEFAULT_SCALE (4)
+
+/**
+ * Makes the "tags" subfunction read the dump through its index,
+ * writing one next to the dump if there is none.
+ * Must precede all other arguments.
+ */
+#define TAGS_INDEX_OPTION (L"--index")
+
+/**
+ * Number of times the "selftest" subfunction goes over
+ * the synthetic screens, unless specified otherwise.
+ */
+#define SELFTEST_DEFAULT_ROUNDS (2)
+
+/**
+ * Number of patches of noise the "selftest" subfunction
+ * pastes over a screen to have something to diff.
+ */
+#define SELFTEST_DIFF_PATCHES (3)
+
+/**
+ * Number of times the "bench" subfunction decodes each screen
+ * in each way, unless specified otherwise. The fastest time counts.
+ */
+#define BENCH_DEFAULT_REPETITIONS (16)
+
+/**
+ * Number of fingerprints the "bench" subfunction groups,
+ * at the "dedup" subfunction's default distance.
+ * Grouping is timed fewer times than decoding,
+ * since each takes far longer.
+ */
+#define BENCH_GROUP_FINGERPRINTS (1000000)
+#define BENCH_GROUP_REPETITIONS (4)
+
+
+/** Macros **************************************************************/
+
+/**
+ * Releases a capture read by main_ReadCapture,
+ * then resets the pointer to NULL.
+ */
+#define RELEASE_CAPTURE(pvCapture, cbCapture, bRaw) \
+	CLOSE_TO_VALUE_VARIADIC((pvCapture), main_ReleaseCapture, NULL, (cbCapture), (bRaw))
+
 
 /** Enums ***************************************************************/
 
@@ -57,13 +208,166 @@ typedef enum _SUBFUNCTION_CONVERT_ARGS
 	// Indicates the path to the dump file.
 	SUBFUNCTION_CONVERT_ARG_INPUT = 0,
 
-	// Indicates the path to the resulting BMP file.
+	// Indicates the path to the first resulting file.
+	// Any arguments after it are more resulting files.
 	SUBFUNCTION_CONVERT_ARG_OUTPUT,
 
 	// Must be last:
 	SUBFUNCTION_CONVERT_ARGS_COUNT
 } SUBFUNCTION_CONVERT_ARGS, *PSUBFUNCTION_CONVERT_ARGS;
 
+/**
+ * Command line argument positions for the "convert" subfunction
+ * (drawing on the terminal, with an input argument).
+ */
+typedef enum _SUBFUNCTION_CONVERT_TTY_ARGS
+{
+	// Indicates the path to the dump file.
+	SUBFUNCTION_CONVERT_TTY_ARG_INPUT = 0,
+
+	// Must be last:
+	SUBFUNCTION_CONVERT_TTY_ARGS_COUNT
+} SUBFUNCTION_CONVERT_TTY_ARGS, *PSUBFUNCTION_CONVERT_TTY_ARGS;
+
+/**
+ * Kinds of files the "convert" subfunction writes.
+ */
+typedef enum _CONVERT_FORMAT
+{
+	// A BMP, as the options describe it.
+	CONVERT_FORMAT_BMP = 0,
+
+	// A 16 color PNG.
+	CONVERT_FORMAT_PNG,
+
+	// One of the formats VgaPixmap writes.
+	CONVERT_FORMAT_PIXMAP,
+
+	// A true color BMP thumbnail, as --thumbnail writes.
+	// Outputs can't be written as thumbnails by name.
+	CONVERT_FORMAT_THUMBNAIL,
+
+	// Must be last:
+	CONVERT_FORMATS_COUNT
+} CONVERT_FORMAT, *PCONVERT_FORMAT;
+
+/**
+ * Command line argument positions for the "dedup" subfunction.
+ */
+typedef enum _SUBFUNCTION_DEDUP_ARGS
+{
+	// Indicates the directory containing the dumps and BMPs.
+	SUBFUNCTION_DEDUP_ARG_DIRECTORY = 0,
+
+	// Optional. Indicates the largest distance between duplicates.
+	SUBFUNCTION_DEDUP_ARG_MAX_DISTANCE,
+
+	// Must be last:
+	SUBFUNCTION_DEDUP_ARGS_COUNT
+} SUBFUNCTION_DEDUP_ARGS, *PSUBFUNCTION_DEDUP_ARGS;
+
+/**
+ * Command line argument positions for the "diff" subfunction.
+ */
+typedef enum _SUBFUNCTION_DIFF_ARGS
+{
+	// Indicate the paths to the dump files.
+	SUBFUNCTION_DIFF_ARG_FIRST = 0,
+	SUBFUNCTION_DIFF_ARG_SECOND,
+
+	// Optional. Indicates the path to the resulting BMP file.
+	SUBFUNCTION_DIFF_ARG_OUTPUT,
+
+	// Must be last:
+	SUBFUNCTION_DIFF_ARGS_COUNT
+} SUBFUNCTION_DIFF_ARGS, *PSUBFUNCTION_DIFF_ARGS;
+
+/**
+ * Command line argument positions for the "animate" subfunction.
+ */
+typedef enum _SUBFUNCTION_ANIMATE_ARGS
+{
+	// Indicates the path to the resulting GIF file.
+	SUBFUNCTION_ANIMATE_ARG_OUTPUT = 0,
+
+	// Indicates the path to the first frame's dump.
+	// Any arguments after it are the next frames' dumps.
+	SUBFUNCTION_ANIMATE_ARG_FIRST_FRAME,
+
+	// Must be last:
+	SUBFUNCTION_ANIMATE_ARGS_COUNT
+} SUBFUNCTION_ANIMATE_ARGS, *PSUBFUNCTION_ANIMATE_ARGS;
+
+/**
+ * Command line argument positions for the "mosaic" subfunction.
+ */
+typedef enum _SUBFUNCTION_MOSAIC_ARGS
+{
+	// Indicates the path to the resulting BMP file.
+	SUBFUNCTION_MOSAIC_ARG_OUTPUT = 0,
+
+	// Indicates the path to the first screen's dump.
+	// Any arguments after it are the next screens' dumps.
+	SUBFUNCTION_MOSAIC_ARG_FIRST_INPUT,
+
+	// Must be last:
+	SUBFUNCTION_MOSAIC_ARGS_COUNT
+} SUBFUNCTION_MOSAIC_ARGS, *PSUBFUNCTION_MOSAIC_ARGS;
+
+/**
+ * Command line argument positions for the "tags" subfunction.
+ */
+typedef enum _SUBFUNCTION_TAGS_ARGS
+{
+	// Optional. Indicates the path to the dump file.
+	SUBFUNCTION_TAGS_ARG_INPUT = 0,
+
+	// Must be last:
+	SUBFUNCTION_TAGS_ARGS_COUNT
+} SUBFUNCTION_TAGS_ARGS, *PSUBFUNCTION_TAGS_ARGS;
+
+/**
+ * Command line argument positions for the "synth" subfunction.
+ */
+typedef enum _SUBFUNCTION_SYNTH_ARGS
+{
+	// The kind of screen to generate.
+	SUBFUNCTION_SYNTH_ARG_KIND = 0,
+	// The screen's dimensions, in pixels.
+	SUBFUNCTION_SYNTH_ARG_WIDTH,
+	SUBFUNCTION_SYNTH_ARG_HEIGHT,
+	// Seeds the random choices.
+	SUBFUNCTION_SYNTH_ARG_SEED,
+	// Indicates the path to the resulting capture file.
+	SUBFUNCTION_SYNTH_ARG_OUTPUT,
+	// Must be last:
+	SUBFUNCTION_SYNTH_ARGS_COUNT
+} SUBFUNCTION_SYNTH_ARGS, *PSUBFUNCTION_SYNTH_ARGS;
+
+/**
+ * Command line argument positions for the "selftest" subfunction.
+ */
+typedef enum _SUBFUNCTION_SELFTEST_ARGS
+{
+	// Optional. Indicates how many times to go over the screens.
+	SUBFUNCTION_SELFTEST_ARG_ROUNDS = 0,
+
+	// Must be last:
+	SUBFUNCTION_SELFTEST_ARGS_COUNT
+} SUBFUNCTION_SELFTEST_ARGS, *PSUBFUNCTION_SELFTEST_ARGS;
+
+/**
+ * Command line argument positions for the "bench" subfunction.
+ */
+typedef enum _SUBFUNCTION_BENCH_ARGS
+{
+	// Optional. Indicates how many times to decode each screen.
+	SUBFUNCTION_BENCH_ARG_REPETITIONS = 0,
+
+	// Must be last:
+	SUBFUNCTION_BENCH_ARGS_COUNT
+} SUBFUNCTION_BENCH_ARGS, *PSUBFUNCTION_BENCH_ARGS;
+
 /**
  * Command line argument positions for the "vanity" subfunction.
  */
@@ -115,6 +419,225 @@ typedef struct _SUBFUNCTION_HANDLER_ENTRY
 } SUBFUNCTION_HANDLER_ENTRY, *PSUBFUNCTION_HANDLER_ENTRY;
 typedef CONST SUBFUNCTION_HANDLER_ENTRY *PCSUBFUNCTION_HANDLER_ENTRY;
 
+/**
+ * Structure describing a single format of the "convert" subfunction.
+ */
+typedef struct _CONVERT_FORMAT_ENTRY
+{
+	// The format's name, which is also its extension.
+	PCWSTR				pwszName;
+
+	// What kind of file it is, and for pixmaps, which format.
+	CONVERT_FORMAT		eFormat;
+	VGA_PIXMAP_FORMAT	ePixmapFormat;
+} CONVERT_FORMAT_ENTRY, *PCONVERT_FORMAT_ENTRY;
+typedef CONST CONVERT_FORMAT_ENTRY *PCCONVERT_FORMAT_ENTRY;
+
+/**
+ * Options for the "convert" subfunction.
+ */
+typedef struct _CONVERT_OPTIONS
+{
+	// Bits per pixel of the resulting BMP (4, 8 or 32).
+	WORD					nBitsPerPixel;
+
+	// Whether to write the text on the screen instead of a BMP.
+	BOOL					bText;
+
+	// Font to read the text of graphics mode screens with.
+	PCWSTR					pwszFontPath;
+
+	// Where to write a thumbnail of the screen, if anywhere,
+	// and how many times smaller than the screen it is.
+	PCWSTR					pwszThumbnailPath;
+	DWORD					nThumbnailScale;
+
+	// Whether the input is a bare capture, as written by
+	// the "synth" subfunction, rather than a memory dump.
+	BOOL					bRaw;
+
+	// Whether to run-length encode the pixels of a paletted BMP.
+	BOOL					bRle;
+
+	// The format to write, or NULL to go by the output's extension.
+	PCCONVERT_FORMAT_ENTRY	ptFormat;
+
+	// Whether to print the screen's fingerprint,
+	// as the "dedup" subfunction calculates it.
+	BOOL					bFingerprint;
+
+	// Whether to write outputs of a known size straight into
+	// a mapping of the file, and whether to leave writing
+	// the mapping to the disk to the system.
+	BOOL					bMapped;
+	BOOL					bScratch;
+
+	// Whether to draw the screen on the terminal instead of
+	// writing files, and how many columns wide it is
+	// (0 to ask the console).
+	BOOL					bTty;
+	DWORD					nTtyColumns;
+
+	// Whether to read the dump through its index,
+	// writing one next to the dump if there is none.
+	BOOL					bIndexed;
+} CONVERT_OPTIONS, *PCONVERT_OPTIONS;
+typedef CONST CONVERT_OPTIONS *PCCONVERT_OPTIONS;
+
+/**
+ * What the outputs of the "convert" subfunction are written from.
+ */
+typedef struct _CONVERT_SOURCE
+{
+	// The screen, as captured.
+	PCVGA_CAPTURE_VIEW	ptCapture;
+
+	// The screen, decoded, if more than one output needs its pixels.
+	// Otherwise, each band of rows is decoded as it is written.
+	PCVGA_IMAGE			ptImage;
+
+	PCCONVERT_OPTIONS	ptOptions;
+} CONVERT_SOURCE, *PCONVERT_SOURCE;
+typedef CONST CONVERT_SOURCE *PCCONVERT_SOURCE;
+
+/**
+ * "convert" encoder prototype.
+ * Writes an output in one kind of format.
+ *
+ * @param[in]	ptSource	What to write the output from.
+ * @param[in]	ptFormat	The output's format.
+ * @param[in]	hStream		Where to write the output.
+ *
+ * @returns HRESULT
+ *
+ * @remark	Encoders of different outputs may run at the same time,
+ *			so they may only read the source.
+ */
+typedef
+HRESULT
+FN_CONVERT_ENCODER(
+	_In_	PCCONVERT_SOURCE		ptSource,
+	_In_	PCCONVERT_FORMAT_ENTRY	ptFormat,
+	_In_	HVGASTREAM				hStream
+);
+typedef FN_CONVERT_ENCODER *PFN_CONVERT_ENCODER;
+
+/**
+ * An output of the "convert" subfunction.
+ */
+typedef struct _CONVERT_JOB
+{
+	// Where to write the output, and in which format.
+	PCWSTR					pwszPath;
+	PCCONVERT_FORMAT_ENTRY	ptFormat;
+
+	// How writing it went.
+	HRESULT					hrResult;
+} CONVERT_JOB, *PCONVERT_JOB;
+typedef CONST CONVERT_JOB *PCCONVERT_JOB;
+
+/**
+ * The outputs of the "convert" subfunction,
+ * as the thread pool works through them.
+ */
+typedef struct _CONVERT_JOBS
+{
+	PCCONVERT_SOURCE	ptSource;
+
+	// The outputs, and the next one to start writing.
+	PCONVERT_JOB		ptJobs;
+	DWORD				nJobs;
+	volatile LONG		nNextJob;
+} CONVERT_JOBS, *PCONVERT_JOBS;
+typedef CONST CONVERT_JOBS *PCCONVERT_JOBS;
+
+/**
+ * The screens of the "mosaic" subfunction,
+ * as the thread pool draws them into their tiles.
+ */
+typedef struct _MOSAIC_JOBS
+{
+	// The dumps, and the next one to start drawing.
+	CONST PCWSTR *	ppwszInputs;
+	DWORD			nInputs;
+	volatile LONG	nNextInput;
+
+	// Whether the dumps are raw captures.
+	BOOL			bRaw;
+
+	// The downscaling factor, and the size of each tile.
+	DWORD			nScale;
+	DWORD			nTileWidth;
+	DWORD			nTileHeight;
+
+	// The mosaic, top row first, nColumns tiles to a row.
+	// Every screen is drawn straight into its own tile.
+	RGBQUAD *		ptPixels;
+	DWORD			nColumns;
+
+	// How many screens couldn't be drawn.
+	volatile LONG	nFailures;
+} MOSAIC_JOBS, *PMOSAIC_JOBS;
+
+/**
+ * The files fingerprinted by the "dedup" subfunction.
+ */
+typedef struct _DEDUP_FILES
+{
+	// Number of files in the list, and how many it has room for.
+	DWORD				nFiles;
+	DWORD				nCapacity;
+
+	// The path and fingerprint of each file.
+	PWSTR *				ppwszPaths;
+	PVGA_FINGERPRINT	pnFingerprints;
+} DEDUP_FILES, *PDEDUP_FILES;
+typedef CONST DEDUP_FILES *PCDEDUP_FILES;
+
+/**
+ * A corpus of fingerprints the "bench" subfunction groups:
+ * random ones, with copies of one of them mixed in.
+ */
+typedef struct _BENCH_GROUP_CORPUS
+{
+	// Number of copies.
+	DWORD	nDuplicates;
+
+	// Whether the copies have a few bits flipped,
+	// rather than being identical.
+	BOOL	bNear;
+} BENCH_GROUP_CORPUS, *PBENCH_GROUP_CORPUS;
+typedef CONST BENCH_GROUP_CORPUS *PCBENCH_GROUP_CORPUS;
+
+/**
+ * "convert" option handler prototype.
+ *
+ * @param[in]		pwszValue	The option's value, if one was specified.
+ * @param[in,out]	ptOptions	The options to update.
+ *
+ * @returns HRESULT
+ */
+typedef
+HRESULT
+FN_CONVERT_OPTION_HANDLER(
+	_In_opt_	PCWSTR				pwszValue,
+	_Inout_		PCONVERT_OPTIONS	ptOptions
+);
+typedef FN_CONVERT_OPTION_HANDLER *PFN_CONVERT_OPTION_HANDLER;
+
+/**
+ * Structure describing a single "convert" option.
+ */
+typedef struct _CONVERT_OPTION_ENTRY
+{
+	// The option name, including the prefix.
+	PCWSTR						pwszOptionName;
+
+	// The handler function.
+	PFN_CONVERT_OPTION_HANDLER	pfnHandler;
+} CONVERT_OPTION_ENTRY, *PCONVERT_OPTION_ENTRY;
+typedef CONST CONVERT_OPTION_ENTRY *PCCONVERT_OPTION_ENTRY;
+
 /**
  * Structure of the finished BMP on disk.
  */
@@ -124,9 +647,34 @@ typedef struct _VGA_BITMAP
 	BITMAPFILEHEADER	tFileHeader;
 	BITMAPINFOHEADER	tInfoHeader;
 	RGBQUAD				atColors[VGA_DAC_PALETTE_ENTRIES];
-	BYTE				anPixels[SCREEN_WIDTH_PIXELS * SCREEN_HEIGHT_PIXELS];
+	BYTE				anPixels[ANYSIZE_ARRAY];
 } VGA_BITMAP, *PVGA_BITMAP;
 typedef CONST VGA_BITMAP *PCVGA_BITMAP;
+
+/**
+ * Structure of the finished 4bpp BMP on disk.
+ * Only the VGA_COLORS pixel values need a palette entry,
+ * and each byte holds two pixels.
+ */
+typedef struct _VGA_PACKED_BITMAP
+{
+	BITMAPFILEHEADER	tFileHeader;
+	BITMAPINFOHEADER	tInfoHeader;
+	RGBQUAD				atColors[VGA_COLORS];
+	BYTE				anPixels[ANYSIZE_ARRAY];
+} VGA_PACKED_BITMAP, *PVGA_PACKED_BITMAP;
+typedef CONST VGA_PACKED_BITMAP *PCVGA_PACKED_BITMAP;
+
+/**
+ * Structure of the finished true color BMP on disk.
+ */
+typedef struct _VGA_TRUECOLOR_BITMAP
+{
+	BITMAPFILEHEADER	tFileHeader;
+	BITMAPINFOHEADER	tInfoHeader;
+	RGBQUAD				atPixels[ANYSIZE_ARRAY];
+} VGA_TRUECOLOR_BITMAP, *PVGA_TRUECOLOR_BITMAP;
+typedef CONST VGA_TRUECOLOR_BITMAP *PCVGA_TRUECOLOR_BITMAP;
 #pragma pack(pop)
 
 
@@ -147,53 +695,1247 @@ main_VgaDacEntryToRgb(
 );
 
 /**
- * Extracts the bit value of a pixel from a single VGA plane.
- * The bit values from all 4 planes should be combined
- * to obtain the index into the Palette RAM.
+ * Fills in the headers of a top-down, uncompressed BMP.
  *
- * @param[in]	pnPlane		The plane data.
- * @param[in]	nPixelIndex	Index of the pixel.
+ * @param[out]	ptFileHeader	The BMP's file header.
+ * @param[out]	ptInfoHeader	The BMP's info header.
+ * @param[in]	nWidth			Width of the BMP, in pixels.
+ * @param[in]	nHeight			Height of the BMP, in pixels.
+ * @param[in]	nBitsPerPixel	Bits per pixel of the BMP.
+ * @param[in]	cbHeaders		Offset of the pixel data in the file.
+ * @param[in]	cbBitmap		Size of the whole file.
+ */
+STATIC
+VOID
+main_InitializeBitmapHeaders(
+	_Out_	BITMAPFILEHEADER *	ptFileHeader,
+	_Out_	BITMAPINFOHEADER *	ptInfoHeader,
+	_In_	DWORD				nWidth,
+	_In_	DWORD				nHeight,
+	_In_	WORD				nBitsPerPixel,
+	_In_	DWORD				cbHeaders,
+	_In_	DWORD				cbBitmap
+);
+
+/**
+ * Looks up the colors the VGA_COLORS pixel values
+ * of a VGA dump are displayed with.
  *
- * @returns BYTE (contains just one bit, the LSB)
+ * @param[in]	ptCapture	The dump.
+ * @param[out]	ptPalette	Will receive the colors.
  */
 STATIC
-BYTE
-main_GetPixelBitFromPlane(
-	_In_	CONST BYTE *	pnPlane,
-	_In_	DWORD			nPixelIndex
+VOID
+main_GetPixelColors(
+	_In_							PCVGA_CAPTURE_VIEW	ptCapture,
+	_Out_writes_all_(VGA_COLORS)	RGBQUAD *			ptPalette
 );
 
 /**
- * Converts a VGA dump to a bitmap.
+ * Allocates a true color bitmap and fills in its headers.
  *
- * @param[in]	ptDump		Dump to convert.
- * @param[out]	pptBitmap	Will receive the converted bitmap.
+ * @param[in]	nWidth		Width of the bitmap, in pixels.
+ * @param[in]	nHeight		Height of the bitmap, in pixels.
+ * @param[out]	pptBitmap	Will receive the bitmap.
+ * @param[out]	pcbBitmap	Will receive the bitmap's size, in bytes.
  *
  * @returns HRESULT
  */
 STATIC
 HRESULT
-main_VgaDumpToBitmap(
-	_In_		PCVGA_DUMP		ptDump,
-	_Outptr_	PVGA_BITMAP *	pptBitmap
+main_AllocateTrueColorBitmap(
+	_In_		DWORD					nWidth,
+	_In_		DWORD					nHeight,
+	_Outptr_	PVGA_TRUECOLOR_BITMAP *	pptBitmap,
+	_Out_		PDWORD					pcbBitmap
 );
 
 /**
- * Handler for the "convert" subfunction.
- * Extracts a VGA dump from a memory dump file
- * and converts it to a BMP file.
+ * Looks up the colors of a VGA dump's whole DAC palette,
+ * as an 8bpp BMP's palette: the VGA_COLORS pixel values
+ * go through the Attribute Controller first.
+ * Entries past the dump's palette are left alone.
  *
- * @param[in]	nArguments		Number of command line arguments.
- * @param[in]	ppwszArguments	The command line arguments.
+ * @param[in]	ptCapture	The dump.
+ * @param[out]	ptColors	Will receive the colors.
+ */
+STATIC
+VOID
+main_GetDacColors(
+	_In_									PCVGA_CAPTURE_VIEW	ptCapture,
+	_Out_writes_(VGA_DAC_PALETTE_ENTRIES)	RGBQUAD *			ptColors
+);
+
+/**
+ * Determines how many rows of a VGA dump to decode at a time,
+ * so that a band fits in CONVERT_BAND_SIZE where possible.
+ * Text mode bands are whole rows of characters.
  *
- * @returns HRESULT
+ * @param[in]	ptCapture	The dump.
+ * @param[in]	cbRow		Size of a decoded row, in bytes.
  *
- * @see SUBFUNCTION_CONVERT_NO_INPUT_ARGS
- *      SUBFUNCTION_CONVERT_ARGS
+ * @returns DWORD
  */
 STATIC
-HRESULT
-main_HandleConvert(
+DWORD
+main_GetBandRows(
+	_In_	PCVGA_CAPTURE_VIEW	ptCapture,
+	_In_	DWORD				cbRow
+);
+
+/**
+ * Retrieves a band of a VGA dump's rows as indexed pixels,
+ * decoding them unless the dump was already decoded.
+ *
+ * @param[in]	ptCapture		The dump.
+ * @param[in]	ptImage			The decoded dump, if it was decoded.
+ * @param[in]	nRow			The band's first row.
+ * @param[in]	nRows			Number of rows in the band.
+ *								In text mode, both must be multiples
+ *								of the character height.
+ * @param[in]	nBitsPerPixel	4 to pack the pixels as in a 4bpp BMP,
+ *								8 for a pixel per byte.
+ * @param[out]	pnBuffer		Room for the pixels, if they
+ *								have to be decoded or packed.
+ * @param[in]	cbRow			Distance between rows of the band, in bytes.
+ *								At 8bpp, must be the width rounded up
+ *								to a multiple of 4, as in the image.
+ *
+ * @returns CONST BYTE * (the band's top row, in pnBuffer or in the image)
+ */
+STATIC
+CONST BYTE *
+main_GetBand(
+	_In_						PCVGA_CAPTURE_VIEW	ptCapture,
+	_In_opt_					PCVGA_IMAGE			ptImage,
+	_In_						DWORD				nRow,
+	_In_						DWORD				nRows,
+	_In_						WORD				nBitsPerPixel,
+	_Out_writes_(cbRow * nRows)	PBYTE				pnBuffer,
+	_In_						DWORD				cbRow
+);
+
+/**
+ * Allocates a true color bitmap for a VGA dump's thumbnail.
+ *
+ * @param[in]	ptCapture		The dump.
+ * @param[in]	nScale			How many times smaller than the screen
+ *								the thumbnail is.
+ * @param[out]	pptThumbnail	Will receive the thumbnail bitmap.
+ * @param[out]	pcbThumbnail	Will receive the thumbnail's size, in bytes.
+ *
+ * @returns HRESULT
+ */
+STATIC
+HRESULT
+main_AllocateThumbnail(
+	_In_		PCVGA_CAPTURE_VIEW		ptCapture,
+	_In_		DWORD					nScale,
+	_Outptr_	PVGA_TRUECOLOR_BITMAP *	pptThumbnail,
+	_Out_		PDWORD					pcbThumbnail
+);
+
+/**
+ * Converts a VGA dump to an uncompressed 4bpp, 8bpp or 32bpp
+ * bitmap, written to a stream as it is decoded: the headers
+ * and the palette go first, and then a band of rows at a time,
+ * so that the whole bitmap is never in memory.
+ *
+ * @param[in]	ptCapture		Dump to convert.
+ * @param[in]	ptImage			The decoded dump, if it was decoded.
+ * @param[in]	nBitsPerPixel	4, 8 or 32.
+ * @param[in]	hStream			Where to write the bitmap.
+ *
+ * @returns HRESULT
+ */
+STATIC
+HRESULT
+main_VgaDumpToStreamedBitmap(
+	_In_		PCVGA_CAPTURE_VIEW	ptCapture,
+	_In_opt_	PCVGA_IMAGE			ptImage,
+	_In_		WORD				nBitsPerPixel,
+	_In_		HVGASTREAM			hStream
+);
+
+/**
+ * Converts a VGA dump to a run-length encoded (BI_RLE4 or BI_RLE8)
+ * bitmap. The runs are found in the decoded rows a quadword at
+ * a time, so the dump is decoded whole unless it already was.
+ *
+ * @param[in]	ptCapture		Dump to convert.
+ * @param[in]	ptImage			The decoded dump, if it was decoded.
+ * @param[in]	nBitsPerPixel	4 or 8.
+ * @param[out]	ppvBitmap		Will receive the converted bitmap.
+ * @param[out]	pcbBitmap		Will receive the bitmap's size, in bytes.
+ *
+ * @returns HRESULT
+ */
+STATIC
+HRESULT
+main_VgaDumpToCompressedBitmap(
+	_In_									PCVGA_CAPTURE_VIEW	ptCapture,
+	_In_opt_								PCVGA_IMAGE			ptImage,
+	_In_									WORD				nBitsPerPixel,
+	_Outptr_result_bytebuffer_(*pcbBitmap)	PVOID *				ppvBitmap,
+	_Out_									PDWORD				pcbBitmap
+);
+
+/**
+ * Converts a VGA dump to a 16 color PNG. The screen is decoded
+ * a band of rows at a time, and every row is compressed
+ * as soon as it is decoded.
+ *
+ * @param[in]	ptCapture	Dump to convert.
+ * @param[in]	ptImage		The decoded dump, if it was decoded.
+ * @param[out]	ppnPng		Will receive the PNG file.
+ * @param[out]	pcbPng		Will receive the PNG's size, in bytes.
+ *
+ * @returns HRESULT
+ */
+STATIC
+HRESULT
+main_VgaDumpToPng(
+	_In_								PCVGA_CAPTURE_VIEW	ptCapture,
+	_In_opt_							PCVGA_IMAGE			ptImage,
+	_Outptr_result_bytebuffer_(*pcbPng)	PBYTE *				ppnPng,
+	_Out_								PDWORD				pcbPng
+);
+
+/**
+ * Converts a VGA dump to a pixmap, written to a stream as it is
+ * decoded a band of rows at a time.
+ *
+ * @param[in]	ptCapture	Dump to convert.
+ * @param[in]	ptImage		The decoded dump, if it was decoded.
+ * @param[in]	eFormat		The pixmap format to write.
+ * @param[in]	hStream		Where to write the pixmap.
+ *
+ * @returns HRESULT
+ */
+STATIC
+HRESULT
+main_VgaDumpToPixmap(
+	_In_		PCVGA_CAPTURE_VIEW	ptCapture,
+	_In_opt_	PCVGA_IMAGE			ptImage,
+	_In_		VGA_PIXMAP_FORMAT	eFormat,
+	_In_		HVGASTREAM			hStream
+);
+
+/**
+ * Converts a VGA dump to a true color bitmap, and optionally
+ * to a thumbnail, in a single pass over the planes.
+ *
+ * @param[in]	ptCapture		Dump to convert.
+ * @param[in]	nThumbnailScale	How many times smaller than the screen
+ *								the thumbnail is.
+ * @param[out]	pptBitmap		Will receive the converted bitmap.
+ * @param[out]	pcbBitmap		Will receive the bitmap's size, in bytes.
+ * @param[out]	pptThumbnail	Optionally receives the thumbnail.
+ * @param[out]	pcbThumbnail	Will receive the thumbnail's size, in bytes.
+ *
+ * @returns HRESULT
+ */
+STATIC
+HRESULT
+main_VgaDumpToTrueColorBitmap(
+	_In_			PCVGA_CAPTURE_VIEW		ptCapture,
+	_In_			DWORD					nThumbnailScale,
+	_Outptr_		PVGA_TRUECOLOR_BITMAP *	pptBitmap,
+	_Out_			PDWORD					pcbBitmap,
+	_Outptr_opt_	PVGA_TRUECOLOR_BITMAP *	pptThumbnail,
+	_Out_opt_		PDWORD					pcbThumbnail
+);
+
+/**
+ * Handler for the "--bpp" option of the "convert" subfunction.
+ * Selects the bits per pixel of the resulting BMP.
+ *
+ * @see FN_CONVERT_OPTION_HANDLER
+ */
+STATIC
+HRESULT
+main_HandleBitsPerPixelOption(
+	_In_opt_	PCWSTR				pwszValue,
+	_Inout_		PCONVERT_OPTIONS	ptOptions
+);
+
+/**
+ * Handler for the "--text" option of the "convert" subfunction.
+ * Writes the text on the screen instead of a BMP.
+ *
+ * @see FN_CONVERT_OPTION_HANDLER
+ */
+STATIC
+HRESULT
+main_HandleTextOption(
+	_In_opt_	PCWSTR				pwszValue,
+	_Inout_		PCONVERT_OPTIONS	ptOptions
+);
+
+/**
+ * Handler for the "--font" option of the "convert" subfunction.
+ * Selects the font to read the text of graphics mode screens with.
+ *
+ * @see FN_CONVERT_OPTION_HANDLER
+ */
+STATIC
+HRESULT
+main_HandleFontOption(
+	_In_opt_	PCWSTR				pwszValue,
+	_Inout_		PCONVERT_OPTIONS	ptOptions
+);
+
+/**
+ * Handler for the "--thumbnail" option of the "convert" subfunction.
+ * Also writes a thumbnail of the screen to the specified path.
+ *
+ * @see FN_CONVERT_OPTION_HANDLER
+ */
+STATIC
+HRESULT
+main_HandleThumbnailOption(
+	_In_opt_	PCWSTR				pwszValue,
+	_Inout_		PCONVERT_OPTIONS	ptOptions
+);
+
+/**
+ * Handler for the "--scale" option of the "convert" subfunction.
+ * Selects how many times smaller than the screen the thumbnail is.
+ *
+ * @see FN_CONVERT_OPTION_HANDLER
+ */
+STATIC
+HRESULT
+main_HandleScaleOption(
+	_In_opt_	PCWSTR				pwszValue,
+	_Inout_		PCONVERT_OPTIONS	ptOptions
+);
+
+/**
+ * Handler for the "--raw" option of the "convert" subfunction.
+ * Reads a bare capture instead of a memory dump.
+ *
+ * @see FN_CONVERT_OPTION_HANDLER
+ */
+STATIC
+HRESULT
+main_HandleRawOption(
+	_In_opt_	PCWSTR				pwszValue,
+	_Inout_		PCONVERT_OPTIONS	ptOptions
+);
+
+/**
+ * Handler for the "--rle" option of the "convert" subfunction.
+ * Run-length encodes the pixels of a paletted BMP.
+ *
+ * @see FN_CONVERT_OPTION_HANDLER
+ */
+STATIC
+HRESULT
+main_HandleRleOption(
+	_In_opt_	PCWSTR				pwszValue,
+	_Inout_		PCONVERT_OPTIONS	ptOptions
+);
+
+/**
+ * Finds a format of the "convert" subfunction by its name.
+ *
+ * @param[in]	pwszName	The name, which is also the format's extension.
+ *
+ * @returns PCCONVERT_FORMAT_ENTRY (NULL if there is no such format)
+ */
+STATIC
+PCCONVERT_FORMAT_ENTRY
+main_FindConvertFormat(
+	_In_	PCWSTR	pwszName
+);
+
+/**
+ * Handler for the "--format" option of the "convert" subfunction.
+ * Writes the given format, whatever the output's extension.
+ *
+ * @see FN_CONVERT_OPTION_HANDLER
+ */
+STATIC
+HRESULT
+main_HandleFormatOption(
+	_In_opt_	PCWSTR				pwszValue,
+	_Inout_		PCONVERT_OPTIONS	ptOptions
+);
+
+/**
+ * Handler for the "--fingerprint" option of the "convert" subfunction.
+ * Prints the screen's fingerprint to the standard output.
+ *
+ * @see FN_CONVERT_OPTION_HANDLER
+ */
+STATIC
+HRESULT
+main_HandleFingerprintOption(
+	_In_opt_	PCWSTR				pwszValue,
+	_Inout_		PCONVERT_OPTIONS	ptOptions
+);
+
+/**
+ * Handler for the "--mmap" option of the "convert" subfunction.
+ * Maps the output files, and decodes BMPs straight into them.
+ *
+ * @see FN_CONVERT_OPTION_HANDLER
+ */
+STATIC
+HRESULT
+main_HandleMappedOption(
+	_In_opt_	PCWSTR				pwszValue,
+	_Inout_		PCONVERT_OPTIONS	ptOptions
+);
+
+/**
+ * Handler for the "--scratch" option of the "convert" subfunction.
+ * Doesn't wait for mapped output files to reach the disk.
+ *
+ * @see FN_CONVERT_OPTION_HANDLER
+ */
+STATIC
+HRESULT
+main_HandleScratchOption(
+	_In_opt_	PCWSTR				pwszValue,
+	_Inout_		PCONVERT_OPTIONS	ptOptions
+);
+
+/**
+ * Handler for the "--tty" option of the "convert" subfunction.
+ * Optionally takes the width of the terminal.
+ *
+ * @see FN_CONVERT_OPTION_HANDLER
+ */
+STATIC
+HRESULT
+main_HandleTtyOption(
+	_In_opt_	PCWSTR				pwszValue,
+	_Inout_		PCONVERT_OPTIONS	ptOptions
+);
+
+/**
+ * Handler for the "--index" option of the "convert" subfunction.
+ * Reads the dump through its index.
+ *
+ * @see FN_CONVERT_OPTION_HANDLER
+ */
+STATIC
+HRESULT
+main_HandleIndexOption(
+	_In_opt_	PCWSTR				pwszValue,
+	_Inout_		PCONVERT_OPTIONS	ptOptions
+);
+
+/**
+ * Parses the options at the beginning of the
+ * "convert" subfunction's arguments.
+ *
+ * @param[in]	nArguments		Number of command line arguments.
+ * @param[in]	ppwszArguments	The command line arguments.
+ * @param[out]	ptOptions		Will receive the parsed options.
+ * @param[out]	pnOptions		Will receive the number of arguments
+ *								that were options.
+ *
+ * @returns HRESULT
+ */
+STATIC
+HRESULT
+main_ParseConvertOptions(
+	_In_					INT					nArguments,
+	_In_reads_(nArguments)	CONST PCWSTR *		ppwszArguments,
+	_Out_					PCONVERT_OPTIONS	ptOptions,
+	_Out_					PINT				pnOptions
+);
+
+/**
+ * Reads the VGA capture saved to a memory dump,
+ * or a raw capture file.
+ * Captures in memory dumps are mapped straight from the dump,
+ * rather than copied out of it.
+ *
+ * @param[in]	pwszPath	The file, or NULL for the system memory dump.
+ * @param[in]	bRaw		Whether the file is a raw capture.
+ * @param[in]	bIndexed	Whether to read the dump through its index.
+ * @param[out]	ppvCapture	Will receive the capture.
+ *							Release with RELEASE_CAPTURE.
+ * @param[out]	pcbCapture	Will receive the capture's size, in bytes.
+ *
+ * @returns HRESULT
+ */
+STATIC
+HRESULT
+main_ReadCapture(
+	_In_opt_								PCWSTR		pwszPath,
+	_In_									BOOL		bRaw,
+	_In_									BOOL		bIndexed,
+	_Outptr_result_bytebuffer_(*pcbCapture)	LPCVOID *	ppvCapture,
+	_Out_									PDWORD		pcbCapture
+);
+
+/**
+ * Releases a capture read by main_ReadCapture.
+ *
+ * @param[in]	pvCapture	The capture.
+ * @param[in]	cbCapture	The capture's size, in bytes.
+ * @param[in]	bRaw		Whether it was read as a raw capture.
+ *
+ * @see RELEASE_CAPTURE
+ */
+STATIC
+VOID
+main_ReleaseCapture(
+	_In_	LPCVOID	pvCapture,
+	_In_	DWORD	cbCapture,
+	_In_	BOOL	bRaw
+);
+
+/**
+ * Encoder of the "convert" subfunction's BMPs,
+ * as the options describe them.
+ *
+ * @see FN_CONVERT_ENCODER
+ */
+STATIC
+HRESULT
+main_EncodeBitmap(
+	_In_	PCCONVERT_SOURCE		ptSource,
+	_In_	PCCONVERT_FORMAT_ENTRY	ptFormat,
+	_In_	HVGASTREAM				hStream
+);
+
+/**
+ * Encoder of the "convert" subfunction's PNGs.
+ *
+ * @see FN_CONVERT_ENCODER
+ */
+STATIC
+HRESULT
+main_EncodePng(
+	_In_	PCCONVERT_SOURCE		ptSource,
+	_In_	PCCONVERT_FORMAT_ENTRY	ptFormat,
+	_In_	HVGASTREAM				hStream
+);
+
+/**
+ * Encoder of the "convert" subfunction's pixmaps.
+ *
+ * @see FN_CONVERT_ENCODER
+ */
+STATIC
+HRESULT
+main_EncodePixmap(
+	_In_	PCCONVERT_SOURCE		ptSource,
+	_In_	PCCONVERT_FORMAT_ENTRY	ptFormat,
+	_In_	HVGASTREAM				hStream
+);
+
+/**
+ * Encoder of the "convert" subfunction's thumbnails.
+ * Thumbnails are counted straight from the planes,
+ * so they never need the decoded dump.
+ *
+ * @see FN_CONVERT_ENCODER
+ */
+STATIC
+HRESULT
+main_EncodeThumbnail(
+	_In_	PCCONVERT_SOURCE		ptSource,
+	_In_	PCCONVERT_FORMAT_ENTRY	ptFormat,
+	_In_	HVGASTREAM				hStream
+);
+
+/**
+ * Opens an output of the "convert" subfunction.
+ * With --mmap, files are opened so that they can be mapped.
+ *
+ * @param[in]	pwszPath	The output file,
+ *							or NULL for the standard output.
+ * @param[in]	ptOptions	The subfunction's options.
+ * @param[out]	phStream	Will receive a handle to the stream.
+ *
+ * @returns HRESULT
+ */
+STATIC
+HRESULT
+main_OpenConvertOutput(
+	_In_opt_	PCWSTR				pwszPath,
+	_In_		PCCONVERT_OPTIONS	ptOptions,
+	_Out_		PHVGASTREAM			phStream
+);
+
+/**
+ * Writes an output of the "convert" subfunction,
+ * with the encoder registered for its format.
+ *
+ * @param[in]	ptSource	What to write the output from.
+ * @param[in]	ptJob		The output. Receives the result.
+ */
+STATIC
+VOID
+main_RunConvertJob(
+	_In_	PCCONVERT_SOURCE	ptSource,
+	_Inout_	PCONVERT_JOB		ptJob
+);
+
+/**
+ * Thread pool callback that writes the next output
+ * of the "convert" subfunction. Submitted once per output.
+ *
+ * @param[in]	ptInstance	The callback instance.
+ * @param[in]	pvContext	The outputs (PCONVERT_JOBS).
+ * @param[in]	ptWork		The work object.
+ */
+STATIC
+VOID
+CALLBACK
+main_ConvertWorkCallback(
+	_Inout_		PTP_CALLBACK_INSTANCE	ptInstance,
+	_Inout_opt_	PVOID					pvContext,
+	_Inout_		PTP_WORK				ptWork
+);
+
+/**
+ * Writes the outputs of the "convert" subfunction,
+ * all at once on the thread pool if there is more than one.
+ *
+ * @param[in]		ptSource	What to write the outputs from.
+ * @param[in,out]	ptJobs		The outputs. Each receives its result.
+ * @param[in]		nJobs		Number of outputs.
+ *
+ * @returns HRESULT (the first output's failure, if any failed)
+ */
+STATIC
+HRESULT
+main_RunConvertJobs(
+	_In_					PCCONVERT_SOURCE	ptSource,
+	_Inout_updates_(nJobs)	PCONVERT_JOB		ptJobs,
+	_In_					DWORD				nJobs
+);
+
+/**
+ * Retrieves the width of the console the standard output
+ * is written to.
+ *
+ * @returns DWORD (in characters, or CONVERT_DEFAULT_TTY_COLUMNS
+ *          if the standard output isn't a console)
+ */
+STATIC
+DWORD
+main_GetTerminalColumns(VOID);
+
+/**
+ * Draws a captured screen on the terminal, through the standard output.
+ * Consoles are told to expect escape sequences and UTF-8 meanwhile.
+ *
+ * @param[in]	ptCapture	The capture.
+ * @param[in]	nColumns	Width of the terminal, in characters,
+ *							or 0 to ask the console.
+ *
+ * @returns HRESULT
+ */
+STATIC
+HRESULT
+main_DrawOnTerminal(
+	_In_	PCVGA_CAPTURE_VIEW	ptCapture,
+	_In_	DWORD				nColumns
+);
+
+/**
+ * Handler for the "convert" subfunction.
+ * Extracts a VGA dump from a memory dump file
+ * and converts it to image files, or to text.
+ * An output may be the standard output.
+ *
+ * @param[in]	nArguments		Number of command line arguments.
+ * @param[in]	ppwszArguments	The command line arguments.
+ *
+ * @returns HRESULT
+ *
+ * @see SUBFUNCTION_CONVERT_NO_INPUT_ARGS
+ *      SUBFUNCTION_CONVERT_ARGS
+ */
+STATIC
+HRESULT
+main_HandleConvert(
+	_In_					INT				nArguments,
+	_In_reads_(nArguments)	CONST PCWSTR *	ppwszArguments
+);
+
+/**
+ * Fingerprints the screen saved in a file,
+ * which is either a memory dump or a BMP.
+ *
+ * @param[in]	pwszPath		Path of the file.
+ * @param[out]	pnFingerprint	Will receive the fingerprint.
+ *
+ * @returns HRESULT
+ */
+STATIC
+HRESULT
+main_FingerprintFile(
+	_In_	PCWSTR				pwszPath,
+	_Out_	PVGA_FINGERPRINT	pnFingerprint
+);
+
+/**
+ * Appends a file to the list of fingerprinted files.
+ *
+ * @param[in,out]	ptFiles			The list.
+ * @param[in]		pwszPath		Path of the file.
+ * @param[in]		nFingerprint	The file's fingerprint.
+ *
+ * @returns HRESULT
+ */
+STATIC
+HRESULT
+main_AddDedupFile(
+	_Inout_	PDEDUP_FILES	ptFiles,
+	_In_	PCWSTR			pwszPath,
+	_In_	VGA_FINGERPRINT	nFingerprint
+);
+
+/**
+ * Frees a list of fingerprinted files.
+ *
+ * @param[in,out]	ptFiles	The list.
+ */
+STATIC
+VOID
+main_FreeDedupFiles(
+	_Inout_	PDEDUP_FILES	ptFiles
+);
+
+/**
+ * Fingerprints all the files in a directory.
+ * Files that can't be fingerprinted are skipped.
+ *
+ * @param[in]		pwszDirectory	The directory.
+ * @param[in,out]	ptFiles			The list to append the files to.
+ *
+ * @returns HRESULT
+ */
+STATIC
+HRESULT
+main_CollectDedupFiles(
+	_In_	PCWSTR			pwszDirectory,
+	_Inout_	PDEDUP_FILES	ptFiles
+);
+
+/**
+ * Prints the groups of duplicate files.
+ *
+ * @param[in]	ptFiles		The files.
+ * @param[in]	pnGroups	The first file in the group of each file.
+ *
+ * @returns HRESULT
+ */
+STATIC
+HRESULT
+main_PrintDedupGroups(
+	_In_						PCDEDUP_FILES	ptFiles,
+	_In_reads_(ptFiles->nFiles)	CONST DWORD *	pnGroups
+);
+
+/**
+ * Handler for the "dedup" subfunction.
+ * Groups the dumps and BMPs in a directory
+ * by the similarity of their screens.
+ *
+ * @param[in]	nArguments		Number of command line arguments.
+ * @param[in]	ppwszArguments	The command line arguments.
+ *
+ * @returns HRESULT
+ *
+ * @see SUBFUNCTION_DEDUP_ARGS
+ */
+STATIC
+HRESULT
+main_HandleDedup(
+	_In_					INT				nArguments,
+	_In_reads_(nArguments)	CONST PCWSTR *	ppwszArguments
+);
+
+/**
+ * Parses a decimal number from the command line.
+ *
+ * @param[in]	pwszValue	The number.
+ * @param[out]	pnValue		Will receive the number.
+ *
+ * @returns HRESULT
+ */
+STATIC
+HRESULT
+main_ParseNumber(
+	_In_	PCWSTR	pwszValue,
+	_Out_	PDWORD	pnValue
+);
+
+/**
+ * Handler for the "diff" subfunction.
+ * Finds the pixels that differ between the screens saved
+ * to two memory dumps, prints the regions they form,
+ * and optionally writes the second screen with the changes
+ * highlighted to a BMP file.
+ *
+ * @param[in]	nArguments		Number of command line arguments.
+ * @param[in]	ppwszArguments	The command line arguments.
+ *
+ * @returns HRESULT
+ *
+ * @see SUBFUNCTION_DIFF_ARGS
+ */
+STATIC
+HRESULT
+main_HandleDiff(
+	_In_					INT				nArguments,
+	_In_reads_(nArguments)	CONST PCWSTR *	ppwszArguments
+);
+
+/**
+ * Finds the part of a screen that changed since the previous one:
+ * the bounding rectangle of all the pixels VGADIFF_Compare finds.
+ * A change of mode or of colors changes the whole screen.
+ *
+ * @param[in]	ptPrevious	The previous screen, if there is one.
+ *							Must be the same size.
+ * @param[in]	ptCurrent	The screen.
+ * @param[out]	ptChanged	Will receive the rectangle. The right
+ *							and bottom edges are exclusive. If nothing
+ *							changed, it is the top-left pixel.
+ *
+ * @returns HRESULT
+ */
+STATIC
+HRESULT
+main_GetChangedRect(
+	_In_opt_	PCVGA_CAPTURE_VIEW	ptPrevious,
+	_In_		PCVGA_CAPTURE_VIEW	ptCurrent,
+	_Out_		PRECT				ptChanged
+);
+
+/**
+ * Writes a frame of an animation, decoding only
+ * the rows of the screen the frame covers.
+ *
+ * @param[in]	hGif		The animation.
+ * @param[in]	ptCapture	The screen.
+ * @param[in]	ptFrame		The part of the screen to write.
+ * @param[in]	nDelay		How long to show the frame,
+ *							in hundredths of a second.
+ *
+ * @returns HRESULT
+ */
+STATIC
+HRESULT
+main_WriteAnimationFrame(
+	_In_	HVGAGIF				hGif,
+	_In_	PCVGA_CAPTURE_VIEW	ptCapture,
+	_In_	CONST RECT *		ptFrame,
+	_In_	WORD				nDelay
+);
+
+/**
+ * Handler for the "animate" subfunction.
+ * Writes the screens saved to several memory dumps
+ * to an animated GIF, one frame per dump. Each frame
+ * only holds the part of the screen that changed.
+ *
+ * @param[in]	nArguments		Number of command line arguments.
+ * @param[in]	ppwszArguments	The command line arguments.
+ *
+ * @returns HRESULT
+ *
+ * @see SUBFUNCTION_ANIMATE_ARGS
+ */
+STATIC
+HRESULT
+main_HandleAnimate(
+	_In_					INT				nArguments,
+	_In_reads_(nArguments)	CONST PCWSTR *	ppwszArguments
+);
+
+/**
+ * Draws a screen into its tile of a mosaic.
+ * Screens smaller than the tiles are drawn at their top-left.
+ *
+ * @param[in]	ptJobs		The mosaic.
+ * @param[in]	nInput		The screen's position among the dumps.
+ * @param[in]	ptCapture	The screen.
+ *
+ * @returns HRESULT
+ */
+STATIC
+HRESULT
+main_DrawMosaicTile(
+	_In_	PMOSAIC_JOBS		ptJobs,
+	_In_	DWORD				nInput,
+	_In_	PCVGA_CAPTURE_VIEW	ptCapture
+);
+
+/**
+ * Reads a dump of the "mosaic" subfunction,
+ * and draws its screen into its tile.
+ * A screen that can't be drawn leaves its tile black.
+ *
+ * @param[in]	ptJobs		The mosaic.
+ *							Counts the screen if it can't be drawn.
+ * @param[in]	nInput		The dump's position among the dumps.
+ */
+STATIC
+VOID
+main_RunMosaicJob(
+	_Inout_	PMOSAIC_JOBS	ptJobs,
+	_In_	DWORD			nInput
+);
+
+/**
+ * Thread pool callback that draws the next screen
+ * of the "mosaic" subfunction. Submitted once per screen.
+ *
+ * @param[in]	ptInstance	The callback instance.
+ * @param[in]	pvContext	The mosaic (PMOSAIC_JOBS).
+ * @param[in]	ptWork		The work object.
+ */
+STATIC
+VOID
+CALLBACK
+main_MosaicWorkCallback(
+	_Inout_		PTP_CALLBACK_INSTANCE	ptInstance,
+	_Inout_opt_	PVOID					pvContext,
+	_Inout_		PTP_WORK				ptWork
+);
+
+/**
+ * Handler for the "mosaic" subfunction.
+ * Tiles the screens saved to many memory dumps in a grid,
+ * scaled down, and writes them as a single true color BMP.
+ * Only the mosaic and a dump per thread are in memory at once.
+ *
+ * @param[in]	nArguments		Number of command line arguments.
+ * @param[in]	ppwszArguments	The command line arguments.
+ *
+ * @returns HRESULT
+ *
+ * @see SUBFUNCTION_MOSAIC_ARGS
+ */
+STATIC
+HRESULT
+main_HandleMosaic(
+	_In_					INT				nArguments,
+	_In_reads_(nArguments)	CONST PCWSTR *	ppwszArguments
+);
+
+/**
+ * Handler for the "tags" subfunction.
+ * Lists the tagged data that bugcheck callbacks saved to a memory dump,
+ * with where each record's data is and how big it is.
+ *
+ * @param[in]	nArguments		Number of command line arguments.
+ * @param[in]	ppwszArguments	The command line arguments.
+ *
+ * @returns HRESULT
+ *
+ * @see SUBFUNCTION_TAGS_ARGS
+ */
+STATIC
+HRESULT
+main_HandleTags(
+	_In_					INT				nArguments,
+	_In_reads_(nArguments)	CONST PCWSTR *	ppwszArguments
+);
+
+/**
+ * Handler for the "synth" subfunction.
+ * Generates a synthetic screen and writes it
+ * as a capture file, for testing and benchmarking.
+ *
+ * @param[in]	nArguments		Number of command line arguments.
+ * @param[in]	ppwszArguments	The command line arguments.
+ *
+ * @returns HRESULT
+ *
+ * @see SUBFUNCTION_SYNTH_ARGS
+ */
+STATIC
+HRESULT
+main_HandleSynth(
+	_In_					INT				nArguments,
+	_In_reads_(nArguments)	CONST PCWSTR *	ppwszArguments
+);
+
+/**
+ * Finds the bounding box of the pixels that differ
+ * from the top-left one, a pixel at a time.
+ *
+ * @param[in]	pnPixels	The indexed pixels, with no padding between rows.
+ * @param[in]	nWidth		Width of the image, in pixels.
+ * @param[in]	nHeight		Height of the image, in pixels.
+ * @param[out]	ptContent	Will receive the bounding box.
+ *
+ * @see VGADECODE_DecodeImage
+ */
+STATIC
+VOID
+main_FindContent(
+	_In_reads_(nWidth * nHeight)	CONST BYTE *	pnPixels,
+	_In_							DWORD			nWidth,
+	_In_							DWORD			nHeight,
+	_Out_							PRECT			ptContent
+);
+
+/**
+ * Generates a synthetic screen, encodes it as a capture,
+ * and checks that the per-pixel reference decodes it back
+ * to the same pixels, and that the selected decoder
+ * matches the reference in every output.
+ *
+ * @param[in]	eKind		The kind of screen.
+ * @param[in]	nSeed		Seeds the screen's random choices.
+ * @param[in]	nWidth		Width of the screen, in pixels.
+ * @param[in]	nHeight		Height of the screen, in pixels.
+ * @param[in]	bLegacy		Whether to encode a legacy VGA_DUMP.
+ * @param[out]	pnCycles	Will receive the number of cycles
+ *							decoding the indexed pixels took.
+ *
+ * @returns HRESULT
+ *
+ * @see VGADECODE_SelectBackend
+ */
+STATIC
+HRESULT
+main_CheckRoundTrip(
+	_In_	VGA_SYNTH_KIND	eKind,
+	_In_	DWORD			nSeed,
+	_In_	DWORD			nWidth,
+	_In_	DWORD			nHeight,
+	_In_	BOOL			bLegacy,
+	_Out_	PDWORD64		pnCycles
+);
+
+/**
+ * Generates a synthetic screen and a copy of it with
+ * patches of noise pasted over it, and checks that diffing
+ * their planes finds exactly the pixels that decoding
+ * and comparing them does.
+ *
+ * @param[in]	eKind				The kind of screen.
+ * @param[in]	nSeed				Seeds the screen and the patches.
+ * @param[in]	nWidth				Width of the screen, in pixels.
+ * @param[in]	nHeight				Height of the screen, in pixels.
+ * @param[out]	pnDiffCycles		Will receive the time diffing took.
+ * @param[out]	pnDecodeCycles		Will receive the time decoding
+ *									and comparing took.
+ *
+ * @returns HRESULT
+ */
+STATIC
+HRESULT
+main_CheckDiff(
+	_In_	VGA_SYNTH_KIND	eKind,
+	_In_	DWORD			nSeed,
+	_In_	DWORD			nWidth,
+	_In_	DWORD			nHeight,
+	_Out_	PDWORD64		pnDiffCycles,
+	_Out_	PDWORD64		pnDecodeCycles
+);
+
+/**
+ * Generates a synthetic screen, run-length encodes it,
+ * and checks that it expands back to the same pixels.
+ *
+ * @param[in]	eKind			The kind of screen.
+ * @param[in]	nSeed			Seeds the screen's random choices.
+ * @param[in]	nWidth			Width of the screen, in pixels.
+ * @param[in]	nHeight			Height of the screen, in pixels.
+ * @param[in]	nBitsPerPixel	4 for BI_RLE4, 8 for BI_RLE8.
+ * @param[out]	pcbCompressed	Will receive the size of the encoded pixels.
+ * @param[out]	pnCycles		Will receive the number of cycles
+ *								encoding took.
+ *
+ * @returns HRESULT
+ */
+STATIC
+HRESULT
+main_CheckRle(
+	_In_	VGA_SYNTH_KIND	eKind,
+	_In_	DWORD			nSeed,
+	_In_	DWORD			nWidth,
+	_In_	DWORD			nHeight,
+	_In_	WORD			nBitsPerPixel,
+	_Out_	PDWORD			pcbCompressed,
+	_Out_	PDWORD64		pnCycles
+);
+
+/**
+ * Opens a dump file with the given reader,
+ * and checks that it reads the expected capture from it.
+ *
+ * @param[in]	pwszPath	Path to the dump file.
+ * @param[in]	eReader		How to read the dump file.
+ * @param[in]	pvExpected	The capture the dump holds.
+ * @param[in]	cbExpected	Size of the capture, in bytes.
+ * @param[out]	pnCycles	Will receive the number of cycles
+ *							opening the dump and reading the capture took.
+ * @param[out]	pcbRead		Will receive how much of the dump was read,
+ *							in bytes.
+ *
+ * @returns HRESULT
+ */
+STATIC
+HRESULT
+main_TimeDumpRead(
+	_In_							PCWSTR				pwszPath,
+	_In_							DUMPPARSE_READER	eReader,
+	_In_reads_bytes_(cbExpected)	PVOID				pvExpected,
+	_In_							DWORD				cbExpected,
+	_Out_							PDWORD64			pnCycles,
+	_Out_							PULONGLONG			pcbRead
+);
+
+/**
+ * Checks that listing the tagged data in a synthetic dump file
+ * finds the capture once, among the records around it.
+ *
+ * @param[in]	pwszPath	Path to the dump file.
+ * @param[in]	cbExpected	Size of the capture, in bytes.
+ *
+ * @returns HRESULT
+ */
+STATIC
+HRESULT
+main_CheckDumpTags(
+	_In_	PCWSTR	pwszPath,
+	_In_	DWORD	cbExpected
+);
+
+/**
+ * Writes a synthetic screen into a synthetic dump file,
+ * and checks that the native reader reads it back and lists it,
+ * and that the indexed reader reads it back through its index.
+ * Times the debugger engine reading it too, for comparison.
+ *
+ * @param[in]	eLayout				The layout of the dump.
+ * @param[in]	nSeed				Seeds the screen's random choices.
+ * @param[out]	pnNativeCycles		Will receive the number of cycles
+ *									the native reader took.
+ * @param[out]	pnDebuggerCycles	Will receive the number of cycles
+ *									the debugger engine took,
+ *									or 0 if it couldn't read the dump.
+ * @param[out]	pcbRead				Will receive how much of the dump
+ *									the native reader read, in bytes.
+ * @param[out]	pcbDump				Will receive the dump's size, in bytes.
+ * @param[out]	pnIndexedCycles		Will receive the number of cycles
+ *									the indexed reader took,
+ *									once the dump was indexed.
+ * @param[out]	pcbIndexedRead		Will receive how much of the dump
+ *									the indexed reader read then, in bytes.
+ *
+ * @returns HRESULT
+ */
+STATIC
+HRESULT
+main_CheckDumpParse(
+	_In_	DUMP_SYNTH_LAYOUT	eLayout,
+	_In_	DWORD				nSeed,
+	_Out_	PDWORD64			pnNativeCycles,
+	_Out_	PDWORD64			pnDebuggerCycles,
+	_Out_	PULONGLONG			pcbRead,
+	_Out_	PDWORD				pcbDump,
+	_Out_	PDWORD64			pnIndexedCycles,
+	_Out_	PULONGLONG			pcbIndexedRead
+);
+
+/**
+ * Handler for the "selftest" subfunction.
+ * Round-trips synthetic screens of every kind and of various
+ * geometries through the encoder and the decoders,
+ * and reports how long decoding and diffing them took.
+ *
+ * @param[in]	nArguments		Number of command line arguments.
+ * @param[in]	ppwszArguments	The command line arguments.
+ *
+ * @returns HRESULT
+ *
+ * @see SUBFUNCTION_SELFTEST_ARGS
+ */
+STATIC
+HRESULT
+main_HandleSelftest(
+	_In_					INT				nArguments,
+	_In_reads_(nArguments)	CONST PCWSTR *	ppwszArguments
+);
+
+/**
+ * Times decoding a synthetic screen to true color with the selected
+ * decoder, both straight from the planes and the way it used to be
+ * done: decoding to indexed pixels, then looking up their colors
+ * in a second pass. Both must give the same pixels.
+ *
+ * @param[in]	eKind				The kind of screen.
+ * @param[in]	nSeed				Seeds the screen's random choices.
+ * @param[in]	nWidth				Width of the screen, in pixels.
+ * @param[in]	nHeight				Height of the screen, in pixels.
+ * @param[in]	nRepetitions		How many times to decode it each way.
+ * @param[out]	pnFusedCycles		Will receive the fewest cycles decoding
+ *									straight to true color took.
+ * @param[out]	pnTwoStepCycles		Will receive the fewest cycles decoding
+ *									and then looking up the colors took.
+ *
+ * @returns HRESULT
+ *
+ * @see VGADECODE_SelectBackend
+ */
+STATIC
+HRESULT
+main_BenchColorDecode(
+	_In_	VGA_SYNTH_KIND	eKind,
+	_In_	DWORD			nSeed,
+	_In_	DWORD			nWidth,
+	_In_	DWORD			nHeight,
+	_In_	DWORD			nRepetitions,
+	_Out_	PDWORD64		pnFusedCycles,
+	_Out_	PDWORD64		pnTwoStepCycles
+);
+
+/**
+ * Times grouping a corpus of fingerprints, and checks that
+ * the copies mixed into it all ended up in one group.
+ *
+ * @param[in]	ptCorpus		The corpus.
+ * @param[in]	nRepetitions	How many times to group it.
+ * @param[out]	pnCycles		Will receive the fewest cycles
+ *								grouping it took.
+ *
+ * @returns HRESULT
+ */
+STATIC
+HRESULT
+main_BenchGroup(
+	_In_	PCBENCH_GROUP_CORPUS	ptCorpus,
+	_In_	DWORD					nRepetitions,
+	_Out_	PDWORD64				pnCycles
+);
+
+/**
+ * Handler for the "bench" subfunction.
+ * Compares decoding synthetic screens straight to true color
+ * with decoding them to indexed pixels and then applying
+ * the palette, in cycles per pixel, with every decoder
+ * the CPU can run. Then times grouping fingerprints,
+ * with many copies of one of them and without.
+ *
+ * @param[in]	nArguments		Number of command line arguments.
+ * @param[in]	ppwszArguments	The command line arguments.
+ *
+ * @returns HRESULT
+ *
+ * @see SUBFUNCTION_BENCH_ARGS
+ */
+STATIC
+HRESULT
+main_HandleBench(
 	_In_					INT				nArguments,
 	_In_reads_(nArguments)	CONST PCWSTR *	ppwszArguments
 );
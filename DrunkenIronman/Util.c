@@ -362,6 +362,146 @@ lblCleanup:
 	return hrResult;
 }
 
+HRESULT
+UTIL_ReadFile(
+	_In_									PCWSTR	pwszPath,
+	_Outptr_result_bytebuffer_(*pcbData)	PVOID *	ppvData,
+	_Out_									PDWORD	pcbData
+)
+{
+	HRESULT			hrResult	= E_FAIL;
+	HANDLE			hFile		= INVALID_HANDLE_VALUE;
+	LARGE_INTEGER	tFileSize	= { 0 };
+	DWORD			cbData		= 0;
+	PVOID			pvData		= NULL;
+	DWORD			cbRead		= 0;
+
+	if ((NULL == pwszPath) ||
+		(NULL == ppvData) ||
+		(NULL == pcbData))
+	{
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+
+	hFile = CreateFileW(pwszPath,
+						GENERIC_READ,
+						FILE_SHARE_READ,
+						NULL,
+						OPEN_EXISTING,
+						FILE_ATTRIBUTE_NORMAL,
+						NULL);
+	if (INVALID_HANDLE_VALUE == hFile)
+	{
+		hrResult = HRESULT_FROM_WIN32(GetLastError());
+		goto lblCleanup;
+	}
+
+	if (!GetFileSizeEx(hFile, &tFileSize))
+	{
+		hrResult = HRESULT_FROM_WIN32(GetLastError());
+		goto lblCleanup;
+	}
+
+	// Safely cast to DWORD.
+	hrResult = LongLongToDWord(tFileSize.QuadPart, &cbData);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	// Allocate at least a byte, so that empty files
+	// don't look like allocation failures.
+	pvData = HEAPALLOC(max(cbData, 1));
+	if (NULL == pvData)
+	{
+		hrResult = E_OUTOFMEMORY;
+		goto lblCleanup;
+	}
+
+	if (!ReadFile(hFile,
+				  pvData,
+				  cbData,
+				  &cbRead,
+				  NULL))
+	{
+		hrResult = HRESULT_FROM_WIN32(GetLastError());
+		goto lblCleanup;
+	}
+	if (cbData != cbRead)
+	{
+		hrResult = E_UNEXPECTED;
+		goto lblCleanup;
+	}
+
+	// Transfer ownership:
+	*ppvData = pvData;
+	pvData = NULL;
+	*pcbData = cbData;
+
+	hrResult = S_OK;
+
+lblCleanup:
+	HEAPFREE(pvData);
+	CLOSE_FILE_HANDLE(hFile);
+
+	return hrResult;
+}
+
+HRESULT
+UTIL_WriteFile(
+	_In_						PCWSTR	pwszPath,
+	_In_reads_bytes_(cbData)	LPCVOID	pvData,
+	_In_						DWORD	cbData
+)
+{
+	HRESULT	hrResult	= E_FAIL;
+	HANDLE	hFile		= INVALID_HANDLE_VALUE;
+	DWORD	cbWritten	= 0;
+
+	if ((NULL == pwszPath) ||
+		(NULL == pvData))
+	{
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+
+	hFile = CreateFileW(pwszPath,
+						GENERIC_WRITE,
+						0,
+						NULL,
+						CREATE_ALWAYS,
+						FILE_ATTRIBUTE_NORMAL,
+						NULL);
+	if (INVALID_HANDLE_VALUE == hFile)
+	{
+		hrResult = HRESULT_FROM_WIN32(GetLastError());
+		goto lblCleanup;
+	}
+
+	if (!WriteFile(hFile,
+				   pvData,
+				   cbData,
+				   &cbWritten,
+				   NULL))
+	{
+		hrResult = HRESULT_FROM_WIN32(GetLastError());
+		goto lblCleanup;
+	}
+	if (cbData != cbWritten)
+	{
+		hrResult = E_UNEXPECTED;
+		goto lblCleanup;
+	}
+
+	hrResult = S_OK;
+
+lblCleanup:
+	CLOSE_FILE_HANDLE(hFile);
+
+	return hrResult;
+}
+
 HRESULT
 UTIL_DuplicateStringUnicodeToAnsi(
 	_In_		PCWSTR	pwszSource,
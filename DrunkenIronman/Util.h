@@ -157,6 +157,41 @@ UTIL_WriteToTemporaryFile(
 	_Outptr_					PWSTR *	ppwzTempPath
 );
 
+/**
+ * Reads an entire file into memory.
+ *
+ * @param[in]	pwszPath	Path of the file to read.
+ * @param[out]	ppvData		Will receive the file's contents.
+ * @param[out]	pcbData		Will receive the size of the file.
+ *
+ * @returns HRESULT
+ *
+ * @remark Free the returned data to the process heap.
+ */
+HRESULT
+UTIL_ReadFile(
+	_In_									PCWSTR	pwszPath,
+	_Outptr_result_bytebuffer_(*pcbData)	PVOID *	ppvData,
+	_Out_									PDWORD	pcbData
+);
+
+/**
+ * Writes a buffer into a file, replacing the file
+ * if it already exists.
+ *
+ * @param[in]	pwszPath	Path of the file to write.
+ * @param[in]	pvData		The data to write.
+ * @param[in]	cbData		Size of the data, in bytes.
+ *
+ * @returns HRESULT
+ */
+HRESULT
+UTIL_WriteFile(
+	_In_						PCWSTR	pwszPath,
+	_In_reads_bytes_(cbData)	LPCVOID	pvData,
+	_In_						DWORD	cbData
+);
+
 /**
  * Converts a Unicode string to an ANSI string.
  *
@@ -0,0 +1,442 @@
+/**
+ * @file VgaCapture.c
+ * @author biko
+ * @date 2026-10-17
+ *
+ * VgaCapture module implementation.
+ */
+
+/** Headers *************************************************************/
+#include <Windows.h>
+#include <intsafe.h>
+
+#include <assert.h>
+
+#include <Drink.h>
+
+#include "Debug.h"
+
+#include "VgaCapture.h"
+
+
+/** Functions ***********************************************************/
+
+/**
+ * Sets up a capture's view to display each pixel value
+ * with the DAC entry of the same index, as Windows
+ * programs the Attribute Controller.
+ *
+ * @param[out]	ptView	The capture's view.
+ */
+STATIC
+VOID
+vgacapture_SetIdentityColors(
+	_Inout_	PVGA_CAPTURE_VIEW	ptView
+)
+{
+	DWORD	nColor	= 0;
+
+	for (nColor = 0; nColor < VGA_COLORS; ++nColor)
+	{
+		ptView->anColorIndices[nColor] = (BYTE)nColor;
+	}
+}
+
+/**
+ * Translates each pixel value to a DAC entry the way
+ * the Attribute Controller does.
+ *
+ * @param[in]	ptHeader	The capture's header.
+ * @param[out]	ptView		The capture's view.
+ *
+ * @returns HRESULT
+ */
+STATIC
+HRESULT
+vgacapture_GetColorIndices(
+	_In_	PCVGA_CAPTURE_HEADER	ptHeader,
+	_Inout_	PVGA_CAPTURE_VIEW		ptView
+)
+{
+	HRESULT	hrResult	= E_FAIL;
+	DWORD	nColor		= 0;
+	BYTE	nIndex		= 0;
+
+	C_ASSERT(VGA_COLORS == VGA_ATTRIBUTE_PALETTE_ENTRIES);
+
+	for (nColor = 0; nColor < VGA_COLORS; ++nColor)
+	{
+		// Bits 4-5 of the DAC index come either from the palette
+		// or from the Color Select register, and bits 6-7
+		// always come from the Color Select register.
+		if (0 != (ptHeader->fAttributeMode & VGA_ATTRIBUTE_MODE_P54S))
+		{
+			nIndex = (ptHeader->anAttributePalette[nColor] & 0x0F) |
+					 ((ptHeader->fColorSelect & 0x03) << 4);
+		}
+		else
+		{
+			nIndex = ptHeader->anAttributePalette[nColor] & 0x3F;
+		}
+		nIndex |= (ptHeader->fColorSelect & 0x0C) << 4;
+
+		if (nIndex >= ptHeader->nPaletteEntries)
+		{
+			PROGRESS("Color %lu is outside the palette.", nColor);
+			hrResult = HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+			goto lblCleanup;
+		}
+
+		ptView->anColorIndices[nColor] = nIndex;
+	}
+
+	hrResult = S_OK;
+
+lblCleanup:
+	return hrResult;
+}
+
+/**
+ * Describes the contents of a graphics mode capture.
+ *
+ * @param[in]	ptHeader		The capture's header.
+ * @param[in]	pnContents		The planes.
+ * @param[in]	cbAvailable		Number of bytes available at pnContents.
+ * @param[out]	ptView			The capture's view.
+ * @param[out]	pcbContents		Will receive the size of the planes, in bytes.
+ *
+ * @returns HRESULT
+ */
+STATIC
+HRESULT
+vgacapture_ParseGraphics(
+	_In_							PCVGA_CAPTURE_HEADER	ptHeader,
+	_In_reads_bytes_(cbAvailable)	CONST BYTE *			pnContents,
+	_In_							DWORD					cbAvailable,
+	_Inout_							PVGA_CAPTURE_VIEW		ptView,
+	_Out_							PDWORD					pcbContents
+)
+{
+	HRESULT	hrResult	= E_FAIL;
+	DWORD	cbPlane		= 0;
+	DWORD	nPlane		= 0;
+
+	// Only 16-color planar captures are supported.
+	if (VGA_PLANES != ptHeader->nPlanes)
+	{
+		PROGRESS("Unsupported capture format (%lu planes).", ptHeader->nPlanes);
+		hrResult = HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+		goto lblCleanup;
+	}
+
+	// The stride is bounded by what the CRTC can address,
+	// and each plane by the window it is read through.
+	// The size of a plane is multiplied with overflow checks,
+	// since the header comes straight from the file.
+	if ((0 == ptHeader->nWidth) ||
+		(0 == ptHeader->nHeight) ||
+		(0 == ptHeader->cbStride) ||
+		(VGA_GRAPHICS_MAX_STRIDE < ptHeader->cbStride) ||
+		(VGA_PLANE_MAX_BYTES < ptHeader->nHeight) ||
+		((ptHeader->cbStride * PIXELS_IN_BYTE) < ptHeader->nWidth) ||
+		FAILED(DWordMult(ptHeader->cbStride, ptHeader->nHeight, &cbPlane)) ||
+		(VGA_PLANE_MAX_BYTES < cbPlane))
+	{
+		PROGRESS("The capture has a weird geometry (%lux%lu, %lu bytes per row).",
+				 ptHeader->nWidth,
+				 ptHeader->nHeight,
+				 ptHeader->cbStride);
+		hrResult = HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+		goto lblCleanup;
+	}
+
+	if (cbAvailable < VGA_PLANES * cbPlane)
+	{
+		PROGRESS("The capture is truncated.");
+		hrResult = HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+		goto lblCleanup;
+	}
+
+	ptView->nWidth = ptHeader->nWidth;
+	ptView->nHeight = ptHeader->nHeight;
+	ptView->cbStride = ptHeader->cbStride;
+	for (nPlane = 0; nPlane < VGA_PLANES; ++nPlane)
+	{
+		ptView->apnPlanes[nPlane] = pnContents + (nPlane * cbPlane);
+	}
+	*pcbContents = VGA_PLANES * cbPlane;
+
+	hrResult = S_OK;
+
+lblCleanup:
+	return hrResult;
+}
+
+/**
+ * Describes the contents of a text mode capture.
+ *
+ * @param[in]	ptHeader		The capture's header.
+ * @param[in]	pnContents		The text, followed by the font.
+ * @param[in]	cbAvailable		Number of bytes available at pnContents.
+ * @param[out]	ptView			The capture's view.
+ * @param[out]	pcbContents		Will receive the size of the text
+ *								and the font, in bytes.
+ *
+ * @returns HRESULT
+ */
+STATIC
+HRESULT
+vgacapture_ParseText(
+	_In_							PCVGA_CAPTURE_HEADER	ptHeader,
+	_In_reads_bytes_(cbAvailable)	CONST BYTE *			pnContents,
+	_In_							DWORD					cbAvailable,
+	_Inout_							PVGA_CAPTURE_VIEW		ptView,
+	_Out_							PDWORD					pcbContents
+)
+{
+	HRESULT	hrResult	= E_FAIL;
+	DWORD	cbText		= 0;
+	DWORD	cbFont		= 0;
+
+	// Rows must be stored without padding. The geometry is bounded
+	// by the largest text modes, and the size of the text is
+	// multiplied with overflow checks, as with graphics.
+	if ((0 == ptHeader->nWidth) ||
+		(0 == ptHeader->nHeight) ||
+		(0 == ptHeader->nCharHeight) ||
+		(VGA_FONT_GLYPH_MAX_HEIGHT < ptHeader->nCharHeight) ||
+		(VGA_TEXT_MAX_COLUMNS < ptHeader->nWidth) ||
+		(VGA_TEXT_MAX_ROWS < ptHeader->nHeight) ||
+		((ptHeader->nWidth * VGA_TEXT_CELL_BYTES) != ptHeader->cbStride) ||
+		FAILED(DWordMult(ptHeader->cbStride, ptHeader->nHeight, &cbText)) ||
+		(VGA_PLANE_MAX_BYTES < cbText))
+	{
+		PROGRESS("The capture has a weird geometry (%lux%lu characters, %lu scan lines each).",
+				 ptHeader->nWidth,
+				 ptHeader->nHeight,
+				 ptHeader->nCharHeight);
+		hrResult = HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+		goto lblCleanup;
+	}
+
+	cbFont = VGA_FONT_GLYPHS * ptHeader->nCharHeight;
+	if (cbAvailable < cbText + cbFont)
+	{
+		PROGRESS("The capture is truncated.");
+		hrResult = HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+		goto lblCleanup;
+	}
+
+	ptView->nWidth = ptHeader->nWidth * PIXELS_IN_BYTE;
+	ptView->nHeight = ptHeader->nHeight * ptHeader->nCharHeight;
+	ptView->tText.pnText = pnContents;
+	ptView->tText.nColumns = ptHeader->nWidth;
+	ptView->tText.nRows = ptHeader->nHeight;
+	ptView->tText.pnFont = pnContents + cbText;
+	ptView->tText.nCharHeight = ptHeader->nCharHeight;
+	ptView->tText.bBlinkEnabled = (0 != (ptHeader->fAttributeMode & VGA_ATTRIBUTE_MODE_BLINK));
+	*pcbContents = cbText + cbFont;
+
+	hrResult = S_OK;
+
+lblCleanup:
+	return hrResult;
+}
+
+/**
+ * Describes a legacy capture, which is a bare VGA_DUMP.
+ *
+ * @param[in]	ptDump	The capture.
+ * @param[out]	ptView	Will receive the capture's description.
+ */
+STATIC
+VOID
+vgacapture_ParseLegacy(
+	_In_	PCVGA_DUMP			ptDump,
+	_Out_	PVGA_CAPTURE_VIEW	ptView
+)
+{
+	VGA_CAPTURE_VIEW	tView	= { 0 };
+	DWORD				nPlane	= 0;
+
+	tView.nVersion = 0;
+	tView.eMode = VGA_CAPTURE_MODE_GRAPHICS;
+	tView.nWidth = SCREEN_WIDTH_PIXELS;
+	tView.nHeight = SCREEN_HEIGHT_PIXELS;
+	tView.nPaletteEntries = ARRAYSIZE(ptDump->atPaletteEntries);
+	tView.ptPaletteEntries = ptDump->atPaletteEntries;
+	vgacapture_SetIdentityColors(&tView);
+
+	tView.cbStride = SCREEN_WIDTH_PIXELS / PIXELS_IN_BYTE;
+	for (nPlane = 0; nPlane < VGA_PLANES; ++nPlane)
+	{
+		tView.apnPlanes[nPlane] = ptDump->atPlanes[nPlane];
+	}
+
+	*ptView = tView;
+}
+
+DWORD
+VGACAPTURE_Checksum(
+	_In_reads_bytes_(cbData)	LPCVOID	pvData,
+	_In_						DWORD	cbData
+)
+{
+	CONST BYTE *	pnData		= (CONST BYTE *)pvData;
+	DWORD			nChecksum	= VGA_CAPTURE_CHECKSUM_BASIS;
+	DWORD			nIndex		= 0;
+
+	for (nIndex = 0; nIndex < cbData; ++nIndex)
+	{
+		nChecksum = VGA_CAPTURE_CHECKSUM_STEP(nChecksum, pnData[nIndex]);
+	}
+
+	return nChecksum;
+}
+
+HRESULT
+VGACAPTURE_Parse(
+	_In_reads_bytes_(cbCapture)	LPCVOID				pvCapture,
+	_In_						DWORD				cbCapture,
+	_Out_						PVGA_CAPTURE_VIEW	ptView
+)
+{
+	HRESULT					hrResult	= E_FAIL;
+	PCVGA_CAPTURE_HEADER	ptHeader	= (PCVGA_CAPTURE_HEADER)pvCapture;
+	VGA_CAPTURE_HEADER		tHeader		= { 0 };
+	CONST BYTE *			pnPayload	= NULL;
+	DWORD					cbPayload	= 0;
+	DWORD					cbPalette	= 0;
+	DWORD					cbContents	= 0;
+	VGA_CAPTURE_VIEW		tView		= { 0 };
+
+	assert(NULL != pvCapture);
+	assert(NULL != ptView);
+
+	// Captures from before the header was introduced
+	// are identified by their size. They begin with 6-bit DAC
+	// values, so they can't be mistaken for the magic.
+	if ((sizeof(VGA_DUMP) == cbCapture) &&
+		(VGA_CAPTURE_MAGIC != ptHeader->nMagic))
+	{
+		PROGRESS("Legacy capture.");
+		vgacapture_ParseLegacy((PCVGA_DUMP)pvCapture, ptView);
+		hrResult = S_OK;
+		goto lblCleanup;
+	}
+
+	if ((VGA_CAPTURE_HEADER_V1_SIZE > cbCapture) ||
+		(VGA_CAPTURE_MAGIC != ptHeader->nMagic))
+	{
+		PROGRESS("Not a VGA capture.");
+		hrResult = HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+		goto lblCleanup;
+	}
+	if ((0 == ptHeader->nVersion) ||
+		(VGA_CAPTURE_VERSION < ptHeader->nVersion))
+	{
+		PROGRESS("Unsupported capture version %lu.", ptHeader->nVersion);
+		hrResult = HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+		goto lblCleanup;
+	}
+	if ((VGA_CAPTURE_HEADER_V1_SIZE > ptHeader->cbHeader) ||
+		((1 < ptHeader->nVersion) && (sizeof(tHeader) > ptHeader->cbHeader)) ||
+		(cbCapture < ptHeader->cbHeader))
+	{
+		PROGRESS("The capture header has a weird size.");
+		hrResult = HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+		goto lblCleanup;
+	}
+
+	// Work on a copy, so that fields that are missing
+	// from older versions read as zeros.
+	CopyMemory(&tHeader, ptHeader, min(sizeof(tHeader), ptHeader->cbHeader));
+	pnPayload = (CONST BYTE *)pvCapture + tHeader.cbHeader;
+	cbPayload = cbCapture - tHeader.cbHeader;
+
+	if ((VGA_PLANES != tHeader.nBitsPerPixel) ||
+		(VGA_COLORS > tHeader.nPaletteEntries) ||
+		(VGA_DAC_PALETTE_ENTRIES < tHeader.nPaletteEntries))
+	{
+		PROGRESS("Unsupported capture format (%lu bits per pixel, %lu colors).",
+				 tHeader.nBitsPerPixel,
+				 tHeader.nPaletteEntries);
+		hrResult = HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+		goto lblCleanup;
+	}
+
+	cbPalette = tHeader.nPaletteEntries * sizeof(PALETTE_ENTRY);
+	if (cbPayload < cbPalette)
+	{
+		PROGRESS("The capture is truncated.");
+		hrResult = HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+		goto lblCleanup;
+	}
+
+	tView.nVersion = tHeader.nVersion;
+	tView.eMode = (VGA_CAPTURE_MODE)tHeader.eMode;
+	tView.nPaletteEntries = tHeader.nPaletteEntries;
+	tView.ptPaletteEntries = (PCPALETTE_ENTRY)pnPayload;
+
+	// The Attribute Controller's state was first saved in version 2.
+	if (1 == tHeader.nVersion)
+	{
+		vgacapture_SetIdentityColors(&tView);
+	}
+	else
+	{
+		hrResult = vgacapture_GetColorIndices(&tHeader, &tView);
+		if (FAILED(hrResult))
+		{
+			goto lblCleanup;
+		}
+	}
+
+	switch (tView.eMode)
+	{
+	case VGA_CAPTURE_MODE_GRAPHICS:
+		hrResult = vgacapture_ParseGraphics(&tHeader,
+											pnPayload + cbPalette,
+											cbPayload - cbPalette,
+											&tView,
+											&cbContents);
+		break;
+
+	case VGA_CAPTURE_MODE_TEXT:
+		hrResult = vgacapture_ParseText(&tHeader,
+										pnPayload + cbPalette,
+										cbPayload - cbPalette,
+										&tView,
+										&cbContents);
+		break;
+
+	default:
+		PROGRESS("Unsupported capture mode %lu.", tHeader.eMode);
+		hrResult = HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+		break;
+	}
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	if (VGACAPTURE_Checksum(pnPayload, cbPalette + cbContents) != tHeader.nChecksum)
+	{
+		PROGRESS("The capture is corrupt.");
+		hrResult = HRESULT_FROM_WIN32(ERROR_CRC);
+		goto lblCleanup;
+	}
+
+	PROGRESS("Capture version %lu, mode %lu, %lux%lu.",
+			 tView.nVersion,
+			 (DWORD)tView.eMode,
+			 tView.nWidth,
+			 tView.nHeight);
+
+	*ptView = tView;
+
+	hrResult = S_OK;
+
+lblCleanup:
+	return hrResult;
+}
@@ -0,0 +1,94 @@
+/**
+ * @file VgaCapture.h
+ * @author biko
+ * @date 2026-10-17
+ *
+ * VgaCapture module public header.
+ * Contains routines for interpreting the VGA captures
+ * saved to the dump file by the driver.
+ */
+#pragma once
+
+/** Headers *************************************************************/
+#include <Windows.h>
+
+#include <Drink.h>
+
+#include "VgaDecode.h"
+
+
+/** Typedefs ************************************************************/
+
+/**
+ * Describes a validated VGA capture.
+ * All pointers point into the capture's buffer.
+ */
+typedef struct _VGA_CAPTURE_VIEW
+{
+	// Version of the capture format,
+	// or 0 for a legacy VGA_DUMP.
+	DWORD				nVersion;
+
+	// What the screen was showing.
+	VGA_CAPTURE_MODE	eMode;
+
+	// Dimensions of the screen, in pixels.
+	DWORD				nWidth;
+	DWORD				nHeight;
+
+	// The DAC palette.
+	DWORD				nPaletteEntries;
+	PCPALETTE_ENTRY		ptPaletteEntries;
+
+	// The DAC entry each pixel value is displayed with.
+	BYTE				anColorIndices[VGA_COLORS];
+
+	// Graphics mode only:
+	// Distance between the starts of adjacent rows
+	// in each plane, in bytes, and the first row of each plane.
+	DWORD				cbStride;
+	CONST BYTE *		apnPlanes[VGA_PLANES];
+
+	// Text mode only:
+	VGA_TEXT_SCREEN		tText;
+} VGA_CAPTURE_VIEW, *PVGA_CAPTURE_VIEW;
+typedef CONST VGA_CAPTURE_VIEW *PCVGA_CAPTURE_VIEW;
+
+
+/** Functions ***********************************************************/
+
+/**
+ * Validates a VGA capture read from a dump file,
+ * and describes its contents.
+ * Both versioned captures and legacy VGA_DUMPs are accepted.
+ *
+ * @param[in]	pvCapture	The capture.
+ * @param[in]	cbCapture	Size of the capture, in bytes.
+ * @param[out]	ptView		Will receive the capture's description.
+ *
+ * @returns HRESULT
+ *
+ * @remark	The capture must outlive the view.
+ */
+HRESULT
+VGACAPTURE_Parse(
+	_In_reads_bytes_(cbCapture)	LPCVOID				pvCapture,
+	_In_						DWORD				cbCapture,
+	_Out_						PVGA_CAPTURE_VIEW	ptView
+);
+
+/**
+ * Calculates the checksum of a capture's payload.
+ *
+ * @param[in]	pvData	The payload.
+ * @param[in]	cbData	Size of the payload, in bytes.
+ *
+ * @returns DWORD
+ *
+ * @see VGA_CAPTURE_HEADER
+ */
+DWORD
+VGACAPTURE_Checksum(
+	_In_reads_bytes_(cbData)	LPCVOID	pvData,
+	_In_						DWORD	cbData
+);
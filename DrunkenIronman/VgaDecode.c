@@ -0,0 +1,2209 @@
+/**
+ * @file VgaDecode.c
+ * @author biko
+ * @date 2026-10-17
+ *
+ * VgaDecode module implementation.
+ */
+
+/** Headers *************************************************************/
+#include <Windows.h>
+#include <intrin.h>
+#include <emmintrin.h>
+#include <immintrin.h>
+
+#include <assert.h>
+
+#include <Drink.h>
+
+#include "VgaDecode.h"
+
+
+/** Constants ***********************************************************/
+
+/**
+ * Number of bytes consumed from each plane by a single
+ * iteration of the vectorized decoders (64 pixels).
+ */
+#define DECODE_GROUP_BYTES (8)
+
+/**
+ * CPUID.01H:ECX - the CPU supports SSSE3.
+ */
+#define CPUID_01_ECX_SSSE3 (1UL << 9)
+
+/**
+ * CPUID.01H:ECX - the OS uses XSAVE/XRSTOR to manage extended state.
+ */
+#define CPUID_01_ECX_OSXSAVE (1UL << 27)
+
+/**
+ * CPUID.01H:ECX - the CPU supports AVX.
+ */
+#define CPUID_01_ECX_AVX (1UL << 28)
+
+/**
+ * CPUID.(EAX=07H,ECX=0):EBX - the CPU supports AVX2.
+ */
+#define CPUID_07_EBX_AVX2 (1UL << 5)
+
+/**
+ * Index of the XFEATURE_ENABLED_MASK extended control register.
+ */
+#define XCR_XFEATURE_ENABLED_MASK (0)
+
+/**
+ * XCR0 bits indicating that the OS preserves both
+ * the XMM and the YMM registers.
+ */
+#define XCR0_SSE_AVX_STATE (0x6)
+
+/**
+ * Number of bytes in a single RGBQUAD.
+ */
+#define RGBQUAD_CHANNELS (sizeof(RGBQUAD))
+
+/**
+ * Returned by vgadecode_ClassifyGroup for groups
+ * that have to be decoded bit by bit.
+ */
+#define MIXED_GROUP (MAXDWORD)
+
+
+/** Macros **************************************************************/
+
+/**
+ * Spreads the 8 bits of a plane byte into 8 bytes, one per pixel.
+ * The MSB (the leftmost pixel) ends up in the lowest-addressed byte.
+ */
+#define SPREAD_BITS(nByte)								\
+	(((((ULONGLONG)(nByte)) >> 7) & 1)			|		\
+	 (((((ULONGLONG)(nByte)) >> 6) & 1) << 8)	|		\
+	 (((((ULONGLONG)(nByte)) >> 5) & 1) << 16)	|		\
+	 (((((ULONGLONG)(nByte)) >> 4) & 1) << 24)	|		\
+	 (((((ULONGLONG)(nByte)) >> 3) & 1) << 32)	|		\
+	 (((((ULONGLONG)(nByte)) >> 2) & 1) << 40)	|		\
+	 (((((ULONGLONG)(nByte)) >> 1) & 1) << 48)	|		\
+	 (((((ULONGLONG)(nByte)) >> 0) & 1) << 56))
+
+/**
+ * Spreads the 8 bits of a glyph's scan line into 8 bytes,
+ * 0xFF for each foreground pixel and 0 for each background pixel.
+ */
+#define GLYPH_ROW_MASK(nByte) (SPREAD_BITS(nByte) * 0xFF)
+
+/**
+ * Spreads the 8 bits of a plane byte into 8 nibbles, one per pixel,
+ * packed the way 4bpp BMPs pack them: the leftmost pixel is the high
+ * nibble of the lowest-addressed byte.
+ */
+#define SPREAD_NIBBLE_BITS(nByte)						\
+	((((((DWORD)(nByte)) >> 7) & 1) << 4)		|		\
+	 (((((DWORD)(nByte)) >> 6) & 1) << 0)		|		\
+	 (((((DWORD)(nByte)) >> 5) & 1) << 12)		|		\
+	 (((((DWORD)(nByte)) >> 4) & 1) << 8)		|		\
+	 (((((DWORD)(nByte)) >> 3) & 1) << 20)		|		\
+	 (((((DWORD)(nByte)) >> 2) & 1) << 16)		|		\
+	 (((((DWORD)(nByte)) >> 1) & 1) << 28)		|		\
+	 (((((DWORD)(nByte)) >> 0) & 1) << 24))
+
+/**
+ * Spreads the 8 bits of a glyph's scan line into 8 nibbles,
+ * 0xF for each foreground pixel and 0 for each background pixel.
+ */
+#define GLYPH_NIBBLE_MASK(nByte) (SPREAD_NIBBLE_BITS(nByte) * 0xF)
+
+/**
+ * Expands to consecutive entries of a lookup table,
+ * generated by the given macro.
+ */
+#define TABLE_ENTRIES_4(ENTRY, n)	\
+	ENTRY(n), ENTRY((n) + 1), ENTRY((n) + 2), ENTRY((n) + 3)
+#define TABLE_ENTRIES_16(ENTRY, n)	\
+	TABLE_ENTRIES_4(ENTRY, n), TABLE_ENTRIES_4(ENTRY, (n) + 4), TABLE_ENTRIES_4(ENTRY, (n) + 8), TABLE_ENTRIES_4(ENTRY, (n) + 12)
+#define TABLE_ENTRIES_64(ENTRY, n)	\
+	TABLE_ENTRIES_16(ENTRY, n), TABLE_ENTRIES_16(ENTRY, (n) + 16), TABLE_ENTRIES_16(ENTRY, (n) + 32), TABLE_ENTRIES_16(ENTRY, (n) + 48)
+#define TABLE_ENTRIES_256(ENTRY)	\
+	TABLE_ENTRIES_64(ENTRY, 0), TABLE_ENTRIES_64(ENTRY, 64), TABLE_ENTRIES_64(ENTRY, 128), TABLE_ENTRIES_64(ENTRY, 192)
+
+/**
+ * Repeats a pixel value in all 8 bytes.
+ */
+#define BROADCAST_PIXEL(nPixel) (((ULONGLONG)(nPixel)) * 0x0101010101010101ULL)
+
+/**
+ * Repeats a pixel value in all 8 nibbles.
+ */
+#define BROADCAST_NIBBLE(nPixel) (((DWORD)(nPixel)) * 0x11111111UL)
+
+
+/** Typedefs ************************************************************/
+
+/**
+ * Indexed decoder implementation prototype.
+ *
+ * @param[in]	ppnPlanes	Pointers to the first byte to decode in each plane.
+ * @param[in]	cbSpan		Number of bytes to decode from each plane.
+ *							Must be a multiple of DECODE_GROUP_BYTES.
+ * @param[out]	pnPixels	Will receive the indexed pixels.
+ */
+typedef
+VOID
+FN_VGADECODE_KERNEL(
+	_In_reads_(VGA_PLANES)					CONST BYTE * CONST *	ppnPlanes,
+	_In_									DWORD					cbSpan,
+	_Out_writes_(cbSpan * PIXELS_IN_BYTE)	PBYTE					pnPixels
+);
+typedef FN_VGADECODE_KERNEL *PFN_VGADECODE_KERNEL;
+
+/**
+ * True color decoder implementation prototype.
+ *
+ * @param[in]	ppnPlanes	Pointers to the first byte to decode in each plane.
+ * @param[in]	cbSpan		Number of bytes to decode from each plane.
+ *							Must be a multiple of DECODE_GROUP_BYTES.
+ * @param[in]	ptPalette	The colors of the VGA_COLORS pixel values.
+ * @param[out]	ptPixels	Will receive the colored pixels.
+ */
+typedef
+VOID
+FN_VGADECODE_COLOR_KERNEL(
+	_In_reads_(VGA_PLANES)					CONST BYTE * CONST *	ppnPlanes,
+	_In_									DWORD					cbSpan,
+	_In_reads_(VGA_COLORS)					CONST RGBQUAD *			ptPalette,
+	_Out_writes_(cbSpan * PIXELS_IN_BYTE)	RGBQUAD *				ptPixels
+);
+typedef FN_VGADECODE_COLOR_KERNEL *PFN_VGADECODE_COLOR_KERNEL;
+
+/**
+ * Packed 4bpp decoder implementation prototype.
+ *
+ * @param[in]	ppnPlanes	Pointers to the first byte to decode in each plane.
+ * @param[in]	cbSpan		Number of bytes to decode from each plane.
+ *							Must be a multiple of DECODE_GROUP_BYTES.
+ * @param[out]	pnPixels	Will receive the indexed pixels, two to a byte,
+ *							leftmost in the high nibble.
+ */
+typedef
+VOID
+FN_VGADECODE_NIBBLE_KERNEL(
+	_In_reads_(VGA_PLANES)							CONST BYTE * CONST *	ppnPlanes,
+	_In_											DWORD					cbSpan,
+	_Out_writes_(cbSpan * (PIXELS_IN_BYTE / 2))		PBYTE					pnPixels
+);
+typedef FN_VGADECODE_NIBBLE_KERNEL *PFN_VGADECODE_NIBBLE_KERNEL;
+
+/**
+ * Determines whether a decoder implementation can run on the current CPU.
+ *
+ * @returns BOOL
+ */
+typedef
+BOOL
+FN_VGADECODE_IS_SUPPORTED(VOID);
+typedef FN_VGADECODE_IS_SUPPORTED *PFN_VGADECODE_IS_SUPPORTED;
+
+/**
+ * Describes a single decoder implementation.
+ */
+typedef struct _VGADECODE_BACKEND
+{
+	// Name of the implementation, for diagnostics.
+	PCSTR						pszName;
+
+	// Checks whether the implementation is usable.
+	PFN_VGADECODE_IS_SUPPORTED	pfnIsSupported;
+
+	// Decodes to indexed pixels.
+	PFN_VGADECODE_KERNEL		pfnDecode;
+
+	// Decodes straight to true color pixels.
+	PFN_VGADECODE_COLOR_KERNEL	pfnDecodeToColor;
+
+	// Decodes to packed 4bpp pixels.
+	PFN_VGADECODE_NIBBLE_KERNEL	pfnDecodeToNibbles;
+
+	// Whether runs of uniform groups should be filled instead of decoded.
+	// Kernels that already keep up with the stores only lose time
+	// classifying the groups.
+	BOOL						bFillUniformRuns;
+} VGADECODE_BACKEND, *PVGADECODE_BACKEND;
+typedef CONST VGADECODE_BACKEND *PCVGADECODE_BACKEND;
+
+/**
+ * Whole image decoder prototype.
+ *
+ * @see VGADECODE_DecodeImage
+ */
+typedef
+VOID
+FN_VGADECODE_IMAGE(
+	_In_reads_(VGA_PLANES)					CONST BYTE * CONST *	ppnPlanes,
+	_In_									DWORD					cbPlaneStride,
+	_In_									DWORD					nWidth,
+	_In_									DWORD					nHeight,
+	_Out_writes_(cbPixelStride * nHeight)	PBYTE					pnPixels,
+	_In_									DWORD					cbPixelStride,
+	_Out_opt_								PRECT					ptContent
+);
+typedef FN_VGADECODE_IMAGE *PFN_VGADECODE_IMAGE;
+
+/**
+ * Whole image true color decoder prototype.
+ *
+ * @see VGADECODE_DecodeImageToColor
+ */
+typedef
+VOID
+FN_VGADECODE_IMAGE_TO_COLOR(
+	_In_reads_(VGA_PLANES)					CONST BYTE * CONST *	ppnPlanes,
+	_In_									DWORD					cbPlaneStride,
+	_In_									DWORD					nWidth,
+	_In_									DWORD					nHeight,
+	_In_reads_(VGA_COLORS)					CONST RGBQUAD *			ptPalette,
+	_Out_writes_(nWidth * nHeight)			RGBQUAD *				ptPixels,
+	_Out_opt_								PRECT					ptContent
+);
+typedef FN_VGADECODE_IMAGE_TO_COLOR *PFN_VGADECODE_IMAGE_TO_COLOR;
+
+/**
+ * Describes whole image decoders specialized for a single geometry.
+ */
+typedef struct _VGADECODE_GEOMETRY
+{
+	// The geometry the decoders are specialized for.
+	DWORD							nWidth;
+	DWORD							nHeight;
+	DWORD							cbPlaneStride;
+
+	// Decodes to indexed pixels.
+	PFN_VGADECODE_IMAGE				pfnDecodeImage;
+
+	// Decodes straight to true color pixels.
+	PFN_VGADECODE_IMAGE_TO_COLOR	pfnDecodeImageToColor;
+} VGADECODE_GEOMETRY, *PVGADECODE_GEOMETRY;
+typedef CONST VGADECODE_GEOMETRY *PCVGADECODE_GEOMETRY;
+
+// Forward declarations for the backend table.
+STATIC FN_VGADECODE_IS_SUPPORTED vgadecode_IsAvx2Supported;
+STATIC FN_VGADECODE_IS_SUPPORTED vgadecode_IsSsse3Supported;
+STATIC FN_VGADECODE_IS_SUPPORTED vgadecode_IsSse2Supported;
+STATIC FN_VGADECODE_IS_SUPPORTED vgadecode_IsScalarSupported;
+STATIC FN_VGADECODE_KERNEL vgadecode_DecodeAvx2;
+STATIC FN_VGADECODE_KERNEL vgadecode_DecodeSse2;
+STATIC FN_VGADECODE_KERNEL vgadecode_DecodeScalar;
+STATIC FN_VGADECODE_COLOR_KERNEL vgadecode_DecodeToColorAvx2;
+STATIC FN_VGADECODE_COLOR_KERNEL vgadecode_DecodeToColorSsse3;
+STATIC FN_VGADECODE_COLOR_KERNEL vgadecode_DecodeToColorScalar;
+STATIC FN_VGADECODE_NIBBLE_KERNEL vgadecode_DecodeToNibblesAvx2;
+STATIC FN_VGADECODE_NIBBLE_KERNEL vgadecode_DecodeToNibblesScalar;
+
+// Forward declarations for the geometry table.
+STATIC FN_VGADECODE_IMAGE vgadecode_DecodeImage640x480;
+STATIC FN_VGADECODE_IMAGE vgadecode_DecodeImage800x600;
+STATIC FN_VGADECODE_IMAGE_TO_COLOR vgadecode_DecodeImageToColor640x480;
+STATIC FN_VGADECODE_IMAGE_TO_COLOR vgadecode_DecodeImageToColor800x600;
+
+
+/** Globals *************************************************************/
+
+/**
+ * Maps every possible plane byte to its 8 pixel bits,
+ * one bit per byte.
+ *
+ * @see SPREAD_BITS
+ */
+STATIC CONST ULONGLONG g_anSpreadBits[256] = {
+	TABLE_ENTRIES_256(SPREAD_BITS)
+};
+
+/**
+ * Maps every possible glyph scan line to the mask
+ * of its 8 foreground pixels, one byte per pixel.
+ *
+ * @see GLYPH_ROW_MASK
+ */
+STATIC CONST ULONGLONG g_anGlyphRowMasks[VGA_FONT_GLYPHS] = {
+	TABLE_ENTRIES_256(GLYPH_ROW_MASK)
+};
+
+/**
+ * Maps every possible plane byte to its 8 pixel bits,
+ * one bit per nibble.
+ *
+ * @see SPREAD_NIBBLE_BITS
+ */
+STATIC CONST DWORD g_anSpreadNibbleBits[256] = {
+	TABLE_ENTRIES_256(SPREAD_NIBBLE_BITS)
+};
+
+/**
+ * Maps every possible glyph scan line to the mask
+ * of its 8 foreground pixels, one nibble per pixel.
+ * Also used to clear the pixels past the end of a row.
+ *
+ * @see GLYPH_NIBBLE_MASK
+ */
+STATIC CONST DWORD g_anGlyphNibbleMasks[VGA_FONT_GLYPHS] = {
+	TABLE_ENTRIES_256(GLYPH_NIBBLE_MASK)
+};
+
+/**
+ * The available decoder implementations, most preferred first.
+ * The last one must always be supported.
+ */
+STATIC CONST VGADECODE_BACKEND g_atBackends[] = {
+	{
+		"AVX2",
+		&vgadecode_IsAvx2Supported,
+		&vgadecode_DecodeAvx2,
+		&vgadecode_DecodeToColorAvx2,
+		&vgadecode_DecodeToNibblesAvx2,
+		FALSE
+	},
+
+	{
+		"SSSE3",
+		&vgadecode_IsSsse3Supported,
+		&vgadecode_DecodeSse2,
+		&vgadecode_DecodeToColorSsse3,
+		&vgadecode_DecodeToNibblesScalar,
+		TRUE
+	},
+
+	{
+		"SSE2",
+		&vgadecode_IsSse2Supported,
+		&vgadecode_DecodeSse2,
+		&vgadecode_DecodeToColorScalar,
+		&vgadecode_DecodeToNibblesScalar,
+		TRUE
+	},
+
+	{
+		"Scalar",
+		&vgadecode_IsScalarSupported,
+		&vgadecode_DecodeScalar,
+		&vgadecode_DecodeToColorScalar,
+		&vgadecode_DecodeToNibblesScalar,
+		TRUE
+	},
+};
+
+/**
+ * Geometries with specialized whole image decoders.
+ * Everything else goes through the generic path.
+ */
+STATIC CONST VGADECODE_GEOMETRY g_atGeometries[] = {
+	{
+		640, 480, 640 / PIXELS_IN_BYTE,
+		&vgadecode_DecodeImage640x480,
+		&vgadecode_DecodeImageToColor640x480
+	},
+
+	{
+		800, 600, 800 / PIXELS_IN_BYTE,
+		&vgadecode_DecodeImage800x600,
+		&vgadecode_DecodeImageToColor800x600
+	},
+};
+
+/**
+ * The decoder implementation selected for the current CPU.
+ * Selection is idempotent, so concurrent first calls
+ * are harmless.
+ */
+STATIC PCVGADECODE_BACKEND g_ptSelectedBackend = NULL;
+
+
+/** Functions ***********************************************************/
+
+/**
+ * Determines whether the CPU and the OS support AVX2.
+ *
+ * @returns BOOL
+ */
+STATIC
+BOOL
+vgadecode_IsAvx2Supported(VOID)
+{
+	BOOL	bSupported		= FALSE;
+	INT		anRegisters[4]	= { 0 };
+
+	// Make sure the structured extended feature leaf exists.
+	__cpuid(anRegisters, 0);
+	if (7 > anRegisters[0])
+	{
+		goto lblCleanup;
+	}
+
+	// AVX must be present, and the OS must be saving the YMM registers.
+	__cpuid(anRegisters, 1);
+	if ((CPUID_01_ECX_OSXSAVE | CPUID_01_ECX_AVX) !=
+		((DWORD)anRegisters[2] & (CPUID_01_ECX_OSXSAVE | CPUID_01_ECX_AVX)))
+	{
+		goto lblCleanup;
+	}
+	if (XCR0_SSE_AVX_STATE != (_xgetbv(XCR_XFEATURE_ENABLED_MASK) & XCR0_SSE_AVX_STATE))
+	{
+		goto lblCleanup;
+	}
+
+	__cpuidex(anRegisters, 7, 0);
+	if (0 == ((DWORD)anRegisters[1] & CPUID_07_EBX_AVX2))
+	{
+		goto lblCleanup;
+	}
+
+	bSupported = TRUE;
+
+lblCleanup:
+	return bSupported;
+}
+
+/**
+ * Determines whether the CPU supports SSSE3.
+ *
+ * @returns BOOL
+ */
+STATIC
+BOOL
+vgadecode_IsSsse3Supported(VOID)
+{
+	INT		anRegisters[4]	= { 0 };
+
+	__cpuid(anRegisters, 1);
+
+	return 0 != ((DWORD)anRegisters[2] & CPUID_01_ECX_SSSE3);
+}
+
+/**
+ * Determines whether the CPU supports SSE2.
+ *
+ * @returns BOOL
+ */
+STATIC
+BOOL
+vgadecode_IsSse2Supported(VOID)
+{
+	return IsProcessorFeaturePresent(PF_XMMI64_INSTRUCTIONS_AVAILABLE);
+}
+
+/**
+ * The scalar decoder runs everywhere.
+ *
+ * @returns BOOL
+ */
+STATIC
+BOOL
+vgadecode_IsScalarSupported(VOID)
+{
+	return TRUE;
+}
+
+/**
+ * Decodes 8 pixels using the bit-spreading lookup table.
+ *
+ * @param[in]	ppnPlanes	Pointers to the first byte of the span in each plane.
+ * @param[in]	nOffset		Offset of the byte to decode.
+ *
+ * @returns ULONGLONG (the 8 pixels, leftmost in the lowest byte)
+ */
+STATIC
+FORCEINLINE
+ULONGLONG
+vgadecode_ScalarDecodeByte(
+	_In_reads_(VGA_PLANES)	CONST BYTE * CONST *	ppnPlanes,
+	_In_					DWORD					nOffset
+)
+{
+	C_ASSERT(4 == VGA_PLANES);
+
+	return (g_anSpreadBits[ppnPlanes[0][nOffset]] << 0) |
+		   (g_anSpreadBits[ppnPlanes[1][nOffset]] << 1) |
+		   (g_anSpreadBits[ppnPlanes[2][nOffset]] << 2) |
+		   (g_anSpreadBits[ppnPlanes[3][nOffset]] << 3);
+}
+
+/**
+ * Decodes planar data using the bit-spreading lookup table,
+ * 8 pixels at a time.
+ *
+ * @see FN_VGADECODE_KERNEL
+ *
+ * @remark	Unlike the other implementations, cbSpan
+ *			need not be a multiple of DECODE_GROUP_BYTES.
+ */
+STATIC
+VOID
+vgadecode_DecodeScalar(
+	_In_reads_(VGA_PLANES)					CONST BYTE * CONST *	ppnPlanes,
+	_In_									DWORD					cbSpan,
+	_Out_writes_(cbSpan * PIXELS_IN_BYTE)	PBYTE					pnPixels
+)
+{
+	DWORD	nOffset	= 0;
+
+	for (nOffset = 0; nOffset < cbSpan; ++nOffset)
+	{
+		// The table is laid out for a little-endian store,
+		// which is what all our targets are.
+		*(UNALIGNED ULONGLONG *)(pnPixels + (nOffset * PIXELS_IN_BYTE)) =
+			vgadecode_ScalarDecodeByte(ppnPlanes, nOffset);
+	}
+}
+
+/**
+ * Decodes planar data straight to true color,
+ * 8 pixels at a time.
+ *
+ * @see FN_VGADECODE_COLOR_KERNEL
+ *
+ * @remark	Unlike the other implementations, cbSpan
+ *			need not be a multiple of DECODE_GROUP_BYTES.
+ */
+STATIC
+VOID
+vgadecode_DecodeToColorScalar(
+	_In_reads_(VGA_PLANES)					CONST BYTE * CONST *	ppnPlanes,
+	_In_									DWORD					cbSpan,
+	_In_reads_(VGA_COLORS)					CONST RGBQUAD *			ptPalette,
+	_Out_writes_(cbSpan * PIXELS_IN_BYTE)	RGBQUAD *				ptPixels
+)
+{
+	DWORD		nOffset		= 0;
+	DWORD		nPixel		= 0;
+	ULONGLONG	nIndices	= 0;
+
+	for (nOffset = 0; nOffset < cbSpan; ++nOffset)
+	{
+		nIndices = vgadecode_ScalarDecodeByte(ppnPlanes, nOffset);
+
+		for (nPixel = 0; nPixel < PIXELS_IN_BYTE; ++nPixel)
+		{
+			*ptPixels++ = ptPalette[(BYTE)nIndices];
+			nIndices >>= 8;
+		}
+	}
+}
+
+/**
+ * Decodes planar data to packed 4bpp pixels using
+ * the nibble-spreading lookup table, 8 pixels at a time.
+ *
+ * @see FN_VGADECODE_NIBBLE_KERNEL
+ *
+ * @remark	Unlike the other implementations, cbSpan
+ *			need not be a multiple of DECODE_GROUP_BYTES.
+ */
+STATIC
+VOID
+vgadecode_DecodeToNibblesScalar(
+	_In_reads_(VGA_PLANES)							CONST BYTE * CONST *	ppnPlanes,
+	_In_											DWORD					cbSpan,
+	_Out_writes_(cbSpan * (PIXELS_IN_BYTE / 2))		PBYTE					pnPixels
+)
+{
+	DWORD	nOffset	= 0;
+
+	C_ASSERT(4 == VGA_PLANES);
+
+	for (nOffset = 0; nOffset < cbSpan; ++nOffset)
+	{
+		// Like the bit-spreading table, this one is laid out
+		// for a little-endian store.
+		*(UNALIGNED DWORD *)(pnPixels + (nOffset * sizeof(DWORD))) =
+			(g_anSpreadNibbleBits[ppnPlanes[0][nOffset]] << 0) |
+			(g_anSpreadNibbleBits[ppnPlanes[1][nOffset]] << 1) |
+			(g_anSpreadNibbleBits[ppnPlanes[2][nOffset]] << 2) |
+			(g_anSpreadNibbleBits[ppnPlanes[3][nOffset]] << 3);
+	}
+}
+
+/**
+ * Expands 16 broadcast plane bytes into the plane's bit
+ * of 16 pixels.
+ *
+ * @param[in]	xBytes		Each plane byte repeated 8 times.
+ * @param[in]	xBitMask	The pixel bit mask, MSB first.
+ * @param[in]	xPlaneBit	The plane's bit in the pixel index.
+ *
+ * @returns __m128i
+ */
+STATIC
+FORCEINLINE
+__m128i
+vgadecode_Sse2PlaneBits(
+	_In_	__m128i	xBytes,
+	_In_	__m128i	xBitMask,
+	_In_	__m128i	xPlaneBit
+)
+{
+	return _mm_and_si128(_mm_cmpeq_epi8(_mm_and_si128(xBytes, xBitMask), xBitMask),
+						 xPlaneBit);
+}
+
+/**
+ * Decodes 64 pixels using SSE2.
+ *
+ * @param[in]	ppnPlanes	Pointers to the first byte of the span in each plane.
+ * @param[in]	nOffset		Offset of the first of 8 bytes to decode.
+ * @param[out]	axPixels	Will receive the indexed pixels, in order.
+ */
+STATIC
+FORCEINLINE
+VOID
+vgadecode_Sse2DecodeGroup(
+	_In_reads_(VGA_PLANES)	CONST BYTE * CONST *	ppnPlanes,
+	_In_					DWORD					nOffset,
+	_Out_writes_all_(4)		__m128i *				axPixels
+)
+{
+	CONST __m128i	xBitMask		= _mm_setr_epi8((CHAR)0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01,
+													(CHAR)0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01);
+	DWORD			nPlane			= 0;
+	__m128i			xPlaneBit		= _mm_setzero_si128();
+	__m128i			xBytes			= _mm_setzero_si128();
+	__m128i			xWords			= _mm_setzero_si128();
+
+	axPixels[0] = _mm_setzero_si128();
+	axPixels[1] = _mm_setzero_si128();
+	axPixels[2] = _mm_setzero_si128();
+	axPixels[3] = _mm_setzero_si128();
+
+	for (nPlane = 0; nPlane < VGA_PLANES; ++nPlane)
+	{
+		xPlaneBit = _mm_set1_epi8((CHAR)(1 << nPlane));
+
+		// Broadcast each of the 8 plane bytes to 8 lanes:
+		// b0 b0 b1 b1 ... -> b0 x4 b1 x4 ... -> b0 x8 b1 x8.
+		xBytes = _mm_loadl_epi64((CONST __m128i *)(ppnPlanes[nPlane] + nOffset));
+		xBytes = _mm_unpacklo_epi8(xBytes, xBytes);
+
+		xWords = _mm_unpacklo_epi16(xBytes, xBytes);
+		axPixels[0] = _mm_or_si128(axPixels[0],
+								   vgadecode_Sse2PlaneBits(_mm_unpacklo_epi32(xWords, xWords),
+														   xBitMask,
+														   xPlaneBit));
+		axPixels[1] = _mm_or_si128(axPixels[1],
+								   vgadecode_Sse2PlaneBits(_mm_unpackhi_epi32(xWords, xWords),
+														   xBitMask,
+														   xPlaneBit));
+
+		xWords = _mm_unpackhi_epi16(xBytes, xBytes);
+		axPixels[2] = _mm_or_si128(axPixels[2],
+								   vgadecode_Sse2PlaneBits(_mm_unpacklo_epi32(xWords, xWords),
+														   xBitMask,
+														   xPlaneBit));
+		axPixels[3] = _mm_or_si128(axPixels[3],
+								   vgadecode_Sse2PlaneBits(_mm_unpackhi_epi32(xWords, xWords),
+														   xBitMask,
+														   xPlaneBit));
+	}
+}
+
+/**
+ * Decodes planar data using SSE2, 64 pixels at a time.
+ *
+ * @see FN_VGADECODE_KERNEL
+ */
+STATIC
+VOID
+vgadecode_DecodeSse2(
+	_In_reads_(VGA_PLANES)					CONST BYTE * CONST *	ppnPlanes,
+	_In_									DWORD					cbSpan,
+	_Out_writes_(cbSpan * PIXELS_IN_BYTE)	PBYTE					pnPixels
+)
+{
+	DWORD	nOffset			= 0;
+	__m128i	axPixels[4]		= { 0 };
+
+	assert(0 == (cbSpan % DECODE_GROUP_BYTES));
+
+	for (nOffset = 0; nOffset < cbSpan; nOffset += DECODE_GROUP_BYTES)
+	{
+		vgadecode_Sse2DecodeGroup(ppnPlanes, nOffset, axPixels);
+
+		_mm_storeu_si128((__m128i *)(pnPixels + (nOffset * PIXELS_IN_BYTE) + 0), axPixels[0]);
+		_mm_storeu_si128((__m128i *)(pnPixels + (nOffset * PIXELS_IN_BYTE) + 16), axPixels[1]);
+		_mm_storeu_si128((__m128i *)(pnPixels + (nOffset * PIXELS_IN_BYTE) + 32), axPixels[2]);
+		_mm_storeu_si128((__m128i *)(pnPixels + (nOffset * PIXELS_IN_BYTE) + 48), axPixels[3]);
+	}
+}
+
+/**
+ * Splits a palette into per-channel lookup tables,
+ * suitable for a byte shuffle.
+ *
+ * @param[in]	ptPalette	The palette to split.
+ * @param[out]	anChannels	Will receive byte N of each palette entry
+ *							in anChannels[N].
+ */
+STATIC
+FORCEINLINE
+VOID
+vgadecode_SplitPalette(
+	_In_reads_(VGA_COLORS)				CONST RGBQUAD *	ptPalette,
+	_Out_writes_all_(RGBQUAD_CHANNELS)	BYTE			anChannels[RGBQUAD_CHANNELS][VGA_COLORS]
+)
+{
+	DWORD	nColor		= 0;
+	DWORD	nChannel	= 0;
+
+	for (nColor = 0; nColor < VGA_COLORS; ++nColor)
+	{
+		for (nChannel = 0; nChannel < RGBQUAD_CHANNELS; ++nChannel)
+		{
+			anChannels[nChannel][nColor] = ((CONST BYTE *)&(ptPalette[nColor]))[nChannel];
+		}
+	}
+}
+
+/**
+ * Looks up the colors of 16 indexed pixels using SSSE3
+ * and stores them.
+ *
+ * @param[in]	xIndices	The indexed pixels.
+ * @param[in]	axChannels	Per-channel lookup tables.
+ * @param[out]	ptPixels	Will receive the 16 colored pixels.
+ */
+STATIC
+FORCEINLINE
+VOID
+vgadecode_Ssse3ExpandColors(
+	_In_							__m128i			xIndices,
+	_In_reads_(RGBQUAD_CHANNELS)	CONST __m128i *	axChannels,
+	_Out_writes_all_(16)			RGBQUAD *		ptPixels
+)
+{
+	__m128i	xChannel0	= _mm_shuffle_epi8(axChannels[0], xIndices);
+	__m128i	xChannel1	= _mm_shuffle_epi8(axChannels[1], xIndices);
+	__m128i	xChannel2	= _mm_shuffle_epi8(axChannels[2], xIndices);
+	__m128i	xChannel3	= _mm_shuffle_epi8(axChannels[3], xIndices);
+	__m128i	xLow01		= _mm_unpacklo_epi8(xChannel0, xChannel1);
+	__m128i	xHigh01		= _mm_unpackhi_epi8(xChannel0, xChannel1);
+	__m128i	xLow23		= _mm_unpacklo_epi8(xChannel2, xChannel3);
+	__m128i	xHigh23		= _mm_unpackhi_epi8(xChannel2, xChannel3);
+
+	C_ASSERT(4 == RGBQUAD_CHANNELS);
+
+	_mm_storeu_si128((__m128i *)(ptPixels + 0), _mm_unpacklo_epi16(xLow01, xLow23));
+	_mm_storeu_si128((__m128i *)(ptPixels + 4), _mm_unpackhi_epi16(xLow01, xLow23));
+	_mm_storeu_si128((__m128i *)(ptPixels + 8), _mm_unpacklo_epi16(xHigh01, xHigh23));
+	_mm_storeu_si128((__m128i *)(ptPixels + 12), _mm_unpackhi_epi16(xHigh01, xHigh23));
+}
+
+/**
+ * Decodes planar data straight to true color using SSSE3,
+ * 64 pixels at a time. Since there are only 16 colors,
+ * each channel of the palette fits in a single register
+ * and is looked up with one byte shuffle.
+ *
+ * @see FN_VGADECODE_COLOR_KERNEL
+ */
+STATIC
+VOID
+vgadecode_DecodeToColorSsse3(
+	_In_reads_(VGA_PLANES)					CONST BYTE * CONST *	ppnPlanes,
+	_In_									DWORD					cbSpan,
+	_In_reads_(VGA_COLORS)					CONST RGBQUAD *			ptPalette,
+	_Out_writes_(cbSpan * PIXELS_IN_BYTE)	RGBQUAD *				ptPixels
+)
+{
+	BYTE	anChannels[RGBQUAD_CHANNELS][VGA_COLORS]	= { 0 };
+	__m128i	axChannels[RGBQUAD_CHANNELS]				= { 0 };
+	__m128i	axPixels[4]									= { 0 };
+	DWORD	nChannel									= 0;
+	DWORD	nOffset										= 0;
+	DWORD	nVector										= 0;
+
+	C_ASSERT(sizeof(axChannels[0]) == sizeof(anChannels[0]));
+	assert(0 == (cbSpan % DECODE_GROUP_BYTES));
+
+	vgadecode_SplitPalette(ptPalette, anChannels);
+	for (nChannel = 0; nChannel < RGBQUAD_CHANNELS; ++nChannel)
+	{
+		axChannels[nChannel] = _mm_loadu_si128((CONST __m128i *)anChannels[nChannel]);
+	}
+
+	for (nOffset = 0; nOffset < cbSpan; nOffset += DECODE_GROUP_BYTES)
+	{
+		vgadecode_Sse2DecodeGroup(ppnPlanes, nOffset, axPixels);
+
+		for (nVector = 0; nVector < ARRAYSIZE(axPixels); ++nVector)
+		{
+			vgadecode_Ssse3ExpandColors(axPixels[nVector],
+										axChannels,
+										ptPixels + (nOffset * PIXELS_IN_BYTE) + (nVector * 16));
+		}
+	}
+}
+
+/**
+ * Decodes 64 pixels using AVX2.
+ *
+ * @param[in]	ppnPlanes		Pointers to the first byte of the span in each plane.
+ * @param[in]	nOffset			Offset of the first of 8 bytes to decode.
+ * @param[out]	pyLowPixels		Will receive the first 32 indexed pixels.
+ * @param[out]	pyHighPixels	Will receive the last 32 indexed pixels.
+ */
+STATIC
+FORCEINLINE
+VOID
+vgadecode_Avx2DecodeGroup(
+	_In_reads_(VGA_PLANES)	CONST BYTE * CONST *	ppnPlanes,
+	_In_					DWORD					nOffset,
+	_Out_					__m256i *				pyLowPixels,
+	_Out_					__m256i *				pyHighPixels
+)
+{
+	CONST __m256i	yBitMask		= _mm256_setr_epi8((CHAR)0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01,
+													   (CHAR)0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01,
+													   (CHAR)0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01,
+													   (CHAR)0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01);
+
+	// The shuffle works within 128-bit lanes, so each lane
+	// picks its bytes from its own copy of the 8 plane bytes.
+	CONST __m256i	yLowBytes		= _mm256_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1,
+													   2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3);
+	CONST __m256i	yHighBytes		= _mm256_setr_epi8(4, 4, 4, 4, 4, 4, 4, 4, 5, 5, 5, 5, 5, 5, 5, 5,
+													   6, 6, 6, 6, 6, 6, 6, 6, 7, 7, 7, 7, 7, 7, 7, 7);
+	DWORD			nPlane			= 0;
+	__m256i			yPlaneBit		= _mm256_setzero_si256();
+	__m256i			yBytes			= _mm256_setzero_si256();
+	__m256i			yBits			= _mm256_setzero_si256();
+	__m256i			yLowPixels		= _mm256_setzero_si256();
+	__m256i			yHighPixels		= _mm256_setzero_si256();
+
+	for (nPlane = 0; nPlane < VGA_PLANES; ++nPlane)
+	{
+		yPlaneBit = _mm256_set1_epi8((CHAR)(1 << nPlane));
+		yBytes = _mm256_broadcastq_epi64(_mm_loadl_epi64((CONST __m128i *)(ppnPlanes[nPlane] + nOffset)));
+
+		yBits = _mm256_and_si256(_mm256_shuffle_epi8(yBytes, yLowBytes), yBitMask);
+		yBits = _mm256_and_si256(_mm256_cmpeq_epi8(yBits, yBitMask), yPlaneBit);
+		yLowPixels = _mm256_or_si256(yLowPixels, yBits);
+
+		yBits = _mm256_and_si256(_mm256_shuffle_epi8(yBytes, yHighBytes), yBitMask);
+		yBits = _mm256_and_si256(_mm256_cmpeq_epi8(yBits, yBitMask), yPlaneBit);
+		yHighPixels = _mm256_or_si256(yHighPixels, yBits);
+	}
+
+	*pyLowPixels = yLowPixels;
+	*pyHighPixels = yHighPixels;
+}
+
+/**
+ * Decodes planar data using AVX2, 64 pixels at a time.
+ *
+ * @see FN_VGADECODE_KERNEL
+ */
+STATIC
+VOID
+vgadecode_DecodeAvx2(
+	_In_reads_(VGA_PLANES)					CONST BYTE * CONST *	ppnPlanes,
+	_In_									DWORD					cbSpan,
+	_Out_writes_(cbSpan * PIXELS_IN_BYTE)	PBYTE					pnPixels
+)
+{
+	DWORD	nOffset			= 0;
+	__m256i	yLowPixels		= _mm256_setzero_si256();
+	__m256i	yHighPixels		= _mm256_setzero_si256();
+
+	assert(0 == (cbSpan % DECODE_GROUP_BYTES));
+
+	for (nOffset = 0; nOffset < cbSpan; nOffset += DECODE_GROUP_BYTES)
+	{
+		vgadecode_Avx2DecodeGroup(ppnPlanes, nOffset, &yLowPixels, &yHighPixels);
+
+		_mm256_storeu_si256((__m256i *)(pnPixels + (nOffset * PIXELS_IN_BYTE) + 0), yLowPixels);
+		_mm256_storeu_si256((__m256i *)(pnPixels + (nOffset * PIXELS_IN_BYTE) + 32), yHighPixels);
+	}
+
+	// Avoid AVX-SSE transition penalties in the caller.
+	_mm256_zeroupper();
+}
+
+/**
+ * Decodes planar data to packed 4bpp pixels using AVX2,
+ * 64 pixels at a time. Each plane byte is repeated
+ * in the 4 output bytes it covers, and tested for
+ * the left and the right pixel of each.
+ *
+ * @see FN_VGADECODE_NIBBLE_KERNEL
+ */
+STATIC
+VOID
+vgadecode_DecodeToNibblesAvx2(
+	_In_reads_(VGA_PLANES)							CONST BYTE * CONST *	ppnPlanes,
+	_In_											DWORD					cbSpan,
+	_Out_writes_(cbSpan * (PIXELS_IN_BYTE / 2))		PBYTE					pnPixels
+)
+{
+	// Output byte N holds pixels 2N and 2N+1 of its plane byte.
+	CONST __m256i	yLeftMask		= _mm256_set1_epi32(0x02082080);
+	CONST __m256i	yRightMask		= _mm256_set1_epi32(0x01041040);
+
+	// The shuffle works within 128-bit lanes, so each lane
+	// picks its bytes from its own copy of the 8 plane bytes.
+	CONST __m256i	yNibbleBytes	= _mm256_setr_epi8(0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3,
+													   4, 4, 4, 4, 5, 5, 5, 5, 6, 6, 6, 6, 7, 7, 7, 7);
+	CONST __m256i	yLeftBit		= _mm256_set1_epi8(0x10);
+	CONST __m256i	yRightBit		= _mm256_set1_epi8(0x01);
+	DWORD			nOffset			= 0;
+	INT				nPlane			= 0;
+	__m256i			yBytes			= _mm256_setzero_si256();
+	__m256i			yLeft			= _mm256_setzero_si256();
+	__m256i			yRight			= _mm256_setzero_si256();
+	__m256i			yPixels			= _mm256_setzero_si256();
+
+	assert(0 == (cbSpan % DECODE_GROUP_BYTES));
+
+	for (nOffset = 0; nOffset < cbSpan; nOffset += DECODE_GROUP_BYTES)
+	{
+		yPixels = _mm256_setzero_si256();
+
+		// The planes are shifted in from the highest, so the bits
+		// never cross into the neighbouring byte.
+		for (nPlane = VGA_PLANES - 1; nPlane >= 0; --nPlane)
+		{
+			yBytes = _mm256_broadcastq_epi64(_mm_loadl_epi64((CONST __m128i *)(ppnPlanes[nPlane] + nOffset)));
+			yBytes = _mm256_shuffle_epi8(yBytes, yNibbleBytes);
+
+			yLeft = _mm256_cmpeq_epi8(_mm256_and_si256(yBytes, yLeftMask), yLeftMask);
+			yRight = _mm256_cmpeq_epi8(_mm256_and_si256(yBytes, yRightMask), yRightMask);
+			yPixels = _mm256_or_si256(_mm256_slli_epi16(yPixels, 1),
+									  _mm256_or_si256(_mm256_and_si256(yLeft, yLeftBit),
+													  _mm256_and_si256(yRight, yRightBit)));
+		}
+
+		_mm256_storeu_si256((__m256i *)(pnPixels + (nOffset * (PIXELS_IN_BYTE / 2))), yPixels);
+	}
+
+	// Avoid AVX-SSE transition penalties in the caller.
+	_mm256_zeroupper();
+}
+
+/**
+ * Looks up the colors of 32 indexed pixels using AVX2
+ * and stores them.
+ *
+ * @param[in]	yIndices	The indexed pixels.
+ * @param[in]	ayChannels	Per-channel lookup tables,
+ *							repeated in both 128-bit lanes.
+ * @param[out]	ptPixels	Will receive the 32 colored pixels.
+ */
+STATIC
+FORCEINLINE
+VOID
+vgadecode_Avx2ExpandColors(
+	_In_							__m256i			yIndices,
+	_In_reads_(RGBQUAD_CHANNELS)	CONST __m256i *	ayChannels,
+	_Out_writes_all_(32)			RGBQUAD *		ptPixels
+)
+{
+	__m256i	yChannel0	= _mm256_shuffle_epi8(ayChannels[0], yIndices);
+	__m256i	yChannel1	= _mm256_shuffle_epi8(ayChannels[1], yIndices);
+	__m256i	yChannel2	= _mm256_shuffle_epi8(ayChannels[2], yIndices);
+	__m256i	yChannel3	= _mm256_shuffle_epi8(ayChannels[3], yIndices);
+	__m256i	yLow01		= _mm256_unpacklo_epi8(yChannel0, yChannel1);
+	__m256i	yHigh01		= _mm256_unpackhi_epi8(yChannel0, yChannel1);
+	__m256i	yLow23		= _mm256_unpacklo_epi8(yChannel2, yChannel3);
+	__m256i	yHigh23		= _mm256_unpackhi_epi8(yChannel2, yChannel3);
+
+	// Lane N of each quad holds pixels 16N+0..3, 16N+4..7, etc.
+	__m256i	yQuad0		= _mm256_unpacklo_epi16(yLow01, yLow23);
+	__m256i	yQuad1		= _mm256_unpackhi_epi16(yLow01, yLow23);
+	__m256i	yQuad2		= _mm256_unpacklo_epi16(yHigh01, yHigh23);
+	__m256i	yQuad3		= _mm256_unpackhi_epi16(yHigh01, yHigh23);
+
+	C_ASSERT(4 == RGBQUAD_CHANNELS);
+
+	_mm256_storeu_si256((__m256i *)(ptPixels + 0), _mm256_permute2x128_si256(yQuad0, yQuad1, 0x20));
+	_mm256_storeu_si256((__m256i *)(ptPixels + 8), _mm256_permute2x128_si256(yQuad2, yQuad3, 0x20));
+	_mm256_storeu_si256((__m256i *)(ptPixels + 16), _mm256_permute2x128_si256(yQuad0, yQuad1, 0x31));
+	_mm256_storeu_si256((__m256i *)(ptPixels + 24), _mm256_permute2x128_si256(yQuad2, yQuad3, 0x31));
+}
+
+/**
+ * Decodes planar data straight to true color using AVX2,
+ * 64 pixels at a time.
+ *
+ * @see FN_VGADECODE_COLOR_KERNEL
+ * @see vgadecode_DecodeToColorSsse3
+ */
+STATIC
+VOID
+vgadecode_DecodeToColorAvx2(
+	_In_reads_(VGA_PLANES)					CONST BYTE * CONST *	ppnPlanes,
+	_In_									DWORD					cbSpan,
+	_In_reads_(VGA_COLORS)					CONST RGBQUAD *			ptPalette,
+	_Out_writes_(cbSpan * PIXELS_IN_BYTE)	RGBQUAD *				ptPixels
+)
+{
+	BYTE	anChannels[RGBQUAD_CHANNELS][VGA_COLORS]	= { 0 };
+	__m256i	ayChannels[RGBQUAD_CHANNELS]				= { 0 };
+	__m256i	yLowPixels									= _mm256_setzero_si256();
+	__m256i	yHighPixels									= _mm256_setzero_si256();
+	DWORD	nChannel									= 0;
+	DWORD	nOffset										= 0;
+
+	assert(0 == (cbSpan % DECODE_GROUP_BYTES));
+
+	vgadecode_SplitPalette(ptPalette, anChannels);
+	for (nChannel = 0; nChannel < RGBQUAD_CHANNELS; ++nChannel)
+	{
+		ayChannels[nChannel] = _mm256_broadcastsi128_si256(
+			_mm_loadu_si128((CONST __m128i *)anChannels[nChannel]));
+	}
+
+	for (nOffset = 0; nOffset < cbSpan; nOffset += DECODE_GROUP_BYTES)
+	{
+		vgadecode_Avx2DecodeGroup(ppnPlanes, nOffset, &yLowPixels, &yHighPixels);
+
+		vgadecode_Avx2ExpandColors(yLowPixels,
+								   ayChannels,
+								   ptPixels + (nOffset * PIXELS_IN_BYTE));
+		vgadecode_Avx2ExpandColors(yHighPixels,
+								   ayChannels,
+								   ptPixels + (nOffset * PIXELS_IN_BYTE) + 32);
+	}
+
+	// Avoid AVX-SSE transition penalties in the caller.
+	_mm256_zeroupper();
+}
+
+/**
+ * Retrieves the decoder implementation for the current CPU,
+ * selecting it if this is the first call.
+ *
+ * @returns PCVGADECODE_BACKEND
+ */
+STATIC
+PCVGADECODE_BACKEND
+vgadecode_GetBackend(VOID)
+{
+	DWORD	nIndex	= 0;
+
+	if (NULL != g_ptSelectedBackend)
+	{
+		goto lblCleanup;
+	}
+
+	for (nIndex = 0; nIndex < ARRAYSIZE(g_atBackends); ++nIndex)
+	{
+		if (g_atBackends[nIndex].pfnIsSupported())
+		{
+			g_ptSelectedBackend = &(g_atBackends[nIndex]);
+			break;
+		}
+	}
+	assert(NULL != g_ptSelectedBackend);
+
+lblCleanup:
+	return g_ptSelectedBackend;
+}
+
+/**
+ * Retrieves a single pixel's bit from one of the planes.
+ *
+ * @param[in]	pnPlane		The row of the plane the pixel is on.
+ * @param[in]	nPixelIndex	The pixel's column.
+ *
+ * @returns BYTE (0 or 1)
+ */
+STATIC
+BYTE
+vgadecode_GetPixelBitFromPlane(
+	_In_	CONST BYTE *	pnPlane,
+	_In_	DWORD			nPixelIndex
+)
+{
+	BYTE	nByteContainingPixel	= 0;
+	BYTE	nBit					= 0;
+
+	assert(NULL != pnPlane);
+
+	// Find the byte containing the pixel data required
+	nByteContainingPixel = pnPlane[nPixelIndex / PIXELS_IN_BYTE];
+
+	// Move the relevant bit to be the MSB
+	nBit = nByteContainingPixel;
+	nBit <<= (nPixelIndex % PIXELS_IN_BYTE);
+
+	// Move the relevant bit to be the LSB
+	nBit >>= (PIXELS_IN_BYTE - 1);
+
+	return nBit;
+}
+
+/**
+ * Advances pointers into each of the planes.
+ *
+ * @param[in]	ppnPlanes	Pointers into each plane.
+ * @param[in]	cbOffset	Number of bytes to advance by.
+ * @param[out]	apnOffset	Will receive the advanced pointers.
+ */
+STATIC
+FORCEINLINE
+VOID
+vgadecode_OffsetPlanes(
+	_In_reads_(VGA_PLANES)			CONST BYTE * CONST *	ppnPlanes,
+	_In_							DWORD					cbOffset,
+	_Out_writes_all_(VGA_PLANES)	CONST BYTE **			apnOffset
+)
+{
+	DWORD	nPlane	= 0;
+
+	for (nPlane = 0; nPlane < VGA_PLANES; ++nPlane)
+	{
+		apnOffset[nPlane] = ppnPlanes[nPlane] + cbOffset;
+	}
+}
+
+/**
+ * Checks whether each plane of a group is uniformly 0x00 or 0xFF,
+ * in which case all of the group's pixels have the same value.
+ *
+ * @param[in]	ppnPlanes	Pointers into each plane.
+ * @param[in]	cbOffset	Offset of the group.
+ *
+ * @returns DWORD, the pixel value of the group, or MIXED_GROUP.
+ */
+STATIC
+FORCEINLINE
+DWORD
+vgadecode_ClassifyGroup(
+	_In_reads_(VGA_PLANES)	CONST BYTE * CONST *	ppnPlanes,
+	_In_					DWORD					cbOffset
+)
+{
+	DWORD		nValue	= 0;
+	DWORD		nPlane	= 0;
+	ULONGLONG	nBits	= 0;
+
+	for (nPlane = 0; nPlane < VGA_PLANES; ++nPlane)
+	{
+		nBits = *(UNALIGNED CONST ULONGLONG *)(ppnPlanes[nPlane] + cbOffset);
+		if (~0ULL == nBits)
+		{
+			nValue |= 1UL << nPlane;
+		}
+		else if (0 != nBits)
+		{
+			nValue = MIXED_GROUP;
+			break;
+		}
+	}
+
+	return nValue;
+}
+
+/**
+ * Finds the run of groups that are classified the same
+ * as the group it starts with.
+ *
+ * @param[in]	ppnPlanes	Pointers into each plane.
+ * @param[in]	cbOffset	Offset of the run.
+ * @param[in]	cbSpan		Offset the run can't extend past.
+ *							Must be a multiple of DECODE_GROUP_BYTES.
+ * @param[out]	pnValue		Will receive the classification of the run.
+ *
+ * @returns DWORD, the offset the run ends at.
+ *
+ * @see vgadecode_ClassifyGroup
+ */
+STATIC
+FORCEINLINE
+DWORD
+vgadecode_FindRun(
+	_In_reads_(VGA_PLANES)	CONST BYTE * CONST *	ppnPlanes,
+	_In_					DWORD					cbOffset,
+	_In_					DWORD					cbSpan,
+	_Out_					PDWORD					pnValue
+)
+{
+	DWORD	nValue	= vgadecode_ClassifyGroup(ppnPlanes, cbOffset);
+
+	for (cbOffset += DECODE_GROUP_BYTES;
+		 (cbOffset < cbSpan) && (vgadecode_ClassifyGroup(ppnPlanes, cbOffset) == nValue);
+		 cbOffset += DECODE_GROUP_BYTES)
+	{
+		// Just looking.
+	}
+
+	*pnValue = nValue;
+
+	return cbOffset;
+}
+
+/**
+ * Decodes whole groups into indexed pixels. Unless the backend
+ * is faster decoding everything, runs of uniform groups
+ * are filled in one go, and only the rest is decoded bit by bit.
+ *
+ * @see FN_VGADECODE_KERNEL
+ */
+STATIC
+VOID
+vgadecode_DecodeGroups(
+	_In_reads_(VGA_PLANES)					CONST BYTE * CONST *	ppnPlanes,
+	_In_									DWORD					cbSpan,
+	_Out_writes_(cbSpan * PIXELS_IN_BYTE)	PBYTE					pnPixels
+)
+{
+	PCVGADECODE_BACKEND		ptBackend				= vgadecode_GetBackend();
+	DWORD					cbOffset				= 0;
+	DWORD					cbRunEnd				= 0;
+	DWORD					nValue					= 0;
+	CONST BYTE *			apnRun[VGA_PLANES]		= { NULL };
+
+	if (!ptBackend->bFillUniformRuns)
+	{
+		ptBackend->pfnDecode(ppnPlanes, cbSpan, pnPixels);
+		goto lblCleanup;
+	}
+
+	for (cbOffset = 0; cbOffset < cbSpan; cbOffset = cbRunEnd)
+	{
+		cbRunEnd = vgadecode_FindRun(ppnPlanes, cbOffset, cbSpan, &nValue);
+
+		if (MIXED_GROUP == nValue)
+		{
+			vgadecode_OffsetPlanes(ppnPlanes, cbOffset, apnRun);
+			ptBackend->pfnDecode(apnRun, cbRunEnd - cbOffset, pnPixels + (cbOffset * PIXELS_IN_BYTE));
+		}
+		else
+		{
+			FillMemory(pnPixels + (cbOffset * PIXELS_IN_BYTE),
+					   (cbRunEnd - cbOffset) * PIXELS_IN_BYTE,
+					   (BYTE)nValue);
+		}
+	}
+
+lblCleanup:
+	return;
+}
+
+/**
+ * Decodes whole groups straight to true color.
+ *
+ * @see FN_VGADECODE_COLOR_KERNEL
+ * @see vgadecode_DecodeGroups
+ */
+STATIC
+VOID
+vgadecode_DecodeGroupsToColor(
+	_In_reads_(VGA_PLANES)					CONST BYTE * CONST *	ppnPlanes,
+	_In_									DWORD					cbSpan,
+	_In_reads_(VGA_COLORS)					CONST RGBQUAD *			ptPalette,
+	_Out_writes_(cbSpan * PIXELS_IN_BYTE)	RGBQUAD *				ptPixels
+)
+{
+	PCVGADECODE_BACKEND			ptBackend				= vgadecode_GetBackend();
+	DWORD						cbOffset				= 0;
+	DWORD						cbRunEnd				= 0;
+	DWORD						nValue					= 0;
+	DWORD						nPixel					= 0;
+	DWORD						nRunPixels				= 0;
+	RGBQUAD *					ptRun					= NULL;
+	CONST BYTE *				apnRun[VGA_PLANES]		= { NULL };
+
+	if (!ptBackend->bFillUniformRuns)
+	{
+		ptBackend->pfnDecodeToColor(ppnPlanes, cbSpan, ptPalette, ptPixels);
+		goto lblCleanup;
+	}
+
+	for (cbOffset = 0; cbOffset < cbSpan; cbOffset = cbRunEnd)
+	{
+		cbRunEnd = vgadecode_FindRun(ppnPlanes, cbOffset, cbSpan, &nValue);
+
+		if (MIXED_GROUP == nValue)
+		{
+			vgadecode_OffsetPlanes(ppnPlanes, cbOffset, apnRun);
+			ptBackend->pfnDecodeToColor(apnRun, cbRunEnd - cbOffset, ptPalette, ptPixels + (cbOffset * PIXELS_IN_BYTE));
+		}
+		else
+		{
+			// Fill the first group, and then keep doubling the filled part.
+			ptRun = ptPixels + (cbOffset * PIXELS_IN_BYTE);
+			nRunPixels = (cbRunEnd - cbOffset) * PIXELS_IN_BYTE;
+			for (nPixel = 0; nPixel < DECODE_GROUP_BYTES * PIXELS_IN_BYTE; ++nPixel)
+			{
+				ptRun[nPixel] = ptPalette[nValue];
+			}
+			for (; nPixel < nRunPixels; nPixel *= 2)
+			{
+				CopyMemory(ptRun + nPixel,
+						   ptRun,
+						   min(nPixel, nRunPixels - nPixel) * sizeof(ptRun[0]));
+			}
+		}
+	}
+
+lblCleanup:
+	return;
+}
+
+/**
+ * Finds the pixels of a plane byte position that differ
+ * from the background.
+ *
+ * @param[in]	ppnPlanes	Pointers into each plane.
+ * @param[in]	nOffset		Offset of the byte.
+ * @param[in]	nBackground	The background's pixel value.
+ *
+ * @returns BYTE, with a bit set for each differing pixel.
+ */
+STATIC
+FORCEINLINE
+BYTE
+vgadecode_GetByteContent(
+	_In_reads_(VGA_PLANES)	CONST BYTE * CONST *	ppnPlanes,
+	_In_					DWORD					nOffset,
+	_In_					BYTE					nBackground
+)
+{
+	DWORD	nPlane		= 0;
+	BYTE	nContent	= 0;
+
+	for (nPlane = 0; nPlane < VGA_PLANES; ++nPlane)
+	{
+		nContent |= ppnPlanes[nPlane][nOffset] ^ ((0 != (nBackground & (1 << nPlane))) ? MAXBYTE : 0);
+	}
+
+	return nContent;
+}
+
+/**
+ * Checks whether a group has any pixels
+ * that differ from the background.
+ *
+ * @param[in]	ppnPlanes	Pointers into each plane.
+ * @param[in]	cbOffset	Offset of the group.
+ * @param[in]	nBackground	The background's pixel value.
+ *
+ * @returns BOOL
+ */
+STATIC
+FORCEINLINE
+BOOL
+vgadecode_HasGroupContent(
+	_In_reads_(VGA_PLANES)	CONST BYTE * CONST *	ppnPlanes,
+	_In_					DWORD					cbOffset,
+	_In_					BYTE					nBackground
+)
+{
+	DWORD		nPlane		= 0;
+	ULONGLONG	nContent	= 0;
+
+	for (nPlane = 0; nPlane < VGA_PLANES; ++nPlane)
+	{
+		nContent |= *(UNALIGNED CONST ULONGLONG *)(ppnPlanes[nPlane] + cbOffset) ^
+					((0 != (nBackground & (1 << nPlane))) ? ~0ULL : 0);
+	}
+
+	return 0 != nContent;
+}
+
+/**
+ * Extends the bounding box of the non-background content
+ * with a row of the image.
+ * Background groups are skipped a quadword at a time,
+ * from both ends of the row.
+ *
+ * @param[in]		ppnPlanes	Pointers to the row in each plane.
+ * @param[in]		nRow		The row.
+ * @param[in]		nWidth		Width of the image, in pixels.
+ * @param[in]		nBackground	The background's pixel value.
+ * @param[in,out]	ptContent	The bounding box to extend.
+ */
+STATIC
+VOID
+vgadecode_AddRowContent(
+	_In_reads_(VGA_PLANES)	CONST BYTE * CONST *	ppnPlanes,
+	_In_					DWORD					nRow,
+	_In_					DWORD					nWidth,
+	_In_					BYTE					nBackground,
+	_Inout_					PRECT					ptContent
+)
+{
+	DWORD	cbRow			= (nWidth + PIXELS_IN_BYTE - 1) / PIXELS_IN_BYTE;
+	BYTE	nLastByteMask	= (BYTE)(0xFF << ((cbRow * PIXELS_IN_BYTE) - nWidth));
+	DWORD	nFirstByte		= 0;
+	DWORD	nEndByte		= cbRow;
+	BYTE	nContent		= 0;
+	LONG	nLeft			= 0;
+	LONG	nRight			= 0;
+
+	// Find the first byte with content.
+	while ((nFirstByte + DECODE_GROUP_BYTES <= cbRow) &&
+		   !vgadecode_HasGroupContent(ppnPlanes, nFirstByte, nBackground))
+	{
+		nFirstByte += DECODE_GROUP_BYTES;
+	}
+	for (; nFirstByte < cbRow; ++nFirstByte)
+	{
+		nContent = vgadecode_GetByteContent(ppnPlanes, nFirstByte, nBackground);
+		if (cbRow - 1 == nFirstByte)
+		{
+			// Pixels past the width aren't displayed.
+			nContent &= nLastByteMask;
+		}
+		if (0 != nContent)
+		{
+			break;
+		}
+	}
+	if (cbRow == nFirstByte)
+	{
+		goto lblCleanup;
+	}
+
+	// The leftmost pixel is in the MSB.
+	for (nLeft = nFirstByte * PIXELS_IN_BYTE; 0 == (nContent & 0x80); ++nLeft)
+	{
+		nContent <<= 1;
+	}
+
+	// Find the last byte with content. There is one, so this stops.
+	while ((nEndByte >= nFirstByte + DECODE_GROUP_BYTES) &&
+		   !vgadecode_HasGroupContent(ppnPlanes, nEndByte - DECODE_GROUP_BYTES, nBackground))
+	{
+		nEndByte -= DECODE_GROUP_BYTES;
+	}
+	for (; nEndByte > nFirstByte; --nEndByte)
+	{
+		nContent = vgadecode_GetByteContent(ppnPlanes, nEndByte - 1, nBackground);
+		if (cbRow == nEndByte)
+		{
+			nContent &= nLastByteMask;
+		}
+		if (0 != nContent)
+		{
+			break;
+		}
+	}
+	if (0 == nContent)
+	{
+		nContent = vgadecode_GetByteContent(ppnPlanes, nFirstByte, nBackground);
+		nEndByte = nFirstByte + 1;
+	}
+	for (nRight = nEndByte * PIXELS_IN_BYTE; 0 == (nContent & 0x01); --nRight)
+	{
+		nContent >>= 1;
+	}
+
+	// Rows come in order, so an empty box means this is the top row.
+	if (ptContent->bottom <= ptContent->top)
+	{
+		ptContent->left = nLeft;
+		ptContent->top = (LONG)nRow;
+		ptContent->right = nRight;
+	}
+	else
+	{
+		ptContent->left = min(ptContent->left, nLeft);
+		ptContent->right = max(ptContent->right, nRight);
+	}
+	ptContent->bottom = (LONG)nRow + 1;
+
+lblCleanup:
+	return;
+}
+
+/**
+ * Starts looking for the non-background content of an image.
+ * The background is the pixel value of the top-left pixel.
+ *
+ * @param[in]	ppnPlanes	Pointers to the first row of each plane.
+ * @param[out]	ptContent	The bounding box, which is emptied.
+ *
+ * @returns BYTE, the background's pixel value.
+ */
+STATIC
+FORCEINLINE
+BYTE
+vgadecode_StartContent(
+	_In_reads_(VGA_PLANES)	CONST BYTE * CONST *	ppnPlanes,
+	_Out_					PRECT					ptContent
+)
+{
+	ptContent->left = 0;
+	ptContent->top = 0;
+	ptContent->right = 0;
+	ptContent->bottom = 0;
+
+	return (BYTE)vgadecode_ScalarDecodeByte(ppnPlanes, 0);
+}
+
+/**
+ * Decodes an image, row by row unless the rows
+ * are contiguous in both the planes and the output.
+ * When inlined with a constant geometry, the checks
+ * and the row loop fold away.
+ *
+ * @see VGADECODE_DecodeImage
+ */
+STATIC
+FORCEINLINE
+VOID
+vgadecode_DecodeRows(
+	_In_reads_(VGA_PLANES)					CONST BYTE * CONST *	ppnPlanes,
+	_In_									DWORD					cbPlaneStride,
+	_In_									DWORD					nWidth,
+	_In_									DWORD					nHeight,
+	_Out_writes_(cbPixelStride * nHeight)	PBYTE					pnPixels,
+	_In_									DWORD					cbPixelStride,
+	_Out_opt_								PRECT					ptContent
+)
+{
+	DWORD			cbRow					= nWidth / PIXELS_IN_BYTE;
+	DWORD			nRemainder				= nWidth % PIXELS_IN_BYTE;
+	DWORD			nRow					= 0;
+	CONST BYTE *	apnRow[VGA_PLANES]		= { NULL };
+	ULONGLONG		nLastPixels				= 0;
+	BYTE			nBackground				= 0;
+
+	if (NULL != ptContent)
+	{
+		nBackground = vgadecode_StartContent(ppnPlanes, ptContent);
+	}
+	else if ((0 == nRemainder) &&
+			 (cbRow == cbPlaneStride) &&
+			 (nWidth == cbPixelStride))
+	{
+		VGADECODE_DecodeSpan(ppnPlanes, cbRow * nHeight, pnPixels);
+		goto lblCleanup;
+	}
+
+	for (nRow = 0; nRow < nHeight; ++nRow)
+	{
+		vgadecode_OffsetPlanes(ppnPlanes, nRow * cbPlaneStride, apnRow);
+		VGADECODE_DecodeSpan(apnRow, cbRow, pnPixels + (nRow * cbPixelStride));
+
+		// The last byte of the row is only partially displayed.
+		if (0 != nRemainder)
+		{
+			nLastPixels = vgadecode_ScalarDecodeByte(apnRow, cbRow);
+			CopyMemory(pnPixels + (nRow * cbPixelStride) + (cbRow * PIXELS_IN_BYTE),
+					   &nLastPixels,
+					   nRemainder);
+		}
+
+		// The row's plane bytes are still in the cache.
+		if (NULL != ptContent)
+		{
+			vgadecode_AddRowContent(apnRow, nRow, nWidth, nBackground, ptContent);
+		}
+	}
+
+lblCleanup:
+	return;
+}
+
+/**
+ * Decodes an image straight to true color, row by row
+ * unless the rows are contiguous in the planes.
+ *
+ * @see VGADECODE_DecodeImageToColor
+ * @see vgadecode_DecodeRows
+ */
+STATIC
+FORCEINLINE
+VOID
+vgadecode_DecodeRowsToColor(
+	_In_reads_(VGA_PLANES)					CONST BYTE * CONST *	ppnPlanes,
+	_In_									DWORD					cbPlaneStride,
+	_In_									DWORD					nWidth,
+	_In_									DWORD					nHeight,
+	_In_reads_(VGA_COLORS)					CONST RGBQUAD *			ptPalette,
+	_Out_writes_(nWidth * nHeight)			RGBQUAD *				ptPixels,
+	_Out_opt_								PRECT					ptContent
+)
+{
+	DWORD			cbRow					= nWidth / PIXELS_IN_BYTE;
+	DWORD			nRemainder				= nWidth % PIXELS_IN_BYTE;
+	DWORD			nRow					= 0;
+	DWORD			nPixel					= 0;
+	CONST BYTE *	apnRow[VGA_PLANES]		= { NULL };
+	ULONGLONG		nLastPixels				= 0;
+	RGBQUAD *		ptRowPixels				= NULL;
+	BYTE			nBackground				= 0;
+
+	if (NULL != ptContent)
+	{
+		nBackground = vgadecode_StartContent(ppnPlanes, ptContent);
+	}
+	else if ((0 == nRemainder) &&
+			 (cbRow == cbPlaneStride))
+	{
+		VGADECODE_DecodeSpanToColor(ppnPlanes, cbRow * nHeight, ptPalette, ptPixels);
+		goto lblCleanup;
+	}
+
+	for (nRow = 0; nRow < nHeight; ++nRow)
+	{
+		ptRowPixels = ptPixels + (nRow * nWidth);
+
+		vgadecode_OffsetPlanes(ppnPlanes, nRow * cbPlaneStride, apnRow);
+		VGADECODE_DecodeSpanToColor(apnRow, cbRow, ptPalette, ptRowPixels);
+
+		// The last byte of the row is only partially displayed.
+		if (0 != nRemainder)
+		{
+			nLastPixels = vgadecode_ScalarDecodeByte(apnRow, cbRow);
+			for (nPixel = 0; nPixel < nRemainder; ++nPixel)
+			{
+				ptRowPixels[(cbRow * PIXELS_IN_BYTE) + nPixel] = ptPalette[(BYTE)nLastPixels];
+				nLastPixels >>= 8;
+			}
+		}
+
+		if (NULL != ptContent)
+		{
+			vgadecode_AddRowContent(apnRow, nRow, nWidth, nBackground, ptContent);
+		}
+	}
+
+lblCleanup:
+	return;
+}
+
+/**
+ * Decodes a 640x480 image, such as the BSoD's mode 12h.
+ *
+ * @see FN_VGADECODE_IMAGE
+ */
+STATIC
+VOID
+vgadecode_DecodeImage640x480(
+	_In_reads_(VGA_PLANES)					CONST BYTE * CONST *	ppnPlanes,
+	_In_									DWORD					cbPlaneStride,
+	_In_									DWORD					nWidth,
+	_In_									DWORD					nHeight,
+	_Out_writes_(cbPixelStride * nHeight)	PBYTE					pnPixels,
+	_In_									DWORD					cbPixelStride,
+	_Out_opt_								PRECT					ptContent
+)
+{
+	UNREFERENCED_PARAMETER(cbPlaneStride);
+	UNREFERENCED_PARAMETER(nWidth);
+	UNREFERENCED_PARAMETER(nHeight);
+	UNREFERENCED_PARAMETER(cbPixelStride);
+
+	vgadecode_DecodeRows(ppnPlanes, 640 / PIXELS_IN_BYTE, 640, 480, pnPixels, 640, ptContent);
+}
+
+/**
+ * Decodes an 800x600 image.
+ *
+ * @see FN_VGADECODE_IMAGE
+ */
+STATIC
+VOID
+vgadecode_DecodeImage800x600(
+	_In_reads_(VGA_PLANES)					CONST BYTE * CONST *	ppnPlanes,
+	_In_									DWORD					cbPlaneStride,
+	_In_									DWORD					nWidth,
+	_In_									DWORD					nHeight,
+	_Out_writes_(cbPixelStride * nHeight)	PBYTE					pnPixels,
+	_In_									DWORD					cbPixelStride,
+	_Out_opt_								PRECT					ptContent
+)
+{
+	UNREFERENCED_PARAMETER(cbPlaneStride);
+	UNREFERENCED_PARAMETER(nWidth);
+	UNREFERENCED_PARAMETER(nHeight);
+	UNREFERENCED_PARAMETER(cbPixelStride);
+
+	vgadecode_DecodeRows(ppnPlanes, 800 / PIXELS_IN_BYTE, 800, 600, pnPixels, 800, ptContent);
+}
+
+/**
+ * Decodes a 640x480 image straight to true color.
+ *
+ * @see FN_VGADECODE_IMAGE_TO_COLOR
+ */
+STATIC
+VOID
+vgadecode_DecodeImageToColor640x480(
+	_In_reads_(VGA_PLANES)					CONST BYTE * CONST *	ppnPlanes,
+	_In_									DWORD					cbPlaneStride,
+	_In_									DWORD					nWidth,
+	_In_									DWORD					nHeight,
+	_In_reads_(VGA_COLORS)					CONST RGBQUAD *			ptPalette,
+	_Out_writes_(nWidth * nHeight)			RGBQUAD *				ptPixels,
+	_Out_opt_								PRECT					ptContent
+)
+{
+	UNREFERENCED_PARAMETER(cbPlaneStride);
+	UNREFERENCED_PARAMETER(nWidth);
+	UNREFERENCED_PARAMETER(nHeight);
+
+	vgadecode_DecodeRowsToColor(ppnPlanes, 640 / PIXELS_IN_BYTE, 640, 480, ptPalette, ptPixels, ptContent);
+}
+
+/**
+ * Decodes an 800x600 image straight to true color.
+ *
+ * @see FN_VGADECODE_IMAGE_TO_COLOR
+ */
+STATIC
+VOID
+vgadecode_DecodeImageToColor800x600(
+	_In_reads_(VGA_PLANES)					CONST BYTE * CONST *	ppnPlanes,
+	_In_									DWORD					cbPlaneStride,
+	_In_									DWORD					nWidth,
+	_In_									DWORD					nHeight,
+	_In_reads_(VGA_COLORS)					CONST RGBQUAD *			ptPalette,
+	_Out_writes_(nWidth * nHeight)			RGBQUAD *				ptPixels,
+	_Out_opt_								PRECT					ptContent
+)
+{
+	UNREFERENCED_PARAMETER(cbPlaneStride);
+	UNREFERENCED_PARAMETER(nWidth);
+	UNREFERENCED_PARAMETER(nHeight);
+
+	vgadecode_DecodeRowsToColor(ppnPlanes, 800 / PIXELS_IN_BYTE, 800, 600, ptPalette, ptPixels, ptContent);
+}
+
+/**
+ * Looks up the specialized decoders for a geometry.
+ *
+ * @param[in]	cbPlaneStride	Distance between rows in each plane, in bytes.
+ * @param[in]	nWidth			Width of the image, in pixels.
+ * @param[in]	nHeight			Height of the image, in pixels.
+ *
+ * @returns PCVGADECODE_GEOMETRY, or NULL if there are none.
+ */
+STATIC
+PCVGADECODE_GEOMETRY
+vgadecode_FindGeometry(
+	_In_	DWORD	cbPlaneStride,
+	_In_	DWORD	nWidth,
+	_In_	DWORD	nHeight
+)
+{
+	PCVGADECODE_GEOMETRY	ptGeometry	= NULL;
+	DWORD					nIndex		= 0;
+
+	for (nIndex = 0; nIndex < ARRAYSIZE(g_atGeometries); ++nIndex)
+	{
+		if ((g_atGeometries[nIndex].nWidth == nWidth) &&
+			(g_atGeometries[nIndex].nHeight == nHeight) &&
+			(g_atGeometries[nIndex].cbPlaneStride == cbPlaneStride))
+		{
+			ptGeometry = &(g_atGeometries[nIndex]);
+			break;
+		}
+	}
+
+	return ptGeometry;
+}
+
+VOID
+VGADECODE_DecodeSpan(
+	_In_reads_(VGA_PLANES)					CONST BYTE * CONST *	ppnPlanes,
+	_In_									DWORD					cbSpan,
+	_Out_writes_(cbSpan * PIXELS_IN_BYTE)	PBYTE					pnPixels
+)
+{
+	DWORD			cbBulk					= cbSpan - (cbSpan % DECODE_GROUP_BYTES);
+	CONST BYTE *	apnTail[VGA_PLANES]		= { NULL };
+
+	assert(NULL != ppnPlanes);
+	assert(NULL != pnPixels);
+
+	vgadecode_DecodeGroups(ppnPlanes, cbBulk, pnPixels);
+
+	// Whatever is left over is not a whole group.
+	if (cbBulk != cbSpan)
+	{
+		vgadecode_OffsetPlanes(ppnPlanes, cbBulk, apnTail);
+		vgadecode_DecodeScalar(apnTail,
+							   cbSpan - cbBulk,
+							   pnPixels + (cbBulk * PIXELS_IN_BYTE));
+	}
+}
+
+VOID
+VGADECODE_DecodeSpanToColor(
+	_In_reads_(VGA_PLANES)					CONST BYTE * CONST *	ppnPlanes,
+	_In_									DWORD					cbSpan,
+	_In_reads_(VGA_COLORS)					CONST RGBQUAD *			ptPalette,
+	_Out_writes_(cbSpan * PIXELS_IN_BYTE)	RGBQUAD *				ptPixels
+)
+{
+	DWORD			cbBulk					= cbSpan - (cbSpan % DECODE_GROUP_BYTES);
+	CONST BYTE *	apnTail[VGA_PLANES]		= { NULL };
+
+	assert(NULL != ppnPlanes);
+	assert(NULL != ptPalette);
+	assert(NULL != ptPixels);
+
+	vgadecode_DecodeGroupsToColor(ppnPlanes, cbBulk, ptPalette, ptPixels);
+
+	// Whatever is left over is not a whole group.
+	if (cbBulk != cbSpan)
+	{
+		vgadecode_OffsetPlanes(ppnPlanes, cbBulk, apnTail);
+		vgadecode_DecodeToColorScalar(apnTail,
+									  cbSpan - cbBulk,
+									  ptPalette,
+									  ptPixels + (cbBulk * PIXELS_IN_BYTE));
+	}
+}
+
+PCSTR
+VGADECODE_GetBackendName(VOID)
+{
+	return vgadecode_GetBackend()->pszName;
+}
+
+HRESULT
+VGADECODE_SelectBackend(
+	_In_	DWORD	nBackend
+)
+{
+	HRESULT	hrResult	= E_FAIL;
+
+	if (VGADECODE_BACKEND_DEFAULT == nBackend)
+	{
+		// Selected again on the next use.
+		g_ptSelectedBackend = NULL;
+		hrResult = S_OK;
+		goto lblCleanup;
+	}
+
+	if (ARRAYSIZE(g_atBackends) <= nBackend)
+	{
+		hrResult = HRESULT_FROM_WIN32(ERROR_NO_MORE_ITEMS);
+		goto lblCleanup;
+	}
+
+	if (!g_atBackends[nBackend].pfnIsSupported())
+	{
+		hrResult = HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+		goto lblCleanup;
+	}
+
+	g_ptSelectedBackend = &(g_atBackends[nBackend]);
+
+	hrResult = S_OK;
+
+lblCleanup:
+	return hrResult;
+}
+
+VOID
+VGADECODE_DecodeImage(
+	_In_reads_(VGA_PLANES)					CONST BYTE * CONST *	ppnPlanes,
+	_In_									DWORD					cbPlaneStride,
+	_In_									DWORD					nWidth,
+	_In_									DWORD					nHeight,
+	_Out_writes_(cbPixelStride * nHeight)	PBYTE					pnPixels,
+	_In_									DWORD					cbPixelStride,
+	_Out_opt_								PRECT					ptContent
+)
+{
+	PCVGADECODE_GEOMETRY	ptGeometry	= NULL;
+
+	assert(NULL != ppnPlanes);
+	assert(NULL != pnPixels);
+	assert(nWidth <= cbPlaneStride * PIXELS_IN_BYTE);
+	assert(nWidth <= cbPixelStride);
+
+	ptGeometry = vgadecode_FindGeometry(cbPlaneStride, nWidth, nHeight);
+	if ((NULL != ptGeometry) &&
+		(nWidth == cbPixelStride))
+	{
+		ptGeometry->pfnDecodeImage(ppnPlanes, cbPlaneStride, nWidth, nHeight, pnPixels, cbPixelStride, ptContent);
+	}
+	else
+	{
+		vgadecode_DecodeRows(ppnPlanes, cbPlaneStride, nWidth, nHeight, pnPixels, cbPixelStride, ptContent);
+	}
+}
+
+VOID
+VGADECODE_DecodeImageToColor(
+	_In_reads_(VGA_PLANES)					CONST BYTE * CONST *	ppnPlanes,
+	_In_									DWORD					cbPlaneStride,
+	_In_									DWORD					nWidth,
+	_In_									DWORD					nHeight,
+	_In_reads_(VGA_COLORS)					CONST RGBQUAD *			ptPalette,
+	_Out_writes_(nWidth * nHeight)			RGBQUAD *				ptPixels,
+	_Out_opt_								PRECT					ptContent
+)
+{
+	PCVGADECODE_GEOMETRY	ptGeometry	= NULL;
+
+	assert(NULL != ppnPlanes);
+	assert(NULL != ptPalette);
+	assert(NULL != ptPixels);
+	assert(nWidth <= cbPlaneStride * PIXELS_IN_BYTE);
+
+	ptGeometry = vgadecode_FindGeometry(cbPlaneStride, nWidth, nHeight);
+	if (NULL != ptGeometry)
+	{
+		ptGeometry->pfnDecodeImageToColor(ppnPlanes, cbPlaneStride, nWidth, nHeight, ptPalette, ptPixels, ptContent);
+	}
+	else
+	{
+		vgadecode_DecodeRowsToColor(ppnPlanes, cbPlaneStride, nWidth, nHeight, ptPalette, ptPixels, ptContent);
+	}
+}
+
+VOID
+VGADECODE_DecodeImageToNibbles(
+	_In_reads_(VGA_PLANES)					CONST BYTE * CONST *	ppnPlanes,
+	_In_									DWORD					cbPlaneStride,
+	_In_									DWORD					nWidth,
+	_In_									DWORD					nHeight,
+	_Out_writes_(cbPixelStride * nHeight)	PBYTE					pnPixels,
+	_In_									DWORD					cbPixelStride
+)
+{
+	PCVGADECODE_BACKEND	ptBackend				= vgadecode_GetBackend();
+	DWORD				cbRow					= (nWidth / PIXELS_IN_BYTE) + ((0 != nWidth % PIXELS_IN_BYTE) ? 1 : 0);
+	DWORD				cbBulk					= cbRow - (cbRow % DECODE_GROUP_BYTES);
+	DWORD				nRemainder				= nWidth % PIXELS_IN_BYTE;
+	DWORD				nRow					= 0;
+	CONST BYTE *		apnRow[VGA_PLANES]		= { NULL };
+	CONST BYTE *		apnTail[VGA_PLANES]		= { NULL };
+	PBYTE				pnRowPixels				= NULL;
+
+	assert(NULL != ppnPlanes);
+	assert(NULL != pnPixels);
+	assert(nWidth <= cbPlaneStride * PIXELS_IN_BYTE);
+	assert(cbRow * sizeof(DWORD) <= cbPixelStride);
+
+	// Each byte of the planes makes a DWORD of nibbles,
+	// which is also how 4bpp BMPs pad their rows.
+	C_ASSERT(sizeof(DWORD) == PIXELS_IN_BYTE / 2);
+
+	// When the rows are whole groups with no padding on either side,
+	// the image is one long span.
+	if ((0 == nRemainder) &&
+		(cbBulk == cbRow) &&
+		(cbPlaneStride == cbRow) &&
+		(cbPixelStride == cbRow * sizeof(DWORD)))
+	{
+		ptBackend->pfnDecodeToNibbles(ppnPlanes, cbRow * nHeight, pnPixels);
+		goto lblCleanup;
+	}
+
+	for (nRow = 0; nRow < nHeight; ++nRow)
+	{
+		vgadecode_OffsetPlanes(ppnPlanes, nRow * cbPlaneStride, apnRow);
+		pnRowPixels = pnPixels + (nRow * cbPixelStride);
+
+		ptBackend->pfnDecodeToNibbles(apnRow, cbBulk, pnRowPixels);
+
+		// Whatever is left over is not a whole group.
+		if (cbBulk != cbRow)
+		{
+			vgadecode_OffsetPlanes(apnRow, cbBulk, apnTail);
+			vgadecode_DecodeToNibblesScalar(apnTail,
+											cbRow - cbBulk,
+											pnRowPixels + (cbBulk * sizeof(DWORD)));
+		}
+
+		// The bits past the width aren't pixels.
+		if (0 != nRemainder)
+		{
+			*(UNALIGNED DWORD *)(pnRowPixels + ((cbRow - 1) * sizeof(DWORD))) &=
+				g_anGlyphNibbleMasks[(BYTE)(MAXBYTE << (PIXELS_IN_BYTE - nRemainder))];
+		}
+	}
+
+lblCleanup:
+	return;
+}
+
+VOID
+VGADECODE_DecodeImageReference(
+	_In_reads_(VGA_PLANES)					CONST BYTE * CONST *	ppnPlanes,
+	_In_									DWORD					cbPlaneStride,
+	_In_									DWORD					nWidth,
+	_In_									DWORD					nHeight,
+	_Out_writes_(cbPixelStride * nHeight)	PBYTE					pnPixels,
+	_In_									DWORD					cbPixelStride
+)
+{
+	DWORD	nRow			= 0;
+	DWORD	nCurrentPixel	= 0;
+	DWORD	nCurrentPlane	= 0;
+	BYTE	nPixel			= 0;
+
+	assert(NULL != ppnPlanes);
+	assert(NULL != pnPixels);
+	assert(nWidth <= cbPlaneStride * PIXELS_IN_BYTE);
+	assert(nWidth <= cbPixelStride);
+
+	for (nRow = 0; nRow < nHeight; ++nRow)
+	{
+		for (nCurrentPixel = 0; nCurrentPixel < nWidth; ++nCurrentPixel)
+		{
+			nPixel = 0;
+			for (nCurrentPlane = 0; nCurrentPlane < VGA_PLANES; ++nCurrentPlane)
+			{
+				nPixel |= vgadecode_GetPixelBitFromPlane(ppnPlanes[nCurrentPlane] + (nRow * cbPlaneStride),
+														 nCurrentPixel) << nCurrentPlane;
+			}
+			pnPixels[(nRow * cbPixelStride) + nCurrentPixel] = nPixel;
+		}
+	}
+}
+
+/**
+ * Retrieves the foreground and background pixel values
+ * of a text mode character.
+ *
+ * @param[in]	ptScreen		The screen the character is on.
+ * @param[in]	nAttribute		The character's attribute.
+ * @param[out]	pnForeground	Will receive the foreground pixel value.
+ * @param[out]	pnBackground	Will receive the background pixel value.
+ */
+STATIC
+FORCEINLINE
+VOID
+vgadecode_GetTextColors(
+	_In_	PCVGA_TEXT_SCREEN	ptScreen,
+	_In_	BYTE				nAttribute,
+	_Out_	PBYTE				pnForeground,
+	_Out_	PBYTE				pnBackground
+)
+{
+	*pnForeground = nAttribute & 0x0F;
+	*pnBackground = (nAttribute >> 4) & (ptScreen->bBlinkEnabled ? 0x07 : 0x0F);
+}
+
+VOID
+VGADECODE_RenderText(
+	_In_		PCVGA_TEXT_SCREEN	ptScreen,
+	_Out_		PBYTE				pnPixels,
+	_In_		DWORD				cbPixelStride
+)
+{
+	DWORD			nRow			= 0;
+	DWORD			nLine			= 0;
+	DWORD			nColumn			= 0;
+	CONST BYTE *	pnCell			= NULL;
+	PBYTE			pnLinePixels	= NULL;
+	BYTE			nForeground		= 0;
+	BYTE			nBackground		= 0;
+	ULONGLONG		nMask			= 0;
+
+	assert(NULL != ptScreen);
+	assert(NULL != pnPixels);
+	assert(ptScreen->nColumns * PIXELS_IN_BYTE <= cbPixelStride);
+
+	// Go over the output in order, one scan line
+	// of a row of characters at a time.
+	for (nRow = 0; nRow < ptScreen->nRows; ++nRow)
+	{
+		for (nLine = 0; nLine < ptScreen->nCharHeight; ++nLine)
+		{
+			pnCell = ptScreen->pnText + (nRow * ptScreen->nColumns * VGA_TEXT_CELL_BYTES);
+			pnLinePixels = pnPixels + (((nRow * ptScreen->nCharHeight) + nLine) * cbPixelStride);
+
+			for (nColumn = 0; nColumn < ptScreen->nColumns; ++nColumn)
+			{
+				vgadecode_GetTextColors(ptScreen, pnCell[1], &nForeground, &nBackground);
+				nMask = g_anGlyphRowMasks[ptScreen->pnFont[(pnCell[0] * ptScreen->nCharHeight) + nLine]];
+
+				*(UNALIGNED ULONGLONG *)(pnLinePixels + (nColumn * PIXELS_IN_BYTE)) =
+					(BROADCAST_PIXEL(nForeground) & nMask) |
+					(BROADCAST_PIXEL(nBackground) & (~nMask));
+
+				pnCell += VGA_TEXT_CELL_BYTES;
+			}
+		}
+	}
+}
+
+VOID
+VGADECODE_RenderTextToNibbles(
+	_In_		PCVGA_TEXT_SCREEN	ptScreen,
+	_Out_		PBYTE				pnPixels,
+	_In_		DWORD				cbPixelStride
+)
+{
+	DWORD				nRow			= 0;
+	DWORD				nLine			= 0;
+	DWORD				nColumn			= 0;
+	CONST BYTE *		pnCell			= NULL;
+	UNALIGNED DWORD *	pnLinePixels	= NULL;
+	BYTE				nForeground		= 0;
+	BYTE				nBackground		= 0;
+	DWORD				nMask			= 0;
+
+	assert(NULL != ptScreen);
+	assert(NULL != pnPixels);
+	assert(ptScreen->nColumns * sizeof(DWORD) <= cbPixelStride);
+
+	for (nRow = 0; nRow < ptScreen->nRows; ++nRow)
+	{
+		for (nLine = 0; nLine < ptScreen->nCharHeight; ++nLine)
+		{
+			pnCell = ptScreen->pnText + (nRow * ptScreen->nColumns * VGA_TEXT_CELL_BYTES);
+			pnLinePixels = (UNALIGNED DWORD *)(pnPixels + (((nRow * ptScreen->nCharHeight) + nLine) * cbPixelStride));
+
+			for (nColumn = 0; nColumn < ptScreen->nColumns; ++nColumn)
+			{
+				vgadecode_GetTextColors(ptScreen, pnCell[1], &nForeground, &nBackground);
+				nMask = g_anGlyphNibbleMasks[ptScreen->pnFont[(pnCell[0] * ptScreen->nCharHeight) + nLine]];
+
+				pnLinePixels[nColumn] = (BROADCAST_NIBBLE(nForeground) & nMask) |
+										(BROADCAST_NIBBLE(nBackground) & (~nMask));
+
+				pnCell += VGA_TEXT_CELL_BYTES;
+			}
+		}
+	}
+}
+
+VOID
+VGADECODE_RenderTextToColor(
+	_In_					PCVGA_TEXT_SCREEN	ptScreen,
+	_In_reads_(VGA_COLORS)	CONST RGBQUAD *		ptPalette,
+	_Out_					RGBQUAD *			ptPixels
+)
+{
+	DWORD			nRow			= 0;
+	DWORD			nLine			= 0;
+	DWORD			nColumn			= 0;
+	DWORD			nPixel			= 0;
+	CONST BYTE *	pnCell			= NULL;
+	BYTE			nForeground		= 0;
+	BYTE			nBackground		= 0;
+	BYTE			nGlyphRow		= 0;
+
+	assert(NULL != ptScreen);
+	assert(NULL != ptPalette);
+	assert(NULL != ptPixels);
+
+	for (nRow = 0; nRow < ptScreen->nRows; ++nRow)
+	{
+		for (nLine = 0; nLine < ptScreen->nCharHeight; ++nLine)
+		{
+			pnCell = ptScreen->pnText + (nRow * ptScreen->nColumns * VGA_TEXT_CELL_BYTES);
+
+			for (nColumn = 0; nColumn < ptScreen->nColumns; ++nColumn)
+			{
+				vgadecode_GetTextColors(ptScreen, pnCell[1], &nForeground, &nBackground);
+				nGlyphRow = ptScreen->pnFont[(pnCell[0] * ptScreen->nCharHeight) + nLine];
+
+				for (nPixel = 0; nPixel < PIXELS_IN_BYTE; ++nPixel)
+				{
+					*ptPixels++ = ptPalette[(0 != (nGlyphRow & (0x80 >> nPixel))) ? nForeground : nBackground];
+				}
+
+				pnCell += VGA_TEXT_CELL_BYTES;
+			}
+		}
+	}
+}
@@ -0,0 +1,283 @@
+/**
+ * @file VgaDecode.h
+ * @author biko
+ * @date 2026-10-17
+ *
+ * VgaDecode module public header.
+ * Contains routines for converting planar VGA video memory
+ * and text mode screens into indexed or true color pixels.
+ */
+#pragma once
+
+/** Headers *************************************************************/
+#include <Windows.h>
+
+#include <Drink.h>
+
+
+/** Constants ***********************************************************/
+
+/**
+ * Passed to VGADECODE_SelectBackend to go back to
+ * the implementation selected for the current CPU.
+ */
+#define VGADECODE_BACKEND_DEFAULT ((DWORD)-1)
+
+
+/** Typedefs ************************************************************/
+
+/**
+ * Describes a text mode screen.
+ */
+typedef struct _VGA_TEXT_SCREEN
+{
+	// Character/attribute pairs, row by row, with no padding.
+	CONST BYTE *	pnText;
+
+	// Dimensions of the screen, in characters.
+	DWORD			nColumns;
+	DWORD			nRows;
+
+	// The font, VGA_FONT_GLYPHS glyphs of nCharHeight bytes each.
+	// Each byte is a scan line, with the leftmost pixel in the MSB.
+	CONST BYTE *	pnFont;
+	DWORD			nCharHeight;
+
+	// Whether the top bit of an attribute means blinking,
+	// rather than being part of the background color.
+	BOOL			bBlinkEnabled;
+} VGA_TEXT_SCREEN, *PVGA_TEXT_SCREEN;
+typedef CONST VGA_TEXT_SCREEN *PCVGA_TEXT_SCREEN;
+
+
+/** Functions ***********************************************************/
+
+/**
+ * Decodes a span of planar VGA memory into indexed pixels.
+ * Each byte of each plane yields 8 pixels, MSB first,
+ * with plane N providing bit N of the pixel's index.
+ *
+ * @param[in]	ppnPlanes	Pointers to the first byte to decode
+ *							in each of the VGA's planes.
+ * @param[in]	cbSpan		Number of bytes to decode from each plane.
+ * @param[out]	pnPixels	Will receive the indexed pixels.
+ *
+ * @remark	The fastest implementation supported by the CPU
+ *			is selected on first use.
+ */
+VOID
+VGADECODE_DecodeSpan(
+	_In_reads_(VGA_PLANES)					CONST BYTE * CONST *	ppnPlanes,
+	_In_									DWORD					cbSpan,
+	_Out_writes_(cbSpan * PIXELS_IN_BYTE)	PBYTE					pnPixels
+);
+
+/**
+ * Decodes a span of planar VGA memory straight into
+ * true color pixels, without an intermediate indexed buffer.
+ *
+ * @param[in]	ppnPlanes	Pointers to the first byte to decode
+ *							in each of the VGA's planes.
+ * @param[in]	cbSpan		Number of bytes to decode from each plane.
+ * @param[in]	ptPalette	The colors of the VGA_COLORS pixel values.
+ * @param[out]	ptPixels	Will receive the colored pixels.
+ *
+ * @see VGADECODE_DecodeSpan
+ */
+VOID
+VGADECODE_DecodeSpanToColor(
+	_In_reads_(VGA_PLANES)					CONST BYTE * CONST *	ppnPlanes,
+	_In_									DWORD					cbSpan,
+	_In_reads_(VGA_COLORS)					CONST RGBQUAD *			ptPalette,
+	_Out_writes_(cbSpan * PIXELS_IN_BYTE)	RGBQUAD *				ptPixels
+);
+
+/**
+ * Decodes a whole image of planar VGA memory into indexed pixels.
+ * Common geometries are handled by specialized decoders.
+ *
+ * @param[in]	ppnPlanes		Pointers to the first row of each plane.
+ * @param[in]	cbPlaneStride	Distance between rows in each plane, in bytes.
+ * @param[in]	nWidth			Width of the image, in pixels.
+ * @param[in]	nHeight			Height of the image, in pixels.
+ * @param[out]	pnPixels		Will receive the indexed pixels, top row first.
+ * @param[in]	cbPixelStride	Distance between rows in the output, in bytes.
+ * @param[out]	ptContent		Optionally receives the bounding box of the pixels
+ *								that differ from the top-left one, which is
+ *								taken to be the background. Empty if there
+ *								are none.
+ *
+ * @see VGADECODE_DecodeSpan
+ * @remark	Unless the CPU can decode as fast as it stores the pixels,
+ *			runs of solid color (most of a BSoD) are filled
+ *			without decoding them bit by bit.
+ */
+VOID
+VGADECODE_DecodeImage(
+	_In_reads_(VGA_PLANES)					CONST BYTE * CONST *	ppnPlanes,
+	_In_									DWORD					cbPlaneStride,
+	_In_									DWORD					nWidth,
+	_In_									DWORD					nHeight,
+	_Out_writes_(cbPixelStride * nHeight)	PBYTE					pnPixels,
+	_In_									DWORD					cbPixelStride,
+	_Out_opt_								PRECT					ptContent
+);
+
+/**
+ * Decodes a whole image of planar VGA memory straight
+ * into true color pixels.
+ *
+ * @param[in]	ppnPlanes		Pointers to the first row of each plane.
+ * @param[in]	cbPlaneStride	Distance between rows in each plane, in bytes.
+ * @param[in]	nWidth			Width of the image, in pixels.
+ * @param[in]	nHeight			Height of the image, in pixels.
+ * @param[in]	ptPalette		The colors of the VGA_COLORS pixel values.
+ * @param[out]	ptPixels		Will receive the colored pixels, top row first,
+ *								with no padding between rows.
+ * @param[out]	ptContent		Optionally receives the bounding box of the pixels
+ *								that differ from the top-left one.
+ *
+ * @see VGADECODE_DecodeImage
+ */
+VOID
+VGADECODE_DecodeImageToColor(
+	_In_reads_(VGA_PLANES)					CONST BYTE * CONST *	ppnPlanes,
+	_In_									DWORD					cbPlaneStride,
+	_In_									DWORD					nWidth,
+	_In_									DWORD					nHeight,
+	_In_reads_(VGA_COLORS)					CONST RGBQUAD *			ptPalette,
+	_Out_writes_(nWidth * nHeight)			RGBQUAD *				ptPixels,
+	_Out_opt_								PRECT					ptContent
+);
+
+/**
+ * Decodes a whole image of planar VGA memory into indexed pixels
+ * packed two to a byte, as in a 4bpp BMP: the leftmost pixel
+ * of each pair is in the high nibble.
+ *
+ * @param[in]	ppnPlanes		Pointers to the first row of each plane.
+ * @param[in]	cbPlaneStride	Distance between rows in each plane, in bytes.
+ * @param[in]	nWidth			Width of the image, in pixels.
+ * @param[in]	nHeight			Height of the image, in pixels.
+ * @param[out]	pnPixels		Will receive the packed pixels, top row first.
+ * @param[in]	cbPixelStride	Distance between rows in the output, in bytes.
+ *								Must have room for a DWORD per 8 pixels,
+ *								rounded up.
+ *
+ * @remark	The nibbles past the width in the last DWORD
+ *			of each row are cleared.
+ *
+ * @see VGADECODE_DecodeImage
+ */
+VOID
+VGADECODE_DecodeImageToNibbles(
+	_In_reads_(VGA_PLANES)					CONST BYTE * CONST *	ppnPlanes,
+	_In_									DWORD					cbPlaneStride,
+	_In_									DWORD					nWidth,
+	_In_									DWORD					nHeight,
+	_Out_writes_(cbPixelStride * nHeight)	PBYTE					pnPixels,
+	_In_									DWORD					cbPixelStride
+);
+
+/**
+ * Decodes a whole image of planar VGA memory into indexed pixels
+ * one pixel and one plane at a time, the way captures were first
+ * converted. It shares nothing with the other decoders, which are
+ * checked against it, and is far too slow for anything else.
+ *
+ * @param[in]	ppnPlanes		Pointers to the first row of each plane.
+ * @param[in]	cbPlaneStride	Distance between rows in each plane, in bytes.
+ * @param[in]	nWidth			Width of the image, in pixels.
+ * @param[in]	nHeight			Height of the image, in pixels.
+ * @param[out]	pnPixels		Will receive the indexed pixels, top row first.
+ * @param[in]	cbPixelStride	Distance between rows in the output, in bytes.
+ *
+ * @see VGADECODE_DecodeImage
+ */
+VOID
+VGADECODE_DecodeImageReference(
+	_In_reads_(VGA_PLANES)					CONST BYTE * CONST *	ppnPlanes,
+	_In_									DWORD					cbPlaneStride,
+	_In_									DWORD					nWidth,
+	_In_									DWORD					nHeight,
+	_Out_writes_(cbPixelStride * nHeight)	PBYTE					pnPixels,
+	_In_									DWORD					cbPixelStride
+);
+
+/**
+ * Draws a text mode screen as indexed pixels.
+ * Each character is 8 pixels wide and nCharHeight pixels tall.
+ * Blinking characters are drawn as visible.
+ *
+ * @param[in]	ptScreen		The screen to draw.
+ * @param[out]	pnPixels		Will receive the indexed pixels, top row first.
+ * @param[in]	cbPixelStride	Distance between rows in the output, in bytes.
+ */
+VOID
+VGADECODE_RenderText(
+	_In_		PCVGA_TEXT_SCREEN	ptScreen,
+	_Out_		PBYTE				pnPixels,
+	_In_		DWORD				cbPixelStride
+);
+
+/**
+ * Draws a text mode screen as indexed pixels
+ * packed two to a byte.
+ *
+ * @param[in]	ptScreen		The screen to draw.
+ * @param[out]	pnPixels		Will receive the packed pixels, top row first.
+ * @param[in]	cbPixelStride	Distance between rows in the output, in bytes.
+ *
+ * @see VGADECODE_RenderText
+ * @see VGADECODE_DecodeImageToNibbles
+ */
+VOID
+VGADECODE_RenderTextToNibbles(
+	_In_		PCVGA_TEXT_SCREEN	ptScreen,
+	_Out_		PBYTE				pnPixels,
+	_In_		DWORD				cbPixelStride
+);
+
+/**
+ * Draws a text mode screen as true color pixels.
+ *
+ * @param[in]	ptScreen	The screen to draw.
+ * @param[in]	ptPalette	The colors of the VGA_COLORS pixel values.
+ * @param[out]	ptPixels	Will receive the colored pixels, top row first,
+ *							with no padding between rows.
+ *
+ * @see VGADECODE_RenderText
+ */
+VOID
+VGADECODE_RenderTextToColor(
+	_In_					PCVGA_TEXT_SCREEN	ptScreen,
+	_In_reads_(VGA_COLORS)	CONST RGBQUAD *		ptPalette,
+	_Out_					RGBQUAD *			ptPixels
+);
+
+/**
+ * Retrieves the name of the decoder implementation
+ * selected for the current CPU.
+ *
+ * @returns PCSTR
+ */
+PCSTR
+VGADECODE_GetBackendName(VOID);
+
+/**
+ * Forces the decoder implementation used from now on,
+ * so that each of them can be tested and timed.
+ *
+ * @param[in]	nBackend	Index of the implementation, from 0 for the most
+ *							preferred one, or VGADECODE_BACKEND_DEFAULT.
+ *
+ * @returns HRESULT
+ *
+ * @remark	Fails with ERROR_NO_MORE_ITEMS past the last implementation,
+ *			and with ERROR_NOT_SUPPORTED if the CPU can't run it.
+ * @remark	Must not be called while other threads are decoding.
+ */
+HRESULT
+VGADECODE_SelectBackend(
+	_In_	DWORD	nBackend
+);
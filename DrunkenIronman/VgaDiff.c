@@ -0,0 +1,675 @@
+/**
+ * @file VgaDiff.c
+ * @author biko
+ * @date 2026-10-17
+ *
+ * VgaDiff module implementation.
+ */
+
+/** Headers *************************************************************/
+#include <Windows.h>
+#include <intsafe.h>
+
+#include <assert.h>
+#include <string.h>
+
+#include <Drink.h>
+
+#include "Util.h"
+#include "Debug.h"
+
+#include "VgaDiff.h"
+
+
+/** Constants ***********************************************************/
+
+/**
+ * Marks cells without changes in the region tree.
+ */
+#define NO_CHANGES (MAXDWORD)
+
+/**
+ * Unchanged pixels are faded by mixing them
+ * with FADE_GRAY, FADE_WEIGHT parts to one.
+ */
+#define FADE_GRAY (0xC0)
+#define FADE_WEIGHT (3)
+
+/**
+ * Color of the outlines around regions.
+ */
+#define OUTLINE_RED (0xFF)
+#define OUTLINE_GREEN (0x00)
+#define OUTLINE_BLUE (0x00)
+
+
+/** Functions ***********************************************************/
+
+/**
+ * Counts the set bits in a quadword.
+ *
+ * @param[in]	nValue	The quadword.
+ *
+ * @returns DWORD
+ */
+STATIC
+FORCEINLINE
+DWORD
+vgadiff_CountBits(
+	_In_	ULONGLONG	nValue
+)
+{
+	nValue = nValue - ((nValue >> 1) & 0x5555555555555555ULL);
+	nValue = (nValue & 0x3333333333333333ULL) + ((nValue >> 2) & 0x3333333333333333ULL);
+	nValue = (nValue + (nValue >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+
+	return (DWORD)((nValue * 0x0101010101010101ULL) >> 56);
+}
+
+/**
+ * Compares a row of two graphics mode screens.
+ *
+ * @param[in]	ppnFirst	The row in each plane of the first screen.
+ * @param[in]	ppnSecond	The row in each plane of the second screen.
+ * @param[in]	cbRow		Size of the row in each plane, in bytes.
+ * @param[out]	pnMask		Will receive the row of the mask.
+ *
+ * @returns DWORD	The number of bits set in the mask.
+ */
+STATIC
+DWORD
+vgadiff_CompareRow(
+	_In_reads_(VGA_PLANES)	CONST BYTE * CONST *	ppnFirst,
+	_In_reads_(VGA_PLANES)	CONST BYTE * CONST *	ppnSecond,
+	_In_					DWORD					cbRow,
+	_Out_writes_(cbRow)		PBYTE					pnMask
+)
+{
+	DWORD		nChanged	= 0;
+	DWORD		nOffset		= 0;
+	DWORD		nPlane		= 0;
+	ULONGLONG	nChanges	= 0;
+
+	for (; nOffset + sizeof(ULONGLONG) <= cbRow; nOffset += sizeof(ULONGLONG))
+	{
+		nChanges = 0;
+		for (nPlane = 0; nPlane < VGA_PLANES; ++nPlane)
+		{
+			nChanges |= *(UNALIGNED CONST ULONGLONG *)(ppnFirst[nPlane] + nOffset) ^
+						*(UNALIGNED CONST ULONGLONG *)(ppnSecond[nPlane] + nOffset);
+		}
+		*(UNALIGNED ULONGLONG *)(pnMask + nOffset) = nChanges;
+		nChanged += vgadiff_CountBits(nChanges);
+	}
+
+	for (; nOffset < cbRow; ++nOffset)
+	{
+		nChanges = 0;
+		for (nPlane = 0; nPlane < VGA_PLANES; ++nPlane)
+		{
+			nChanges |= ppnFirst[nPlane][nOffset] ^ ppnSecond[nPlane][nOffset];
+		}
+		pnMask[nOffset] = (BYTE)nChanges;
+		nChanged += vgadiff_CountBits(nChanges);
+	}
+
+	return nChanged;
+}
+
+/**
+ * Compares two graphics mode screens of the same size.
+ *
+ * @param[in]	ptFirst			The first screen.
+ * @param[in]	ptSecond		The second screen.
+ * @param[out]	pnMask			Will receive the mask.
+ * @param[in]	cbMaskStride	Distance between rows in the mask, in bytes.
+ *
+ * @returns DWORD	The number of pixels that differ.
+ */
+STATIC
+DWORD
+vgadiff_CompareGraphics(
+	_In_	PCVGA_CAPTURE_VIEW	ptFirst,
+	_In_	PCVGA_CAPTURE_VIEW	ptSecond,
+	_Out_	PBYTE				pnMask,
+	_In_	DWORD				cbMaskStride
+)
+{
+	DWORD			nChanged					= 0;
+	DWORD			nRow						= 0;
+	DWORD			nPlane						= 0;
+	CONST BYTE *	apnFirst[VGA_PLANES]		= { NULL };
+	CONST BYTE *	apnSecond[VGA_PLANES]		= { NULL };
+	DWORD			nRemainder					= ptFirst->nWidth % PIXELS_IN_BYTE;
+	BYTE			nLastByteMask				= (BYTE)(MAXBYTE << (PIXELS_IN_BYTE - nRemainder));
+	PBYTE			pnLastByte					= NULL;
+
+	for (nRow = 0; nRow < ptFirst->nHeight; ++nRow)
+	{
+		for (nPlane = 0; nPlane < VGA_PLANES; ++nPlane)
+		{
+			apnFirst[nPlane] = ptFirst->apnPlanes[nPlane] + (nRow * ptFirst->cbStride);
+			apnSecond[nPlane] = ptSecond->apnPlanes[nPlane] + (nRow * ptSecond->cbStride);
+		}
+		nChanged += vgadiff_CompareRow(apnFirst, apnSecond, cbMaskStride, pnMask + (nRow * cbMaskStride));
+
+		// The bits past the width aren't pixels.
+		if (0 != nRemainder)
+		{
+			pnLastByte = pnMask + (nRow * cbMaskStride) + cbMaskStride - 1;
+			nChanged -= vgadiff_CountBits(*pnLastByte & (BYTE)~nLastByteMask);
+			*pnLastByte &= nLastByteMask;
+		}
+	}
+
+	return nChanged;
+}
+
+/**
+ * Compares two text mode screens of the same size.
+ * A character cell differs if its glyph or its colors do.
+ *
+ * @param[in]	ptFirst			The first screen.
+ * @param[in]	ptSecond		The second screen.
+ * @param[out]	pnMask			Will receive the mask.
+ * @param[in]	cbMaskStride	Distance between rows in the mask, in bytes.
+ *
+ * @returns DWORD	The number of pixels that differ.
+ */
+STATIC
+DWORD
+vgadiff_CompareText(
+	_In_	PCVGA_TEXT_SCREEN	ptFirst,
+	_In_	PCVGA_TEXT_SCREEN	ptSecond,
+	_Out_	PBYTE				pnMask,
+	_In_	DWORD				cbMaskStride
+)
+{
+	DWORD			nChanged		= 0;
+	DWORD			nRow			= 0;
+	DWORD			nColumn			= 0;
+	DWORD			nLine			= 0;
+	DWORD			nCharHeight		= ptFirst->nCharHeight;
+	CONST BYTE *	pnFirstCell		= ptFirst->pnText;
+	CONST BYTE *	pnSecondCell	= ptSecond->pnText;
+
+	assert(ptFirst->nColumns == cbMaskStride);
+
+	for (nRow = 0; nRow < ptFirst->nRows; ++nRow)
+	{
+		for (nColumn = 0; nColumn < ptFirst->nColumns; ++nColumn)
+		{
+			if ((pnFirstCell[1] != pnSecondCell[1]) ||
+				(0 != memcmp(ptFirst->pnFont + (pnFirstCell[0] * nCharHeight),
+							 ptSecond->pnFont + (pnSecondCell[0] * nCharHeight),
+							 nCharHeight)))
+			{
+				for (nLine = 0; nLine < nCharHeight; ++nLine)
+				{
+					pnMask[(((nRow * nCharHeight) + nLine) * cbMaskStride) + nColumn] = MAXBYTE;
+				}
+				nChanged += PIXELS_IN_BYTE * nCharHeight;
+			}
+			pnFirstCell += VGA_TEXT_CELL_BYTES;
+			pnSecondCell += VGA_TEXT_CELL_BYTES;
+		}
+	}
+
+	return nChanged;
+}
+
+HRESULT
+VGADIFF_Compare(
+	_In_		PCVGA_CAPTURE_VIEW	ptFirst,
+	_In_		PCVGA_CAPTURE_VIEW	ptSecond,
+	_Outptr_	PBYTE *				ppnMask,
+	_Out_		PDWORD				pcbMaskStride,
+	_Out_		PDWORD				pnChangedPixels
+)
+{
+	HRESULT	hrResult		= E_FAIL;
+	DWORD	cbMaskStride	= 0;
+	PBYTE	pnMask			= NULL;
+	DWORD	nChanged		= 0;
+
+	assert(NULL != ptFirst);
+	assert(NULL != ptSecond);
+	assert(NULL != ppnMask);
+	assert(NULL != pcbMaskStride);
+	assert(NULL != pnChangedPixels);
+
+	if ((ptFirst->eMode != ptSecond->eMode) ||
+		(ptFirst->nWidth != ptSecond->nWidth) ||
+		(ptFirst->nHeight != ptSecond->nHeight) ||
+		((VGA_CAPTURE_MODE_TEXT == ptFirst->eMode) &&
+		 (ptFirst->tText.nCharHeight != ptSecond->tText.nCharHeight)))
+	{
+		PROGRESS("Only screens of the same mode and size can be compared (%lux%lu and %lux%lu).",
+				 ptFirst->nWidth,
+				 ptFirst->nHeight,
+				 ptSecond->nWidth,
+				 ptSecond->nHeight);
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+
+	// A parsed capture's planes are bounded,
+	// so neither the stride nor the mask can overflow.
+	cbMaskStride = (ptFirst->nWidth / PIXELS_IN_BYTE) + ((0 != ptFirst->nWidth % PIXELS_IN_BYTE) ? 1 : 0);
+	pnMask = HEAPALLOC(max(cbMaskStride * ptFirst->nHeight, 1));
+	if (NULL == pnMask)
+	{
+		PROGRESS("Oops. Ran out of memory.");
+		hrResult = E_OUTOFMEMORY;
+		goto lblCleanup;
+	}
+
+	if (VGA_CAPTURE_MODE_TEXT == ptFirst->eMode)
+	{
+		nChanged = vgadiff_CompareText(&ptFirst->tText, &ptSecond->tText, pnMask, cbMaskStride);
+	}
+	else
+	{
+		nChanged = vgadiff_CompareGraphics(ptFirst, ptSecond, pnMask, cbMaskStride);
+	}
+
+	// Transfer ownership:
+	*ppnMask = pnMask;
+	pnMask = NULL;
+	*pcbMaskStride = cbMaskStride;
+	*pnChangedPixels = nChanged;
+
+	hrResult = S_OK;
+
+lblCleanup:
+	HEAPFREE(pnMask);
+
+	return hrResult;
+}
+
+/**
+ * Finds the root of a cell's region.
+ *
+ * @param[in,out]	pnParents	The region tree.
+ * @param[in]		nIndex		The cell.
+ *
+ * @returns DWORD
+ */
+STATIC
+FORCEINLINE
+DWORD
+vgadiff_FindRoot(
+	_Inout_	PDWORD	pnParents,
+	_In_	DWORD	nIndex
+)
+{
+	while (pnParents[nIndex] != nIndex)
+	{
+		pnParents[nIndex] = pnParents[pnParents[nIndex]];
+		nIndex = pnParents[nIndex];
+	}
+
+	return nIndex;
+}
+
+/**
+ * Merges the regions of two changed cells.
+ * The earlier cell's root is kept, so each region's root
+ * is its first cell in reading order.
+ *
+ * @param[in,out]	pnParents	The region tree.
+ * @param[in]		nFirst		The first cell.
+ * @param[in]		nSecond		The second cell.
+ */
+STATIC
+VOID
+vgadiff_Merge(
+	_Inout_	PDWORD	pnParents,
+	_In_	DWORD	nFirst,
+	_In_	DWORD	nSecond
+)
+{
+	DWORD	nFirstRoot	= 0;
+	DWORD	nSecondRoot	= 0;
+
+	if ((NO_CHANGES == pnParents[nFirst]) ||
+		(NO_CHANGES == pnParents[nSecond]))
+	{
+		return;
+	}
+
+	nFirstRoot = vgadiff_FindRoot(pnParents, nFirst);
+	nSecondRoot = vgadiff_FindRoot(pnParents, nSecond);
+	if (nFirstRoot < nSecondRoot)
+	{
+		pnParents[nSecondRoot] = nFirstRoot;
+	}
+	else
+	{
+		pnParents[nFirstRoot] = nSecondRoot;
+	}
+}
+
+/**
+ * Extends a rectangle over the changes in a cell.
+ *
+ * @param[in]		pnMask			The mask, at the cell's top-left byte.
+ * @param[in]		cbMaskStride	Distance between rows in the mask, in bytes.
+ * @param[in]		nLeft			The cell's left edge, in pixels.
+ * @param[in]		nTop			The cell's top edge, in pixels.
+ * @param[in]		nLines			The cell's height, in pixels.
+ * @param[in,out]	ptRegion		The rectangle. Empty if it has
+ *									no changes yet.
+ */
+STATIC
+VOID
+vgadiff_AddCell(
+	_In_	CONST BYTE *	pnMask,
+	_In_	DWORD			cbMaskStride,
+	_In_	LONG			nLeft,
+	_In_	LONG			nTop,
+	_In_	DWORD			nLines,
+	_Inout_	PRECT			ptRegion
+)
+{
+	DWORD	nLine		= 0;
+	BYTE	nChanges	= 0;
+	LONG	nFirstLine	= -1;
+	LONG	nLastLine	= 0;
+	LONG	nFirstBit	= 0;
+	LONG	nLastBit	= PIXELS_IN_BYTE - 1;
+	RECT	tCell		= { 0 };
+
+	for (nLine = 0; nLine < nLines; ++nLine)
+	{
+		if (0 != pnMask[nLine * cbMaskStride])
+		{
+			nChanges |= pnMask[nLine * cbMaskStride];
+			if (0 > nFirstLine)
+			{
+				nFirstLine = (LONG)nLine;
+			}
+			nLastLine = (LONG)nLine;
+		}
+	}
+	assert(0 != nChanges);
+
+	// The leftmost pixel is in the MSB.
+	while (0 == (nChanges & (0x80 >> nFirstBit)))
+	{
+		++nFirstBit;
+	}
+	while (0 == (nChanges & (0x80 >> nLastBit)))
+	{
+		--nLastBit;
+	}
+
+	tCell.left = nLeft + nFirstBit;
+	tCell.top = nTop + nFirstLine;
+	tCell.right = nLeft + nLastBit + 1;
+	tCell.bottom = nTop + nLastLine + 1;
+
+	if (ptRegion->bottom <= ptRegion->top)
+	{
+		*ptRegion = tCell;
+	}
+	else
+	{
+		ptRegion->left = min(ptRegion->left, tCell.left);
+		ptRegion->top = min(ptRegion->top, tCell.top);
+		ptRegion->right = max(ptRegion->right, tCell.right);
+		ptRegion->bottom = max(ptRegion->bottom, tCell.bottom);
+	}
+}
+
+HRESULT
+VGADIFF_FindRegions(
+	_In_reads_(cbMaskStride * nHeight)				CONST BYTE *	pnMask,
+	_In_											DWORD			cbMaskStride,
+	_In_											DWORD			nWidth,
+	_In_											DWORD			nHeight,
+	_Outptr_result_buffer_maybenull_(*pnRegions)	PRECT *			pptRegions,
+	_Out_											PDWORD			pnRegions
+)
+{
+	HRESULT			hrResult		= E_FAIL;
+	DWORD			nColumns		= cbMaskStride;
+	DWORD			nRows			= (nHeight / VGA_DIFF_CELL_HEIGHT) + ((0 != nHeight % VGA_DIFF_CELL_HEIGHT) ? 1 : 0);
+	DWORD			nCells			= 0;
+	PDWORD			pnParents		= NULL;
+	PDWORD			pnLabels		= NULL;
+	PRECT			ptRegions		= NULL;
+	DWORD			nRegions		= 0;
+	DWORD			nRow			= 0;
+	DWORD			nColumn			= 0;
+	DWORD			nCell			= 0;
+	DWORD			nLine			= 0;
+	DWORD			nLines			= 0;
+	CONST BYTE *	pnCellMask		= NULL;
+
+	assert(NULL != pnMask);
+	assert(NULL != pptRegions);
+	assert(NULL != pnRegions);
+	assert(nWidth <= cbMaskStride * PIXELS_IN_BYTE);
+
+	UNREFERENCED_PARAMETER(nWidth);
+
+	hrResult = DWordMult(nColumns, nRows, &nCells);
+	if (FAILED(hrResult))
+	{
+		PROGRESS("The screen is too big.");
+		goto lblCleanup;
+	}
+
+	pnParents = HEAPALLOC(max(nCells, 1) * sizeof(pnParents[0]));
+	pnLabels = HEAPALLOC(max(nCells, 1) * sizeof(pnLabels[0]));
+	if ((NULL == pnParents) ||
+		(NULL == pnLabels))
+	{
+		PROGRESS("Oops. Ran out of memory.");
+		hrResult = E_OUTOFMEMORY;
+		goto lblCleanup;
+	}
+
+	// Find the changed cells, and merge each with
+	// the changed cells it touches above and to its left.
+	for (nRow = 0; nRow < nRows; ++nRow)
+	{
+		nLines = min(VGA_DIFF_CELL_HEIGHT, nHeight - (nRow * VGA_DIFF_CELL_HEIGHT));
+		for (nColumn = 0; nColumn < nColumns; ++nColumn)
+		{
+			nCell = (nRow * nColumns) + nColumn;
+			pnParents[nCell] = NO_CHANGES;
+
+			pnCellMask = pnMask + (nRow * VGA_DIFF_CELL_HEIGHT * cbMaskStride) + nColumn;
+			for (nLine = 0; nLine < nLines; ++nLine)
+			{
+				if (0 != pnCellMask[nLine * cbMaskStride])
+				{
+					pnParents[nCell] = nCell;
+					break;
+				}
+			}
+			if (NO_CHANGES == pnParents[nCell])
+			{
+				continue;
+			}
+
+			if (0 < nColumn)
+			{
+				vgadiff_Merge(pnParents, nCell, nCell - 1);
+			}
+			if (0 < nRow)
+			{
+				vgadiff_Merge(pnParents, nCell, nCell - nColumns);
+				if (0 < nColumn)
+				{
+					vgadiff_Merge(pnParents, nCell, nCell - nColumns - 1);
+				}
+				if (nColumns - 1 > nColumn)
+				{
+					vgadiff_Merge(pnParents, nCell, nCell - nColumns + 1);
+				}
+			}
+		}
+	}
+
+	// Number the regions by their roots, which come first.
+	for (nCell = 0; nCell < nCells; ++nCell)
+	{
+		if (NO_CHANGES == pnParents[nCell])
+		{
+			continue;
+		}
+		if (vgadiff_FindRoot(pnParents, nCell) == nCell)
+		{
+			pnLabels[nCell] = nRegions;
+			++nRegions;
+		}
+	}
+
+	if (0 < nRegions)
+	{
+		ptRegions = HEAPALLOC(nRegions * sizeof(ptRegions[0]));
+		if (NULL == ptRegions)
+		{
+			PROGRESS("Oops. Ran out of memory.");
+			hrResult = E_OUTOFMEMORY;
+			goto lblCleanup;
+		}
+
+		for (nRow = 0; nRow < nRows; ++nRow)
+		{
+			nLines = min(VGA_DIFF_CELL_HEIGHT, nHeight - (nRow * VGA_DIFF_CELL_HEIGHT));
+			for (nColumn = 0; nColumn < nColumns; ++nColumn)
+			{
+				nCell = (nRow * nColumns) + nColumn;
+				if (NO_CHANGES == pnParents[nCell])
+				{
+					continue;
+				}
+
+				vgadiff_AddCell(pnMask + (nRow * VGA_DIFF_CELL_HEIGHT * cbMaskStride) + nColumn,
+								cbMaskStride,
+								(LONG)(nColumn * VGA_DIFF_CELL_WIDTH),
+								(LONG)(nRow * VGA_DIFF_CELL_HEIGHT),
+								nLines,
+								&(ptRegions[pnLabels[vgadiff_FindRoot(pnParents, nCell)]]));
+			}
+		}
+	}
+
+	// Transfer ownership:
+	*pptRegions = ptRegions;
+	ptRegions = NULL;
+	*pnRegions = nRegions;
+
+	hrResult = S_OK;
+
+lblCleanup:
+	HEAPFREE(ptRegions);
+	HEAPFREE(pnLabels);
+	HEAPFREE(pnParents);
+
+	return hrResult;
+}
+
+/**
+ * Fades a color channel.
+ *
+ * @param[in]	nChannel	The channel's intensity.
+ *
+ * @returns BYTE
+ */
+STATIC
+FORCEINLINE
+BYTE
+vgadiff_Fade(
+	_In_	BYTE	nChannel
+)
+{
+	return (BYTE)((nChannel + (FADE_GRAY * FADE_WEIGHT)) / (FADE_WEIGHT + 1));
+}
+
+/**
+ * Paints a pixel in the outline color.
+ *
+ * @param[out]	ptPixel	The pixel.
+ */
+STATIC
+FORCEINLINE
+VOID
+vgadiff_Outline(
+	_Out_	RGBQUAD *	ptPixel
+)
+{
+	ptPixel->rgbRed = OUTLINE_RED;
+	ptPixel->rgbGreen = OUTLINE_GREEN;
+	ptPixel->rgbBlue = OUTLINE_BLUE;
+	ptPixel->rgbReserved = MAXBYTE;
+}
+
+VOID
+VGADIFF_Highlight(
+	_In_reads_(cbMaskStride * nHeight)	CONST BYTE *	pnMask,
+	_In_								DWORD			cbMaskStride,
+	_In_								DWORD			nWidth,
+	_In_								DWORD			nHeight,
+	_In_reads_opt_(nRegions)			CONST RECT *	ptRegions,
+	_In_								DWORD			nRegions,
+	_Inout_updates_(nWidth * nHeight)	RGBQUAD *		ptPixels
+)
+{
+	DWORD		nRow		= 0;
+	DWORD		nColumn		= 0;
+	DWORD		nRegion		= 0;
+	RGBQUAD *	ptPixel		= NULL;
+	LONG		nLeft		= 0;
+	LONG		nTop		= 0;
+	LONG		nRight		= 0;
+	LONG		nBottom		= 0;
+	LONG		nX			= 0;
+	LONG		nY			= 0;
+
+	assert(NULL != pnMask);
+	assert((NULL != ptRegions) || (0 == nRegions));
+	assert(NULL != ptPixels);
+
+	for (nRow = 0; nRow < nHeight; ++nRow)
+	{
+		for (nColumn = 0; nColumn < nWidth; ++nColumn)
+		{
+			if (0 != (pnMask[(nRow * cbMaskStride) + (nColumn / PIXELS_IN_BYTE)] & (0x80 >> (nColumn % PIXELS_IN_BYTE))))
+			{
+				continue;
+			}
+
+			ptPixel = &(ptPixels[(nRow * nWidth) + nColumn]);
+			ptPixel->rgbRed = vgadiff_Fade(ptPixel->rgbRed);
+			ptPixel->rgbGreen = vgadiff_Fade(ptPixel->rgbGreen);
+			ptPixel->rgbBlue = vgadiff_Fade(ptPixel->rgbBlue);
+		}
+	}
+
+	// The outlines go just outside the regions,
+	// so that they don't hide any of the changes.
+	for (nRegion = 0; nRegion < nRegions; ++nRegion)
+	{
+		nLeft = ptRegions[nRegion].left - 1;
+		nTop = ptRegions[nRegion].top - 1;
+		nRight = ptRegions[nRegion].right;
+		nBottom = ptRegions[nRegion].bottom;
+
+		for (nY = max(nTop, 0); nY <= min(nBottom, (LONG)nHeight - 1); ++nY)
+		{
+			for (nX = max(nLeft, 0); nX <= min(nRight, (LONG)nWidth - 1); ++nX)
+			{
+				if ((nTop == nY) || (nBottom == nY) ||
+					(nLeft == nX) || (nRight == nX))
+				{
+					vgadiff_Outline(&(ptPixels[(nY * (LONG)nWidth) + nX]));
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,112 @@
+/**
+ * @file VgaDiff.h
+ * @author biko
+ * @date 2026-10-17
+ *
+ * VgaDiff module public header.
+ * Contains routines for finding the pixels that differ
+ * between two captured screens.
+ */
+#pragma once
+
+/** Headers *************************************************************/
+#include <Windows.h>
+
+#include "VgaCapture.h"
+
+
+/** Constants ***********************************************************/
+
+/**
+ * Changes are grouped into regions in cells of
+ * VGA_DIFF_CELL_WIDTH x VGA_DIFF_CELL_HEIGHT pixels:
+ * changes in touching cells belong to the same region.
+ * A cell is a byte of the mask wide, and about a character tall.
+ */
+#define VGA_DIFF_CELL_WIDTH (PIXELS_IN_BYTE)
+#define VGA_DIFF_CELL_HEIGHT (16)
+
+
+/** Functions ***********************************************************/
+
+/**
+ * Finds the pixels that differ between two screens.
+ * Graphics mode screens are compared by XORing their planes
+ * a quadword (64 pixels) at a time, without decoding the pixels.
+ * Text mode screens are compared a character cell at a time.
+ *
+ * @param[in]	ptFirst				The first screen.
+ * @param[in]	ptSecond			The second screen.
+ *									Must have the same mode and size.
+ * @param[out]	ppnMask				Will receive a bit for each pixel,
+ *									set where the screens differ.
+ *									Laid out like a plane, MSB first.
+ *									Free with HEAPFREE.
+ * @param[out]	pcbMaskStride		Will receive the distance between
+ *									rows in the mask, in bytes.
+ * @param[out]	pnChangedPixels		Will receive the number of
+ *									pixels that differ.
+ *
+ * @returns HRESULT
+ *
+ * @remark	Pixel values are compared, not colors,
+ *			so changes to the palette aren't found.
+ */
+HRESULT
+VGADIFF_Compare(
+	_In_		PCVGA_CAPTURE_VIEW	ptFirst,
+	_In_		PCVGA_CAPTURE_VIEW	ptSecond,
+	_Outptr_	PBYTE *				ppnMask,
+	_Out_		PDWORD				pcbMaskStride,
+	_Out_		PDWORD				pnChangedPixels
+);
+
+/**
+ * Groups the changes found by VGADIFF_Compare into regions,
+ * and finds the bounding rectangle of each.
+ *
+ * @param[in]	pnMask			The mask.
+ * @param[in]	cbMaskStride	Distance between rows in the mask, in bytes.
+ * @param[in]	nWidth			Width of the screen, in pixels.
+ * @param[in]	nHeight			Height of the screen, in pixels.
+ * @param[out]	pptRegions		Will receive the regions' rectangles,
+ *								top to bottom, by their first change.
+ *								The right and bottom edges are exclusive.
+ *								NULL if there are no changes.
+ *								Free with HEAPFREE.
+ * @param[out]	pnRegions		Will receive the number of regions.
+ *
+ * @returns HRESULT
+ */
+HRESULT
+VGADIFF_FindRegions(
+	_In_reads_(cbMaskStride * nHeight)				CONST BYTE *	pnMask,
+	_In_											DWORD			cbMaskStride,
+	_In_											DWORD			nWidth,
+	_In_											DWORD			nHeight,
+	_Outptr_result_buffer_maybenull_(*pnRegions)	PRECT *			pptRegions,
+	_Out_											PDWORD			pnRegions
+);
+
+/**
+ * Highlights the changes in a true color image of a screen:
+ * unchanged pixels are faded, and each region is outlined.
+ *
+ * @param[in]		pnMask			The mask.
+ * @param[in]		cbMaskStride	Distance between rows in the mask, in bytes.
+ * @param[in]		nWidth			Width of the screen, in pixels.
+ * @param[in]		nHeight			Height of the screen, in pixels.
+ * @param[in]		ptRegions		The regions, as found by VGADIFF_FindRegions.
+ * @param[in]		nRegions		Number of regions.
+ * @param[in,out]	ptPixels		The image, top row first, with no padding.
+ */
+VOID
+VGADIFF_Highlight(
+	_In_reads_(cbMaskStride * nHeight)	CONST BYTE *	pnMask,
+	_In_								DWORD			cbMaskStride,
+	_In_								DWORD			nWidth,
+	_In_								DWORD			nHeight,
+	_In_reads_opt_(nRegions)			CONST RECT *	ptRegions,
+	_In_								DWORD			nRegions,
+	_Inout_updates_(nWidth * nHeight)	RGBQUAD *		ptPixels
+);
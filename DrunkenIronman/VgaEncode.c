@@ -0,0 +1,250 @@
+/**
+ * @file VgaEncode.c
+ * @author biko
+ * @date 2026-10-17
+ *
+ * VgaEncode module implementation.
+ */
+
+/** Headers *************************************************************/
+#include <Windows.h>
+
+#include <assert.h>
+
+#include <Drink.h>
+
+#include "Util.h"
+#include "Debug.h"
+#include "VgaCapture.h"
+
+#include "VgaEncode.h"
+
+
+/** Constants ***********************************************************/
+
+/**
+ * Selects the low bit of each of 8 pixels.
+ */
+#define PIXEL_LOW_BITS (0x0101010101010101ULL)
+
+/**
+ * Gathers the low bits of 8 pixels into the top byte,
+ * with the first pixel (the lowest byte) in the MSB.
+ * Pixel i only ever lands on bit 7 - i of the top byte,
+ * and none of the partial products overlap, so nothing carries.
+ */
+#define PIXEL_GATHER_MULTIPLIER (0x8040201008040201ULL)
+
+
+/** Functions ***********************************************************/
+
+/**
+ * Encodes 8 pixels into a byte of each plane.
+ *
+ * @param[in]	nPixels		The pixels, the first in the lowest byte.
+ * @param[in]	ppnPlanes	Pointers to the bytes to write in each plane.
+ */
+STATIC
+FORCEINLINE
+VOID
+vgaencode_EncodeByte(
+	_In_					ULONGLONG		nPixels,
+	_In_reads_(VGA_PLANES)	PBYTE CONST *	ppnPlanes
+)
+{
+	DWORD	nPlane	= 0;
+
+	for (nPlane = 0; nPlane < VGA_PLANES; ++nPlane)
+	{
+		*(ppnPlanes[nPlane]) = (BYTE)((((nPixels >> nPlane) & PIXEL_LOW_BITS) * PIXEL_GATHER_MULTIPLIER) >> 56);
+	}
+}
+
+/**
+ * Encodes a single row of pixels.
+ *
+ * @param[in]	pnPixels	The row's pixels.
+ * @param[in]	nWidth		Width of the row, in pixels.
+ * @param[in]	ppnPlanes	Pointers to the row in each plane.
+ */
+STATIC
+VOID
+vgaencode_EncodeRow(
+	_In_reads_(nWidth)		CONST BYTE *	pnPixels,
+	_In_					DWORD			nWidth,
+	_In_reads_(VGA_PLANES)	PBYTE CONST *	ppnPlanes
+)
+{
+	DWORD		cbRow					= nWidth / PIXELS_IN_BYTE;
+	DWORD		nRemainder				= nWidth % PIXELS_IN_BYTE;
+	DWORD		nOffset					= 0;
+	DWORD		nPlane					= 0;
+	PBYTE		apnBytes[VGA_PLANES]	= { NULL };
+	ULONGLONG	nLastPixels				= 0;
+
+	C_ASSERT(sizeof(ULONGLONG) == PIXELS_IN_BYTE);
+
+	for (nOffset = 0; nOffset <= cbRow; ++nOffset)
+	{
+		if (cbRow == nOffset)
+		{
+			if (0 == nRemainder)
+			{
+				break;
+			}
+
+			// The pixels past the width are encoded as zeros.
+			CopyMemory(&nLastPixels, pnPixels + (nOffset * PIXELS_IN_BYTE), nRemainder);
+		}
+		else
+		{
+			nLastPixels = *(UNALIGNED CONST ULONGLONG *)(pnPixels + (nOffset * PIXELS_IN_BYTE));
+		}
+
+		for (nPlane = 0; nPlane < VGA_PLANES; ++nPlane)
+		{
+			apnBytes[nPlane] = ppnPlanes[nPlane] + nOffset;
+		}
+		vgaencode_EncodeByte(nLastPixels, apnBytes);
+	}
+}
+
+VOID
+VGAENCODE_EncodeImage(
+	_In_reads_(cbPixelStride * nHeight)	CONST BYTE *	pnPixels,
+	_In_								DWORD			cbPixelStride,
+	_In_								DWORD			nWidth,
+	_In_								DWORD			nHeight,
+	_In_reads_(VGA_PLANES)				PBYTE CONST *	ppnPlanes,
+	_In_								DWORD			cbPlaneStride
+)
+{
+	DWORD	nRow				= 0;
+	DWORD	nPlane				= 0;
+	PBYTE	apnRow[VGA_PLANES]	= { NULL };
+
+	assert(NULL != pnPixels);
+	assert(NULL != ppnPlanes);
+	assert(nWidth <= cbPixelStride);
+	assert(nWidth <= cbPlaneStride * PIXELS_IN_BYTE);
+
+	for (nRow = 0; nRow < nHeight; ++nRow)
+	{
+		for (nPlane = 0; nPlane < VGA_PLANES; ++nPlane)
+		{
+			apnRow[nPlane] = ppnPlanes[nPlane] + (nRow * cbPlaneStride);
+		}
+		vgaencode_EncodeRow(pnPixels + (nRow * cbPixelStride), nWidth, apnRow);
+	}
+}
+
+HRESULT
+VGAENCODE_CreateCapture(
+	_In_reads_(cbPixelStride * nHeight)			CONST BYTE *		pnPixels,
+	_In_										DWORD				cbPixelStride,
+	_In_										DWORD				nWidth,
+	_In_										DWORD				nHeight,
+	_In_reads_(VGA_DAC_PALETTE_ENTRIES)			PCPALETTE_ENTRY		ptPaletteEntries,
+	_In_										BOOL				bLegacy,
+	_Outptr_result_bytebuffer_(*pcbCapture)		PVOID *				ppvCapture,
+	_Out_										PDWORD				pcbCapture
+)
+{
+	HRESULT					hrResult				= E_FAIL;
+	DWORD					cbStride				= 0;
+	DWORD					cbPlane					= 0;
+	DWORD					cbHeader				= 0;
+	DWORD					cbPalette				= VGA_DAC_PALETTE_ENTRIES * sizeof(PALETTE_ENTRY);
+	DWORD					cbCapture				= 0;
+	PBYTE					pnCapture				= NULL;
+	PVGA_CAPTURE_HEADER		ptHeader				= NULL;
+	PBYTE					apnPlanes[VGA_PLANES]	= { NULL };
+	DWORD					nPlane					= 0;
+	DWORD					nColor					= 0;
+
+	assert(NULL != pnPixels);
+	assert(NULL != ptPaletteEntries);
+	assert(NULL != ppvCapture);
+	assert(NULL != pcbCapture);
+
+	// The same bounds as VGACAPTURE_Parse, checked so that
+	// the size calculations can't overflow.
+	cbStride = (nWidth / PIXELS_IN_BYTE) + ((0 != nWidth % PIXELS_IN_BYTE) ? 1 : 0);
+	if ((0 == nWidth) ||
+		(0 == nHeight) ||
+		(VGA_GRAPHICS_MAX_STRIDE < cbStride) ||
+		(VGA_PLANE_MAX_BYTES / cbStride < nHeight))
+	{
+		PROGRESS("A %lux%lu screen doesn't fit in the planes.", nWidth, nHeight);
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+	cbPlane = cbStride * nHeight;
+
+	if (bLegacy)
+	{
+		if ((SCREEN_WIDTH_PIXELS != nWidth) ||
+			(SCREEN_HEIGHT_PIXELS != nHeight))
+		{
+			PROGRESS("Legacy captures are always %dx%d.", SCREEN_WIDTH_PIXELS, SCREEN_HEIGHT_PIXELS);
+			hrResult = E_INVALIDARG;
+			goto lblCleanup;
+		}
+		C_ASSERT(sizeof(VGA_PLANE_DUMP) == (SCREEN_WIDTH_PIXELS / PIXELS_IN_BYTE) * SCREEN_HEIGHT_PIXELS);
+		C_ASSERT(FIELD_OFFSET(VGA_DUMP, atPlanes) == VGA_DAC_PALETTE_ENTRIES * sizeof(PALETTE_ENTRY));
+	}
+	else
+	{
+		cbHeader = sizeof(*ptHeader);
+	}
+
+	// The payload (or the whole VGA_DUMP) is the palette,
+	// followed by the planes.
+	cbCapture = cbHeader + cbPalette + (VGA_PLANES * cbPlane);
+	pnCapture = HEAPALLOC(cbCapture);
+	if (NULL == pnCapture)
+	{
+		PROGRESS("Oops. Ran out of memory.");
+		hrResult = E_OUTOFMEMORY;
+		goto lblCleanup;
+	}
+
+	CopyMemory(pnCapture + cbHeader, ptPaletteEntries, cbPalette);
+	for (nPlane = 0; nPlane < VGA_PLANES; ++nPlane)
+	{
+		apnPlanes[nPlane] = pnCapture + cbHeader + cbPalette + (nPlane * cbPlane);
+	}
+	VGAENCODE_EncodeImage(pnPixels, cbPixelStride, nWidth, nHeight, apnPlanes, cbStride);
+
+	if (!bLegacy)
+	{
+		ptHeader = (PVGA_CAPTURE_HEADER)pnCapture;
+		ptHeader->nMagic = VGA_CAPTURE_MAGIC;
+		ptHeader->nVersion = VGA_CAPTURE_VERSION;
+		ptHeader->cbHeader = cbHeader;
+		ptHeader->nWidth = nWidth;
+		ptHeader->nHeight = nHeight;
+		ptHeader->cbStride = cbStride;
+		ptHeader->nPlanes = VGA_PLANES;
+		ptHeader->nBitsPerPixel = VGA_PLANES;
+		ptHeader->nPaletteEntries = VGA_DAC_PALETTE_ENTRIES;
+		ptHeader->eMode = VGA_CAPTURE_MODE_GRAPHICS;
+		for (nColor = 0; nColor < VGA_ATTRIBUTE_PALETTE_ENTRIES; ++nColor)
+		{
+			ptHeader->anAttributePalette[nColor] = (UCHAR)nColor;
+		}
+		ptHeader->nChecksum = VGACAPTURE_Checksum(pnCapture + cbHeader, cbCapture - cbHeader);
+	}
+
+	// Transfer ownership:
+	*ppvCapture = pnCapture;
+	pnCapture = NULL;
+	*pcbCapture = cbCapture;
+
+	hrResult = S_OK;
+
+lblCleanup:
+	HEAPFREE(pnCapture);
+
+	return hrResult;
+}
@@ -0,0 +1,81 @@
+/**
+ * @file VgaEncode.h
+ * @author biko
+ * @date 2026-10-17
+ *
+ * VgaEncode module public header.
+ * Contains routines for converting indexed pixels into planar
+ * VGA video memory, and for packaging them as VGA captures.
+ * This is the reverse of VgaDecode, for producing captures
+ * without crashing a machine.
+ */
+#pragma once
+
+/** Headers *************************************************************/
+#include <Windows.h>
+
+#include <Drink.h>
+
+
+/** Functions ***********************************************************/
+
+/**
+ * Encodes indexed pixels into planar VGA memory.
+ * Each 8 pixels yield a byte of each plane, MSB first,
+ * with bit N of each pixel's value going to plane N.
+ *
+ * @param[in]	pnPixels		The indexed pixels, top row first.
+ *								Only the low VGA_PLANES bits are used.
+ * @param[in]	cbPixelStride	Distance between rows in pnPixels, in bytes.
+ * @param[in]	nWidth			Width of the image, in pixels.
+ * @param[in]	nHeight			Height of the image, in pixels.
+ * @param[out]	ppnPlanes		Pointers to the first row of each plane.
+ * @param[in]	cbPlaneStride	Distance between rows in each plane, in bytes.
+ *
+ * @remark	Bits past the width in the last byte of each row are cleared.
+ *			Bytes past the last one of each row are left as they are.
+ *
+ * @see VGADECODE_DecodeImage
+ */
+VOID
+VGAENCODE_EncodeImage(
+	_In_reads_(cbPixelStride * nHeight)	CONST BYTE *	pnPixels,
+	_In_								DWORD			cbPixelStride,
+	_In_								DWORD			nWidth,
+	_In_								DWORD			nHeight,
+	_In_reads_(VGA_PLANES)				PBYTE CONST *	ppnPlanes,
+	_In_								DWORD			cbPlaneStride
+);
+
+/**
+ * Packages indexed pixels as a graphics mode VGA capture,
+ * as the driver would have saved it to the dump file.
+ *
+ * @param[in]	pnPixels			The indexed pixels, top row first.
+ * @param[in]	cbPixelStride		Distance between rows in pnPixels, in bytes.
+ * @param[in]	nWidth				Width of the image, in pixels.
+ * @param[in]	nHeight				Height of the image, in pixels.
+ * @param[in]	ptPaletteEntries	The DAC palette.
+ * @param[in]	bLegacy				Whether to produce a bare VGA_DUMP,
+ *									as captures were before VGA_CAPTURE_HEADER.
+ *									Only possible for 640x480.
+ * @param[out]	ppvCapture			Will receive the capture.
+ *									Free with HEAPFREE.
+ * @param[out]	pcbCapture			Will receive the capture's size, in bytes.
+ *
+ * @returns HRESULT
+ *
+ * @remark	Each pixel value is displayed with the DAC entry
+ *			of the same index, as Windows programs the VGA.
+ */
+HRESULT
+VGAENCODE_CreateCapture(
+	_In_reads_(cbPixelStride * nHeight)			CONST BYTE *		pnPixels,
+	_In_										DWORD				cbPixelStride,
+	_In_										DWORD				nWidth,
+	_In_										DWORD				nHeight,
+	_In_reads_(VGA_DAC_PALETTE_ENTRIES)			PCPALETTE_ENTRY		ptPaletteEntries,
+	_In_										BOOL				bLegacy,
+	_Outptr_result_bytebuffer_(*pcbCapture)		PVOID *				ppvCapture,
+	_Out_										PDWORD				pcbCapture
+);
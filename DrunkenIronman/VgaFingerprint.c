@@ -0,0 +1,906 @@
+/**
+ * @file VgaFingerprint.c
+ * @author biko
+ * @date 2026-10-17
+ *
+ * VgaFingerprint module implementation.
+ */
+
+/** Headers *************************************************************/
+#include <Windows.h>
+#include <intsafe.h>
+
+#include <assert.h>
+
+#include <Drink.h>
+
+#include "Util.h"
+#include "Debug.h"
+
+#include "VgaRle.h"
+#include "VgaFingerprint.h"
+
+
+/** Constants ***********************************************************/
+
+/**
+ * Number of buckets in the index of each chunk, as a power of two.
+ * Chunks wider than this are hashed down to it.
+ */
+#define BUCKET_BITS (16)
+#define BUCKETS (1UL << BUCKET_BITS)
+C_ASSERT(0 == VGA_FINGERPRINT_BITS % (2 * BUCKET_BITS));
+
+/**
+ * Multiplier for hashing chunks into buckets (2^64 / golden ratio).
+ */
+#define BUCKET_HASH_MULTIPLIER (0x9E3779B97F4A7C15ULL)
+
+/**
+ * Buckets up to this size are compared pair by pair,
+ * which is cheaper than keeping track of their groups.
+ */
+#define BUCKET_PAIRWISE_MAX (32)
+
+/**
+ * Ends the lists of positions in a bucket,
+ * and marks fingerprints that have no group in it yet.
+ */
+#define NO_POSITION (MAXDWORD)
+
+
+/** Typedefs ************************************************************/
+
+/**
+ * Accumulates the pixel values of each block of the screen.
+ */
+typedef struct _VGAFINGERPRINT_BLOCKS
+{
+	// Sum of the pixel values in each block.
+	ULONGLONG	anSums[VGA_FINGERPRINT_BITS];
+
+	// Number of pixels in each block.
+	ULONGLONG	anPixels[VGA_FINGERPRINT_BITS];
+} VGAFINGERPRINT_BLOCKS, *PVGAFINGERPRINT_BLOCKS;
+typedef CONST VGAFINGERPRINT_BLOCKS *PCVGAFINGERPRINT_BLOCKS;
+
+/**
+ * A group seen in the bucket being compared,
+ * with the bucket's fingerprints that are in it.
+ */
+typedef struct _VGAFINGERPRINT_BUCKET_GROUP
+{
+	// The group's root.
+	DWORD	nRoot;
+
+	// Positions of the first and last of the group's fingerprints
+	// in the bucket, linked through the list of next positions.
+	DWORD	nFirst;
+	DWORD	nLast;
+} VGAFINGERPRINT_BUCKET_GROUP, *PVGAFINGERPRINT_BUCKET_GROUP;
+
+
+/** Functions ***********************************************************/
+
+/**
+ * Counts the set bits in a quadword.
+ *
+ * @param[in]	nValue	The quadword.
+ *
+ * @returns DWORD
+ *
+ * @remark	Doesn't rely on the POPCNT instruction,
+ *			which older processors lack.
+ */
+STATIC
+FORCEINLINE
+DWORD
+vgafingerprint_CountBits(
+	_In_	ULONGLONG	nValue
+)
+{
+	nValue = nValue - ((nValue >> 1) & 0x5555555555555555ULL);
+	nValue = (nValue & 0x3333333333333333ULL) + ((nValue >> 2) & 0x3333333333333333ULL);
+	nValue = (nValue + (nValue >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+
+	return (DWORD)((nValue * 0x0101010101010101ULL) >> 56);
+}
+
+/**
+ * Counts the set bits in a span of bytes.
+ *
+ * @param[in]	pnSpan	The span.
+ * @param[in]	cbSpan	Size of the span, in bytes.
+ *
+ * @returns DWORD
+ */
+STATIC
+FORCEINLINE
+DWORD
+vgafingerprint_CountSpanBits(
+	_In_reads_(cbSpan)	CONST BYTE *	pnSpan,
+	_In_				DWORD			cbSpan
+)
+{
+	DWORD		nBits	= 0;
+	ULONGLONG	nTail	= 0;
+
+	for (; cbSpan >= sizeof(ULONGLONG); cbSpan -= sizeof(ULONGLONG))
+	{
+		nBits += vgafingerprint_CountBits(*(UNALIGNED CONST ULONGLONG *)pnSpan);
+		pnSpan += sizeof(ULONGLONG);
+	}
+
+	for (; cbSpan > 0; --cbSpan)
+	{
+		nTail = (nTail << 8) | *pnSpan;
+		++pnSpan;
+	}
+
+	return nBits + vgafingerprint_CountBits(nTail);
+}
+
+/**
+ * Finds the block a pixel coordinate falls in.
+ *
+ * @param[in]	nCoordinate	The coordinate.
+ * @param[in]	nExtent		The size of the screen along the same axis.
+ *
+ * @returns DWORD
+ */
+STATIC
+FORCEINLINE
+DWORD
+vgafingerprint_GetBlock(
+	_In_	DWORD	nCoordinate,
+	_In_	DWORD	nExtent
+)
+{
+	return (DWORD)(((ULONGLONG)nCoordinate * VGA_FINGERPRINT_GRID) / nExtent);
+}
+
+/**
+ * Turns the accumulated blocks into a fingerprint.
+ *
+ * @param[in]	ptBlocks	The blocks.
+ *
+ * @returns VGA_FINGERPRINT
+ */
+STATIC
+VGA_FINGERPRINT
+vgafingerprint_Finish(
+	_In_	PCVGAFINGERPRINT_BLOCKS	ptBlocks
+)
+{
+	ULONGLONG		anAverages[VGA_FINGERPRINT_BITS]	= { 0 };
+	ULONGLONG		nTotal								= 0;
+	DWORD			nBlock								= 0;
+	VGA_FINGERPRINT	nFingerprint						= 0;
+
+	// The averages are kept in fixed point, so that dim blocks
+	// don't all round down to the same value.
+	for (nBlock = 0; nBlock < VGA_FINGERPRINT_BITS; ++nBlock)
+	{
+		if (0 != ptBlocks->anPixels[nBlock])
+		{
+			anAverages[nBlock] = (ptBlocks->anSums[nBlock] << 8) / ptBlocks->anPixels[nBlock];
+		}
+		nTotal += anAverages[nBlock];
+	}
+
+	for (nBlock = 0; nBlock < VGA_FINGERPRINT_BITS; ++nBlock)
+	{
+		if (anAverages[nBlock] * VGA_FINGERPRINT_BITS > nTotal)
+		{
+			nFingerprint |= 1ULL << nBlock;
+		}
+	}
+
+	return nFingerprint;
+}
+
+/**
+ * Accumulates the blocks of a graphics mode screen.
+ *
+ * @param[in]	ptCapture	The capture.
+ * @param[out]	ptBlocks	The blocks to update.
+ */
+STATIC
+VOID
+vgafingerprint_AddGraphics(
+	_In_	PCVGA_CAPTURE_VIEW		ptCapture,
+	_Inout_	PVGAFINGERPRINT_BLOCKS	ptBlocks
+)
+{
+	DWORD			cbRow										= ptCapture->nWidth / PIXELS_IN_BYTE;
+	DWORD			anColumnStarts[VGA_FINGERPRINT_GRID + 1]	= { 0 };
+	DWORD			nBlockColumn								= 0;
+	DWORD			nY											= 0;
+	DWORD			nBlock										= 0;
+	DWORD			nPlane										= 0;
+	CONST BYTE *	pnSpan										= NULL;
+	DWORD			cbSpan										= 0;
+
+	// Blocks are made of whole plane bytes: byte N is in the block
+	// vgafingerprint_GetBlock(N, cbRow) returns. Pixels in a partial
+	// byte at the end of a row are ignored.
+	for (nBlockColumn = 0; nBlockColumn <= VGA_FINGERPRINT_GRID; ++nBlockColumn)
+	{
+		anColumnStarts[nBlockColumn] = ((nBlockColumn * cbRow) + VGA_FINGERPRINT_GRID - 1) / VGA_FINGERPRINT_GRID;
+	}
+
+	for (nY = 0; nY < ptCapture->nHeight; ++nY)
+	{
+		nBlock = vgafingerprint_GetBlock(nY, ptCapture->nHeight) * VGA_FINGERPRINT_GRID;
+
+		for (nBlockColumn = 0; nBlockColumn < VGA_FINGERPRINT_GRID; ++nBlockColumn, ++nBlock)
+		{
+			cbSpan = anColumnStarts[nBlockColumn + 1] - anColumnStarts[nBlockColumn];
+
+			// Plane N contributes 2^N to the value of each pixel it's set in.
+			for (nPlane = 0; nPlane < VGA_PLANES; ++nPlane)
+			{
+				pnSpan = ptCapture->apnPlanes[nPlane] +
+						 (nY * ptCapture->cbStride) +
+						 anColumnStarts[nBlockColumn];
+				ptBlocks->anSums[nBlock] += (ULONGLONG)vgafingerprint_CountSpanBits(pnSpan, cbSpan) << nPlane;
+			}
+			ptBlocks->anPixels[nBlock] += cbSpan * PIXELS_IN_BYTE;
+		}
+	}
+}
+
+/**
+ * Accumulates the blocks of a text mode screen.
+ * Each character cell falls entirely in one block.
+ *
+ * @param[in]	ptScreen	The screen.
+ * @param[out]	ptBlocks	The blocks to update.
+ */
+STATIC
+VOID
+vgafingerprint_AddText(
+	_In_	PCVGA_TEXT_SCREEN		ptScreen,
+	_Inout_	PVGAFINGERPRINT_BLOCKS	ptBlocks
+)
+{
+	DWORD			nCellPixels	= PIXELS_IN_BYTE * ptScreen->nCharHeight;
+	DWORD			nRow		= 0;
+	DWORD			nColumn		= 0;
+	DWORD			nBlock		= 0;
+	CONST BYTE *	pnCell		= ptScreen->pnText;
+	DWORD			nInk		= 0;
+	BYTE			nForeground	= 0;
+	BYTE			nBackground	= 0;
+
+	for (nRow = 0; nRow < ptScreen->nRows; ++nRow)
+	{
+		for (nColumn = 0; nColumn < ptScreen->nColumns; ++nColumn)
+		{
+			nBlock = (vgafingerprint_GetBlock(nRow, ptScreen->nRows) * VGA_FINGERPRINT_GRID) +
+					 vgafingerprint_GetBlock(nColumn, ptScreen->nColumns);
+
+			// Same colors as VGADECODE_RenderText.
+			nForeground = pnCell[1] & 0x0F;
+			nBackground = (pnCell[1] >> 4) & (ptScreen->bBlinkEnabled ? 0x07 : 0x0F);
+			nInk = vgafingerprint_CountSpanBits(ptScreen->pnFont + (pnCell[0] * ptScreen->nCharHeight),
+												ptScreen->nCharHeight);
+
+			ptBlocks->anSums[nBlock] += (nInk * nForeground) + ((nCellPixels - nInk) * nBackground);
+			ptBlocks->anPixels[nBlock] += nCellPixels;
+
+			pnCell += VGA_TEXT_CELL_BYTES;
+		}
+	}
+}
+
+VOID
+VGAFINGERPRINT_FromCapture(
+	_In_	PCVGA_CAPTURE_VIEW	ptCapture,
+	_Out_	PVGA_FINGERPRINT	pnFingerprint
+)
+{
+	VGAFINGERPRINT_BLOCKS	tBlocks	= { { 0 } };
+
+	assert(NULL != ptCapture);
+	assert(NULL != pnFingerprint);
+
+	if (VGA_CAPTURE_MODE_TEXT == ptCapture->eMode)
+	{
+		vgafingerprint_AddText(&ptCapture->tText, &tBlocks);
+	}
+	else
+	{
+		vgafingerprint_AddGraphics(ptCapture, &tBlocks);
+	}
+
+	*pnFingerprint = vgafingerprint_Finish(&tBlocks);
+}
+
+HRESULT
+VGAFINGERPRINT_FromBitmap(
+	_In_reads_bytes_(cbBitmap)	LPCVOID				pvBitmap,
+	_In_						DWORD				cbBitmap,
+	_Out_						PVGA_FINGERPRINT	pnFingerprint
+)
+{
+	HRESULT						hrResult		= E_FAIL;
+	CONST BITMAPFILEHEADER *	ptFileHeader	= (CONST BITMAPFILEHEADER *)pvBitmap;
+	CONST BITMAPINFOHEADER *	ptInfoHeader	= NULL;
+	VGAFINGERPRINT_BLOCKS		tBlocks			= { { 0 } };
+	DWORD						nWidth			= 0;
+	DWORD						nHeight			= 0;
+	DWORD						cbRow			= 0;
+	DWORD						cbPlaneRow		= 0;
+	DWORD						cbPixels		= 0;
+	CONST BYTE *				pnRow			= NULL;
+	DWORD						nY				= 0;
+	DWORD						nX				= 0;
+	DWORD						nBlock			= 0;
+	DWORD						cbRowBits		= 0;
+	BYTE						nPixel			= 0;
+	WORD						nBitsPerPixel	= 0;
+	BOOL						bBottomUp		= FALSE;
+	CONST BYTE *				pnPixels		= NULL;
+	PBYTE						pnExpanded		= NULL;
+
+	if ((NULL == pvBitmap) ||
+		(NULL == pnFingerprint))
+	{
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+
+	if ((sizeof(BITMAPFILEHEADER) + sizeof(BITMAPINFOHEADER) > cbBitmap) ||
+		(MAKEWORD('B', 'M') != ptFileHeader->bfType))
+	{
+		PROGRESS("Not a BMP file.");
+		hrResult = HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+		goto lblCleanup;
+	}
+
+	ptInfoHeader = (CONST BITMAPINFOHEADER *)(ptFileHeader + 1);
+	if (((4 != ptInfoHeader->biBitCount) && (8 != ptInfoHeader->biBitCount)) ||
+		((BI_RGB != ptInfoHeader->biCompression) &&
+		 ((4 == ptInfoHeader->biBitCount) ? BI_RLE4 : BI_RLE8) != ptInfoHeader->biCompression) ||
+		(0 >= ptInfoHeader->biWidth) ||
+		(0 == ptInfoHeader->biHeight) ||
+		(-MAXLONG > ptInfoHeader->biHeight))
+	{
+		PROGRESS("Only 4bpp and 8bpp BMPs are supported.");
+		hrResult = HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+		goto lblCleanup;
+	}
+
+	nWidth = (DWORD)ptInfoHeader->biWidth;
+	nHeight = (DWORD)((0 > ptInfoHeader->biHeight) ? -ptInfoHeader->biHeight : ptInfoHeader->biHeight);
+	nBitsPerPixel = ptInfoHeader->biBitCount;
+	bBottomUp = (0 < ptInfoHeader->biHeight);
+
+	if (ptFileHeader->bfOffBits > cbBitmap)
+	{
+		PROGRESS("The BMP is truncated.");
+		hrResult = HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+		goto lblCleanup;
+	}
+	pnPixels = (CONST BYTE *)pvBitmap + ptFileHeader->bfOffBits;
+
+	if (BI_RGB != ptInfoHeader->biCompression)
+	{
+		// Expand the runs to 8bpp, and take it from there.
+		if (FAILED(DWordMult(nWidth, nHeight, &cbPixels)))
+		{
+			PROGRESS("The BMP is too big.");
+			hrResult = HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+			goto lblCleanup;
+		}
+
+		pnExpanded = HEAPALLOC(cbPixels);
+		if (NULL == pnExpanded)
+		{
+			PROGRESS("Oops. Ran out of memory.");
+			hrResult = E_OUTOFMEMORY;
+			goto lblCleanup;
+		}
+
+		hrResult = VGARLE_Expand(pnPixels,
+								 cbBitmap - ptFileHeader->bfOffBits,
+								 nBitsPerPixel,
+								 nWidth,
+								 nHeight,
+								 pnExpanded,
+								 nWidth);
+		if (FAILED(hrResult))
+		{
+			goto lblCleanup;
+		}
+
+		pnPixels = pnExpanded;
+		cbRow = nWidth;
+		nBitsPerPixel = 8;
+		bBottomUp = FALSE;
+	}
+	else
+	{
+		// Rows are padded to a multiple of 4 bytes.
+		if (FAILED(DWordMult(nWidth, nBitsPerPixel, &cbRowBits)) ||
+			FAILED(DWordAdd(cbRowBits, 31, &cbRowBits)) ||
+			FAILED(DWordMult((cbRowBits / 32), sizeof(DWORD), &cbRow)) ||
+			FAILED(DWordMult(cbRow, nHeight, &cbPixels)) ||
+			(cbPixels > cbBitmap - ptFileHeader->bfOffBits))
+		{
+			PROGRESS("The BMP is truncated.");
+			hrResult = HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+			goto lblCleanup;
+		}
+	}
+
+	cbPlaneRow = nWidth / PIXELS_IN_BYTE;
+	for (nY = 0; nY < nHeight; ++nY)
+	{
+		// Positive heights mean the bottom row comes first.
+		pnRow = pnPixels + (cbRow * (bBottomUp ? (nHeight - 1 - nY) : nY));
+
+		// Blocks are divided the same way as in vgafingerprint_AddGraphics.
+		for (nX = 0; nX < cbPlaneRow * PIXELS_IN_BYTE; ++nX)
+		{
+			nBlock = (vgafingerprint_GetBlock(nY, nHeight) * VGA_FINGERPRINT_GRID) +
+					 vgafingerprint_GetBlock(nX / PIXELS_IN_BYTE, cbPlaneRow);
+			if (8 == nBitsPerPixel)
+			{
+				nPixel = pnRow[nX];
+			}
+			else
+			{
+				// The leftmost pixel of each pair is in the high nibble.
+				nPixel = (pnRow[nX / 2] >> ((0 == nX % 2) ? 4 : 0)) & 0x0F;
+			}
+			tBlocks.anSums[nBlock] += nPixel;
+			++(tBlocks.anPixels[nBlock]);
+		}
+	}
+
+	*pnFingerprint = vgafingerprint_Finish(&tBlocks);
+
+	hrResult = S_OK;
+
+lblCleanup:
+	HEAPFREE(pnExpanded);
+
+	return hrResult;
+}
+
+DWORD
+VGAFINGERPRINT_Distance(
+	_In_	VGA_FINGERPRINT	nFirst,
+	_In_	VGA_FINGERPRINT	nSecond
+)
+{
+	return vgafingerprint_CountBits(nFirst ^ nSecond);
+}
+
+/**
+ * Finds the first fingerprint in a fingerprint's group.
+ *
+ * @param[in,out]	pnParents	The union-find forest.
+ * @param[in]		nIndex		The fingerprint.
+ *
+ * @returns DWORD
+ */
+STATIC
+FORCEINLINE
+DWORD
+vgafingerprint_FindRoot(
+	_Inout_	PDWORD	pnParents,
+	_In_	DWORD	nIndex
+)
+{
+	// Path halving keeps the trees flat.
+	while (pnParents[nIndex] != nIndex)
+	{
+		pnParents[nIndex] = pnParents[pnParents[nIndex]];
+		nIndex = pnParents[nIndex];
+	}
+
+	return nIndex;
+}
+
+/**
+ * Extracts a chunk of a fingerprint and hashes it into a bucket.
+ *
+ * @param[in]	nFingerprint	The fingerprint.
+ * @param[in]	nChunk			The chunk.
+ * @param[in]	nChunks			Number of chunks the fingerprint is split into.
+ *
+ * @returns DWORD
+ */
+STATIC
+FORCEINLINE
+DWORD
+vgafingerprint_GetBucket(
+	_In_	VGA_FINGERPRINT	nFingerprint,
+	_In_	DWORD			nChunk,
+	_In_	DWORD			nChunks
+)
+{
+	DWORD		nFirstBit	= (nChunk * VGA_FINGERPRINT_BITS) / nChunks;
+	DWORD		nLastBit	= ((nChunk + 1) * VGA_FINGERPRINT_BITS) / nChunks;
+	ULONGLONG	nValue		= nFingerprint >> nFirstBit;
+
+	if (nLastBit - nFirstBit < VGA_FINGERPRINT_BITS)
+	{
+		nValue &= (1ULL << (nLastBit - nFirstBit)) - 1;
+	}
+
+	// Chunks are told apart, so that equal values
+	// in different chunks don't share buckets.
+	return (DWORD)(((nValue + nChunk) * BUCKET_HASH_MULTIPLIER) >> (64 - BUCKET_BITS));
+}
+
+/**
+ * Sorts the fingerprints, and puts identical ones in one group
+ * without comparing them, rooted at the first of them.
+ *
+ * @param[in]		pnFingerprints	The fingerprints.
+ * @param[in]		nFingerprints	Number of fingerprints.
+ * @param[in,out]	pnCounts		Scratch space for BUCKETS counts.
+ * @param[in,out]	pnScratch		Scratch space for nFingerprints indices.
+ * @param[out]		pnDistinct		Will receive the index of the first
+ *									of each distinct fingerprint,
+ *									in ascending order.
+ * @param[out]		pnGroups		Will receive the union-find forest.
+ *
+ * @returns DWORD (the number of distinct fingerprints)
+ */
+STATIC
+DWORD
+vgafingerprint_CollapseIdentical(
+	_In_reads_(nFingerprints)		PCVGA_FINGERPRINT	pnFingerprints,
+	_In_							DWORD				nFingerprints,
+	_Inout_updates_(BUCKETS)		PDWORD				pnCounts,
+	_Inout_updates_(nFingerprints)	PDWORD				pnScratch,
+	_Out_writes_(nFingerprints)		PDWORD				pnDistinct,
+	_Out_writes_(nFingerprints)		PDWORD				pnGroups
+)
+{
+	PDWORD	pnFrom		= pnDistinct;
+	PDWORD	pnTo		= pnScratch;
+	PDWORD	pnSwap		= NULL;
+	DWORD	nShift		= 0;
+	DWORD	nIndex		= 0;
+	DWORD	nDigit		= 0;
+	DWORD	nDistinct	= 0;
+
+	for (nIndex = 0; nIndex < nFingerprints; ++nIndex)
+	{
+		pnFrom[nIndex] = nIndex;
+	}
+
+	// Radix sort, a bucket index at a time. Each pass is stable,
+	// so identical fingerprints stay in ascending order.
+	// There's an even number of passes, so the result
+	// ends up in pnDistinct.
+	for (nShift = 0; nShift < VGA_FINGERPRINT_BITS; nShift += BUCKET_BITS)
+	{
+		ZeroMemory(pnCounts, BUCKETS * sizeof(pnCounts[0]));
+		for (nIndex = 0; nIndex < nFingerprints; ++nIndex)
+		{
+			++(pnCounts[(DWORD)(pnFingerprints[nIndex] >> nShift) & (BUCKETS - 1)]);
+		}
+		for (nDigit = 1; nDigit < BUCKETS; ++nDigit)
+		{
+			pnCounts[nDigit] += pnCounts[nDigit - 1];
+		}
+		for (nIndex = nFingerprints; nIndex > 0; --nIndex)
+		{
+			nDigit = (DWORD)(pnFingerprints[pnFrom[nIndex - 1]] >> nShift) & (BUCKETS - 1);
+			pnTo[--(pnCounts[nDigit])] = pnFrom[nIndex - 1];
+		}
+
+		pnSwap = pnFrom;
+		pnFrom = pnTo;
+		pnTo = pnSwap;
+	}
+
+	// Each fingerprint joins the first one identical to it.
+	for (nIndex = 0; nIndex < nFingerprints; ++nIndex)
+	{
+		if ((0 != nIndex) &&
+			(pnFingerprints[pnDistinct[nIndex - 1]] == pnFingerprints[pnDistinct[nIndex]]))
+		{
+			pnGroups[pnDistinct[nIndex]] = pnGroups[pnDistinct[nIndex - 1]];
+		}
+		else
+		{
+			pnGroups[pnDistinct[nIndex]] = pnDistinct[nIndex];
+		}
+	}
+
+	// The first ones are listed in ascending order, so that the buckets
+	// are filled from the fingerprints in the order they're stored.
+	for (nIndex = 0; nIndex < nFingerprints; ++nIndex)
+	{
+		if (pnGroups[nIndex] == nIndex)
+		{
+			pnDistinct[nDistinct] = nIndex;
+			++nDistinct;
+		}
+	}
+
+	return nDistinct;
+}
+
+/**
+ * Groups the fingerprints in a bucket that are close enough.
+ *
+ * In all but small buckets, each fingerprint is compared with
+ * the groups already seen in the bucket, other than its own,
+ * rather than with every fingerprint before it, and only until
+ * one of a group's fingerprints is close enough. So fingerprints
+ * that are all close to one another cost about one comparison each,
+ * rather than one for each pair of them.
+ *
+ * @param[in]		pnEntries		Indices of the bucket's fingerprints.
+ * @param[in]		pnValues		The bucket's fingerprints.
+ * @param[in]		nEntries		Number of fingerprints in the bucket.
+ * @param[in]		nMaxDistance	Largest distance between fingerprints
+ *									in the same group.
+ * @param[in,out]	pnGroups		The union-find forest.
+ * @param[in,out]	pnNext			Scratch space for nEntries positions.
+ * @param[in,out]	ptGroups		Scratch space for nEntries groups.
+ */
+STATIC
+VOID
+vgafingerprint_GroupBucket(
+	_In_reads_(nEntries)		CONST DWORD *					pnEntries,
+	_In_reads_(nEntries)		PCVGA_FINGERPRINT				pnValues,
+	_In_						DWORD							nEntries,
+	_In_						DWORD							nMaxDistance,
+	_Inout_						PDWORD							pnGroups,
+	_Inout_updates_(nEntries)	PDWORD							pnNext,
+	_Inout_updates_(nEntries)	PVGAFINGERPRINT_BUCKET_GROUP	ptGroups
+)
+{
+	DWORD	nGroups		= 0;
+	DWORD	nEntry		= 0;
+	DWORD	nRoot		= 0;
+	DWORD	nOwnGroup	= 0;
+	DWORD	nGroup		= 0;
+	DWORD	nMember		= 0;
+	DWORD	nOtherRoot	= 0;
+
+	// The fingerprints are next to one another, and the forest isn't,
+	// so the roots are only looked up for pairs that are close enough.
+	if (BUCKET_PAIRWISE_MAX >= nEntries)
+	{
+		for (nEntry = 1; nEntry < nEntries; ++nEntry)
+		{
+			for (nMember = 0; nMember < nEntry; ++nMember)
+			{
+				if (nMaxDistance < VGAFINGERPRINT_Distance(pnValues[nEntry], pnValues[nMember]))
+				{
+					continue;
+				}
+
+				nRoot = vgafingerprint_FindRoot(pnGroups, pnEntries[nEntry]);
+				nOtherRoot = vgafingerprint_FindRoot(pnGroups, pnEntries[nMember]);
+				pnGroups[max(nRoot, nOtherRoot)] = min(nRoot, nOtherRoot);
+			}
+		}
+
+		return;
+	}
+
+	for (nEntry = 0; nEntry < nEntries; ++nEntry)
+	{
+		// The fingerprint's group may be in the bucket already,
+		// if it was joined through another chunk. The bucket is in
+		// ascending order, so not if the fingerprint is its root.
+		nRoot = vgafingerprint_FindRoot(pnGroups, pnEntries[nEntry]);
+		nOwnGroup = NO_POSITION;
+		if (nRoot != pnEntries[nEntry])
+		{
+			for (nGroup = 0; nGroup < nGroups; ++nGroup)
+			{
+				if (ptGroups[nGroup].nRoot == nRoot)
+				{
+					nOwnGroup = nGroup;
+					break;
+				}
+			}
+		}
+
+		nGroup = 0;
+		while (nGroup < nGroups)
+		{
+			if (nGroup == nOwnGroup)
+			{
+				++nGroup;
+				continue;
+			}
+
+			for (nMember = ptGroups[nGroup].nFirst; NO_POSITION != nMember; nMember = pnNext[nMember])
+			{
+				if (nMaxDistance >= VGAFINGERPRINT_Distance(pnValues[nEntry], pnValues[nMember]))
+				{
+					break;
+				}
+			}
+			if (NO_POSITION == nMember)
+			{
+				++nGroup;
+				continue;
+			}
+
+			// The root with the lower index wins, so every
+			// group ends up rooted at its first fingerprint.
+			nOtherRoot = ptGroups[nGroup].nRoot;
+			if (nRoot < nOtherRoot)
+			{
+				pnGroups[nOtherRoot] = nRoot;
+			}
+			else
+			{
+				pnGroups[nRoot] = nOtherRoot;
+				nRoot = nOtherRoot;
+			}
+
+			if (NO_POSITION == nOwnGroup)
+			{
+				// The fingerprint joins the group.
+				nOwnGroup = nGroup;
+				ptGroups[nOwnGroup].nRoot = nRoot;
+				++nGroup;
+				continue;
+			}
+
+			// The fingerprint joins the groups. The group that was found
+			// is appended to its own, and the last group takes its place.
+			ptGroups[nOwnGroup].nRoot = nRoot;
+			pnNext[ptGroups[nOwnGroup].nLast] = ptGroups[nGroup].nFirst;
+			ptGroups[nOwnGroup].nLast = ptGroups[nGroup].nLast;
+
+			--nGroups;
+			ptGroups[nGroup] = ptGroups[nGroups];
+			if (nOwnGroup == nGroups)
+			{
+				nOwnGroup = nGroup;
+			}
+		}
+
+		if (NO_POSITION == nOwnGroup)
+		{
+			nOwnGroup = nGroups;
+			++nGroups;
+			ptGroups[nOwnGroup].nRoot = nRoot;
+			ptGroups[nOwnGroup].nFirst = nEntry;
+		}
+		else
+		{
+			pnNext[ptGroups[nOwnGroup].nLast] = nEntry;
+		}
+		ptGroups[nOwnGroup].nLast = nEntry;
+		pnNext[nEntry] = NO_POSITION;
+	}
+}
+
+HRESULT
+VGAFINGERPRINT_Group(
+	_In_reads_(nFingerprints)	PCVGA_FINGERPRINT	pnFingerprints,
+	_In_						DWORD				nFingerprints,
+	_In_						DWORD				nMaxDistance,
+	_Out_writes_(nFingerprints)	PDWORD				pnGroups
+)
+{
+	HRESULT							hrResult		= E_FAIL;
+	PDWORD							pnBucketStarts	= NULL;
+	PDWORD							pnDistinct		= NULL;
+	PDWORD							pnEntries		= NULL;
+	PVGA_FINGERPRINT				pnValues		= NULL;
+	PDWORD							pnNext			= NULL;
+	PVGAFINGERPRINT_BUCKET_GROUP	ptGroups		= NULL;
+	DWORD							nDistinct		= 0;
+	DWORD							nChunks			= nMaxDistance + 1;
+	DWORD							nChunk			= 0;
+	DWORD							nIndex			= 0;
+	DWORD							nBucket			= 0;
+	DWORD							nBucketStart	= 0;
+	DWORD							nBucketEnd		= 0;
+
+	if (((NULL == pnFingerprints) && (0 != nFingerprints)) ||
+		((NULL == pnGroups) && (0 != nFingerprints)) ||
+		(VGA_FINGERPRINT_MAX_DISTANCE < nMaxDistance))
+	{
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+
+	pnBucketStarts = HEAPALLOC(BUCKETS * sizeof(pnBucketStarts[0]));
+	pnDistinct = HEAPALLOC(max(nFingerprints, 1) * sizeof(pnDistinct[0]));
+	pnEntries = HEAPALLOC(max(nFingerprints, 1) * sizeof(pnEntries[0]));
+	pnValues = HEAPALLOC(max(nFingerprints, 1) * sizeof(pnValues[0]));
+	pnNext = HEAPALLOC(max(nFingerprints, 1) * sizeof(pnNext[0]));
+	ptGroups = HEAPALLOC(max(nFingerprints, 1) * sizeof(ptGroups[0]));
+	if ((NULL == pnBucketStarts) ||
+		(NULL == pnDistinct) ||
+		(NULL == pnEntries) ||
+		(NULL == pnValues) ||
+		(NULL == pnNext) ||
+		(NULL == ptGroups))
+	{
+		PROGRESS("Oops. Ran out of memory.");
+		hrResult = E_OUTOFMEMORY;
+		goto lblCleanup;
+	}
+
+	// Identical fingerprints never need comparing,
+	// so only the first of each is indexed.
+	nDistinct = vgafingerprint_CollapseIdentical(pnFingerprints,
+												 nFingerprints,
+												 pnBucketStarts,
+												 pnEntries,
+												 pnDistinct,
+												 pnGroups);
+
+	for (nChunk = 0; nChunk < nChunks; ++nChunk)
+	{
+		// Sort the fingerprints into buckets by the chunk (counting sort).
+		// Counting leaves the end of each bucket in pnBucketStarts.
+		ZeroMemory(pnBucketStarts, BUCKETS * sizeof(pnBucketStarts[0]));
+		for (nIndex = 0; nIndex < nDistinct; ++nIndex)
+		{
+			++(pnBucketStarts[vgafingerprint_GetBucket(pnFingerprints[pnDistinct[nIndex]], nChunk, nChunks)]);
+		}
+		for (nBucket = 1; nBucket < BUCKETS; ++nBucket)
+		{
+			pnBucketStarts[nBucket] += pnBucketStarts[nBucket - 1];
+		}
+
+		// Filling each bucket from its end leaves the start
+		// of each bucket in pnBucketStarts. The fingerprints
+		// are copied along, so that each bucket's are together.
+		for (nIndex = nDistinct; nIndex > 0; --nIndex)
+		{
+			nBucket = vgafingerprint_GetBucket(pnFingerprints[pnDistinct[nIndex - 1]], nChunk, nChunks);
+			--(pnBucketStarts[nBucket]);
+			pnEntries[pnBucketStarts[nBucket]] = pnDistinct[nIndex - 1];
+			pnValues[pnBucketStarts[nBucket]] = pnFingerprints[pnDistinct[nIndex - 1]];
+		}
+
+		// Only fingerprints in the same bucket can be close enough.
+		for (nBucket = 0; nBucket < BUCKETS; ++nBucket)
+		{
+			nBucketStart = pnBucketStarts[nBucket];
+			nBucketEnd = (BUCKETS - 1 == nBucket) ? nDistinct : pnBucketStarts[nBucket + 1];
+			if (2 > nBucketEnd - nBucketStart)
+			{
+				continue;
+			}
+
+			vgafingerprint_GroupBucket(pnEntries + nBucketStart,
+									   pnValues + nBucketStart,
+									   nBucketEnd - nBucketStart,
+									   nMaxDistance,
+									   pnGroups,
+									   pnNext,
+									   ptGroups);
+		}
+	}
+
+	for (nIndex = 0; nIndex < nFingerprints; ++nIndex)
+	{
+		pnGroups[nIndex] = vgafingerprint_FindRoot(pnGroups, nIndex);
+	}
+
+	hrResult = S_OK;
+
+lblCleanup:
+	HEAPFREE(ptGroups);
+	HEAPFREE(pnNext);
+	HEAPFREE(pnValues);
+	HEAPFREE(pnEntries);
+	HEAPFREE(pnDistinct);
+	HEAPFREE(pnBucketStarts);
+
+	return hrResult;
+}
@@ -0,0 +1,119 @@
+/**
+ * @file VgaFingerprint.h
+ * @author biko
+ * @date 2026-10-17
+ *
+ * VgaFingerprint module public header.
+ * Contains routines for fingerprinting captured screens,
+ * so that near-duplicates can be found quickly.
+ */
+#pragma once
+
+/** Headers *************************************************************/
+#include <Windows.h>
+
+#include "VgaCapture.h"
+
+
+/** Constants ***********************************************************/
+
+/**
+ * The screen is divided into a grid of
+ * VGA_FINGERPRINT_GRID x VGA_FINGERPRINT_GRID blocks,
+ * each providing a bit of the fingerprint.
+ */
+#define VGA_FINGERPRINT_GRID (8)
+#define VGA_FINGERPRINT_BITS (VGA_FINGERPRINT_GRID * VGA_FINGERPRINT_GRID)
+
+/**
+ * Largest Hamming distance supported by VGAFINGERPRINT_Group.
+ */
+#define VGA_FINGERPRINT_MAX_DISTANCE (15)
+
+
+/** Typedefs ************************************************************/
+
+/**
+ * A screen's fingerprint.
+ * Bit N is set if block N (row-major) is brighter,
+ * in terms of pixel values, than the average block.
+ */
+typedef ULONGLONG VGA_FINGERPRINT, *PVGA_FINGERPRINT;
+typedef CONST VGA_FINGERPRINT *PCVGA_FINGERPRINT;
+
+
+/** Functions ***********************************************************/
+
+/**
+ * Fingerprints a captured screen.
+ * Graphics mode screens are fingerprinted by counting
+ * the bits of each plane, without decoding the pixels.
+ *
+ * @param[in]	ptCapture		The capture.
+ * @param[out]	pnFingerprint	Will receive the fingerprint.
+ */
+VOID
+VGAFINGERPRINT_FromCapture(
+	_In_	PCVGA_CAPTURE_VIEW	ptCapture,
+	_Out_	PVGA_FINGERPRINT	pnFingerprint
+);
+
+/**
+ * Fingerprints a paletted (4bpp or 8bpp) BMP, such as the ones
+ * written by the "convert" subfunction.
+ * Pixel values are used as-is, so the fingerprints
+ * match those of the captures the BMPs were converted from.
+ *
+ * @param[in]	pvBitmap		The BMP file.
+ * @param[in]	cbBitmap		Size of the BMP file, in bytes.
+ * @param[out]	pnFingerprint	Will receive the fingerprint.
+ *
+ * @returns HRESULT
+ */
+HRESULT
+VGAFINGERPRINT_FromBitmap(
+	_In_reads_bytes_(cbBitmap)	LPCVOID				pvBitmap,
+	_In_						DWORD				cbBitmap,
+	_Out_						PVGA_FINGERPRINT	pnFingerprint
+);
+
+/**
+ * Calculates the Hamming distance between two fingerprints.
+ *
+ * @param[in]	nFirst	The first fingerprint.
+ * @param[in]	nSecond	The second fingerprint.
+ *
+ * @returns DWORD
+ */
+DWORD
+VGAFINGERPRINT_Distance(
+	_In_	VGA_FINGERPRINT	nFirst,
+	_In_	VGA_FINGERPRINT	nSecond
+);
+
+/**
+ * Groups fingerprints that are within a Hamming distance
+ * of one another (transitively).
+ *
+ * Avoids comparing all the pairs by splitting the fingerprints
+ * into nMaxDistance + 1 chunks and indexing each chunk:
+ * fingerprints within the distance must agree on at least one chunk,
+ * so only fingerprints that share a bucket are compared.
+ *
+ * @param[in]	pnFingerprints	The fingerprints.
+ * @param[in]	nFingerprints	Number of fingerprints.
+ * @param[in]	nMaxDistance	Largest distance between fingerprints
+ *								in the same group.
+ * @param[out]	pnGroups		Will receive, for each fingerprint,
+ *								the index of the first fingerprint
+ *								in its group.
+ *
+ * @returns HRESULT
+ */
+HRESULT
+VGAFINGERPRINT_Group(
+	_In_reads_(nFingerprints)	PCVGA_FINGERPRINT	pnFingerprints,
+	_In_						DWORD				nFingerprints,
+	_In_						DWORD				nMaxDistance,
+	_Out_writes_(nFingerprints)	PDWORD				pnGroups
+);
@@ -0,0 +1,723 @@
+/**
+ * @file VgaGif.c
+ * @author biko
+ * @date 2026-10-17
+ *
+ * VgaGif module implementation.
+ */
+
+/** Headers *************************************************************/
+#include <Windows.h>
+
+#include <assert.h>
+
+#include "Util.h"
+#include "Debug.h"
+
+#include "VgaGif.h"
+
+
+/** Constants ***********************************************************/
+
+/**
+ * The GIF header. Animations need the 89a version.
+ */
+#define GIF_SIGNATURE ("GIF89a")
+#define GIF_SIGNATURE_SIZE (6)
+
+/**
+ * Block introducers, extension labels and the trailer.
+ */
+#define GIF_EXTENSION_INTRODUCER (0x21)
+#define GIF_IMAGE_SEPARATOR (0x2C)
+#define GIF_TRAILER (0x3B)
+#define GIF_GRAPHIC_CONTROL_LABEL (0xF9)
+#define GIF_APPLICATION_LABEL (0xFF)
+
+/**
+ * Flags of the logical screen and image descriptors.
+ * A color table of 2^(n+1) entries has a size field of n.
+ */
+#define GIF_COLOR_TABLE_PRESENT (0x80)
+#define GIF_COLOR_RESOLUTION_8BIT (0x70)
+#define GIF_COLOR_TABLE_SIZE_FIELD (VGA_PLANES - 1)
+
+/**
+ * Size of a 16 color table, in bytes.
+ */
+#define GIF_COLOR_TABLE_SIZE (VGA_COLORS * 3)
+
+/**
+ * Sizes of the logical screen descriptor, the image descriptor
+ * and the graphic control extension, in bytes.
+ */
+#define GIF_SCREEN_DESCRIPTOR_SIZE (7)
+#define GIF_IMAGE_DESCRIPTOR_SIZE (10)
+#define GIF_GRAPHIC_CONTROL_SIZE (8)
+
+/**
+ * The graphic control extension's flags: leave each frame
+ * in place, for the next one to be drawn over it.
+ */
+#define GIF_DISPOSAL_NONE (1 << 2)
+
+/**
+ * The application extension that makes an animation loop forever.
+ */
+#define GIF_LOOP_EXTENSION_SIZE (19)
+
+/**
+ * Most bytes in a data sub-block.
+ */
+#define GIF_MAX_SUBBLOCK_SIZE (255)
+
+/**
+ * Pixel values take 4 bits, so those are the codes LZW starts out with.
+ * The two after them clear the dictionary and end the image.
+ */
+#define LZW_MIN_CODE_SIZE (VGA_PLANES)
+#define LZW_CLEAR_CODE (1 << LZW_MIN_CODE_SIZE)
+#define LZW_END_CODE (LZW_CLEAR_CODE + 1)
+#define LZW_FIRST_CODE (LZW_CLEAR_CODE + 2)
+
+/**
+ * Codes are at most 12 bits long. The last one is never assigned,
+ * so that the dictionary is cleared just as a decoder expects.
+ */
+#define LZW_MAX_CODE_SIZE (12)
+#define LZW_MAX_CODES (1 << LZW_MAX_CODE_SIZE)
+#define LZW_LAST_CODE (LZW_MAX_CODES - 1)
+
+/**
+ * Stands for no string at all, at the start of a frame.
+ */
+#define LZW_NO_CODE (MAXDWORD)
+
+
+/** Macros **************************************************************/
+
+/**
+ * The dictionary slot of a string that is another string
+ * followed by a pixel value.
+ */
+#define LZW_KEY(nPrefix, nValue) (((nPrefix) << LZW_MIN_CODE_SIZE) | (nValue))
+
+
+/** Typedefs ************************************************************/
+
+/**
+ * An animation being written.
+ */
+typedef struct _VGAGIF_CONTEXT
+{
+	DWORD		nWidth;
+	DWORD		nHeight;
+	HVGASTREAM	hStream;
+
+	// The colors of the global color table.
+	RGBQUAD		atPalette[VGA_COLORS];
+
+	// The size of the current frame, and how many
+	// of its rows were written. All 0 between frames.
+	DWORD		nFrameWidth;
+	DWORD		nFrameHeight;
+	DWORD		nRowsWritten;
+
+	// The string matched so far, the next code to assign,
+	// and how many bits codes currently take.
+	DWORD		nPrefix;
+	DWORD		nNextCode;
+	DWORD		nCodeSize;
+
+	// Bits not yet making up a whole byte, and the sub-block
+	// being filled, with its size in the first byte.
+	DWORD		nBits;
+	DWORD		nBitCount;
+	BYTE		anSubblock[1 + GIF_MAX_SUBBLOCK_SIZE];
+
+	// The code of every string in the dictionary, by its LZW_KEY,
+	// or 0 if it isn't in the dictionary, and the LZW_KEY
+	// of every code, to clear them with.
+	WORD		anCodes[LZW_MAX_CODES * VGA_COLORS];
+	WORD		anKeys[LZW_MAX_CODES];
+} VGAGIF_CONTEXT, *PVGAGIF_CONTEXT;
+typedef CONST VGAGIF_CONTEXT *PCVGAGIF_CONTEXT;
+
+
+/** Globals *************************************************************/
+
+/**
+ * The application extension that makes an animation loop forever:
+ * "NETSCAPE2.0", with a loop count of 0.
+ */
+STATIC CONST BYTE g_anLoopExtension[GIF_LOOP_EXTENSION_SIZE] = {
+	GIF_EXTENSION_INTRODUCER, GIF_APPLICATION_LABEL, 11,
+	'N', 'E', 'T', 'S', 'C', 'A', 'P', 'E', '2', '.', '0',
+	3, 1, 0, 0,
+	0
+};
+
+
+/** Functions ***********************************************************/
+
+/**
+ * Stores a WORD in little-endian byte order, as GIFs have it.
+ *
+ * @param[out]	pnData		Where to store the value.
+ * @param[in]	nValue		The value.
+ */
+STATIC
+VOID
+vgagif_StoreWord(
+	_Out_writes_(sizeof(WORD))	PBYTE	pnData,
+	_In_						DWORD	nValue
+)
+{
+	assert(NULL != pnData);
+	assert(MAXWORD >= nValue);
+
+	pnData[0] = (BYTE)nValue;
+	pnData[1] = (BYTE)(nValue >> 8);
+}
+
+/**
+ * Writes a color table.
+ *
+ * @param[in]	ptContext	The animation.
+ * @param[in]	ptPalette	The colors of the VGA_COLORS pixel values.
+ *
+ * @returns HRESULT
+ */
+STATIC
+HRESULT
+vgagif_WriteColorTable(
+	_In_					PCVGAGIF_CONTEXT	ptContext,
+	_In_reads_(VGA_COLORS)	CONST RGBQUAD *		ptPalette
+)
+{
+	BYTE	anColors[GIF_COLOR_TABLE_SIZE]	= { 0 };
+	DWORD	nValue							= 0;
+
+	assert(NULL != ptContext);
+	assert(NULL != ptPalette);
+
+	for (nValue = 0; nValue < VGA_COLORS; ++nValue)
+	{
+		anColors[(nValue * 3) + 0] = ptPalette[nValue].rgbRed;
+		anColors[(nValue * 3) + 1] = ptPalette[nValue].rgbGreen;
+		anColors[(nValue * 3) + 2] = ptPalette[nValue].rgbBlue;
+	}
+
+	return VGASTREAM_Write(ptContext->hStream, anColors, sizeof(anColors));
+}
+
+/**
+ * Writes out the sub-block being filled, if it has anything in it.
+ *
+ * @param[in]	ptContext	The animation.
+ *
+ * @returns HRESULT
+ */
+STATIC
+HRESULT
+vgagif_FlushSubblock(
+	_Inout_	PVGAGIF_CONTEXT	ptContext
+)
+{
+	HRESULT	hrResult	= E_FAIL;
+
+	assert(NULL != ptContext);
+
+	if (0 != ptContext->anSubblock[0])
+	{
+		hrResult = VGASTREAM_Write(ptContext->hStream,
+								   ptContext->anSubblock,
+								   1 + ptContext->anSubblock[0]);
+		if (FAILED(hrResult))
+		{
+			goto lblCleanup;
+		}
+		ptContext->anSubblock[0] = 0;
+	}
+
+	hrResult = S_OK;
+
+lblCleanup:
+	return hrResult;
+}
+
+/**
+ * Writes a code, least significant bit first.
+ *
+ * @param[in]	ptContext	The animation.
+ * @param[in]	nCode		The code.
+ *
+ * @returns HRESULT
+ */
+STATIC
+HRESULT
+vgagif_WriteCode(
+	_Inout_	PVGAGIF_CONTEXT	ptContext,
+	_In_	DWORD			nCode
+)
+{
+	HRESULT	hrResult	= S_OK;
+
+	assert(NULL != ptContext);
+	assert(nCode < (1UL << ptContext->nCodeSize));
+
+	ptContext->nBits |= nCode << ptContext->nBitCount;
+	ptContext->nBitCount += ptContext->nCodeSize;
+	while (8 <= ptContext->nBitCount)
+	{
+		ptContext->anSubblock[1 + ptContext->anSubblock[0]] = (BYTE)ptContext->nBits;
+		++ptContext->anSubblock[0];
+		ptContext->nBits >>= 8;
+		ptContext->nBitCount -= 8;
+
+		if (GIF_MAX_SUBBLOCK_SIZE == ptContext->anSubblock[0])
+		{
+			hrResult = vgagif_FlushSubblock(ptContext);
+			if (FAILED(hrResult))
+			{
+				break;
+			}
+		}
+	}
+
+	return hrResult;
+}
+
+/**
+ * Empties the dictionary, leaving only the pixel values.
+ * Only the codes assigned since it was last emptied are cleared.
+ *
+ * @param[in]	ptContext	The animation.
+ */
+STATIC
+VOID
+vgagif_ResetDictionary(
+	_Inout_	PVGAGIF_CONTEXT	ptContext
+)
+{
+	DWORD	nCode	= 0;
+
+	assert(NULL != ptContext);
+
+	for (nCode = LZW_FIRST_CODE; nCode < ptContext->nNextCode; ++nCode)
+	{
+		ptContext->anCodes[ptContext->anKeys[nCode]] = 0;
+	}
+	ptContext->nNextCode = LZW_FIRST_CODE;
+	ptContext->nCodeSize = LZW_MIN_CODE_SIZE + 1;
+}
+
+/**
+ * Writes the code of the string matched so far.
+ * Codes grow by a bit as soon as a decoder, which assigns
+ * each code a step after the encoder does, could need it.
+ *
+ * @param[in]	ptContext	The animation.
+ *
+ * @returns HRESULT
+ */
+STATIC
+HRESULT
+vgagif_WritePrefix(
+	_Inout_	PVGAGIF_CONTEXT	ptContext
+)
+{
+	HRESULT	hrResult	= E_FAIL;
+
+	assert(NULL != ptContext);
+	assert(LZW_NO_CODE != ptContext->nPrefix);
+
+	hrResult = vgagif_WriteCode(ptContext, ptContext->nPrefix);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	if ((ptContext->nNextCode >= (1UL << ptContext->nCodeSize)) &&
+		(LZW_MAX_CODE_SIZE > ptContext->nCodeSize))
+	{
+		++ptContext->nCodeSize;
+	}
+
+	hrResult = S_OK;
+
+lblCleanup:
+	return hrResult;
+}
+
+/**
+ * Ends the current frame: writes the last string,
+ * the end code, and whatever bits are left.
+ *
+ * @param[in]	ptContext	The animation.
+ *
+ * @returns HRESULT
+ */
+STATIC
+HRESULT
+vgagif_EndFrame(
+	_Inout_	PVGAGIF_CONTEXT	ptContext
+)
+{
+	HRESULT	hrResult	= E_FAIL;
+	BYTE	nTerminator	= 0;
+
+	assert(NULL != ptContext);
+
+	hrResult = vgagif_WritePrefix(ptContext);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+	hrResult = vgagif_WriteCode(ptContext, LZW_END_CODE);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	// The last byte is padded with zeros. Full sub-blocks
+	// were already written, so there is room for it.
+	if (0 != ptContext->nBitCount)
+	{
+		ptContext->anSubblock[1 + ptContext->anSubblock[0]] = (BYTE)ptContext->nBits;
+		++ptContext->anSubblock[0];
+	}
+	ptContext->nBits = 0;
+	ptContext->nBitCount = 0;
+
+	hrResult = vgagif_FlushSubblock(ptContext);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+	hrResult = VGASTREAM_Write(ptContext->hStream, &nTerminator, sizeof(nTerminator));
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	ptContext->nFrameWidth = 0;
+	ptContext->nFrameHeight = 0;
+	ptContext->nRowsWritten = 0;
+
+	hrResult = S_OK;
+
+lblCleanup:
+	return hrResult;
+}
+
+HRESULT
+VGAGIF_Create(
+	_In_					DWORD			nWidth,
+	_In_					DWORD			nHeight,
+	_In_reads_(VGA_COLORS)	CONST RGBQUAD *	ptPalette,
+	_In_					HVGASTREAM		hStream,
+	_Out_					PHVGAGIF		phGif
+)
+{
+	HRESULT			hrResult										= E_FAIL;
+	PVGAGIF_CONTEXT	ptContext										= NULL;
+	BYTE			anScreenDescriptor[GIF_SCREEN_DESCRIPTOR_SIZE]	= { 0 };
+
+	if ((0 == nWidth) ||
+		(MAXWORD < nWidth) ||
+		(0 == nHeight) ||
+		(MAXWORD < nHeight) ||
+		(NULL == ptPalette) ||
+		(NULL == hStream) ||
+		(NULL == phGif))
+	{
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+
+	ptContext = HEAPALLOC(sizeof(*ptContext));
+	if (NULL == ptContext)
+	{
+		PROGRESS("Oops. Ran out of memory.");
+		hrResult = E_OUTOFMEMORY;
+		goto lblCleanup;
+	}
+	ptContext->nWidth = nWidth;
+	ptContext->nHeight = nHeight;
+	ptContext->hStream = hStream;
+	CopyMemory(ptContext->atPalette, ptPalette, sizeof(ptContext->atPalette));
+	ptContext->nNextCode = LZW_FIRST_CODE;
+
+	hrResult = VGASTREAM_Write(hStream, GIF_SIGNATURE, GIF_SIGNATURE_SIZE);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	vgagif_StoreWord(anScreenDescriptor + 0, nWidth);
+	vgagif_StoreWord(anScreenDescriptor + 2, nHeight);
+	anScreenDescriptor[4] = GIF_COLOR_TABLE_PRESENT |
+							GIF_COLOR_RESOLUTION_8BIT |
+							GIF_COLOR_TABLE_SIZE_FIELD;
+	hrResult = VGASTREAM_Write(hStream, anScreenDescriptor, sizeof(anScreenDescriptor));
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	hrResult = vgagif_WriteColorTable(ptContext, ptPalette);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	hrResult = VGASTREAM_Write(hStream, g_anLoopExtension, sizeof(g_anLoopExtension));
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	// Transfer ownership:
+	*phGif = (HVGAGIF)ptContext;
+	ptContext = NULL;
+
+	hrResult = S_OK;
+
+lblCleanup:
+	VGAGIF_Destroy((HVGAGIF)ptContext);
+
+	return hrResult;
+}
+
+HRESULT
+VGAGIF_StartFrame(
+	_In_					HVGAGIF			hGif,
+	_In_					CONST RECT *	ptFrame,
+	_In_reads_(VGA_COLORS)	CONST RGBQUAD *	ptPalette,
+	_In_					WORD			nDelay
+)
+{
+	HRESULT			hrResult										= E_FAIL;
+	PVGAGIF_CONTEXT	ptContext										= (PVGAGIF_CONTEXT)hGif;
+	BOOL			bLocalColors									= FALSE;
+	BYTE			anGraphicControl[GIF_GRAPHIC_CONTROL_SIZE]		= { 0 };
+	BYTE			anImageDescriptor[GIF_IMAGE_DESCRIPTOR_SIZE]	= { 0 };
+	BYTE			nMinCodeSize									= LZW_MIN_CODE_SIZE;
+
+	if ((NULL == hGif) ||
+		(NULL == ptFrame) ||
+		(NULL == ptPalette) ||
+		(0 > ptFrame->left) ||
+		(0 > ptFrame->top) ||
+		(ptFrame->left >= ptFrame->right) ||
+		(ptFrame->top >= ptFrame->bottom) ||
+		((LONG)ptContext->nWidth < ptFrame->right) ||
+		((LONG)ptContext->nHeight < ptFrame->bottom))
+	{
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+
+	if (0 != ptContext->nFrameHeight)
+	{
+		hrResult = E_UNEXPECTED;
+		goto lblCleanup;
+	}
+
+	anGraphicControl[0] = GIF_EXTENSION_INTRODUCER;
+	anGraphicControl[1] = GIF_GRAPHIC_CONTROL_LABEL;
+	anGraphicControl[2] = 4;
+	anGraphicControl[3] = GIF_DISPOSAL_NONE;
+	vgagif_StoreWord(anGraphicControl + 4, nDelay);
+	hrResult = VGASTREAM_Write(ptContext->hStream, anGraphicControl, sizeof(anGraphicControl));
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	// Frames with colors of their own carry them along.
+	bLocalColors = (0 != memcmp(ptPalette, ptContext->atPalette, sizeof(ptContext->atPalette)));
+	anImageDescriptor[0] = GIF_IMAGE_SEPARATOR;
+	vgagif_StoreWord(anImageDescriptor + 1, (DWORD)ptFrame->left);
+	vgagif_StoreWord(anImageDescriptor + 3, (DWORD)ptFrame->top);
+	vgagif_StoreWord(anImageDescriptor + 5, (DWORD)(ptFrame->right - ptFrame->left));
+	vgagif_StoreWord(anImageDescriptor + 7, (DWORD)(ptFrame->bottom - ptFrame->top));
+	anImageDescriptor[9] = bLocalColors
+						 ? (GIF_COLOR_TABLE_PRESENT | GIF_COLOR_TABLE_SIZE_FIELD)
+						 : 0;
+	hrResult = VGASTREAM_Write(ptContext->hStream, anImageDescriptor, sizeof(anImageDescriptor));
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	if (bLocalColors)
+	{
+		hrResult = vgagif_WriteColorTable(ptContext, ptPalette);
+		if (FAILED(hrResult))
+		{
+			goto lblCleanup;
+		}
+	}
+
+	hrResult = VGASTREAM_Write(ptContext->hStream, &nMinCodeSize, sizeof(nMinCodeSize));
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	// Every frame starts with an empty dictionary.
+	vgagif_ResetDictionary(ptContext);
+	ptContext->nPrefix = LZW_NO_CODE;
+	hrResult = vgagif_WriteCode(ptContext, LZW_CLEAR_CODE);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	ptContext->nFrameWidth = (DWORD)(ptFrame->right - ptFrame->left);
+	ptContext->nFrameHeight = (DWORD)(ptFrame->bottom - ptFrame->top);
+	ptContext->nRowsWritten = 0;
+
+	hrResult = S_OK;
+
+lblCleanup:
+	return hrResult;
+}
+
+HRESULT
+VGAGIF_WriteRow(
+	_In_	HVGAGIF			hGif,
+	_In_	CONST BYTE *	pnRow
+)
+{
+	HRESULT			hrResult	= E_FAIL;
+	PVGAGIF_CONTEXT	ptContext	= (PVGAGIF_CONTEXT)hGif;
+	DWORD			nPixel		= 0;
+	DWORD			nValue		= 0;
+	DWORD			nKey		= 0;
+	DWORD			nCode		= 0;
+
+	if ((NULL == hGif) ||
+		(NULL == pnRow))
+	{
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+
+	if (0 == ptContext->nFrameHeight)
+	{
+		hrResult = E_UNEXPECTED;
+		goto lblCleanup;
+	}
+
+	// Strings carry over from one row to the next.
+	for (nPixel = 0; nPixel < ptContext->nFrameWidth; ++nPixel)
+	{
+		nValue = pnRow[nPixel] & (VGA_COLORS - 1);
+		if (LZW_NO_CODE == ptContext->nPrefix)
+		{
+			ptContext->nPrefix = nValue;
+			continue;
+		}
+
+		nKey = LZW_KEY(ptContext->nPrefix, nValue);
+		nCode = ptContext->anCodes[nKey];
+		if (0 != nCode)
+		{
+			ptContext->nPrefix = nCode;
+			continue;
+		}
+
+		hrResult = vgagif_WritePrefix(ptContext);
+		if (FAILED(hrResult))
+		{
+			goto lblCleanup;
+		}
+
+		if (LZW_LAST_CODE > ptContext->nNextCode)
+		{
+			ptContext->anCodes[nKey] = (WORD)ptContext->nNextCode;
+			ptContext->anKeys[ptContext->nNextCode] = (WORD)nKey;
+			++ptContext->nNextCode;
+		}
+		else
+		{
+			// The dictionary is full, so start over.
+			hrResult = vgagif_WriteCode(ptContext, LZW_CLEAR_CODE);
+			if (FAILED(hrResult))
+			{
+				goto lblCleanup;
+			}
+			vgagif_ResetDictionary(ptContext);
+		}
+		ptContext->nPrefix = nValue;
+	}
+
+	++ptContext->nRowsWritten;
+	if (ptContext->nFrameHeight == ptContext->nRowsWritten)
+	{
+		hrResult = vgagif_EndFrame(ptContext);
+		if (FAILED(hrResult))
+		{
+			goto lblCleanup;
+		}
+	}
+
+	hrResult = S_OK;
+
+lblCleanup:
+	return hrResult;
+}
+
+HRESULT
+VGAGIF_Finish(
+	_In_	HVGAGIF	hGif
+)
+{
+	HRESULT			hrResult	= E_FAIL;
+	PVGAGIF_CONTEXT	ptContext	= (PVGAGIF_CONTEXT)hGif;
+	BYTE			nTrailer	= GIF_TRAILER;
+
+	if (NULL == hGif)
+	{
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+
+	if (0 != ptContext->nFrameHeight)
+	{
+		hrResult = E_UNEXPECTED;
+		goto lblCleanup;
+	}
+
+	hrResult = VGASTREAM_Write(ptContext->hStream, &nTrailer, sizeof(nTrailer));
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	hrResult = S_OK;
+
+lblCleanup:
+	return hrResult;
+}
+
+VOID
+VGAGIF_Destroy(
+	_In_	HVGAGIF	hGif
+)
+{
+	PVGAGIF_CONTEXT	ptContext	= (PVGAGIF_CONTEXT)hGif;
+
+	if (NULL == hGif)
+	{
+		goto lblCleanup;
+	}
+
+	HEAPFREE(ptContext);
+
+lblCleanup:
+	return;
+}
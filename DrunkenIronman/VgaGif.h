@@ -0,0 +1,119 @@
+/**
+ * @file VgaGif.h
+ * @author biko
+ * @date 2026-10-17
+ *
+ * VgaGif module public header.
+ * Contains routines for writing a sequence of screens to a stream
+ * as an animated 16 color GIF, where each frame only redraws
+ * the rectangle of the screen that changed.
+ */
+#pragma once
+
+/** Headers *************************************************************/
+#include <Windows.h>
+
+#include <Drink.h>
+
+#include "VgaStream.h"
+
+
+/** Typedefs ************************************************************/
+
+/**
+ * Handle to an animation being written.
+ */
+DECLARE_HANDLE(HVGAGIF);
+typedef HVGAGIF *PHVGAGIF;
+
+
+/** Functions ***********************************************************/
+
+/**
+ * Starts writing an animation that loops forever, and writes its header.
+ *
+ * @param[in]	nWidth		Width of the screen, in pixels.
+ * @param[in]	nHeight		Height of the screen, in pixels.
+ *							Both must fit in a WORD.
+ * @param[in]	ptPalette	The colors of the VGA_COLORS pixel values,
+ *							unless a frame has colors of its own.
+ * @param[in]	hStream		Where to write the animation.
+ *							Must outlive the animation.
+ * @param[out]	phGif		Will receive a handle to the animation.
+ *
+ * @returns HRESULT
+ */
+HRESULT
+VGAGIF_Create(
+	_In_					DWORD			nWidth,
+	_In_					DWORD			nHeight,
+	_In_reads_(VGA_COLORS)	CONST RGBQUAD *	ptPalette,
+	_In_					HVGASTREAM		hStream,
+	_Out_					PHVGAGIF		phGif
+);
+
+/**
+ * Starts the next frame of an animation. The frame is drawn
+ * over the previous one, so it need only cover what changed.
+ *
+ * @param[in]	hGif		The animation.
+ * @param[in]	ptFrame		The part of the screen the frame covers.
+ *							The right and bottom edges are exclusive.
+ * @param[in]	ptPalette	The colors of the frame's pixel values.
+ *							Only written if they differ from the
+ *							animation's.
+ * @param[in]	nDelay		How long to show the frame,
+ *							in hundredths of a second.
+ *
+ * @returns HRESULT
+ *
+ * @remark	The frame ends once all of its rows have been written.
+ */
+HRESULT
+VGAGIF_StartFrame(
+	_In_					HVGAGIF			hGif,
+	_In_					CONST RECT *	ptFrame,
+	_In_reads_(VGA_COLORS)	CONST RGBQUAD *	ptPalette,
+	_In_					WORD			nDelay
+);
+
+/**
+ * Writes the next row of the current frame, top row first.
+ * The row is compressed right away, so it need not be kept
+ * around afterwards.
+ *
+ * @param[in]	hGif		The animation.
+ * @param[in]	pnRow		The row's indexed pixels, one to a byte,
+ *							starting at the left edge of the frame.
+ *							Only the low nibble of each is used.
+ *
+ * @returns HRESULT
+ */
+HRESULT
+VGAGIF_WriteRow(
+	_In_	HVGAGIF			hGif,
+	_In_	CONST BYTE *	pnRow
+);
+
+/**
+ * Finishes an animation, once its last frame has ended.
+ * The stream is not flushed.
+ *
+ * @param[in]	hGif		The animation.
+ *
+ * @returns HRESULT
+ */
+HRESULT
+VGAGIF_Finish(
+	_In_	HVGAGIF	hGif
+);
+
+/**
+ * Discards an animation, finished or not.
+ *
+ * @param[in]	hGif		The animation.
+ */
+VOID
+VGAGIF_Destroy(
+	_In_	HVGAGIF	hGif
+);
@@ -0,0 +1,151 @@
+/**
+ * @file VgaImage.c
+ * @author biko
+ * @date 2026-10-17
+ *
+ * VgaImage module implementation.
+ */
+
+/** Headers *************************************************************/
+#include <Windows.h>
+#include <intsafe.h>
+
+#include <assert.h>
+
+#include <Drink.h>
+
+#include "Util.h"
+#include "Debug.h"
+#include "VgaDecode.h"
+
+#include "VgaImage.h"
+
+
+/** Constants ***********************************************************/
+
+/**
+ * Number of pixels packed into each byte of a 4bpp row.
+ */
+#define PIXELS_IN_NIBBLES_BYTE (2)
+
+
+/** Functions ***********************************************************/
+
+HRESULT
+VGAIMAGE_Decode(
+	_In_		PCVGA_CAPTURE_VIEW	ptCapture,
+	_Outptr_	PVGA_IMAGE *		pptImage
+)
+{
+	HRESULT		hrResult	= E_FAIL;
+	PVGA_IMAGE	ptImage		= NULL;
+	DWORD		cbStride	= 0;
+	DWORD		cbPixels	= 0;
+	DWORD		cbImage		= 0;
+
+	if ((NULL == ptCapture) ||
+		(NULL == pptImage))
+	{
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+
+	cbStride = (ptCapture->nWidth + 3) & ~3UL;
+	hrResult = DWordMult(cbStride, ptCapture->nHeight, &cbPixels);
+	if (FAILED(hrResult))
+	{
+		PROGRESS("The image is too big.");
+		goto lblCleanup;
+	}
+	hrResult = DWordAdd(FIELD_OFFSET(VGA_IMAGE, anPixels), cbPixels, &cbImage);
+	if (FAILED(hrResult))
+	{
+		PROGRESS("The image is too big.");
+		goto lblCleanup;
+	}
+
+	ptImage = HEAPALLOC(cbImage);
+	if (NULL == ptImage)
+	{
+		PROGRESS("Oops. Ran out of memory.");
+		hrResult = E_OUTOFMEMORY;
+		goto lblCleanup;
+	}
+	ptImage->nWidth = ptCapture->nWidth;
+	ptImage->nHeight = ptCapture->nHeight;
+	ptImage->cbStride = cbStride;
+
+	if (VGA_CAPTURE_MODE_TEXT == ptCapture->eMode)
+	{
+		VGADECODE_RenderText(&ptCapture->tText, ptImage->anPixels, cbStride);
+	}
+	else
+	{
+		VGADECODE_DecodeImage(ptCapture->apnPlanes,
+							  ptCapture->cbStride,
+							  ptCapture->nWidth,
+							  ptCapture->nHeight,
+							  ptImage->anPixels,
+							  cbStride,
+							  NULL);
+	}
+
+	// Transfer ownership:
+	*pptImage = ptImage;
+	ptImage = NULL;
+
+	hrResult = S_OK;
+
+lblCleanup:
+	HEAPFREE(ptImage);
+
+	return hrResult;
+}
+
+VOID
+VGAIMAGE_PackRows(
+	_In_									PCVGA_IMAGE	ptImage,
+	_In_									DWORD		nRow,
+	_In_									DWORD		nRows,
+	_Out_writes_(cbPixelStride * nRows)		PBYTE		pnPixels,
+	_In_									DWORD		cbPixelStride
+)
+{
+	DWORD			cbRow			= 0;
+	DWORD			nCurrentRow		= 0;
+	DWORD			nPixel			= 0;
+	CONST BYTE *	pnSource		= NULL;
+	PBYTE			pnTarget		= NULL;
+	PBYTE			pnTargetEnd		= NULL;
+
+	assert(NULL != ptImage);
+	assert(nRow + nRows <= ptImage->nHeight);
+	assert(NULL != pnPixels);
+
+	// A DWORD per 8 pixels, as VGADECODE_DecodeImageToNibbles writes them.
+	cbRow = ((ptImage->nWidth + 7) / PIXELS_IN_BYTE) * sizeof(DWORD);
+	assert(cbRow <= cbPixelStride);
+
+	for (nCurrentRow = 0; nCurrentRow < nRows; ++nCurrentRow)
+	{
+		pnSource = ptImage->anPixels + ((nRow + nCurrentRow) * ptImage->cbStride);
+		pnTarget = pnPixels + (nCurrentRow * cbPixelStride);
+		pnTargetEnd = pnTarget + cbRow;
+
+		// Pixel values are below VGA_COLORS, so they fit in a nibble.
+		for (nPixel = 0;
+			 nPixel + 1 < ptImage->nWidth;
+			 nPixel += PIXELS_IN_NIBBLES_BYTE)
+		{
+			*pnTarget++ = (BYTE)((pnSource[nPixel] << 4) | pnSource[nPixel + 1]);
+		}
+
+		// An odd pixel out only fills the high nibble.
+		if (nPixel < ptImage->nWidth)
+		{
+			*pnTarget++ = (BYTE)(pnSource[nPixel] << 4);
+		}
+
+		ZeroMemory(pnTarget, pnTargetEnd - pnTarget);
+	}
+}
@@ -0,0 +1,79 @@
+/**
+ * @file VgaImage.h
+ * @author biko
+ * @date 2026-10-17
+ *
+ * VgaImage module public header.
+ * Contains routines for decoding a captured screen once,
+ * into indexed pixels that any number of encoders can share.
+ */
+#pragma once
+
+/** Headers *************************************************************/
+#include <Windows.h>
+
+#include "VgaCapture.h"
+
+
+/** Typedefs ************************************************************/
+
+/**
+ * A decoded screen.
+ */
+typedef struct _VGA_IMAGE
+{
+	// Dimensions of the image, in pixels.
+	DWORD	nWidth;
+	DWORD	nHeight;
+
+	// Distance between rows, in bytes.
+	// Rows are padded to a multiple of 4 bytes, as in an 8bpp BMP.
+	DWORD	cbStride;
+
+	// The pixel values, one to a byte, top row first.
+	BYTE	anPixels[ANYSIZE_ARRAY];
+} VGA_IMAGE, *PVGA_IMAGE;
+typedef CONST VGA_IMAGE *PCVGA_IMAGE;
+
+
+/** Functions ***********************************************************/
+
+/**
+ * Decodes a captured screen, in graphics or text mode.
+ *
+ * @param[in]	ptCapture	The capture.
+ * @param[out]	pptImage	Will receive the image. Free with HEAPFREE.
+ *
+ * @returns HRESULT
+ */
+HRESULT
+VGAIMAGE_Decode(
+	_In_		PCVGA_CAPTURE_VIEW	ptCapture,
+	_Outptr_	PVGA_IMAGE *		pptImage
+);
+
+/**
+ * Packs rows of an image two pixels to a byte, as in a 4bpp BMP:
+ * the leftmost pixel of each pair is in the high nibble.
+ *
+ * @param[in]	ptImage			The image.
+ * @param[in]	nRow			The first row to pack.
+ * @param[in]	nRows			Number of rows to pack.
+ * @param[out]	pnPixels		Will receive the packed pixels.
+ * @param[in]	cbPixelStride	Distance between rows in the output, in bytes.
+ *								Must have room for a DWORD per 8 pixels,
+ *								rounded up.
+ *
+ * @remark	The nibbles past the width in the last DWORD
+ *			of each row are cleared.
+ *
+ * @see VGADECODE_DecodeImageToNibbles
+ */
+VOID
+VGAIMAGE_PackRows(
+	_In_									PCVGA_IMAGE	ptImage,
+	_In_									DWORD		nRow,
+	_In_									DWORD		nRows,
+	_Out_writes_(cbPixelStride * nRows)		PBYTE		pnPixels,
+	_In_									DWORD		cbPixelStride
+);
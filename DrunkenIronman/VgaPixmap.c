@@ -0,0 +1,643 @@
+/**
+ * @file VgaPixmap.c
+ * @author biko
+ * @date 2026-10-17
+ *
+ * VgaPixmap module implementation.
+ */
+
+/** Headers *************************************************************/
+#include <Windows.h>
+#include <strsafe.h>
+
+#include <assert.h>
+
+#include "Util.h"
+#include "Debug.h"
+
+#include "VgaPixmap.h"
+
+
+/** Constants ***********************************************************/
+
+/**
+ * Headers of the Netpbm formats, given the width and height.
+ */
+#define PPM_HEADER_FORMAT ("P6\n%lu %lu\n255\n")
+#define PGM_HEADER_FORMAT ("P5\n%lu %lu\n255\n")
+
+/**
+ * Room for a Netpbm header.
+ */
+#define NETPBM_MAX_HEADER_SIZE (64)
+
+/**
+ * Rec. 601 luma weights, in thousandths.
+ */
+#define LUMA_RED_WEIGHT (299)
+#define LUMA_GREEN_WEIGHT (587)
+#define LUMA_BLUE_WEIGHT (114)
+#define LUMA_WEIGHTS_TOTAL (1000)
+
+/**
+ * QOI header values for an RGB image.
+ */
+#define QOI_HEADER_SIZE (14)
+#define QOI_CHANNELS (3)
+#define QOI_COLORSPACE_SRGB (0)
+
+/**
+ * QOI operations. The small ones keep their argument
+ * in the bits below the tag.
+ */
+#define QOI_OP_INDEX (0x00)
+#define QOI_OP_DIFF (0x40)
+#define QOI_OP_LUMA (0x80)
+#define QOI_OP_RUN (0xC0)
+#define QOI_OP_RGB (0xFE)
+
+/**
+ * The longest run a single QOI_OP_RUN can hold.
+ */
+#define QOI_MAX_RUN (62)
+
+/**
+ * Number of previously seen colors QOI_OP_INDEX can refer to.
+ */
+#define QOI_INDEX_SIZE (64)
+
+/**
+ * The most a single pixel can take up: the run before it,
+ * then a QOI_OP_RGB. The alpha never changes.
+ */
+#define QOI_MAX_PIXEL_SIZE (1 + 4)
+
+
+/** Macros **************************************************************/
+
+/**
+ * Packs a color the way a DWORD of it is laid out in memory:
+ * red first, then green, blue and alpha.
+ */
+#define PACK_COLOR(nRed, nGreen, nBlue, nAlpha)	\
+	((DWORD)(nRed) |							\
+	 ((DWORD)(nGreen) << 8) |					\
+	 ((DWORD)(nBlue) << 16) |					\
+	 ((DWORD)(nAlpha) << 24))
+
+/**
+ * Extracts a channel from a packed color.
+ */
+#define COLOR_RED(nColor) ((BYTE)(nColor))
+#define COLOR_GREEN(nColor) ((BYTE)((nColor) >> 8))
+#define COLOR_BLUE(nColor) ((BYTE)((nColor) >> 16))
+#define COLOR_ALPHA(nColor) ((BYTE)((nColor) >> 24))
+
+/**
+ * Stores a DWORD at a byte address.
+ */
+#define WRITE_DWORD(pnData, nValue) (*(UNALIGNED DWORD *)(pnData) = (nValue))
+
+/**
+ * The slot of a color in the QOI index.
+ */
+#define QOI_HASH(nColor)						\
+	(((COLOR_RED(nColor) * 3) +					\
+	  (COLOR_GREEN(nColor) * 5) +				\
+	  (COLOR_BLUE(nColor) * 7) +				\
+	  (COLOR_ALPHA(nColor) * 11)) % QOI_INDEX_SIZE)
+
+
+/** Typedefs ************************************************************/
+
+/**
+ * A pixmap being written.
+ */
+typedef struct _VGAPIXMAP_CONTEXT
+{
+	VGA_PIXMAP_FORMAT	eFormat;
+	DWORD				nWidth;
+	DWORD				nHeight;
+	DWORD				nRowsWritten;
+	HVGASTREAM			hStream;
+
+	// PPM, PGM, RGBA and BGRA: each pixel value is written
+	// as the first cbPixel bytes of its DWORD.
+	DWORD				cbPixel;
+	DWORD				anPixels[VGA_COLORS];
+
+	// QOI: the color of each pixel value, and its slot in the index.
+	DWORD				anColors[VGA_COLORS];
+	BYTE				anSlots[VGA_COLORS];
+
+	// QOI: the previous pixel's color, how many pixels
+	// since have had the same color, and the index.
+	DWORD				nPrevious;
+	DWORD				nRun;
+	DWORD				anIndex[QOI_INDEX_SIZE];
+} VGAPIXMAP_CONTEXT, *PVGAPIXMAP_CONTEXT;
+typedef CONST VGAPIXMAP_CONTEXT *PCVGAPIXMAP_CONTEXT;
+
+
+/** Globals *************************************************************/
+
+/**
+ * The end of a QOI file.
+ */
+STATIC CONST BYTE g_anQoiEnd[] = {
+	0, 0, 0, 0, 0, 0, 0, 1
+};
+
+
+/** Functions ***********************************************************/
+
+/**
+ * Stores a DWORD in big-endian byte order, as QOI headers have it.
+ *
+ * @param[out]	pnData		Where to store the value.
+ * @param[in]	nValue		The value.
+ */
+STATIC
+VOID
+vgapixmap_StoreBigEndian(
+	_Out_writes_(sizeof(DWORD))	PBYTE	pnData,
+	_In_						DWORD	nValue
+)
+{
+	assert(NULL != pnData);
+
+	pnData[0] = (BYTE)(nValue >> 24);
+	pnData[1] = (BYTE)(nValue >> 16);
+	pnData[2] = (BYTE)(nValue >> 8);
+	pnData[3] = (BYTE)nValue;
+}
+
+/**
+ * Writes a pixmap's header, if its format has one.
+ *
+ * @param[in]	ptContext	The pixmap.
+ *
+ * @returns HRESULT
+ */
+STATIC
+HRESULT
+vgapixmap_WriteHeader(
+	_In_	PCVGAPIXMAP_CONTEXT	ptContext
+)
+{
+	HRESULT	hrResult								= E_FAIL;
+	CHAR	acNetpbmHeader[NETPBM_MAX_HEADER_SIZE]	= { 0 };
+	PSTR	pszNetpbmHeaderEnd						= NULL;
+	BYTE	anQoiHeader[QOI_HEADER_SIZE]			= { 0 };
+
+	assert(NULL != ptContext);
+
+	switch (ptContext->eFormat)
+	{
+	case VGA_PIXMAP_FORMAT_PPM:
+	case VGA_PIXMAP_FORMAT_PGM:
+		hrResult = StringCchPrintfExA(acNetpbmHeader,
+									  ARRAYSIZE(acNetpbmHeader),
+									  &pszNetpbmHeaderEnd,
+									  NULL,
+									  0,
+									  (VGA_PIXMAP_FORMAT_PPM == ptContext->eFormat)
+									  ? PPM_HEADER_FORMAT
+									  : PGM_HEADER_FORMAT,
+									  ptContext->nWidth,
+									  ptContext->nHeight);
+		if (FAILED(hrResult))
+		{
+			goto lblCleanup;
+		}
+		hrResult = VGASTREAM_Write(ptContext->hStream,
+								   acNetpbmHeader,
+								   (DWORD)(pszNetpbmHeaderEnd - acNetpbmHeader));
+		break;
+
+	case VGA_PIXMAP_FORMAT_QOI:
+		anQoiHeader[0] = 'q';
+		anQoiHeader[1] = 'o';
+		anQoiHeader[2] = 'i';
+		anQoiHeader[3] = 'f';
+		vgapixmap_StoreBigEndian(anQoiHeader + 4, ptContext->nWidth);
+		vgapixmap_StoreBigEndian(anQoiHeader + 8, ptContext->nHeight);
+		anQoiHeader[12] = QOI_CHANNELS;
+		anQoiHeader[13] = QOI_COLORSPACE_SRGB;
+		hrResult = VGASTREAM_Write(ptContext->hStream, anQoiHeader, sizeof(anQoiHeader));
+		break;
+
+	default:
+		hrResult = S_OK;
+		break;
+	}
+
+lblCleanup:
+	return hrResult;
+}
+
+/**
+ * Writes a row of a PPM, PGM, RGBA or BGRA pixmap.
+ *
+ * @param[in]	ptContext	The pixmap.
+ * @param[in]	pnRow		The row's indexed pixels.
+ *
+ * @returns HRESULT
+ */
+STATIC
+HRESULT
+vgapixmap_WriteRawRow(
+	_In_	PCVGAPIXMAP_CONTEXT	ptContext,
+	_In_	CONST BYTE *		pnRow
+)
+{
+	HRESULT	hrResult	= E_FAIL;
+	DWORD	nPixel		= 0;
+	DWORD	nLast		= 0;
+	PBYTE	pnSpace		= NULL;
+	DWORD	cbSpace		= 0;
+	PBYTE	pnOutput	= NULL;
+
+	assert(NULL != ptContext);
+	assert(NULL != pnRow);
+
+	while (nPixel < ptContext->nWidth)
+	{
+		// Every pixel is stored as a whole DWORD,
+		// so the last one needs the rest of it to fit too.
+		hrResult = VGASTREAM_Reserve(ptContext->hStream, sizeof(DWORD), &pnSpace, &cbSpace);
+		if (FAILED(hrResult))
+		{
+			goto lblCleanup;
+		}
+		nLast = nPixel + min(ptContext->nWidth - nPixel,
+							 (cbSpace - (sizeof(DWORD) - ptContext->cbPixel)) / ptContext->cbPixel);
+
+		for (pnOutput = pnSpace; nPixel < nLast; ++nPixel)
+		{
+			WRITE_DWORD(pnOutput, ptContext->anPixels[pnRow[nPixel] & (VGA_COLORS - 1)]);
+			pnOutput += ptContext->cbPixel;
+		}
+		VGASTREAM_Commit(ptContext->hStream, (DWORD)(pnOutput - pnSpace));
+	}
+
+	hrResult = S_OK;
+
+lblCleanup:
+	return hrResult;
+}
+
+/**
+ * Writes a QOI pixel whose color isn't in the index,
+ * relative to the previous pixel's color.
+ *
+ * @param[out]	pnOutput	Where to write the pixel.
+ * @param[in]	nColor		The pixel's color.
+ * @param[in]	nPrevious	The previous pixel's color.
+ *
+ * @returns PBYTE (just past the written pixel)
+ */
+STATIC
+PBYTE
+vgapixmap_WriteQoiColor(
+	_Out_writes_(QOI_MAX_PIXEL_SIZE)	PBYTE	pnOutput,
+	_In_								DWORD	nColor,
+	_In_								DWORD	nPrevious
+)
+{
+	CHAR	nRedDelta	= (CHAR)(COLOR_RED(nColor) - COLOR_RED(nPrevious));
+	CHAR	nGreenDelta	= (CHAR)(COLOR_GREEN(nColor) - COLOR_GREEN(nPrevious));
+	CHAR	nBlueDelta	= (CHAR)(COLOR_BLUE(nColor) - COLOR_BLUE(nPrevious));
+	CHAR	nRedLuma	= (CHAR)(nRedDelta - nGreenDelta);
+	CHAR	nBlueLuma	= (CHAR)(nBlueDelta - nGreenDelta);
+
+	assert(NULL != pnOutput);
+
+	if ((-2 <= nRedDelta) && (nRedDelta <= 1) &&
+		(-2 <= nGreenDelta) && (nGreenDelta <= 1) &&
+		(-2 <= nBlueDelta) && (nBlueDelta <= 1))
+	{
+		*pnOutput++ = (BYTE)(QOI_OP_DIFF |
+							 ((nRedDelta + 2) << 4) |
+							 ((nGreenDelta + 2) << 2) |
+							 (nBlueDelta + 2));
+	}
+	else if ((-32 <= nGreenDelta) && (nGreenDelta <= 31) &&
+			 (-8 <= nRedLuma) && (nRedLuma <= 7) &&
+			 (-8 <= nBlueLuma) && (nBlueLuma <= 7))
+	{
+		*pnOutput++ = (BYTE)(QOI_OP_LUMA | (nGreenDelta + 32));
+		*pnOutput++ = (BYTE)(((nRedLuma + 8) << 4) | (nBlueLuma + 8));
+	}
+	else
+	{
+		*pnOutput++ = QOI_OP_RGB;
+		*pnOutput++ = COLOR_RED(nColor);
+		*pnOutput++ = COLOR_GREEN(nColor);
+		*pnOutput++ = COLOR_BLUE(nColor);
+	}
+
+	return pnOutput;
+}
+
+/**
+ * Writes a row of a QOI pixmap.
+ * Runs carry over from one row to the next.
+ *
+ * @param[in]	ptContext	The pixmap.
+ * @param[in]	pnRow		The row's indexed pixels.
+ *
+ * @returns HRESULT
+ */
+STATIC
+HRESULT
+vgapixmap_WriteQoiRow(
+	_In_	PVGAPIXMAP_CONTEXT	ptContext,
+	_In_	CONST BYTE *		pnRow
+)
+{
+	HRESULT	hrResult	= E_FAIL;
+	DWORD	nPixel		= 0;
+	DWORD	nValue		= 0;
+	DWORD	nColor		= 0;
+	DWORD	nPrevious	= 0;
+	DWORD	nRun		= 0;
+	PBYTE	pnSpace		= NULL;
+	DWORD	cbSpace		= 0;
+	PBYTE	pnOutput	= NULL;
+	PBYTE	pnLimit		= NULL;
+
+	assert(NULL != ptContext);
+	assert(NULL != pnRow);
+
+	nPrevious = ptContext->nPrevious;
+	nRun = ptContext->nRun;
+	while (nPixel < ptContext->nWidth)
+	{
+		hrResult = VGASTREAM_Reserve(ptContext->hStream, QOI_MAX_PIXEL_SIZE, &pnSpace, &cbSpace);
+		if (FAILED(hrResult))
+		{
+			goto lblCleanup;
+		}
+		pnLimit = pnSpace + cbSpace - QOI_MAX_PIXEL_SIZE;
+
+		for (pnOutput = pnSpace;
+			 (nPixel < ptContext->nWidth) && (pnOutput <= pnLimit);
+			 ++nPixel)
+		{
+			nValue = pnRow[nPixel] & (VGA_COLORS - 1);
+			nColor = ptContext->anColors[nValue];
+			if (nColor == nPrevious)
+			{
+				++nRun;
+				if (QOI_MAX_RUN == nRun)
+				{
+					*pnOutput++ = (BYTE)(QOI_OP_RUN | (nRun - 1));
+					nRun = 0;
+				}
+				continue;
+			}
+
+			if (0 != nRun)
+			{
+				*pnOutput++ = (BYTE)(QOI_OP_RUN | (nRun - 1));
+				nRun = 0;
+			}
+
+			if (nColor == ptContext->anIndex[ptContext->anSlots[nValue]])
+			{
+				*pnOutput++ = (BYTE)(QOI_OP_INDEX | ptContext->anSlots[nValue]);
+			}
+			else
+			{
+				ptContext->anIndex[ptContext->anSlots[nValue]] = nColor;
+				pnOutput = vgapixmap_WriteQoiColor(pnOutput, nColor, nPrevious);
+			}
+			nPrevious = nColor;
+		}
+		VGASTREAM_Commit(ptContext->hStream, (DWORD)(pnOutput - pnSpace));
+	}
+
+	hrResult = S_OK;
+
+lblCleanup:
+	ptContext->nPrevious = nPrevious;
+	ptContext->nRun = nRun;
+
+	return hrResult;
+}
+
+HRESULT
+VGAPIXMAP_Create(
+	_In_					VGA_PIXMAP_FORMAT	eFormat,
+	_In_					DWORD				nWidth,
+	_In_					DWORD				nHeight,
+	_In_reads_(VGA_COLORS)	CONST RGBQUAD *		ptPalette,
+	_In_					HVGASTREAM			hStream,
+	_Out_					PHVGAPIXMAP			phPixmap
+)
+{
+	HRESULT				hrResult	= E_FAIL;
+	PVGAPIXMAP_CONTEXT	ptContext	= NULL;
+	DWORD				nValue		= 0;
+	DWORD				nColor		= 0;
+	DWORD				nLuma		= 0;
+
+	if ((VGA_PIXMAP_FORMATS_COUNT <= (DWORD)eFormat) ||
+		(0 == nWidth) ||
+		(0 == nHeight) ||
+		(NULL == ptPalette) ||
+		(NULL == hStream) ||
+		(NULL == phPixmap))
+	{
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+
+	ptContext = HEAPALLOC(sizeof(*ptContext));
+	if (NULL == ptContext)
+	{
+		PROGRESS("Oops. Ran out of memory.");
+		hrResult = E_OUTOFMEMORY;
+		goto lblCleanup;
+	}
+	ptContext->eFormat = eFormat;
+	ptContext->nWidth = nWidth;
+	ptContext->nHeight = nHeight;
+	ptContext->hStream = hStream;
+
+	// QOI starts out as if the pixel before the first was opaque black.
+	ptContext->nPrevious = PACK_COLOR(0, 0, 0, MAXBYTE);
+
+	for (nValue = 0; nValue < VGA_COLORS; ++nValue)
+	{
+		nColor = PACK_COLOR(ptPalette[nValue].rgbRed,
+							ptPalette[nValue].rgbGreen,
+							ptPalette[nValue].rgbBlue,
+							MAXBYTE);
+		nLuma = ((ptPalette[nValue].rgbRed * LUMA_RED_WEIGHT) +
+				 (ptPalette[nValue].rgbGreen * LUMA_GREEN_WEIGHT) +
+				 (ptPalette[nValue].rgbBlue * LUMA_BLUE_WEIGHT) +
+				 (LUMA_WEIGHTS_TOTAL / 2)) / LUMA_WEIGHTS_TOTAL;
+
+		ptContext->anColors[nValue] = nColor;
+		ptContext->anSlots[nValue] = (BYTE)QOI_HASH(nColor);
+		switch (eFormat)
+		{
+		case VGA_PIXMAP_FORMAT_PGM:
+			ptContext->anPixels[nValue] = nLuma;
+			break;
+
+		case VGA_PIXMAP_FORMAT_BGRA:
+			ptContext->anPixels[nValue] = PACK_COLOR(ptPalette[nValue].rgbBlue,
+													 ptPalette[nValue].rgbGreen,
+													 ptPalette[nValue].rgbRed,
+													 MAXBYTE);
+			break;
+
+		default:
+			ptContext->anPixels[nValue] = nColor;
+			break;
+		}
+	}
+
+	switch (eFormat)
+	{
+	case VGA_PIXMAP_FORMAT_PGM:
+		ptContext->cbPixel = 1;
+		break;
+
+	case VGA_PIXMAP_FORMAT_RGBA:
+	case VGA_PIXMAP_FORMAT_BGRA:
+		ptContext->cbPixel = 4;
+		break;
+
+	default:
+		ptContext->cbPixel = 3;
+		break;
+	}
+
+	hrResult = vgapixmap_WriteHeader(ptContext);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	// Transfer ownership:
+	*phPixmap = (HVGAPIXMAP)ptContext;
+	ptContext = NULL;
+
+	hrResult = S_OK;
+
+lblCleanup:
+	VGAPIXMAP_Destroy((HVGAPIXMAP)ptContext);
+
+	return hrResult;
+}
+
+HRESULT
+VGAPIXMAP_WriteRow(
+	_In_	HVGAPIXMAP		hPixmap,
+	_In_	CONST BYTE *	pnRow
+)
+{
+	HRESULT				hrResult	= E_FAIL;
+	PVGAPIXMAP_CONTEXT	ptContext	= (PVGAPIXMAP_CONTEXT)hPixmap;
+
+	if ((NULL == hPixmap) ||
+		(NULL == pnRow))
+	{
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+
+	if (ptContext->nHeight <= ptContext->nRowsWritten)
+	{
+		hrResult = E_UNEXPECTED;
+		goto lblCleanup;
+	}
+
+	if (VGA_PIXMAP_FORMAT_QOI == ptContext->eFormat)
+	{
+		hrResult = vgapixmap_WriteQoiRow(ptContext, pnRow);
+	}
+	else
+	{
+		hrResult = vgapixmap_WriteRawRow(ptContext, pnRow);
+	}
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+	++ptContext->nRowsWritten;
+
+	hrResult = S_OK;
+
+lblCleanup:
+	return hrResult;
+}
+
+HRESULT
+VGAPIXMAP_Finish(
+	_In_	HVGAPIXMAP	hPixmap
+)
+{
+	HRESULT				hrResult	= E_FAIL;
+	PVGAPIXMAP_CONTEXT	ptContext	= (PVGAPIXMAP_CONTEXT)hPixmap;
+	BYTE				nRunOp		= 0;
+
+	if (NULL == hPixmap)
+	{
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+
+	if (ptContext->nHeight != ptContext->nRowsWritten)
+	{
+		hrResult = E_UNEXPECTED;
+		goto lblCleanup;
+	}
+
+	if (VGA_PIXMAP_FORMAT_QOI == ptContext->eFormat)
+	{
+		if (0 != ptContext->nRun)
+		{
+			nRunOp = (BYTE)(QOI_OP_RUN | (ptContext->nRun - 1));
+			hrResult = VGASTREAM_Write(ptContext->hStream, &nRunOp, sizeof(nRunOp));
+			if (FAILED(hrResult))
+			{
+				goto lblCleanup;
+			}
+			ptContext->nRun = 0;
+		}
+
+		hrResult = VGASTREAM_Write(ptContext->hStream, g_anQoiEnd, sizeof(g_anQoiEnd));
+		if (FAILED(hrResult))
+		{
+			goto lblCleanup;
+		}
+	}
+
+	hrResult = S_OK;
+
+lblCleanup:
+	return hrResult;
+}
+
+VOID
+VGAPIXMAP_Destroy(
+	_In_	HVGAPIXMAP	hPixmap
+)
+{
+	PVGAPIXMAP_CONTEXT	ptContext	= (PVGAPIXMAP_CONTEXT)hPixmap;
+
+	if (NULL == hPixmap)
+	{
+		goto lblCleanup;
+	}
+
+	HEAPFREE(ptContext);
+
+lblCleanup:
+	return;
+}
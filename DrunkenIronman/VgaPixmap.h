@@ -0,0 +1,118 @@
+/**
+ * @file VgaPixmap.h
+ * @author biko
+ * @date 2026-10-17
+ *
+ * VgaPixmap module public header.
+ * Contains routines for writing indexed pixels to a stream,
+ * one row at a time, in the simple formats image pipelines
+ * read: binary PPM and PGM, bare RGBA or BGRA, and QOI.
+ */
+#pragma once
+
+/** Headers *************************************************************/
+#include <Windows.h>
+
+#include <Drink.h>
+
+#include "VgaStream.h"
+
+
+/** Enums ***************************************************************/
+
+/**
+ * The formats a pixmap can be written in.
+ */
+typedef enum _VGA_PIXMAP_FORMAT
+{
+	// Binary PPM (P6): 8-bit RGB.
+	VGA_PIXMAP_FORMAT_PPM = 0,
+
+	// Binary PGM (P5): 8-bit luma, as Rec. 601 weighs the colors.
+	VGA_PIXMAP_FORMAT_PGM,
+
+	// RGBA with an opaque alpha, and no header at all.
+	VGA_PIXMAP_FORMAT_RGBA,
+
+	// The same, with blue first, as in the pixels of 32bpp BMPs.
+	VGA_PIXMAP_FORMAT_BGRA,
+
+	// The "Quite OK Image" format, with 3 channels.
+	VGA_PIXMAP_FORMAT_QOI,
+
+	// Must be last:
+	VGA_PIXMAP_FORMATS_COUNT
+} VGA_PIXMAP_FORMAT, *PVGA_PIXMAP_FORMAT;
+
+
+/** Typedefs ************************************************************/
+
+/**
+ * Handle to a pixmap being written.
+ */
+DECLARE_HANDLE(HVGAPIXMAP);
+typedef HVGAPIXMAP *PHVGAPIXMAP;
+
+
+/** Functions ***********************************************************/
+
+/**
+ * Starts writing a pixmap, and writes its header.
+ *
+ * @param[in]	eFormat		The format to write.
+ * @param[in]	nWidth		Width of the image, in pixels.
+ * @param[in]	nHeight		Height of the image, in pixels.
+ * @param[in]	ptPalette	The colors of the VGA_COLORS pixel values.
+ * @param[in]	hStream		Where to write the pixmap.
+ *							Must outlive the pixmap.
+ * @param[out]	phPixmap	Will receive a handle to the pixmap.
+ *
+ * @returns HRESULT
+ */
+HRESULT
+VGAPIXMAP_Create(
+	_In_					VGA_PIXMAP_FORMAT	eFormat,
+	_In_					DWORD				nWidth,
+	_In_					DWORD				nHeight,
+	_In_reads_(VGA_COLORS)	CONST RGBQUAD *		ptPalette,
+	_In_					HVGASTREAM			hStream,
+	_Out_					PHVGAPIXMAP			phPixmap
+);
+
+/**
+ * Writes the next row of a pixmap, top row first.
+ *
+ * @param[in]	hPixmap		The pixmap.
+ * @param[in]	pnRow		The row's indexed pixels, one to a byte.
+ *							Only the low nibble of each is used.
+ *
+ * @returns HRESULT
+ */
+HRESULT
+VGAPIXMAP_WriteRow(
+	_In_	HVGAPIXMAP		hPixmap,
+	_In_	CONST BYTE *	pnRow
+);
+
+/**
+ * Finishes a pixmap, once all of its rows have been written.
+ * The stream is not flushed.
+ *
+ * @param[in]	hPixmap		The pixmap.
+ *
+ * @returns HRESULT
+ */
+HRESULT
+VGAPIXMAP_Finish(
+	_In_	HVGAPIXMAP	hPixmap
+);
+
+/**
+ * Discards a pixmap, finished or not.
+ *
+ * @param[in]	hPixmap		The pixmap.
+ */
+VOID
+VGAPIXMAP_Destroy(
+	_In_	HVGAPIXMAP	hPixmap
+);
@@ -0,0 +1,1561 @@
+/**
+ * @file VgaPng.c
+ * @author biko
+ * @date 2026-10-17
+ *
+ * VgaPng module implementation.
+ */
+
+/** Headers *************************************************************/
+#include <Windows.h>
+#include <intsafe.h>
+
+#include <assert.h>
+
+#include "Util.h"
+#include "Debug.h"
+
+#include "VgaPng.h"
+
+
+/** Constants ***********************************************************/
+
+/**
+ * PNG header values for a 4bpp paletted image.
+ */
+#define PNG_BIT_DEPTH (4)
+#define PNG_COLOR_TYPE_PALETTE (3)
+#define PNG_IHDR_SIZE (13)
+
+/**
+ * Row filters. Only the two that suit screens are tried:
+ * None keeps runs of one color, and Up turns rows
+ * that repeat the ones above them into runs of zeroes.
+ */
+#define PNG_FILTER_NONE (0)
+#define PNG_FILTER_UP (2)
+
+/**
+ * Overhead of a chunk: its length, type and CRC.
+ */
+#define PNG_CHUNK_OVERHEAD (3 * sizeof(DWORD))
+
+/**
+ * zlib header for deflate with a 32KB window.
+ */
+#define ZLIB_CMF (0x78)
+#define ZLIB_FLG (0x01)
+#define ZLIB_ADLER32_MODULUS (65521)
+
+/**
+ * The most bytes Adler-32 can sum before its sums must be reduced,
+ * and how many it sums at a time.
+ */
+#define ZLIB_ADLER32_NMAX (5552)
+#define ADLER32_UNROLL (8)
+
+/**
+ * Deflate alphabets and limits.
+ */
+#define DEFLATE_LITERAL_CODES (286)
+#define DEFLATE_DISTANCE_CODES (30)
+#define DEFLATE_LENGTH_CODES (29)
+#define DEFLATE_CODE_LENGTH_CODES (19)
+#define DEFLATE_END_OF_BLOCK (256)
+#define DEFLATE_FIRST_LENGTH_CODE (257)
+#define DEFLATE_MAX_CODE_LENGTH (15)
+#define DEFLATE_MAX_CODE_LENGTH_CODE_LENGTH (7)
+#define DEFLATE_MIN_MATCH (3)
+#define MIN_MATCH_MASK (0x00FFFFFF)
+#define DEFLATE_MAX_MATCH (258)
+#define DEFLATE_WINDOW_SIZE (32768)
+#define DEFLATE_BLOCK_DYNAMIC (2)
+
+/**
+ * Code length codes that repeat lengths, and their limits.
+ */
+#define DEFLATE_REPEAT_PREVIOUS (16)
+#define DEFLATE_REPEAT_ZERO_SHORT (17)
+#define DEFLATE_REPEAT_ZERO_LONG (18)
+
+/**
+ * Blocks are ended once they have this many symbols,
+ * so that their codes follow the image as it changes.
+ */
+#define DEFLATE_BLOCK_SYMBOLS (16384)
+
+/**
+ * Worst case sizes of a symbol and of a block header, in bytes.
+ * A match takes at most 15 + 5 bits for its length
+ * and 15 + 13 bits for its distance.
+ */
+#define DEFLATE_MAX_SYMBOL_SIZE (6)
+#define DEFLATE_MAX_HEADER_SIZE (1024)
+
+/**
+ * The output starts out this big, and doubles whenever it fills up.
+ */
+#define PNG_INITIAL_OUTPUT_SIZE (4096)
+
+/**
+ * The most code lengths a Huffman code is built with
+ * before it is limited.
+ */
+#define HUFFMAN_MAX_UNLIMITED_LENGTH (32)
+
+
+/** Macros **************************************************************/
+
+/**
+ * Builds a match symbol. Literals are stored as they are.
+ */
+#define MAKE_MATCH_SYMBOL(nLength, nDistance) (((DWORD)(nLength) << 16) | (nDistance))
+#define MATCH_SYMBOL_LENGTH(nSymbol) ((nSymbol) >> 16)
+#define MATCH_SYMBOL_DISTANCE(nSymbol) ((nSymbol) & MAXWORD)
+
+/**
+ * Sets the high bit of every byte of a quadword that isn't zero,
+ * and clears all the other bits.
+ */
+#define NONZERO_BYTES(nValue)	\
+	(((((nValue) & 0x7F7F7F7F7F7F7F7FULL) + 0x7F7F7F7F7F7F7F7FULL) | (nValue)) & 0x8080808080808080ULL)
+
+/**
+ * Counts the bytes of a quadword with their high bit set,
+ * when no other bits are set.
+ */
+#define COUNT_HIGH_BITS(nValue) ((DWORD)((((nValue) >> 7) * 0x0101010101010101ULL) >> 56))
+
+/**
+ * Subtracts every byte of a quadword from the one
+ * in the same place in another, modulo 256.
+ */
+#define SUBTRACT_BYTES(nLeft, nRight)														\
+	((((nLeft) | 0x8080808080808080ULL) - ((nRight) & 0x7F7F7F7F7F7F7F7FULL)) ^			\
+	 (((nLeft) ^ ~(nRight)) & 0x8080808080808080ULL))
+
+/**
+ * Reads a DWORD or a quadword that may not be aligned.
+ */
+#define READ_DWORD(pnData) (*(UNALIGNED CONST DWORD *)(pnData))
+#define READ_QUADWORD(pnData) (*(UNALIGNED CONST ULONGLONG *)(pnData))
+
+/**
+ * Builds a chunk type from its 4 letters.
+ */
+#define PNG_CHUNK_TYPE(a, b, c, d) ((((DWORD)(a)) << 24) | (((DWORD)(b)) << 16) | (((DWORD)(c)) << 8) | ((DWORD)(d)))
+
+
+/** Typedefs ************************************************************/
+
+/**
+ * A canonical Huffman code, with the codes bit-reversed
+ * since deflate writes them most significant bit first.
+ */
+typedef struct _VGAPNG_HUFFMAN
+{
+	WORD	anCodes[DEFLATE_LITERAL_CODES];
+	BYTE	anLengths[DEFLATE_LITERAL_CODES];
+} VGAPNG_HUFFMAN, *PVGAPNG_HUFFMAN;
+typedef CONST VGAPNG_HUFFMAN *PCVGAPNG_HUFFMAN;
+
+/**
+ * Writes bits into the output, least significant first.
+ * Blocks copy it out of the context while they're written,
+ * so that it stays in registers.
+ */
+typedef struct _VGAPNG_BIT_WRITER
+{
+	PBYTE		pnOutput;
+	ULONGLONG	nBuffer;
+	DWORD		cBits;
+} VGAPNG_BIT_WRITER, *PVGAPNG_BIT_WRITER;
+
+/**
+ * A PNG being written.
+ */
+typedef struct _VGAPNG_CONTEXT
+{
+	DWORD		nWidth;
+	DWORD		nHeight;
+	DWORD		nRowsWritten;
+
+	// Each line is a row and the filter byte before it.
+	DWORD		cbRow;
+	DWORD		cbLine;
+
+	// The previous row as it was given, for the Up filter.
+	PBYTE		pnPreviousRow;
+
+	// The previous line as it was compressed, then the current one.
+	PBYTE		pnWindow;
+
+	// The code of every match length, and of the distance to the line above.
+	BYTE		anLengthCodes[DEFLATE_MAX_MATCH + 1];
+	DWORD		nLineDistanceCode;
+
+	// The symbols of the current block, and how often each code is used.
+	PDWORD		pnSymbols;
+	DWORD		nSymbols;
+	DWORD		cSymbolCapacity;
+	DWORD		anLiteralCounts[DEFLATE_LITERAL_CODES];
+	DWORD		anDistanceCounts[DEFLATE_DISTANCE_CODES];
+
+	// Adler-32 of everything compressed so far.
+	DWORD		nAdlerLow;
+	DWORD		nAdlerHigh;
+
+	// The file so far, and the bits that don't fill a byte yet.
+	PBYTE		pnOutput;
+	DWORD		cbOutput;
+	DWORD		cbOutputCapacity;
+	DWORD		nIdatOffset;
+	ULONGLONG	nBitBuffer;
+	DWORD		cBits;
+} VGAPNG_CONTEXT, *PVGAPNG_CONTEXT;
+typedef CONST VGAPNG_CONTEXT *PCVGAPNG_CONTEXT;
+
+
+/** Globals *************************************************************/
+
+/**
+ * The PNG file signature.
+ */
+STATIC CONST BYTE g_anPngSignature[] = {
+	0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'
+};
+
+/**
+ * CRC-32 of every byte value, for the chunk CRCs.
+ */
+STATIC CONST DWORD g_anCrc32[256] = {
+	0x00000000UL, 0x77073096UL, 0xEE0E612CUL, 0x990951BAUL, 0x076DC419UL, 0x706AF48FUL,
+	0xE963A535UL, 0x9E6495A3UL, 0x0EDB8832UL, 0x79DCB8A4UL, 0xE0D5E91EUL, 0x97D2D988UL,
+	0x09B64C2BUL, 0x7EB17CBDUL, 0xE7B82D07UL, 0x90BF1D91UL, 0x1DB71064UL, 0x6AB020F2UL,
+	0xF3B97148UL, 0x84BE41DEUL, 0x1ADAD47DUL, 0x6DDDE4EBUL, 0xF4D4B551UL, 0x83D385C7UL,
+	0x136C9856UL, 0x646BA8C0UL, 0xFD62F97AUL, 0x8A65C9ECUL, 0x14015C4FUL, 0x63066CD9UL,
+	0xFA0F3D63UL, 0x8D080DF5UL, 0x3B6E20C8UL, 0x4C69105EUL, 0xD56041E4UL, 0xA2677172UL,
+	0x3C03E4D1UL, 0x4B04D447UL, 0xD20D85FDUL, 0xA50AB56BUL, 0x35B5A8FAUL, 0x42B2986CUL,
+	0xDBBBC9D6UL, 0xACBCF940UL, 0x32D86CE3UL, 0x45DF5C75UL, 0xDCD60DCFUL, 0xABD13D59UL,
+	0x26D930ACUL, 0x51DE003AUL, 0xC8D75180UL, 0xBFD06116UL, 0x21B4F4B5UL, 0x56B3C423UL,
+	0xCFBA9599UL, 0xB8BDA50FUL, 0x2802B89EUL, 0x5F058808UL, 0xC60CD9B2UL, 0xB10BE924UL,
+	0x2F6F7C87UL, 0x58684C11UL, 0xC1611DABUL, 0xB6662D3DUL, 0x76DC4190UL, 0x01DB7106UL,
+	0x98D220BCUL, 0xEFD5102AUL, 0x71B18589UL, 0x06B6B51FUL, 0x9FBFE4A5UL, 0xE8B8D433UL,
+	0x7807C9A2UL, 0x0F00F934UL, 0x9609A88EUL, 0xE10E9818UL, 0x7F6A0DBBUL, 0x086D3D2DUL,
+	0x91646C97UL, 0xE6635C01UL, 0x6B6B51F4UL, 0x1C6C6162UL, 0x856530D8UL, 0xF262004EUL,
+	0x6C0695EDUL, 0x1B01A57BUL, 0x8208F4C1UL, 0xF50FC457UL, 0x65B0D9C6UL, 0x12B7E950UL,
+	0x8BBEB8EAUL, 0xFCB9887CUL, 0x62DD1DDFUL, 0x15DA2D49UL, 0x8CD37CF3UL, 0xFBD44C65UL,
+	0x4DB26158UL, 0x3AB551CEUL, 0xA3BC0074UL, 0xD4BB30E2UL, 0x4ADFA541UL, 0x3DD895D7UL,
+	0xA4D1C46DUL, 0xD3D6F4FBUL, 0x4369E96AUL, 0x346ED9FCUL, 0xAD678846UL, 0xDA60B8D0UL,
+	0x44042D73UL, 0x33031DE5UL, 0xAA0A4C5FUL, 0xDD0D7CC9UL, 0x5005713CUL, 0x270241AAUL,
+	0xBE0B1010UL, 0xC90C2086UL, 0x5768B525UL, 0x206F85B3UL, 0xB966D409UL, 0xCE61E49FUL,
+	0x5EDEF90EUL, 0x29D9C998UL, 0xB0D09822UL, 0xC7D7A8B4UL, 0x59B33D17UL, 0x2EB40D81UL,
+	0xB7BD5C3BUL, 0xC0BA6CADUL, 0xEDB88320UL, 0x9ABFB3B6UL, 0x03B6E20CUL, 0x74B1D29AUL,
+	0xEAD54739UL, 0x9DD277AFUL, 0x04DB2615UL, 0x73DC1683UL, 0xE3630B12UL, 0x94643B84UL,
+	0x0D6D6A3EUL, 0x7A6A5AA8UL, 0xE40ECF0BUL, 0x9309FF9DUL, 0x0A00AE27UL, 0x7D079EB1UL,
+	0xF00F9344UL, 0x8708A3D2UL, 0x1E01F268UL, 0x6906C2FEUL, 0xF762575DUL, 0x806567CBUL,
+	0x196C3671UL, 0x6E6B06E7UL, 0xFED41B76UL, 0x89D32BE0UL, 0x10DA7A5AUL, 0x67DD4ACCUL,
+	0xF9B9DF6FUL, 0x8EBEEFF9UL, 0x17B7BE43UL, 0x60B08ED5UL, 0xD6D6A3E8UL, 0xA1D1937EUL,
+	0x38D8C2C4UL, 0x4FDFF252UL, 0xD1BB67F1UL, 0xA6BC5767UL, 0x3FB506DDUL, 0x48B2364BUL,
+	0xD80D2BDAUL, 0xAF0A1B4CUL, 0x36034AF6UL, 0x41047A60UL, 0xDF60EFC3UL, 0xA867DF55UL,
+	0x316E8EEFUL, 0x4669BE79UL, 0xCB61B38CUL, 0xBC66831AUL, 0x256FD2A0UL, 0x5268E236UL,
+	0xCC0C7795UL, 0xBB0B4703UL, 0x220216B9UL, 0x5505262FUL, 0xC5BA3BBEUL, 0xB2BD0B28UL,
+	0x2BB45A92UL, 0x5CB36A04UL, 0xC2D7FFA7UL, 0xB5D0CF31UL, 0x2CD99E8BUL, 0x5BDEAE1DUL,
+	0x9B64C2B0UL, 0xEC63F226UL, 0x756AA39CUL, 0x026D930AUL, 0x9C0906A9UL, 0xEB0E363FUL,
+	0x72076785UL, 0x05005713UL, 0x95BF4A82UL, 0xE2B87A14UL, 0x7BB12BAEUL, 0x0CB61B38UL,
+	0x92D28E9BUL, 0xE5D5BE0DUL, 0x7CDCEFB7UL, 0x0BDBDF21UL, 0x86D3D2D4UL, 0xF1D4E242UL,
+	0x68DDB3F8UL, 0x1FDA836EUL, 0x81BE16CDUL, 0xF6B9265BUL, 0x6FB077E1UL, 0x18B74777UL,
+	0x88085AE6UL, 0xFF0F6A70UL, 0x66063BCAUL, 0x11010B5CUL, 0x8F659EFFUL, 0xF862AE69UL,
+	0x616BFFD3UL, 0x166CCF45UL, 0xA00AE278UL, 0xD70DD2EEUL, 0x4E048354UL, 0x3903B3C2UL,
+	0xA7672661UL, 0xD06016F7UL, 0x4969474DUL, 0x3E6E77DBUL, 0xAED16A4AUL, 0xD9D65ADCUL,
+	0x40DF0B66UL, 0x37D83BF0UL, 0xA9BCAE53UL, 0xDEBB9EC5UL, 0x47B2CF7FUL, 0x30B5FFE9UL,
+	0xBDBDF21CUL, 0xCABAC28AUL, 0x53B39330UL, 0x24B4A3A6UL, 0xBAD03605UL, 0xCDD70693UL,
+	0x54DE5729UL, 0x23D967BFUL, 0xB3667A2EUL, 0xC4614AB8UL, 0x5D681B02UL, 0x2A6F2B94UL,
+	0xB40BBE37UL, 0xC30C8EA1UL, 0x5A05DF1BUL, 0x2D02EF8DUL,
+};
+
+/**
+ * Smallest length and number of extra bits of every length code.
+ */
+STATIC CONST WORD g_anLengthBases[DEFLATE_LENGTH_CODES] = {
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+	35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+STATIC CONST BYTE g_anLengthExtraBits[DEFLATE_LENGTH_CODES] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+	3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+
+/**
+ * Smallest distance and number of extra bits of every distance code.
+ */
+STATIC CONST WORD g_anDistanceBases[DEFLATE_DISTANCE_CODES] = {
+	1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+	257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+STATIC CONST BYTE g_anDistanceExtraBits[DEFLATE_DISTANCE_CODES] = {
+	0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+	7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+/**
+ * The order the code length code's lengths are stored in.
+ */
+STATIC CONST BYTE g_anCodeLengthOrder[DEFLATE_CODE_LENGTH_CODES] = {
+	16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+
+/** Functions ***********************************************************/
+
+/**
+ * Updates a CRC-32 with more bytes.
+ *
+ * @param[in]	nCrc		The CRC so far, 0 to start.
+ * @param[in]	pnData		The bytes.
+ * @param[in]	cbData		Number of bytes.
+ *
+ * @returns DWORD (the updated CRC)
+ */
+STATIC
+DWORD
+vgapng_Crc32(
+	_In_						DWORD			nCrc,
+	_In_reads_bytes_(cbData)	CONST BYTE *	pnData,
+	_In_						DWORD			cbData
+)
+{
+	DWORD	nOffset	= 0;
+
+	nCrc = ~nCrc;
+	for (nOffset = 0; nOffset < cbData; ++nOffset)
+	{
+		nCrc = g_anCrc32[(nCrc ^ pnData[nOffset]) & MAXBYTE] ^ (nCrc >> 8);
+	}
+
+	return ~nCrc;
+}
+
+/**
+ * Stores a DWORD most significant byte first, as PNG and zlib do.
+ *
+ * @param[out]	pnOutput	Where to store it.
+ * @param[in]	nValue		The value.
+ */
+STATIC
+FORCEINLINE
+VOID
+vgapng_StoreBigEndian(
+	_Out_writes_bytes_all_(sizeof(DWORD))	PBYTE	pnOutput,
+	_In_									DWORD	nValue
+)
+{
+	pnOutput[0] = (BYTE)(nValue >> 24);
+	pnOutput[1] = (BYTE)(nValue >> 16);
+	pnOutput[2] = (BYTE)(nValue >> 8);
+	pnOutput[3] = (BYTE)nValue;
+}
+
+/**
+ * Makes sure the output has room for more bytes,
+ * doubling its capacity as needed.
+ *
+ * @param[in]	ptContext	The PNG.
+ * @param[in]	cbNeeded	Number of bytes about to be written.
+ *
+ * @returns HRESULT
+ */
+STATIC
+HRESULT
+vgapng_ReserveOutput(
+	_Inout_	PVGAPNG_CONTEXT	ptContext,
+	_In_	DWORD			cbNeeded
+)
+{
+	HRESULT	hrResult	= E_FAIL;
+	DWORD	cbRequired	= 0;
+	DWORD	cbCapacity	= 0;
+	PBYTE	pnOutput	= NULL;
+
+	if (FAILED(DWordAdd(ptContext->cbOutput, cbNeeded, &cbRequired)))
+	{
+		PROGRESS("The PNG is too big.");
+		hrResult = HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+		goto lblCleanup;
+	}
+	if (cbRequired <= ptContext->cbOutputCapacity)
+	{
+		hrResult = S_OK;
+		goto lblCleanup;
+	}
+
+	cbCapacity = max(ptContext->cbOutputCapacity, PNG_INITIAL_OUTPUT_SIZE);
+	while (cbCapacity < cbRequired)
+	{
+		if (FAILED(DWordMult(cbCapacity, 2, &cbCapacity)))
+		{
+			cbCapacity = cbRequired;
+		}
+	}
+
+	pnOutput = HEAPALLOC(cbCapacity);
+	if (NULL == pnOutput)
+	{
+		PROGRESS("Oops. Ran out of memory.");
+		hrResult = E_OUTOFMEMORY;
+		goto lblCleanup;
+	}
+	CopyMemory(pnOutput, ptContext->pnOutput, ptContext->cbOutput);
+
+	HEAPFREE(ptContext->pnOutput);
+	ptContext->pnOutput = pnOutput;
+	pnOutput = NULL;
+	ptContext->cbOutputCapacity = cbCapacity;
+
+	hrResult = S_OK;
+
+lblCleanup:
+	HEAPFREE(pnOutput);
+
+	return hrResult;
+}
+
+/**
+ * Appends a whole chunk to the output.
+ *
+ * @param[in]	ptContext	The PNG.
+ * @param[in]	nType		The chunk type.
+ * @param[in]	pnData		The chunk data.
+ * @param[in]	cbData		Size of the chunk data.
+ *
+ * @returns HRESULT
+ */
+STATIC
+HRESULT
+vgapng_AppendChunk(
+	_Inout_							PVGAPNG_CONTEXT	ptContext,
+	_In_							DWORD			nType,
+	_In_reads_bytes_opt_(cbData)	CONST BYTE *	pnData,
+	_In_							DWORD			cbData
+)
+{
+	HRESULT	hrResult	= E_FAIL;
+	PBYTE	pnChunk		= NULL;
+
+	hrResult = vgapng_ReserveOutput(ptContext, PNG_CHUNK_OVERHEAD + cbData);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	pnChunk = ptContext->pnOutput + ptContext->cbOutput;
+	vgapng_StoreBigEndian(pnChunk, cbData);
+	vgapng_StoreBigEndian(pnChunk + sizeof(DWORD), nType);
+	CopyMemory(pnChunk + (2 * sizeof(DWORD)), pnData, cbData);
+
+	// The CRC covers the type and the data.
+	vgapng_StoreBigEndian(pnChunk + (2 * sizeof(DWORD)) + cbData,
+						  vgapng_Crc32(0, pnChunk + sizeof(DWORD), sizeof(DWORD) + cbData));
+	ptContext->cbOutput += PNG_CHUNK_OVERHEAD + cbData;
+
+	hrResult = S_OK;
+
+lblCleanup:
+	return hrResult;
+}
+
+/**
+ * Updates the Adler-32 of the compressed data with more bytes.
+ *
+ * @param[in]	ptContext	The PNG.
+ * @param[in]	pnData		The bytes.
+ * @param[in]	cbData		Number of bytes.
+ */
+STATIC
+VOID
+vgapng_UpdateAdler32(
+	_Inout_						PVGAPNG_CONTEXT	ptContext,
+	_In_reads_bytes_(cbData)	CONST BYTE *	pnData,
+	_In_						DWORD			cbData
+)
+{
+	DWORD	nLow	= ptContext->nAdlerLow;
+	DWORD	nHigh	= ptContext->nAdlerHigh;
+	DWORD	nOffset	= 0;
+	DWORD	nEnd	= 0;
+
+	C_ASSERT(0 == ZLIB_ADLER32_NMAX % ADLER32_UNROLL);
+
+	while (nOffset < cbData)
+	{
+		nEnd = nOffset + min(cbData - nOffset, ZLIB_ADLER32_NMAX);
+
+		// Every byte is added to the high sum once for every byte
+		// from it on, so a group's bytes can be added weighted,
+		// without waiting on the low sum between them.
+		for (; nOffset + ADLER32_UNROLL <= nEnd; nOffset += ADLER32_UNROLL)
+		{
+			nHigh += (nLow * ADLER32_UNROLL) +
+					 (pnData[nOffset + 0] * 8) + (pnData[nOffset + 1] * 7) +
+					 (pnData[nOffset + 2] * 6) + (pnData[nOffset + 3] * 5) +
+					 (pnData[nOffset + 4] * 4) + (pnData[nOffset + 5] * 3) +
+					 (pnData[nOffset + 6] * 2) + pnData[nOffset + 7];
+			nLow += pnData[nOffset + 0] + pnData[nOffset + 1] +
+					pnData[nOffset + 2] + pnData[nOffset + 3] +
+					pnData[nOffset + 4] + pnData[nOffset + 5] +
+					pnData[nOffset + 6] + pnData[nOffset + 7];
+		}
+		for (; nOffset < nEnd; ++nOffset)
+		{
+			nLow += pnData[nOffset];
+			nHigh += nLow;
+		}
+
+		nLow %= ZLIB_ADLER32_MODULUS;
+		nHigh %= ZLIB_ADLER32_MODULUS;
+	}
+
+	ptContext->nAdlerLow = nLow;
+	ptContext->nAdlerHigh = nHigh;
+}
+
+/**
+ * Adds bits to the compressed data, least significant first.
+ * The output must have room for them, and for a quadword more.
+ *
+ * @param[in]	ptWriter	The bit writer.
+ * @param[in]	nValue		The bits.
+ * @param[in]	cBits		Number of bits, at most 16.
+ *
+ * @remark	The whole buffer is stored every time, and only its
+ *			whole bytes are kept, so that no branch depends on
+ *			the lengths of the codes.
+ */
+STATIC
+FORCEINLINE
+VOID
+vgapng_WriteBits(
+	_Inout_	PVGAPNG_BIT_WRITER	ptWriter,
+	_In_	DWORD				nValue,
+	_In_	DWORD				cBits
+)
+{
+	assert((16 >= cBits) && (0 == (nValue >> cBits)) && (8 > ptWriter->cBits));
+
+	ptWriter->nBuffer |= ((ULONGLONG)nValue) << ptWriter->cBits;
+	ptWriter->cBits += cBits;
+
+	*(UNALIGNED ULONGLONG *)ptWriter->pnOutput = ptWriter->nBuffer;
+	ptWriter->pnOutput += ptWriter->cBits / 8;
+	ptWriter->nBuffer >>= ptWriter->cBits & ~7;
+	ptWriter->cBits %= 8;
+}
+
+/**
+ * Writes out the bits that are left over,
+ * padding the last byte with zeroes.
+ *
+ * @param[in]	ptContext	The PNG.
+ */
+STATIC
+VOID
+vgapng_FlushBits(
+	_Inout_	PVGAPNG_CONTEXT	ptContext
+)
+{
+	if (0 < ptContext->cBits)
+	{
+		ptContext->pnOutput[ptContext->cbOutput++] = (BYTE)ptContext->nBitBuffer;
+	}
+	ptContext->nBitBuffer = 0;
+	ptContext->cBits = 0;
+}
+
+/**
+ * Finds the code of a match length or distance.
+ *
+ * @param[in]	pnBases		The smallest value of every code.
+ * @param[in]	nCodes		Number of codes.
+ * @param[in]	nValue		The length or distance.
+ *
+ * @returns DWORD (the code)
+ */
+STATIC
+FORCEINLINE
+DWORD
+vgapng_FindCode(
+	_In_reads_(nCodes)	CONST WORD *	pnBases,
+	_In_				DWORD			nCodes,
+	_In_				DWORD			nValue
+)
+{
+	DWORD	nCode	= nCodes - 1;
+
+	while (pnBases[nCode] > nValue)
+	{
+		--nCode;
+	}
+
+	return nCode;
+}
+
+/**
+ * Finds the code of a match distance.
+ * Matches are only ever a byte back or a line back.
+ *
+ * @param[in]	ptContext	The PNG.
+ * @param[in]	nDistance	The distance.
+ *
+ * @returns DWORD (the code)
+ */
+STATIC
+FORCEINLINE
+DWORD
+vgapng_GetDistanceCode(
+	_In_	PCVGAPNG_CONTEXT	ptContext,
+	_In_	DWORD				nDistance
+)
+{
+	assert((1 == nDistance) || (ptContext->cbLine == nDistance));
+
+	return (1 == nDistance) ? 0 : ptContext->nLineDistanceCode;
+}
+
+/**
+ * Builds length limited Huffman code lengths for symbol counts.
+ * Symbols that aren't used get no code, but at least two
+ * always get one, since a code must have a bit.
+ *
+ * @param[in]	pnCounts	How often each symbol is used.
+ * @param[in]	nSymbols	Number of symbols.
+ * @param[in]	nMaxLength	The longest code allowed.
+ * @param[out]	pnLengths	Will receive the length of every symbol's code.
+ *
+ * @remark	The lengths are built with the in-place algorithm of
+ *			Moffat and Katajainen, then the longest ones are
+ *			shortened, and the shortest go to the most used symbols.
+ */
+STATIC
+VOID
+vgapng_BuildLengths(
+	_In_reads_(nSymbols)		CONST DWORD *	pnCounts,
+	_In_						DWORD			nSymbols,
+	_In_						DWORD			nMaxLength,
+	_Out_writes_all_(nSymbols)	PBYTE			pnLengths
+)
+{
+	WORD	anSorted[DEFLATE_LITERAL_CODES]						= { 0 };
+	DWORD	anWeights[DEFLATE_LITERAL_CODES]					= { 0 };
+	DWORD	anLengthCounts[HUFFMAN_MAX_UNLIMITED_LENGTH + 1]	= { 0 };
+	DWORD	nUsed												= 0;
+	DWORD	nSymbol												= 0;
+	DWORD	nIndex												= 0;
+	DWORD	nInsert												= 0;
+	DWORD	nLength												= 0;
+	DWORD	nRoot												= 0;
+	DWORD	nLeaf												= 0;
+	DWORD	nNext												= 0;
+	DWORD	nAvailable											= 0;
+	DWORD	nTaken												= 0;
+	DWORD	nDepth												= 0;
+	DWORD	nKraft												= 0;
+
+	assert(DEFLATE_LITERAL_CODES >= nSymbols);
+
+	ZeroMemory(pnLengths, nSymbols);
+
+	// Sort the used symbols by count, least used first.
+	for (nSymbol = 0; nSymbol < nSymbols; ++nSymbol)
+	{
+		if (0 == pnCounts[nSymbol])
+		{
+			continue;
+		}
+		for (nInsert = nUsed; (0 < nInsert) && (anWeights[nInsert - 1] > pnCounts[nSymbol]); --nInsert)
+		{
+			anWeights[nInsert] = anWeights[nInsert - 1];
+			anSorted[nInsert] = anSorted[nInsert - 1];
+		}
+		anWeights[nInsert] = pnCounts[nSymbol];
+		anSorted[nInsert] = (WORD)nSymbol;
+		++nUsed;
+	}
+
+	// A single used symbol still takes a bit, so pair it with another.
+	for (nSymbol = 0; (2 > nUsed) && (nSymbol < nSymbols); ++nSymbol)
+	{
+		if ((1 == nUsed) && (anSorted[0] == nSymbol))
+		{
+			continue;
+		}
+		anSorted[nUsed] = anSorted[0];
+		anWeights[nUsed] = anWeights[0];
+		anSorted[0] = (WORD)nSymbol;
+		anWeights[0] = 0;
+		++nUsed;
+	}
+
+	// First pass: combine the two lightest nodes over and over,
+	// leaving every internal node's parent in its weight.
+	anWeights[0] += anWeights[1];
+	nRoot = 0;
+	nLeaf = 2;
+	for (nNext = 1; nNext < nUsed - 1; ++nNext)
+	{
+		if ((nLeaf >= nUsed) || (anWeights[nRoot] < anWeights[nLeaf]))
+		{
+			anWeights[nNext] = anWeights[nRoot];
+			anWeights[nRoot++] = nNext;
+		}
+		else
+		{
+			anWeights[nNext] = anWeights[nLeaf++];
+		}
+
+		if ((nLeaf >= nUsed) || ((nRoot < nNext) && (anWeights[nRoot] < anWeights[nLeaf])))
+		{
+			anWeights[nNext] += anWeights[nRoot];
+			anWeights[nRoot++] = nNext;
+		}
+		else
+		{
+			anWeights[nNext] += anWeights[nLeaf++];
+		}
+	}
+
+	// Second pass: turn the parents into depths.
+	anWeights[nUsed - 2] = 0;
+	for (nNext = nUsed - 2; nNext > 0; --nNext)
+	{
+		anWeights[nNext - 1] = anWeights[anWeights[nNext - 1]] + 1;
+	}
+
+	// Third pass: count the leaves at every depth.
+	nAvailable = 1;
+	nRoot = nUsed - 1;
+	nDepth = 0;
+	while (0 < nAvailable)
+	{
+		nTaken = 0;
+		while ((0 < nRoot) && (anWeights[nRoot - 1] == nDepth))
+		{
+			++nTaken;
+			--nRoot;
+		}
+		if (nAvailable > nTaken)
+		{
+			anLengthCounts[min(nDepth, HUFFMAN_MAX_UNLIMITED_LENGTH)] += nAvailable - nTaken;
+		}
+		nAvailable = 2 * nTaken;
+		++nDepth;
+	}
+
+	// Move the codes that are too long up, then lengthen
+	// shorter ones until the code is complete again.
+	for (nLength = nMaxLength + 1; nLength <= HUFFMAN_MAX_UNLIMITED_LENGTH; ++nLength)
+	{
+		anLengthCounts[nMaxLength] += anLengthCounts[nLength];
+		anLengthCounts[nLength] = 0;
+	}
+	for (nLength = nMaxLength; nLength > 0; --nLength)
+	{
+		nKraft += anLengthCounts[nLength] << (nMaxLength - nLength);
+	}
+	while ((1UL << nMaxLength) < nKraft)
+	{
+		--anLengthCounts[nMaxLength];
+		for (nLength = nMaxLength - 1; nLength > 0; --nLength)
+		{
+			if (0 != anLengthCounts[nLength])
+			{
+				--anLengthCounts[nLength];
+				anLengthCounts[nLength + 1] += 2;
+				break;
+			}
+		}
+		--nKraft;
+	}
+
+	// The least used symbols get the longest codes.
+	nIndex = 0;
+	for (nLength = nMaxLength; nLength > 0; --nLength)
+	{
+		for (nTaken = anLengthCounts[nLength]; nTaken > 0; --nTaken)
+		{
+			pnLengths[anSorted[nIndex++]] = (BYTE)nLength;
+		}
+	}
+	assert(nUsed == nIndex);
+}
+
+/**
+ * Assigns canonical codes to code lengths.
+ *
+ * @param[in]	pnLengths	The length of every symbol's code.
+ * @param[in]	nSymbols	Number of symbols.
+ * @param[out]	ptHuffman	Will receive the codes.
+ */
+STATIC
+VOID
+vgapng_BuildCodes(
+	_In_reads_(nSymbols)	CONST BYTE *	pnLengths,
+	_In_					DWORD			nSymbols,
+	_Out_					PVGAPNG_HUFFMAN	ptHuffman
+)
+{
+	DWORD	anLengthCounts[DEFLATE_MAX_CODE_LENGTH + 1]	= { 0 };
+	DWORD	anNextCodes[DEFLATE_MAX_CODE_LENGTH + 1]	= { 0 };
+	DWORD	nSymbol										= 0;
+	DWORD	nLength										= 0;
+	DWORD	nCode										= 0;
+	DWORD	nReversed									= 0;
+	DWORD	nBit										= 0;
+
+	ZeroMemory(ptHuffman, sizeof(*ptHuffman));
+
+	for (nSymbol = 0; nSymbol < nSymbols; ++nSymbol)
+	{
+		++anLengthCounts[pnLengths[nSymbol]];
+	}
+	anLengthCounts[0] = 0;
+	for (nLength = 1; nLength <= DEFLATE_MAX_CODE_LENGTH; ++nLength)
+	{
+		nCode = (nCode + anLengthCounts[nLength - 1]) << 1;
+		anNextCodes[nLength] = nCode;
+	}
+
+	for (nSymbol = 0; nSymbol < nSymbols; ++nSymbol)
+	{
+		nLength = pnLengths[nSymbol];
+		if (0 == nLength)
+		{
+			continue;
+		}
+
+		nCode = anNextCodes[nLength]++;
+		nReversed = 0;
+		for (nBit = 0; nBit < nLength; ++nBit)
+		{
+			nReversed = (nReversed << 1) | ((nCode >> nBit) & 1);
+		}
+		ptHuffman->anCodes[nSymbol] = (WORD)nReversed;
+		ptHuffman->anLengths[nSymbol] = (BYTE)nLength;
+	}
+}
+
+/**
+ * Writes a symbol with its code.
+ *
+ * @param[in]	ptWriter	The bit writer.
+ * @param[in]	ptHuffman	The code.
+ * @param[in]	nSymbol		The symbol.
+ */
+STATIC
+FORCEINLINE
+VOID
+vgapng_WriteSymbol(
+	_Inout_	PVGAPNG_BIT_WRITER	ptWriter,
+	_In_	PCVGAPNG_HUFFMAN	ptHuffman,
+	_In_	DWORD				nSymbol
+)
+{
+	assert(0 != ptHuffman->anLengths[nSymbol]);
+
+	vgapng_WriteBits(ptWriter, ptHuffman->anCodes[nSymbol], ptHuffman->anLengths[nSymbol]);
+}
+
+/**
+ * Run-length encodes the code lengths of a block's codes,
+ * as the block header stores them.
+ *
+ * @param[in]	pnLengths		The code lengths.
+ * @param[in]	nLengths		Number of code lengths.
+ * @param[out]	pnEncoded		Will receive the code length codes, each
+ *								with its repeat count in the high byte.
+ * @param[out]	pnCounts		Will receive how often each code is used.
+ *
+ * @returns DWORD (the number of code length codes)
+ */
+STATIC
+DWORD
+vgapng_EncodeLengths(
+	_In_reads_(nLengths)						CONST BYTE *	pnLengths,
+	_In_										DWORD			nLengths,
+	_Out_writes_to_(nLengths, return)			PWORD			pnEncoded,
+	_Out_writes_all_(DEFLATE_CODE_LENGTH_CODES)	PDWORD			pnCounts
+)
+{
+	DWORD	nEncoded	= 0;
+	DWORD	nIndex		= 0;
+	DWORD	nRun		= 0;
+	DWORD	nChunk		= 0;
+	BYTE	nLength		= 0;
+
+	ZeroMemory(pnCounts, DEFLATE_CODE_LENGTH_CODES * sizeof(*pnCounts));
+
+	while (nIndex < nLengths)
+	{
+		nLength = pnLengths[nIndex];
+		nRun = 1;
+		while ((nIndex + nRun < nLengths) && (pnLengths[nIndex + nRun] == nLength))
+		{
+			++nRun;
+		}
+		nIndex += nRun;
+
+		if (0 == nLength)
+		{
+			while (11 <= nRun)
+			{
+				nChunk = min(nRun, 138);
+				pnEncoded[nEncoded++] = (WORD)(DEFLATE_REPEAT_ZERO_LONG | ((nChunk - 11) << 8));
+				++pnCounts[DEFLATE_REPEAT_ZERO_LONG];
+				nRun -= nChunk;
+			}
+			if (3 <= nRun)
+			{
+				pnEncoded[nEncoded++] = (WORD)(DEFLATE_REPEAT_ZERO_SHORT | ((nRun - 3) << 8));
+				++pnCounts[DEFLATE_REPEAT_ZERO_SHORT];
+				nRun = 0;
+			}
+		}
+		else
+		{
+			// A repeat needs the length once before it.
+			pnEncoded[nEncoded++] = nLength;
+			++pnCounts[nLength];
+			--nRun;
+			while (3 <= nRun)
+			{
+				nChunk = min(nRun, 6);
+				pnEncoded[nEncoded++] = (WORD)(DEFLATE_REPEAT_PREVIOUS | ((nChunk - 3) << 8));
+				++pnCounts[DEFLATE_REPEAT_PREVIOUS];
+				nRun -= nChunk;
+			}
+		}
+
+		for (; 0 < nRun; --nRun)
+		{
+			pnEncoded[nEncoded++] = nLength;
+			++pnCounts[nLength];
+		}
+	}
+
+	return nEncoded;
+}
+
+/**
+ * Writes the symbols gathered so far as a block with its own codes.
+ *
+ * @param[in]	ptContext	The PNG.
+ * @param[in]	bFinal		Whether this is the last block.
+ *
+ * @returns HRESULT
+ */
+STATIC
+HRESULT
+vgapng_WriteBlock(
+	_Inout_	PVGAPNG_CONTEXT	ptContext,
+	_In_	BOOL			bFinal
+)
+{
+	HRESULT				hrResult															= E_FAIL;
+	BYTE				anLengths[DEFLATE_LITERAL_CODES + DEFLATE_DISTANCE_CODES]			= { 0 };
+	WORD				anEncodedLengths[DEFLATE_LITERAL_CODES + DEFLATE_DISTANCE_CODES]	= { 0 };
+	DWORD				anCodeLengthCounts[DEFLATE_CODE_LENGTH_CODES]						= { 0 };
+	BYTE				anCodeLengthLengths[DEFLATE_CODE_LENGTH_CODES]						= { 0 };
+	VGAPNG_HUFFMAN		tLiterals															= { 0 };
+	VGAPNG_HUFFMAN		tDistances															= { 0 };
+	VGAPNG_HUFFMAN		tCodeLengths														= { 0 };
+	VGAPNG_BIT_WRITER	tWriter																= { 0 };
+	DWORD				nLiteralCodes														= DEFLATE_LITERAL_CODES;
+	DWORD				nDistanceCodes														= DEFLATE_DISTANCE_CODES;
+	DWORD				nCodeLengthCodes													= DEFLATE_CODE_LENGTH_CODES;
+	DWORD				nEncodedLengths														= 0;
+	DWORD				cbBound																= 0;
+	DWORD				nIndex																= 0;
+	DWORD				nSymbol																= 0;
+	DWORD				nLength																= 0;
+	DWORD				nDistance															= 0;
+	DWORD				nCode																= 0;
+	DWORD				nExtraBits															= 0;
+
+	if (FAILED(DWordMult(ptContext->nSymbols, DEFLATE_MAX_SYMBOL_SIZE, &cbBound)) ||
+		FAILED(DWordAdd(cbBound, DEFLATE_MAX_HEADER_SIZE + sizeof(ULONGLONG), &cbBound)))
+	{
+		PROGRESS("The PNG is too big.");
+		hrResult = HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+		goto lblCleanup;
+	}
+	hrResult = vgapng_ReserveOutput(ptContext, cbBound);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	ptContext->anLiteralCounts[DEFLATE_END_OF_BLOCK] = 1;
+	vgapng_BuildLengths(ptContext->anLiteralCounts, DEFLATE_LITERAL_CODES, DEFLATE_MAX_CODE_LENGTH, anLengths);
+	vgapng_BuildLengths(ptContext->anDistanceCounts, DEFLATE_DISTANCE_CODES, DEFLATE_MAX_CODE_LENGTH, anLengths + DEFLATE_LITERAL_CODES);
+	vgapng_BuildCodes(anLengths, DEFLATE_LITERAL_CODES, &tLiterals);
+	vgapng_BuildCodes(anLengths + DEFLATE_LITERAL_CODES, DEFLATE_DISTANCE_CODES, &tDistances);
+
+	// Trailing unused codes aren't stored, and the distance lengths
+	// follow the literal ones right away.
+	while ((DEFLATE_FIRST_LENGTH_CODE < nLiteralCodes) && (0 == anLengths[nLiteralCodes - 1]))
+	{
+		--nLiteralCodes;
+	}
+	while ((1 < nDistanceCodes) && (0 == anLengths[DEFLATE_LITERAL_CODES + nDistanceCodes - 1]))
+	{
+		--nDistanceCodes;
+	}
+	MoveMemory(anLengths + nLiteralCodes, anLengths + DEFLATE_LITERAL_CODES, nDistanceCodes);
+
+	nEncodedLengths = vgapng_EncodeLengths(anLengths,
+										   nLiteralCodes + nDistanceCodes,
+										   anEncodedLengths,
+										   anCodeLengthCounts);
+	vgapng_BuildLengths(anCodeLengthCounts,
+						DEFLATE_CODE_LENGTH_CODES,
+						DEFLATE_MAX_CODE_LENGTH_CODE_LENGTH,
+						anCodeLengthLengths);
+	vgapng_BuildCodes(anCodeLengthLengths, DEFLATE_CODE_LENGTH_CODES, &tCodeLengths);
+	while ((4 < nCodeLengthCodes) && (0 == anCodeLengthLengths[g_anCodeLengthOrder[nCodeLengthCodes - 1]]))
+	{
+		--nCodeLengthCodes;
+	}
+
+	tWriter.pnOutput = ptContext->pnOutput + ptContext->cbOutput;
+	tWriter.nBuffer = ptContext->nBitBuffer;
+	tWriter.cBits = ptContext->cBits;
+
+	// The block header.
+	vgapng_WriteBits(&tWriter, bFinal ? 1 : 0, 1);
+	vgapng_WriteBits(&tWriter, DEFLATE_BLOCK_DYNAMIC, 2);
+	vgapng_WriteBits(&tWriter, nLiteralCodes - DEFLATE_FIRST_LENGTH_CODE, 5);
+	vgapng_WriteBits(&tWriter, nDistanceCodes - 1, 5);
+	vgapng_WriteBits(&tWriter, nCodeLengthCodes - 4, 4);
+	for (nIndex = 0; nIndex < nCodeLengthCodes; ++nIndex)
+	{
+		vgapng_WriteBits(&tWriter, anCodeLengthLengths[g_anCodeLengthOrder[nIndex]], 3);
+	}
+	for (nIndex = 0; nIndex < nEncodedLengths; ++nIndex)
+	{
+		nCode = anEncodedLengths[nIndex] & MAXBYTE;
+		vgapng_WriteSymbol(&tWriter, &tCodeLengths, nCode);
+		switch (nCode)
+		{
+		case DEFLATE_REPEAT_PREVIOUS:
+			vgapng_WriteBits(&tWriter, anEncodedLengths[nIndex] >> 8, 2);
+			break;
+
+		case DEFLATE_REPEAT_ZERO_SHORT:
+			vgapng_WriteBits(&tWriter, anEncodedLengths[nIndex] >> 8, 3);
+			break;
+
+		case DEFLATE_REPEAT_ZERO_LONG:
+			vgapng_WriteBits(&tWriter, anEncodedLengths[nIndex] >> 8, 7);
+			break;
+
+		default:
+			break;
+		}
+	}
+
+	// The symbols themselves.
+	for (nIndex = 0; nIndex < ptContext->nSymbols; ++nIndex)
+	{
+		nSymbol = ptContext->pnSymbols[nIndex];
+		if (MAXBYTE >= nSymbol)
+		{
+			vgapng_WriteSymbol(&tWriter, &tLiterals, nSymbol);
+			continue;
+		}
+
+		nLength = MATCH_SYMBOL_LENGTH(nSymbol);
+		nCode = ptContext->anLengthCodes[nLength];
+		vgapng_WriteSymbol(&tWriter, &tLiterals, DEFLATE_FIRST_LENGTH_CODE + nCode);
+		nExtraBits = g_anLengthExtraBits[nCode];
+		if (0 != nExtraBits)
+		{
+			vgapng_WriteBits(&tWriter, nLength - g_anLengthBases[nCode], nExtraBits);
+		}
+
+		nDistance = MATCH_SYMBOL_DISTANCE(nSymbol);
+		nCode = vgapng_GetDistanceCode(ptContext, nDistance);
+		vgapng_WriteSymbol(&tWriter, &tDistances, nCode);
+		nExtraBits = g_anDistanceExtraBits[nCode];
+		if (0 != nExtraBits)
+		{
+			vgapng_WriteBits(&tWriter, nDistance - g_anDistanceBases[nCode], nExtraBits);
+		}
+	}
+	vgapng_WriteSymbol(&tWriter, &tLiterals, DEFLATE_END_OF_BLOCK);
+
+	ptContext->cbOutput = (DWORD)(tWriter.pnOutput - ptContext->pnOutput);
+	ptContext->nBitBuffer = tWriter.nBuffer;
+	ptContext->cBits = tWriter.cBits;
+
+	ptContext->nSymbols = 0;
+	ZeroMemory(ptContext->anLiteralCounts, sizeof(ptContext->anLiteralCounts));
+	ZeroMemory(ptContext->anDistanceCounts, sizeof(ptContext->anDistanceCounts));
+
+	hrResult = S_OK;
+
+lblCleanup:
+	return hrResult;
+}
+
+/**
+ * Measures how far the bytes at a position repeat
+ * the ones a distance before them, a quadword at a time.
+ *
+ * @param[in]	pnWindow	The window.
+ * @param[in]	nPosition	The position.
+ * @param[in]	nDistance	The distance.
+ * @param[in]	nMaxLength	The longest match to look for.
+ *
+ * @returns DWORD (the length of the match)
+ */
+STATIC
+FORCEINLINE
+DWORD
+vgapng_MeasureMatch(
+	_In_reads_(nPosition + nMaxLength)	CONST BYTE *	pnWindow,
+	_In_								DWORD			nPosition,
+	_In_								DWORD			nDistance,
+	_In_								DWORD			nMaxLength
+)
+{
+	CONST BYTE *	pnCurrent	= pnWindow + nPosition;
+	CONST BYTE *	pnEarlier	= pnCurrent - nDistance;
+	DWORD			nLength		= 0;
+
+	while ((nLength + sizeof(ULONGLONG) <= nMaxLength) &&
+		   (*(UNALIGNED CONST ULONGLONG *)(pnCurrent + nLength) == *(UNALIGNED CONST ULONGLONG *)(pnEarlier + nLength)))
+	{
+		nLength += sizeof(ULONGLONG);
+	}
+	while ((nLength < nMaxLength) && (pnCurrent[nLength] == pnEarlier[nLength]))
+	{
+		++nLength;
+	}
+
+	return nLength;
+}
+
+/**
+ * Turns the current line into symbols.
+ * Screens are mostly runs of one color and rows that repeat
+ * the ones above them, so only matches a byte back and a line
+ * back are looked for, and the longest one is taken right away.
+ *
+ * @param[in]	ptContext	The PNG.
+ */
+STATIC
+VOID
+vgapng_CompressLine(
+	_Inout_	PVGAPNG_CONTEXT	ptContext
+)
+{
+	CONST BYTE *	pnWindow		= ptContext->pnWindow;
+	DWORD			cbLine			= ptContext->cbLine;
+	BOOL			bHasPrevious	= (0 < ptContext->nRowsWritten);
+	BOOL			bLineDistance	= bHasPrevious && (DEFLATE_WINDOW_SIZE >= cbLine);
+	DWORD			nRunStart		= bHasPrevious ? cbLine : (cbLine + 1);
+	DWORD			nPrefix			= 0;
+	BOOL			bRun			= FALSE;
+	BOOL			bLine			= FALSE;
+	DWORD			nPosition		= cbLine;
+	DWORD			nEnd			= 2 * cbLine;
+	DWORD			nMaxLength		= 0;
+	DWORD			nLength			= 0;
+	DWORD			nLineLength		= 0;
+	DWORD			nDistance		= 0;
+	PDWORD			pnSymbols		= ptContext->pnSymbols + ptContext->nSymbols;
+
+	assert(ptContext->nSymbols + cbLine <= ptContext->cSymbolCapacity);
+
+	while (nPosition < nEnd)
+	{
+		// Most positions in busy rows start no match at all,
+		// which the first bytes alone tell.
+		nPrefix = READ_DWORD(pnWindow + nPosition) & MIN_MATCH_MASK;
+		bRun = (nRunStart <= nPosition) &&
+			   (nPrefix == (READ_DWORD(pnWindow + nPosition - 1) & MIN_MATCH_MASK));
+		bLine = bLineDistance &&
+				(nPrefix == (READ_DWORD(pnWindow + nPosition - cbLine) & MIN_MATCH_MASK));
+
+		nMaxLength = min(nEnd - nPosition, DEFLATE_MAX_MATCH);
+		nLength = 0;
+		nDistance = 1;
+		if (bRun)
+		{
+			nLength = vgapng_MeasureMatch(pnWindow, nPosition, 1, nMaxLength);
+		}
+		if (bLine && (nLength < nMaxLength))
+		{
+			nLineLength = vgapng_MeasureMatch(pnWindow, nPosition, cbLine, nMaxLength);
+			if (nLineLength > nLength)
+			{
+				nLength = nLineLength;
+				nDistance = cbLine;
+			}
+		}
+
+		if (DEFLATE_MIN_MATCH > nLength)
+		{
+			*pnSymbols++ = pnWindow[nPosition];
+			++ptContext->anLiteralCounts[pnWindow[nPosition]];
+			++nPosition;
+			continue;
+		}
+
+		*pnSymbols++ = MAKE_MATCH_SYMBOL(nLength, nDistance);
+		++ptContext->anLiteralCounts[DEFLATE_FIRST_LENGTH_CODE + ptContext->anLengthCodes[nLength]];
+		++ptContext->anDistanceCounts[vgapng_GetDistanceCode(ptContext, nDistance)];
+		nPosition += nLength;
+	}
+
+	ptContext->nSymbols = (DWORD)(pnSymbols - ptContext->pnSymbols);
+}
+
+/**
+ * Filters a row into the current line, picking the filter
+ * that leaves the fewest bytes that neither repeat the byte
+ * before them nor the one above them.
+ *
+ * @param[in]	ptContext	The PNG.
+ * @param[in]	pnRow		The row.
+ */
+STATIC
+VOID
+vgapng_FilterRow(
+	_Inout_							PVGAPNG_CONTEXT	ptContext,
+	_In_reads_(ptContext->cbRow)	CONST BYTE *	pnRow
+)
+{
+	CONST BYTE *	pnPreviousRow	= ptContext->pnPreviousRow;
+	CONST BYTE *	pnAbove			= ptContext->pnWindow + 1;
+	PBYTE			pnLine			= ptContext->pnWindow + ptContext->cbLine;
+	DWORD			cbRow			= ptContext->cbRow;
+	DWORD			nNoneCost		= 0;
+	DWORD			nUpCost			= 0;
+	BYTE			nUp				= 0;
+	BYTE			nPreviousUp		= 0;
+	DWORD			nOffset			= 0;
+	ULONGLONG		nBytes			= 0;
+	ULONGLONG		nBytesBefore	= 0;
+	ULONGLONG		nBytesAbove		= 0;
+	ULONGLONG		nUpBytes		= 0;
+	ULONGLONG		nUpBytesBefore	= 0;
+
+	// The first row has nothing above it, so Up is the same as None.
+	// The costs are summed a quadword at a time, without branches,
+	// as the comparisons are as good as random on busy rows.
+	if (0 < ptContext->nRowsWritten)
+	{
+		nPreviousUp = (BYTE)(pnRow[0] - pnPreviousRow[0]);
+		nNoneCost = (pnRow[0] != pnAbove[0]);
+		nUpCost = (nPreviousUp != pnAbove[0]);
+		for (nOffset = 1; nOffset + sizeof(ULONGLONG) <= cbRow; nOffset += sizeof(ULONGLONG))
+		{
+			nBytes = READ_QUADWORD(pnRow + nOffset);
+			nBytesBefore = READ_QUADWORD(pnRow + nOffset - 1);
+			nBytesAbove = READ_QUADWORD(pnAbove + nOffset);
+			nUpBytes = SUBTRACT_BYTES(nBytes, READ_QUADWORD(pnPreviousRow + nOffset));
+			nUpBytesBefore = SUBTRACT_BYTES(nBytesBefore, READ_QUADWORD(pnPreviousRow + nOffset - 1));
+
+			nNoneCost += COUNT_HIGH_BITS(NONZERO_BYTES(nBytes ^ nBytesBefore) &
+										 NONZERO_BYTES(nBytes ^ nBytesAbove));
+			nUpCost += COUNT_HIGH_BITS(NONZERO_BYTES(nUpBytes ^ nUpBytesBefore) &
+									   NONZERO_BYTES(nUpBytes ^ nBytesAbove));
+		}
+		nPreviousUp = (BYTE)(pnRow[nOffset - 1] - pnPreviousRow[nOffset - 1]);
+		for (; nOffset < cbRow; ++nOffset)
+		{
+			nUp = (BYTE)(pnRow[nOffset] - pnPreviousRow[nOffset]);
+			nNoneCost += (pnRow[nOffset] != pnRow[nOffset - 1]) & (pnRow[nOffset] != pnAbove[nOffset]);
+			nUpCost += (nUp != nPreviousUp) & (nUp != pnAbove[nOffset]);
+			nPreviousUp = nUp;
+		}
+	}
+
+	if (nUpCost < nNoneCost)
+	{
+		pnLine[0] = PNG_FILTER_UP;
+		for (nOffset = 0; nOffset < cbRow; ++nOffset)
+		{
+			pnLine[1 + nOffset] = (BYTE)(pnRow[nOffset] - pnPreviousRow[nOffset]);
+		}
+	}
+	else
+	{
+		pnLine[0] = PNG_FILTER_NONE;
+		CopyMemory(pnLine + 1, pnRow, cbRow);
+	}
+}
+
+HRESULT
+VGAPNG_Create(
+	_In_					DWORD			nWidth,
+	_In_					DWORD			nHeight,
+	_In_reads_(VGA_COLORS)	CONST RGBQUAD *	ptPalette,
+	_Out_					PHVGAPNG		phPng
+)
+{
+	HRESULT			hrResult					= E_FAIL;
+	PVGAPNG_CONTEXT	ptContext					= NULL;
+	BYTE			anHeader[PNG_IHDR_SIZE]		= { 0 };
+	BYTE			anPalette[VGA_COLORS * 3]	= { 0 };
+	DWORD			cbWindow					= 0;
+	DWORD			nColor						= 0;
+	DWORD			nLength						= 0;
+	PBYTE			pnZlibHeader				= NULL;
+
+	// PNG dimensions are limited to 31 bits.
+	if ((0 == nWidth) ||
+		(0 == nHeight) ||
+		(MAXLONG < nWidth) ||
+		(MAXLONG < nHeight) ||
+		(NULL == ptPalette) ||
+		(NULL == phPng))
+	{
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+
+	ptContext = HEAPALLOC(sizeof(*ptContext));
+	if (NULL == ptContext)
+	{
+		PROGRESS("Oops. Ran out of memory.");
+		hrResult = E_OUTOFMEMORY;
+		goto lblCleanup;
+	}
+	ptContext->nWidth = nWidth;
+	ptContext->nHeight = nHeight;
+	ptContext->cbRow = VGA_PNG_ROW_SIZE(nWidth);
+	ptContext->cbLine = ptContext->cbRow + 1;
+	ptContext->cSymbolCapacity = DEFLATE_BLOCK_SYMBOLS + ptContext->cbLine;
+	ptContext->nAdlerLow = 1;
+
+	for (nLength = DEFLATE_MIN_MATCH; nLength <= DEFLATE_MAX_MATCH; ++nLength)
+	{
+		ptContext->anLengthCodes[nLength] = (BYTE)vgapng_FindCode(g_anLengthBases, DEFLATE_LENGTH_CODES, nLength);
+	}
+	ptContext->nLineDistanceCode = vgapng_FindCode(g_anDistanceBases,
+												   DEFLATE_DISTANCE_CODES,
+												   min(ptContext->cbLine, DEFLATE_WINDOW_SIZE));
+
+	// The matches' first bytes are read a DWORD at a time,
+	// so the window is padded for the last ones.
+	if (FAILED(DWordMult(ptContext->cbLine, 2, &cbWindow)) ||
+		FAILED(DWordAdd(cbWindow, sizeof(DWORD), &cbWindow)) ||
+		(MAXDWORD / sizeof(DWORD) < ptContext->cbLine + DEFLATE_BLOCK_SYMBOLS))
+	{
+		PROGRESS("The image is too big.");
+		hrResult = HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+		goto lblCleanup;
+	}
+	ptContext->pnPreviousRow = HEAPALLOC(ptContext->cbRow);
+	ptContext->pnWindow = HEAPALLOC(cbWindow);
+	ptContext->pnSymbols = HEAPALLOC(ptContext->cSymbolCapacity * sizeof(DWORD));
+	if ((NULL == ptContext->pnPreviousRow) ||
+		(NULL == ptContext->pnWindow) ||
+		(NULL == ptContext->pnSymbols))
+	{
+		PROGRESS("Oops. Ran out of memory.");
+		hrResult = E_OUTOFMEMORY;
+		goto lblCleanup;
+	}
+
+	hrResult = vgapng_ReserveOutput(ptContext, sizeof(g_anPngSignature));
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+	CopyMemory(ptContext->pnOutput, g_anPngSignature, sizeof(g_anPngSignature));
+	ptContext->cbOutput = sizeof(g_anPngSignature);
+
+	vgapng_StoreBigEndian(anHeader, nWidth);
+	vgapng_StoreBigEndian(anHeader + sizeof(DWORD), nHeight);
+	anHeader[8] = PNG_BIT_DEPTH;
+	anHeader[9] = PNG_COLOR_TYPE_PALETTE;
+	hrResult = vgapng_AppendChunk(ptContext, PNG_CHUNK_TYPE('I', 'H', 'D', 'R'), anHeader, sizeof(anHeader));
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	for (nColor = 0; nColor < VGA_COLORS; ++nColor)
+	{
+		anPalette[(nColor * 3) + 0] = ptPalette[nColor].rgbRed;
+		anPalette[(nColor * 3) + 1] = ptPalette[nColor].rgbGreen;
+		anPalette[(nColor * 3) + 2] = ptPalette[nColor].rgbBlue;
+	}
+	hrResult = vgapng_AppendChunk(ptContext, PNG_CHUNK_TYPE('P', 'L', 'T', 'E'), anPalette, sizeof(anPalette));
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	// The IDAT chunk's length and CRC are filled in once it's done.
+	hrResult = vgapng_ReserveOutput(ptContext, (2 * sizeof(DWORD)) + 2);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+	ptContext->nIdatOffset = ptContext->cbOutput;
+	vgapng_StoreBigEndian(ptContext->pnOutput + ptContext->cbOutput + sizeof(DWORD), PNG_CHUNK_TYPE('I', 'D', 'A', 'T'));
+	ptContext->cbOutput += 2 * sizeof(DWORD);
+
+	pnZlibHeader = ptContext->pnOutput + ptContext->cbOutput;
+	pnZlibHeader[0] = ZLIB_CMF;
+	pnZlibHeader[1] = ZLIB_FLG;
+	ptContext->cbOutput += 2;
+
+	// Transfer ownership:
+	*phPng = (HVGAPNG)ptContext;
+	ptContext = NULL;
+
+	hrResult = S_OK;
+
+lblCleanup:
+	VGAPNG_Destroy((HVGAPNG)ptContext);
+
+	return hrResult;
+}
+
+HRESULT
+VGAPNG_WriteRow(
+	_In_	HVGAPNG			hPng,
+	_In_	CONST BYTE *	pnRow
+)
+{
+	HRESULT			hrResult	= E_FAIL;
+	PVGAPNG_CONTEXT	ptContext	= (PVGAPNG_CONTEXT)hPng;
+
+	if ((NULL == hPng) ||
+		(NULL == pnRow))
+	{
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+	if (ptContext->nRowsWritten >= ptContext->nHeight)
+	{
+		PROGRESS("The PNG already has all of its rows.");
+		hrResult = E_UNEXPECTED;
+		goto lblCleanup;
+	}
+
+	// A line takes at most a symbol per byte, so the buffer
+	// always has room for one more.
+	if (DEFLATE_BLOCK_SYMBOLS <= ptContext->nSymbols)
+	{
+		hrResult = vgapng_WriteBlock(ptContext, FALSE);
+		if (FAILED(hrResult))
+		{
+			goto lblCleanup;
+		}
+	}
+
+	vgapng_FilterRow(ptContext, pnRow);
+	vgapng_UpdateAdler32(ptContext, ptContext->pnWindow + ptContext->cbLine, ptContext->cbLine);
+	vgapng_CompressLine(ptContext);
+
+	// The current line becomes the previous one.
+	CopyMemory(ptContext->pnPreviousRow, pnRow, ptContext->cbRow);
+	MoveMemory(ptContext->pnWindow, ptContext->pnWindow + ptContext->cbLine, ptContext->cbLine);
+	++ptContext->nRowsWritten;
+
+	hrResult = S_OK;
+
+lblCleanup:
+	return hrResult;
+}
+
+HRESULT
+VGAPNG_Finish(
+	_In_									HVGAPNG	hPng,
+	_Outptr_result_bytebuffer_(*pcbPng)		PBYTE *	ppnPng,
+	_Out_									PDWORD	pcbPng
+)
+{
+	HRESULT			hrResult	= E_FAIL;
+	PVGAPNG_CONTEXT	ptContext	= (PVGAPNG_CONTEXT)hPng;
+	PBYTE			pnIdat		= NULL;
+	DWORD			cbIdat		= 0;
+
+	if ((NULL == hPng) ||
+		(NULL == ppnPng) ||
+		(NULL == pcbPng))
+	{
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+	if (ptContext->nRowsWritten != ptContext->nHeight)
+	{
+		PROGRESS("The PNG is missing rows.");
+		hrResult = E_UNEXPECTED;
+		goto lblCleanup;
+	}
+
+	hrResult = vgapng_WriteBlock(ptContext, TRUE);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+	vgapng_FlushBits(ptContext);
+
+	// The block reserved room for these.
+	vgapng_StoreBigEndian(ptContext->pnOutput + ptContext->cbOutput,
+						  (ptContext->nAdlerHigh << 16) | ptContext->nAdlerLow);
+	ptContext->cbOutput += sizeof(DWORD);
+
+	pnIdat = ptContext->pnOutput + ptContext->nIdatOffset;
+	cbIdat = ptContext->cbOutput - ptContext->nIdatOffset - (2 * sizeof(DWORD));
+	vgapng_StoreBigEndian(pnIdat, cbIdat);
+	vgapng_StoreBigEndian(ptContext->pnOutput + ptContext->cbOutput,
+						  vgapng_Crc32(0, pnIdat + sizeof(DWORD), sizeof(DWORD) + cbIdat));
+	ptContext->cbOutput += sizeof(DWORD);
+
+	hrResult = vgapng_AppendChunk(ptContext, PNG_CHUNK_TYPE('I', 'E', 'N', 'D'), NULL, 0);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	// Transfer ownership:
+	*ppnPng = ptContext->pnOutput;
+	ptContext->pnOutput = NULL;
+	*pcbPng = ptContext->cbOutput;
+	ptContext->cbOutput = 0;
+	ptContext->cbOutputCapacity = 0;
+
+	hrResult = S_OK;
+
+lblCleanup:
+	return hrResult;
+}
+
+VOID
+VGAPNG_Destroy(
+	_In_	HVGAPNG	hPng
+)
+{
+	PVGAPNG_CONTEXT	ptContext	= (PVGAPNG_CONTEXT)hPng;
+
+	if (NULL == hPng)
+	{
+		goto lblCleanup;
+	}
+
+	HEAPFREE(ptContext->pnOutput);
+	HEAPFREE(ptContext->pnSymbols);
+	HEAPFREE(ptContext->pnWindow);
+	HEAPFREE(ptContext->pnPreviousRow);
+	HEAPFREE(ptContext);
+
+lblCleanup:
+	return;
+}
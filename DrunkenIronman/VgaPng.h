@@ -0,0 +1,101 @@
+/**
+ * @file VgaPng.h
+ * @author biko
+ * @date 2026-10-17
+ *
+ * VgaPng module public header.
+ * Contains routines for writing 16 color PNGs, one row at a time,
+ * with a built-in deflate tuned for screens: runs of one color,
+ * and rows that repeat the ones above them.
+ */
+#pragma once
+
+/** Headers *************************************************************/
+#include <Windows.h>
+
+#include <Drink.h>
+
+
+/** Macros **************************************************************/
+
+/**
+ * Size of a row of a 4bpp PNG, in bytes.
+ */
+#define VGA_PNG_ROW_SIZE(nWidth) (((nWidth) / 2) + ((nWidth) % 2))
+
+
+/** Typedefs ************************************************************/
+
+/**
+ * Handle to a PNG being written.
+ */
+DECLARE_HANDLE(HVGAPNG);
+typedef HVGAPNG *PHVGAPNG;
+
+
+/** Functions ***********************************************************/
+
+/**
+ * Starts writing a 4bpp paletted PNG.
+ *
+ * @param[in]	nWidth		Width of the image, in pixels.
+ * @param[in]	nHeight		Height of the image, in pixels.
+ * @param[in]	ptPalette	The colors of the VGA_COLORS pixel values.
+ * @param[out]	phPng		Will receive a handle to the PNG.
+ *
+ * @returns HRESULT
+ */
+HRESULT
+VGAPNG_Create(
+	_In_						DWORD			nWidth,
+	_In_						DWORD			nHeight,
+	_In_reads_(VGA_COLORS)		CONST RGBQUAD *	ptPalette,
+	_Out_						PHVGAPNG		phPng
+);
+
+/**
+ * Adds the next row to a PNG, top row first.
+ * The row is filtered and compressed right away,
+ * so it need not be kept around afterwards.
+ *
+ * @param[in]	hPng		The PNG.
+ * @param[in]	pnRow		The row's VGA_PNG_ROW_SIZE(nWidth) bytes
+ *							of pixels, two to a byte, leftmost in the
+ *							high nibble. The bits past the width
+ *							should be clear.
+ *
+ * @returns HRESULT
+ *
+ * @see VGADECODE_DecodeImageToNibbles
+ */
+HRESULT
+VGAPNG_WriteRow(
+	_In_	HVGAPNG			hPng,
+	_In_	CONST BYTE *	pnRow
+);
+
+/**
+ * Finishes a PNG, once all of its rows have been added.
+ *
+ * @param[in]	hPng		The PNG.
+ * @param[out]	ppnPng		Will receive the PNG file. Free with HEAPFREE.
+ * @param[out]	pcbPng		Will receive the size of the PNG file, in bytes.
+ *
+ * @returns HRESULT
+ */
+HRESULT
+VGAPNG_Finish(
+	_In_									HVGAPNG	hPng,
+	_Outptr_result_bytebuffer_(*pcbPng)		PBYTE *	ppnPng,
+	_Out_									PDWORD	pcbPng
+);
+
+/**
+ * Discards a PNG, finished or not.
+ *
+ * @param[in]	hPng		The PNG.
+ */
+VOID
+VGAPNG_Destroy(
+	_In_	HVGAPNG	hPng
+);
@@ -0,0 +1,504 @@
+/**
+ * @file VgaRle.c
+ * @author biko
+ * @date 2026-10-17
+ *
+ * VgaRle module implementation.
+ */
+
+/** Headers *************************************************************/
+#include <Windows.h>
+#include <intsafe.h>
+
+#include <assert.h>
+
+#include "Util.h"
+#include "Debug.h"
+
+#include "VgaRle.h"
+
+
+/** Constants ***********************************************************/
+
+/**
+ * A zero count escapes to one of these codes,
+ * or to an absolute run of 3 or more pixels.
+ */
+#define RLE_ESCAPE (0)
+#define RLE_END_OF_LINE (0)
+#define RLE_END_OF_BITMAP (1)
+#define RLE_DELTA (2)
+#define RLE_MIN_ABSOLUTE_RUN (3)
+
+/**
+ * The longest run a single count can describe.
+ */
+#define RLE_MAX_RUN (MAXBYTE)
+
+/**
+ * Runs of a single value at least this long are worth ending
+ * an absolute run for: the count and value take 2 bytes,
+ * and starting a new absolute run afterwards takes 2 to 3 more.
+ */
+#define RLE_MIN_ENCODED_RUN (4)
+
+/**
+ * Absolute runs are padded to a whole number of words.
+ */
+#define RLE_ALIGNMENT (sizeof(WORD))
+
+
+/** Macros **************************************************************/
+
+/**
+ * Repeats a pixel value in all 8 bytes.
+ */
+#define BROADCAST_PIXEL(nPixel) (((ULONGLONG)(nPixel)) * 0x0101010101010101ULL)
+
+/**
+ * Determines whether any byte of a quadword is zero.
+ */
+#define HAS_ZERO_BYTE(nValue)	\
+	(0 != (((nValue) - 0x0101010101010101ULL) & ~(nValue) & 0x8080808080808080ULL))
+
+/**
+ * Packs a pair of pixels into a byte, the first in the high nibble.
+ */
+#define PACK_NIBBLES(nFirst, nSecond) ((BYTE)((((nFirst) & 0x0F) << 4) | ((nSecond) & 0x0F)))
+
+
+/** Functions ***********************************************************/
+
+/**
+ * Measures the run of a single value starting at a pixel,
+ * comparing a quadword at a time.
+ *
+ * @param[in]	pnRow		The row.
+ * @param[in]	nStart		Where the run starts.
+ * @param[in]	nEnd		Where the run must end at the latest.
+ *
+ * @returns DWORD (the length of the run, at least 1)
+ */
+STATIC
+FORCEINLINE
+DWORD
+vgarle_MeasureRun(
+	_In_reads_(nEnd)	CONST BYTE *	pnRow,
+	_In_				DWORD			nStart,
+	_In_				DWORD			nEnd
+)
+{
+	ULONGLONG	nPattern	= BROADCAST_PIXEL(pnRow[nStart]);
+	DWORD		nPosition	= nStart + 1;
+
+	assert(nStart < nEnd);
+
+	while ((nPosition + sizeof(ULONGLONG) <= nEnd) &&
+		   (nPattern == *(UNALIGNED CONST ULONGLONG *)(pnRow + nPosition)))
+	{
+		nPosition += sizeof(ULONGLONG);
+	}
+
+	while ((nPosition < nEnd) && (pnRow[nPosition] == pnRow[nStart]))
+	{
+		++nPosition;
+	}
+
+	return nPosition - nStart;
+}
+
+/**
+ * Measures the pixels starting at a pixel that don't start
+ * a run worth encoding, comparing a quadword at a time.
+ *
+ * @param[in]	pnRow		The row.
+ * @param[in]	nStart		The first pixel.
+ * @param[in]	nEnd		Where the pixels must end at the latest.
+ *
+ * @returns DWORD (the number of pixels)
+ */
+STATIC
+FORCEINLINE
+DWORD
+vgarle_MeasureLiteral(
+	_In_reads_(nEnd)	CONST BYTE *	pnRow,
+	_In_				DWORD			nStart,
+	_In_				DWORD			nEnd
+)
+{
+	DWORD		nPosition		= nStart;
+	ULONGLONG	nDifferences	= 0;
+
+	C_ASSERT(4 == RLE_MIN_ENCODED_RUN);
+
+	// Byte N of the XOR is zero where pixel N equals the next one,
+	// so a run of 4 starts where 3 bytes in a row are zero.
+	// Only the first 6 bytes have all 3 in the quadword.
+	while (nPosition + sizeof(ULONGLONG) + 1 <= nEnd)
+	{
+		nDifferences = *(UNALIGNED CONST ULONGLONG *)(pnRow + nPosition) ^
+					   *(UNALIGNED CONST ULONGLONG *)(pnRow + nPosition + 1);
+		nDifferences |= (nDifferences >> 8) | (nDifferences >> 16) | 0xFFFF000000000000ULL;
+		if (HAS_ZERO_BYTE(nDifferences))
+		{
+			break;
+		}
+		nPosition += sizeof(ULONGLONG) - 2;
+	}
+
+	while ((nPosition < nEnd) &&
+		   !((nPosition + RLE_MIN_ENCODED_RUN <= nEnd) &&
+			 (pnRow[nPosition] == pnRow[nPosition + 1]) &&
+			 (pnRow[nPosition] == pnRow[nPosition + 2]) &&
+			 (pnRow[nPosition] == pnRow[nPosition + 3])))
+	{
+		++nPosition;
+	}
+
+	return nPosition - nStart;
+}
+
+/**
+ * Writes a run of a single value.
+ *
+ * @param[in]	nCount			Length of the run.
+ * @param[in]	nPixel			The value.
+ * @param[in]	nBitsPerPixel	4 or 8.
+ * @param[out]	pnOutput		Will receive the encoded run.
+ *
+ * @returns DWORD (the number of bytes written)
+ */
+STATIC
+FORCEINLINE
+DWORD
+vgarle_WriteEncodedRun(
+	_In_			DWORD	nCount,
+	_In_			BYTE	nPixel,
+	_In_			WORD	nBitsPerPixel,
+	_Out_writes_(2)	PBYTE	pnOutput
+)
+{
+	assert((0 < nCount) && (RLE_MAX_RUN >= nCount));
+
+	pnOutput[0] = (BYTE)nCount;
+	pnOutput[1] = (4 == nBitsPerPixel) ? PACK_NIBBLES(nPixel, nPixel) : nPixel;
+
+	return 2;
+}
+
+/**
+ * Writes a run of pixels as they are.
+ *
+ * @param[in]	pnPixels		The pixels.
+ * @param[in]	nCount			Number of pixels.
+ * @param[in]	nBitsPerPixel	4 or 8.
+ * @param[out]	pnOutput		Will receive the absolute run.
+ *
+ * @returns DWORD (the number of bytes written)
+ */
+STATIC
+DWORD
+vgarle_WriteAbsoluteRun(
+	_In_reads_(nCount)				CONST BYTE *	pnPixels,
+	_In_							DWORD			nCount,
+	_In_							WORD			nBitsPerPixel,
+	_Out_writes_(2 + nCount + 1)	PBYTE			pnOutput
+)
+{
+	DWORD	cbData	= 0;
+	DWORD	nPixel	= 0;
+
+	assert((RLE_MIN_ABSOLUTE_RUN <= nCount) && (RLE_MAX_RUN >= nCount));
+
+	pnOutput[0] = RLE_ESCAPE;
+	pnOutput[1] = (BYTE)nCount;
+	pnOutput += 2;
+
+	if (4 == nBitsPerPixel)
+	{
+		for (nPixel = 0; nPixel + 1 < nCount; nPixel += 2)
+		{
+			pnOutput[cbData++] = PACK_NIBBLES(pnPixels[nPixel], pnPixels[nPixel + 1]);
+		}
+		if (nPixel < nCount)
+		{
+			pnOutput[cbData++] = PACK_NIBBLES(pnPixels[nPixel], 0);
+		}
+	}
+	else
+	{
+		CopyMemory(pnOutput, pnPixels, nCount);
+		cbData = nCount;
+	}
+
+	if (0 != cbData % RLE_ALIGNMENT)
+	{
+		pnOutput[cbData++] = 0;
+	}
+
+	return 2 + cbData;
+}
+
+/**
+ * Encodes a single row of pixels, without the end of line.
+ *
+ * @param[in]	pnRow			The row.
+ * @param[in]	nWidth			Width of the row, in pixels.
+ * @param[in]	nBitsPerPixel	4 or 8.
+ * @param[out]	pnOutput		Will receive the encoded row.
+ *
+ * @returns DWORD (the number of bytes written)
+ *
+ * @remark	The encoded row takes at most 2 bytes per pixel.
+ */
+STATIC
+DWORD
+vgarle_CompressRow(
+	_In_reads_(nWidth)			CONST BYTE *	pnRow,
+	_In_						DWORD			nWidth,
+	_In_						WORD			nBitsPerPixel,
+	_Out_writes_(nWidth * 2)	PBYTE			pnOutput
+)
+{
+	DWORD	cbOutput	= 0;
+	DWORD	nX			= 0;
+	DWORD	nEnd		= 0;
+	DWORD	nRun		= 0;
+	DWORD	nLiteral	= 0;
+
+	while (nX < nWidth)
+	{
+		nRun = vgarle_MeasureRun(pnRow, nX, min(nX + RLE_MAX_RUN, nWidth));
+		if (RLE_MIN_ENCODED_RUN <= nRun)
+		{
+			cbOutput += vgarle_WriteEncodedRun(nRun, pnRow[nX], nBitsPerPixel, pnOutput + cbOutput);
+			nX += nRun;
+			continue;
+		}
+
+		// Store everything up to the next long run as is.
+		nLiteral = vgarle_MeasureLiteral(pnRow, nX, min(nX + RLE_MAX_RUN, nWidth));
+		assert(0 < nLiteral);
+		if (RLE_MIN_ABSOLUTE_RUN <= nLiteral)
+		{
+			cbOutput += vgarle_WriteAbsoluteRun(pnRow + nX, nLiteral, nBitsPerPixel, pnOutput + cbOutput);
+			nX += nLiteral;
+			continue;
+		}
+
+		// Too short for absolute mode, which is where the escapes are.
+		nEnd = nX + nLiteral;
+		while (nX < nEnd)
+		{
+			nRun = vgarle_MeasureRun(pnRow, nX, nEnd);
+			cbOutput += vgarle_WriteEncodedRun(nRun, pnRow[nX], nBitsPerPixel, pnOutput + cbOutput);
+			nX += nRun;
+		}
+	}
+
+	return cbOutput;
+}
+
+HRESULT
+VGARLE_Compress(
+	_In_reads_(cbPixelStride * nHeight)		CONST BYTE *	pnPixels,
+	_In_									DWORD			cbPixelStride,
+	_In_									DWORD			nWidth,
+	_In_									DWORD			nHeight,
+	_In_									WORD			nBitsPerPixel,
+	_Outptr_result_bytebuffer_(*pcbData)	PBYTE *			ppnData,
+	_Out_									PDWORD			pcbData
+)
+{
+	HRESULT	hrResult	= E_FAIL;
+	PBYTE	pnData		= NULL;
+	DWORD	cbBound		= 0;
+	DWORD	cbData		= 0;
+	DWORD	nRow		= 0;
+
+	if ((NULL == pnPixels) ||
+		(nWidth > cbPixelStride) ||
+		((4 != nBitsPerPixel) && (8 != nBitsPerPixel)) ||
+		(NULL == ppnData) ||
+		(NULL == pcbData))
+	{
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+
+	// Every row takes at most 2 bytes per pixel and an end of line,
+	// and the last one is followed by the end of the bitmap.
+	if (FAILED(DWordMult(nWidth, 2, &cbBound)) ||
+		FAILED(DWordAdd(cbBound, 2, &cbBound)) ||
+		FAILED(DWordMult(cbBound, nHeight, &cbBound)) ||
+		FAILED(DWordAdd(cbBound, 2, &cbBound)))
+	{
+		PROGRESS("The image is too big.");
+		hrResult = HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+		goto lblCleanup;
+	}
+
+	pnData = HEAPALLOC(cbBound);
+	if (NULL == pnData)
+	{
+		PROGRESS("Oops. Ran out of memory.");
+		hrResult = E_OUTOFMEMORY;
+		goto lblCleanup;
+	}
+
+	// BMPs with run-length encoded rows are always bottom-up.
+	for (nRow = nHeight; nRow > 0; --nRow)
+	{
+		cbData += vgarle_CompressRow(pnPixels + ((nRow - 1) * cbPixelStride),
+									 nWidth,
+									 nBitsPerPixel,
+									 pnData + cbData);
+
+		// The end of the bitmap also ends the last row.
+		pnData[cbData++] = RLE_ESCAPE;
+		pnData[cbData++] = (1 == nRow) ? RLE_END_OF_BITMAP : RLE_END_OF_LINE;
+	}
+	if (0 == nHeight)
+	{
+		pnData[cbData++] = RLE_ESCAPE;
+		pnData[cbData++] = RLE_END_OF_BITMAP;
+	}
+	assert(cbData <= cbBound);
+
+	// Transfer ownership:
+	*ppnData = pnData;
+	pnData = NULL;
+	*pcbData = cbData;
+
+	hrResult = S_OK;
+
+lblCleanup:
+	HEAPFREE(pnData);
+
+	return hrResult;
+}
+
+HRESULT
+VGARLE_Expand(
+	_In_reads_bytes_(cbData)				CONST BYTE *	pnData,
+	_In_									DWORD			cbData,
+	_In_									WORD			nBitsPerPixel,
+	_In_									DWORD			nWidth,
+	_In_									DWORD			nHeight,
+	_Out_writes_(cbPixelStride * nHeight)	PBYTE			pnPixels,
+	_In_									DWORD			cbPixelStride
+)
+{
+	HRESULT	hrResult	= E_FAIL;
+	DWORD	nOffset		= 0;
+	DWORD	nX			= 0;
+	DWORD	nY			= 0;
+	DWORD	nCount		= 0;
+	BYTE	nValue		= 0;
+	DWORD	cbRun		= 0;
+	DWORD	nPixel		= 0;
+	PBYTE	pnRow		= NULL;
+
+	if ((NULL == pnData) ||
+		((4 != nBitsPerPixel) && (8 != nBitsPerPixel)) ||
+		(nWidth > cbPixelStride) ||
+		(NULL == pnPixels))
+	{
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+
+	for (nY = 0; nY < nHeight; ++nY)
+	{
+		ZeroMemory(pnPixels + (nY * cbPixelStride), nWidth);
+	}
+
+	nY = 0;
+	for (;;)
+	{
+		if (2 > cbData - nOffset)
+		{
+			PROGRESS("The RLE data ends without an end of bitmap.");
+			hrResult = HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+			goto lblCleanup;
+		}
+		nCount = pnData[nOffset];
+		nValue = pnData[nOffset + 1];
+		nOffset += 2;
+
+		if (RLE_ESCAPE != nCount)
+		{
+			if ((nY >= nHeight) || (nCount > nWidth - nX))
+			{
+				PROGRESS("An RLE run is out of the image.");
+				hrResult = HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+				goto lblCleanup;
+			}
+
+			// Rows are stored bottom-up.
+			// At 4bpp, the run alternates between the two nibbles.
+			pnRow = pnPixels + ((nHeight - 1 - nY) * cbPixelStride);
+			for (nPixel = 0; nPixel < nCount; ++nPixel)
+			{
+				pnRow[nX + nPixel] =
+					(8 == nBitsPerPixel) ? nValue
+										 : (BYTE)((nValue >> ((0 == nPixel % 2) ? 4 : 0)) & 0x0F);
+			}
+			nX += nCount;
+			continue;
+		}
+
+		switch (nValue)
+		{
+		case RLE_END_OF_LINE:
+			nX = 0;
+			++nY;
+			break;
+
+		case RLE_END_OF_BITMAP:
+			hrResult = S_OK;
+			goto lblCleanup;
+
+		case RLE_DELTA:
+			if ((2 > cbData - nOffset) ||
+				(pnData[nOffset] > nWidth - nX))
+			{
+				PROGRESS("An RLE delta is out of the image.");
+				hrResult = HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+				goto lblCleanup;
+			}
+			nX += pnData[nOffset];
+			nY += pnData[nOffset + 1];
+			nOffset += 2;
+			break;
+
+		default:
+			nCount = nValue;
+			cbRun = (8 == nBitsPerPixel) ? nCount : ((nCount + 1) / 2);
+			if ((nY >= nHeight) ||
+				(nCount > nWidth - nX) ||
+				(cbRun > cbData - nOffset))
+			{
+				PROGRESS("An RLE run is out of the image.");
+				hrResult = HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+				goto lblCleanup;
+			}
+
+			pnRow = pnPixels + ((nHeight - 1 - nY) * cbPixelStride);
+			for (nPixel = 0; nPixel < nCount; ++nPixel)
+			{
+				pnRow[nX + nPixel] =
+					(8 == nBitsPerPixel) ? pnData[nOffset + nPixel]
+										 : (BYTE)((pnData[nOffset + (nPixel / 2)] >> ((0 == nPixel % 2) ? 4 : 0)) & 0x0F);
+			}
+			nX += nCount;
+
+			// The padding may be missing at the very end.
+			nOffset += min(cbRun + (cbRun % RLE_ALIGNMENT), cbData - nOffset);
+			break;
+		}
+	}
+
+lblCleanup:
+	return hrResult;
+}
@@ -0,0 +1,69 @@
+/**
+ * @file VgaRle.h
+ * @author biko
+ * @date 2026-10-17
+ *
+ * VgaRle module public header.
+ * Contains routines for run-length encoding indexed pixels
+ * the way BI_RLE8 and BI_RLE4 BMPs store them.
+ */
+#pragma once
+
+/** Headers *************************************************************/
+#include <Windows.h>
+
+
+/** Functions ***********************************************************/
+
+/**
+ * Run-length encodes indexed pixels.
+ * Runs of a single value are stored as a count and the value,
+ * and everything else is stored as is, in absolute mode.
+ *
+ * @param[in]	pnPixels		The indexed pixels, top row first.
+ * @param[in]	cbPixelStride	Distance between rows in pnPixels, in bytes.
+ * @param[in]	nWidth			Width of the image, in pixels.
+ * @param[in]	nHeight			Height of the image, in pixels.
+ * @param[in]	nBitsPerPixel	4 for BI_RLE4, 8 for BI_RLE8.
+ *								At 4bpp, only the low nibble of each pixel is used.
+ * @param[out]	ppnData			Will receive the encoded rows, bottom row first,
+ *								as BMPs store them. Free with HEAPFREE.
+ * @param[out]	pcbData			Will receive the size of the encoded rows.
+ *
+ * @returns HRESULT
+ */
+HRESULT
+VGARLE_Compress(
+	_In_reads_(cbPixelStride * nHeight)		CONST BYTE *	pnPixels,
+	_In_									DWORD			cbPixelStride,
+	_In_									DWORD			nWidth,
+	_In_									DWORD			nHeight,
+	_In_									WORD			nBitsPerPixel,
+	_Outptr_result_bytebuffer_(*pcbData)	PBYTE *			ppnData,
+	_Out_									PDWORD			pcbData
+);
+
+/**
+ * Expands run-length encoded pixels.
+ *
+ * @param[in]	pnData			The encoded rows, bottom row first.
+ * @param[in]	cbData			Size of the encoded rows, in bytes.
+ * @param[in]	nBitsPerPixel	4 for BI_RLE4, 8 for BI_RLE8.
+ * @param[in]	nWidth			Width of the image, in pixels.
+ * @param[in]	nHeight			Height of the image, in pixels.
+ * @param[out]	pnPixels		Will receive the indexed pixels, top row first.
+ *								Pixels skipped by the encoding are set to 0.
+ * @param[in]	cbPixelStride	Distance between rows in pnPixels, in bytes.
+ *
+ * @returns HRESULT
+ */
+HRESULT
+VGARLE_Expand(
+	_In_reads_bytes_(cbData)				CONST BYTE *	pnData,
+	_In_									DWORD			cbData,
+	_In_									WORD			nBitsPerPixel,
+	_In_									DWORD			nWidth,
+	_In_									DWORD			nHeight,
+	_Out_writes_(cbPixelStride * nHeight)	PBYTE			pnPixels,
+	_In_									DWORD			cbPixelStride
+);
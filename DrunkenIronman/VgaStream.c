@@ -0,0 +1,506 @@
+/**
+ * @file VgaStream.c
+ * @author biko
+ * @date 2026-10-17
+ *
+ * VgaStream module implementation.
+ */
+
+/** Headers *************************************************************/
+#include <Windows.h>
+
+#include <assert.h>
+
+#include "Util.h"
+#include "Debug.h"
+
+#include "VgaStream.h"
+
+
+/** Typedefs ************************************************************/
+
+/**
+ * An output stream.
+ */
+typedef struct _VGASTREAM_CONTEXT
+{
+	// Where the data goes, and whether the stream owns the handle.
+	HANDLE	hFile;
+	BOOL	bOwnsFile;
+
+	// Bytes written so far, including the buffered ones.
+	DWORD64	cbTotal;
+
+	// Whether the stream may be mapped, and whether flushing it
+	// waits for the mapped data to reach the disk.
+	BOOL	bMappable;
+	BOOL	bDurable;
+
+	// The mapping, once the stream is sized.
+	// Everything written goes straight into the view.
+	HANDLE	hMapping;
+	PBYTE	pnView;
+	DWORD	cbView;
+
+	// Data waiting to be written.
+	DWORD	cbBuffered;
+	BYTE	anBuffer[VGA_STREAM_BUFFER_SIZE];
+} VGASTREAM_CONTEXT, *PVGASTREAM_CONTEXT;
+typedef CONST VGASTREAM_CONTEXT *PCVGASTREAM_CONTEXT;
+
+
+/** Functions ***********************************************************/
+
+/**
+ * Writes data to a stream's file, bypassing the buffer.
+ *
+ * @param[in]	ptContext	The stream.
+ * @param[in]	pvData		The data to write.
+ * @param[in]	cbData		Size of the data, in bytes.
+ *
+ * @returns HRESULT
+ */
+STATIC
+HRESULT
+vgastream_WriteFile(
+	_In_						PVGASTREAM_CONTEXT	ptContext,
+	_In_reads_bytes_(cbData)	LPCVOID				pvData,
+	_In_						DWORD				cbData
+)
+{
+	HRESULT	hrResult	= E_FAIL;
+	DWORD	cbWritten	= 0;
+
+	assert(NULL != ptContext);
+	assert(NULL != pvData);
+
+	if (!WriteFile(ptContext->hFile,
+				   pvData,
+				   cbData,
+				   &cbWritten,
+				   NULL))
+	{
+		hrResult = HRESULT_FROM_WIN32(GetLastError());
+		goto lblCleanup;
+	}
+	if (cbData != cbWritten)
+	{
+		hrResult = E_UNEXPECTED;
+		goto lblCleanup;
+	}
+
+	hrResult = S_OK;
+
+lblCleanup:
+	return hrResult;
+}
+
+HRESULT
+VGASTREAM_Create(
+	_In_opt_	PCWSTR		pwszPath,
+	_Out_		PHVGASTREAM	phStream
+)
+{
+	HRESULT				hrResult	= E_FAIL;
+	PVGASTREAM_CONTEXT	ptContext	= NULL;
+
+	if (NULL == phStream)
+	{
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+
+	ptContext = HEAPALLOC(sizeof(*ptContext));
+	if (NULL == ptContext)
+	{
+		PROGRESS("Oops. Ran out of memory.");
+		hrResult = E_OUTOFMEMORY;
+		goto lblCleanup;
+	}
+
+	if (NULL == pwszPath)
+	{
+		ptContext->hFile = GetStdHandle(STD_OUTPUT_HANDLE);
+		if ((INVALID_HANDLE_VALUE == ptContext->hFile) ||
+			(NULL == ptContext->hFile))
+		{
+			PROGRESS("There's no standard output to write to.");
+			hrResult = HRESULT_FROM_WIN32(ERROR_INVALID_HANDLE);
+			goto lblCleanup;
+		}
+	}
+	else
+	{
+		ptContext->hFile = CreateFileW(pwszPath,
+									   GENERIC_WRITE,
+									   0,
+									   NULL,
+									   CREATE_ALWAYS,
+									   FILE_ATTRIBUTE_NORMAL,
+									   NULL);
+		if (INVALID_HANDLE_VALUE == ptContext->hFile)
+		{
+			hrResult = HRESULT_FROM_WIN32(GetLastError());
+			goto lblCleanup;
+		}
+		ptContext->bOwnsFile = TRUE;
+	}
+
+	// Transfer ownership:
+	*phStream = (HVGASTREAM)ptContext;
+	ptContext = NULL;
+
+	hrResult = S_OK;
+
+lblCleanup:
+	VGASTREAM_Close((HVGASTREAM)ptContext);
+
+	return hrResult;
+}
+
+HRESULT
+VGASTREAM_CreateMapped(
+	_In_	PCWSTR		pwszPath,
+	_In_	BOOL		bDurable,
+	_Out_	PHVGASTREAM	phStream
+)
+{
+	HRESULT				hrResult	= E_FAIL;
+	PVGASTREAM_CONTEXT	ptContext	= NULL;
+
+	if ((NULL == pwszPath) ||
+		(NULL == phStream))
+	{
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+
+	ptContext = HEAPALLOC(sizeof(*ptContext));
+	if (NULL == ptContext)
+	{
+		PROGRESS("Oops. Ran out of memory.");
+		hrResult = E_OUTOFMEMORY;
+		goto lblCleanup;
+	}
+
+	// Mapping a file for writing takes reading it too.
+	ptContext->hFile = CreateFileW(pwszPath,
+								   GENERIC_READ | GENERIC_WRITE,
+								   0,
+								   NULL,
+								   CREATE_ALWAYS,
+								   FILE_ATTRIBUTE_NORMAL,
+								   NULL);
+	if (INVALID_HANDLE_VALUE == ptContext->hFile)
+	{
+		hrResult = HRESULT_FROM_WIN32(GetLastError());
+		goto lblCleanup;
+	}
+	ptContext->bOwnsFile = TRUE;
+	ptContext->bMappable = TRUE;
+	ptContext->bDurable = bDurable;
+
+	// Transfer ownership:
+	*phStream = (HVGASTREAM)ptContext;
+	ptContext = NULL;
+
+	hrResult = S_OK;
+
+lblCleanup:
+	VGASTREAM_Close((HVGASTREAM)ptContext);
+
+	return hrResult;
+}
+
+HRESULT
+VGASTREAM_Map(
+	_In_	HVGASTREAM	hStream,
+	_In_	DWORD		cbSize
+)
+{
+	HRESULT				hrResult	= E_FAIL;
+	PVGASTREAM_CONTEXT	ptContext	= (PVGASTREAM_CONTEXT)hStream;
+
+	if ((NULL == hStream) ||
+		(0 != ptContext->cbTotal) ||
+		(NULL != ptContext->pnView))
+	{
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+
+	// Empty files can't be mapped, and have nothing to save anyway.
+	if ((!ptContext->bMappable) ||
+		(0 == cbSize))
+	{
+		hrResult = S_OK;
+		goto lblCleanup;
+	}
+
+	// Sizes the file, too.
+	ptContext->hMapping = CreateFileMappingW(ptContext->hFile,
+											 NULL,
+											 PAGE_READWRITE,
+											 0,
+											 cbSize,
+											 NULL);
+	if (NULL == ptContext->hMapping)
+	{
+		hrResult = HRESULT_FROM_WIN32(GetLastError());
+		goto lblCleanup;
+	}
+
+	ptContext->pnView = MapViewOfFile(ptContext->hMapping, FILE_MAP_WRITE, 0, 0, cbSize);
+	if (NULL == ptContext->pnView)
+	{
+		hrResult = HRESULT_FROM_WIN32(GetLastError());
+		goto lblCleanup;
+	}
+	ptContext->cbView = cbSize;
+
+	hrResult = S_OK;
+
+lblCleanup:
+	if (FAILED(hrResult) && (NULL != hStream))
+	{
+		CLOSE_HANDLE(ptContext->hMapping);
+	}
+
+	return hrResult;
+}
+
+BOOL
+VGASTREAM_IsMapped(
+	_In_	HVGASTREAM	hStream
+)
+{
+	PCVGASTREAM_CONTEXT	ptContext	= (PCVGASTREAM_CONTEXT)hStream;
+
+	assert(NULL != hStream);
+
+	return NULL != ptContext->pnView;
+}
+
+HRESULT
+VGASTREAM_Write(
+	_In_						HVGASTREAM	hStream,
+	_In_reads_bytes_(cbData)	LPCVOID		pvData,
+	_In_						DWORD		cbData
+)
+{
+	HRESULT				hrResult	= E_FAIL;
+	PVGASTREAM_CONTEXT	ptContext	= (PVGASTREAM_CONTEXT)hStream;
+
+	if ((NULL == hStream) ||
+		((NULL == pvData) && (0 != cbData)))
+	{
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+
+	if (NULL != ptContext->pnView)
+	{
+		if (ptContext->cbView - ptContext->cbTotal < cbData)
+		{
+			hrResult = HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
+			goto lblCleanup;
+		}
+		CopyMemory(ptContext->pnView + ptContext->cbTotal, pvData, cbData);
+		ptContext->cbTotal += cbData;
+
+		hrResult = S_OK;
+		goto lblCleanup;
+	}
+
+	if (sizeof(ptContext->anBuffer) - ptContext->cbBuffered < cbData)
+	{
+		hrResult = VGASTREAM_Flush(hStream);
+		if (FAILED(hrResult))
+		{
+			goto lblCleanup;
+		}
+	}
+
+	// Copying what doesn't fit in the buffer anyway
+	// would only split it into more writes.
+	if (sizeof(ptContext->anBuffer) <= cbData)
+	{
+		hrResult = vgastream_WriteFile(ptContext, pvData, cbData);
+		if (FAILED(hrResult))
+		{
+			goto lblCleanup;
+		}
+	}
+	else
+	{
+		CopyMemory(ptContext->anBuffer + ptContext->cbBuffered, pvData, cbData);
+		ptContext->cbBuffered += cbData;
+	}
+	ptContext->cbTotal += cbData;
+
+	hrResult = S_OK;
+
+lblCleanup:
+	return hrResult;
+}
+
+HRESULT
+VGASTREAM_Reserve(
+	_In_									HVGASTREAM	hStream,
+	_In_									DWORD		cbMinimum,
+	_Outptr_result_bytebuffer_(*pcbSpace)	PBYTE *		ppnSpace,
+	_Out_									PDWORD		pcbSpace
+)
+{
+	HRESULT				hrResult	= E_FAIL;
+	PVGASTREAM_CONTEXT	ptContext	= (PVGASTREAM_CONTEXT)hStream;
+
+	if ((NULL == hStream) ||
+		(NULL == ppnSpace) ||
+		(NULL == pcbSpace))
+	{
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+
+	// The rest of the mapping is all there is.
+	if (NULL != ptContext->pnView)
+	{
+		if (ptContext->cbView - ptContext->cbTotal < cbMinimum)
+		{
+			hrResult = HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
+			goto lblCleanup;
+		}
+		*ppnSpace = ptContext->pnView + ptContext->cbTotal;
+		*pcbSpace = ptContext->cbView - (DWORD)ptContext->cbTotal;
+
+		hrResult = S_OK;
+		goto lblCleanup;
+	}
+
+	if (sizeof(ptContext->anBuffer) < cbMinimum)
+	{
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+
+	if (sizeof(ptContext->anBuffer) - ptContext->cbBuffered < cbMinimum)
+	{
+		hrResult = VGASTREAM_Flush(hStream);
+		if (FAILED(hrResult))
+		{
+			goto lblCleanup;
+		}
+	}
+
+	*ppnSpace = ptContext->anBuffer + ptContext->cbBuffered;
+	*pcbSpace = sizeof(ptContext->anBuffer) - ptContext->cbBuffered;
+
+	hrResult = S_OK;
+
+lblCleanup:
+	return hrResult;
+}
+
+VOID
+VGASTREAM_Commit(
+	_In_	HVGASTREAM	hStream,
+	_In_	DWORD		cbUsed
+)
+{
+	PVGASTREAM_CONTEXT	ptContext	= (PVGASTREAM_CONTEXT)hStream;
+
+	assert(NULL != hStream);
+
+	if (NULL != ptContext->pnView)
+	{
+		assert(cbUsed <= ptContext->cbView - ptContext->cbTotal);
+	}
+	else
+	{
+		assert(cbUsed <= sizeof(ptContext->anBuffer) - ptContext->cbBuffered);
+		ptContext->cbBuffered += cbUsed;
+	}
+	ptContext->cbTotal += cbUsed;
+}
+
+DWORD64
+VGASTREAM_GetSize(
+	_In_	HVGASTREAM	hStream
+)
+{
+	PCVGASTREAM_CONTEXT	ptContext	= (PCVGASTREAM_CONTEXT)hStream;
+
+	assert(NULL != hStream);
+
+	return ptContext->cbTotal;
+}
+
+HRESULT
+VGASTREAM_Flush(
+	_In_	HVGASTREAM	hStream
+)
+{
+	HRESULT				hrResult	= E_FAIL;
+	PVGASTREAM_CONTEXT	ptContext	= (PVGASTREAM_CONTEXT)hStream;
+
+	if (NULL == hStream)
+	{
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+
+	if (0 != ptContext->cbBuffered)
+	{
+		hrResult = vgastream_WriteFile(ptContext, ptContext->anBuffer, ptContext->cbBuffered);
+		if (FAILED(hrResult))
+		{
+			goto lblCleanup;
+		}
+		ptContext->cbBuffered = 0;
+	}
+
+	if ((NULL != ptContext->pnView) && ptContext->bDurable)
+	{
+		if (!FlushViewOfFile(ptContext->pnView, ptContext->cbView))
+		{
+			hrResult = HRESULT_FROM_WIN32(GetLastError());
+			goto lblCleanup;
+		}
+		if (!FlushFileBuffers(ptContext->hFile))
+		{
+			hrResult = HRESULT_FROM_WIN32(GetLastError());
+			goto lblCleanup;
+		}
+	}
+
+	hrResult = S_OK;
+
+lblCleanup:
+	return hrResult;
+}
+
+VOID
+VGASTREAM_Close(
+	_In_	HVGASTREAM	hStream
+)
+{
+	PVGASTREAM_CONTEXT	ptContext	= (PVGASTREAM_CONTEXT)hStream;
+
+	if (NULL == hStream)
+	{
+		goto lblCleanup;
+	}
+
+	// The system writes the mapped data out on its own.
+	CLOSE(ptContext->pnView, UnmapViewOfFile);
+	CLOSE_HANDLE(ptContext->hMapping);
+	if (ptContext->bOwnsFile)
+	{
+		CLOSE_FILE_HANDLE(ptContext->hFile);
+	}
+	HEAPFREE(ptContext);
+
+lblCleanup:
+	return;
+}
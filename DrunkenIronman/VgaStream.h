@@ -0,0 +1,198 @@
+/**
+ * @file VgaStream.h
+ * @author biko
+ * @date 2026-10-17
+ *
+ * VgaStream module public header.
+ * Contains routines for writing images out a piece at a time,
+ * through a small buffer, to a file or to the standard output,
+ * or straight into a mapping of the file.
+ */
+#pragma once
+
+/** Headers *************************************************************/
+#include <Windows.h>
+
+
+/** Constants ***********************************************************/
+
+/**
+ * Size of a stream's buffer, in bytes.
+ * This is also the most that can be reserved at once.
+ */
+#define VGA_STREAM_BUFFER_SIZE (16 * 1024)
+
+
+/** Typedefs ************************************************************/
+
+/**
+ * Handle to an output stream.
+ */
+DECLARE_HANDLE(HVGASTREAM);
+typedef HVGASTREAM *PHVGASTREAM;
+
+
+/** Functions ***********************************************************/
+
+/**
+ * Opens an output stream.
+ *
+ * @param[in]	pwszPath	The file to write, which is overwritten
+ *							if it exists. NULL for the standard output.
+ * @param[out]	phStream	Will receive a handle to the stream.
+ *
+ * @returns HRESULT
+ */
+HRESULT
+VGASTREAM_Create(
+	_In_opt_	PCWSTR		pwszPath,
+	_Out_		PHVGASTREAM	phStream
+);
+
+/**
+ * Opens an output stream that can write straight into a mapping
+ * of its file, saving the copy through the buffer. Until it's mapped,
+ * it's written through the buffer like any other stream.
+ *
+ * @param[in]	pwszPath	The file to write, which is overwritten
+ *							if it exists.
+ * @param[in]	bDurable	Whether flushing the stream also waits for
+ *							the mapped data to reach the disk. Scratch
+ *							outputs can leave that to the system.
+ * @param[out]	phStream	Will receive a handle to the stream.
+ *
+ * @returns HRESULT
+ *
+ * @see VGASTREAM_Map
+ */
+HRESULT
+VGASTREAM_CreateMapped(
+	_In_	PCWSTR		pwszPath,
+	_In_	BOOL		bDurable,
+	_Out_	PHVGASTREAM	phStream
+);
+
+/**
+ * Sizes a stream opened with VGASTREAM_CreateMapped, and maps it,
+ * once it's known how much will be written to it. Everything
+ * written afterwards goes straight into the mapping, and
+ * reservations get the rest of it. Other streams are left as they are.
+ *
+ * @param[in]	hStream		The stream. Nothing may have been written to it.
+ * @param[in]	cbSize		How much will be written to it, in bytes.
+ *
+ * @returns HRESULT
+ */
+HRESULT
+VGASTREAM_Map(
+	_In_	HVGASTREAM	hStream,
+	_In_	DWORD		cbSize
+);
+
+/**
+ * Checks whether a stream writes straight into a mapping of its file.
+ *
+ * @param[in]	hStream		The stream.
+ *
+ * @returns BOOL
+ *
+ * @see VGASTREAM_Map
+ */
+BOOL
+VGASTREAM_IsMapped(
+	_In_	HVGASTREAM	hStream
+);
+
+/**
+ * Writes data to a stream.
+ * Small writes are gathered in the buffer,
+ * and big ones go out as they are.
+ *
+ * @param[in]	hStream		The stream.
+ * @param[in]	pvData		The data to write.
+ * @param[in]	cbData		Size of the data, in bytes.
+ *
+ * @returns HRESULT
+ */
+HRESULT
+VGASTREAM_Write(
+	_In_						HVGASTREAM	hStream,
+	_In_reads_bytes_(cbData)	LPCVOID		pvData,
+	_In_						DWORD		cbData
+);
+
+/**
+ * Reserves room in a stream's buffer, so that the data
+ * can be written into it directly rather than copied there.
+ * Flushes the buffer first if there isn't enough room.
+ *
+ * @param[in]	hStream		The stream.
+ * @param[in]	cbMinimum	The least room needed, in bytes.
+ *							At most VGA_STREAM_BUFFER_SIZE,
+ *							unless the stream is mapped.
+ * @param[out]	ppnSpace	Will receive the room.
+ * @param[out]	pcbSpace	Will receive the size of the room,
+ *							which may be more than asked for.
+ *
+ * @returns HRESULT
+ *
+ * @see VGASTREAM_Commit
+ */
+HRESULT
+VGASTREAM_Reserve(
+	_In_									HVGASTREAM	hStream,
+	_In_									DWORD		cbMinimum,
+	_Outptr_result_bytebuffer_(*pcbSpace)	PBYTE *		ppnSpace,
+	_Out_									PDWORD		pcbSpace
+);
+
+/**
+ * Adds the start of the reserved room to the stream.
+ *
+ * @param[in]	hStream		The stream.
+ * @param[in]	cbUsed		How much of the room was written, in bytes.
+ *
+ * @see VGASTREAM_Reserve
+ */
+VOID
+VGASTREAM_Commit(
+	_In_	HVGASTREAM	hStream,
+	_In_	DWORD		cbUsed
+);
+
+/**
+ * Retrieves the number of bytes written to a stream so far,
+ * including those still in its buffer.
+ *
+ * @param[in]	hStream		The stream.
+ *
+ * @returns DWORD64
+ */
+DWORD64
+VGASTREAM_GetSize(
+	_In_	HVGASTREAM	hStream
+);
+
+/**
+ * Writes out whatever is left in a stream's buffer.
+ * A durable mapped stream is written to the disk.
+ *
+ * @param[in]	hStream		The stream.
+ *
+ * @returns HRESULT
+ */
+HRESULT
+VGASTREAM_Flush(
+	_In_	HVGASTREAM	hStream
+);
+
+/**
+ * Closes a stream, without flushing it.
+ * The standard output is left open.
+ *
+ * @param[in]	hStream		The stream.
+ */
+VOID
+VGASTREAM_Close(
+	_In_	HVGASTREAM	hStream
+);
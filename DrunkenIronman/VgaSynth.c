@@ -0,0 +1,500 @@
+/**
+ * @file VgaSynth.c
+ * @author biko
+ * @date 2026-10-17
+ *
+ * VgaSynth module implementation.
+ */
+
+/** Headers *************************************************************/
+#include <Windows.h>
+
+#include <assert.h>
+
+#include <Drink.h>
+
+#include "Debug.h"
+
+#include "VgaSynth.h"
+
+
+/** Constants ***********************************************************/
+
+/**
+ * Pixel values of the BSoD's background and text,
+ * in the boot video driver's palette.
+ */
+#define BSOD_BACKGROUND (4)
+#define BSOD_FOREGROUND (15)
+
+/**
+ * Scan lines of each glyph that have ink in them.
+ * The rest are the spacing between lines.
+ */
+#define GLYPH_FIRST_INKED_LINE (2)
+#define GLYPH_LAST_INKED_LINE (12)
+
+/**
+ * Range of the glyphs picked for the text.
+ */
+#define GLYPH_FIRST_PRINTABLE (0x21)
+#define GLYPH_LAST_PRINTABLE (0x7E)
+
+/**
+ * Proportion of the lines of a BSoD that are left blank, in percent.
+ */
+#define BSOD_BLANK_LINE_PERCENT (25)
+
+/**
+ * Longest word on a BSoD, in characters.
+ */
+#define BSOD_MAX_WORD_LENGTH (12)
+
+/**
+ * Number of noise pixels made from each random number.
+ */
+#define NOISE_PIXELS_PER_RANDOM ((8 * sizeof(DWORD)) / VGA_PLANES)
+
+
+/** Typedefs ************************************************************/
+
+/**
+ * A synthetic font: each glyph is a set of random strokes.
+ */
+typedef struct _VGASYNTH_FONT
+{
+	BYTE	aanGlyphs[VGA_FONT_GLYPHS][VGA_SYNTH_CHAR_HEIGHT];
+} VGASYNTH_FONT, *PVGASYNTH_FONT;
+typedef CONST VGASYNTH_FONT *PCVGASYNTH_FONT;
+
+/**
+ * Where synthetic screens are drawn.
+ */
+typedef struct _VGASYNTH_CANVAS
+{
+	PBYTE	pnPixels;
+	DWORD	cbPixelStride;
+	DWORD	nWidth;
+	DWORD	nHeight;
+} VGASYNTH_CANVAS, *PVGASYNTH_CANVAS;
+typedef CONST VGASYNTH_CANVAS *PCVGASYNTH_CANVAS;
+
+
+/** Globals *************************************************************/
+
+/**
+ * Names of the kinds of synthetic screens.
+ */
+STATIC CONST PCWSTR g_apwszKindNames[] = {
+	L"solid",
+	L"text",
+	L"noise",
+	L"bsod",
+};
+C_ASSERT(ARRAYSIZE(g_apwszKindNames) == VGA_SYNTH_KINDS);
+
+/**
+ * The boot video driver's palette, as 6-bit DAC values.
+ */
+STATIC CONST PALETTE_ENTRY g_atBootPalette[VGA_COLORS] = {
+	{ 0x00, 0x00, 0x00 },	// Black
+	{ 0x20, 0x00, 0x00 },	// Red
+	{ 0x00, 0x20, 0x00 },	// Green
+	{ 0x20, 0x20, 0x00 },	// Brown
+	{ 0x00, 0x00, 0x20 },	// Blue
+	{ 0x20, 0x00, 0x20 },	// Magenta
+	{ 0x00, 0x20, 0x20 },	// Cyan
+	{ 0x20, 0x20, 0x20 },	// Dark gray
+	{ 0x30, 0x30, 0x30 },	// Light gray
+	{ 0x3F, 0x00, 0x00 },	// Light red
+	{ 0x00, 0x3F, 0x00 },	// Light green
+	{ 0x3F, 0x3F, 0x00 },	// Yellow
+	{ 0x00, 0x00, 0x3F },	// Light blue
+	{ 0x3F, 0x00, 0x3F },	// Light magenta
+	{ 0x00, 0x3F, 0x3F },	// Light cyan
+	{ 0x3F, 0x3F, 0x3F },	// White
+};
+
+
+/** Functions ***********************************************************/
+
+/**
+ * Generates a pseudo-random number (xorshift64*).
+ *
+ * @param[in,out]	pnState	The generator's state. Must not be 0.
+ *
+ * @returns DWORD
+ */
+STATIC
+DWORD
+vgasynth_Random(
+	_Inout_	PULONGLONG	pnState
+)
+{
+	ULONGLONG	nState	= *pnState;
+
+	nState ^= nState >> 12;
+	nState ^= nState << 25;
+	nState ^= nState >> 27;
+	*pnState = nState;
+
+	return (DWORD)((nState * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+/**
+ * Generates a pseudo-random number in a range.
+ *
+ * @param[in,out]	pnState	The generator's state.
+ * @param[in]		nFirst	Smallest number to generate.
+ * @param[in]		nLast	Largest number to generate.
+ *
+ * @returns DWORD
+ */
+STATIC
+DWORD
+vgasynth_RandomInRange(
+	_Inout_	PULONGLONG	pnState,
+	_In_	DWORD		nFirst,
+	_In_	DWORD		nLast
+)
+{
+	assert(nFirst <= nLast);
+
+	return nFirst + (vgasynth_Random(pnState) % (nLast - nFirst + 1));
+}
+
+/**
+ * Generates a font of random strokes.
+ * The space glyph is left blank.
+ *
+ * @param[in,out]	pnState	The random generator's state.
+ * @param[out]		ptFont	Will receive the font.
+ */
+STATIC
+VOID
+vgasynth_GenerateFont(
+	_Inout_	PULONGLONG		pnState,
+	_Out_	PVGASYNTH_FONT	ptFont
+)
+{
+	DWORD	nGlyph	= 0;
+	DWORD	nLine	= 0;
+
+	ZeroMemory(ptFont, sizeof(*ptFont));
+
+	for (nGlyph = GLYPH_FIRST_PRINTABLE; nGlyph < VGA_FONT_GLYPHS; ++nGlyph)
+	{
+		for (nLine = GLYPH_FIRST_INKED_LINE; nLine <= GLYPH_LAST_INKED_LINE; ++nLine)
+		{
+			// About a quarter of the pixels are inked, and the
+			// rightmost column is kept clear to separate the glyphs.
+			ptFont->aanGlyphs[nGlyph][nLine] =
+				(BYTE)(vgasynth_Random(pnState) & vgasynth_Random(pnState) & 0xFE);
+		}
+	}
+}
+
+/**
+ * Fills a rectangle of the canvas, clipping it to the canvas.
+ *
+ * @param[in]	ptCanvas	The canvas.
+ * @param[in]	nLeft		Left edge of the rectangle.
+ * @param[in]	nTop		Top edge of the rectangle.
+ * @param[in]	nWidth		Width of the rectangle.
+ * @param[in]	nHeight		Height of the rectangle.
+ * @param[in]	nColor		The pixel value to fill with.
+ */
+STATIC
+VOID
+vgasynth_FillRectangle(
+	_In_	PCVGASYNTH_CANVAS	ptCanvas,
+	_In_	DWORD				nLeft,
+	_In_	DWORD				nTop,
+	_In_	DWORD				nWidth,
+	_In_	DWORD				nHeight,
+	_In_	BYTE				nColor
+)
+{
+	DWORD	nRow	= 0;
+
+	if ((nLeft >= ptCanvas->nWidth) ||
+		(nTop >= ptCanvas->nHeight))
+	{
+		goto lblCleanup;
+	}
+	nWidth = min(nWidth, ptCanvas->nWidth - nLeft);
+	nHeight = min(nHeight, ptCanvas->nHeight - nTop);
+
+	for (nRow = nTop; nRow < nTop + nHeight; ++nRow)
+	{
+		FillMemory(ptCanvas->pnPixels + (nRow * ptCanvas->cbPixelStride) + nLeft,
+				   nWidth,
+				   nColor);
+	}
+
+lblCleanup:
+	return;
+}
+
+/**
+ * Draws a character on the canvas, clipping it to the canvas.
+ *
+ * @param[in]	ptCanvas		The canvas.
+ * @param[in]	ptFont			The font to draw with.
+ * @param[in]	nLeft			Left edge of the character's cell.
+ * @param[in]	nTop			Top edge of the character's cell.
+ * @param[in]	nGlyph			The character.
+ * @param[in]	nForeground		Pixel value of the ink.
+ * @param[in]	nBackground		Pixel value of the rest of the cell.
+ */
+STATIC
+VOID
+vgasynth_DrawCharacter(
+	_In_	PCVGASYNTH_CANVAS	ptCanvas,
+	_In_	PCVGASYNTH_FONT		ptFont,
+	_In_	DWORD				nLeft,
+	_In_	DWORD				nTop,
+	_In_	BYTE				nGlyph,
+	_In_	BYTE				nForeground,
+	_In_	BYTE				nBackground
+)
+{
+	DWORD	nLine	= 0;
+	DWORD	nColumn	= 0;
+	BYTE	nBits	= 0;
+	PBYTE	pnRow	= NULL;
+
+	for (nLine = 0;
+		 (nLine < VGA_SYNTH_CHAR_HEIGHT) && (nTop + nLine < ptCanvas->nHeight);
+		 ++nLine)
+	{
+		pnRow = ptCanvas->pnPixels + ((nTop + nLine) * ptCanvas->cbPixelStride);
+		nBits = ptFont->aanGlyphs[nGlyph][nLine];
+
+		for (nColumn = 0;
+			 (nColumn < VGA_SYNTH_CHAR_WIDTH) && (nLeft + nColumn < ptCanvas->nWidth);
+			 ++nColumn)
+		{
+			pnRow[nLeft + nColumn] = (0 != (nBits & (0x80 >> nColumn))) ? nForeground : nBackground;
+		}
+	}
+}
+
+/**
+ * Generates a screen full of character cells, each with
+ * random foreground and background colors.
+ *
+ * @param[in,out]	pnState		The random generator's state.
+ * @param[in]		ptFont		The font to draw with.
+ * @param[in]		ptCanvas	The canvas to draw on.
+ */
+STATIC
+VOID
+vgasynth_GenerateText(
+	_Inout_	PULONGLONG			pnState,
+	_In_	PCVGASYNTH_FONT		ptFont,
+	_In_	PCVGASYNTH_CANVAS	ptCanvas
+)
+{
+	DWORD	nLeft		= 0;
+	DWORD	nTop		= 0;
+	BYTE	nForeground	= 0;
+	BYTE	nBackground	= 0;
+
+	// Cells that don't fit are cut off at the edges.
+	for (nTop = 0; nTop < ptCanvas->nHeight; nTop += VGA_SYNTH_CHAR_HEIGHT)
+	{
+		for (nLeft = 0; nLeft < ptCanvas->nWidth; nLeft += VGA_SYNTH_CHAR_WIDTH)
+		{
+			nBackground = (BYTE)vgasynth_RandomInRange(pnState, 0, VGA_COLORS - 1);
+			nForeground = (BYTE)((nBackground + vgasynth_RandomInRange(pnState, 1, VGA_COLORS - 1)) % VGA_COLORS);
+
+			vgasynth_DrawCharacter(ptCanvas,
+								   ptFont,
+								   nLeft,
+								   nTop,
+								   (BYTE)vgasynth_RandomInRange(pnState, GLYPH_FIRST_PRINTABLE, VGA_FONT_GLYPHS - 1),
+								   nForeground,
+								   nBackground);
+		}
+	}
+}
+
+/**
+ * Generates lines of words on a solid background, like a BSoD.
+ * Lines are of random lengths, with some left blank,
+ * and the screen's edges are left as margins.
+ *
+ * @param[in,out]	pnState		The random generator's state.
+ * @param[in]		ptFont		The font to draw with.
+ * @param[in]		ptCanvas	The canvas to draw on.
+ */
+STATIC
+VOID
+vgasynth_GenerateBsod(
+	_Inout_	PULONGLONG			pnState,
+	_In_	PCVGASYNTH_FONT		ptFont,
+	_In_	PCVGASYNTH_CANVAS	ptCanvas
+)
+{
+	DWORD	nColumns	= ptCanvas->nWidth / VGA_SYNTH_CHAR_WIDTH;
+	DWORD	nLines		= ptCanvas->nHeight / VGA_SYNTH_CHAR_HEIGHT;
+	DWORD	nLine		= 0;
+	DWORD	nColumn		= 0;
+	DWORD	nLineEnd	= 0;
+	DWORD	nWordEnd	= 0;
+
+	vgasynth_FillRectangle(ptCanvas, 0, 0, ptCanvas->nWidth, ptCanvas->nHeight, BSOD_BACKGROUND);
+
+	// Leave a margin of a character all around.
+	if ((3 > nColumns) || (3 > nLines))
+	{
+		goto lblCleanup;
+	}
+
+	for (nLine = 1; nLine < nLines - 1; ++nLine)
+	{
+		if (vgasynth_RandomInRange(pnState, 1, 100) <= BSOD_BLANK_LINE_PERCENT)
+		{
+			continue;
+		}
+
+		nLineEnd = vgasynth_RandomInRange(pnState, 2, nColumns - 1);
+		for (nColumn = 1; nColumn < nLineEnd; nColumn = nWordEnd + 1)
+		{
+			nWordEnd = min(nLineEnd, nColumn + vgasynth_RandomInRange(pnState, 1, BSOD_MAX_WORD_LENGTH));
+			for (; nColumn < nWordEnd; ++nColumn)
+			{
+				vgasynth_DrawCharacter(ptCanvas,
+									   ptFont,
+									   nColumn * VGA_SYNTH_CHAR_WIDTH,
+									   nLine * VGA_SYNTH_CHAR_HEIGHT,
+									   (BYTE)vgasynth_RandomInRange(pnState, GLYPH_FIRST_PRINTABLE, GLYPH_LAST_PRINTABLE),
+									   BSOD_FOREGROUND,
+									   BSOD_BACKGROUND);
+			}
+		}
+	}
+
+lblCleanup:
+	return;
+}
+
+HRESULT
+VGASYNTH_ParseKind(
+	_In_	PCWSTR			pwszName,
+	_Out_	PVGA_SYNTH_KIND	peKind
+)
+{
+	HRESULT	hrResult	= E_FAIL;
+	DWORD	nKind		= 0;
+
+	assert(NULL != pwszName);
+	assert(NULL != peKind);
+
+	for (nKind = 0; nKind < VGA_SYNTH_KINDS; ++nKind)
+	{
+		if (0 == _wcsicmp(pwszName, g_apwszKindNames[nKind]))
+		{
+			break;
+		}
+	}
+	if (VGA_SYNTH_KINDS == nKind)
+	{
+		PROGRESS("Unknown kind of screen '%S'.", pwszName);
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+
+	*peKind = (VGA_SYNTH_KIND)nKind;
+
+	hrResult = S_OK;
+
+lblCleanup:
+	return hrResult;
+}
+
+PCWSTR
+VGASYNTH_GetKindName(
+	_In_	VGA_SYNTH_KIND	eKind
+)
+{
+	assert(VGA_SYNTH_KINDS > eKind);
+
+	return g_apwszKindNames[eKind];
+}
+
+VOID
+VGASYNTH_GetPalette(
+	_Out_writes_all_(VGA_DAC_PALETTE_ENTRIES)	PPALETTE_ENTRY	ptPaletteEntries
+)
+{
+	assert(NULL != ptPaletteEntries);
+
+	ZeroMemory(ptPaletteEntries, VGA_DAC_PALETTE_ENTRIES * sizeof(ptPaletteEntries[0]));
+	CopyMemory(ptPaletteEntries, g_atBootPalette, sizeof(g_atBootPalette));
+}
+
+VOID
+VGASYNTH_Generate(
+	_In_									VGA_SYNTH_KIND	eKind,
+	_In_									DWORD			nSeed,
+	_In_									DWORD			nWidth,
+	_In_									DWORD			nHeight,
+	_Out_writes_(cbPixelStride * nHeight)	PBYTE			pnPixels,
+	_In_									DWORD			cbPixelStride
+)
+{
+	// The high bits keep the state from ever being 0.
+	ULONGLONG		nState		= 0x9E3779B97F4A7C15ULL ^ nSeed;
+	VGASYNTH_CANVAS	tCanvas		= { pnPixels, cbPixelStride, nWidth, nHeight };
+	VGASYNTH_FONT	tFont		= { { { 0 } } };
+	DWORD			nRow		= 0;
+	DWORD			nColumn		= 0;
+	DWORD			nRandom		= 0;
+
+	assert(VGA_SYNTH_KINDS > eKind);
+	assert(NULL != pnPixels);
+	assert(nWidth <= cbPixelStride);
+
+	switch (eKind)
+	{
+	case VGA_SYNTH_KIND_SOLID:
+		vgasynth_FillRectangle(&tCanvas,
+							   0,
+							   0,
+							   nWidth,
+							   nHeight,
+							   (BYTE)vgasynth_RandomInRange(&nState, 0, VGA_COLORS - 1));
+		break;
+
+	case VGA_SYNTH_KIND_TEXT:
+		vgasynth_GenerateFont(&nState, &tFont);
+		vgasynth_GenerateText(&nState, &tFont, &tCanvas);
+		break;
+
+	case VGA_SYNTH_KIND_NOISE:
+		for (nRow = 0; nRow < nHeight; ++nRow)
+		{
+			for (nColumn = 0; nColumn < nWidth; ++nColumn)
+			{
+				if (0 == nColumn % NOISE_PIXELS_PER_RANDOM)
+				{
+					nRandom = vgasynth_Random(&nState);
+				}
+				pnPixels[(nRow * cbPixelStride) + nColumn] = (BYTE)(nRandom & (VGA_COLORS - 1));
+				nRandom >>= VGA_PLANES;
+			}
+		}
+		break;
+
+	case VGA_SYNTH_KIND_BSOD:
+		vgasynth_GenerateFont(&nState, &tFont);
+		vgasynth_GenerateBsod(&nState, &tFont, &tCanvas);
+		break;
+
+	default:
+		assert(FALSE);
+		break;
+	}
+}
@@ -0,0 +1,112 @@
+/**
+ * @file VgaSynth.h
+ * @author biko
+ * @date 2026-10-17
+ *
+ * VgaSynth module public header.
+ * Contains routines for generating synthetic screens,
+ * for testing and benchmarking without a crashed machine.
+ */
+#pragma once
+
+/** Headers *************************************************************/
+#include <Windows.h>
+
+#include <Drink.h>
+
+
+/** Constants ***********************************************************/
+
+/**
+ * Dimensions of the character cells of synthetic text.
+ */
+#define VGA_SYNTH_CHAR_WIDTH (8)
+#define VGA_SYNTH_CHAR_HEIGHT (16)
+
+
+/** Enums ***************************************************************/
+
+/**
+ * The kinds of synthetic screens.
+ */
+typedef enum _VGA_SYNTH_KIND
+{
+	// A single color.
+	VGA_SYNTH_KIND_SOLID = 0,
+
+	// Character cells covering the whole screen,
+	// each with its own foreground and background.
+	VGA_SYNTH_KIND_TEXT,
+
+	// Every pixel random.
+	VGA_SYNTH_KIND_NOISE,
+
+	// Lines of white text on a blue background,
+	// laid out like a BSoD.
+	VGA_SYNTH_KIND_BSOD,
+
+	// Must be last:
+	VGA_SYNTH_KINDS
+} VGA_SYNTH_KIND, *PVGA_SYNTH_KIND;
+
+
+/** Functions ***********************************************************/
+
+/**
+ * Looks up a kind of synthetic screen by its name.
+ *
+ * @param[in]	pwszName	The name, as returned by VGASYNTH_GetKindName.
+ * @param[out]	peKind		Will receive the kind.
+ *
+ * @returns HRESULT
+ */
+HRESULT
+VGASYNTH_ParseKind(
+	_In_	PCWSTR			pwszName,
+	_Out_	PVGA_SYNTH_KIND	peKind
+);
+
+/**
+ * Retrieves the name of a kind of synthetic screen.
+ *
+ * @param[in]	eKind	The kind.
+ *
+ * @returns PCWSTR
+ */
+PCWSTR
+VGASYNTH_GetKindName(
+	_In_	VGA_SYNTH_KIND	eKind
+);
+
+/**
+ * Retrieves the DAC palette synthetic screens are displayed with:
+ * the 16 colors the kernel's boot video driver programs for the BSoD,
+ * followed by black.
+ *
+ * @param[out]	ptPaletteEntries	Will receive the palette.
+ */
+VOID
+VGASYNTH_GetPalette(
+	_Out_writes_all_(VGA_DAC_PALETTE_ENTRIES)	PPALETTE_ENTRY	ptPaletteEntries
+);
+
+/**
+ * Generates a synthetic screen as indexed pixels.
+ * The same seed always generates the same screen.
+ *
+ * @param[in]	eKind			The kind of screen.
+ * @param[in]	nSeed			Seeds the random choices.
+ * @param[in]	nWidth			Width of the screen, in pixels.
+ * @param[in]	nHeight			Height of the screen, in pixels.
+ * @param[out]	pnPixels		Will receive the indexed pixels, top row first.
+ * @param[in]	cbPixelStride	Distance between rows in pnPixels, in bytes.
+ */
+VOID
+VGASYNTH_Generate(
+	_In_									VGA_SYNTH_KIND	eKind,
+	_In_									DWORD			nSeed,
+	_In_									DWORD			nWidth,
+	_In_									DWORD			nHeight,
+	_Out_writes_(cbPixelStride * nHeight)	PBYTE			pnPixels,
+	_In_									DWORD			cbPixelStride
+);
@@ -0,0 +1,772 @@
+/**
+ * @file VgaText.c
+ * @author biko
+ * @date 2026-10-17
+ *
+ * VgaText module implementation.
+ */
+
+/** Headers *************************************************************/
+#include <Windows.h>
+#include <intrin.h>
+#include <intsafe.h>
+
+#include <assert.h>
+#include <string.h>
+
+#include <Drink.h>
+
+#include "Util.h"
+#include "Debug.h"
+
+#include "VgaText.h"
+
+
+/** Constants ***********************************************************/
+
+/**
+ * Number of slots in the glyph signature table.
+ * Must be a power of two, and at least twice the number
+ * of glyphs to keep the probe sequences short.
+ */
+#define SIGNATURE_SLOTS (512)
+
+/**
+ * Marks an empty slot in the glyph signature table.
+ */
+#define SIGNATURE_SLOT_EMPTY (0)
+
+/**
+ * Returned for cells that don't match any glyph.
+ */
+#define UNRECOGNIZED_CELL (-1)
+
+/**
+ * Character that replaces unrecognized cells.
+ */
+#define UNRECOGNIZED_CHARACTER (L'?')
+
+/**
+ * Character that blank cells are read as.
+ */
+#define BLANK_CHARACTER (L' ')
+
+/**
+ * Terminates each line of text.
+ */
+#define LINE_BREAK (L"\r\n")
+#define LINE_BREAK_LENGTH (ARRAYSIZE(LINE_BREAK) - 1)
+
+
+/** Typedefs ************************************************************/
+
+/**
+ * Glyph signature table.
+ * Maps the scan lines of each distinct glyph to its code.
+ */
+typedef struct _VGATEXT_SIGNATURES
+{
+	// The font the glyphs are taken from.
+	CONST BYTE *	pnFont;
+	DWORD			nCharHeight;
+
+	// Open-addressed hash table, indexed by the FNV-1a hash
+	// of a glyph's scan lines. Each slot holds a glyph code plus 1,
+	// or SIGNATURE_SLOT_EMPTY.
+	WORD			anSlots[SIGNATURE_SLOTS];
+} VGATEXT_SIGNATURES, *PVGATEXT_SIGNATURES;
+typedef CONST VGATEXT_SIGNATURES *PCVGATEXT_SIGNATURES;
+
+/**
+ * Describes how text is laid out on a graphics mode screen.
+ */
+typedef struct _VGATEXT_GRID
+{
+	// The pixel value of the background.
+	BYTE	nBackground;
+
+	// The first scan line of the first row of text.
+	DWORD	nFirstScanLine;
+
+	// Dimensions of the grid, in characters.
+	DWORD	nColumns;
+	DWORD	nRows;
+} VGATEXT_GRID, *PVGATEXT_GRID;
+typedef CONST VGATEXT_GRID *PCVGATEXT_GRID;
+
+
+/** Globals *************************************************************/
+
+/**
+ * Maps code page 437, which is what the VGA's fonts are laid out in,
+ * to Unicode. The control characters map to the symbols the VGA
+ * displays in their place.
+ */
+STATIC CONST WCHAR g_awcCodePage437[VGA_FONT_GLYPHS] = {
+	0x0020, 0x263A, 0x263B, 0x2665, 0x2666, 0x2663, 0x2660, 0x2022,
+	0x25D8, 0x25CB, 0x25D9, 0x2642, 0x2640, 0x266A, 0x266B, 0x263C,
+	0x25BA, 0x25C4, 0x2195, 0x203C, 0x00B6, 0x00A7, 0x25AC, 0x21A8,
+	0x2191, 0x2193, 0x2192, 0x2190, 0x221F, 0x2194, 0x25B2, 0x25BC,
+	0x0020, 0x0021, 0x0022, 0x0023, 0x0024, 0x0025, 0x0026, 0x0027,
+	0x0028, 0x0029, 0x002A, 0x002B, 0x002C, 0x002D, 0x002E, 0x002F,
+	0x0030, 0x0031, 0x0032, 0x0033, 0x0034, 0x0035, 0x0036, 0x0037,
+	0x0038, 0x0039, 0x003A, 0x003B, 0x003C, 0x003D, 0x003E, 0x003F,
+	0x0040, 0x0041, 0x0042, 0x0043, 0x0044, 0x0045, 0x0046, 0x0047,
+	0x0048, 0x0049, 0x004A, 0x004B, 0x004C, 0x004D, 0x004E, 0x004F,
+	0x0050, 0x0051, 0x0052, 0x0053, 0x0054, 0x0055, 0x0056, 0x0057,
+	0x0058, 0x0059, 0x005A, 0x005B, 0x005C, 0x005D, 0x005E, 0x005F,
+	0x0060, 0x0061, 0x0062, 0x0063, 0x0064, 0x0065, 0x0066, 0x0067,
+	0x0068, 0x0069, 0x006A, 0x006B, 0x006C, 0x006D, 0x006E, 0x006F,
+	0x0070, 0x0071, 0x0072, 0x0073, 0x0074, 0x0075, 0x0076, 0x0077,
+	0x0078, 0x0079, 0x007A, 0x007B, 0x007C, 0x007D, 0x007E, 0x2302,
+	0x00C7, 0x00FC, 0x00E9, 0x00E2, 0x00E4, 0x00E0, 0x00E5, 0x00E7,
+	0x00EA, 0x00EB, 0x00E8, 0x00EF, 0x00EE, 0x00EC, 0x00C4, 0x00C5,
+	0x00C9, 0x00E6, 0x00C6, 0x00F4, 0x00F6, 0x00F2, 0x00FB, 0x00F9,
+	0x00FF, 0x00D6, 0x00DC, 0x00A2, 0x00A3, 0x00A5, 0x20A7, 0x0192,
+	0x00E1, 0x00ED, 0x00F3, 0x00FA, 0x00F1, 0x00D1, 0x00AA, 0x00BA,
+	0x00BF, 0x2310, 0x00AC, 0x00BD, 0x00BC, 0x00A1, 0x00AB, 0x00BB,
+	0x2591, 0x2592, 0x2593, 0x2502, 0x2524, 0x2561, 0x2562, 0x2556,
+	0x2555, 0x2563, 0x2551, 0x2557, 0x255D, 0x255C, 0x255B, 0x2510,
+	0x2514, 0x2534, 0x252C, 0x251C, 0x2500, 0x253C, 0x255E, 0x255F,
+	0x255A, 0x2554, 0x2569, 0x2566, 0x2560, 0x2550, 0x256C, 0x2567,
+	0x2568, 0x2564, 0x2565, 0x2559, 0x2558, 0x2552, 0x2553, 0x256B,
+	0x256A, 0x2518, 0x250C, 0x2588, 0x2584, 0x258C, 0x2590, 0x2580,
+	0x03B1, 0x00DF, 0x0393, 0x03C0, 0x03A3, 0x03C3, 0x00B5, 0x03C4,
+	0x03A6, 0x0398, 0x03A9, 0x03B4, 0x221E, 0x03C6, 0x03B5, 0x2229,
+	0x2261, 0x00B1, 0x2265, 0x2264, 0x2320, 0x2321, 0x00F7, 0x2248,
+	0x00B0, 0x2219, 0x00B7, 0x221A, 0x207F, 0x00B2, 0x25A0, 0x0020,
+};
+
+
+/** Functions ***********************************************************/
+
+/**
+ * Calculates the signature of a glyph's scan lines.
+ *
+ * @param[in]	pnScanLines		The scan lines.
+ * @param[in]	nCharHeight		Number of scan lines.
+ *
+ * @returns DWORD
+ */
+STATIC
+FORCEINLINE
+DWORD
+vgatext_Hash(
+	_In_reads_(nCharHeight)	CONST BYTE *	pnScanLines,
+	_In_					DWORD			nCharHeight
+)
+{
+	DWORD	nHash		= VGA_CAPTURE_CHECKSUM_BASIS;
+	DWORD	nScanLine	= 0;
+
+	for (nScanLine = 0; nScanLine < nCharHeight; ++nScanLine)
+	{
+		nHash = VGA_CAPTURE_CHECKSUM_STEP(nHash, pnScanLines[nScanLine]);
+	}
+
+	return nHash;
+}
+
+/**
+ * Builds the signature table of a font.
+ *
+ * @param[in]	pnFont			The font.
+ * @param[in]	nCharHeight		Number of scan lines in each glyph.
+ * @param[out]	ptSignatures	Will receive the signature table.
+ */
+STATIC
+VOID
+vgatext_BuildSignatures(
+	_In_reads_(VGA_FONT_GLYPHS * nCharHeight)	CONST BYTE *		pnFont,
+	_In_										DWORD				nCharHeight,
+	_Out_										PVGATEXT_SIGNATURES	ptSignatures
+)
+{
+	DWORD	nIndex	= 0;
+	DWORD	nCode	= 0;
+	DWORD	nSlot	= 0;
+	WORD	nEntry	= SIGNATURE_SLOT_EMPTY;
+
+	C_ASSERT(SIGNATURE_SLOTS >= 2 * VGA_FONT_GLYPHS);
+	C_ASSERT(0 == (SIGNATURE_SLOTS & (SIGNATURE_SLOTS - 1)));
+
+	ptSignatures->pnFont = pnFont;
+	ptSignatures->nCharHeight = nCharHeight;
+	ZeroMemory(ptSignatures->anSlots, sizeof(ptSignatures->anSlots));
+
+	// Fonts often draw several codes identically (0x00, 0x20 and 0xFF
+	// are usually all blank). Only the first of them gets a slot,
+	// so the printable ASCII characters go first.
+	for (nIndex = 0; nIndex < VGA_FONT_GLYPHS; ++nIndex)
+	{
+		nCode = (nIndex + ' ') % VGA_FONT_GLYPHS;
+
+		nSlot = vgatext_Hash(pnFont + (nCode * nCharHeight), nCharHeight);
+		for (;;)
+		{
+			nSlot &= SIGNATURE_SLOTS - 1;
+			nEntry = ptSignatures->anSlots[nSlot];
+			if (SIGNATURE_SLOT_EMPTY == nEntry)
+			{
+				ptSignatures->anSlots[nSlot] = (WORD)(nCode + 1);
+				break;
+			}
+			if (0 == memcmp(pnFont + ((nEntry - 1) * nCharHeight),
+							pnFont + (nCode * nCharHeight),
+							nCharHeight))
+			{
+				break;
+			}
+			++nSlot;
+		}
+	}
+}
+
+/**
+ * Looks up a glyph by its scan lines.
+ *
+ * @param[in]	ptSignatures	The signature table.
+ * @param[in]	pnScanLines		The glyph's scan lines.
+ *
+ * @returns INT The glyph's code, or UNRECOGNIZED_CELL.
+ */
+STATIC
+INT
+vgatext_FindGlyph(
+	_In_	PCVGATEXT_SIGNATURES	ptSignatures,
+	_In_	CONST BYTE *			pnScanLines
+)
+{
+	DWORD	nSlot	= 0;
+	WORD	nEntry	= SIGNATURE_SLOT_EMPTY;
+
+	nSlot = vgatext_Hash(pnScanLines, ptSignatures->nCharHeight);
+	for (;;)
+	{
+		nSlot &= SIGNATURE_SLOTS - 1;
+		nEntry = ptSignatures->anSlots[nSlot];
+		if (SIGNATURE_SLOT_EMPTY == nEntry)
+		{
+			return UNRECOGNIZED_CELL;
+		}
+		if (0 == memcmp(ptSignatures->pnFont + ((nEntry - 1) * ptSignatures->nCharHeight),
+						pnScanLines,
+						ptSignatures->nCharHeight))
+		{
+			return nEntry - 1;
+		}
+		++nSlot;
+	}
+}
+
+/**
+ * Retrieves the value of a single pixel of a graphics mode screen.
+ *
+ * @param[in]	ptCapture	The capture.
+ * @param[in]	nX			Column of the pixel.
+ * @param[in]	nY			Row of the pixel.
+ *
+ * @returns BYTE
+ */
+STATIC
+BYTE
+vgatext_GetPixel(
+	_In_	PCVGA_CAPTURE_VIEW	ptCapture,
+	_In_	DWORD				nX,
+	_In_	DWORD				nY
+)
+{
+	DWORD	nOffset	= (nY * ptCapture->cbStride) + (nX / PIXELS_IN_BYTE);
+	DWORD	nShift	= (PIXELS_IN_BYTE - 1) - (nX % PIXELS_IN_BYTE);
+	BYTE	nPixel	= 0;
+	DWORD	nPlane	= 0;
+
+	for (nPlane = 0; nPlane < VGA_PLANES; ++nPlane)
+	{
+		nPixel |= ((ptCapture->apnPlanes[nPlane][nOffset] >> nShift) & 1) << nPlane;
+	}
+
+	return nPixel;
+}
+
+/**
+ * Extracts the ink of a cell of a graphics mode screen,
+ * which is every pixel that differs from the background.
+ * Works on whole plane bytes, without decoding the pixels.
+ *
+ * @param[in]	ptCapture		The capture.
+ * @param[in]	nBackground		The pixel value of the background.
+ * @param[in]	nColumn			Column of the cell, in characters.
+ * @param[in]	nScanLine		First scan line of the cell.
+ * @param[in]	nCharHeight		Height of the cell, in scan lines.
+ * @param[out]	pnScanLines		Will receive the cell's ink,
+ *								one byte per scan line.
+ *
+ * @returns BOOL Whether the cell has any ink.
+ */
+STATIC
+FORCEINLINE
+BOOL
+vgatext_GetCellInk(
+	_In_						PCVGA_CAPTURE_VIEW	ptCapture,
+	_In_						BYTE				nBackground,
+	_In_						DWORD				nColumn,
+	_In_						DWORD				nScanLine,
+	_In_						DWORD				nCharHeight,
+	_Out_writes_(nCharHeight)	PBYTE				pnScanLines
+)
+{
+	BYTE	anBackgroundMasks[VGA_PLANES]	= { 0 };
+	DWORD	nPlane							= 0;
+	DWORD	nOffset							= 0;
+	DWORD	nCurrentLine					= 0;
+	BYTE	nInk							= 0;
+	BYTE	nAllInk							= 0;
+
+	for (nPlane = 0; nPlane < VGA_PLANES; ++nPlane)
+	{
+		anBackgroundMasks[nPlane] = (0 != (nBackground & (1 << nPlane))) ? MAXBYTE : 0;
+	}
+
+	nOffset = (nScanLine * ptCapture->cbStride) + nColumn;
+	for (nCurrentLine = 0; nCurrentLine < nCharHeight; ++nCurrentLine)
+	{
+		nInk = (ptCapture->apnPlanes[0][nOffset] ^ anBackgroundMasks[0]) |
+			   (ptCapture->apnPlanes[1][nOffset] ^ anBackgroundMasks[1]) |
+			   (ptCapture->apnPlanes[2][nOffset] ^ anBackgroundMasks[2]) |
+			   (ptCapture->apnPlanes[3][nOffset] ^ anBackgroundMasks[3]);
+		pnScanLines[nCurrentLine] = nInk;
+		nAllInk |= nInk;
+		nOffset += ptCapture->cbStride;
+	}
+
+	return 0 != nAllInk;
+}
+
+/**
+ * Recognizes a single cell of a graphics mode screen.
+ *
+ * @param[in]	ptCapture		The capture.
+ * @param[in]	ptSignatures	The signature table of the font.
+ * @param[in]	nBackground		The pixel value of the screen's background.
+ * @param[in]	nColumn			Column of the cell, in characters.
+ * @param[in]	nScanLine		First scan line of the cell.
+ *
+ * @returns INT The glyph's code, ' ' for blank cells,
+ *				or UNRECOGNIZED_CELL.
+ */
+STATIC
+INT
+vgatext_RecognizeCell(
+	_In_	PCVGA_CAPTURE_VIEW		ptCapture,
+	_In_	PCVGATEXT_SIGNATURES	ptSignatures,
+	_In_	BYTE					nBackground,
+	_In_	DWORD					nColumn,
+	_In_	DWORD					nScanLine
+)
+{
+	BYTE	anScanLines[VGA_FONT_GLYPH_MAX_HEIGHT]	= { 0 };
+	BYTE	nCellBackground							= 0;
+	INT		nCode									= UNRECOGNIZED_CELL;
+
+	if (!vgatext_GetCellInk(ptCapture,
+							nBackground,
+							nColumn,
+							nScanLine,
+							ptSignatures->nCharHeight,
+							anScanLines))
+	{
+		return ' ';
+	}
+
+	nCode = vgatext_FindGlyph(ptSignatures, anScanLines);
+	if (UNRECOGNIZED_CELL != nCode)
+	{
+		return nCode;
+	}
+
+	// Maybe the text has a background of its own.
+	// The top left pixel is background in almost every glyph.
+	nCellBackground = vgatext_GetPixel(ptCapture,
+									   nColumn * PIXELS_IN_BYTE,
+									   nScanLine);
+	if (nCellBackground == nBackground)
+	{
+		return UNRECOGNIZED_CELL;
+	}
+
+	if (!vgatext_GetCellInk(ptCapture,
+							nCellBackground,
+							nColumn,
+							nScanLine,
+							ptSignatures->nCharHeight,
+							anScanLines))
+	{
+		return ' ';
+	}
+
+	return vgatext_FindGlyph(ptSignatures, anScanLines);
+}
+
+/**
+ * Counts the non-blank cells of a row of text that match a glyph.
+ *
+ * @param[in]	ptCapture		The capture.
+ * @param[in]	ptSignatures	The signature table of the font.
+ * @param[in]	nBackground		The pixel value of the screen's background.
+ * @param[in]	nColumns		Number of cells in the row.
+ * @param[in]	nScanLine		First scan line of the row.
+ *
+ * @returns DWORD
+ */
+STATIC
+DWORD
+vgatext_CountRecognizedCells(
+	_In_	PCVGA_CAPTURE_VIEW		ptCapture,
+	_In_	PCVGATEXT_SIGNATURES	ptSignatures,
+	_In_	BYTE					nBackground,
+	_In_	DWORD					nColumns,
+	_In_	DWORD					nScanLine
+)
+{
+	DWORD	nColumn		= 0;
+	DWORD	nRecognized	= 0;
+	INT		nCode		= UNRECOGNIZED_CELL;
+
+	for (nColumn = 0; nColumn < nColumns; ++nColumn)
+	{
+		nCode = vgatext_RecognizeCell(ptCapture,
+									  ptSignatures,
+									  nBackground,
+									  nColumn,
+									  nScanLine);
+		if ((UNRECOGNIZED_CELL != nCode) && (' ' != nCode))
+		{
+			++nRecognized;
+		}
+	}
+
+	return nRecognized;
+}
+
+/**
+ * Determines how text is laid out on a graphics mode screen.
+ *
+ * Text is assumed to be aligned to bytes horizontally,
+ * but the rows may start at any scan line. The first scan line
+ * with ink belongs to the first row of text, so only the alignments
+ * that put it inside a cell need to be tried.
+ *
+ * @param[in]	ptCapture		The capture.
+ * @param[in]	ptSignatures	The signature table of the font.
+ * @param[out]	ptGrid			Will receive the layout.
+ */
+STATIC
+VOID
+vgatext_FindGrid(
+	_In_	PCVGA_CAPTURE_VIEW		ptCapture,
+	_In_	PCVGATEXT_SIGNATURES	ptSignatures,
+	_Out_	PVGATEXT_GRID			ptGrid
+)
+{
+	VGATEXT_GRID	tGrid			= { 0 };
+	DWORD			nCharHeight		= ptSignatures->nCharHeight;
+	BYTE			nScanLineInk	= 0;
+	DWORD			nInkLine		= 0;
+	DWORD			nColumn			= 0;
+	DWORD			nCandidate		= 0;
+	DWORD			nRecognized		= 0;
+	DWORD			nBestRecognized	= 0;
+
+	// The background fills the corners of the screen.
+	tGrid.nBackground = vgatext_GetPixel(ptCapture, 0, 0);
+	tGrid.nColumns = ptCapture->nWidth / PIXELS_IN_BYTE;
+
+	for (nInkLine = 0; nInkLine < ptCapture->nHeight; ++nInkLine)
+	{
+		for (nColumn = 0; nColumn < tGrid.nColumns; ++nColumn)
+		{
+			if (vgatext_GetCellInk(ptCapture,
+								   tGrid.nBackground,
+								   nColumn,
+								   nInkLine,
+								   1,
+								   &nScanLineInk))
+			{
+				break;
+			}
+		}
+		if (nColumn < tGrid.nColumns)
+		{
+			break;
+		}
+	}
+
+	if (nInkLine < ptCapture->nHeight)
+	{
+		nCandidate = (nInkLine >= nCharHeight - 1) ? (nInkLine - (nCharHeight - 1)) : 0;
+		for (; nCandidate <= nInkLine; ++nCandidate)
+		{
+			if (nCandidate + nCharHeight > ptCapture->nHeight)
+			{
+				break;
+			}
+
+			nRecognized = vgatext_CountRecognizedCells(ptCapture,
+													   ptSignatures,
+													   tGrid.nBackground,
+													   tGrid.nColumns,
+													   nCandidate);
+			if (nRecognized > nBestRecognized)
+			{
+				nBestRecognized = nRecognized;
+				tGrid.nFirstScanLine = nCandidate % nCharHeight;
+			}
+		}
+	}
+
+	tGrid.nRows = (ptCapture->nHeight - tGrid.nFirstScanLine) / nCharHeight;
+
+	*ptGrid = tGrid;
+}
+
+/**
+ * Recognizes a row of text on a graphics mode screen.
+ *
+ * @param[in]	ptCapture		The capture.
+ * @param[in]	ptSignatures	The signature table of the font.
+ * @param[in]	ptGrid			The layout of the text.
+ * @param[in]	nRow			The row to recognize.
+ * @param[out]	pwszLine		Will receive the row's characters.
+ */
+STATIC
+VOID
+vgatext_ReadGraphicsRow(
+	_In_							PCVGA_CAPTURE_VIEW		ptCapture,
+	_In_							PCVGATEXT_SIGNATURES	ptSignatures,
+	_In_							PCVGATEXT_GRID			ptGrid,
+	_In_							DWORD					nRow,
+	_Out_writes_(ptGrid->nColumns)	PWCHAR					pwszLine
+)
+{
+	DWORD	nScanLine	= ptGrid->nFirstScanLine + (nRow * ptSignatures->nCharHeight);
+	DWORD	nColumn		= 0;
+	INT		nCode		= UNRECOGNIZED_CELL;
+
+	for (nColumn = 0; nColumn < ptGrid->nColumns; ++nColumn)
+	{
+		nCode = vgatext_RecognizeCell(ptCapture,
+									  ptSignatures,
+									  ptGrid->nBackground,
+									  nColumn,
+									  nScanLine);
+		pwszLine[nColumn] =
+			(UNRECOGNIZED_CELL == nCode)
+			? (UNRECOGNIZED_CHARACTER)
+			: (g_awcCodePage437[nCode]);
+	}
+}
+
+/**
+ * Reads a row of text from a text mode screen.
+ *
+ * @param[in]	ptScreen	The screen.
+ * @param[in]	nRow		The row to read.
+ * @param[out]	pwszLine	Will receive the row's characters.
+ */
+STATIC
+VOID
+vgatext_ReadTextRow(
+	_In_								PCVGA_TEXT_SCREEN	ptScreen,
+	_In_								DWORD				nRow,
+	_Out_writes_(ptScreen->nColumns)	PWCHAR				pwszLine
+)
+{
+	CONST BYTE *	pnCell	= ptScreen->pnText + (nRow * ptScreen->nColumns * VGA_TEXT_CELL_BYTES);
+	DWORD			nColumn	= 0;
+
+	for (nColumn = 0; nColumn < ptScreen->nColumns; ++nColumn)
+	{
+		pwszLine[nColumn] = g_awcCodePage437[*pnCell];
+		pnCell += VGA_TEXT_CELL_BYTES;
+	}
+}
+
+HRESULT
+VGATEXT_ReadScreen(
+	_In_										PCVGA_CAPTURE_VIEW	ptCapture,
+	_In_reads_bytes_opt_(cbFont)				LPCVOID				pvFont,
+	_In_										DWORD				cbFont,
+	_Outptr_result_bytebuffer_(*pcbText + 1)	PSTR *				ppszText,
+	_Out_										PDWORD				pcbText
+)
+{
+	HRESULT				hrResult		= E_FAIL;
+	VGATEXT_SIGNATURES	tSignatures		= { 0 };
+	VGATEXT_GRID		tGrid			= { 0 };
+	DWORD				nCharHeight		= 0;
+	DWORD				cchLines		= 0;
+	PWSTR				pwszLines		= NULL;
+	DWORD				cchWritten		= 0;
+	DWORD				cchText			= 0;
+	DWORD				nRow			= 0;
+	PWCHAR				pwszLine		= NULL;
+	DWORD				cchLine			= 0;
+	INT					cbReturned		= 0;
+	DWORD				cbText			= 0;
+	PSTR				pszText			= NULL;
+	DWORD64				nStartTime		= 0;
+	DWORD64				nCycles			= 0;
+
+	if ((NULL == ptCapture) ||
+		((NULL == pvFont) && (0 != cbFont)) ||
+		(NULL == ppszText) ||
+		(NULL == pcbText))
+	{
+		PROGRESS("Invalid arguments specified.");
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+
+	nStartTime = __rdtsc();
+
+	if (VGA_CAPTURE_MODE_TEXT == ptCapture->eMode)
+	{
+		PROGRESS("Reading the text straight from the capture.");
+		tGrid.nColumns = ptCapture->tText.nColumns;
+		tGrid.nRows = ptCapture->tText.nRows;
+	}
+	else
+	{
+		if (NULL == pvFont)
+		{
+			PROGRESS("A font is needed to read text off a graphics mode screen.");
+			hrResult = E_INVALIDARG;
+			goto lblCleanup;
+		}
+
+		nCharHeight = cbFont / VGA_FONT_GLYPHS;
+		if ((0 != (cbFont % VGA_FONT_GLYPHS)) ||
+			(0 == nCharHeight) ||
+			(VGA_FONT_GLYPH_MAX_HEIGHT < nCharHeight) ||
+			(ptCapture->nHeight < nCharHeight))
+		{
+			PROGRESS("Unsupported font size (%lu bytes).", cbFont);
+			hrResult = HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+			goto lblCleanup;
+		}
+
+		vgatext_BuildSignatures((CONST BYTE *)pvFont, nCharHeight, &tSignatures);
+		vgatext_FindGrid(ptCapture, &tSignatures, &tGrid);
+		PROGRESS("Reading %lux%lu characters starting at scan line %lu.",
+				 tGrid.nColumns,
+				 tGrid.nRows,
+				 tGrid.nFirstScanLine);
+	}
+
+	// The capture's validation bounds the grid by the size of a plane,
+	// so this can't overflow.
+	cchLines = tGrid.nRows * (tGrid.nColumns + LINE_BREAK_LENGTH);
+	pwszLines = HEAPALLOC(max(cchLines, 1) * sizeof(pwszLines[0]));
+	if (NULL == pwszLines)
+	{
+		PROGRESS("Oops. Ran out of memory.");
+		hrResult = E_OUTOFMEMORY;
+		goto lblCleanup;
+	}
+
+	// Blank lines before and after the text are dropped,
+	// as are spaces at the end of each line.
+	for (nRow = 0; nRow < tGrid.nRows; ++nRow)
+	{
+		pwszLine = pwszLines + cchWritten;
+		if (VGA_CAPTURE_MODE_TEXT == ptCapture->eMode)
+		{
+			vgatext_ReadTextRow(&ptCapture->tText, nRow, pwszLine);
+		}
+		else
+		{
+			vgatext_ReadGraphicsRow(ptCapture, &tSignatures, &tGrid, nRow, pwszLine);
+		}
+
+		cchLine = tGrid.nColumns;
+		while ((0 < cchLine) && (BLANK_CHARACTER == pwszLine[cchLine - 1]))
+		{
+			--cchLine;
+		}
+
+		if ((0 == cchLine) && (0 == cchWritten))
+		{
+			continue;
+		}
+
+		CopyMemory(pwszLine + cchLine, LINE_BREAK, LINE_BREAK_LENGTH * sizeof(pwszLine[0]));
+		cchWritten += cchLine + LINE_BREAK_LENGTH;
+		if (0 != cchLine)
+		{
+			cchText = cchWritten;
+		}
+	}
+
+	if (0 != cchText)
+	{
+		// Determine the amount of memory required for the converted text.
+		cbReturned = WideCharToMultiByte(CP_UTF8,
+										 0,
+										 pwszLines, (INT)cchText,
+										 NULL, 0,
+										 NULL,
+										 NULL);
+		if (0 == cbReturned)
+		{
+			hrResult = HRESULT_FROM_WIN32(GetLastError());
+			goto lblCleanup;
+		}
+
+		// Safely cast to DWORD.
+		hrResult = IntToDWord(cbReturned, &cbText);
+		if (FAILED(hrResult))
+		{
+			goto lblCleanup;
+		}
+	}
+
+	pszText = HEAPALLOC(cbText + 1);
+	if (NULL == pszText)
+	{
+		PROGRESS("Oops. Ran out of memory.");
+		hrResult = E_OUTOFMEMORY;
+		goto lblCleanup;
+	}
+
+	if (0 != cchText)
+	{
+		cbReturned = WideCharToMultiByte(CP_UTF8,
+										 0,
+										 pwszLines, (INT)cchText,
+										 pszText, (INT)cbText,
+										 NULL,
+										 NULL);
+		if (0 == cbReturned)
+		{
+			hrResult = HRESULT_FROM_WIN32(GetLastError());
+			goto lblCleanup;
+		}
+	}
+
+	nCycles = __rdtsc() - nStartTime;
+	PROGRESS("Read the screen in %I64u cycles.", nCycles);
+
+	// Transfer ownership:
+	*ppszText = pszText;
+	pszText = NULL;
+	*pcbText = cbText;
+
+	hrResult = S_OK;
+
+lblCleanup:
+	HEAPFREE(pszText);
+	HEAPFREE(pwszLines);
+
+	return hrResult;
+}
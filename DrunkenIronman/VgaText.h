@@ -0,0 +1,49 @@
+/**
+ * @file VgaText.h
+ * @author biko
+ * @date 2026-10-17
+ *
+ * VgaText module public header.
+ * Contains routines for reading the text off a captured screen.
+ */
+#pragma once
+
+/** Headers *************************************************************/
+#include <Windows.h>
+
+#include "VgaCapture.h"
+
+
+/** Functions ***********************************************************/
+
+/**
+ * Reads the text displayed on a captured screen.
+ *
+ * Text mode screens are read straight from the capture.
+ * On graphics mode screens, each 8-pixel wide cell is matched
+ * against the glyphs of the font the text was drawn with,
+ * directly on the planes.
+ *
+ * @param[in]	ptCapture	The capture.
+ * @param[in]	pvFont		Optional font for graphics mode screens:
+ *							VGA_FONT_GLYPHS glyphs, one byte per scan line,
+ *							with the leftmost pixel in the MSB.
+ * @param[in]	cbFont		Size of the font, in bytes.
+ * @param[out]	ppszText	Will receive the text, one line per text row,
+ *							as a terminated UTF-8 string.
+ * @param[out]	pcbText		Will receive the length of the text,
+ *							in bytes, excluding the terminator.
+ *
+ * @returns HRESULT
+ *
+ * @remark	Characters that can't be recognized are replaced with '?'.
+ * @remark	Free the returned text to the process heap.
+ */
+HRESULT
+VGATEXT_ReadScreen(
+	_In_										PCVGA_CAPTURE_VIEW	ptCapture,
+	_In_reads_bytes_opt_(cbFont)				LPCVOID				pvFont,
+	_In_										DWORD				cbFont,
+	_Outptr_result_bytebuffer_(*pcbText + 1)	PSTR *				ppszText,
+	_Out_										PDWORD				pcbText
+);
@@ -0,0 +1,672 @@
+/**
+ * @file VgaThumbnail.c
+ * @author biko
+ * @date 2026-10-17
+ *
+ * VgaThumbnail module implementation.
+ */
+
+/** Headers *************************************************************/
+#include <Windows.h>
+#include <intsafe.h>
+
+#include <assert.h>
+
+#include <Drink.h>
+
+#include "Util.h"
+#include "Debug.h"
+
+#include "VgaDecode.h"
+#include "VgaThumbnail.h"
+
+
+/** Constants ***********************************************************/
+
+/**
+ * Each block's color counts are kept in 16-bit lanes,
+ * 4 colors to a quadword. VGA_THUMBNAIL_MAX_SCALE keeps
+ * the counts from overflowing.
+ */
+#define LANES_PER_BLOCK (VGA_COLORS / 4)
+
+/**
+ * Selects the even bytes of a quadword.
+ */
+#define EVEN_BYTES (0x00FF00FF00FF00FFULL)
+
+/**
+ * Averages are divided by multiplying by a reciprocal
+ * scaled by 2^RECIPROCAL_SHIFT. Exact for sums below
+ * 2^(RECIPROCAL_SHIFT - 16) of blocks of up to 2^16 pixels.
+ */
+#define RECIPROCAL_SHIFT (40)
+
+
+/** Macros **************************************************************/
+
+/**
+ * Repeats a byte in all 8 bytes of a quadword.
+ */
+#define BROADCAST_BYTE(nByte) (((ULONGLONG)(nByte)) * 0x0101010101010101ULL)
+
+
+/** Typedefs ************************************************************/
+
+/**
+ * Accumulates the colors of a band of nScale rows,
+ * which make up a single row of the thumbnail.
+ */
+typedef struct _VGATHUMBNAIL_BAND
+{
+	// The downscaling factor.
+	DWORD		nScale;
+
+	// Width of the thumbnail, in blocks.
+	DWORD		nWidth;
+
+	// How many pixels of each color each block has,
+	// LANES_PER_BLOCK quadwords per block. Quadword N has
+	// the counts of colors 8 * (N / 2) + (N % 2) + 2 * M in lane M.
+	PULONGLONG	pnCounts;
+
+	// The block the row currently being added is in,
+	// and the pixel it ends at.
+	DWORD		nBlock;
+	DWORD		nBlockEnd;
+
+	// The colors of the pixel values, in 32-bit fields:
+	// red and green in the first quadword, blue and reserved
+	// in the second. Lets a block's sums be taken 2 channels at a time.
+	ULONGLONG	aanColors[VGA_COLORS][2];
+
+	// Divides by the number of pixels in a block.
+	// @see RECIPROCAL_SHIFT
+	ULONGLONG	nReciprocal;
+} VGATHUMBNAIL_BAND, *PVGATHUMBNAIL_BAND;
+typedef CONST VGATHUMBNAIL_BAND *PCVGATHUMBNAIL_BAND;
+
+
+/** Functions ***********************************************************/
+
+/**
+ * Counts the set bits in each byte of a quadword.
+ *
+ * @param[in]	nValue	The quadword.
+ *
+ * @returns ULONGLONG, with the count of each byte in its place.
+ */
+STATIC
+FORCEINLINE
+ULONGLONG
+vgathumbnail_CountByteBits(
+	_In_	ULONGLONG	nValue
+)
+{
+	nValue = nValue - ((nValue >> 1) & 0x5555555555555555ULL);
+	nValue = (nValue & 0x3333333333333333ULL) + ((nValue >> 2) & 0x3333333333333333ULL);
+
+	return (nValue + (nValue >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+}
+
+/**
+ * Starts adding a row to the band.
+ *
+ * @param[in,out]	ptBand	The band.
+ */
+STATIC
+FORCEINLINE
+VOID
+vgathumbnail_StartRow(
+	_Inout_	PVGATHUMBNAIL_BAND	ptBand
+)
+{
+	ptBand->nBlock = 0;
+	ptBand->nBlockEnd = ptBand->nScale;
+}
+
+/**
+ * Adds the 8 pixels of the row's next byte position
+ * to the blocks they fall in.
+ *
+ * @param[in,out]	ptBand	The band to update.
+ * @param[in]		nByte	Position of the byte in the row.
+ * @param[in]		pnMasks	For each pixel value, the mask of the pixels
+ *							that have it, as the bytes of 2 quadwords.
+ */
+STATIC
+FORCEINLINE
+VOID
+vgathumbnail_AddByte(
+	_Inout_										PVGATHUMBNAIL_BAND	ptBand,
+	_In_										DWORD				nByte,
+	_In_reads_(VGA_COLORS / sizeof(ULONGLONG))	CONST ULONGLONG *	pnMasks
+)
+{
+	DWORD		nFirstPixel	= nByte * PIXELS_IN_BYTE;
+	DWORD		nPixel		= 0;
+	DWORD		nEnd		= 0;
+	ULONGLONG	nSegment	= 0;
+	ULONGLONG	nLowCounts	= 0;
+	ULONGLONG	nHighCounts	= 0;
+	PULONGLONG	pnLanes		= NULL;
+
+	// A byte may span several blocks when the scale is small.
+	while ((nPixel < PIXELS_IN_BYTE) &&
+		   (ptBand->nBlock < ptBand->nWidth))
+	{
+		nEnd = min(ptBand->nBlockEnd - nFirstPixel, PIXELS_IN_BYTE);
+
+		// The leftmost pixel is in the MSB.
+		nSegment = BROADCAST_BYTE((0xFF >> nPixel) & ~(0xFF >> nEnd) & 0xFF);
+
+		// Count all the colors at once, and spread the counts
+		// into 16-bit lanes so they don't overflow.
+		nLowCounts = vgathumbnail_CountByteBits(pnMasks[0] & nSegment);
+		nHighCounts = vgathumbnail_CountByteBits(pnMasks[1] & nSegment);
+		pnLanes = ptBand->pnCounts + (ptBand->nBlock * LANES_PER_BLOCK);
+		pnLanes[0] += nLowCounts & EVEN_BYTES;
+		pnLanes[1] += (nLowCounts >> 8) & EVEN_BYTES;
+		pnLanes[2] += nHighCounts & EVEN_BYTES;
+		pnLanes[3] += (nHighCounts >> 8) & EVEN_BYTES;
+
+		nPixel = nEnd;
+		if (nFirstPixel + nPixel == ptBand->nBlockEnd)
+		{
+			++(ptBand->nBlock);
+			ptBand->nBlockEnd += ptBand->nScale;
+		}
+	}
+}
+
+/**
+ * Adds a row of a graphics mode screen to the band.
+ *
+ * @param[in,out]	ptBand		The band to update.
+ * @param[in]		ptCapture	The capture.
+ * @param[in]		nY			The row.
+ */
+STATIC
+VOID
+vgathumbnail_AddGraphicsRow(
+	_Inout_	PVGATHUMBNAIL_BAND	ptBand,
+	_In_	PCVGA_CAPTURE_VIEW	ptCapture,
+	_In_	DWORD				nY
+)
+{
+	DWORD			cbRow				= ((ptBand->nWidth * ptBand->nScale) + PIXELS_IN_BYTE - 1) / PIXELS_IN_BYTE;
+	CONST BYTE *	apnRow[VGA_PLANES]	= { NULL };
+	ULONGLONG		anMasks[2]			= { 0 };
+	ULONGLONG		nLowPlanes			= 0;
+	ULONGLONG		nPlane3				= 0;
+	DWORD			nPlane				= 0;
+	DWORD			nByte				= 0;
+
+	for (nPlane = 0; nPlane < VGA_PLANES; ++nPlane)
+	{
+		apnRow[nPlane] = ptCapture->apnPlanes[nPlane] + (nY * ptCapture->cbStride);
+	}
+
+	vgathumbnail_StartRow(ptBand);
+	for (nByte = 0; nByte < cbRow; ++nByte)
+	{
+		// Byte V of nLowPlanes gets the pixels whose low 3 bits equal V:
+		// each plane is taken as-is where V has its bit set,
+		// and inverted elsewhere. Plane 3 then splits them in two.
+		nLowPlanes = ~(BROADCAST_BYTE(apnRow[0][nByte]) ^ 0xFF00FF00FF00FF00ULL) &
+					 ~(BROADCAST_BYTE(apnRow[1][nByte]) ^ 0xFFFF0000FFFF0000ULL) &
+					 ~(BROADCAST_BYTE(apnRow[2][nByte]) ^ 0xFFFFFFFF00000000ULL);
+		nPlane3 = BROADCAST_BYTE(apnRow[3][nByte]);
+		anMasks[0] = nLowPlanes & ~nPlane3;
+		anMasks[1] = nLowPlanes & nPlane3;
+
+		vgathumbnail_AddByte(ptBand, nByte, anMasks);
+	}
+}
+
+/**
+ * Adds a row of a text mode screen to the band.
+ * Each character is a byte position, with only
+ * its foreground and background colors present.
+ *
+ * @param[in,out]	ptBand		The band to update.
+ * @param[in]		ptScreen	The screen.
+ * @param[in]		nY			The row, in pixels.
+ */
+STATIC
+VOID
+vgathumbnail_AddTextRow(
+	_Inout_	PVGATHUMBNAIL_BAND	ptBand,
+	_In_	PCVGA_TEXT_SCREEN	ptScreen,
+	_In_	DWORD				nY
+)
+{
+	DWORD			nColumns		= ((ptBand->nWidth * ptBand->nScale) + PIXELS_IN_BYTE - 1) / PIXELS_IN_BYTE;
+	DWORD			nLine			= nY % ptScreen->nCharHeight;
+	CONST BYTE *	pnCell			= ptScreen->pnText + ((nY / ptScreen->nCharHeight) * ptScreen->nColumns * VGA_TEXT_CELL_BYTES);
+	ULONGLONG		anMasks[2]		= { 0 };
+	PBYTE			pnMasks			= (PBYTE)anMasks;
+	DWORD			nColumn			= 0;
+	BYTE			nGlyphLine		= 0;
+	BYTE			nForeground		= 0;
+	BYTE			nBackground		= 0;
+
+	vgathumbnail_StartRow(ptBand);
+	for (nColumn = 0; nColumn < nColumns; ++nColumn)
+	{
+		// Same colors as VGADECODE_RenderText.
+		nGlyphLine = ptScreen->pnFont[(pnCell[0] * ptScreen->nCharHeight) + nLine];
+		nForeground = pnCell[1] & 0x0F;
+		nBackground = (pnCell[1] >> 4) & (ptScreen->bBlinkEnabled ? 0x07 : 0x0F);
+
+		pnMasks[nBackground] = (BYTE)~nGlyphLine;
+		pnMasks[nForeground] |= nGlyphLine;
+		vgathumbnail_AddByte(ptBand, nColumn, anMasks);
+		pnMasks[nBackground] = 0;
+		pnMasks[nForeground] = 0;
+
+		pnCell += VGA_TEXT_CELL_BYTES;
+	}
+}
+
+/**
+ * Prepares a band for averaging blocks.
+ *
+ * @param[out]	ptBand		The band.
+ * @param[in]	ptPalette	The colors of the VGA_COLORS pixel values.
+ * @param[in]	nScale		The downscaling factor.
+ * @param[in]	nWidth		Width of the thumbnail, in blocks.
+ */
+STATIC
+VOID
+vgathumbnail_InitializeBand(
+	_Out_					PVGATHUMBNAIL_BAND	ptBand,
+	_In_reads_(VGA_COLORS)	CONST RGBQUAD *		ptPalette,
+	_In_					DWORD				nScale,
+	_In_					DWORD				nWidth
+)
+{
+	ULONGLONG	nArea	= (ULONGLONG)nScale * nScale;
+	DWORD		nColor	= 0;
+
+	ptBand->nScale = nScale;
+	ptBand->nWidth = nWidth;
+	ptBand->pnCounts = NULL;
+	ptBand->nReciprocal = ((1ULL << RECIPROCAL_SHIFT) + nArea - 1) / nArea;
+
+	for (nColor = 0; nColor < VGA_COLORS; ++nColor)
+	{
+		ptBand->aanColors[nColor][0] = ptPalette[nColor].rgbRed |
+									   ((ULONGLONG)ptPalette[nColor].rgbGreen << 32);
+		ptBand->aanColors[nColor][1] = ptPalette[nColor].rgbBlue |
+									   ((ULONGLONG)ptPalette[nColor].rgbReserved << 32);
+	}
+}
+
+/**
+ * Divides a channel's sum by the number of pixels in a block,
+ * rounding to the nearest value.
+ *
+ * @param[in]	ptBand	The band.
+ * @param[in]	nSum	The channel's sum.
+ *
+ * @returns BYTE
+ */
+STATIC
+FORCEINLINE
+BYTE
+vgathumbnail_Average(
+	_In_	PCVGATHUMBNAIL_BAND	ptBand,
+	_In_	DWORD				nSum
+)
+{
+	nSum += (ptBand->nScale * ptBand->nScale) / 2;
+
+	return (BYTE)((nSum * ptBand->nReciprocal) >> RECIPROCAL_SHIFT);
+}
+
+/**
+ * Averages the colors of each block in the band
+ * into a row of the thumbnail, and empties the band.
+ *
+ * @param[in,out]	ptBand	The band.
+ * @param[out]		ptRow	Will receive the thumbnail row.
+ */
+STATIC
+VOID
+vgathumbnail_FinishBand(
+	_Inout_							PVGATHUMBNAIL_BAND	ptBand,
+	_Out_writes_(ptBand->nWidth)	RGBQUAD *			ptRow
+)
+{
+	DWORD				nBlock			= 0;
+	DWORD				nLane			= 0;
+	DWORD				nColor			= 0;
+	CONST ULONGLONG *	pnLanes			= NULL;
+	ULONGLONG			nCounts			= 0;
+	ULONGLONG			nCount			= 0;
+	ULONGLONG			nRedGreen		= 0;
+	ULONGLONG			nBlueReserved	= 0;
+
+	for (nBlock = 0; nBlock < ptBand->nWidth; ++nBlock)
+	{
+		pnLanes = ptBand->pnCounts + (nBlock * LANES_PER_BLOCK);
+
+		// The sums fit in 32 bits, since VGA_THUMBNAIL_MAX_SCALE
+		// keeps the counts in 16 bits.
+		nRedGreen = 0;
+		nBlueReserved = 0;
+		for (nLane = 0; nLane < LANES_PER_BLOCK; ++nLane)
+		{
+			// Most blocks only have a color or two.
+			for (nCounts = pnLanes[nLane], nColor = ((nLane / 2) * 8) + (nLane % 2);
+				 0 != nCounts;
+				 nCounts >>= 16, nColor += 2)
+			{
+				nCount = nCounts & MAXWORD;
+				nRedGreen += nCount * ptBand->aanColors[nColor][0];
+				nBlueReserved += nCount * ptBand->aanColors[nColor][1];
+			}
+		}
+
+		ptRow[nBlock].rgbRed = vgathumbnail_Average(ptBand, (DWORD)nRedGreen);
+		ptRow[nBlock].rgbGreen = vgathumbnail_Average(ptBand, (DWORD)(nRedGreen >> 32));
+		ptRow[nBlock].rgbBlue = vgathumbnail_Average(ptBand, (DWORD)nBlueReserved);
+		ptRow[nBlock].rgbReserved = vgathumbnail_Average(ptBand, (DWORD)(nBlueReserved >> 32));
+	}
+
+	ZeroMemory(ptBand->pnCounts, ptBand->nWidth * LANES_PER_BLOCK * sizeof(ptBand->pnCounts[0]));
+}
+
+/**
+ * Decodes a band of rows of a graphics mode screen
+ * into the full-size image.
+ *
+ * @param[in]	ptCapture		The capture.
+ * @param[in]	ptPalette		The colors of the VGA_COLORS pixel values.
+ * @param[in]	nFirstRow		The first row of the band.
+ * @param[in]	nRows			Number of rows in the band.
+ * @param[out]	pnPixels		Optional indexed image.
+ * @param[in]	cbPixelStride	Distance between rows in pnPixels, in bytes.
+ * @param[out]	ptPixels		Optional colored image.
+ */
+STATIC
+VOID
+vgathumbnail_DecodeBand(
+	_In_					PCVGA_CAPTURE_VIEW	ptCapture,
+	_In_reads_(VGA_COLORS)	CONST RGBQUAD *		ptPalette,
+	_In_					DWORD				nFirstRow,
+	_In_					DWORD				nRows,
+	_Out_opt_				PBYTE				pnPixels,
+	_In_					DWORD				cbPixelStride,
+	_Out_opt_				RGBQUAD *			ptPixels
+)
+{
+	CONST BYTE *	apnBand[VGA_PLANES]	= { NULL };
+	DWORD			nPlane				= 0;
+
+	for (nPlane = 0; nPlane < VGA_PLANES; ++nPlane)
+	{
+		apnBand[nPlane] = ptCapture->apnPlanes[nPlane] + (nFirstRow * ptCapture->cbStride);
+	}
+
+	if (NULL != pnPixels)
+	{
+		VGADECODE_DecodeImage(apnBand,
+							  ptCapture->cbStride,
+							  ptCapture->nWidth,
+							  nRows,
+							  pnPixels + (nFirstRow * cbPixelStride),
+							  cbPixelStride,
+							  NULL);
+	}
+	else if (NULL != ptPixels)
+	{
+		VGADECODE_DecodeImageToColor(apnBand,
+									 ptCapture->cbStride,
+									 ptCapture->nWidth,
+									 nRows,
+									 ptPalette,
+									 ptPixels + (nFirstRow * ptCapture->nWidth),
+									 NULL);
+	}
+}
+
+HRESULT
+VGATHUMBNAIL_GetSize(
+	_In_	PCVGA_CAPTURE_VIEW	ptCapture,
+	_In_	DWORD				nScale,
+	_Out_	PDWORD				pnWidth,
+	_Out_	PDWORD				pnHeight
+)
+{
+	HRESULT	hrResult	= E_FAIL;
+
+	if ((NULL == ptCapture) ||
+		(NULL == pnWidth) ||
+		(NULL == pnHeight))
+	{
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+
+	if ((0 == nScale) ||
+		(VGA_THUMBNAIL_MAX_SCALE < nScale) ||
+		(ptCapture->nWidth < nScale) ||
+		(ptCapture->nHeight < nScale))
+	{
+		PROGRESS("Can't scale a %lux%lu screen down by %lu.",
+				 ptCapture->nWidth,
+				 ptCapture->nHeight,
+				 nScale);
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+
+	*pnWidth = ptCapture->nWidth / nScale;
+	*pnHeight = ptCapture->nHeight / nScale;
+
+	hrResult = S_OK;
+
+lblCleanup:
+	return hrResult;
+}
+
+/**
+ * Renders a thumbnail, once its size is known.
+ *
+ * @param[in]	ptCapture			The capture.
+ * @param[in]	ptPalette			The colors of the VGA_COLORS pixel values.
+ * @param[in]	nScale				The downscaling factor.
+ * @param[in]	nWidth				Width of the thumbnail, in pixels.
+ * @param[out]	ptThumbnail			Will receive the thumbnail, top row first.
+ * @param[in]	nThumbnailStride	Distance between rows in ptThumbnail, in pixels.
+ * @param[out]	pnPixels			Optional indexed full-size image.
+ * @param[in]	cbPixelStride		Distance between rows in pnPixels, in bytes.
+ * @param[out]	ptPixels			Optional colored full-size image.
+ *
+ * @returns HRESULT
+ *
+ * @see VGATHUMBNAIL_Render
+ */
+STATIC
+HRESULT
+vgathumbnail_Render(
+	_In_					PCVGA_CAPTURE_VIEW	ptCapture,
+	_In_reads_(VGA_COLORS)	CONST RGBQUAD *		ptPalette,
+	_In_					DWORD				nScale,
+	_In_					DWORD				nWidth,
+	_Out_					RGBQUAD *			ptThumbnail,
+	_In_					DWORD				nThumbnailStride,
+	_Out_opt_				PBYTE				pnPixels,
+	_In_					DWORD				cbPixelStride,
+	_Out_opt_				RGBQUAD *			ptPixels
+)
+{
+	HRESULT				hrResult	= E_FAIL;
+	VGATHUMBNAIL_BAND	tBand		= { 0 };
+	DWORD				nLanes		= 0;
+	DWORD				nY			= 0;
+	DWORD				nBandRows	= 0;
+	DWORD				nRow		= 0;
+
+	assert(NULL != ptCapture);
+	assert(NULL != ptPalette);
+	assert(NULL != ptThumbnail);
+	assert(nWidth <= nThumbnailStride);
+
+	vgathumbnail_InitializeBand(&tBand, ptPalette, nScale, nWidth);
+
+	hrResult = DWordMult(tBand.nWidth, LANES_PER_BLOCK, &nLanes);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+	tBand.pnCounts = HEAPALLOC(nLanes * sizeof(tBand.pnCounts[0]));
+	if (NULL == tBand.pnCounts)
+	{
+		PROGRESS("Oops. Ran out of memory.");
+		hrResult = E_OUTOFMEMORY;
+		goto lblCleanup;
+	}
+
+	// Text mode screens are tiny, so they're just drawn in one go.
+	if (VGA_CAPTURE_MODE_TEXT == ptCapture->eMode)
+	{
+		if (NULL != pnPixels)
+		{
+			VGADECODE_RenderText(&ptCapture->tText, pnPixels, cbPixelStride);
+		}
+		else if (NULL != ptPixels)
+		{
+			VGADECODE_RenderTextToColor(&ptCapture->tText, ptPalette, ptPixels);
+		}
+	}
+
+	for (nY = 0; nY < ptCapture->nHeight; nY += nBandRows)
+	{
+		nBandRows = min(nScale, ptCapture->nHeight - nY);
+
+		if (VGA_CAPTURE_MODE_TEXT != ptCapture->eMode)
+		{
+			vgathumbnail_DecodeBand(ptCapture, ptPalette, nY, nBandRows, pnPixels, cbPixelStride, ptPixels);
+		}
+
+		// Rows past the last whole band are only decoded.
+		if (nBandRows < nScale)
+		{
+			continue;
+		}
+
+		for (nRow = nY; nRow < nY + nBandRows; ++nRow)
+		{
+			if (VGA_CAPTURE_MODE_TEXT == ptCapture->eMode)
+			{
+				vgathumbnail_AddTextRow(&tBand, &ptCapture->tText, nRow);
+			}
+			else
+			{
+				vgathumbnail_AddGraphicsRow(&tBand, ptCapture, nRow);
+			}
+		}
+
+		vgathumbnail_FinishBand(&tBand, ptThumbnail + ((nY / nScale) * nThumbnailStride));
+	}
+
+	hrResult = S_OK;
+
+lblCleanup:
+	HEAPFREE(tBand.pnCounts);
+
+	return hrResult;
+}
+
+HRESULT
+VGATHUMBNAIL_Render(
+	_In_					PCVGA_CAPTURE_VIEW	ptCapture,
+	_In_reads_(VGA_COLORS)	CONST RGBQUAD *		ptPalette,
+	_In_					DWORD				nScale,
+	_Out_					RGBQUAD *			ptThumbnail,
+	_Out_opt_				PBYTE				pnPixels,
+	_In_					DWORD				cbPixelStride,
+	_Out_opt_				RGBQUAD *			ptPixels
+)
+{
+	HRESULT	hrResult	= E_FAIL;
+	DWORD	nWidth		= 0;
+	DWORD	nHeight		= 0;
+
+	if ((NULL == ptCapture) ||
+		(NULL == ptPalette) ||
+		(NULL == ptThumbnail) ||
+		((NULL != pnPixels) && (NULL != ptPixels)))
+	{
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+
+	hrResult = VGATHUMBNAIL_GetSize(ptCapture, nScale, &nWidth, &nHeight);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	hrResult = vgathumbnail_Render(ptCapture,
+								   ptPalette,
+								   nScale,
+								   nWidth,
+								   ptThumbnail,
+								   nWidth,
+								   pnPixels,
+								   cbPixelStride,
+								   ptPixels);
+
+lblCleanup:
+	return hrResult;
+}
+
+HRESULT
+VGATHUMBNAIL_RenderTile(
+	_In_					PCVGA_CAPTURE_VIEW	ptCapture,
+	_In_reads_(VGA_COLORS)	CONST RGBQUAD *		ptPalette,
+	_In_					DWORD				nScale,
+	_Out_					RGBQUAD *			ptTile,
+	_In_					DWORD				nTileStride
+)
+{
+	HRESULT	hrResult	= E_FAIL;
+	DWORD	nWidth		= 0;
+	DWORD	nHeight		= 0;
+
+	if ((NULL == ptCapture) ||
+		(NULL == ptPalette) ||
+		(NULL == ptTile))
+	{
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+
+	hrResult = VGATHUMBNAIL_GetSize(ptCapture, nScale, &nWidth, &nHeight);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+	if (nTileStride < nWidth)
+	{
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+
+	hrResult = vgathumbnail_Render(ptCapture,
+								   ptPalette,
+								   nScale,
+								   nWidth,
+								   ptTile,
+								   nTileStride,
+								   NULL,
+								   0,
+								   NULL);
+
+lblCleanup:
+	return hrResult;
+}
@@ -0,0 +1,109 @@
+/**
+ * @file VgaThumbnail.h
+ * @author biko
+ * @date 2026-10-17
+ *
+ * VgaThumbnail module public header.
+ * Contains routines for rendering downscaled thumbnails
+ * of captured screens.
+ */
+#pragma once
+
+/** Headers *************************************************************/
+#include <Windows.h>
+
+#include "VgaCapture.h"
+
+
+/** Constants ***********************************************************/
+
+/**
+ * Largest downscaling factor supported.
+ */
+#define VGA_THUMBNAIL_MAX_SCALE (255)
+
+
+/** Functions ***********************************************************/
+
+/**
+ * Calculates the dimensions of a capture's thumbnail.
+ * Each thumbnail pixel covers nScale x nScale screen pixels.
+ * Screen pixels past the last whole block are left out.
+ *
+ * @param[in]	ptCapture	The capture.
+ * @param[in]	nScale		The downscaling factor,
+ *							up to VGA_THUMBNAIL_MAX_SCALE.
+ * @param[out]	pnWidth		Will receive the width of the thumbnail.
+ * @param[out]	pnHeight	Will receive the height of the thumbnail.
+ *
+ * @returns HRESULT
+ */
+HRESULT
+VGATHUMBNAIL_GetSize(
+	_In_	PCVGA_CAPTURE_VIEW	ptCapture,
+	_In_	DWORD				nScale,
+	_Out_	PDWORD				pnWidth,
+	_Out_	PDWORD				pnHeight
+);
+
+/**
+ * Renders a box-filtered thumbnail of a captured screen.
+ *
+ * The colors in each block are counted straight from the plane bytes,
+ * so the full-size image is never needed. It can still be produced
+ * in the same pass, by specifying one of the optional outputs:
+ * each band of rows is decoded right before its thumbnail row
+ * is counted, while the band's plane bytes are still in the cache.
+ *
+ * @param[in]	ptCapture		The capture.
+ * @param[in]	ptPalette		The colors of the VGA_COLORS pixel values.
+ * @param[in]	nScale			The downscaling factor.
+ * @param[out]	ptThumbnail		Will receive the thumbnail, top row first,
+ *								with no padding between rows.
+ * @param[out]	pnPixels		Optionally receives the full-size image
+ *								as indexed pixels, top row first.
+ * @param[in]	cbPixelStride	Distance between rows in pnPixels, in bytes.
+ * @param[out]	ptPixels		Optionally receives the full-size image
+ *								as colored pixels, top row first,
+ *								with no padding between rows.
+ *
+ * @returns HRESULT
+ *
+ * @see VGATHUMBNAIL_GetSize
+ * @remark	At most one of pnPixels and ptPixels may be specified.
+ */
+HRESULT
+VGATHUMBNAIL_Render(
+	_In_					PCVGA_CAPTURE_VIEW	ptCapture,
+	_In_reads_(VGA_COLORS)	CONST RGBQUAD *		ptPalette,
+	_In_					DWORD				nScale,
+	_Out_					RGBQUAD *			ptThumbnail,
+	_Out_opt_				PBYTE				pnPixels,
+	_In_					DWORD				cbPixelStride,
+	_Out_opt_				RGBQUAD *			ptPixels
+);
+
+/**
+ * Renders a box-filtered thumbnail of a captured screen
+ * into a tile of a bigger image, such as a mosaic of screens.
+ *
+ * @param[in]	ptCapture	The capture.
+ * @param[in]	ptPalette	The colors of the VGA_COLORS pixel values.
+ * @param[in]	nScale		The downscaling factor.
+ * @param[out]	ptTile		Will receive the thumbnail, top row first,
+ *							starting at the tile's top-left pixel.
+ * @param[in]	nTileStride	Distance between rows of the bigger image,
+ *							in pixels. At least the thumbnail's width.
+ *
+ * @returns HRESULT
+ *
+ * @see VGATHUMBNAIL_Render
+ */
+HRESULT
+VGATHUMBNAIL_RenderTile(
+	_In_					PCVGA_CAPTURE_VIEW	ptCapture,
+	_In_reads_(VGA_COLORS)	CONST RGBQUAD *		ptPalette,
+	_In_					DWORD				nScale,
+	_Out_					RGBQUAD *			ptTile,
+	_In_					DWORD				nTileStride
+);
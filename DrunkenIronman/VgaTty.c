@@ -0,0 +1,410 @@
+/**
+ * @file VgaTty.c
+ * @author biko
+ * @date 2026-10-17
+ *
+ * VgaTty module implementation.
+ */
+
+/** Headers *************************************************************/
+#include <Windows.h>
+#include <intsafe.h>
+
+#include <assert.h>
+
+#include <Drink.h>
+
+#include "Util.h"
+#include "Debug.h"
+
+#include "VgaThumbnail.h"
+#include "VgaTty.h"
+
+
+/** Constants ***********************************************************/
+
+/**
+ * Starts an escape sequence that sets colors.
+ */
+#define CONTROL_SEQUENCE_INTRODUCER ("\x1B[")
+
+/**
+ * Sets the foreground or background to a 24-bit color,
+ * given as its red, green and blue values.
+ */
+#define SET_FOREGROUND_COLOR ("38;2;")
+#define SET_BACKGROUND_COLOR ("48;2;")
+
+/**
+ * Restores the terminal's own background.
+ */
+#define SET_DEFAULT_BACKGROUND ("49")
+
+/**
+ * The upper half block (U+2580) in UTF-8. Its foreground
+ * draws the top pixel of a cell, and its background the bottom one.
+ */
+#define UPPER_HALF_BLOCK ("\xE2\x96\x80")
+
+/**
+ * Ends a line of cells. The colors are reset first,
+ * so they don't bleed into the rest of the line.
+ */
+#define LINE_END ("\x1B[0m\n")
+
+/**
+ * The most a single cell can take up: both colors, then the block.
+ */
+#define MAX_CELL_SIZE (sizeof("\x1B[38;2;255;255;255;48;2;255;255;255m\xE2\x96\x80") - 1)
+
+/**
+ * Number of values a color channel can have,
+ * and the most decimal digits any of them takes.
+ */
+#define CHANNEL_VALUES (256)
+#define MAX_CHANNEL_DIGITS (3)
+
+/**
+ * Number of thumbnail rows each line of cells covers.
+ */
+#define ROWS_PER_LINE (2)
+
+
+/** Macros **************************************************************/
+
+/**
+ * Copies a string constant to the output, without its terminator,
+ * and moves past it.
+ */
+#define APPEND_STRING(pchOutput, szString)							\
+	do																\
+	{																\
+		CopyMemory((pchOutput), (szString), sizeof(szString) - 1);	\
+		(pchOutput) += sizeof(szString) - 1;						\
+	} while (0)
+
+
+/** Typedefs ************************************************************/
+
+/**
+ * Writes the cells of a screen, setting colors only
+ * where they differ from the previous cell's.
+ */
+typedef struct _VGATTY_WRITER
+{
+	// Where the cells are written.
+	HVGASTREAM	hStream;
+
+	// The decimal digits of each channel value, so a cell's
+	// colors are copied rather than formatted.
+	CHAR		aachDigits[CHANNEL_VALUES][MAX_CHANNEL_DIGITS];
+	BYTE		acchDigits[CHANNEL_VALUES];
+
+	// The colors set so far on the current line.
+	// Unset colors are the terminal's own.
+	BOOL		bForeground;
+	RGBQUAD		tForeground;
+	BOOL		bBackground;
+	RGBQUAD		tBackground;
+} VGATTY_WRITER, *PVGATTY_WRITER;
+typedef CONST VGATTY_WRITER *PCVGATTY_WRITER;
+
+
+/** Functions ***********************************************************/
+
+/**
+ * Prepares a writer, and its table of channel values.
+ *
+ * @param[out]	ptWriter	The writer.
+ * @param[in]	hStream		Where to write the cells.
+ */
+STATIC
+VOID
+vgatty_InitializeWriter(
+	_Out_	PVGATTY_WRITER	ptWriter,
+	_In_	HVGASTREAM		hStream
+)
+{
+	DWORD	nValue	= 0;
+	DWORD	nDigits	= 0;
+	DWORD	nDigit	= 0;
+	DWORD	nRest	= 0;
+
+	ZeroMemory(ptWriter, sizeof(*ptWriter));
+	ptWriter->hStream = hStream;
+
+	for (nValue = 0; nValue < CHANNEL_VALUES; ++nValue)
+	{
+		nDigits = (100 <= nValue) ? 3 : ((10 <= nValue) ? 2 : 1);
+
+		// Least significant digit last.
+		for (nDigit = nDigits, nRest = nValue; 0 < nDigit; --nDigit, nRest /= 10)
+		{
+			ptWriter->aachDigits[nValue][nDigit - 1] = (CHAR)('0' + (nRest % 10));
+		}
+		ptWriter->acchDigits[nValue] = (BYTE)nDigits;
+	}
+}
+
+/**
+ * Checks whether two colors look the same.
+ * The reserved channel is ignored.
+ *
+ * @param[in]	ptFirst		The first color.
+ * @param[in]	ptSecond	The second color.
+ *
+ * @returns BOOL
+ */
+STATIC
+FORCEINLINE
+BOOL
+vgatty_IsSameColor(
+	_In_	CONST RGBQUAD *	ptFirst,
+	_In_	CONST RGBQUAD *	ptSecond
+)
+{
+	return (ptFirst->rgbRed == ptSecond->rgbRed) &&
+		   (ptFirst->rgbGreen == ptSecond->rgbGreen) &&
+		   (ptFirst->rgbBlue == ptSecond->rgbBlue);
+}
+
+/**
+ * Writes a channel value in decimal.
+ *
+ * @param[in]	ptWriter	The writer.
+ * @param[out]	pchOutput	Where to write the value.
+ * @param[in]	nValue		The value.
+ *
+ * @returns PCHAR, right past the value.
+ */
+STATIC
+FORCEINLINE
+PCHAR
+vgatty_AppendChannel(
+	_In_										PCVGATTY_WRITER	ptWriter,
+	_Out_writes_to_(MAX_CHANNEL_DIGITS, return)	PCHAR			pchOutput,
+	_In_										BYTE			nValue
+)
+{
+	CopyMemory(pchOutput, ptWriter->aachDigits[nValue], MAX_CHANNEL_DIGITS);
+
+	return pchOutput + ptWriter->acchDigits[nValue];
+}
+
+/**
+ * Writes the red, green and blue values of a color,
+ * separated as a control sequence separates them.
+ *
+ * @param[in]	ptWriter	The writer.
+ * @param[out]	pchOutput	Where to write the values.
+ * @param[in]	ptColor		The color.
+ *
+ * @returns PCHAR, right past the values.
+ */
+STATIC
+PCHAR
+vgatty_AppendColor(
+	_In_	PCVGATTY_WRITER	ptWriter,
+	_Out_	PCHAR			pchOutput,
+	_In_	CONST RGBQUAD *	ptColor
+)
+{
+	pchOutput = vgatty_AppendChannel(ptWriter, pchOutput, ptColor->rgbRed);
+	*pchOutput++ = ';';
+	pchOutput = vgatty_AppendChannel(ptWriter, pchOutput, ptColor->rgbGreen);
+	*pchOutput++ = ';';
+
+	return vgatty_AppendChannel(ptWriter, pchOutput, ptColor->rgbBlue);
+}
+
+/**
+ * Writes a cell, with whatever colors it needs set.
+ *
+ * @param[in,out]	ptWriter	The writer.
+ * @param[in]		ptTop		The color of the top pixel.
+ * @param[in]		ptBottom	The color of the bottom pixel.
+ *								NULL leaves the bottom blank,
+ *								past the last row of the screen.
+ *
+ * @returns HRESULT
+ */
+STATIC
+HRESULT
+vgatty_WriteCell(
+	_Inout_		PVGATTY_WRITER	ptWriter,
+	_In_		CONST RGBQUAD *	ptTop,
+	_In_opt_	CONST RGBQUAD *	ptBottom
+)
+{
+	HRESULT	hrResult		= E_FAIL;
+	PBYTE	pnSpace			= NULL;
+	DWORD	cbSpace			= 0;
+	PCHAR	pchOutput		= NULL;
+	BOOL	bSetForeground	= FALSE;
+	BOOL	bSetBackground	= FALSE;
+
+	assert(NULL != ptWriter);
+	assert(NULL != ptTop);
+
+	hrResult = VGASTREAM_Reserve(ptWriter->hStream, MAX_CELL_SIZE, &pnSpace, &cbSpace);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+	pchOutput = (PCHAR)pnSpace;
+
+	bSetForeground = !ptWriter->bForeground ||
+					 !vgatty_IsSameColor(ptTop, &ptWriter->tForeground);
+	bSetBackground =
+		(NULL == ptBottom)
+		? ptWriter->bBackground
+		: (!ptWriter->bBackground || !vgatty_IsSameColor(ptBottom, &ptWriter->tBackground));
+
+	// Neighboring cells are mostly the same colors.
+	if (bSetForeground || bSetBackground)
+	{
+		APPEND_STRING(pchOutput, CONTROL_SEQUENCE_INTRODUCER);
+		if (bSetForeground)
+		{
+			APPEND_STRING(pchOutput, SET_FOREGROUND_COLOR);
+			pchOutput = vgatty_AppendColor(ptWriter, pchOutput, ptTop);
+			ptWriter->bForeground = TRUE;
+			ptWriter->tForeground = *ptTop;
+		}
+		if (bSetForeground && bSetBackground)
+		{
+			*pchOutput++ = ';';
+		}
+		if (bSetBackground && (NULL != ptBottom))
+		{
+			APPEND_STRING(pchOutput, SET_BACKGROUND_COLOR);
+			pchOutput = vgatty_AppendColor(ptWriter, pchOutput, ptBottom);
+			ptWriter->bBackground = TRUE;
+			ptWriter->tBackground = *ptBottom;
+		}
+		else if (bSetBackground)
+		{
+			APPEND_STRING(pchOutput, SET_DEFAULT_BACKGROUND);
+			ptWriter->bBackground = FALSE;
+		}
+		*pchOutput++ = 'm';
+	}
+	APPEND_STRING(pchOutput, UPPER_HALF_BLOCK);
+
+	VGASTREAM_Commit(ptWriter->hStream, (DWORD)(pchOutput - (PCHAR)pnSpace));
+
+	hrResult = S_OK;
+
+lblCleanup:
+	return hrResult;
+}
+
+/**
+ * Ends the current line of cells.
+ *
+ * @param[in,out]	ptWriter	The writer.
+ *
+ * @returns HRESULT
+ */
+STATIC
+HRESULT
+vgatty_EndLine(
+	_Inout_	PVGATTY_WRITER	ptWriter
+)
+{
+	assert(NULL != ptWriter);
+
+	ptWriter->bForeground = FALSE;
+	ptWriter->bBackground = FALSE;
+
+	return VGASTREAM_Write(ptWriter->hStream, LINE_END, sizeof(LINE_END) - 1);
+}
+
+HRESULT
+VGATTY_Draw(
+	_In_					PCVGA_CAPTURE_VIEW	ptCapture,
+	_In_reads_(VGA_COLORS)	CONST RGBQUAD *		ptPalette,
+	_In_					DWORD				nColumns,
+	_In_					HVGASTREAM			hStream
+)
+{
+	HRESULT			hrResult	= E_FAIL;
+	DWORD			nScale		= 0;
+	DWORD			nWidth		= 0;
+	DWORD			nHeight		= 0;
+	DWORD			nPixels		= 0;
+	RGBQUAD *		ptThumbnail	= NULL;
+	VGATTY_WRITER	tWriter		= { 0 };
+	DWORD			nY			= 0;
+	DWORD			nX			= 0;
+	CONST RGBQUAD *	ptTop		= NULL;
+	CONST RGBQUAD *	ptBottom	= NULL;
+
+	if ((NULL == ptCapture) ||
+		(NULL == ptPalette) ||
+		(0 == nColumns) ||
+		(NULL == hStream))
+	{
+		hrResult = E_INVALIDARG;
+		goto lblCleanup;
+	}
+
+	// The smallest scale that fits, and never upscaled.
+	nScale = max((ptCapture->nWidth + nColumns - 1) / nColumns, 1);
+	hrResult = VGATHUMBNAIL_GetSize(ptCapture, nScale, &nWidth, &nHeight);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	hrResult = DWordMult(nWidth, nHeight, &nPixels);
+	if (FAILED(hrResult))
+	{
+		PROGRESS("The image is too big.");
+		goto lblCleanup;
+	}
+	ptThumbnail = HEAPALLOC(nPixels * sizeof(*ptThumbnail));
+	if (NULL == ptThumbnail)
+	{
+		PROGRESS("Oops. Ran out of memory.");
+		hrResult = E_OUTOFMEMORY;
+		goto lblCleanup;
+	}
+
+	hrResult = VGATHUMBNAIL_Render(ptCapture, ptPalette, nScale, ptThumbnail, NULL, 0, NULL);
+	if (FAILED(hrResult))
+	{
+		goto lblCleanup;
+	}
+
+	vgatty_InitializeWriter(&tWriter, hStream);
+	for (nY = 0; nY < nHeight; nY += ROWS_PER_LINE)
+	{
+		ptTop = ptThumbnail + (nY * nWidth);
+		ptBottom = (nY + 1 < nHeight) ? (ptTop + nWidth) : NULL;
+
+		for (nX = 0; nX < nWidth; ++nX)
+		{
+			hrResult = vgatty_WriteCell(&tWriter,
+										&(ptTop[nX]),
+										(NULL == ptBottom) ? NULL : &(ptBottom[nX]));
+			if (FAILED(hrResult))
+			{
+				goto lblCleanup;
+			}
+		}
+
+		hrResult = vgatty_EndLine(&tWriter);
+		if (FAILED(hrResult))
+		{
+			goto lblCleanup;
+		}
+	}
+
+	hrResult = S_OK;
+
+lblCleanup:
+	HEAPFREE(ptThumbnail);
+
+	return hrResult;
+}
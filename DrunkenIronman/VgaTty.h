@@ -0,0 +1,45 @@
+/**
+ * @file VgaTty.h
+ * @author biko
+ * @date 2026-10-17
+ *
+ * VgaTty module public header.
+ * Contains routines for drawing captured screens on a terminal,
+ * with 24-bit ANSI colors and half-block characters.
+ */
+#pragma once
+
+/** Headers *************************************************************/
+#include <Windows.h>
+
+#include <Drink.h>
+
+#include "VgaCapture.h"
+#include "VgaStream.h"
+
+
+/** Functions ***********************************************************/
+
+/**
+ * Draws a captured screen, scaled down to fit the given width.
+ * Each character cell covers two pixels of the scaled screen,
+ * one above the other, so the pixels come out square.
+ *
+ * The scaled screen is a thumbnail, counted straight
+ * from the plane bytes, so the full-size image is never decoded.
+ *
+ * @param[in]	ptCapture	The capture.
+ * @param[in]	ptPalette	The colors of the VGA_COLORS pixel values.
+ * @param[in]	nColumns	Width of the terminal, in characters.
+ * @param[in]	hStream		Where to write the escape sequences,
+ *							as UTF-8.
+ *
+ * @returns HRESULT
+ */
+HRESULT
+VGATTY_Draw(
+	_In_					PCVGA_CAPTURE_VIEW	ptCapture,
+	_In_reads_(VGA_COLORS)	CONST RGBQUAD *		ptPalette,
+	_In_					DWORD				nColumns,
+	_In_					HVGASTREAM			hStream
+);
@@ -19,7 +19,7 @@
 	{																\
 		if ((value) != (object))									\
 		{															\
-			(VOID)(pfnDestructor)((object), __VA_ARGS__);			\
+			(VOID)(pfnDestructor)((object), ##__VA_ARGS__);			\
 			(object) = (value);										\
 		}															\
 	} while (0)
@@ -11,6 +11,8 @@
 
 /**
  * Width of the bugcheck screen, in pixels.
+ * This is the geometry of VGA mode 12h, which is what
+ * Windows uses for the BSoD, and of legacy captures.
  */
 #define SCREEN_WIDTH_PIXELS (640)
 
@@ -31,11 +33,88 @@ C_ASSERT(PIXELS_IN_BYTE == 8);
  */
 #define VGA_PLANES (4)
 
+/**
+ * Number of distinct pixel values that can be
+ * stored in the VGA's planes.
+ */
+#define VGA_COLORS (1 << VGA_PLANES)
+
 /**
  * Number of entries in the VGA's DAC palette.
  */
 #define VGA_DAC_PALETTE_ENTRIES (256)
 
+/**
+ * Size of the window through which each VGA plane
+ * can be read, in bytes.
+ */
+#define VGA_PLANE_MAX_BYTES (0x10000)
+
+/**
+ * Maximum distance between rows of a graphics mode screen, in bytes.
+ * The CRTC's Offset register is a byte, and even in doubleword mode
+ * each of its units is only 8 bytes.
+ */
+#define VGA_GRAPHICS_MAX_STRIDE (0xFF * 8)
+
+/**
+ * Number of glyphs in a text mode font.
+ */
+#define VGA_FONT_GLYPHS (256)
+
+/**
+ * Maximum height of a text mode glyph, in scan lines.
+ * This is also the distance between glyphs in plane 2.
+ */
+#define VGA_FONT_GLYPH_MAX_HEIGHT (32)
+
+/**
+ * Number of bytes each character occupies in text mode
+ * (the character and its attribute).
+ */
+#define VGA_TEXT_CELL_BYTES (2)
+
+/**
+ * Maximum dimensions of a text mode screen, in characters.
+ * No VGA or VESA text mode goes beyond 132x60.
+ */
+#define VGA_TEXT_MAX_COLUMNS (132)
+#define VGA_TEXT_MAX_ROWS (60)
+
+/**
+ * Number of Attribute Controller palette registers.
+ */
+#define VGA_ATTRIBUTE_PALETTE_ENTRIES (16)
+
+/**
+ * Identifies a VGA capture header ("DrVC").
+ */
+#define VGA_CAPTURE_MAGIC (0x43567244)
+
+/**
+ * Current version of the VGA capture format.
+ */
+#define VGA_CAPTURE_VERSION (2)
+
+/**
+ * Attribute Mode Control register - blinking is enabled,
+ * so the top bit of a character's attribute is not
+ * part of the background color.
+ */
+#define VGA_ATTRIBUTE_MODE_BLINK (0x08)
+
+/**
+ * Attribute Mode Control register - bits 4-5 of the DAC index
+ * come from the Color Select register instead of the palette.
+ */
+#define VGA_ATTRIBUTE_MODE_P54S (0x80)
+
+/**
+ * FNV-1a parameters for the VGA capture checksum.
+ */
+#define VGA_CAPTURE_CHECKSUM_BASIS (0x811C9DC5)
+#define VGA_CAPTURE_CHECKSUM_PRIME (0x01000193)
+
 /**
  * {ab490092-9446-4088-901b-b6a801cd6c75}
  * GUID for tagging the saved VGA dump in the dump file.
@@ -72,8 +151,31 @@ EXTERN_C CONST GUID DECLSPEC_SELECTANY g_tVgaDumpGuid =
 	(CTL_CODE(DRINK_DEVICE_TYPE, 0x801, METHOD_BUFFERED, FILE_ANY_ACCESS))
 
 
+/** Macros **************************************************************/
+
+/**
+ * Adds a single byte to a VGA capture checksum.
+ */
+#define VGA_CAPTURE_CHECKSUM_STEP(nChecksum, nByte) \
+	((((ULONG)(nChecksum)) ^ ((UCHAR)(nByte))) * VGA_CAPTURE_CHECKSUM_PRIME)
+
+
 /** Typedefs ************************************************************/
 
+/**
+ * The kinds of screen contents a VGA capture can hold.
+ */
+typedef enum _VGA_CAPTURE_MODE
+{
+	// 16-color planar graphics.
+	// The payload holds the planes.
+	VGA_CAPTURE_MODE_GRAPHICS = 0,
+
+	// Text. The payload holds the character/attribute pairs,
+	// row by row, followed by the font.
+	VGA_CAPTURE_MODE_TEXT,
+} VGA_CAPTURE_MODE, *PVGA_CAPTURE_MODE;
+
 /**
  * Contains information about a single DAC palette entry.
  */
@@ -86,12 +188,88 @@ typedef struct _PALETTE_ENTRY
 typedef CONST PALETTE_ENTRY *PCPALETTE_ENTRY;
 
 /**
- * Structure of a single plane of VGA video memory.
+ * Describes a capture of the VGA's state.
+ *
+ * The header is followed by the payload:
+ * nPaletteEntries DAC palette entries, and then the screen contents.
+ * In graphics mode, these are nPlanes planes, each of them
+ * nHeight rows of cbStride bytes.
+ * In text mode, these are nHeight rows of cbStride bytes, each holding
+ * nWidth character/attribute pairs, followed by VGA_FONT_GLYPHS glyphs
+ * of nCharHeight bytes.
+ */
+typedef struct _VGA_CAPTURE_HEADER
+{
+	// Always VGA_CAPTURE_MAGIC.
+	ULONG	nMagic;
+
+	// Version of the capture format.
+	ULONG	nVersion;
+
+	// Size of the header, in bytes.
+	// Newer versions only ever append fields.
+	ULONG	cbHeader;
+
+	// Dimensions of the screen, in pixels
+	// (or characters, in text mode).
+	ULONG	nWidth;
+	ULONG	nHeight;
+
+	// Distance between the starts of adjacent rows
+	// in each plane (or in the text), in bytes.
+	ULONG	cbStride;
+
+	// Number of planes in the payload.
+	ULONG	nPlanes;
+
+	// Number of bits in each pixel's value.
+	ULONG	nBitsPerPixel;
+
+	// Number of DAC palette entries in the payload.
+	ULONG	nPaletteEntries;
+
+	// FNV-1a of the payload.
+	ULONG	nChecksum;
+
+	//
+	// Version 2 and up.
+	//
+
+	// A VGA_CAPTURE_MODE value.
+	ULONG	eMode;
+
+	// Height of each character, in scan lines.
+	// Only meaningful in text mode.
+	ULONG	nCharHeight;
+
+	// The Attribute Controller's palette, which maps
+	// pixel values to DAC entries.
+	UCHAR	anAttributePalette[VGA_ATTRIBUTE_PALETTE_ENTRIES];
+
+	// The Attribute Mode Control register.
+	UCHAR	fAttributeMode;
+
+	// The Color Select register.
+	UCHAR	fColorSelect;
+
+	UCHAR	anReserved[2];
+} VGA_CAPTURE_HEADER, *PVGA_CAPTURE_HEADER;
+typedef CONST VGA_CAPTURE_HEADER *PCVGA_CAPTURE_HEADER;
+
+/**
+ * Size of the first version of the capture header.
+ */
+#define VGA_CAPTURE_HEADER_V1_SIZE (RTL_SIZEOF_THROUGH_FIELD(VGA_CAPTURE_HEADER, nChecksum))
+
+/**
+ * Structure of a single plane of VGA video memory,
+ * as stored in legacy captures.
  */
 typedef UCHAR VGA_PLANE_DUMP[(SCREEN_WIDTH_PIXELS * SCREEN_HEIGHT_PIXELS) / PIXELS_IN_BYTE];
 
 /**
- * Structure of a VGA video memory dump.
+ * Structure of a legacy VGA video memory dump,
+ * which predates VGA_CAPTURE_HEADER.
  */
 typedef struct _VGA_DUMP
 {
@@ -0,0 +1,168 @@
+/**
+ * @file Windows.h
+ * @author biko
+ * @date 2026-10-17
+ *
+ * Just enough of the Windows SDK to build the modules that don't
+ * talk to the OS (VgaDecode), and the dump reader (DumpParse, which
+ * talks to it through DumpFile, and DumpSynth), with gcc or clang,
+ * so that the tests run on Linux as well. Not a replacement for the SDK.
+ */
+#pragma once
+
+/** Headers *************************************************************/
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+
+
+/** Constants ***********************************************************/
+
+#define VOID void
+#define CONST const
+#define STATIC static
+#define FORCEINLINE inline __attribute__((always_inline))
+#define UNALIGNED
+
+// In C, the SDK makes this "extern", which gcc warns about
+// on initialized definitions such as the GUIDs in Drink.h.
+#define EXTERN_C
+#define DECLSPEC_SELECTANY __attribute__((weak))
+
+#define TRUE (1)
+#define FALSE (0)
+#define MAXBYTE (0xFF)
+#define MAXDWORD (0xFFFFFFFF)
+
+#define S_OK ((HRESULT)0)
+#define E_FAIL ((HRESULT)0x80004005)
+#define E_INVALIDARG ((HRESULT)0x80070057)
+#define E_OUTOFMEMORY ((HRESULT)0x8007000E)
+
+#define ERROR_FILE_NOT_FOUND (2L)
+#define ERROR_ACCESS_DENIED (5L)
+#define ERROR_BAD_FORMAT (11L)
+#define ERROR_INVALID_DATA (13L)
+#define ERROR_CRC (23L)
+#define ERROR_HANDLE_EOF (38L)
+#define ERROR_NOT_SUPPORTED (50L)
+#define ERROR_FILE_TOO_LARGE (223L)
+#define ERROR_NO_MORE_ITEMS (259L)
+#define ERROR_NO_UNICODE_TRANSLATION (1113L)
+#define ERROR_NOT_FOUND (1168L)
+
+#define HEAP_ZERO_MEMORY (0x00000008)
+
+#define FACILITY_WIN32 (7)
+
+#define PF_XMMI64_INSTRUCTIONS_AVAILABLE (10)
+
+
+/** Macros **************************************************************/
+
+#define C_ASSERT(e) _Static_assert((e), #e)
+#define DECLARE_HANDLE(name) struct name##__ { int unused; }; typedef struct name##__ *name
+#define ARRAYSIZE(a) (sizeof(a) / sizeof((a)[0]))
+#define FIELD_OFFSET(type, field) offsetof(type, field)
+#define RTL_FIELD_SIZE(type, field) (sizeof(((type *)0)->field))
+#define RTL_SIZEOF_THROUGH_FIELD(type, field) (FIELD_OFFSET(type, field) + RTL_FIELD_SIZE(type, field))
+#define UNREFERENCED_PARAMETER(p) ((VOID)(p))
+
+#define min(a, b) (((a) < (b)) ? (a) : (b))
+#define max(a, b) (((a) > (b)) ? (a) : (b))
+
+#define CopyMemory(pvDestination, pvSource, cbLength) memcpy((pvDestination), (pvSource), (cbLength))
+#define FillMemory(pvDestination, cbLength, nFill) memset((pvDestination), (nFill), (cbLength))
+#define ZeroMemory(pvDestination, cbLength) memset((pvDestination), 0, (cbLength))
+
+#define SUCCEEDED(hr) (((HRESULT)(hr)) >= 0)
+#define FAILED(hr) (((HRESULT)(hr)) < 0)
+#define IsEqualGUID(rguid1, rguid2) (0 == memcmp((rguid1), (rguid2), sizeof(GUID)))
+
+// The process heap is the C heap.
+#define GetProcessHeap() (NULL)
+#define HeapAlloc(hHeap, fFlags, cbSize) calloc(1, (cbSize))
+#define HeapFree(hHeap, fFlags, pvMemory) (free(pvMemory), TRUE)
+
+#define HRESULT_FROM_WIN32(x) \
+	((HRESULT)(((x) <= 0) ? (x) : ((((x) & 0x0000FFFF) | (FACILITY_WIN32 << 16) | 0x80000000))))
+
+// SAL annotations only mean something to the MSVC analyzer.
+#define _In_
+#define _In_opt_
+#define _In_reads_(s)
+#define _In_reads_bytes_(s)
+#define _In_reads_bytes_opt_(s)
+#define _Inout_
+#define _Out_
+#define _Out_opt_
+#define _Out_writes_(s)
+#define _Out_writes_all_(s)
+#define _Out_writes_bytes_(s)
+#define _Outptr_
+#define _Outptr_result_buffer_(s)
+#define _Outptr_result_bytebuffer_(s)
+#define _Outptr_result_bytebuffer_maybenull_(s)
+
+
+/** Typedefs ************************************************************/
+
+typedef char CHAR;
+typedef unsigned char UCHAR;
+typedef wchar_t WCHAR;
+typedef uint8_t BYTE, *PBYTE;
+typedef uint16_t WORD, USHORT;
+typedef int INT;
+typedef int BOOL;
+typedef int32_t LONG;
+typedef uint32_t DWORD, ULONG, *PDWORD;
+typedef long long LONGLONG;
+typedef unsigned long long ULONGLONG, DWORD64, *PULONGLONG;
+typedef uintptr_t ULONG_PTR;
+typedef size_t SIZE_T, *PSIZE_T;
+typedef LONG HRESULT;
+typedef CHAR *PSTR;
+typedef CONST CHAR *PCSTR;
+typedef WCHAR *PWSTR;
+typedef CONST WCHAR *PCWSTR;
+typedef void *PVOID, *HANDLE, *HKEY, *HMODULE;
+typedef CONST void *LPCVOID;
+
+typedef struct _GUID
+{
+	uint32_t	Data1;
+	uint16_t	Data2;
+	uint16_t	Data3;
+	uint8_t		Data4[8];
+} GUID, *LPGUID;
+typedef CONST GUID *LPCGUID;
+
+typedef struct tagRGBQUAD
+{
+	BYTE	rgbBlue;
+	BYTE	rgbGreen;
+	BYTE	rgbRed;
+	BYTE	rgbReserved;
+} RGBQUAD;
+
+typedef struct tagRECT
+{
+	LONG	left;
+	LONG	top;
+	LONG	right;
+	LONG	bottom;
+} RECT, *PRECT;
+
+
+/** Functions ***********************************************************/
+
+static inline
+BOOL
+IsProcessorFeaturePresent(
+	DWORD	eFeature
+)
+{
+	return (PF_XMMI64_INSTRUCTIONS_AVAILABLE == eFeature) && __builtin_cpu_supports("sse2");
+}
@@ -0,0 +1,33 @@
+/**
+ * @file intrin.h
+ * @author biko
+ * @date 2026-10-17
+ *
+ * The MSVC intrinsics used by the decoders, on top of
+ * the gcc and clang headers.
+ */
+#pragma once
+
+/** Headers *************************************************************/
+#include <x86intrin.h>
+#include <cpuid.h>
+
+
+/** Functions ***********************************************************/
+
+// cpuid.h has a __cpuid of its own, with different arguments,
+// and newer ones a __cpuidex as well.
+#undef __cpuid
+#define __cpuid(anRegisters, nLeaf) compat_Cpuidex((anRegisters), (nLeaf), 0)
+#define __cpuidex(anRegisters, nLeaf, nSubleaf) compat_Cpuidex((anRegisters), (nLeaf), (nSubleaf))
+
+static inline
+void
+compat_Cpuidex(
+	int	anRegisters[4],
+	int	nLeaf,
+	int	nSubleaf
+)
+{
+	__cpuid_count(nLeaf, nSubleaf, anRegisters[0], anRegisters[1], anRegisters[2], anRegisters[3]);
+}
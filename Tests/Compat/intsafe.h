@@ -0,0 +1,64 @@
+/**
+ * @file intsafe.h
+ * @author biko
+ * @date 2026-10-17
+ *
+ * The checked arithmetic of the SDK's intsafe.h
+ * that the dump reader uses, with the gcc and clang builtins.
+ */
+#pragma once
+
+/** Headers *************************************************************/
+#include <Windows.h>
+
+
+/** Constants ***********************************************************/
+
+#define INTSAFE_E_ARITHMETIC_OVERFLOW ((HRESULT)0x80070216)
+
+
+/** Macros **************************************************************/
+
+/**
+ * Defines a checked operation on two values of a type.
+ */
+#define COMPAT_DEFINE_INTSAFE(pfnName, tType, pfnBuiltin)			\
+	static inline													\
+	HRESULT															\
+	pfnName(														\
+		tType	nLeft,												\
+		tType	nRight,												\
+		tType *	pnResult											\
+	)																\
+	{																\
+		if (pfnBuiltin(nLeft, nRight, pnResult))					\
+		{															\
+			*pnResult = 0;											\
+			return INTSAFE_E_ARITHMETIC_OVERFLOW;					\
+		}															\
+		return S_OK;												\
+	}
+
+
+/** Functions ***********************************************************/
+
+COMPAT_DEFINE_INTSAFE(DWordAdd, DWORD, __builtin_add_overflow)
+COMPAT_DEFINE_INTSAFE(DWordMult, DWORD, __builtin_mul_overflow)
+COMPAT_DEFINE_INTSAFE(ULongLongAdd, ULONGLONG, __builtin_add_overflow)
+COMPAT_DEFINE_INTSAFE(ULongLongMult, ULONGLONG, __builtin_mul_overflow)
+
+static inline
+HRESULT
+ULongLongToSizeT(
+	ULONGLONG	nValue,
+	SIZE_T *	pnResult
+)
+{
+	if ((SIZE_T)nValue != nValue)
+	{
+		*pnResult = 0;
+		return INTSAFE_E_ARITHMETIC_OVERFLOW;
+	}
+	*pnResult = (SIZE_T)nValue;
+	return S_OK;
+}
@@ -0,0 +1,61 @@
+/**
+ * @file strsafe.h
+ * @author biko
+ * @date 2026-10-17
+ *
+ * The bounded string copies of the SDK's strsafe.h
+ * that the dump reader uses.
+ */
+#pragma once
+
+/** Headers *************************************************************/
+#include <Windows.h>
+
+
+/** Constants ***********************************************************/
+
+#define STRSAFE_E_INSUFFICIENT_BUFFER ((HRESULT)0x8007007A)
+
+
+/** Functions ***********************************************************/
+
+static inline
+HRESULT
+StringCchCopyW(
+	PWSTR	pwszDestination,
+	SIZE_T	cchDestination,
+	PCWSTR	pwszSource
+)
+{
+	SIZE_T	cchSource	= wcslen(pwszSource);
+
+	if (cchDestination <= cchSource)
+	{
+		if (0 != cchDestination)
+		{
+			pwszDestination[0] = L'\0';
+		}
+		return STRSAFE_E_INSUFFICIENT_BUFFER;
+	}
+
+	CopyMemory(pwszDestination, pwszSource, (cchSource + 1) * sizeof(WCHAR));
+	return S_OK;
+}
+
+static inline
+HRESULT
+StringCchCatW(
+	PWSTR	pwszDestination,
+	SIZE_T	cchDestination,
+	PCWSTR	pwszSource
+)
+{
+	SIZE_T	cchExisting	= wcsnlen(pwszDestination, cchDestination);
+
+	if (cchDestination == cchExisting)
+	{
+		return STRSAFE_E_INSUFFICIENT_BUFFER;
+	}
+
+	return StringCchCopyW(pwszDestination + cchExisting, cchDestination - cchExisting, pwszSource);
+}
@@ -0,0 +1,637 @@
+/**
+ * @file DumpParseTest.c
+ * @author biko
+ * @date 2026-10-17
+ *
+ * Writes a synthetic dump in every layout DumpSynth has,
+ * with tagged data of several sizes, and checks that the native
+ * and indexed readers find the data, read it and map it exactly,
+ * and fail cleanly on truncated dumps, missing tags and other files.
+ * It only needs DumpParse, DumpFile and DumpSynth, so it builds
+ * on Linux as well, with the headers in Compat standing in
+ * for the SDK. From the root of the repository:
+ *
+ *     gcc -O2 -fno-strict-aliasing -ITests/Compat -IShared \
+ *         Tests/DumpParseTest.c DrunkenIronman/DumpParse.c \
+ *         DrunkenIronman/DumpFile.c DrunkenIronman/DumpSynth.c -o DumpParseTest
+ *     ./DumpParseTest
+ *
+ * The dump and its index are written to the current directory,
+ * and deleted at the end. Pass -v to see what the readers report.
+ * Exits with 0 only if every check passed.
+ */
+
+/** Headers *************************************************************/
+#include <Windows.h>
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <Drink.h>
+
+#include "../DrunkenIronman/DumpFormat.h"
+#include "../DrunkenIronman/DumpParse.h"
+#include "../DrunkenIronman/DumpSynth.h"
+
+
+/** Constants ***********************************************************/
+
+/**
+ * Where the dumps are written, and where the indexed reader
+ * keeps its index of them.
+ */
+#define TEST_DUMP_PATH ("DumpParseTest.dmp")
+#define TEST_DUMP_WIDE_PATH (L"DumpParseTest.dmp")
+#define TEST_INDEX_PATH ("DumpParseTest.dmp.didx")
+
+/**
+ * The most a reader may read of a dump it has an index of,
+ * before mapping anything: the header it checks the index against.
+ */
+#define TEST_INDEXED_MAX_READ (KERNEL_DUMP_HEADER64_SIZE)
+
+
+/** Typedefs ************************************************************/
+
+/**
+ * What the headers of a synthetic dump should say.
+ */
+typedef struct _TEST_LAYOUT
+{
+	DUMP_SYNTH_LAYOUT	eLayout;
+	BOOL				b64Bit;
+	KERNEL_DUMP_TYPE	eDumpType;
+} TEST_LAYOUT, *PTEST_LAYOUT;
+typedef CONST TEST_LAYOUT *PCTEST_LAYOUT;
+
+
+/** Globals *************************************************************/
+
+/**
+ * Every layout of synthetic dumps.
+ */
+STATIC CONST TEST_LAYOUT g_atLayouts[] = {
+	{ DUMP_SYNTH_LAYOUT_FULL32, FALSE, KERNEL_DUMP_TYPE_FULL },
+	{ DUMP_SYNTH_LAYOUT_KERNEL32, FALSE, KERNEL_DUMP_TYPE_SUMMARY },
+	{ DUMP_SYNTH_LAYOUT_FULL64, TRUE, KERNEL_DUMP_TYPE_FULL },
+	{ DUMP_SYNTH_LAYOUT_KERNEL64, TRUE, KERNEL_DUMP_TYPE_SUMMARY },
+	{ DUMP_SYNTH_LAYOUT_BITMAP64, TRUE, KERNEL_DUMP_TYPE_BITMAP_FULL },
+};
+C_ASSERT(ARRAYSIZE(g_atLayouts) == DUMP_SYNTH_LAYOUTS);
+
+/**
+ * Sizes of the tagged data: empty, smaller than a page,
+ * across pages, and bigger than the read-ahead.
+ */
+STATIC CONST DWORD g_acbData[] = {
+	0,
+	1,
+	13,
+	KERNEL_DUMP_PAGE_SIZE - 1,
+	KERNEL_DUMP_PAGE_SIZE + 1,
+	(64 * 1024) + 17,
+	sizeof(VGA_DUMP),
+};
+
+/**
+ * The readers that parse the dump themselves.
+ */
+STATIC CONST DUMPPARSE_READER g_aeReaders[] = {
+	DUMPPARSE_READER_NATIVE,
+	DUMPPARSE_READER_INDEXED,
+};
+
+/**
+ * {5d0b7e21-c4a3-4f86-9e1d-3b72a8f05c64}
+ * A tag none of the dumps have.
+ */
+STATIC CONST GUID g_tMissingTag =
+{ 0x5d0b7e21, 0xc4a3, 0x4f86, { 0x9e, 0x1d, 0x3b, 0x72, 0xa8, 0xf0, 0x5c, 0x64 } };
+
+/**
+ * Whether to print what the readers report.
+ */
+STATIC BOOL g_bVerbose = FALSE;
+
+/**
+ * State of the random number generator.
+ */
+STATIC DWORD g_nRandom = 0;
+
+
+/** Functions ***********************************************************/
+
+/**
+ * Stands in for the Debug module, which only runs on Windows.
+ */
+VOID
+DEBUG_Progress(
+	_In_	PCSTR	pszFunction,
+	_In_	PCSTR	pszFormat,
+	...
+)
+{
+	va_list	vaArguments;
+
+	if (!g_bVerbose)
+	{
+		return;
+	}
+
+	va_start(vaArguments, pszFormat);
+	(VOID)printf("    %s: ", pszFunction);
+	(VOID)vprintf(pszFormat, vaArguments);
+	(VOID)printf("\n");
+	va_end(vaArguments);
+}
+
+STATIC
+DWORD
+test_Random(VOID)
+{
+	// xorshift32, which never leaves 0 once there.
+	g_nRandom ^= g_nRandom << 13;
+	g_nRandom ^= g_nRandom >> 17;
+	g_nRandom ^= g_nRandom << 5;
+
+	return g_nRandom;
+}
+
+/**
+ * Writes a file, replacing it.
+ *
+ * @returns BOOL
+ */
+STATIC
+BOOL
+test_WriteFile(
+	_In_						PCSTR	pszPath,
+	_In_reads_bytes_(cbData)	LPCVOID	pvData,
+	_In_						DWORD	cbData
+)
+{
+	BOOL	bWritten	= FALSE;
+	FILE *	ptFile		= NULL;
+
+	ptFile = fopen(pszPath, "wb");
+	if (NULL == ptFile)
+	{
+		goto lblCleanup;
+	}
+
+	if ((0 != cbData) && (1 != fwrite(pvData, cbData, 1, ptFile)))
+	{
+		goto lblCleanup;
+	}
+
+	bWritten = TRUE;
+
+lblCleanup:
+	if ((NULL != ptFile) && (0 != fclose(ptFile)))
+	{
+		bWritten = FALSE;
+	}
+
+	return bWritten;
+}
+
+/**
+ * Checks that a file exists.
+ *
+ * @returns BOOL
+ */
+STATIC
+BOOL
+test_FileExists(
+	_In_	PCSTR	pszPath
+)
+{
+	FILE *	ptFile	= NULL;
+
+	ptFile = fopen(pszPath, "rb");
+	if (NULL == ptFile)
+	{
+		return FALSE;
+	}
+	(VOID)fclose(ptFile);
+
+	return TRUE;
+}
+
+/**
+ * Opens the dump written to TEST_DUMP_PATH with a reader,
+ * and checks everything the reader says about it.
+ *
+ * @param[in]	ptLayout	The layout of the dump.
+ * @param[in]	eReader		The reader.
+ * @param[in]	pnDump		The dump, as written.
+ * @param[in]	cbDump		The dump's size, in bytes.
+ * @param[in]	pnData		The tagged data in it.
+ * @param[in]	cbData		The data's size, in bytes.
+ * @param[in]	bIndexed	Whether the dump's index is up to date,
+ *							for the indexed reader.
+ * @param[in]	pszFixture	Names the dump in failures.
+ *
+ * @returns DWORD (the number of failures)
+ */
+STATIC
+DWORD
+test_CheckDump(
+	_In_					PCTEST_LAYOUT	ptLayout,
+	_In_					DUMPPARSE_READER	eReader,
+	_In_reads_(cbDump)		CONST BYTE *	pnDump,
+	_In_					DWORD			cbDump,
+	_In_reads_(cbData)		CONST BYTE *	pnData,
+	_In_					DWORD			cbData,
+	_In_					BOOL			bIndexed,
+	_In_					PCSTR			pszFixture
+)
+{
+	HRESULT								hrResult	= E_FAIL;
+	DWORD								nFailures	= 0;
+	HDUMP								hDump		= NULL;
+	DUMPPARSE_DUMP_INFO					tInfo		= { 0 };
+	PCKERNEL_DUMP_BLOB_FILE_HEADER		ptBlobFile	= NULL;
+	ULONGLONG							cbRead		= 0;
+	ULONGLONG							cbFile		= 0;
+	PDUMPPARSE_TAG						patTags		= NULL;
+	DWORD								nTags		= 0;
+	PVOID								pvRead		= NULL;
+	DWORD								cbRead32	= 0;
+	LPCVOID								pvMapped	= NULL;
+	DWORD								cbMapped	= 0;
+
+	hrResult = DUMPPARSE_OpenWithReader(TEST_DUMP_WIDE_PATH, eReader, &hDump);
+	if (FAILED(hrResult))
+	{
+		(VOID)printf("  %s: open failed (0x%08x)\n", pszFixture, (DWORD)hrResult);
+		++nFailures;
+		goto lblCleanup;
+	}
+
+	// With an index, nothing but the header is read to open it.
+	DUMPPARSE_GetReadStatistics(hDump, &cbRead, &cbFile);
+	if (cbDump != cbFile)
+	{
+		(VOID)printf("  %s: the file is %llu bytes, not %u\n", pszFixture, cbFile, cbDump);
+		++nFailures;
+	}
+	if (bIndexed && (TEST_INDEXED_MAX_READ < cbRead))
+	{
+		(VOID)printf("  %s: read %llu bytes despite the index\n", pszFixture, cbRead);
+		++nFailures;
+	}
+
+	hrResult = DUMPPARSE_GetDumpInfo(hDump, &tInfo);
+	if (FAILED(hrResult))
+	{
+		(VOID)printf("  %s: no dump info (0x%08x)\n", pszFixture, (DWORD)hrResult);
+		++nFailures;
+		goto lblCleanup;
+	}
+	if ((ptLayout->b64Bit != tInfo.b64Bit) ||
+		((DWORD)ptLayout->eDumpType != tInfo.eDumpType))
+	{
+		(VOID)printf("  %s: the header was misread\n", pszFixture);
+		++nFailures;
+	}
+
+	// The secondary data has to start right where the pages end.
+	ptBlobFile = (PCKERNEL_DUMP_BLOB_FILE_HEADER)(pnDump + tInfo.nSecondaryData);
+	if ((cbDump - sizeof(*ptBlobFile) < tInfo.nSecondaryData) ||
+		(KERNEL_DUMP_BLOB_SIGNATURE1 != ptBlobFile->nSignature1) ||
+		(KERNEL_DUMP_BLOB_SIGNATURE2 != ptBlobFile->nSignature2) ||
+		(ptBlobFile->nBuildNumber != tInfo.nBuildNumber))
+	{
+		(VOID)printf("  %s: the pages end at %llu, not at the secondary data\n",
+					 pszFixture,
+					 tInfo.nSecondaryData);
+		++nFailures;
+		goto lblCleanup;
+	}
+
+	// The data is between two other records.
+	hrResult = DUMPPARSE_EnumerateTags(hDump, &patTags, &nTags);
+	if (FAILED(hrResult))
+	{
+		(VOID)printf("  %s: listing failed (0x%08x)\n", pszFixture, (DWORD)hrResult);
+		++nFailures;
+		goto lblCleanup;
+	}
+	if ((3 != nTags) ||
+		!IsEqualGUID(&(patTags[1].tTag), &g_tVgaDumpGuid) ||
+		(cbData != patTags[1].cbData) ||
+		(cbDump - cbData < patTags[1].nOffset) ||
+		(0 != memcmp(pnDump + patTags[1].nOffset, pnData, cbData)) ||
+		(patTags[0].nOffset >= patTags[1].nOffset) ||
+		(patTags[1].nOffset >= patTags[2].nOffset))
+	{
+		(VOID)printf("  %s: the records were misread (%u of them)\n", pszFixture, nTags);
+		++nFailures;
+	}
+
+	hrResult = DUMPPARSE_ReadTagged(hDump, &g_tVgaDumpGuid, &pvRead, &cbRead32);
+	if (FAILED(hrResult))
+	{
+		(VOID)printf("  %s: reading failed (0x%08x)\n", pszFixture, (DWORD)hrResult);
+		++nFailures;
+	}
+	else if ((cbData != cbRead32) || (0 != memcmp(pvRead, pnData, cbData)))
+	{
+		(VOID)printf("  %s: read the wrong data\n", pszFixture);
+		++nFailures;
+	}
+
+	hrResult = DUMPPARSE_MapTagged(hDump, &g_tVgaDumpGuid, &pvMapped, &cbMapped);
+	if (FAILED(hrResult))
+	{
+		(VOID)printf("  %s: mapping failed (0x%08x)\n", pszFixture, (DWORD)hrResult);
+		++nFailures;
+	}
+	else if ((cbData != cbMapped) || ((0 == cbData) != (NULL == pvMapped)))
+	{
+		(VOID)printf("  %s: mapped the wrong size\n", pszFixture);
+		++nFailures;
+	}
+
+	hrResult = DUMPPARSE_ReadTagged(hDump, &g_tMissingTag, &pvRead, &cbRead32);
+	if (HRESULT_FROM_WIN32(ERROR_NOT_FOUND) != hrResult)
+	{
+		(VOID)printf("  %s: found a tag that isn't there (0x%08x)\n", pszFixture, (DWORD)hrResult);
+		++nFailures;
+	}
+
+	// The view outlives the dump.
+	DUMPPARSE_Close(hDump);
+	hDump = NULL;
+	if ((NULL != pvMapped) && (0 != memcmp(pvMapped, pnData, cbData)))
+	{
+		(VOID)printf("  %s: mapped the wrong data\n", pszFixture);
+		++nFailures;
+	}
+
+lblCleanup:
+	DUMPPARSE_UnmapTagged(pvMapped, cbMapped);
+	free(pvRead);
+	free(patTags);
+	DUMPPARSE_Close(hDump);
+
+	return nFailures;
+}
+
+/**
+ * Writes the start of a dump, cut off in the middle of its tagged data,
+ * and checks that the data isn't read past the end of the file.
+ *
+ * @returns DWORD (the number of failures)
+ */
+STATIC
+DWORD
+test_CheckTruncated(
+	_In_reads_(cbDump)	CONST BYTE *	pnDump,
+	_In_				DWORD			cbDump,
+	_In_				DWORD			cbData,
+	_In_				PCSTR			pszFixture
+)
+{
+	HRESULT	hrResult	= E_FAIL;
+	DWORD	nFailures	= 0;
+	DWORD	cbTruncated	= 0;
+	HDUMP	hDump		= NULL;
+	PVOID	pvRead		= NULL;
+	DWORD	cbRead		= 0;
+	LPCVOID	pvMapped	= NULL;
+	DWORD	cbMapped	= 0;
+
+	// Half of the data, and none of the record after it.
+	cbTruncated = cbDump - (sizeof(KERNEL_DUMP_BLOB_HEADER) + (4 * 0x10) + 0x200) - (cbData - (cbData / 2));
+	if (!test_WriteFile(TEST_DUMP_PATH, pnDump, cbTruncated))
+	{
+		(VOID)printf("  %s: couldn't write the truncated dump\n", pszFixture);
+		++nFailures;
+		goto lblCleanup;
+	}
+
+	hrResult = DUMPPARSE_Open(TEST_DUMP_WIDE_PATH, &hDump);
+	if (FAILED(hrResult))
+	{
+		(VOID)printf("  %s: truncated dump didn't open (0x%08x)\n", pszFixture, (DWORD)hrResult);
+		++nFailures;
+		goto lblCleanup;
+	}
+
+	hrResult = DUMPPARSE_ReadTagged(hDump, &g_tVgaDumpGuid, &pvRead, &cbRead);
+	if (HRESULT_FROM_WIN32(ERROR_HANDLE_EOF) != hrResult)
+	{
+		(VOID)printf("  %s: read truncated data (0x%08x)\n", pszFixture, (DWORD)hrResult);
+		++nFailures;
+	}
+
+	hrResult = DUMPPARSE_MapTagged(hDump, &g_tVgaDumpGuid, &pvMapped, &cbMapped);
+	if (HRESULT_FROM_WIN32(ERROR_HANDLE_EOF) != hrResult)
+	{
+		(VOID)printf("  %s: mapped truncated data (0x%08x)\n", pszFixture, (DWORD)hrResult);
+		++nFailures;
+	}
+
+lblCleanup:
+	DUMPPARSE_UnmapTagged(pvMapped, cbMapped);
+	free(pvRead);
+	DUMPPARSE_Close(hDump);
+
+	return nFailures;
+}
+
+/**
+ * Checks that files that aren't dumps, or aren't there,
+ * fail to open with every reader.
+ *
+ * @returns DWORD (the number of failures)
+ */
+STATIC
+DWORD
+test_CheckNotDumps(VOID)
+{
+	HRESULT	hrResult	= E_FAIL;
+	DWORD	nFailures	= 0;
+	DWORD	nReader		= 0;
+	HDUMP	hDump		= NULL;
+	BYTE	anJunk[KERNEL_DUMP_HEADER64_SIZE * 2];
+
+	FillMemory(anJunk, sizeof(anJunk), 0x5A);
+	if (!test_WriteFile(TEST_DUMP_PATH, anJunk, sizeof(anJunk)))
+	{
+		(VOID)printf("  junk: couldn't write the file\n");
+		++nFailures;
+		goto lblCleanup;
+	}
+
+	for (nReader = 0; nReader < ARRAYSIZE(g_aeReaders); ++nReader)
+	{
+		hrResult = DUMPPARSE_OpenWithReader(TEST_DUMP_WIDE_PATH, g_aeReaders[nReader], &hDump);
+		if (HRESULT_FROM_WIN32(ERROR_BAD_FORMAT) != hrResult)
+		{
+			(VOID)printf("  junk: the %ls reader opened it (0x%08x)\n",
+						 DUMPPARSE_GetReaderName(g_aeReaders[nReader]),
+						 (DWORD)hrResult);
+			++nFailures;
+			DUMPPARSE_Close(hDump);
+			hDump = NULL;
+		}
+	}
+
+	(VOID)remove(TEST_DUMP_PATH);
+	hrResult = DUMPPARSE_Open(TEST_DUMP_WIDE_PATH, &hDump);
+	if (HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND) != hrResult)
+	{
+		(VOID)printf("  missing: opened it (0x%08x)\n", (DWORD)hrResult);
+		++nFailures;
+		DUMPPARSE_Close(hDump);
+		hDump = NULL;
+	}
+
+lblCleanup:
+	return nFailures;
+}
+
+INT
+main(
+	_In_					INT		nArguments,
+	_In_reads_(nArguments)	PSTR *	ppszArguments
+)
+{
+	HRESULT				hrResult			= E_FAIL;
+	DWORD				nLayout				= 0;
+	DWORD				nSize				= 0;
+	DWORD				nReader				= 0;
+	DWORD				nByte				= 0;
+	DWORD				nChecks				= 0;
+	DWORD				nFailures			= 0;
+	DWORD				nLayoutFailures		= 0;
+	PCTEST_LAYOUT		ptLayout			= NULL;
+	DUMPPARSE_READER	eReader				= DUMPPARSE_READER_NATIVE;
+	PBYTE				pnData				= NULL;
+	DWORD				cbData				= 0;
+	PVOID				pvDump				= NULL;
+	DWORD				cbDump				= 0;
+	BOOL				bIndexed			= FALSE;
+	CHAR				szFixture[64]		= { 0 };
+
+	g_bVerbose = (2 == nArguments) && (0 == strcmp(ppszArguments[1], "-v"));
+
+	pnData = malloc(sizeof(VGA_DUMP));
+	if (NULL == pnData)
+	{
+		(VOID)printf("Oops. Ran out of memory.\n");
+		return EXIT_FAILURE;
+	}
+
+	for (nLayout = 0; nLayout < ARRAYSIZE(g_atLayouts); ++nLayout)
+	{
+		ptLayout = &(g_atLayouts[nLayout]);
+
+		nLayoutFailures = 0;
+		for (nSize = 0; nSize < ARRAYSIZE(g_acbData); ++nSize)
+		{
+			cbData = g_acbData[nSize];
+			g_nRandom = 0x9E3779B9 ^ ((nLayout << 8) | nSize);
+			for (nByte = 0; nByte < cbData; ++nByte)
+			{
+				pnData[nByte] = (BYTE)test_Random();
+			}
+
+			hrResult = DUMPSYNTH_Create(ptLayout->eLayout, &g_tVgaDumpGuid, pnData, cbData, &pvDump, &cbDump);
+			if (FAILED(hrResult))
+			{
+				(VOID)printf("  %ls %u bytes: synthesis failed (0x%08x)\n",
+							 DUMPSYNTH_GetLayoutName(ptLayout->eLayout),
+							 cbData,
+							 (DWORD)hrResult);
+				++nLayoutFailures;
+				continue;
+			}
+
+			if (!test_WriteFile(TEST_DUMP_PATH, pvDump, cbDump))
+			{
+				(VOID)printf("Couldn't write '%s'.\n", TEST_DUMP_PATH);
+				free(pvDump);
+				free(pnData);
+				return EXIT_FAILURE;
+			}
+
+			// The dump changed, so its index is stale at first,
+			// and up to date once the indexed reader opened it.
+			bIndexed = FALSE;
+			for (nReader = 0; nReader <= ARRAYSIZE(g_aeReaders); ++nReader)
+			{
+				eReader = g_aeReaders[min(nReader, ARRAYSIZE(g_aeReaders) - 1)];
+				(VOID)snprintf(szFixture,
+							   sizeof(szFixture),
+							   "%ls %ls %u bytes",
+							   DUMPSYNTH_GetLayoutName(ptLayout->eLayout),
+							   DUMPPARSE_GetReaderName(eReader),
+							   cbData);
+
+				++nChecks;
+				nLayoutFailures += test_CheckDump(ptLayout,
+												  eReader,
+												  pvDump,
+												  cbDump,
+												  pnData,
+												  cbData,
+												  bIndexed,
+												  szFixture);
+
+				if (DUMPPARSE_READER_INDEXED == eReader)
+				{
+					if (!test_FileExists(TEST_INDEX_PATH))
+					{
+						(VOID)printf("  %s: no index was written\n", szFixture);
+						++nLayoutFailures;
+					}
+					bIndexed = TRUE;
+				}
+			}
+
+			if (1 < cbData)
+			{
+				++nChecks;
+				nLayoutFailures += test_CheckTruncated(pvDump, cbDump, cbData, szFixture);
+			}
+
+			free(pvDump);
+			pvDump = NULL;
+		}
+
+		(VOID)printf("%ls: %u failures\n", DUMPSYNTH_GetLayoutName(ptLayout->eLayout), nLayoutFailures);
+		nFailures += nLayoutFailures;
+	}
+
+	++nChecks;
+	nFailures += test_CheckNotDumps();
+
+#ifndef _WIN32
+	// Without dbgeng, its reader fails rather than the program.
+	{
+		HDUMP	hDump	= NULL;
+
+		++nChecks;
+		hrResult = DUMPPARSE_OpenWithReader(TEST_DUMP_WIDE_PATH, DUMPPARSE_READER_DEBUGGER, &hDump);
+		if (HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED) != hrResult)
+		{
+			(VOID)printf("  dbgeng: opened a dump without dbgeng (0x%08x)\n", (DWORD)hrResult);
+			++nFailures;
+			DUMPPARSE_Close(hDump);
+		}
+	}
+#endif // !_WIN32
+
+	(VOID)remove(TEST_DUMP_PATH);
+	(VOID)remove(TEST_INDEX_PATH);
+	free(pnData);
+
+	(VOID)printf("%u dumps checked, %u failures.\n", nChecks, nFailures);
+
+	return (0 == nFailures) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,974 @@
+/**
+ * @file VgaDecodeTest.c
+ * @author biko
+ * @date 2026-10-17
+ *
+ * Checks every decoder implementation the CPU can run against
+ * the per-pixel reference, bit for bit, on synthetic VGA_DUMPs
+ * and on other geometries. Text mode captures are parsed and drawn
+ * in every way, and checked against a per-pixel reference as well.
+ * It only needs VgaDecode and VgaCapture, so it builds on Linux
+ * as well, with the headers in Compat standing in for the SDK.
+ * From the root of the repository:
+ *
+ *     gcc -O2 -fno-strict-aliasing -mavx2 -mxsave -ITests/Compat -IShared \
+ *         Tests/VgaDecodeTest.c DrunkenIronman/VgaDecode.c \
+ *         DrunkenIronman/VgaCapture.c -o VgaDecodeTest
+ *     ./VgaDecodeTest
+ *
+ * Built that way, all of VgaDecode may use AVX2, so the machine
+ * has to support it. Exits with 0 only if every check passed.
+ */
+
+/** Headers *************************************************************/
+#include <Windows.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <Drink.h>
+
+#include "../DrunkenIronman/VgaCapture.h"
+#include "../DrunkenIronman/VgaDecode.h"
+
+
+/** Constants ***********************************************************/
+
+/**
+ * Number of random fixtures of each kind and geometry.
+ */
+#define TEST_SEEDS (4)
+
+/**
+ * Extra bytes at the end of each output row, for the checks
+ * with padded rows. Never written by the decoders.
+ */
+#define TEST_ROW_PADDING (12)
+
+/**
+ * Filled into the outputs before decoding, so that
+ * pixels that aren't written stand out.
+ */
+#define TEST_POISON (0xCD)
+
+/**
+ * Number of rows of characters in the synthetic text screens.
+ */
+#define TEST_TEXT_ROWS (5)
+
+/**
+ * Attribute Mode Control register - Line Graphics Enable.
+ * It only matters to 9-dot text, where it extends the box drawing
+ * characters into the 9th column. Text is always drawn 8 pixels
+ * per character, so it must not change the output.
+ */
+#define TEST_ATTRIBUTE_MODE_LGE (0x04)
+
+
+/** Enums ***************************************************************/
+
+/**
+ * The kinds of synthetic screens.
+ */
+typedef enum _TEST_KIND
+{
+	// Every pixel the same color.
+	TEST_KIND_SOLID = 0,
+
+	// Random bytes in every plane.
+	TEST_KIND_NOISE,
+
+	// A solid background with short random runs on some rows,
+	// like the text of a BSoD.
+	TEST_KIND_BSOD,
+
+	// Runs of uniform bytes of random lengths and colors,
+	// so that they start and end everywhere in a group.
+	TEST_KIND_RUNS,
+
+	// Must be last:
+	TEST_KINDS
+} TEST_KIND, *PTEST_KIND;
+
+
+/** Typedefs ************************************************************/
+
+/**
+ * A geometry to test.
+ */
+typedef struct _TEST_GEOMETRY
+{
+	DWORD	nWidth;
+	DWORD	nHeight;
+	DWORD	cbStride;
+} TEST_GEOMETRY, *PTEST_GEOMETRY;
+typedef CONST TEST_GEOMETRY *PCTEST_GEOMETRY;
+
+/**
+ * A synthetic text mode capture, laid out
+ * the way the driver saves it.
+ */
+typedef struct _TEST_TEXT_CAPTURE
+{
+	VGA_CAPTURE_HEADER	tHeader;
+	PALETTE_ENTRY		atPaletteEntries[VGA_DAC_PALETTE_ENTRIES];
+
+	// The text, followed by the font.
+	BYTE				anContents[(VGA_TEXT_MAX_COLUMNS * VGA_TEXT_CELL_BYTES * TEST_TEXT_ROWS) +
+								   (VGA_FONT_GLYPHS * VGA_FONT_GLYPH_MAX_HEIGHT)];
+} TEST_TEXT_CAPTURE, *PTEST_TEXT_CAPTURE;
+typedef CONST TEST_TEXT_CAPTURE *PCTEST_TEXT_CAPTURE;
+
+
+/** Globals *************************************************************/
+
+/**
+ * The geometries to test. The first is that of a VGA_DUMP,
+ * and the first two have specialized decoders.
+ */
+STATIC CONST TEST_GEOMETRY g_atGeometries[] = {
+	{ SCREEN_WIDTH_PIXELS, SCREEN_HEIGHT_PIXELS, SCREEN_WIDTH_PIXELS / PIXELS_IN_BYTE },
+	{ 800, 600, 800 / PIXELS_IN_BYTE },
+	{ 1024, 64, 1024 / PIXELS_IN_BYTE },
+	{ 632, 40, 80 },
+	{ 100, 37, 16 },
+	{ 13, 5, 2 },
+	{ 1, 1, 1 },
+};
+
+/**
+ * The names of the kinds of synthetic screens.
+ */
+STATIC PCSTR CONST g_apszKindNames[TEST_KINDS] = {
+	"solid",
+	"noise",
+	"bsod",
+	"runs",
+};
+
+/**
+ * The widths of the synthetic text screens, in characters.
+ */
+STATIC CONST DWORD g_anTextColumns[] = { 40, 80, VGA_TEXT_MAX_COLUMNS, 41, 3, 1 };
+
+/**
+ * The heights of the characters in the synthetic text screens.
+ */
+STATIC CONST DWORD g_anTextCharHeights[] = { 8, 14, 16, VGA_FONT_GLYPH_MAX_HEIGHT, 9, 1 };
+
+/**
+ * The Attribute Mode Control settings of the synthetic text screens:
+ * blinking on and off, each with and without the 9-dot
+ * line graphics and the P54S color select.
+ */
+STATIC CONST BYTE g_anTextAttributeModes[] = {
+	0,
+	VGA_ATTRIBUTE_MODE_BLINK,
+	TEST_ATTRIBUTE_MODE_LGE,
+	TEST_ATTRIBUTE_MODE_LGE | VGA_ATTRIBUTE_MODE_BLINK,
+	VGA_ATTRIBUTE_MODE_P54S,
+	VGA_ATTRIBUTE_MODE_P54S | VGA_ATTRIBUTE_MODE_BLINK,
+	VGA_ATTRIBUTE_MODE_P54S | TEST_ATTRIBUTE_MODE_LGE,
+	VGA_ATTRIBUTE_MODE_P54S | TEST_ATTRIBUTE_MODE_LGE | VGA_ATTRIBUTE_MODE_BLINK,
+};
+
+/**
+ * The synthetic planes, big enough for any geometry.
+ */
+STATIC BYTE g_aanPlanes[VGA_PLANES][VGA_PLANE_MAX_BYTES];
+
+/**
+ * Holds the mode 12h screens, which are laid out
+ * the way the driver first saved them.
+ */
+STATIC VGA_DUMP g_tDump;
+
+/**
+ * Holds the text mode screens.
+ */
+STATIC TEST_TEXT_CAPTURE g_tTextCapture;
+
+/**
+ * State of the random number generator.
+ */
+STATIC DWORD g_nRandom = 0;
+
+
+/** Functions ***********************************************************/
+
+STATIC
+DWORD
+test_Random(VOID)
+{
+	// xorshift32, which never leaves 0 once there.
+	g_nRandom ^= g_nRandom << 13;
+	g_nRandom ^= g_nRandom >> 17;
+	g_nRandom ^= g_nRandom << 5;
+
+	return g_nRandom;
+}
+
+STATIC
+VOID
+test_FillColor(
+	_In_reads_(VGA_PLANES)	PBYTE *	ppnPlanes,
+	_In_					DWORD	nOffset,
+	_In_					DWORD	cbLength,
+	_In_					BYTE	nColor
+)
+{
+	DWORD	nPlane	= 0;
+
+	for (nPlane = 0; nPlane < VGA_PLANES; ++nPlane)
+	{
+		FillMemory(ppnPlanes[nPlane] + nOffset,
+				   cbLength,
+				   (0 != (nColor & (1 << nPlane))) ? MAXBYTE : 0);
+	}
+}
+
+STATIC
+VOID
+test_FillRandom(
+	_In_reads_(VGA_PLANES)	PBYTE *	ppnPlanes,
+	_In_					DWORD	nOffset,
+	_In_					DWORD	cbLength
+)
+{
+	DWORD	nPlane	= 0;
+	DWORD	nByte	= 0;
+
+	for (nPlane = 0; nPlane < VGA_PLANES; ++nPlane)
+	{
+		for (nByte = 0; nByte < cbLength; ++nByte)
+		{
+			ppnPlanes[nPlane][nOffset + nByte] = (BYTE)test_Random();
+		}
+	}
+}
+
+STATIC
+VOID
+test_Generate(
+	_In_					TEST_KIND	eKind,
+	_In_					DWORD		cbPlane,
+	_In_reads_(VGA_PLANES)	PBYTE *		ppnPlanes
+)
+{
+	BYTE	nBackground	= (BYTE)(test_Random() % VGA_COLORS);
+	DWORD	nOffset		= 0;
+	DWORD	cbRun		= 0;
+
+	test_FillColor(ppnPlanes, 0, cbPlane, nBackground);
+
+	switch (eKind)
+	{
+	case TEST_KIND_SOLID:
+		break;
+
+	case TEST_KIND_NOISE:
+		test_FillRandom(ppnPlanes, 0, cbPlane);
+		break;
+
+	case TEST_KIND_BSOD:
+		for (nOffset = 0; nOffset < cbPlane; nOffset += cbRun)
+		{
+			// min evaluates its arguments twice.
+			cbRun = 1 + (test_Random() % 64);
+			cbRun = min(cbRun, cbPlane - nOffset);
+			if (0 == test_Random() % 4)
+			{
+				test_FillRandom(ppnPlanes, nOffset, cbRun);
+			}
+		}
+		break;
+
+	case TEST_KIND_RUNS:
+		for (nOffset = 0; nOffset < cbPlane; nOffset += cbRun)
+		{
+			// min evaluates its arguments twice.
+			cbRun = 1 + (test_Random() % 40);
+			cbRun = min(cbRun, cbPlane - nOffset);
+			test_FillColor(ppnPlanes, nOffset, cbRun, (BYTE)(test_Random() % VGA_COLORS));
+		}
+		break;
+
+	default:
+		break;
+	}
+}
+
+STATIC
+VOID
+test_FindContent(
+	_In_	CONST BYTE *	pnPixels,
+	_In_	DWORD			nWidth,
+	_In_	DWORD			nHeight,
+	_Out_	PRECT			ptContent
+)
+{
+	RECT	tContent	= { 0 };
+	DWORD	nRow		= 0;
+	DWORD	nColumn		= 0;
+
+	for (nRow = 0; nRow < nHeight; ++nRow)
+	{
+		for (nColumn = 0; nColumn < nWidth; ++nColumn)
+		{
+			if (pnPixels[(nRow * nWidth) + nColumn] == pnPixels[0])
+			{
+				continue;
+			}
+
+			if (tContent.bottom <= tContent.top)
+			{
+				tContent.left = (LONG)nColumn;
+				tContent.top = (LONG)nRow;
+				tContent.right = (LONG)nColumn + 1;
+			}
+			else
+			{
+				tContent.left = min(tContent.left, (LONG)nColumn);
+				tContent.right = max(tContent.right, (LONG)nColumn + 1);
+			}
+			tContent.bottom = (LONG)nRow + 1;
+		}
+	}
+
+	*ptContent = tContent;
+}
+
+/**
+ * Decodes a screen into packed pixels with the selected implementation,
+ * and compares them with the reference. The nibbles past the width
+ * must be clear.
+ *
+ * @returns DWORD (the number of mismatches)
+ */
+STATIC
+DWORD
+test_CheckNibbles(
+	_In_reads_(VGA_PLANES)	CONST BYTE * CONST *	ppnPlanes,
+	_In_					PCTEST_GEOMETRY			ptGeometry,
+	_In_					CONST BYTE *			pnExpected,
+	_In_					DWORD					cbPixelStride,
+	_In_					PCSTR					pszFixture
+)
+{
+	DWORD	nWidth		= ptGeometry->nWidth;
+	DWORD	nHeight		= ptGeometry->nHeight;
+	DWORD	cbRow		= ((nWidth + PIXELS_IN_BYTE - 1) / PIXELS_IN_BYTE) * sizeof(DWORD);
+	DWORD	nMismatches	= 0;
+	PBYTE	pnPixels	= NULL;
+	DWORD	nRow		= 0;
+	DWORD	nPixel		= 0;
+	BYTE	nExpected	= 0;
+
+	pnPixels = malloc(cbPixelStride * nHeight);
+	if (NULL == pnPixels)
+	{
+		(VOID)printf("Oops. Ran out of memory.\n");
+		++nMismatches;
+		goto lblCleanup;
+	}
+
+	FillMemory(pnPixels, cbPixelStride * nHeight, TEST_POISON);
+	VGADECODE_DecodeImageToNibbles(ppnPlanes, ptGeometry->cbStride, nWidth, nHeight, pnPixels, cbPixelStride);
+
+	for (nRow = 0; nRow < nHeight; ++nRow)
+	{
+		for (nPixel = 0; nPixel < cbRow * 2; nPixel += 2)
+		{
+			nExpected = 0;
+			if (nPixel < nWidth)
+			{
+				nExpected |= pnExpected[(nRow * nWidth) + nPixel] << 4;
+			}
+			if (nPixel + 1 < nWidth)
+			{
+				nExpected |= pnExpected[(nRow * nWidth) + nPixel + 1];
+			}
+
+			if (pnPixels[(nRow * cbPixelStride) + (nPixel / 2)] != nExpected)
+			{
+				(VOID)printf("  %s: packed pixels differ on row %u with a stride of %u\n",
+							 pszFixture,
+							 nRow,
+							 cbPixelStride);
+				++nMismatches;
+				goto lblCleanup;
+			}
+		}
+	}
+
+lblCleanup:
+	free(pnPixels);
+
+	return nMismatches;
+}
+
+/**
+ * Decodes a screen with the selected implementation in every way,
+ * and compares the results with the reference.
+ *
+ * @returns DWORD (the number of mismatches)
+ */
+STATIC
+DWORD
+test_CheckScreen(
+	_In_reads_(VGA_PLANES)	CONST BYTE * CONST *	ppnPlanes,
+	_In_					PCTEST_GEOMETRY			ptGeometry,
+	_In_reads_(VGA_COLORS)	CONST RGBQUAD *			ptPalette,
+	_In_					PCSTR					pszFixture
+)
+{
+	DWORD		nWidth			= ptGeometry->nWidth;
+	DWORD		nHeight			= ptGeometry->nHeight;
+	DWORD		cbStride		= ptGeometry->cbStride;
+	DWORD		nPixels			= nWidth * nHeight;
+	DWORD		cbPaddedRow		= nWidth + TEST_ROW_PADDING;
+	DWORD		cbNibbleRow		= ((nWidth + PIXELS_IN_BYTE - 1) / PIXELS_IN_BYTE) * sizeof(DWORD);
+	DWORD		cbSpan			= cbStride * nHeight;
+	DWORD		nMismatches		= 0;
+	PBYTE		pnExpected		= NULL;
+	PBYTE		pnDecoded		= NULL;
+	RGBQUAD *	ptDecoded		= NULL;
+	PBYTE		pnSpan			= NULL;
+	PBYTE		pnSpanExpected	= NULL;
+	RECT		tExpected		= { 0 };
+	RECT		tContent		= { 0 };
+	DWORD		nRow			= 0;
+	DWORD		nPixel			= 0;
+
+	pnExpected = malloc(nPixels);
+	pnDecoded = malloc(cbPaddedRow * nHeight);
+	ptDecoded = malloc(nPixels * sizeof(ptDecoded[0]));
+	pnSpan = malloc(cbSpan * PIXELS_IN_BYTE);
+	pnSpanExpected = malloc(cbSpan * PIXELS_IN_BYTE);
+	if ((NULL == pnExpected) ||
+		(NULL == pnDecoded) ||
+		(NULL == ptDecoded) ||
+		(NULL == pnSpan) ||
+		(NULL == pnSpanExpected))
+	{
+		(VOID)printf("Oops. Ran out of memory.\n");
+		++nMismatches;
+		goto lblCleanup;
+	}
+
+	VGADECODE_DecodeImageReference(ppnPlanes, cbStride, nWidth, nHeight, pnExpected, nWidth);
+	test_FindContent(pnExpected, nWidth, nHeight, &tExpected);
+
+	// Unpadded rows, which may take a specialized decoder.
+	FillMemory(pnDecoded, nPixels, TEST_POISON);
+	VGADECODE_DecodeImage(ppnPlanes, cbStride, nWidth, nHeight, pnDecoded, nWidth, &tContent);
+	if (0 != memcmp(pnDecoded, pnExpected, nPixels))
+	{
+		(VOID)printf("  %s: indexed pixels differ\n", pszFixture);
+		++nMismatches;
+	}
+	if (0 != memcmp(&tContent, &tExpected, sizeof(tContent)))
+	{
+		(VOID)printf("  %s: content is (%d,%d)-(%d,%d) rather than (%d,%d)-(%d,%d)\n",
+					 pszFixture,
+					 tContent.left,
+					 tContent.top,
+					 tContent.right,
+					 tContent.bottom,
+					 tExpected.left,
+					 tExpected.top,
+					 tExpected.right,
+					 tExpected.bottom);
+		++nMismatches;
+	}
+
+	// Padded rows, which always take the generic one.
+	FillMemory(pnDecoded, cbPaddedRow * nHeight, TEST_POISON);
+	VGADECODE_DecodeImage(ppnPlanes, cbStride, nWidth, nHeight, pnDecoded, cbPaddedRow, NULL);
+	for (nRow = 0; nRow < nHeight; ++nRow)
+	{
+		if (0 != memcmp(pnDecoded + (nRow * cbPaddedRow), pnExpected + (nRow * nWidth), nWidth))
+		{
+			(VOID)printf("  %s: indexed pixels differ on padded row %u\n", pszFixture, nRow);
+			++nMismatches;
+			break;
+		}
+	}
+
+	FillMemory(ptDecoded, nPixels * sizeof(ptDecoded[0]), TEST_POISON);
+	VGADECODE_DecodeImageToColor(ppnPlanes, cbStride, nWidth, nHeight, ptPalette, ptDecoded, &tContent);
+	for (nPixel = 0; nPixel < nPixels; ++nPixel)
+	{
+		if (0 != memcmp(&(ptDecoded[nPixel]), &(ptPalette[pnExpected[nPixel]]), sizeof(ptDecoded[0])))
+		{
+			(VOID)printf("  %s: colored pixels differ at %u\n", pszFixture, nPixel);
+			++nMismatches;
+			break;
+		}
+	}
+	if (0 != memcmp(&tContent, &tExpected, sizeof(tContent)))
+	{
+		(VOID)printf("  %s: colored content differs\n", pszFixture);
+		++nMismatches;
+	}
+
+	// Both the exact stride, which may be decoded as one span,
+	// and a padded one.
+	nMismatches += test_CheckNibbles(ppnPlanes, ptGeometry, pnExpected, cbNibbleRow, pszFixture);
+	nMismatches += test_CheckNibbles(ppnPlanes, ptGeometry, pnExpected, cbNibbleRow + TEST_ROW_PADDING, pszFixture);
+
+	// The planes as one long span, padding and all.
+	VGADECODE_DecodeImageReference(ppnPlanes,
+								   cbSpan,
+								   cbSpan * PIXELS_IN_BYTE,
+								   1,
+								   pnSpanExpected,
+								   cbSpan * PIXELS_IN_BYTE);
+	VGADECODE_DecodeSpan(ppnPlanes, cbSpan, pnSpan);
+	if (0 != memcmp(pnSpan, pnSpanExpected, cbSpan * PIXELS_IN_BYTE))
+	{
+		(VOID)printf("  %s: span differs\n", pszFixture);
+		++nMismatches;
+	}
+
+lblCleanup:
+	free(pnSpanExpected);
+	free(pnSpan);
+	free(ptDecoded);
+	free(pnDecoded);
+	free(pnExpected);
+
+	return nMismatches;
+}
+
+/**
+ * Stands in for the Debug module, which only runs on Windows.
+ * The parser's reasons for rejecting a capture are left out,
+ * since the checks report their own.
+ */
+VOID
+DEBUG_Progress(
+	_In_	PCSTR	pszFunction,
+	_In_	PCSTR	pszFormat,
+	...
+)
+{
+	UNREFERENCED_PARAMETER(pszFunction);
+	UNREFERENCED_PARAMETER(pszFormat);
+}
+
+/**
+ * Fills a text mode capture with random characters, attributes,
+ * glyphs and colors, and with the given geometry and
+ * Attribute Mode Control register.
+ *
+ * @returns DWORD (the size of the capture, in bytes)
+ */
+STATIC
+DWORD
+test_GenerateText(
+	_Out_	PTEST_TEXT_CAPTURE	ptCapture,
+	_In_	DWORD				nColumns,
+	_In_	DWORD				nCharHeight,
+	_In_	BYTE				fAttributeMode
+)
+{
+	PVGA_CAPTURE_HEADER	ptHeader	= &(ptCapture->tHeader);
+	DWORD				cbStride	= nColumns * VGA_TEXT_CELL_BYTES;
+	DWORD				cbContents	= (cbStride * TEST_TEXT_ROWS) + (VGA_FONT_GLYPHS * nCharHeight);
+	DWORD				nIndex		= 0;
+
+	ZeroMemory(ptHeader, sizeof(*ptHeader));
+	ptHeader->nMagic = VGA_CAPTURE_MAGIC;
+	ptHeader->nVersion = VGA_CAPTURE_VERSION;
+	ptHeader->cbHeader = sizeof(*ptHeader);
+	ptHeader->nWidth = nColumns;
+	ptHeader->nHeight = TEST_TEXT_ROWS;
+	ptHeader->cbStride = cbStride;
+	ptHeader->nPlanes = VGA_PLANES;
+	ptHeader->nBitsPerPixel = VGA_PLANES;
+	ptHeader->nPaletteEntries = ARRAYSIZE(ptCapture->atPaletteEntries);
+	ptHeader->eMode = VGA_CAPTURE_MODE_TEXT;
+	ptHeader->nCharHeight = nCharHeight;
+	for (nIndex = 0; nIndex < ARRAYSIZE(ptHeader->anAttributePalette); ++nIndex)
+	{
+		ptHeader->anAttributePalette[nIndex] = (UCHAR)(test_Random() % 0x40);
+	}
+	ptHeader->fAttributeMode = fAttributeMode;
+	ptHeader->fColorSelect = (UCHAR)(test_Random() % 0x10);
+
+	for (nIndex = 0; nIndex < ARRAYSIZE(ptCapture->atPaletteEntries); ++nIndex)
+	{
+		ptCapture->atPaletteEntries[nIndex].nRed = (UCHAR)(test_Random() % 0x40);
+		ptCapture->atPaletteEntries[nIndex].nGreen = (UCHAR)(test_Random() % 0x40);
+		ptCapture->atPaletteEntries[nIndex].nBlue = (UCHAR)(test_Random() % 0x40);
+	}
+
+	// The cells, and then every glyph.
+	for (nIndex = 0; nIndex < cbContents; ++nIndex)
+	{
+		ptCapture->anContents[nIndex] = (BYTE)test_Random();
+	}
+
+	ptHeader->nChecksum = VGACAPTURE_Checksum(ptCapture->atPaletteEntries,
+											  sizeof(ptCapture->atPaletteEntries) + cbContents);
+
+	return sizeof(*ptHeader) + sizeof(ptCapture->atPaletteEntries) + cbContents;
+}
+
+/**
+ * Reference for drawing text: finds the value of a single pixel
+ * of a text mode capture, straight from its header and contents.
+ *
+ * @returns BYTE
+ */
+STATIC
+BYTE
+test_GetTextPixel(
+	_In_	PCTEST_TEXT_CAPTURE	ptCapture,
+	_In_	DWORD				nX,
+	_In_	DWORD				nY
+)
+{
+	PCVGA_CAPTURE_HEADER	ptHeader	= &(ptCapture->tHeader);
+	DWORD					nCell		= ((nY / ptHeader->nCharHeight) * ptHeader->nWidth) + (nX / PIXELS_IN_BYTE);
+	CONST BYTE *			pnFont		= ptCapture->anContents + (ptHeader->cbStride * ptHeader->nHeight);
+	BYTE					nCharacter	= ptCapture->anContents[nCell * VGA_TEXT_CELL_BYTES];
+	BYTE					nAttribute	= ptCapture->anContents[(nCell * VGA_TEXT_CELL_BYTES) + 1];
+	BYTE					nGlyphRow	= pnFont[(nCharacter * ptHeader->nCharHeight) + (nY % ptHeader->nCharHeight)];
+
+	if (0 != ((nGlyphRow >> (7 - (nX % PIXELS_IN_BYTE))) & 1))
+	{
+		return nAttribute & 0x0F;
+	}
+
+	// With blinking enabled, the top bit of the attribute
+	// is the blink bit rather than the background's intensity.
+	if (0 != (ptHeader->fAttributeMode & VGA_ATTRIBUTE_MODE_BLINK))
+	{
+		return (nAttribute >> 4) & 0x07;
+	}
+
+	return nAttribute >> 4;
+}
+
+/**
+ * Reference for the Attribute Controller: finds the DAC entry
+ * a pixel value is displayed with, straight from a capture's header.
+ *
+ * @returns DWORD
+ */
+STATIC
+DWORD
+test_GetDacIndex(
+	_In_	PCVGA_CAPTURE_HEADER	ptHeader,
+	_In_	BYTE					nColor
+)
+{
+	DWORD	nPaletteBits	= ptHeader->anAttributePalette[nColor];
+	DWORD	nSelectBits		= ptHeader->fColorSelect;
+	DWORD	nIndex			= nPaletteBits & 0x0F;
+
+	// Bits 4-5.
+	if (0 != (ptHeader->fAttributeMode & VGA_ATTRIBUTE_MODE_P54S))
+	{
+		nIndex |= (nSelectBits & 0x03) << 4;
+	}
+	else
+	{
+		nIndex |= ((nPaletteBits >> 4) & 0x03) << 4;
+	}
+
+	// Bits 6-7.
+	nIndex |= ((nSelectBits >> 2) & 0x03) << 6;
+
+	return nIndex;
+}
+
+STATIC
+RGBQUAD
+test_GetDacColor(
+	_In_	PCPALETTE_ENTRY	ptEntry
+)
+{
+	RGBQUAD	tColor	= { 0 };
+
+	tColor.rgbRed = ptEntry->nRed;
+	tColor.rgbGreen = ptEntry->nGreen;
+	tColor.rgbBlue = ptEntry->nBlue;
+
+	return tColor;
+}
+
+/**
+ * Parses a text mode capture, draws it in every way,
+ * and compares the results with the reference.
+ *
+ * @returns DWORD (the number of mismatches)
+ */
+STATIC
+DWORD
+test_CheckText(
+	_In_	PCTEST_TEXT_CAPTURE	ptCapture,
+	_In_	DWORD				cbCapture,
+	_In_	PCSTR				pszFixture
+)
+{
+	HRESULT				hrResult				= E_FAIL;
+	DWORD				nMismatches				= 0;
+	VGA_CAPTURE_VIEW	tView					= { 0 };
+	DWORD				nWidth					= ptCapture->tHeader.nWidth * PIXELS_IN_BYTE;
+	DWORD				nHeight					= ptCapture->tHeader.nHeight * ptCapture->tHeader.nCharHeight;
+	DWORD				nPixels					= nWidth * nHeight;
+	DWORD				cbPaddedRow				= nWidth + TEST_ROW_PADDING;
+	DWORD				cbNibbleRow				= nWidth / 2;
+	DWORD				cbPaddedNibbleRow		= cbNibbleRow + TEST_ROW_PADDING;
+	PBYTE				pnExpected				= NULL;
+	PBYTE				pnRendered				= NULL;
+	RGBQUAD *			ptRendered				= NULL;
+	RGBQUAD				atPalette[VGA_COLORS]	= { { 0 } };
+	RGBQUAD				tExpected				= { 0 };
+	DWORD				nRow					= 0;
+	DWORD				nPixel					= 0;
+	DWORD				nColor					= 0;
+	BYTE				nExpected				= 0;
+
+	pnExpected = malloc(nPixels);
+	pnRendered = malloc(cbPaddedRow * nHeight);
+	ptRendered = malloc(nPixels * sizeof(ptRendered[0]));
+	if ((NULL == pnExpected) ||
+		(NULL == pnRendered) ||
+		(NULL == ptRendered))
+	{
+		(VOID)printf("Oops. Ran out of memory.\n");
+		++nMismatches;
+		goto lblCleanup;
+	}
+
+	hrResult = VGACAPTURE_Parse(ptCapture, cbCapture, &tView);
+	if (FAILED(hrResult))
+	{
+		(VOID)printf("  %s: rejected by the parser (0x%08x)\n", pszFixture, (DWORD)hrResult);
+		++nMismatches;
+		goto lblCleanup;
+	}
+	if ((VGA_CAPTURE_MODE_TEXT != tView.eMode) ||
+		(nWidth != tView.nWidth) ||
+		(nHeight != tView.nHeight))
+	{
+		(VOID)printf("  %s: parsed as %ux%u mode %u\n",
+					 pszFixture,
+					 tView.nWidth,
+					 tView.nHeight,
+					 (DWORD)tView.eMode);
+		++nMismatches;
+		goto lblCleanup;
+	}
+
+	for (nRow = 0; nRow < nHeight; ++nRow)
+	{
+		for (nPixel = 0; nPixel < nWidth; ++nPixel)
+		{
+			pnExpected[(nRow * nWidth) + nPixel] = test_GetTextPixel(ptCapture, nPixel, nRow);
+		}
+	}
+
+	// Indexed pixels, in padded rows. The padding must be left alone.
+	FillMemory(pnRendered, cbPaddedRow * nHeight, TEST_POISON);
+	VGADECODE_RenderText(&(tView.tText), pnRendered, cbPaddedRow);
+	for (nRow = 0; nRow < nHeight; ++nRow)
+	{
+		if (0 != memcmp(pnRendered + (nRow * cbPaddedRow), pnExpected + (nRow * nWidth), nWidth))
+		{
+			(VOID)printf("  %s: indexed pixels differ on row %u\n", pszFixture, nRow);
+			++nMismatches;
+			break;
+		}
+		for (nPixel = nWidth; nPixel < cbPaddedRow; ++nPixel)
+		{
+			if (TEST_POISON != pnRendered[(nRow * cbPaddedRow) + nPixel])
+			{
+				(VOID)printf("  %s: padding overwritten on row %u\n", pszFixture, nRow);
+				++nMismatches;
+				break;
+			}
+		}
+	}
+
+	// Packed pixels, in exact rows and then in padded ones.
+	FillMemory(pnRendered, cbPaddedNibbleRow * nHeight, TEST_POISON);
+	VGADECODE_RenderTextToNibbles(&(tView.tText), pnRendered, cbNibbleRow);
+	for (nPixel = 0; nPixel < nPixels; nPixel += 2)
+	{
+		nExpected = (BYTE)((pnExpected[nPixel] << 4) | pnExpected[nPixel + 1]);
+		if (pnRendered[nPixel / 2] != nExpected)
+		{
+			(VOID)printf("  %s: packed pixels differ at %u\n", pszFixture, nPixel);
+			++nMismatches;
+			break;
+		}
+	}
+
+	FillMemory(pnRendered, cbPaddedNibbleRow * nHeight, TEST_POISON);
+	VGADECODE_RenderTextToNibbles(&(tView.tText), pnRendered, cbPaddedNibbleRow);
+	for (nRow = 0; nRow < nHeight; ++nRow)
+	{
+		for (nPixel = 0; nPixel < nWidth; nPixel += 2)
+		{
+			nExpected = (BYTE)((pnExpected[(nRow * nWidth) + nPixel] << 4) | pnExpected[(nRow * nWidth) + nPixel + 1]);
+			if (pnRendered[(nRow * cbPaddedNibbleRow) + (nPixel / 2)] != nExpected)
+			{
+				(VOID)printf("  %s: packed pixels differ on padded row %u\n", pszFixture, nRow);
+				++nMismatches;
+				goto lblCleanup;
+			}
+		}
+	}
+
+	// True color, through the palette the parser worked out,
+	// against the colors the reference Attribute Controller picks.
+	for (nColor = 0; nColor < VGA_COLORS; ++nColor)
+	{
+		atPalette[nColor] = test_GetDacColor(&(tView.ptPaletteEntries[tView.anColorIndices[nColor]]));
+	}
+
+	FillMemory(ptRendered, nPixels * sizeof(ptRendered[0]), TEST_POISON);
+	VGADECODE_RenderTextToColor(&(tView.tText), atPalette, ptRendered);
+	for (nPixel = 0; nPixel < nPixels; ++nPixel)
+	{
+		tExpected = test_GetDacColor(&(ptCapture->atPaletteEntries[test_GetDacIndex(&(ptCapture->tHeader), pnExpected[nPixel])]));
+		if (0 != memcmp(&(ptRendered[nPixel]), &tExpected, sizeof(tExpected)))
+		{
+			(VOID)printf("  %s: colored pixels differ at %u\n", pszFixture, nPixel);
+			++nMismatches;
+			break;
+		}
+	}
+
+lblCleanup:
+	free(ptRendered);
+	free(pnRendered);
+	free(pnExpected);
+
+	return nMismatches;
+}
+
+INT
+main(VOID)
+{
+	HRESULT			hrResult					= E_FAIL;
+	DWORD			nBackend					= 0;
+	DWORD			nGeometry					= 0;
+	DWORD			nKind						= 0;
+	DWORD			nSeed						= 0;
+	DWORD			nPlane						= 0;
+	DWORD			nColor						= 0;
+	DWORD			nChecks						= 0;
+	DWORD			nMismatches					= 0;
+	DWORD			nBackendMismatches			= 0;
+	DWORD			nTextColumns				= 0;
+	DWORD			nTextCharHeight				= 0;
+	DWORD			nTextAttributeMode			= 0;
+	DWORD			cbTextCapture				= 0;
+	DWORD			nTextMismatches				= 0;
+	PCTEST_GEOMETRY	ptGeometry					= NULL;
+	PBYTE			apnPlanes[VGA_PLANES]		= { NULL };
+	CONST BYTE *	apnConstPlanes[VGA_PLANES]	= { NULL };
+	RGBQUAD			atPalette[VGA_COLORS]		= { { 0 } };
+	CHAR			szFixture[64]				= { 0 };
+
+	for (nBackend = 0; ; ++nBackend)
+	{
+		hrResult = VGADECODE_SelectBackend(nBackend);
+		if (HRESULT_FROM_WIN32(ERROR_NO_MORE_ITEMS) == hrResult)
+		{
+			break;
+		}
+		if (FAILED(hrResult))
+		{
+			(VOID)printf("Backend %u isn't supported by this CPU, skipped.\n", nBackend);
+			continue;
+		}
+
+		nBackendMismatches = 0;
+		for (nGeometry = 0; nGeometry < ARRAYSIZE(g_atGeometries); ++nGeometry)
+		{
+			ptGeometry = &(g_atGeometries[nGeometry]);
+
+			for (nPlane = 0; nPlane < VGA_PLANES; ++nPlane)
+			{
+				// Mode 12h screens are tested as the VGA_DUMPs
+				// the driver used to save.
+				apnPlanes[nPlane] = (0 == nGeometry) ? g_tDump.atPlanes[nPlane] : g_aanPlanes[nPlane];
+				apnConstPlanes[nPlane] = apnPlanes[nPlane];
+			}
+
+			for (nKind = 0; nKind < TEST_KINDS; ++nKind)
+			{
+				for (nSeed = 0; nSeed < TEST_SEEDS; ++nSeed)
+				{
+					g_nRandom = 0x9E3779B9 ^ ((nGeometry << 16) | (nKind << 8) | nSeed);
+
+					test_Generate((TEST_KIND)nKind, ptGeometry->cbStride * ptGeometry->nHeight, apnPlanes);
+					for (nColor = 0; nColor < VGA_COLORS; ++nColor)
+					{
+						*(DWORD *)&(atPalette[nColor]) = test_Random();
+					}
+
+					(VOID)snprintf(szFixture,
+								   sizeof(szFixture),
+								   "%s %ux%u stride %u %s seed %u",
+								   VGADECODE_GetBackendName(),
+								   ptGeometry->nWidth,
+								   ptGeometry->nHeight,
+								   ptGeometry->cbStride,
+								   g_apszKindNames[nKind],
+								   nSeed);
+
+					++nChecks;
+					nBackendMismatches += test_CheckScreen(apnConstPlanes, ptGeometry, atPalette, szFixture);
+				}
+			}
+		}
+
+		(VOID)printf("%s: %u mismatches\n", VGADECODE_GetBackendName(), nBackendMismatches);
+		nMismatches += nBackendMismatches;
+	}
+
+	(VOID)VGADECODE_SelectBackend(VGADECODE_BACKEND_DEFAULT);
+
+	// Text is drawn the same way whatever the backend.
+	for (nTextColumns = 0; nTextColumns < ARRAYSIZE(g_anTextColumns); ++nTextColumns)
+	{
+		for (nTextCharHeight = 0; nTextCharHeight < ARRAYSIZE(g_anTextCharHeights); ++nTextCharHeight)
+		{
+			for (nTextAttributeMode = 0; nTextAttributeMode < ARRAYSIZE(g_anTextAttributeModes); ++nTextAttributeMode)
+			{
+				g_nRandom = 0x7F4A7C15 ^ ((nTextColumns << 16) | (nTextCharHeight << 8) | nTextAttributeMode);
+
+				cbTextCapture = test_GenerateText(&g_tTextCapture,
+												  g_anTextColumns[nTextColumns],
+												  g_anTextCharHeights[nTextCharHeight],
+												  g_anTextAttributeModes[nTextAttributeMode]);
+
+				(VOID)snprintf(szFixture,
+							   sizeof(szFixture),
+							   "text %ux%u characters of %u lines, mode %02X",
+							   g_anTextColumns[nTextColumns],
+							   TEST_TEXT_ROWS,
+							   g_anTextCharHeights[nTextCharHeight],
+							   g_anTextAttributeModes[nTextAttributeMode]);
+
+				++nChecks;
+				nTextMismatches += test_CheckText(&g_tTextCapture, cbTextCapture, szFixture);
+			}
+		}
+	}
+
+	(VOID)printf("text: %u mismatches\n", nTextMismatches);
+	nMismatches += nTextMismatches;
+
+	(VOID)printf("%u screens checked, %u mismatches.\n", nChecks, nMismatches);
+
+	return (0 == nMismatches) ? EXIT_SUCCESS : EXIT_FAILURE;
+}